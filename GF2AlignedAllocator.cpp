@@ -0,0 +1,197 @@
+#include "GF2AlignedAllocator.hpp"
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <sys/mman.h>
+#include <unordered_map>
+#if defined(__APPLE__)
+#include <mach/vm_statistics.h>
+#endif
+
+namespace {
+
+constexpr size_t HUGE_2M = size_t(2) << 20;
+constexpr size_t HUGE_1G = size_t(1) << 30;
+
+std::atomic<int>& mode_value() {
+    static std::atomic<int> mode = [] {
+        GF2HugePages mode = GF2HugePages::Off;
+        if (const char* value = std::getenv("GF2_HUGE_PAGES")) {
+            gf2_parse_huge_pages(value, mode);
+        }
+        return static_cast<int>(mode);
+    }();
+    return mode;
+}
+
+// Huge-page allocations and how to release them, as the deallocation of an
+// allocator only has the element count and the mode may have changed since
+struct HugeBlock {
+    size_t bytes;
+    bool mapped; // munmap, else free
+};
+
+struct HugeRegistry {
+    std::mutex mutex;
+    std::unordered_map<void*, HugeBlock> blocks;
+
+    static HugeRegistry& get() {
+        static HugeRegistry registry;
+        return registry;
+    }
+};
+
+size_t round_up(size_t bytes, size_t unit) {
+    return (bytes + unit - 1) / unit * unit;
+}
+
+// An anonymous mapping from the explicit huge-page pool of page_bytes, or null
+void* map_explicit(size_t bytes, size_t page_bytes) {
+#if defined(MAP_HUGETLB)
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+#if defined(MAP_HUGE_SHIFT)
+    flags |= (page_bytes == HUGE_1G ? 30 : 21) << MAP_HUGE_SHIFT;
+#endif
+    void* ptr = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+    return ptr == MAP_FAILED ? nullptr : ptr;
+#elif defined(__APPLE__) && defined(VM_FLAGS_SUPERPAGE_SIZE_2MB)
+    (void)page_bytes;
+    void* ptr = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON,
+                       VM_FLAGS_SUPERPAGE_SIZE_2MB, 0);
+    return ptr == MAP_FAILED ? nullptr : ptr;
+#else
+    (void)bytes;
+    (void)page_bytes;
+    return nullptr;
+#endif
+}
+
+// 2 MiB aligned memory with the transparent huge-page hint; advised tells
+// whether the kernel took the hint
+void* allocate_transparent(size_t bytes, bool& mapped, bool& advised) {
+    mapped = false;
+    advised = false;
+#if defined(__APPLE__)
+    // A superpage mapping where the hardware has them (Intel Macs)
+    if (void* ptr = map_explicit(bytes, HUGE_2M)) {
+        mapped = true;
+        advised = true;
+        return ptr;
+    }
+#endif
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, HUGE_2M, bytes) != 0) {
+        return nullptr;
+    }
+#if defined(MADV_HUGEPAGE)
+    advised = ::madvise(ptr, bytes, MADV_HUGEPAGE) == 0;
+#endif
+    return ptr;
+}
+
+} // namespace
+
+GF2HugePages gf2_huge_pages() {
+    return static_cast<GF2HugePages>(mode_value().load(std::memory_order_relaxed));
+}
+
+void gf2_set_huge_pages(GF2HugePages mode) {
+    mode_value().store(static_cast<int>(mode), std::memory_order_relaxed);
+}
+
+const char* gf2_huge_pages_name(GF2HugePages mode) {
+    switch (mode) {
+        case GF2HugePages::Off: return "off";
+        case GF2HugePages::Transparent: return "thp";
+        case GF2HugePages::Explicit: return "2m";
+        case GF2HugePages::Explicit1G: return "1g";
+    }
+    return "off";
+}
+
+bool gf2_parse_huge_pages(const std::string& name, GF2HugePages& mode) {
+    for (GF2HugePages m : {GF2HugePages::Off, GF2HugePages::Transparent, GF2HugePages::Explicit,
+                           GF2HugePages::Explicit1G}) {
+        if (name == gf2_huge_pages_name(m)) {
+            mode = m;
+            return true;
+        }
+    }
+    return false;
+}
+
+void* gf2_huge_allocate(size_t bytes, size_t& held) {
+    const GF2HugePages mode = gf2_huge_pages();
+    if (mode == GF2HugePages::Off || bytes < GF2_HUGE_PAGE_MIN_BYTES) {
+        return nullptr;
+    }
+    GF2StorageUsage& usage = GF2StorageUsage::get();
+    void* ptr = nullptr;
+    bool mapped = false;
+    if (mode != GF2HugePages::Transparent) {
+        const size_t page = (mode == GF2HugePages::Explicit1G && bytes >= HUGE_1G) ? HUGE_1G
+                                                                                   : HUGE_2M;
+        held = round_up(bytes, page);
+        ptr = map_explicit(held, page);
+        if (ptr) {
+            mapped = true;
+            usage.huge_allocations.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            usage.huge_fallbacks.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (!ptr) {
+        bool advised = false;
+        held = round_up(bytes, HUGE_2M);
+        ptr = allocate_transparent(held, mapped, advised);
+        if (!ptr) {
+            return nullptr;
+        }
+        if (advised) {
+            usage.advised_allocations.fetch_add(1, std::memory_order_relaxed);
+        } else if (mode == GF2HugePages::Transparent) {
+            usage.huge_fallbacks.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    HugeRegistry& registry = HugeRegistry::get();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.blocks[ptr] = HugeBlock{held, mapped};
+    return ptr;
+}
+
+bool gf2_huge_free(void* ptr, size_t& held) {
+    HugeBlock block;
+    {
+        HugeRegistry& registry = HugeRegistry::get();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        auto it = registry.blocks.find(ptr);
+        if (it == registry.blocks.end()) {
+            return false;
+        }
+        block = it->second;
+        registry.blocks.erase(it);
+    }
+    held = block.bytes;
+    if (block.mapped) {
+        ::munmap(ptr, block.bytes);
+    } else {
+        std::free(ptr);
+    }
+    return true;
+}
+
+long long gf2_transparent_huge_bytes() {
+    FILE* file = std::fopen("/proc/self/smaps_rollup", "r");
+    if (!file) {
+        return -1;
+    }
+    long long kb = -1;
+    char line[256];
+    while (std::fgets(line, sizeof(line), file)) {
+        if (std::sscanf(line, "AnonHugePages: %lld kB", &kb) == 1) {
+            break;
+        }
+    }
+    std::fclose(file);
+    return kb < 0 ? -1 : kb * 1024;
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <utility>
+#include <unistd.h>
+
+// Minimum alignment of GF2Matrix storage: one cache line, which is also the
+// width of the widest vector loads (AVX-512).
+constexpr size_t GF2_STORAGE_ALIGNMENT = 64;
+
+// Allocations of at least this size are aligned to, and padded to a multiple
+// of, the page size so that they can be wrapped by the GPU without a copy.
+constexpr size_t GF2_PAGE_ALIGN_MIN_BYTES = 64 * 1024;
+
+inline size_t gf2_page_size() {
+    static const size_t page = [] {
+        long size = sysconf(_SC_PAGESIZE);
+        return size > 0 ? static_cast<size_t>(size) : size_t(4096);
+    }();
+    return page;
+}
+
+// Huge-page backing of allocations of at least GF2_HUGE_PAGE_MIN_BYTES,
+// which cuts the TLB misses of the strided B^T walks of large products.
+// Transparent aligns them to 2 MiB and asks for transparent huge pages
+// (madvise(MADV_HUGEPAGE) on Linux, a superpage mapping on macOS); the
+// kernel may still back them with small pages. Explicit maps them from the
+// reserved 2 MiB pool (MAP_HUGETLB), and Explicit1G the ones of at least
+// 1 GiB from the 1 GiB pool; either falls back to Transparent when the pool
+// is empty. The mode starts from GF2_HUGE_PAGES (off, thp, 2m, 1g).
+enum class GF2HugePages { Off, Transparent, Explicit, Explicit1G };
+
+constexpr size_t GF2_HUGE_PAGE_MIN_BYTES = size_t(2) << 20;
+
+GF2HugePages gf2_huge_pages();
+void gf2_set_huge_pages(GF2HugePages mode);
+const char* gf2_huge_pages_name(GF2HugePages mode);
+// Mode from its name; false if there is no such mode
+bool gf2_parse_huge_pages(const std::string& name, GF2HugePages& mode);
+
+// Storage of huge-page backed allocations: gf2_huge_allocate returns null
+// when the mode is off, else bytes or more (held) of huge-page aligned
+// memory; gf2_huge_free releases it and returns false for other pointers.
+void* gf2_huge_allocate(size_t bytes, size_t& held);
+bool gf2_huge_free(void* ptr, size_t& held);
+
+// Bytes of the process backed by transparent huge pages (AnonHugePages of
+// /proc/self/smaps_rollup), or -1 where that cannot be read
+long long gf2_transparent_huge_bytes();
+
+// Bytes held by GF2AlignedAllocator across all threads (matrix storage and
+// the workspaces), and the most held since the peak was last reset. The
+// allocation counts follow the huge-page requests: explicit ones that got
+// their pages, transparent ones that were advised, and the requests that
+// had to fall back to small pages.
+struct GF2StorageUsage {
+    std::atomic<size_t> live{0};
+    std::atomic<size_t> peak{0};
+    std::atomic<size_t> huge_allocations{0};
+    std::atomic<size_t> advised_allocations{0};
+    std::atomic<size_t> huge_fallbacks{0};
+
+    static GF2StorageUsage& get() {
+        static GF2StorageUsage usage;
+        return usage;
+    }
+
+    void add(size_t bytes) {
+        const size_t now = live.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        size_t seen = peak.load(std::memory_order_relaxed);
+        while (now > seen &&
+               !peak.compare_exchange_weak(seen, now, std::memory_order_relaxed)) {
+        }
+    }
+    void remove(size_t bytes) { live.fetch_sub(bytes, std::memory_order_relaxed); }
+    // The peak from now on starts at what is live
+    void resetPeak() { peak.store(live.load(std::memory_order_relaxed), std::memory_order_relaxed); }
+};
+
+// std::allocator replacement returning GF2_STORAGE_ALIGNMENT (or page) aligned
+// memory.
+template <typename T>
+struct GF2AlignedAllocator {
+    using value_type = T;
+
+    GF2AlignedAllocator() noexcept = default;
+    template <typename U>
+    GF2AlignedAllocator(const GF2AlignedAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        size_t alignment = 0;
+        const size_t bytes = allocation_bytes(n, alignment);
+        if (bytes >= GF2_HUGE_PAGE_MIN_BYTES) {
+            size_t held = 0;
+            if (void* huge = gf2_huge_allocate(bytes, held)) {
+                GF2StorageUsage::get().add(held);
+                return static_cast<T*>(huge);
+            }
+        }
+
+        void* ptr = nullptr;
+        if (posix_memalign(&ptr, alignment, bytes) != 0) {
+            throw std::bad_alloc();
+        }
+        GF2StorageUsage::get().add(bytes);
+        return static_cast<T*>(ptr);
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept {
+        size_t alignment = 0;
+        const size_t bytes = allocation_bytes(n, alignment);
+        size_t held = 0;
+        if (bytes >= GF2_HUGE_PAGE_MIN_BYTES && gf2_huge_free(ptr, held)) {
+            GF2StorageUsage::get().remove(held);
+            return;
+        }
+        GF2StorageUsage::get().remove(bytes);
+        std::free(ptr);
+    }
+
+    // The padded size of an allocation of n elements, and its alignment
+    static size_t allocation_bytes(size_t n, size_t& alignment) {
+        size_t bytes = n * sizeof(T);
+        alignment = GF2_STORAGE_ALIGNMENT;
+        if (bytes >= GF2_PAGE_ALIGN_MIN_BYTES) {
+            alignment = gf2_page_size();
+        }
+        return (bytes + alignment - 1) / alignment * alignment;
+    }
+
+    template <typename U>
+    bool operator==(const GF2AlignedAllocator<U>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const GF2AlignedAllocator<U>&) const noexcept { return false; }
+};
+
+// GF2AlignedAllocator whose resize(n) leaves the new elements uninitialized,
+// for storage the owner fills itself (GF2Matrix zeroes its rows by first
+// touch, GF2Numa.hpp)
+template <typename T>
+struct GF2UninitializedAllocator : GF2AlignedAllocator<T> {
+    GF2UninitializedAllocator() noexcept = default;
+    template <typename U>
+    GF2UninitializedAllocator(const GF2UninitializedAllocator<U>&) noexcept {}
+
+    template <typename U>
+    void construct(U* p) noexcept {
+        ::new (static_cast<void*>(p)) U;
+    }
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args) {
+        ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+};
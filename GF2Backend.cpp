@@ -0,0 +1,80 @@
+#include "GF2Backend.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#ifdef GF2_HAVE_METAL
+// metal-cpp's definitions, compiled into this file only
+#define NS_PRIVATE_IMPLEMENTATION
+#define MTL_PRIVATE_IMPLEMENTATION
+#define CA_PRIVATE_IMPLEMENTATION
+#include "GF2GPU.hpp"
+#include "GF2MultiGPU.hpp"
+#endif
+#ifdef GF2_HAVE_OPENCL
+#include "GF2OpenCL.hpp"
+#endif
+
+namespace {
+
+#ifdef GF2_HAVE_METAL
+// Every device as one GF2MultiGPU where there are several, unless
+// GF2_GPU_DEVICES=default asks for the system default device alone
+std::unique_ptr<GF2Backend> create_metal() {
+    const char* devices = std::getenv("GF2_GPU_DEVICES");
+    if (devices && std::string(devices) == "default") {
+        MTL::Device* device = MTL::CreateSystemDefaultDevice();
+        if (!device) {
+            return nullptr;
+        }
+        auto backend = std::make_unique<GF2GPU>(device);
+        device->release(); // the backend holds its own reference
+        return backend;
+    }
+    std::vector<std::unique_ptr<GF2GPU>> gpus = GF2GPU::createAll();
+    if (gpus.empty()) {
+        return nullptr;
+    }
+    if (gpus.size() == 1) {
+        return std::move(gpus.front());
+    }
+    return std::make_unique<GF2MultiGPU>(std::move(gpus));
+}
+#endif
+
+#ifdef GF2_HAVE_OPENCL
+std::unique_ptr<GF2Backend> create_opencl() {
+    try {
+        return std::make_unique<GF2OpenCL>();
+    } catch (const std::runtime_error& e) {
+        std::cerr << "OpenCL backend unavailable: " << e.what() << std::endl;
+        return nullptr;
+    }
+}
+#endif
+
+} // namespace
+
+std::unique_ptr<GF2Backend> GF2Backend::create() {
+    std::string wanted;
+    if (const char* value = std::getenv("GF2_GPU_BACKEND")) {
+        wanted = value;
+    }
+
+#ifdef GF2_HAVE_METAL
+    if (wanted.empty() || wanted == "metal") {
+        if (auto backend = create_metal()) {
+            return backend;
+        }
+    }
+#endif
+#ifdef GF2_HAVE_OPENCL
+    if (wanted.empty() || wanted == "opencl") {
+        if (auto backend = create_opencl()) {
+            return backend;
+        }
+    }
+#endif
+    return nullptr;
+}
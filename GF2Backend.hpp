@@ -0,0 +1,99 @@
+#pragma once
+
+#include "GF2Matrix.hpp"
+#include <memory>
+#include <string>
+
+class GF2TiledMatrix;
+
+// Where the time of one GPU multiply went: host preparation (checks, CPU
+// transposes and packing, command encoding), copies of the operands into GPU
+// buffers, GPU execution (GPUStartTime to GPUEndTime of the command buffer)
+// and the copy of the result back. Copies are zero for wrapped storage.
+struct GF2GPUTiming {
+    double host_ms = 0.0;
+    double upload_ms = 0.0;
+    double gpu_ms = 0.0;
+    double readback_ms = 0.0;
+};
+
+// The GPU multiply kernels. A backend need not have all of them.
+enum class GF2Kernel { Baseline, Transposed, Tiled, Vectorized, SimdGroup, M4R };
+
+// A GPU API the multiply kernels run on: GF2GPU on Metal, GF2OpenCL on hosts
+// with an OpenCL runtime. Code that only multiplies matrices (GF2Engine, the
+// test framework) goes through this interface, so it works with whichever
+// backend the host has.
+class GF2Backend {
+public:
+    using Kernel = GF2Kernel;
+
+    virtual ~GF2Backend() = default;
+
+    // "Metal", "OpenCL"
+    virtual const char* backendName() const = 0;
+    virtual std::string deviceName() const = 0;
+
+    // Whether multiply() runs the kernel (it may be compiled on first use)
+    virtual bool supports(Kernel kernel) = 0;
+
+    // result = a * b, synchronously. result must be a.rows() x b.cols().
+    virtual void multiply(Kernel kernel, const GF2Matrix& a, const GF2Matrix& b,
+                          GF2Matrix& result) = 0;
+
+    // y = a * x and y = x^T * a for n x 64 blocks x, synchronously, with the
+    // layouts of GF2Matrix::multiplyBlock and leftMultiplyBlock. A single
+    // vector goes in column 0 of a block.
+    virtual void multiplyBlock(const GF2Matrix& a, const uint64_t* x, uint64_t* y) = 0;
+    virtual void leftMultiplyBlock(const GF2Matrix& a, const uint64_t* x, uint64_t* y) = 0;
+
+    // result = a * b^T (a.cols() == b.cols()) and result = a^T * b
+    // (a.rows() == b.rows()), synchronously, without a transpose: the first
+    // runs the transposed kernel on b as the B^T it reads, the second has one
+    // work-item per result word XOR the words of b that 64-column block of
+    // a selects. As (A B^T)^T = B A^T and (A^T B)^T = B^T A, swapping a and b
+    // writes the transposed product instead.
+    virtual void multiplyABt(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result) = 0;
+    virtual void multiplyAtB(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result) = 0;
+
+    // The same products for an operand in column-major orientation
+    // (GF2Matrix::transpose()), by the kernel that reads it as it is
+    // stored; a * a^T runs multiplyAAt, mirrored
+    void multiply(const GF2Matrix& a, const GF2Transposed& b, GF2Matrix& result) {
+        if (&b.transpose() == &a) {
+            multiplyAAt(a, result, GF2Triangle::Lower, true);
+        } else {
+            multiplyABt(a, b.transpose(), result);
+        }
+    }
+    void multiply(const GF2Transposed& a, const GF2Matrix& b, GF2Matrix& result) {
+        multiplyAtB(a.transpose(), b, result);
+    }
+
+    // One triangle of result = a * a^T (a.rows() x a.rows()), synchronously,
+    // as GF2Matrix::multiplyAAt: a work-item per result word of the triangle
+    // takes dot products of rows of a, and the other triangle is zero, or
+    // mirrored on the CPU (GF2Matrix::mirrorTriangle) if mirror is set
+    virtual void multiplyAAt(const GF2Matrix& a, GF2Matrix& result, GF2Triangle triangle,
+                             bool mirror) = 0;
+
+    // result = a * b in the Morton-ordered tiled layout (GF2TiledMatrix.hpp),
+    // synchronously: one work-group per result tile, which stages each B
+    // tile it meets in local memory with unit-stride, coalesced loads.
+    // result must be a.rows() x b.cols() with the same tile size.
+    virtual void multiplyTiled(const GF2TiledMatrix& a, const GF2TiledMatrix& b,
+                               GF2TiledMatrix& result) = 0;
+
+    // Phases of the most recently completed multiply
+    virtual GF2GPUTiming lastTiming() const = 0;
+
+    // Device memory the backend holds now (operand buffers, pooled buffers,
+    // tables), and the most it held since resetPeakAllocated()
+    virtual size_t allocatedBytes() const = 0;
+    virtual size_t peakAllocatedBytes() const = 0;
+    virtual void resetPeakAllocated() = 0;
+
+    // The backend for this host: GF2_GPU_BACKEND (metal or opencl) if set,
+    // else the first one built in that finds a GPU. Null if there is none.
+    static std::unique_ptr<GF2Backend> create();
+};
@@ -0,0 +1,269 @@
+#include "GF2Basis.hpp"
+#include "GF2Kernels.hpp"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <omp.h>
+#include <stdexcept>
+
+namespace {
+
+// Basis rows per Four Russians table, and the bytes of the tables a pass
+// over the vectors applies
+constexpr size_t TABLE_ROWS = 8;
+constexpr size_t TABLE_BYTES = size_t(8) << 20;
+// Vectors, and bytes of tables, taken together to keep both in cache
+constexpr size_t BLOCK_ROWS = 64;
+constexpr size_t CACHE_BYTES = size_t(256) << 10;
+
+int resolve_threads(int num_threads) {
+    return num_threads > 0 ? num_threads : omp_get_max_threads();
+}
+
+// A vector's words for the single-vector calls, one buffer per thread
+uint64_t* scratch(size_t words) {
+    thread_local std::vector<uint64_t> buffer;
+    if (buffer.size() < words) {
+        buffer.resize(words);
+    }
+    return buffer.data();
+}
+
+} // namespace
+
+GF2Basis::GF2Basis(size_t cols, size_t capacity)
+    : m_cols(cols), m_rows(std::max<size_t>(capacity, 1), cols), m_pivot_row(cols, NO_ROW) {}
+
+GF2MatrixView GF2Basis::basis() const {
+    return m_rows.view(0, rank(), 0, m_cols);
+}
+
+// A basis row has zeros before its pivot, so XORing it in from the pivot's
+// word leaves the ones already passed alone, and clears the one at the pivot
+size_t GF2Basis::reduce(uint64_t* v) const {
+    const RowKernel& kernel = row_kernel();
+    const size_t words = words_per_row();
+    size_t lead = m_cols;
+    for (size_t w = kernel.first_nonzero(v, words); w < words; ++w) {
+        uint64_t bits = v[w];
+        while (bits) {
+            const unsigned b = unsigned(__builtin_ctzll(bits));
+            const size_t r = m_pivot_row[w * 64 + b];
+            if (r != NO_ROW) {
+                kernel.xor_rows(v + w, row(r) + w, words - w);
+            } else if (lead == m_cols) {
+                lead = w * 64 + b;
+            }
+            bits = b == 63 ? 0 : v[w] & (~uint64_t(0) << (b + 1));
+        }
+    }
+    return lead;
+}
+
+bool GF2Basis::contains(const uint64_t* v) const {
+    uint64_t* work = scratch(words_per_row());
+    std::memcpy(work, v, words_per_row() * sizeof(uint64_t));
+    return reduce(work) == m_cols;
+}
+
+bool GF2Basis::contains(const GF2Matrix& rows, size_t r) const {
+    if (rows.cols() != m_cols || r >= rows.rows()) {
+        throw std::runtime_error("Vector does not match the basis");
+    }
+    return contains(rows.get_raw_data() + r * rows.row_stride());
+}
+
+bool GF2Basis::insert(const uint64_t* v) {
+    uint64_t* work = scratch(words_per_row());
+    std::memcpy(work, v, words_per_row() * sizeof(uint64_t));
+    const size_t pivot = reduce(work);
+    if (pivot == m_cols) {
+        return false;
+    }
+    append(work, pivot);
+    return true;
+}
+
+bool GF2Basis::insert(const GF2Matrix& rows, size_t r) {
+    if (rows.cols() != m_cols || r >= rows.rows()) {
+        throw std::runtime_error("Vector does not match the basis");
+    }
+    return insert(rows.get_raw_data() + r * rows.row_stride());
+}
+
+void GF2Basis::append(const uint64_t* v, size_t pivot) {
+    const size_t r = rank();
+    if (r == m_rows.rows()) {
+        GF2Matrix grown(2 * m_rows.rows(), m_cols);
+        std::memcpy(grown.get_raw_data(), m_rows.get_raw_data(),
+                    r * m_rows.row_stride() * sizeof(uint64_t));
+        m_rows = std::move(grown);
+    }
+    std::memcpy(m_rows.get_raw_data() + r * m_rows.row_stride(), v,
+                words_per_row() * sizeof(uint64_t));
+    m_pivots.push_back(pivot);
+    m_pivot_row[pivot] = r;
+}
+
+// Groups of TABLE_ROWS basis rows in pivot order p0 < ... < p7. A row has
+// zeros before its pivot, so after reducing each row of a group by the later
+// ones at their pivots, row j is the only one with a one at p_j, and the
+// combination of rows a vector needs is read off its bits at p0..p7. The
+// rows of later groups are zero at the pivots of earlier ones, so a group's
+// cleared bits stay cleared. A table holds the words from p0's on. The
+// tables of as many groups as fit TABLE_BYTES are built at a time.
+void GF2Basis::reduceTables(GF2Matrix& work, int num_threads) const {
+    struct Group {
+        size_t pivot[TABLE_ROWS];
+        size_t rows;
+        size_t w0;     // first word of the table
+        size_t offset; // of the table in 'tables'
+    };
+    const size_t words = words_per_row();
+    std::vector<size_t> order(rank());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::sort(order.begin(), order.end(),
+              [&](size_t x, size_t y) { return m_pivots[x] < m_pivots[y]; });
+
+    const RowKernel& kernel = row_kernel();
+    const int threads = resolve_threads(num_threads);
+    uint64_t* data = work.get_raw_data();
+    const size_t stride = work.row_stride();
+    std::vector<uint64_t> group_rows(TABLE_ROWS * words);
+    std::vector<uint64_t> tables;
+    std::vector<Group> groups;
+    for (size_t g0 = 0; g0 < order.size();) {
+        groups.clear();
+        tables.clear();
+        for (; g0 < order.size() && tables.size() * sizeof(uint64_t) < TABLE_BYTES;
+             g0 += TABLE_ROWS) {
+            Group g;
+            g.rows = std::min(TABLE_ROWS, order.size() - g0);
+            for (size_t j = 0; j < g.rows; ++j) {
+                g.pivot[j] = m_pivots[order[g0 + j]];
+                std::memcpy(&group_rows[j * words], row(order[g0 + j]), words * sizeof(uint64_t));
+            }
+            for (size_t j = g.rows; j-- > 0;) {
+                for (size_t i = j + 1; i < g.rows; ++i) {
+                    if ((group_rows[j * words + g.pivot[i] / 64] >> (g.pivot[i] % 64)) & 1) {
+                        kernel.xor_rows(&group_rows[j * words], &group_rows[i * words], words);
+                    }
+                }
+            }
+            // table[s] is table[s without its lowest one] ^ that one's row
+            g.w0 = g.pivot[0] / 64;
+            g.offset = tables.size();
+            const size_t width = words - g.w0;
+            tables.resize(g.offset + (size_t(1) << g.rows) * width, 0);
+            uint64_t* table = &tables[g.offset];
+            for (size_t s = 1; s < (size_t(1) << g.rows); ++s) {
+                const size_t low = size_t(__builtin_ctzll(s));
+                std::memcpy(table + s * width, table + (s & (s - 1)) * width,
+                            width * sizeof(uint64_t));
+                kernel.xor_rows(table + s * width, &group_rows[low * words + g.w0], width);
+            }
+            groups.push_back(g);
+        }
+
+        // Blocks of BLOCK_ROWS vectors through runs of groups whose tables
+        // take at most CACHE_BYTES, so each run stays in cache for a block
+        std::vector<size_t> runs = {0};
+        for (size_t g = 0, bytes = 0; g < groups.size(); ++g) {
+            const size_t size =
+                (size_t(1) << groups[g].rows) * (words - groups[g].w0) * sizeof(uint64_t);
+            if (bytes > 0 && bytes + size > CACHE_BYTES) {
+                runs.push_back(g);
+                bytes = 0;
+            }
+            bytes += size;
+        }
+        runs.push_back(groups.size());
+        const long long blocks =
+            static_cast<long long>((work.rows() + BLOCK_ROWS - 1) / BLOCK_ROWS);
+        #pragma omp parallel for schedule(static) num_threads(threads) \
+            if (work.rows() * words >= 4096)
+        for (long long bb = 0; bb < blocks; ++bb) {
+            const size_t r0 = size_t(bb) * BLOCK_ROWS;
+            const size_t r1 = std::min(r0 + BLOCK_ROWS, work.rows());
+            for (size_t run = 0; run + 1 < runs.size(); ++run) {
+                for (size_t r = r0; r < r1; ++r) {
+                    uint64_t* v = data + r * stride;
+                    for (size_t gi = runs[run]; gi < runs[run + 1]; ++gi) {
+                        const Group& g = groups[gi];
+                        size_t s = 0;
+                        for (size_t j = 0; j < g.rows; ++j) {
+                            s |= size_t((v[g.pivot[j] / 64] >> (g.pivot[j] % 64)) & 1) << j;
+                        }
+                        if (s) {
+                            const size_t width = words - g.w0;
+                            kernel.xor_rows(v + g.w0, &tables[g.offset + s * width], width);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+std::vector<bool> GF2Basis::containsBatch(const GF2Matrix& rows, int num_threads) const {
+    if (rows.cols() != m_cols) {
+        throw std::runtime_error("Vectors do not match the basis");
+    }
+    std::vector<bool> in_span(rows.rows());
+    if (rows.rows() < BATCH_MIN_ROWS) {
+        for (size_t r = 0; r < rows.rows(); ++r) {
+            in_span[r] = contains(rows, r);
+        }
+        return in_span;
+    }
+    GF2Matrix work = rows;
+    reduceTables(work, num_threads);
+    const RowKernel& kernel = row_kernel();
+    for (size_t r = 0; r < rows.rows(); ++r) {
+        const uint64_t* v = work.get_raw_data() + r * work.row_stride();
+        in_span[r] = kernel.first_nonzero(v, words_per_row()) == words_per_row();
+    }
+    return in_span;
+}
+
+// After the tables every row is zero at the pivots the basis had; each is
+// then reduced against the rows inserted before it in the batch, which are
+// zero at those pivots too
+std::vector<bool> GF2Basis::insertBatch(const GF2Matrix& rows, int num_threads) {
+    if (rows.cols() != m_cols) {
+        throw std::runtime_error("Vectors do not match the basis");
+    }
+    std::vector<bool> added(rows.rows());
+    if (rows.rows() < BATCH_MIN_ROWS) {
+        for (size_t r = 0; r < rows.rows(); ++r) {
+            added[r] = insert(rows, r);
+        }
+        return added;
+    }
+    GF2Matrix work = rows;
+    reduceTables(work, num_threads);
+    const RowKernel& kernel = row_kernel();
+    const size_t words = words_per_row();
+    uint64_t* data = work.get_raw_data();
+    for (size_t r = 0; r < rows.rows(); ++r) {
+        uint64_t* v = data + r * work.row_stride();
+        if (kernel.first_nonzero(v, words) == words) {
+            continue;
+        }
+        const size_t pivot = reduce(v);
+        if (pivot != m_cols) {
+            append(v, pivot);
+            added[r] = true;
+        }
+    }
+    return added;
+}
+
+void GF2Basis::clear() {
+    for (size_t pivot : m_pivots) {
+        m_pivot_row[pivot] = NO_ROW;
+    }
+    m_pivots.clear();
+    std::memset(m_rows.get_raw_data(), 0,
+                m_rows.rows() * m_rows.row_stride() * sizeof(uint64_t));
+}
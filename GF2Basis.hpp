@@ -0,0 +1,79 @@
+#pragma once
+
+#include "GF2Matrix.hpp"
+#include "GF2MatrixView.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A basis of the span of the row vectors inserted so far, kept in echelon
+// form for linear-independence filtering and deduplication of a stream of
+// vectors. Each basis row has a pivot: its first one, in a column where no
+// other row has its pivot. A vector is reduced by walking its ones from the
+// left and XORing in, with the dispatched row kernel, the basis row whose
+// pivot is at each one it meets, from that word on. What is left is zero if
+// and only if the vector is in the span; otherwise it is independent and
+// its first one becomes a new pivot. Reduced this way a vector has a zero
+// in every pivot column, so an insert or a query costs at most rank()
+// partial row XORs of the words past each pivot, never an elimination.
+//
+// The batch calls reduce many vectors against the basis at once by the
+// Four Russians method: the basis rows in pivot order are taken eight at a
+// time, reduced against each other, and their 256 combinations tabled, so
+// that the eight pivot bits of a vector select the combination that clears
+// them with one XOR. Candidates are split over OpenMP threads. Not for
+// concurrent use, except the const calls.
+class GF2Basis {
+public:
+    // Batches of fewer vectors than this are reduced one vector at a time,
+    // which is cheaper than building the tables
+    static constexpr size_t BATCH_MIN_ROWS = 128;
+
+    // Vectors of 'cols' bits. Storage for 'capacity' rows is reserved up
+    // front; it grows by doubling as needed.
+    explicit GF2Basis(size_t cols, size_t capacity = 64);
+
+    size_t cols() const { return m_cols; }
+    size_t words_per_row() const { return m_rows.words_per_row(); }
+    size_t rank() const { return m_pivots.size(); }
+
+    // The basis rows in insertion order, and the pivot column of each
+    GF2MatrixView basis() const;
+    const std::vector<size_t>& pivots() const { return m_pivots; }
+
+    // Reduces v (words_per_row() words, zero past cols()) in place against
+    // the basis; returns its first one afterwards, cols() if it is zero
+    size_t reduce(uint64_t* v) const;
+    // Whether v is in the span
+    bool contains(const uint64_t* v) const;
+    bool contains(const GF2Matrix& rows, size_t r) const;
+    // Adds v to the basis if it is independent of it; returns whether it was
+    bool insert(const uint64_t* v);
+    bool insert(const GF2Matrix& rows, size_t r);
+
+    // Every row of 'rows' (cols() columns, else std::runtime_error): whether
+    // each is in the span, and inserting them in order, whether each was
+    // independent of the basis and the rows before it. Both are what the
+    // single-vector calls give, row by row. num_threads <= 0 uses the
+    // OpenMP default.
+    std::vector<bool> containsBatch(const GF2Matrix& rows, int num_threads = 0) const;
+    std::vector<bool> insertBatch(const GF2Matrix& rows, int num_threads = 0);
+
+    // Empties the basis, keeping the storage
+    void clear();
+
+private:
+    static constexpr size_t NO_ROW = SIZE_MAX;
+
+    // Reduces the rows of 'work' in place against the whole basis with the
+    // Four Russians tables
+    void reduceTables(GF2Matrix& work, int num_threads) const;
+    // Appends v, reduced with its first one at 'pivot'
+    void append(const uint64_t* v, size_t pivot);
+    const uint64_t* row(size_t i) const { return m_rows.get_raw_data() + i * m_rows.row_stride(); }
+
+    size_t m_cols;
+    GF2Matrix m_rows;                 // rank() rows in use
+    std::vector<size_t> m_pivots;     // pivot column of each row
+    std::vector<size_t> m_pivot_row;  // row whose pivot a column is, or NO_ROW
+};
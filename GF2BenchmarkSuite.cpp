@@ -0,0 +1,249 @@
+#include "GF2TestFramework.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <omp.h>
+#include <set>
+#include <stdexcept>
+
+namespace {
+
+// Methods whose speed depends on the engine's thread count
+bool is_threaded(GF2Engine::Method method) {
+  return method == GF2Engine::Method::SIMDParallel ||
+         method == GF2Engine::Method::SIMDTile ||
+         method == GF2Engine::Method::Hybrid;
+}
+
+double gops(size_t m, size_t k, size_t n, double ms) {
+  return double(m) * double(k) * double(n) / (ms / 1000.0) / 1e9;
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// 1, 2, 4, ... and the OpenMP maximum itself
+std::vector<int> default_thread_counts() {
+  const int max_threads = std::max(omp_get_max_threads(), 1);
+  std::vector<int> counts;
+  for (int t = 1; t < max_threads; t *= 2) {
+    counts.push_back(t);
+  }
+  counts.push_back(max_threads);
+  return counts;
+}
+
+} // namespace
+
+BenchmarkSuite::BenchmarkSuite(BenchmarkConfig config)
+    : _config(std::move(config)), _backend(GF2Backend::create()) {
+  if (_config.thread_counts.empty()) {
+    _config.thread_counts = default_thread_counts();
+  }
+  std::sort(_config.scaling_sizes.begin(), _config.scaling_sizes.end());
+}
+
+BenchmarkSuite::~BenchmarkSuite() = default;
+
+GF2Engine &BenchmarkSuite::engineFor(int threads) {
+  std::unique_ptr<GF2Engine> &engine = _engines[threads];
+  if (!engine) {
+    GF2EngineConfig config;
+    config.num_threads = threads;
+    engine = std::make_unique<GF2Engine>(_backend.get(), config);
+  }
+  return *engine;
+}
+
+void BenchmarkSuite::runScalingBenchmark() {
+  std::cout << "=== Scaling benchmark ===\n";
+  const std::vector<GF2Engine::Method> methods = engineFor(0).availableMethods();
+
+  // (method, threads) pairs that got too slow at a smaller size
+  std::set<std::pair<GF2Engine::Method, int>> dropped;
+  for (size_t size : _config.scaling_sizes) {
+    GF2Matrix a = GF2TestFramework::generateRandomMatrix(size, size);
+    GF2Matrix b = GF2TestFramework::generateRandomMatrix(size, size);
+    GF2Matrix result(size, size);
+
+    for (GF2Engine::Method method : methods) {
+      const std::vector<int> thread_counts =
+          is_threaded(method) ? _config.thread_counts : std::vector<int>{0};
+      for (int threads : thread_counts) {
+        if (dropped.count({method, threads})) {
+          continue;
+        }
+        GF2Engine &engine = engineFor(threads);
+        std::vector<double> times;
+        try {
+          engine.run(method, a, b, result); // warm up
+          for (int i = 0; i < std::max(_config.repetitions, 1); ++i) {
+            auto start = std::chrono::steady_clock::now();
+            engine.run(method, a, b, result);
+            times.push_back(elapsed_ms(start));
+          }
+        } catch (const std::exception &e) {
+          std::cout << "  " << GF2Engine::methodName(method) << " " << size
+                    << ": " << e.what() << "\n";
+          dropped.insert({method, threads});
+          continue;
+        }
+        std::sort(times.begin(), times.end());
+        const double median = times[times.size() / 2];
+        _scaling.push_back(
+            {method, size, threads, median, gops(size, size, size, median)});
+
+        std::cout << "  " << GF2Engine::methodName(method) << " " << size
+                  << "x" << size;
+        if (threads > 0) {
+          std::cout << ", " << threads << " threads";
+        }
+        std::cout << ": " << median << " ms, "
+                  << _scaling.back().gops << " GOps/s\n";
+        if (median > _config.max_method_ms) {
+          dropped.insert({method, threads});
+        }
+      }
+    }
+  }
+}
+
+void BenchmarkSuite::runThroughputBenchmark() {
+  std::cout << "=== Throughput benchmark ===\n";
+  const size_t size = _config.throughput_size;
+  GF2Matrix a = GF2TestFramework::generateRandomMatrix(size, size);
+  GF2Matrix b = GF2TestFramework::generateRandomMatrix(size, size);
+  GF2Matrix result(size, size);
+  GF2Engine &engine = engineFor(0);
+
+  for (GF2Engine::Method method : engine.availableMethods()) {
+    ThroughputPoint point{method, 0, 0.0, 0.0, 0.0, 0.0};
+    try {
+      engine.run(method, a, b, result); // warm up
+      auto start = std::chrono::steady_clock::now();
+      // Back to back on the same operands until the time is up, at least
+      // one product
+      do {
+        auto product_start = std::chrono::steady_clock::now();
+        engine.run(method, a, b, result);
+        const double ms = elapsed_ms(product_start);
+        point.best_ms = point.products == 0 ? ms : std::min(point.best_ms, ms);
+        point.worst_ms = std::max(point.worst_ms, ms);
+        ++point.products;
+      } while (elapsed_ms(start) < _config.throughput_seconds * 1000.0);
+      point.seconds = elapsed_ms(start) / 1000.0;
+    } catch (const std::exception &e) {
+      std::cout << "  " << GF2Engine::methodName(method) << ": " << e.what()
+                << "\n";
+      continue;
+    }
+    point.gops = gops(size, size, size, point.seconds * 1000.0) *
+                 double(point.products);
+    _throughput.push_back(point);
+
+    std::cout << "  " << GF2Engine::methodName(method) << ": "
+              << point.products << " products in " << point.seconds
+              << " s, " << point.gops << " GOps/s (best " << point.best_ms
+              << " ms, worst " << point.worst_ms << " ms)\n";
+  }
+}
+
+void BenchmarkSuite::runAccuracyBenchmark() {
+  std::cout << "=== Accuracy benchmark ===\n";
+  GF2Engine &engine = engineFor(0);
+  const std::vector<GF2Engine::Method> methods = engine.availableMethods();
+
+  for (const auto &[m, k, n] : _config.accuracy_shapes) {
+    GF2Matrix a = GF2TestFramework::generateRandomMatrix(m, k);
+    GF2Matrix b = GF2TestFramework::generateRandomMatrix(k, n);
+    const GF2Matrix reference = a.multiplySerial(b);
+
+    for (GF2Engine::Method method : methods) {
+      AccuracyPoint point{method, m, k, n, false, ""};
+      try {
+        GF2Matrix result(m, n);
+        engine.run(method, a, b, result);
+        point.correct = result == reference;
+      } catch (const std::exception &e) {
+        point.error = e.what();
+      }
+      _accuracy.push_back(point);
+
+      if (!point.correct) {
+        std::cout << "  " << GF2Engine::methodName(method) << " " << m << "x"
+                  << k << " * " << k << "x" << n << ": "
+                  << (point.error.empty() ? "WRONG RESULT" : point.error)
+                  << "\n";
+      }
+    }
+  }
+
+  const size_t failures =
+      std::count_if(_accuracy.begin(), _accuracy.end(),
+                    [](const AccuracyPoint &p) { return !p.correct; });
+  std::cout << "  " << _accuracy.size() - failures << "/" << _accuracy.size()
+            << " products match the serial reference\n";
+}
+
+void BenchmarkSuite::generateReport() {
+  std::ofstream out(_config.report_path);
+  if (!out.is_open()) {
+    std::cerr << "Failed to open file: " << _config.report_path << std::endl;
+    return;
+  }
+
+  out << "# GF(2) benchmark report\n\n";
+  out << "Machine: " << engineFor(0).machineKey() << "\n\n";
+
+  if (!_scaling.empty()) {
+    out << "## Scaling\n\n";
+    out << "Median of " << std::max(_config.repetitions, 1)
+        << " runs after one warm-up.\n\n";
+    out << "| Method | Size | Threads | ms | GOps/s |\n";
+    out << "|---|---:|---:|---:|---:|\n";
+    for (const ScalingPoint &p : _scaling) {
+      out << "| " << GF2Engine::methodName(p.method) << " | " << p.size
+          << " | " << (p.threads > 0 ? std::to_string(p.threads) : "-")
+          << " | " << std::fixed << std::setprecision(3) << p.median_ms
+          << " | " << std::setprecision(2) << p.gops << " |\n";
+    }
+    out << std::defaultfloat << "\n";
+  }
+
+  if (!_throughput.empty()) {
+    out << "## Throughput\n\n";
+    out << "Back-to-back " << _config.throughput_size << "x"
+        << _config.throughput_size << " products for "
+        << _config.throughput_seconds << " s per method.\n\n";
+    out << "| Method | Products | s | GOps/s | Best ms | Worst ms |\n";
+    out << "|---|---:|---:|---:|---:|---:|\n";
+    for (const ThroughputPoint &p : _throughput) {
+      out << "| " << GF2Engine::methodName(p.method) << " | " << p.products
+          << " | " << std::fixed << std::setprecision(3) << p.seconds << " | "
+          << std::setprecision(2) << p.gops << " | " << std::setprecision(3)
+          << p.best_ms << " | " << p.worst_ms << " |\n";
+    }
+    out << std::defaultfloat << "\n";
+  }
+
+  if (!_accuracy.empty()) {
+    out << "## Accuracy\n\n";
+    out << "Every method against multiplySerial.\n\n";
+    out << "| Method | m x k x n | Result |\n";
+    out << "|---|---|---|\n";
+    for (const AccuracyPoint &p : _accuracy) {
+      out << "| " << GF2Engine::methodName(p.method) << " | " << p.m << " x "
+          << p.k << " x " << p.n << " | "
+          << (p.correct ? "ok" : p.error.empty() ? "WRONG" : p.error)
+          << " |\n";
+    }
+    out << "\n";
+  }
+
+  std::cout << "Report saved to: " << _config.report_path << std::endl;
+}
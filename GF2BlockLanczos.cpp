@@ -0,0 +1,395 @@
+#include "GF2SparseMatrix.hpp"
+#include "GF2Kernels.hpp"
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Montgomery's block Lanczos ("A Block Lanczos Algorithm for Finding
+// Dependencies over GF(2)", Eurocrypt 1995) on the symmetric A = B^T * B,
+// with the three-term recurrence written as in msieve. The iterates are
+// n x 64 blocks, one word per row; A is applied as B and then B^T, both
+// sparse, and the 64 x 64 coefficients come from block_transpose_mul_64
+// and block_mul_64. Starting from a random X, the iteration solves
+// A * X' = A * X, so X + X' and the last iterate V span vectors of the
+// nullspace of A; those B also annihilates are picked out at the end.
+
+namespace {
+
+// Up to this many columns the nullspace is found by dense elimination
+constexpr size_t DENSE_NULLSPACE_COLS = 1024;
+
+// Random starts tried before giving up
+constexpr int LANCZOS_ATTEMPTS = 4;
+
+// Further starts whose vectors are merged into a result of fewer than
+// NULLSPACE_VECTORS while the nullspace may hold more
+constexpr int NULLSPACE_MERGES = 4;
+
+// At most this many vectors are returned (one block's worth)
+constexpr size_t NULLSPACE_VECTORS = 64;
+
+using Block = std::vector<uint64_t>;      // n x 64
+using Square = std::array<uint64_t, 64>;  // 64 x 64, row i in word i
+using Columns = std::array<size_t, 64>;
+
+inline uint64_t unit(size_t i) {
+    return uint64_t(1) << i;
+}
+
+Square mul(const Square& a, const Square& b) {
+    Square c;
+    block_mul_64(a.data(), b.data(), 64, c.data(), false);
+    return c;
+}
+
+// Chooses the columns S of t = V^T A V with an invertible S^T t S, taking
+// first the columns the previous step left out, and returns
+// winv = S (S^T t S)^-1 S^T. Gauss-Jordan on [t | I], falling back to the
+// identity half for a column without a pivot. 0 columns on a breakdown.
+size_t select_columns(const Square& t, Columns& s, const Columns& last_s, size_t last_dim,
+                      Square& winv) {
+    uint64_t m[64][2];
+    for (size_t i = 0; i < 64; ++i) {
+        m[i][0] = t[i];
+        m[i][1] = unit(i);
+    }
+    uint64_t last = 0;
+    for (size_t i = 0; i < last_dim; ++i) {
+        last |= unit(last_s[i]);
+        s[64 - last_dim + i] = last_s[i];
+    }
+    for (size_t i = 0, j = 0; i < 64; ++i) {
+        if (!(last & unit(i))) {
+            s[j++] = i;
+        }
+    }
+
+    size_t dim = 0;
+    for (size_t i = 0; i < 64; ++i) {
+        const uint64_t mask = unit(s[i]);
+        uint64_t* row_i = m[s[i]];
+        size_t half = 0;
+        size_t j = i;
+        for (; half < 2; ++half) {
+            for (j = i; j < 64 && !(m[s[j]][half] & mask); ++j) {
+            }
+            if (j < 64) {
+                break;
+            }
+        }
+        if (half == 2) {
+            return 0; // the submatrix cannot be completed
+        }
+        std::swap(row_i[0], m[s[j]][0]);
+        std::swap(row_i[1], m[s[j]][1]);
+        for (size_t k = 0; k < 64; ++k) {
+            uint64_t* row_k = m[s[k]];
+            if (row_k != row_i && (row_k[half] & mask)) {
+                row_k[0] ^= row_i[0];
+                row_k[1] ^= row_i[1];
+            }
+        }
+        if (half == 0) {
+            s[dim++] = s[i];
+        } else {
+            row_i[0] = row_i[1] = 0;
+        }
+    }
+    for (size_t i = 0; i < 64; ++i) {
+        winv[i] = m[i][1];
+    }
+
+    // The recurrence needs every column in this S or the previous one
+    uint64_t used = 0;
+    for (size_t i = 0; i < dim; ++i) {
+        used |= unit(s[i]);
+    }
+    for (size_t i = 0; i < last_dim; ++i) {
+        used |= unit(last_s[i]);
+    }
+    return used == ~uint64_t(0) ? dim : 0;
+}
+
+// One run from a random start; false if it broke down. On success x and v
+// are the two blocks the nullspace vectors are combined from.
+bool lanczos(const GF2SparseMatrix& b, const GF2SparseMatrix& b_t, uint64_t seed,
+             int threads, Block& x, Block& v) {
+    const size_t n = b.cols();
+    Block v0(n), v1(n, 0), v2(n, 0), next(n), rhs(n), scratch(b.rows());
+    auto apply = [&](const Block& in, Block& out) {
+        b.multiplyBlock(in.data(), scratch.data(), threads);
+        b_t.multiplyBlock(scratch.data(), out.data(), threads);
+    };
+
+    x.assign(n, 0);
+    std::mt19937_64 gen(seed);
+    std::generate(x.begin(), x.end(), std::ref(gen));
+    apply(x, v0);
+    rhs = v0;
+
+    Square winv1{}, winv2{}, vav1{}, va2v1{};
+    Columns s0{}, s1{};
+    std::iota(s1.begin(), s1.end(), size_t(0));
+    size_t dim1 = 64;
+    uint64_t mask1 = ~uint64_t(0);
+
+    // Each step spans about 63 new dimensions
+    const size_t max_steps = n / 60 + 100;
+    for (size_t step = 0;; ++step) {
+        if (step > max_steps) {
+            return false;
+        }
+        apply(v0, next);
+        Square vav, va2v;
+        block_transpose_mul_64(v0.data(), next.data(), n, vav.data());
+        block_transpose_mul_64(next.data(), next.data(), n, va2v.data());
+        if (std::all_of(vav.begin(), vav.end(), [](uint64_t w) { return w == 0; })) {
+            break;
+        }
+
+        Square winv0;
+        const size_t dim0 = select_columns(vav, s0, s1, dim1, winv0);
+        if (dim0 == 0) {
+            return false;
+        }
+        uint64_t mask0 = 0;
+        for (size_t i = 0; i < dim0; ++i) {
+            mask0 |= unit(s0[i]);
+        }
+
+        // next = A V0 S0 S0^T + V0 D + V1 E + V2 F
+        Square d, e, f, f2;
+        for (size_t i = 0; i < 64; ++i) {
+            d[i] = (va2v[i] & mask0) ^ vav[i];
+        }
+        d = mul(winv0, d);
+        for (size_t i = 0; i < 64; ++i) {
+            d[i] ^= unit(i);
+        }
+        e = mul(winv1, vav);
+        for (size_t i = 0; i < 64; ++i) {
+            e[i] &= mask0;
+        }
+        f = mul(vav1, winv1);
+        for (size_t i = 0; i < 64; ++i) {
+            f[i] ^= unit(i);
+        }
+        f = mul(winv2, f);
+        for (size_t i = 0; i < 64; ++i) {
+            f2[i] = ((va2v1[i] & mask1) ^ vav1[i]) & mask0;
+        }
+        f = mul(f, f2);
+
+        for (uint64_t& w : next) {
+            w &= mask0;
+        }
+        block_mul_64(v0.data(), d.data(), n, next.data(), true);
+        block_mul_64(v1.data(), e.data(), n, next.data(), true);
+        block_mul_64(v2.data(), f.data(), n, next.data(), true);
+
+        // x += V0 Winv0 V0^T rhs
+        Square t;
+        block_transpose_mul_64(v0.data(), rhs.data(), n, t.data());
+        t = mul(winv0, t);
+        block_mul_64(v0.data(), t.data(), n, x.data(), true);
+
+        std::swap(v2, v1);
+        std::swap(v1, v0);
+        std::swap(v0, next);
+        winv2 = winv1;
+        winv1 = winv0;
+        vav1 = vav;
+        va2v1 = va2v;
+        s1 = s0;
+        mask1 = mask0;
+        dim1 = dim0;
+    }
+    v = std::move(v0);
+    return true;
+}
+
+// The first 'count' rows of m
+GF2Matrix top_rows(const GF2Matrix& m, size_t count) {
+    GF2Matrix out(count, m.cols());
+    for (size_t i = 0; i < count; ++i) {
+        std::copy_n(m.get_raw_data() + i * m.row_stride(), m.words_per_row(),
+                    out.get_raw_data() + i * out.row_stride());
+    }
+    return out;
+}
+
+// Number of nonzero rows of an echelon form (they come first)
+size_t echelon_rank(const GF2Matrix& echelon) {
+    size_t r = 0;
+    while (r < echelon.rows()) {
+        const uint64_t* row = echelon.get_raw_data() + r * echelon.row_stride();
+        if (std::all_of(row, row + echelon.words_per_row(), [](uint64_t w) { return w == 0; })) {
+            break;
+        }
+        ++r;
+    }
+    return r;
+}
+
+// Independent nonzero rows of candidates, at most NULLSPACE_VECTORS
+GF2Matrix independent_rows(const GF2Matrix& candidates, int threads) {
+    const GF2Matrix echelon = candidates.echelonForm(true, threads);
+    return top_rows(echelon, std::min(echelon_rank(echelon), NULLSPACE_VECTORS));
+}
+
+// The rows of a, then those of b (of as many columns)
+GF2Matrix stack_rows(const GF2Matrix& a, const GF2Matrix& b) {
+    GF2Matrix out(a.rows() + b.rows(), a.cols());
+    for (size_t i = 0; i < out.rows(); ++i) {
+        const GF2Matrix& src = i < a.rows() ? a : b;
+        const size_t r = i < a.rows() ? i : i - a.rows();
+        std::copy_n(src.get_raw_data() + r * src.row_stride(), src.words_per_row(),
+                    out.get_raw_data() + i * out.row_stride());
+    }
+    return out;
+}
+
+// The combinations c of the 128 columns of Z = [x | v] with B Z c = 0,
+// read off the rows of the echelon form of [(B Z)^T | I] that vanish on
+// the left, and then the vectors Z c
+GF2Matrix combine(const GF2SparseMatrix& b, const Block& x, const Block& v, int threads) {
+    const size_t m = b.rows(), n = b.cols();
+    Block bz(m);
+    GF2Matrix augmented(128, m + 128);
+    b.multiplyBlock(x.data(), bz.data(), threads);
+    transpose_matrix(bz.data(), 1, augmented.get_raw_data(), augmented.row_stride(), m, 64);
+    b.multiplyBlock(v.data(), bz.data(), threads);
+    transpose_matrix(bz.data(), 1, augmented.get_raw_data() + 64 * augmented.row_stride(),
+                     augmented.row_stride(), m, 64);
+    for (size_t i = 0; i < 128; ++i) {
+        augmented.set(i, m + i, true);
+    }
+    const GF2Matrix echelon = augmented.echelonForm(false, threads);
+
+    std::vector<std::pair<uint64_t, uint64_t>> combinations;
+    for (size_t i = 0; i < echelon.rows(); ++i) {
+        bool left_zero = true;
+        for (size_t c = 0; c < m && left_zero; c += 64) {
+            left_zero = (echelon.get_raw_data()[i * echelon.row_stride() + c / 64] &
+                         (m - c >= 64 ? ~uint64_t(0) : unit(m - c) - 1)) == 0;
+        }
+        if (!left_zero) {
+            continue;
+        }
+        std::pair<uint64_t, uint64_t> c{0, 0};
+        for (size_t j = 0; j < 64; ++j) {
+            c.first |= uint64_t(echelon.get(i, m + j)) << j;
+            c.second |= uint64_t(echelon.get(i, m + 64 + j)) << j;
+        }
+        if (c.first || c.second) {
+            combinations.push_back(c);
+        }
+    }
+
+    // Z c for 64 combinations at a time, one vector per row
+    GF2Matrix candidates(combinations.size(), n);
+    Block w(n);
+    for (size_t c0 = 0; c0 < combinations.size(); c0 += 64) {
+        const size_t count = std::min<size_t>(64, combinations.size() - c0);
+        Square dx{}, dv{};
+        for (size_t t = 0; t < count; ++t) {
+            for (size_t j = 0; j < 64; ++j) {
+                dx[j] |= ((combinations[c0 + t].first >> j) & 1) << t;
+                dv[j] |= ((combinations[c0 + t].second >> j) & 1) << t;
+            }
+        }
+        block_mul_64(x.data(), dx.data(), n, w.data(), false);
+        block_mul_64(v.data(), dv.data(), n, w.data(), true);
+        transpose_matrix(w.data(), 1, candidates.get_raw_data() + c0 * candidates.row_stride(),
+                         candidates.row_stride(), n, count);
+    }
+    return independent_rows(candidates, threads);
+}
+
+} // namespace
+
+// Narrow matrices: the rows are reduced 'cols' at a time into a reduced
+// echelon basis of at most cols rows, whose free columns give the nullspace
+GF2Matrix GF2SparseMatrix::nullspace(uint64_t seed, int num_threads) const {
+    if (m_cols > DENSE_NULLSPACE_COLS) {
+        const GF2SparseMatrix b_t = transpose();
+        // On very sparse matrices one start can come back with fewer than
+        // 64 independent vectors although the nullspace is larger. Such a
+        // result is merged with those of further starts; it is kept short
+        // once a start adds nothing and the nullity need not be larger
+        // than what was found (it is at least cols() - rows()).
+        const size_t nullity_bound = m_cols > m_rows ? m_cols - m_rows : 0;
+        Block x, v;
+        GF2Matrix found(0, m_cols);
+        int failures = 0, merges = 0;
+        for (uint64_t start = seed; failures < LANCZOS_ATTEMPTS; ++start) {
+            if (!lanczos(*this, b_t, start, num_threads, x, v)) {
+                ++failures;
+                continue;
+            }
+            const size_t before = found.rows();
+            found = before == 0 ? combine(*this, x, v, num_threads)
+                                : independent_rows(stack_rows(found, combine(*this, x, v,
+                                                                            num_threads)),
+                                                   num_threads);
+            if (found.rows() >= NULLSPACE_VECTORS || merges++ == NULLSPACE_MERGES ||
+                (found.rows() == before && found.rows() >= nullity_bound)) {
+                return found;
+            }
+        }
+        if (found.rows() > 0) {
+            return found;
+        }
+        throw std::runtime_error("Block Lanczos broke down on every start");
+    }
+
+    GF2Matrix basis(0, m_cols);
+    size_t rank = 0;
+    for (size_t i0 = 0; i0 < m_rows; i0 += std::max<size_t>(m_cols, 1)) {
+        const size_t chunk = std::min(std::max<size_t>(m_cols, 1), m_rows - i0);
+        GF2Matrix stack(rank + chunk, m_cols);
+        for (size_t i = 0; i < rank; ++i) {
+            std::copy_n(basis.get_raw_data() + i * basis.row_stride(), basis.words_per_row(),
+                        stack.get_raw_data() + i * stack.row_stride());
+        }
+        for (size_t i = 0; i < chunk; ++i) {
+            xorRowInto(i0 + i, stack.get_raw_data() + (rank + i) * stack.row_stride());
+        }
+        const GF2Matrix echelon = stack.echelonForm(true, num_threads);
+        rank = echelon_rank(echelon);
+        basis = top_rows(echelon, rank);
+    }
+
+    std::vector<size_t> pivots;
+    for (size_t j = 0; j < rank; ++j) {
+        const uint64_t* row = basis.get_raw_data() + j * basis.row_stride();
+        size_t w = 0;
+        while (row[w] == 0) {
+            ++w;
+        }
+        pivots.push_back(w * 64 + size_t(__builtin_ctzll(row[w])));
+    }
+    std::vector<size_t> free_columns;
+    for (size_t c = 0, p = 0; c < m_cols && free_columns.size() < NULLSPACE_VECTORS; ++c) {
+        if (p < pivots.size() && pivots[p] == c) {
+            ++p;
+        } else {
+            free_columns.push_back(c);
+        }
+    }
+    GF2Matrix out(free_columns.size(), m_cols);
+    for (size_t k = 0; k < free_columns.size(); ++k) {
+        out.set(k, free_columns[k], true);
+        for (size_t j = 0; j < rank; ++j) {
+            if (basis.get(j, free_columns[k])) {
+                out.set(k, pivots[j], true);
+            }
+        }
+    }
+    return out;
+}
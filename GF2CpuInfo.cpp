@@ -0,0 +1,229 @@
+#include "GF2CpuInfo.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <cpuid.h>
+#endif
+
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#elif defined(__linux__)
+#include <unistd.h>
+#if defined(__aarch64__)
+#include <sys/auxv.h>
+#include <sys/prctl.h>
+#endif
+#endif
+
+namespace {
+
+#if defined(__APPLE__)
+size_t sysctl_size(const char* name) {
+    int64_t value = 0;
+    size_t len = sizeof(value);
+    if (sysctlbyname(name, &value, &len, nullptr, 0) != 0 || value <= 0) {
+        return 0;
+    }
+    return static_cast<size_t>(value);
+}
+#elif defined(__linux__)
+// Reads a sysfs cache size such as "48K" or "2048K"
+size_t sysfs_cache_size(int index) {
+    std::ifstream file("/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(index) + "/size");
+    size_t value = 0;
+    char unit = 0;
+    if (!(file >> value)) return 0;
+    if (file >> unit) {
+        if (unit == 'K') value *= 1024;
+        else if (unit == 'M') value *= 1024 * 1024;
+    }
+    return value;
+}
+
+std::string sysfs_cache_type(int index) {
+    std::ifstream file("/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(index) + "/type");
+    std::string type;
+    file >> type;
+    return type;
+}
+
+// Number of CPUs in a sysfs list such as "0-15,20"; 0 if it does not exist
+size_t sysfs_cpu_count(const std::string& path) {
+    std::ifstream file(path);
+    std::string list;
+    if (!std::getline(file, list)) return 0;
+    size_t count = 0;
+    std::stringstream ranges(list);
+    std::string range;
+    while (std::getline(ranges, range, ',')) {
+        int lo = 0, hi = 0;
+        const int n = std::sscanf(range.c_str(), "%d-%d", &lo, &hi);
+        if (n == 1) hi = lo;
+        if (n >= 1 && hi >= lo) count += size_t(hi - lo + 1);
+    }
+    return count;
+}
+
+void detect_core_types(GF2CpuInfo& info) {
+    info.performance_cores = sysfs_cpu_count("/sys/devices/cpu_core/cpus");
+    info.efficiency_cores = sysfs_cpu_count("/sys/devices/cpu_atom/cpus");
+    if (info.hybrid()) return;
+    info.performance_cores = info.efficiency_cores = 0;
+    std::vector<int> capacities;
+    for (int cpu = 0;; ++cpu) {
+        std::ifstream file("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cpu_capacity");
+        int capacity = 0;
+        if (!(file >> capacity)) break;
+        capacities.push_back(capacity);
+    }
+    if (capacities.empty()) return;
+    const int top = *std::max_element(capacities.begin(), capacities.end());
+    for (int capacity : capacities) {
+        ++(capacity == top ? info.performance_cores : info.efficiency_cores);
+    }
+    if (!info.hybrid()) info.performance_cores = info.efficiency_cores = 0;
+}
+
+int sysfs_cache_level(int index) {
+    std::ifstream file("/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(index) + "/level");
+    int level = 0;
+    file >> level;
+    return level;
+}
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+void detect_x86_features(GF2CpuInfo& info) {
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return;
+
+    // The OS must have enabled the YMM (and for AVX-512 the ZMM/opmask) state
+    const bool osxsave = ecx & bit_OSXSAVE;
+    uint64_t xcr0 = 0;
+    if (osxsave) {
+        unsigned lo, hi;
+        __asm__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        xcr0 = (static_cast<uint64_t>(hi) << 32) | lo;
+    }
+    const bool ymm_enabled = (xcr0 & 0x6) == 0x6;
+    const bool zmm_enabled = (xcr0 & 0xE6) == 0xE6;
+    const bool avx = (ecx & bit_AVX) && ymm_enabled;
+    info.pclmul = (ecx & bit_PCLMUL) != 0;
+
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return;
+
+    info.avx2 = avx && (ebx & bit_AVX2);
+    info.avx512f = zmm_enabled && (ebx & bit_AVX512F);
+    info.avx512bw = info.avx512f && (ebx & bit_AVX512BW);
+    info.avx512vpopcntdq = info.avx512f && (ecx & bit_AVX512VPOPCNTDQ);
+    info.gfni = (ecx & bit_GFNI) != 0;
+    info.vpclmulqdq = info.avx512f && (ecx & bit_VPCLMULQDQ);
+}
+#endif
+
+#if defined(__aarch64__)
+void detect_arm_features(GF2CpuInfo& info) {
+    info.neon = true;
+
+#if defined(__APPLE__)
+    info.sha3 = sysctl_size("hw.optional.arm.FEAT_SHA3") != 0;
+    info.pmull = sysctl_size("hw.optional.arm.FEAT_PMULL") != 0;
+#elif defined(__linux__)
+    // Bit values from <asm/hwcap.h>
+    const unsigned long hwcap_pmull = 1UL << 4;
+    const unsigned long hwcap_sha3 = 1UL << 17;
+    const unsigned long hwcap2_sve2 = 1UL << 1;
+    info.sha3 = (getauxval(AT_HWCAP) & hwcap_sha3) != 0;
+    info.pmull = (getauxval(AT_HWCAP) & hwcap_pmull) != 0;
+    info.sve2 = (getauxval(AT_HWCAP2) & hwcap2_sve2) != 0;
+#if defined(PR_SVE_GET_VL)
+    if (info.sve2) {
+        int vl = prctl(PR_SVE_GET_VL);
+        if (vl > 0) info.sve_vector_bytes = static_cast<size_t>(vl & PR_SVE_VL_LEN_MASK);
+    }
+#endif
+#endif
+}
+#endif
+
+GF2CpuInfo detect() {
+    GF2CpuInfo info;
+
+#if defined(__x86_64__) || defined(_M_X64)
+    detect_x86_features(info);
+#elif defined(__aarch64__)
+    detect_arm_features(info);
+#endif
+
+#if defined(__APPLE__)
+    // Apple silicon reports the performance cluster caches under hw.perflevel0
+    size_t l1 = sysctl_size("hw.perflevel0.l1dcachesize");
+    size_t l2 = sysctl_size("hw.perflevel0.l2cachesize");
+    if (!l1) l1 = sysctl_size("hw.l1dcachesize");
+    if (!l2) l2 = sysctl_size("hw.l2cachesize");
+    size_t l3 = sysctl_size("hw.l3cachesize");
+    size_t line = sysctl_size("hw.cachelinesize");
+    if (l1) info.l1d_bytes = l1;
+    if (l2) info.l2_bytes = l2;
+    if (l3) info.l3_bytes = l3;
+    if (line) info.cache_line_bytes = line;
+    if (sysctl_size("hw.nperflevels") >= 2) {
+        info.performance_cores = sysctl_size("hw.perflevel0.logicalcpu");
+        info.efficiency_cores = sysctl_size("hw.perflevel1.logicalcpu");
+        if (!info.hybrid()) info.performance_cores = info.efficiency_cores = 0;
+    }
+#elif defined(__linux__)
+    detect_core_types(info);
+    for (int index = 0; index < 8; ++index) {
+        int level = sysfs_cache_level(index);
+        if (level == 0) break;
+        std::string type = sysfs_cache_type(index);
+        size_t size = sysfs_cache_size(index);
+        if (!size || type == "Instruction") continue;
+        if (level == 1) info.l1d_bytes = size;
+        else if (level == 2) info.l2_bytes = size;
+        else if (level == 3) info.l3_bytes = size;
+    }
+#ifdef _SC_LEVEL1_DCACHE_LINESIZE
+    long line = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+    if (line > 0) info.cache_line_bytes = static_cast<size_t>(line);
+#endif
+#endif
+
+    return info;
+}
+
+} // namespace
+
+const GF2CpuInfo& GF2CpuInfo::get() {
+    static const GF2CpuInfo info = detect();
+    return info;
+}
+
+std::string GF2CpuInfo::describe() const {
+    std::ostringstream out;
+    out << "L1d " << l1d_bytes / 1024 << " KiB, L2 " << l2_bytes / 1024
+        << " KiB, L3 " << l3_bytes / 1024 << " KiB, line " << cache_line_bytes << " B";
+
+    std::string isa;
+    if (avx2) isa += " avx2";
+    if (avx512f) isa += " avx512f";
+    if (avx512bw) isa += " avx512bw";
+    if (avx512vpopcntdq) isa += " avx512vpopcntdq";
+    if (gfni) isa += " gfni";
+    if (pclmul) isa += " pclmul";
+    if (vpclmulqdq) isa += " vpclmulqdq";
+    if (neon) isa += " neon";
+    if (sha3) isa += " sha3";
+    if (pmull) isa += " pmull";
+    if (sve2) isa += " sve2/" + std::to_string(sve_vector_bytes * 8);
+    out << "; ISA:" << (isa.empty() ? " baseline" : isa);
+    if (hybrid()) {
+        out << "; cores " << performance_cores << "P+" << efficiency_cores << "E";
+    }
+    return out.str();
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <cstdint>
+
+// Host CPU properties used to size and select the CPU kernels.
+struct GF2CpuInfo {
+    // Data cache sizes in bytes (per core for L1/L2)
+    size_t l1d_bytes = 32 * 1024;
+    size_t l2_bytes = 256 * 1024;
+    size_t l3_bytes = 8 * 1024 * 1024;
+    size_t cache_line_bytes = 64;
+
+    // Instruction set extensions usable by this process (x86: CPUID plus the
+    // OS-enabled XSAVE state; false when not on x86)
+    bool avx2 = false;
+    bool avx512f = false;
+    bool avx512bw = false;
+    bool avx512vpopcntdq = false;
+    bool gfni = false;
+    bool pclmul = false;
+    bool vpclmulqdq = false;
+
+    // NEON is part of the AArch64 baseline. SHA3 (EOR3/BCAX), PMULL (the
+    // 64-bit carry-less multiply) and SVE2 come from HWCAP on Linux and from
+    // hw.optional sysctls on macOS.
+    bool neon = false;
+    bool sha3 = false;
+    bool pmull = false;
+    bool sve2 = false;
+    size_t sve_vector_bytes = 0;
+
+    // Logical CPUs of each core type on hybrid parts, both 0 when all cores
+    // are alike: Apple silicon's P and E clusters (hw.perflevel0/1 sysctls),
+    // and on Linux Intel's P and E cores (the cpu_core and cpu_atom PMUs) or
+    // an Arm big.LITTLE split (cpu_capacity below the maximum is E)
+    size_t performance_cores = 0;
+    size_t efficiency_cores = 0;
+    bool hybrid() const { return performance_cores > 0 && efficiency_cores > 0; }
+
+    // Detected once on first use
+    static const GF2CpuInfo& get();
+
+    std::string describe() const;
+};
@@ -0,0 +1,426 @@
+#include "GF2Distributed.hpp"
+#include "GF2Engine.hpp"
+#include "GF2MatrixView.hpp"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// dst = src, whole words per row; the bits of src's last word past its
+// columns are dropped
+void copy_view(const GF2MatrixView& src, const GF2MutableMatrixView& dst) {
+    GF2Matrix storage(0, 0);
+    const GF2MatrixView s = src.aligned(storage);
+    const size_t words = s.words_per_row();
+    const uint64_t tail_mask = (s.cols() % 64) ? ((1ULL << (s.cols() % 64)) - 1) : ~0ULL;
+    for (size_t i = 0; i < s.rows() && words > 0; ++i) {
+        uint64_t* out = dst.get_raw_data() + i * dst.row_stride();
+        std::memcpy(out, s.get_raw_data() + i * s.row_stride(), words * sizeof(uint64_t));
+        out[words - 1] &= tail_mask;
+    }
+}
+
+// 'words' words of the rows [row0, row0 + rows) of src, from word word0, to
+// the first rows of dst
+void copy_rows(const GF2Matrix& src, size_t row0, size_t word0, size_t rows, size_t words,
+               GF2Matrix& dst) {
+    for (size_t i = 0; i < rows && words > 0; ++i) {
+        std::memcpy(dst.get_raw_data() + i * dst.row_stride(),
+                    src.get_raw_data() + (row0 + i) * src.row_stride() + word0,
+                    words * sizeof(uint64_t));
+    }
+}
+
+// Columns of A (rows of B) held by grid column (row) 'owner' of 'count'
+size_t owned_k(const GF2SummaLayout& layout, int owner, int count) {
+    size_t total = 0;
+    for (size_t p = size_t(owner); p < layout.panels(); p += size_t(count)) {
+        total += layout.panelWidth(p);
+    }
+    return total;
+}
+
+} // namespace
+
+// A broadcast of the in-process transport is a slot keyed by its group and
+// its number among the group's broadcasts. The root publishes its buffer
+// there; each receiver copies it when it waits, and the root's wait returns
+// once all of them have.
+struct GF2LocalTransport::Hub {
+    struct Slot {
+        const uint64_t* words = nullptr; // null for an empty matrix's buffer
+        bool published = false;
+        size_t n = 0;
+        size_t copied = 0;
+    };
+    using Key = std::pair<std::vector<int>, uint64_t>;
+
+    int ranks = 0;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::map<Key, Slot> slots;
+
+    class RootRequest : public GF2Transport::Request {
+    public:
+        RootRequest(Hub& hub, Key key, size_t receivers)
+            : m_hub(hub), m_key(std::move(key)), m_receivers(receivers) {}
+        void wait() override {
+            std::unique_lock<std::mutex> lock(m_hub.mutex);
+            auto slot = m_hub.slots.find(m_key);
+            m_hub.cv.wait(lock, [&] { return slot->second.copied == m_receivers; });
+            m_hub.slots.erase(slot);
+        }
+
+    private:
+        Hub& m_hub;
+        Key m_key;
+        size_t m_receivers;
+    };
+
+    class ReceiveRequest : public GF2Transport::Request {
+    public:
+        ReceiveRequest(Hub& hub, Key key, uint64_t* words, size_t n)
+            : m_hub(hub), m_key(std::move(key)), m_words(words), m_n(n) {}
+        // The slot stays until the root's wait, which needs this copy
+        void wait() override {
+            std::unique_lock<std::mutex> lock(m_hub.mutex);
+            Slot& slot = m_hub.slots[m_key];
+            m_hub.cv.wait(lock, [&] { return slot.published; });
+            const bool match = slot.n == m_n;
+            lock.unlock();
+            if (match && m_n > 0) {
+                std::memcpy(m_words, slot.words, m_n * sizeof(uint64_t));
+            }
+            lock.lock();
+            ++slot.copied;
+            m_hub.cv.notify_all();
+            if (!match) {
+                throw std::runtime_error("Broadcast sizes differ between root and receiver");
+            }
+        }
+
+    private:
+        Hub& m_hub;
+        Key m_key;
+        uint64_t* m_words;
+        size_t m_n;
+    };
+};
+
+std::vector<std::unique_ptr<GF2LocalTransport>> GF2LocalTransport::create(int ranks) {
+    if (ranks <= 0) {
+        throw std::runtime_error("A transport needs at least one rank");
+    }
+    auto hub = std::make_shared<Hub>();
+    hub->ranks = ranks;
+    std::vector<std::unique_ptr<GF2LocalTransport>> transports;
+    for (int r = 0; r < ranks; ++r) {
+        transports.push_back(std::unique_ptr<GF2LocalTransport>(new GF2LocalTransport(hub, r)));
+    }
+    return transports;
+}
+
+int GF2LocalTransport::size() const {
+    return m_hub->ranks;
+}
+
+std::unique_ptr<GF2Transport::Request> GF2LocalTransport::broadcast(uint64_t* words, size_t n,
+                                                                    const std::vector<int>& group,
+                                                                    int root) {
+    Hub::Key key(group, m_sequence[group]++);
+    if (m_rank != root) {
+        return std::make_unique<Hub::ReceiveRequest>(*m_hub, std::move(key), words, n);
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_hub->mutex);
+        Hub::Slot& slot = m_hub->slots[key];
+        slot.words = words;
+        slot.published = true;
+        slot.n = n;
+    }
+    m_hub->cv.notify_all();
+    return std::make_unique<Hub::RootRequest>(*m_hub, std::move(key), group.size() - 1);
+}
+
+#ifdef GF2_HAVE_MPI
+
+namespace {
+
+class MPIRequest : public GF2Transport::Request {
+public:
+    MPI_Request request = MPI_REQUEST_NULL;
+    void wait() override {
+        if (MPI_Wait(&request, MPI_STATUS_IGNORE) != MPI_SUCCESS) {
+            throw std::runtime_error("MPI_Wait failed");
+        }
+    }
+};
+
+} // namespace
+
+GF2MPITransport::GF2MPITransport(MPI_Comm comm) : m_comm(comm) {
+    MPI_Comm_rank(m_comm, &m_rank);
+    MPI_Comm_size(m_comm, &m_size);
+}
+
+GF2MPITransport::~GF2MPITransport() {
+    int finalized = 0;
+    MPI_Finalized(&finalized);
+    if (finalized) {
+        return;
+    }
+    for (auto& entry : m_groups) {
+        MPI_Comm_free(&entry.second);
+    }
+}
+
+std::unique_ptr<GF2Transport::Request> GF2MPITransport::broadcast(uint64_t* words, size_t n,
+                                                                  const std::vector<int>& group,
+                                                                  int root) {
+    if (n > size_t(INT_MAX)) {
+        throw std::runtime_error("Broadcast of " + std::to_string(n) +
+                                 " words exceeds an MPI count");
+    }
+    auto found = m_groups.find(group);
+    if (found == m_groups.end()) {
+        // Collective over the group only; its ranks reach their first
+        // broadcast on it in the same order
+        MPI_Group all, members;
+        MPI_Comm comm = MPI_COMM_NULL;
+        MPI_Comm_group(m_comm, &all);
+        MPI_Group_incl(all, int(group.size()), group.data(), &members);
+        const int status = MPI_Comm_create_group(m_comm, members, 0, &comm);
+        MPI_Group_free(&members);
+        MPI_Group_free(&all);
+        if (status != MPI_SUCCESS) {
+            throw std::runtime_error("MPI_Comm_create_group failed");
+        }
+        found = m_groups.emplace(group, comm).first;
+    }
+    const int root_index = int(std::find(group.begin(), group.end(), root) - group.begin());
+    auto request = std::make_unique<MPIRequest>();
+    if (MPI_Ibcast(words, int(n), MPI_UINT64_T, root_index, found->second, &request->request) !=
+        MPI_SUCCESS) {
+        throw std::runtime_error("MPI_Ibcast failed");
+    }
+    return request;
+}
+
+#endif
+
+GF2SummaLayout::GF2SummaLayout(size_t m_, size_t k_, size_t n_, int ranks, size_t panel_cols_,
+                               int grid_rows_)
+    : m(m_), k(k_), n(n_) {
+    if (ranks <= 0) {
+        throw std::runtime_error("A SUMMA grid needs at least one rank");
+    }
+    if (grid_rows_ <= 0) {
+        grid_rows_ = 1;
+        for (int r = 1; r * r <= ranks; ++r) {
+            if (ranks % r == 0) grid_rows_ = r;
+        }
+    }
+    if (ranks % grid_rows_ != 0) {
+        throw std::runtime_error(std::to_string(grid_rows_) + " grid rows do not divide " +
+                                 std::to_string(ranks) + " ranks");
+    }
+    grid_rows = grid_rows_;
+    grid_cols = ranks / grid_rows_;
+    panel_cols = std::max<size_t>(64, (panel_cols_ + 63) / 64 * 64);
+}
+
+size_t GF2SummaLayout::rowBegin(int i) const {
+    const size_t chunk = (m + size_t(grid_rows) - 1) / size_t(grid_rows);
+    return std::min(m, size_t(i) * chunk);
+}
+
+size_t GF2SummaLayout::colBegin(int j) const {
+    const size_t words = (n + 63) / 64;
+    const size_t chunk = (words + size_t(grid_cols) - 1) / size_t(grid_cols) * 64;
+    return std::min(n, size_t(j) * chunk);
+}
+
+size_t GF2SummaLayout::panelWidth(size_t p) const {
+    return std::min(k, (p + 1) * panel_cols) - p * panel_cols;
+}
+
+GF2Matrix GF2SummaLayout::localA(const GF2MatrixView& a, int rank) const {
+    if (a.rows() != m || a.cols() != k) {
+        throw std::runtime_error("A does not match the SUMMA layout");
+    }
+    const int i = rank / grid_cols, j = rank % grid_cols;
+    const size_t r0 = rowBegin(i), r1 = rowEnd(i);
+    GF2Matrix local(r1 - r0, owned_k(*this, j, grid_cols));
+    for (size_t p = size_t(j); p < panels(); p += size_t(grid_cols)) {
+        const size_t c0 = p * panel_cols, w = panelWidth(p);
+        const size_t offset = p / size_t(grid_cols) * panel_cols;
+        copy_view(a.view(r0, r1, c0, c0 + w), local.mutableView(0, r1 - r0, offset, offset + w));
+    }
+    return local;
+}
+
+GF2Matrix GF2SummaLayout::localB(const GF2MatrixView& b, int rank) const {
+    if (b.rows() != k || b.cols() != n) {
+        throw std::runtime_error("B does not match the SUMMA layout");
+    }
+    const int i = rank / grid_cols, j = rank % grid_cols;
+    const size_t c0 = colBegin(j), c1 = colEnd(j);
+    GF2Matrix local(owned_k(*this, i, grid_rows), c1 - c0);
+    for (size_t p = size_t(i); p < panels(); p += size_t(grid_rows)) {
+        const size_t r0 = p * panel_cols, w = panelWidth(p);
+        const size_t offset = p / size_t(grid_rows) * panel_cols;
+        copy_view(b.view(r0, r0 + w, c0, c1), local.mutableView(offset, offset + w, 0, c1 - c0));
+    }
+    return local;
+}
+
+void GF2SummaLayout::placeC(const GF2Matrix& c_local, int rank, GF2Matrix& c) const {
+    const int i = rank / grid_cols, j = rank % grid_cols;
+    const size_t r0 = rowBegin(i), r1 = rowEnd(i), c0 = colBegin(j), c1 = colEnd(j);
+    if (c.rows() != m || c.cols() != n || c_local.rows() != r1 - r0 || c_local.cols() != c1 - c0) {
+        throw std::runtime_error("C does not match the SUMMA layout");
+    }
+    // An empty block may start past the last column, off a word boundary
+    if (c_local.rows() == 0 || c_local.cols() == 0) {
+        return;
+    }
+    copy_view(c_local, c.mutableView(r0, r1, c0, c1));
+}
+
+// Panel p travels in buffer p % 2: while panel p is multiplied, the
+// broadcasts of p + 1 fill the other buffer. A wait takes the panels this
+// rank receives before the ones it sends, so no two ranks wait on each
+// other's sends: every receive needs only its root to have started the
+// broadcast, which it does before waiting on the previous panel.
+GF2Matrix gf2_summa_multiply(const GF2Matrix& a_local, const GF2Matrix& b_local,
+                             const GF2SummaLayout& layout, GF2Transport& transport,
+                             const GF2SummaConfig& config, GF2SummaStats* stats) {
+    const Clock::time_point start = Clock::now();
+    if (transport.size() != layout.ranks()) {
+        throw std::runtime_error("Transport has " + std::to_string(transport.size()) +
+                                 " ranks, the SUMMA grid " + std::to_string(layout.ranks()));
+    }
+    const int rank = transport.rank();
+    const int pr = layout.grid_rows, pc = layout.grid_cols;
+    const int gi = rank / pc, gj = rank % pc;
+    const size_t rows = layout.rowEnd(gi) - layout.rowBegin(gi);
+    const size_t cols = layout.colEnd(gj) - layout.colBegin(gj);
+    if (a_local.rows() != rows || a_local.cols() != owned_k(layout, gj, pc) ||
+        b_local.rows() != owned_k(layout, gi, pr) || b_local.cols() != cols) {
+        throw std::runtime_error("Local blocks do not match the SUMMA layout");
+    }
+
+    std::vector<int> row_group, col_group;
+    for (int j = 0; j < pc; ++j) row_group.push_back(gi * pc + j);
+    for (int i = 0; i < pr; ++i) col_group.push_back(i * pc + gj);
+
+    GF2SummaStats local_stats;
+    const size_t panels = layout.panels();
+    const size_t kb = std::min(layout.panel_cols, layout.k);
+    std::vector<GF2Matrix> a_buffers, b_buffers;
+    for (int t = 0; t < 2; ++t) {
+        a_buffers.emplace_back(rows, kb);
+        b_buffers.emplace_back(kb, cols);
+    }
+
+    struct InFlight {
+        std::unique_ptr<GF2Transport::Request> a, b;
+        bool a_root = false, b_root = false;
+    };
+    InFlight flight[2];
+
+    auto issue = [&](size_t p) {
+        InFlight& f = flight[p % 2];
+        GF2Matrix& a = a_buffers[p % 2];
+        GF2Matrix& b = b_buffers[p % 2];
+        const size_t w = layout.panelWidth(p);
+        const int a_root = gi * pc + int(p % size_t(pc));
+        const int b_root = int(p % size_t(pr)) * pc + gj;
+        f.a_root = rank == a_root;
+        f.b_root = rank == b_root;
+        if (f.a_root) {
+            const size_t word0 = p / size_t(pc) * layout.panel_cols / 64;
+            copy_rows(a_local, 0, word0, rows, (w + 63) / 64, a);
+        }
+        if (f.b_root) {
+            copy_rows(b_local, p / size_t(pr) * layout.panel_cols, 0, w, b.words_per_row(), b);
+        }
+        const size_t a_bytes = rows * a.row_stride() * sizeof(uint64_t);
+        const size_t b_bytes = w * b.row_stride() * sizeof(uint64_t);
+        f.a = transport.broadcast(a.get_raw_data(), rows * a.row_stride(), row_group, a_root);
+        f.b = transport.broadcast(b.get_raw_data(), w * b.row_stride(), col_group, b_root);
+        local_stats.bytes_sent += (f.a_root ? a_bytes * (row_group.size() - 1) : 0) +
+                                  (f.b_root ? b_bytes * (col_group.size() - 1) : 0);
+        local_stats.bytes_received += (f.a_root ? 0 : a_bytes) + (f.b_root ? 0 : b_bytes);
+    };
+
+    auto wait = [&](size_t p) {
+        InFlight& f = flight[p % 2];
+        const Clock::time_point t = Clock::now();
+        if (!f.a_root) f.a->wait();
+        if (!f.b_root) f.b->wait();
+        if (f.a_root) f.a->wait();
+        if (f.b_root) f.b->wait();
+        local_stats.stall_seconds += seconds_since(t);
+    };
+
+    GF2Matrix c(rows, cols);
+    GF2Workspace ws;
+    GF2Matrix a_narrow(0, 0), b_narrow(0, 0), product(0, 0);
+    auto compute = [&](size_t p) {
+        const size_t w = layout.panelWidth(p);
+        if (rows == 0 || cols == 0 || w == 0) {
+            return;
+        }
+        const GF2Matrix& a = a_buffers[p % 2];
+        const GF2Matrix& b = b_buffers[p % 2];
+        const Clock::time_point t = Clock::now();
+        if (config.engine) {
+            // The engine takes whole matrices: the last, narrower panel is
+            // copied out of its buffer
+            const GF2Matrix& a_panel = w == kb ? a : (a_narrow = a.view(0, rows, 0, w).copy());
+            const GF2Matrix& b_panel = w == kb ? b : (b_narrow = b.view(0, w, 0, cols).copy());
+            config.engine->multiply(a_panel, b_panel, product);
+            uint64_t* out = c.get_raw_data();
+            const uint64_t* in = product.get_raw_data();
+            const size_t words = rows * c.row_stride();
+            for (size_t x = 0; x < words; ++x) {
+                out[x] ^= in[x];
+            }
+        } else {
+            GF2Matrix::addMul(c.mutableView(0, rows, 0, cols), a.view(0, rows, 0, w),
+                              b.view(0, w, 0, cols), ws, config.num_threads);
+        }
+        local_stats.compute_seconds += seconds_since(t);
+    };
+
+    if (panels > 0) {
+        issue(0);
+    }
+    for (size_t p = 0; p < panels; ++p) {
+        if (p + 1 < panels) {
+            issue(p + 1);
+        }
+        wait(p);
+        compute(p);
+    }
+
+    local_stats.wall_seconds = seconds_since(start);
+    if (stats) {
+        *stats = local_stats;
+    }
+    return c;
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "GF2Matrix.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+#ifdef GF2_HAVE_MPI
+#include <mpi.h>
+#endif
+
+class GF2Engine;
+class GF2MatrixView;
+class GF2MutableMatrixView;
+
+// Moves the panels of a distributed multiply between its ranks. A transport
+// only needs a nonblocking broadcast within a group of ranks; the in-process
+// one below runs ranks as threads, GF2MPITransport over MPI.
+class GF2Transport {
+public:
+    // A broadcast in flight
+    class Request {
+    public:
+        virtual ~Request() = default;
+        // Blocks until the words have arrived (at a receiver) or the root's
+        // buffer may be reused
+        virtual void wait() = 0;
+    };
+
+    virtual ~GF2Transport() = default;
+    virtual int rank() const = 0;
+    virtual int size() const = 0;
+
+    // Starts sending the n words at 'words' of rank root to the 'words' of
+    // every other rank of group (ascending ranks, the caller and root among
+    // them). Every rank of a group starts its broadcasts in the same order,
+    // and the buffers stay untouched until the request's wait() returns.
+    virtual std::unique_ptr<Request> broadcast(uint64_t* words, size_t n,
+                                               const std::vector<int>& group, int root) = 0;
+};
+
+// Ranks as threads of one process, sharing memory: a receiver copies the
+// root's buffer when it waits. For tests of the distributed code and for
+// splitting one host's work the same way.
+class GF2LocalTransport : public GF2Transport {
+public:
+    // The transports of 'ranks' ranks that talk to each other; each is
+    // used by one thread
+    static std::vector<std::unique_ptr<GF2LocalTransport>> create(int ranks);
+
+    int rank() const override { return m_rank; }
+    int size() const override;
+    std::unique_ptr<Request> broadcast(uint64_t* words, size_t n, const std::vector<int>& group,
+                                       int root) override;
+
+private:
+    struct Hub;
+    GF2LocalTransport(std::shared_ptr<Hub> hub, int rank) : m_hub(std::move(hub)), m_rank(rank) {}
+
+    std::shared_ptr<Hub> m_hub;
+    int m_rank;
+    std::map<std::vector<int>, uint64_t> m_sequence; // broadcasts started per group
+};
+
+#ifdef GF2_HAVE_MPI
+// The ranks of an MPI communicator. A group's broadcasts are MPI_Ibcast on
+// a communicator of its ranks, created on its first broadcast. Destroy the
+// transport before MPI_Finalize.
+class GF2MPITransport : public GF2Transport {
+public:
+    explicit GF2MPITransport(MPI_Comm comm = MPI_COMM_WORLD);
+    ~GF2MPITransport() override;
+    GF2MPITransport(const GF2MPITransport&) = delete;
+    GF2MPITransport& operator=(const GF2MPITransport&) = delete;
+
+    int rank() const override { return m_rank; }
+    int size() const override { return m_size; }
+    std::unique_ptr<Request> broadcast(uint64_t* words, size_t n, const std::vector<int>& group,
+                                       int root) override;
+
+private:
+    MPI_Comm m_comm;
+    int m_rank = 0;
+    int m_size = 1;
+    std::map<std::vector<int>, MPI_Comm> m_groups;
+};
+#endif
+
+// Where the blocks of A (m x k), B (k x n) and C live on a grid of
+// grid_rows x grid_cols ranks, rank r at grid row r / grid_cols and column
+// r % grid_cols. Grid row i holds the rows [rowBegin(i), rowEnd(i)) of A and
+// C, grid column j the columns [colBegin(j), colEnd(j)) of B and C. k is cut
+// into panels of panel_cols columns of A (rows of B), dealt round-robin:
+// panel p is in A's grid column p % grid_cols and B's grid row p % grid_rows,
+// so every rank owns about as many as it broadcasts of each.
+struct GF2SummaLayout {
+    size_t m = 0, k = 0, n = 0;
+    int grid_rows = 1, grid_cols = 1;
+    size_t panel_cols = 0; // a multiple of 64
+
+    // The layout of the product on 'ranks' ranks. grid_rows <= 0 picks the
+    // squarest grid, grid_rows the largest divisor of ranks up to its square
+    // root. panel_cols is rounded up to a multiple of 64. Throws
+    // std::runtime_error if grid_rows does not divide ranks.
+    GF2SummaLayout(size_t m, size_t k, size_t n, int ranks, size_t panel_cols = 2048,
+                   int grid_rows = 0);
+
+    int ranks() const { return grid_rows * grid_cols; }
+    size_t rowBegin(int i) const;
+    size_t rowEnd(int i) const { return rowBegin(i + 1); }
+    // Multiples of 64 apart, so C's blocks are writable windows
+    size_t colBegin(int j) const;
+    size_t colEnd(int j) const { return colBegin(j + 1); }
+    size_t panels() const { return panel_cols == 0 ? 0 : (k + panel_cols - 1) / panel_cols; }
+    size_t panelWidth(size_t p) const;
+
+    // The blocks of a rank, cut from whole matrices: A's rows of its grid
+    // row and panels of its grid column side by side, in panel order; B's
+    // panels of its grid row stacked, over the columns of its grid column
+    GF2Matrix localA(const GF2MatrixView& a, int rank) const;
+    GF2Matrix localB(const GF2MatrixView& b, int rank) const;
+    // Copies the block of C computed by rank into its place in c (m x n)
+    void placeC(const GF2Matrix& c_local, int rank, GF2Matrix& c) const;
+};
+
+// How gf2_summa_multiply computes the panel products
+struct GF2SummaConfig {
+    // Runs each panel product, so it takes the engine's fastest method for
+    // the shape (SIMD, M4R, Strassen or the GPU); null for the SIMD kernel
+    // fused into C. One engine per rank.
+    GF2Engine* engine = nullptr;
+    int num_threads = 0; // of the SIMD kernel; <= 0 for the OpenMP default
+};
+
+// Where the time of a distributed multiply went on one rank. stall_seconds
+// is the waits for panels that had not arrived when the compute needed
+// them, which is zero when the network keeps up.
+struct GF2SummaStats {
+    double wall_seconds = 0.0;
+    double compute_seconds = 0.0;
+    double stall_seconds = 0.0;
+    size_t bytes_sent = 0;
+    size_t bytes_received = 0;
+};
+
+// This rank's block of C = A * B by SUMMA: for every panel of k, its owner
+// in each grid row broadcasts its part of A along the row and its owner in
+// each grid column its part of B down the column, and every rank adds the
+// product of the two to its block of C. The next panels' broadcasts are in
+// flight while the current ones are multiplied, so with panels that take
+// longer to multiply than to send a run is bound by the compute, P ranks
+// doing 1/P of it each. a_local and b_local are the rank's blocks
+// (GF2SummaLayout::localA, localB); every rank of the transport calls this
+// with the same layout. Throws std::runtime_error if the blocks or the
+// transport do not match the layout.
+GF2Matrix gf2_summa_multiply(const GF2Matrix& a_local, const GF2Matrix& b_local,
+                             const GF2SummaLayout& layout, GF2Transport& transport,
+                             const GF2SummaConfig& config = GF2SummaConfig(),
+                             GF2SummaStats* stats = nullptr);
@@ -0,0 +1,320 @@
+#include "GF2EnergyMeter.hpp"
+#include <cerrno>
+#include <cstring>
+
+#if defined(__APPLE__)
+#include <CoreFoundation/CoreFoundation.h>
+#include <dlfcn.h>
+#else
+#include <dirent.h>
+#include <fstream>
+#endif
+
+namespace {
+
+#if defined(__APPLE__)
+// The private IOReport library, the source of powermetrics' energy figures
+struct IOReport {
+    using Subscription = void*;
+    CFDictionaryRef (*copy_channels_in_group)(CFStringRef group, CFStringRef subgroup,
+                                              uint64_t, uint64_t, uint64_t) = nullptr;
+    Subscription (*create_subscription)(void*, CFMutableDictionaryRef desired,
+                                        CFMutableDictionaryRef* subscribed, uint64_t,
+                                        CFTypeRef) = nullptr;
+    CFDictionaryRef (*create_samples)(Subscription, CFMutableDictionaryRef subscribed,
+                                      CFTypeRef) = nullptr;
+    CFDictionaryRef (*create_samples_delta)(CFDictionaryRef before, CFDictionaryRef after,
+                                            CFTypeRef) = nullptr;
+    CFStringRef (*channel_name)(CFDictionaryRef channel) = nullptr;
+    CFStringRef (*unit_label)(CFDictionaryRef channel) = nullptr;
+    int64_t (*integer_value)(CFDictionaryRef channel, int32_t) = nullptr;
+
+    bool loaded() const {
+        return copy_channels_in_group && create_subscription && create_samples &&
+               create_samples_delta && channel_name && unit_label && integer_value;
+    }
+};
+
+template <class F>
+void load(void* handle, F& function, const char* name) {
+    function = reinterpret_cast<F>(dlsym(handle, name));
+}
+
+const IOReport& ioreport() {
+    static const IOReport library = [] {
+        IOReport r;
+        void* handle = dlopen("/usr/lib/libIOReport.dylib", RTLD_LAZY);
+        if (handle) {
+            load(handle, r.copy_channels_in_group, "IOReportCopyChannelsInGroup");
+            load(handle, r.create_subscription, "IOReportCreateSubscription");
+            load(handle, r.create_samples, "IOReportCreateSamples");
+            load(handle, r.create_samples_delta, "IOReportCreateSamplesDelta");
+            load(handle, r.channel_name, "IOReportChannelGetChannelName");
+            load(handle, r.unit_label, "IOReportChannelGetUnitLabel");
+            load(handle, r.integer_value, "IOReportSimpleGetIntegerValue");
+        }
+        return r;
+    }();
+    return library;
+}
+
+std::string to_string(CFStringRef text) {
+    char buffer[128] = {};
+    if (!text ||
+        !CFStringGetCString(text, buffer, sizeof(buffer), kCFStringEncodingUTF8)) {
+        return "";
+    }
+    return buffer;
+}
+
+// Joules per unit of a channel's "mJ", "uJ" or "nJ" label, 0 if unknown
+double joules_per_unit(const std::string& unit) {
+    if (unit == "mJ") return 1e-3;
+    if (unit == "uJ") return 1e-6;
+    if (unit == "nJ") return 1e-9;
+    return 0.0;
+}
+
+void add(double& domain, double joules) {
+    domain = (domain < 0.0 ? 0.0 : domain) + joules;
+}
+#else
+const char* const POWERCAP = "/sys/class/powercap";
+
+bool read_number(const std::string& path, double& value) {
+    std::ifstream file(path);
+    return static_cast<bool>(file >> value);
+}
+
+std::string read_line(const std::string& path) {
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+// "package-0" -> "package"; "core", "uncore" and "dram" as they are
+std::string zone_kind(const std::string& name) {
+    return name.compare(0, 8, "package-") == 0 ? "package" : name;
+}
+#endif
+
+} // namespace
+
+double GF2EnergySample::total() const {
+    if (package_j >= 0.0) {
+        return package_j;
+    }
+    double sum = -1.0;
+    for (double j : {cpu_j, gpu_j, dram_j}) {
+        if (j >= 0.0) {
+            sum = (sum < 0.0 ? 0.0 : sum) + j;
+        }
+    }
+    return sum;
+}
+
+double GF2EnergySample::gopsPerWatt(double operations, double joules) {
+    return joules > 0.0 ? operations / joules / 1e9 : -1.0;
+}
+
+GF2EnergyMeter::~GF2EnergyMeter() {
+    close();
+}
+
+#if defined(__APPLE__)
+bool GF2EnergyMeter::open(std::string* error) {
+    close();
+    const IOReport& r = ioreport();
+    if (!r.loaded()) {
+        if (error) {
+            *error = "libIOReport not found";
+        }
+        return false;
+    }
+    CFDictionaryRef group =
+        r.copy_channels_in_group(CFSTR("Energy Model"), nullptr, 0, 0, 0);
+    if (!group) {
+        if (error) {
+            *error = "no IOReport energy channels";
+        }
+        return false;
+    }
+    CFMutableDictionaryRef desired =
+        CFDictionaryCreateMutableCopy(kCFAllocatorDefault, CFDictionaryGetCount(group), group);
+    CFRelease(group);
+    CFMutableDictionaryRef subscribed = nullptr;
+    _subscription = r.create_subscription(nullptr, desired, &subscribed, 0, nullptr);
+    CFRelease(desired);
+    if (!_subscription || !subscribed) {
+        if (error) {
+            *error = "IOReport subscription failed";
+        }
+        close();
+        return false;
+    }
+    _channels = subscribed;
+    _open = true;
+    return true;
+}
+
+void GF2EnergyMeter::close() {
+    if (_begin) {
+        CFRelease(static_cast<CFTypeRef>(_begin));
+    }
+    if (_channels) {
+        CFRelease(static_cast<CFTypeRef>(_channels));
+    }
+    if (_subscription) {
+        CFRelease(static_cast<CFTypeRef>(_subscription));
+    }
+    _begin = nullptr;
+    _channels = nullptr;
+    _subscription = nullptr;
+    _open = false;
+}
+
+std::string GF2EnergyMeter::describe() const {
+    return _open ? "cpu gpu dram" : "";
+}
+
+void GF2EnergyMeter::start() {
+    if (!_open) {
+        return;
+    }
+    if (_begin) {
+        CFRelease(static_cast<CFTypeRef>(_begin));
+    }
+    _begin = ioreport().create_samples(
+        _subscription, static_cast<CFMutableDictionaryRef>(_channels), nullptr);
+}
+
+GF2EnergySample GF2EnergyMeter::stop() {
+    GF2EnergySample sample;
+    if (!_open || !_begin) {
+        return sample;
+    }
+    const IOReport& r = ioreport();
+    CFDictionaryRef end =
+        r.create_samples(_subscription, static_cast<CFMutableDictionaryRef>(_channels), nullptr);
+    if (!end) {
+        return sample;
+    }
+    CFDictionaryRef delta =
+        r.create_samples_delta(static_cast<CFDictionaryRef>(_begin), end, nullptr);
+    CFRelease(end);
+    if (!delta) {
+        return sample;
+    }
+
+    // Names as powermetrics reports them; the per-cluster channels are
+    // parts of "CPU Energy" and are skipped
+    CFArrayRef channels = static_cast<CFArrayRef>(
+        CFDictionaryGetValue(delta, CFSTR("IOReportChannels")));
+    const CFIndex count = channels ? CFArrayGetCount(channels) : 0;
+    for (CFIndex i = 0; i < count; ++i) {
+        CFDictionaryRef channel =
+            static_cast<CFDictionaryRef>(CFArrayGetValueAtIndex(channels, i));
+        const std::string name = to_string(r.channel_name(channel));
+        const double joules = double(r.integer_value(channel, 0)) *
+                              joules_per_unit(to_string(r.unit_label(channel)));
+        if (name == "CPU Energy") {
+            add(sample.cpu_j, joules);
+        } else if (name == "GPU Energy") {
+            add(sample.gpu_j, joules);
+        } else if (name.compare(0, 4, "DRAM") == 0) {
+            add(sample.dram_j, joules);
+        }
+    }
+    CFRelease(delta);
+    return sample;
+}
+#else
+bool GF2EnergyMeter::open(std::string* error) {
+    close();
+    DIR* dir = opendir(POWERCAP);
+    if (!dir) {
+        if (error) {
+            *error = std::string(POWERCAP) + ": " + std::strerror(errno);
+        }
+        return false;
+    }
+    // intel-rapl:0 (package), intel-rapl:0:0 (core), ...; the mmio twins
+    // (intel-rapl-mmio) and psys (the whole platform) are skipped
+    std::string failure = "no RAPL zones";
+    while (dirent* entry = readdir(dir)) {
+        const std::string id = entry->d_name;
+        if (id.compare(0, 11, "intel-rapl:") != 0) {
+            continue;
+        }
+        const std::string base = std::string(POWERCAP) + "/" + id;
+        Zone zone;
+        zone.path = base + "/energy_uj";
+        zone.name = zone_kind(read_line(base + "/name"));
+        double value = 0.0;
+        if (zone.name == "psys" || zone.name.empty()) {
+            continue;
+        }
+        if (!read_number(zone.path, value)) {
+            failure = zone.path + ": " + std::strerror(errno) + " (readable by root only)";
+            continue;
+        }
+        read_number(base + "/max_energy_range_uj", zone.range_uj);
+        _zones.push_back(zone);
+    }
+    closedir(dir);
+    if (_zones.empty()) {
+        if (error) {
+            *error = failure;
+        }
+        return false;
+    }
+    _open = true;
+    return true;
+}
+
+void GF2EnergyMeter::close() {
+    _zones.clear();
+    _open = false;
+}
+
+std::string GF2EnergyMeter::describe() const {
+    std::string names;
+    for (const Zone& zone : _zones) {
+        if (names.find(zone.name) == std::string::npos) {
+            names += (names.empty() ? "" : " ") + zone.name;
+        }
+    }
+    return names;
+}
+
+void GF2EnergyMeter::start() {
+    for (Zone& zone : _zones) {
+        read_number(zone.path, zone.begin_uj);
+    }
+}
+
+GF2EnergySample GF2EnergyMeter::stop() {
+    GF2EnergySample sample;
+    for (const Zone& zone : _zones) {
+        double end_uj = 0.0;
+        if (!read_number(zone.path, end_uj)) {
+            continue;
+        }
+        double used_uj = end_uj - zone.begin_uj;
+        if (used_uj < 0.0) {
+            used_uj += zone.range_uj; // the counter wrapped
+        }
+        // Packages and their subzones of every socket are summed
+        double* domain = zone.name == "package" ? &sample.package_j
+                         : zone.name == "core"  ? &sample.cpu_j
+                         : zone.name == "uncore" ? &sample.gpu_j
+                         : zone.name == "dram"   ? &sample.dram_j
+                                                 : nullptr;
+        if (domain) {
+            *domain = (*domain < 0.0 ? 0.0 : *domain) + used_uj * 1e-6;
+        }
+    }
+    return sample;
+}
+#endif
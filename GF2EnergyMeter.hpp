@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Energy of one timed region in joules, by domain. Negative = not measured
+// on this machine. The domains cover the whole package or SoC, so background
+// activity during the region is included too.
+struct GF2EnergySample {
+    double package_j = -1.0; // whole CPU package (RAPL)
+    double cpu_j = -1.0;     // CPU cores
+    double gpu_j = -1.0;     // integrated GPU (RAPL uncore, Apple GPU)
+    double dram_j = -1.0;
+
+    bool valid() const { return total() >= 0.0; }
+    // The package where it is measured, else the sum of the other domains
+    double total() const;
+    // Giga-operations per joule, which is GOPS/W, or -1
+    static double gopsPerWatt(double operations, double joules);
+};
+
+// Energy counters: RAPL through /sys/class/powercap on Linux (package, core,
+// uncore and DRAM zones; energy_uj is readable by root only on current
+// kernels), and the IOReport "Energy Model" channels on macOS (CPU, GPU and
+// DRAM, no root needed). RAPL counters advance about every millisecond, so
+// regions much shorter than that read as noise.
+class GF2EnergyMeter {
+public:
+    GF2EnergyMeter() = default;
+    ~GF2EnergyMeter();
+
+    GF2EnergyMeter(const GF2EnergyMeter&) = delete;
+    GF2EnergyMeter& operator=(const GF2EnergyMeter&) = delete;
+
+    // False, with the reason in 'error', if there is no energy counter we
+    // can read
+    bool open(std::string* error = nullptr);
+    void close();
+    bool isOpen() const { return _open; }
+    // The domains measured, e.g. "package core dram"
+    std::string describe() const;
+
+    // Around the timed region; stop() returns an empty sample when closed
+    void start();
+    GF2EnergySample stop();
+
+private:
+    bool _open = false;
+#if defined(__APPLE__)
+    // IOReport subscription and the sample taken at start() (CF objects)
+    void* _subscription = nullptr;
+    void* _channels = nullptr;
+    const void* _begin = nullptr;
+#else
+    // One RAPL zone: its energy_uj file, counter range and reading at start()
+    struct Zone {
+        std::string path;
+        std::string name;
+        double range_uj = 0.0;
+        double begin_uj = 0.0;
+    };
+    std::vector<Zone> _zones;
+#endif
+};
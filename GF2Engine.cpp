@@ -0,0 +1,620 @@
+#include "GF2Engine.hpp"
+#include "GF2CpuInfo.hpp"
+#include "GF2MatrixView.hpp"
+#include "GF2Metrics.hpp"
+#include "GF2SparseMatrix.hpp"
+#ifdef GF2_HAVE_METAL
+#include "GF2GPU.hpp"
+#endif
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <sys/stat.h>
+
+namespace {
+
+constexpr GF2Engine::Method ALL_METHODS[] = {
+    GF2Engine::Method::Serial,        GF2Engine::Method::SIMD,
+    GF2Engine::Method::SIMDParallel,  GF2Engine::Method::M4R,
+    GF2Engine::Method::Strassen,      GF2Engine::Method::SIMDTile,
+    GF2Engine::Method::GPUBaseline,   GF2Engine::Method::GPUTransposed,
+    GF2Engine::Method::GPUTiled,      GF2Engine::Method::GPUVectorized,
+    GF2Engine::Method::GPUSimdGroup,  GF2Engine::Method::GPUM4R,
+    GF2Engine::Method::Hybrid,
+};
+
+// Used when the profile has nothing for a shape
+constexpr GF2Engine::Method FALLBACK_METHOD = GF2Engine::Method::SIMDParallel;
+
+bool is_gpu_method(GF2Engine::Method method) {
+    return method >= GF2Engine::Method::GPUBaseline;
+}
+
+// The configured path, GF2_ENGINE_PROFILE, or a file in the user's cache
+// directory (made with mode 0700 if missing); empty to keep the profile in
+// memory. Not a shared directory such as /tmp, where another user could
+// plant the profile the routing trusts.
+std::string profile_path(const GF2EngineConfig& config) {
+    if (!config.persist_profile) {
+        return "";
+    }
+    if (!config.profile_path.empty()) {
+        return config.profile_path;
+    }
+    if (const char* path = std::getenv("GF2_ENGINE_PROFILE")) {
+        return path;
+    }
+    std::string dir;
+    if (const char* cache = std::getenv("XDG_CACHE_HOME"); cache && *cache == '/') {
+        dir = cache;
+    } else if (const char* home = std::getenv("HOME"); home && *home == '/') {
+        dir = std::string(home) + "/.cache";
+    } else {
+        return "";
+    }
+    if (dir.back() != '/') {
+        dir += '/';
+    }
+    ::mkdir(dir.c_str(), 0700);
+    dir += "gf2/";
+    if (::mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST) {
+        return "";
+    }
+    return dir + "engine_profile.txt";
+}
+
+double shape_distance(size_t m, size_t k, size_t n, const std::tuple<size_t, size_t, size_t>& s) {
+    auto d = [](size_t x, size_t y) {
+        double l = std::log2(double(std::max<size_t>(x, 1))) - std::log2(double(std::max<size_t>(y, 1)));
+        return l * l;
+    };
+    return d(m, std::get<0>(s)) + d(k, std::get<1>(s)) + d(n, std::get<2>(s));
+}
+
+double volume(size_t m, size_t k, size_t n) { return double(m) * double(k) * double(n); }
+
+// An a with fewer ones than this goes to the sparse product: its nnz row
+// XORs of b beat the dense kernels up to about 3% ones at 4096 x 4096
+constexpr double SPARSE_MAX_DENSITY = 1.0 / 64;
+
+// Zero rows of a, or zero row blocks of b, are compacted away from this
+// share of the rows on, below which the copies cost about what they save
+constexpr double COMPACT_MIN_FRACTION = 0.25;
+
+// dst = the bits of src, both word aligned and of the same shape
+void copy_view(const GF2MatrixView& src, const GF2MutableMatrixView& dst) {
+    const size_t words = dst.words_per_row();
+    for (size_t r = 0; r < dst.rows(); ++r) {
+        std::memcpy(dst.get_raw_data() + r * dst.row_stride(),
+                    src.get_raw_data() + r * src.row_stride(), words * sizeof(uint64_t));
+    }
+    dst.clearPadding();
+}
+
+// The backend kernel of a GPU method
+GF2Kernel kernel_of(GF2Engine::Method method) {
+    switch (method) {
+    case GF2Engine::Method::GPUBaseline: return GF2Kernel::Baseline;
+    case GF2Engine::Method::GPUTransposed: return GF2Kernel::Transposed;
+    case GF2Engine::Method::GPUTiled: return GF2Kernel::Tiled;
+    case GF2Engine::Method::GPUSimdGroup: return GF2Kernel::SimdGroup;
+    case GF2Engine::Method::GPUM4R: return GF2Kernel::M4R;
+    default: return GF2Kernel::Vectorized; // GPUVectorized, and the GPU half of Hybrid
+    }
+}
+
+} // namespace
+
+GF2Engine::GF2Engine(GF2Backend* gpu, GF2EngineConfig config)
+    : _gpu(gpu), _config(std::move(config)), _ready(false) {
+    if (_config.product_cache_bytes > 0) {
+        _cache = std::make_unique<GF2ProductCache>(_config.product_cache_bytes);
+    }
+}
+
+GF2TaskPool& GF2Engine::taskPool() {
+    std::call_once(_poolOnce, [this] {
+        if (_config.num_threads > 0) {
+            _pool = std::make_unique<GF2TaskPool>(_config.num_threads);
+        }
+    });
+    return _pool ? *_pool : GF2TaskPool::shared();
+}
+
+const char* GF2Engine::methodName(Method method) {
+    switch (method) {
+    case Method::Serial: return "Serial";
+    case Method::SIMD: return "SIMD";
+    case Method::SIMDParallel: return "SIMD-Parallel";
+    case Method::M4R: return "M4R";
+    case Method::Strassen: return "Strassen";
+    case Method::SIMDTile: return "SIMD-Tile";
+    case Method::GPUBaseline: return "GPU";
+    case Method::GPUTransposed: return "GPU-Transposed";
+    case Method::GPUTiled: return "GPU-Tiled";
+    case Method::GPUVectorized: return "GPU-Vectorized";
+    case Method::GPUSimdGroup: return "GPU-SimdGroup";
+    case Method::GPUM4R: return "GPU-M4R";
+    case Method::Hybrid: return "Hybrid";
+    }
+    return "?";
+}
+
+std::vector<GF2Engine::Method> GF2Engine::availableMethods() const {
+    std::vector<Method> methods;
+    for (Method method : ALL_METHODS) {
+        if (!is_gpu_method(method)) {
+            methods.push_back(method);
+        } else if (method == Method::Hybrid) {
+#ifdef GF2_HAVE_METAL
+            if (dynamic_cast<GF2GPU*>(_gpu)) {
+                methods.push_back(method);
+            }
+#endif
+        } else if (_gpu && _gpu->supports(kernel_of(method))) {
+            methods.push_back(method);
+        }
+    }
+    return methods;
+}
+
+std::string GF2Engine::machineKey() const {
+    std::string key = GF2CpuInfo::get().describe();
+    key += " | ";
+    key += GF2Matrix::simdKernelName();
+    key += " | ";
+    if (_gpu) {
+        key += _gpu->backendName();
+        key += " ";
+        key += _gpu->deviceName();
+    } else {
+        key += "no GPU";
+    }
+    // One line in the profile file
+    std::replace(key.begin(), key.end(), '\n', ' ');
+    return key;
+}
+
+// --- Running a method ---
+
+void GF2Engine::run(Method method, const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result) {
+    if (!GF2Metrics::enabled()) {
+        execute(method, a, b, result);
+        return;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    execute(method, a, b, result);
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start);
+    const size_t m = a.rows(), k = a.cols(), n = b.cols();
+    const uint64_t words = a.rows() * a.words_per_row() + b.rows() * b.words_per_row() +
+                           result.rows() * result.words_per_row();
+    GF2Metrics::record(GF2Metrics::series(is_gpu_method(method) ? _gpu->backendName() : "CPU",
+                                          methodName(method), m, k, n),
+                       uint64_t(ns.count()), uint64_t(m) * k * n, words * sizeof(uint64_t));
+}
+
+void GF2Engine::execute(Method method, const GF2Matrix& a, const GF2Matrix& b,
+                        GF2Matrix& result) {
+    if (is_gpu_method(method) && !_gpu) {
+        throw std::runtime_error(std::string("No GPU for method ") + methodName(method));
+    }
+    if (result.rows() != a.rows() || result.cols() != b.cols()) {
+        result = GF2Matrix(a.rows(), b.cols());
+    }
+
+    switch (method) {
+    case Method::Serial: result = a.multiplySerial(b); break;
+    case Method::SIMD: result = a.multiplySIMD(b); break;
+    case Method::SIMDParallel: result = a.multiplySIMDParallel(b, _config.num_threads); break;
+    case Method::M4R: result = a.multiplyM4R(b); break;
+    case Method::Strassen: result = a.multiplyStrassen(b, 1024, &taskPool()); break;
+    case Method::SIMDTile:
+        result = a.multiplySIMDTile(b, tile(a.rows(), a.cols(), b.cols()), _config.num_threads);
+        break;
+    case Method::GPUBaseline:
+    case Method::GPUTransposed:
+    case Method::GPUTiled:
+    case Method::GPUVectorized:
+    case Method::GPUSimdGroup:
+    case Method::GPUM4R: _gpu->multiply(kernel_of(method), a, b, result); break;
+    case Method::Hybrid: {
+#ifdef GF2_HAVE_METAL
+        auto* metal = dynamic_cast<GF2GPU*>(_gpu);
+        if (metal) {
+            metal->multiplyHybrid(a, b, result, GF2Kernel::Vectorized, _config.num_threads);
+            break;
+        }
+#endif
+        throw std::runtime_error(std::string("Hybrid needs the Metal backend, not ") +
+                                 _gpu->backendName());
+    }
+    }
+}
+
+GF2Matrix GF2Engine::multiply(const GF2Matrix& a, const GF2Matrix& b) {
+    GF2Matrix result(a.rows(), b.cols());
+    multiply(a, b, result);
+    return result;
+}
+
+void GF2Engine::multiply(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result) {
+    if (a.cols() != b.rows()) {
+        throw std::runtime_error("Matrix dimensions don't match for multiplication");
+    }
+    if (!_cache) {
+        multiplyUncached(a, b, result);
+        return;
+    }
+    if (_cache->lookup(a, b, result)) {
+        return;
+    }
+    multiplyUncached(a, b, result);
+    _cache->insert(a, b, std::make_shared<const GF2Matrix>(result));
+}
+
+// The structured steps' smaller operands are not looked up in the cache
+void GF2Engine::multiplyUncached(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result) {
+    if (_config.structure_aware && multiplyStructured(a, b, result)) {
+        return;
+    }
+    run(choose(a.rows(), a.cols(), b.cols()), a, b, result);
+}
+
+// Each step multiplies smaller or sparser operands through
+// multiplyUncached(), so the steps compose (an identity prefix over zero rows loses both)
+bool GF2Engine::multiplyStructured(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result) {
+    const size_t m = a.rows(), k = a.cols(), n = b.cols();
+    if (m == 0 || k == 0 || n == 0) {
+        return false;
+    }
+    const GF2Structure& sa = a.structure();
+    const GF2Structure& sb = b.structure();
+    auto fresh_result = [&] {
+        if (result.rows() != m || result.cols() != n) {
+            result = GF2Matrix(m, n);
+        } else {
+            std::memset(result.get_raw_data(), 0,
+                        result.rows() * result.row_stride() * sizeof(uint64_t));
+        }
+    };
+
+    if (sa.zero() || sb.zero()) {
+        fresh_result();
+        return true;
+    }
+
+    // The identity prefixes in whole words. B = [I P; 0 Q] gives
+    // A * B = [A_1 | A * B_2], B_2 its columns past p
+    const size_t pb = sb.identity_prefix / 64 * 64;
+    if (pb > 0) {
+        fresh_result();
+        copy_view(GF2MatrixView(a).view(0, m, 0, pb), result.mutableView(0, m, 0, pb));
+        if (pb < n) {
+            GF2Matrix rest(m, n - pb);
+            multiplyUncached(a, GF2MatrixView(b).view(0, k, pb, n).copy(), rest);
+            copy_view(rest, result.mutableView(0, m, pb, n));
+        }
+        return true;
+    }
+    // A = [I P; 0 Q] gives A * B = A_2 * B_2 with B's first p rows added to
+    // the first p rows, A_2 the columns of A and B_2 the rows of B past p
+    const size_t pa = sa.identity_prefix / 64 * 64;
+    if (pa > 0) {
+        if (pa < k) {
+            multiplyUncached(GF2MatrixView(a).view(0, m, pa, k).copy(),
+                             GF2MatrixView(b).view(pa, k, 0, n).copy(), result);
+        } else {
+            fresh_result();
+        }
+        for (size_t r = 0; r < pa; ++r) {
+            result.rowXor(r, b, r);
+        }
+        return true;
+    }
+
+    // Rows of C are zero where those of A are: multiply A's other rows
+    if (double(sa.zero_rows) >= COMPACT_MIN_FRACTION * double(m)) {
+        std::vector<size_t> live;
+        for (size_t r = 0; r < m; ++r) {
+            if (!sa.rowIsZero(r)) live.push_back(r);
+        }
+        GF2Matrix packed(live.size(), k), product(live.size(), n);
+        for (size_t i = 0; i < live.size(); ++i) {
+            std::memcpy(packed.get_raw_data() + i * packed.row_stride(),
+                        a.get_raw_data() + live[i] * a.row_stride(),
+                        a.words_per_row() * sizeof(uint64_t));
+        }
+        multiplyUncached(packed, b, product);
+        fresh_result();
+        for (size_t i = 0; i < live.size(); ++i) {
+            std::memcpy(result.get_raw_data() + live[i] * result.row_stride(),
+                        product.get_raw_data() + i * product.row_stride(),
+                        result.words_per_row() * sizeof(uint64_t));
+        }
+        return true;
+    }
+
+    // A zero block of 64 rows of B meets a word column of A: drop both
+    const size_t blocks = (k + 63) / 64;
+    if (double(sb.zero_row_blocks) >= COMPACT_MIN_FRACTION * double(blocks)) {
+        std::vector<size_t> live;
+        for (size_t w = 0; w < blocks; ++w) {
+            if (!sb.blockIsZero(w)) live.push_back(w);
+        }
+        // The last block may be partial; it is kept last, so the packed
+        // matrices end with its columns and rows
+        const size_t cols = live.empty() ? 0 : (live.size() - 1) * 64 +
+                                                   std::min<size_t>(64, k - live.back() * 64);
+        GF2Matrix a_packed(m, cols), b_packed(cols, n);
+        for (size_t r = 0; r < m; ++r) {
+            const uint64_t* src = a.get_raw_data() + r * a.row_stride();
+            uint64_t* dst = a_packed.get_raw_data() + r * a_packed.row_stride();
+            for (size_t i = 0; i < live.size(); ++i) dst[i] = src[live[i]];
+        }
+        for (size_t i = 0; i < live.size(); ++i) {
+            const size_t rows = std::min<size_t>(64, k - live[i] * 64);
+            copy_view(GF2MatrixView(b).view(live[i] * 64, live[i] * 64 + rows, 0, n),
+                      b_packed.mutableView(i * 64, i * 64 + rows, 0, n));
+        }
+        multiplyUncached(a_packed, b_packed, result);
+        return true;
+    }
+
+    if (sa.density < SPARSE_MAX_DENSITY) {
+        result = GF2SparseMatrix::fromDense(a).multiply(b, _config.num_threads);
+        return true;
+    }
+    return false;
+}
+
+// --- Profile lookup ---
+
+const std::pair<const GF2Engine::Shape, std::map<GF2Engine::Method, double>>*
+GF2Engine::nearest(size_t m, size_t k, size_t n, const Method* only) const {
+    const std::pair<const Shape, std::map<Method, double>>* best = nullptr;
+    double best_distance = 0.0;
+    for (const auto& entry : _profile) {
+        if (only && !entry.second.count(*only)) {
+            continue;
+        }
+        double distance = shape_distance(m, k, n, entry.first);
+        if (!best || distance < best_distance) {
+            best = &entry;
+            best_distance = distance;
+        }
+    }
+    return best;
+}
+
+GF2Engine::Method GF2Engine::choose(size_t m, size_t k, size_t n) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    ensureProfile();
+
+    const auto* entry = nearest(m, k, n);
+    if (!entry || entry->second.empty()) {
+        return FALLBACK_METHOD;
+    }
+    auto fastest = std::min_element(entry->second.begin(), entry->second.end(),
+                                    [](const auto& x, const auto& y) { return x.second < y.second; });
+    return fastest->first;
+}
+
+double GF2Engine::predictMs(Method method, size_t m, size_t k, size_t n) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    ensureProfile();
+
+    const auto* entry = nearest(m, k, n, &method);
+    if (!entry) {
+        return -1.0;
+    }
+    const Shape& s = entry->first;
+    return entry->second.at(method) * volume(m, k, n) /
+           volume(std::get<0>(s), std::get<1>(s), std::get<2>(s));
+}
+
+std::string GF2Engine::tile(size_t m, size_t k, size_t n) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    ensureProfile();
+
+    const Method tiled = Method::SIMDTile;
+    const auto* entry = nearest(m, k, n, &tiled);
+    auto it = entry ? _tiles.find(entry->first) : _tiles.end();
+    return it != _tiles.end() ? it->second : GF2Matrix::simdTileNames().front();
+}
+
+// --- Calibration and persistence ---
+
+void GF2Engine::ensureProfile() {
+    if (_ready) {
+        return;
+    }
+    const std::string path = profile_path(_config);
+    if (path.empty() || !load(path)) {
+        measure();
+        if (!path.empty()) {
+            save(path);
+        }
+    }
+    _ready = true;
+}
+
+void GF2Engine::calibrate() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    measure();
+    const std::string path = profile_path(_config);
+    if (!path.empty()) {
+        save(path);
+    }
+    _ready = true;
+}
+
+void GF2Engine::measure() {
+    std::vector<Shape> shapes;
+    for (size_t m : _config.dims) {
+        for (size_t k : _config.dims) {
+            for (size_t n : _config.dims) {
+                shapes.emplace_back(m, k, n);
+            }
+        }
+    }
+    // Smallest products first, so that methods which get too slow are
+    // dropped before the large shapes
+    std::stable_sort(shapes.begin(), shapes.end(), [](const Shape& x, const Shape& y) {
+        return volume(std::get<0>(x), std::get<1>(x), std::get<2>(x)) <
+               volume(std::get<0>(y), std::get<1>(y), std::get<2>(y));
+    });
+
+    std::cout << "Calibrating the GF(2) engine over " << shapes.size() << " shapes...\n";
+
+    _profile.clear();
+    _tiles.clear();
+    const std::vector<std::string> tiles = GF2Matrix::simdTileNames();
+    std::set<Method> dropped;
+    for (const Shape& shape : shapes) {
+        const auto [m, k, n] = shape;
+        GF2Matrix a(m, k);
+        GF2Matrix b(k, n);
+        a.randomFill();
+        b.randomFill();
+        GF2Matrix result(m, n);
+
+        // The fastest of the timed runs of one product, after a warm-up
+        auto time_ms = [&](auto&& product) {
+            product(); // warm up
+            double best = 0.0;
+            for (int i = 0; i < std::max(_config.repetitions, 1); ++i) {
+                auto start = std::chrono::steady_clock::now();
+                product();
+                double ms = std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - start)
+                                .count();
+                best = i == 0 ? ms : std::min(best, ms);
+            }
+            return best;
+        };
+
+        std::map<Method, double>& timings = _profile[shape];
+        for (Method method : availableMethods()) {
+            if (dropped.count(method)) {
+                continue;
+            }
+            try {
+                double best = 0.0;
+                if (method == Method::SIMDTile) {
+                    // Every tile; the method's time is the winner's
+                    for (const std::string& tile : tiles) {
+                        double ms = time_ms([&] {
+                            result = a.multiplySIMDTile(b, tile, _config.num_threads);
+                        });
+                        if (!_tiles.count(shape) || ms < best) {
+                            best = ms;
+                            _tiles[shape] = tile;
+                        }
+                    }
+                } else {
+                    best = time_ms([&] { execute(method, a, b, result); });
+                }
+                timings[method] = best;
+                if (best > _config.max_method_ms) {
+                    dropped.insert(method);
+                }
+            } catch (const std::exception&) {
+                // Not usable for this shape (e.g. out of GPU memory)
+            }
+        }
+    }
+}
+
+bool GF2Engine::load(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+
+    std::map<std::string, Method> by_name;
+    for (Method method : availableMethods()) {
+        by_name[methodName(method)] = method;
+    }
+
+    // SIMDTile is saved as "SIMD-Tile:<tile>"
+    const std::string tile_prefix = std::string(methodName(Method::SIMDTile)) + ":";
+    const std::vector<std::string> known_tiles = GF2Matrix::simdTileNames();
+
+    std::map<Shape, std::map<Method, double>> profile;
+    std::map<Shape, std::string> tiles;
+    bool machine_matches = false;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        if (line.compare(0, 8, "machine ") == 0) {
+            machine_matches = line.substr(8) == machineKey();
+            if (!machine_matches) {
+                return false;
+            }
+            continue;
+        }
+
+        std::istringstream fields(line);
+        size_t m = 0, k = 0, n = 0;
+        if (!(fields >> m >> k >> n)) {
+            return false;
+        }
+        std::map<Method, double>& timings = profile[Shape(m, k, n)];
+        std::string name;
+        double ms = 0.0;
+        while (fields >> name >> ms) {
+            if (name.compare(0, tile_prefix.size(), tile_prefix) == 0) {
+                const std::string tile = name.substr(tile_prefix.size());
+                if (std::find(known_tiles.begin(), known_tiles.end(), tile) != known_tiles.end()) {
+                    timings[Method::SIMDTile] = ms;
+                    tiles[Shape(m, k, n)] = tile;
+                }
+                continue;
+            }
+            auto it = by_name.find(name);
+            if (it != by_name.end()) {
+                timings[it->second] = ms;
+            }
+        }
+    }
+
+    if (!machine_matches || profile.empty()) {
+        return false;
+    }
+    _profile = std::move(profile);
+    _tiles = std::move(tiles);
+    return true;
+}
+
+void GF2Engine::save(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Could not write the engine profile to " << path << "\n";
+        return;
+    }
+    out << "# GF(2) engine profile: m k n, then method (SIMD-Tile:<tile> with the winning tile) and\n"
+        << "# milliseconds per product\n";
+    out << "machine " << machineKey() << "\n";
+    for (const auto& [shape, timings] : _profile) {
+        out << std::get<0>(shape) << " " << std::get<1>(shape) << " " << std::get<2>(shape);
+        for (const auto& [method, ms] : timings) {
+            out << " " << methodName(method);
+            if (method == Method::SIMDTile) {
+                out << ":" << _tiles.at(shape);
+            }
+            out << " " << ms;
+        }
+        out << "\n";
+    }
+}
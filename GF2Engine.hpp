@@ -0,0 +1,155 @@
+#pragma once
+
+#include "GF2Matrix.hpp"
+#include "GF2Backend.hpp"
+#include "GF2ProductCache.hpp"
+#include "GF2TaskPool.hpp"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// How GF2Engine measures its profile and routes products
+struct GF2EngineConfig {
+    // Grid values of each of m, k and n
+    std::vector<size_t> dims = {64, 256, 1024, 4096};
+    // Timed runs per method and shape (after one warm-up); the minimum counts
+    int repetitions = 2;
+    // A method slower than this at some shape is not timed at larger ones
+    double max_method_ms = 250.0;
+    int num_threads = 0; // 0 = OpenMP default
+    // Look at the operands' structure() before choosing a method (see
+    // GF2Engine::multiply)
+    bool structure_aware = true;
+    // Budget in bytes of a GF2ProductCache of the products multiply()
+    // returns, for workloads repeating operand pairs; 0 = no cache
+    size_t product_cache_bytes = 0;
+    // The profile file; empty for GF2_ENGINE_PROFILE or the default one
+    // (see GF2Engine)
+    std::string profile_path;
+    // false to measure the profile on first use and keep it in memory only
+    bool persist_profile = true;
+};
+
+// Single entry point that routes each product to the fastest available
+// method for its shape on this machine.
+//
+// The choice comes from a profile: every method is timed over a grid of
+// (m, k, n) shapes, and a call uses the winner at the grid point nearest to
+// its shape (in log scale). The profile is measured on first use and saved,
+// keyed by the CPU, the SIMD kernel and the GPU, so later runs on the same
+// machine load it instead. The file is GF2EngineConfig::profile_path, else
+// GF2_ENGINE_PROFILE (empty to keep the profile in memory only), else
+// gf2/engine_profile.txt in $XDG_CACHE_HOME or ~/.cache, the directory made
+// private to the user. Without any of them it stays in memory.
+class GF2Engine {
+public:
+    enum class Method {
+        Serial,
+        SIMD,
+        SIMDParallel,
+        M4R,
+        Strassen,
+        // The register-tile kernel (GF2Matrix::multiplySIMDTile) that was
+        // fastest at the grid point, each shape timing every tile
+        SIMDTile,
+        GPUBaseline,
+        GPUTransposed,
+        GPUTiled,
+        GPUVectorized,
+        GPUSimdGroup,
+        GPUM4R,
+        Hybrid,
+    };
+
+    // gpu may be null for a CPU-only engine. It must outlive the engine.
+    // Hybrid needs the Metal backend; the other GPU methods run on any
+    // backend that has their kernel.
+    explicit GF2Engine(GF2Backend* gpu = nullptr, GF2EngineConfig config = GF2EngineConfig());
+
+    // a * b with the method chosen for the shape. The first call loads or
+    // measures the profile. With structure_aware, the operands' cached
+    // structure() first takes out the work it makes unnecessary: a zero
+    // operand gives a zero product, identity prefixes are copied instead of
+    // multiplied, zero rows of a and zero 64-row blocks of b (with the
+    // matching word columns of a) are left out of what is multiplied, and an
+    // a of under one one per 64 entries goes to the sparse product
+    // (GF2SparseMatrix). The rest is multiplied by the chosen method. With
+    // a product_cache_bytes budget, a pair multiplied before is copied out
+    // of the product cache instead.
+    GF2Matrix multiply(const GF2Matrix& a, const GF2Matrix& b);
+    void multiply(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result);
+
+    // The method multiply() uses for an m x k by k x n product
+    Method choose(size_t m, size_t k, size_t n);
+
+    // Time of a method for the shape, extrapolated by m * k * n from the
+    // nearest grid point it was measured at; negative if it never was
+    double predictMs(Method method, size_t m, size_t k, size_t n);
+
+    // The register tile Method::SIMDTile runs for the shape: the one that
+    // won at the nearest grid point it was measured at
+    std::string tile(size_t m, size_t k, size_t n);
+
+    // Runs one product with the given method, whatever the profile says,
+    // and records it in GF2Metrics (the profile's own runs are not)
+    void run(Method method, const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result);
+
+    // Measures the profile again and saves it
+    void calibrate();
+
+    // Methods usable with this engine (the GPU ones need a backend with
+    // their kernel)
+    std::vector<Method> availableMethods() const;
+
+    static const char* methodName(Method method);
+
+    // Identifies the hardware a profile is valid for
+    std::string machineKey() const;
+
+    // The work-stealing pool the engine's recursive CPU methods (Strassen)
+    // run on: GF2TaskPool::shared() for the OpenMP default of threads, else
+    // a pool of num_threads made on first use. Code submitting GPU work
+    // alongside can run its CPU side here too (GF2TaskPool::run) instead of
+    // starting threads that oversubscribe the cores.
+    GF2TaskPool& taskPool();
+
+    // The cache multiply() keeps its products in; null without a
+    // product_cache_bytes budget
+    GF2ProductCache* productCache() { return _cache.get(); }
+
+private:
+    using Shape = std::tuple<size_t, size_t, size_t>; // m, k, n
+
+    // run() without the metrics
+    void execute(Method method, const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result);
+
+    // multiply() past the product cache
+    void multiplyUncached(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result);
+    // The structure-aware steps of multiply(); false if none applies
+    bool multiplyStructured(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result);
+
+    void ensureProfile();
+    void measure();
+    bool load(const std::string& path);
+    void save(const std::string& path) const;
+    // The grid point nearest to the shape (among those that measured 'only',
+    // if given) and its timings; null for an empty profile
+    const std::pair<const Shape, std::map<Method, double>>* nearest(
+        size_t m, size_t k, size_t n, const Method* only = nullptr) const;
+
+    GF2Backend* _gpu;
+    GF2EngineConfig _config;
+
+    // Milliseconds per product, by grid shape then method
+    std::map<Shape, std::map<Method, double>> _profile;
+    // The winning tile of the grid shapes that timed SIMDTile
+    std::map<Shape, std::string> _tiles;
+    bool _ready;
+    std::mutex _mutex;
+    std::once_flag _poolOnce;
+    std::unique_ptr<GF2TaskPool> _pool; // null while taskPool() is the shared one
+    std::unique_ptr<GF2ProductCache> _cache;
+};
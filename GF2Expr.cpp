@@ -0,0 +1,252 @@
+#include "GF2Expr.hpp"
+#include "GF2Engine.hpp"
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+// Time of one a * b product of an m x k by a k x n matrix: the engine's
+// prediction for the method it would pick, else the word operations of the
+// SIMD kernel, one AND per output bit and word of the common dimension
+double product_cost(size_t m, size_t k, size_t n, const GF2ExprOptions& options) {
+    if (options.engine) {
+        const double ms = options.engine->predictMs(options.engine->choose(m, k, n), m, k, n);
+        if (ms >= 0.0) {
+            return ms;
+        }
+    }
+    return double(m) * double(n) * double((k + 63) / 64);
+}
+
+bool aliases(const GF2Matrix& out, const GF2Product& p) {
+    for (const GF2Matrix* operand : p.operands()) {
+        if (operand == &out) return true;
+    }
+    return false;
+}
+
+void check_shape(const GF2Matrix& out, size_t rows, size_t cols) {
+    if (out.rows() != rows || out.cols() != cols) {
+        throw std::runtime_error("Output matrix has the wrong dimensions");
+    }
+}
+
+// c ^= a, of the same shape
+void xor_into(GF2Matrix& c, const GF2Matrix& a) {
+    for (size_t r = 0; r < c.rows(); ++r) {
+        uint64_t* dst = c.get_raw_data() + r * c.row_stride();
+        const uint64_t* src = a.get_raw_data() + r * a.row_stride();
+        for (size_t w = 0; w < c.words_per_row(); ++w) {
+            dst[w] ^= src[w];
+        }
+    }
+}
+
+} // namespace
+
+// The matrix-chain-order table: the cheapest cost of the product of
+// operands [i, j] and the operand its left factor ends with
+struct GF2Product::Plan {
+    size_t count;
+    std::vector<double> cost;  // count x count, upper triangle
+    std::vector<size_t> split;
+
+    double& costOf(size_t i, size_t j) { return cost[i * count + j]; }
+    size_t& splitOf(size_t i, size_t j) { return split[i * count + j]; }
+};
+
+GF2Product::GF2Product(const GF2Matrix& a) : m_operands{&a}, m_dims{a.rows(), a.cols()} {}
+
+GF2Product& GF2Product::operator*=(const GF2Product& b) {
+    if (cols() != b.rows()) {
+        throw std::runtime_error("Matrix dimensions incompatible for multiplication");
+    }
+    m_operands.insert(m_operands.end(), b.m_operands.begin(), b.m_operands.end());
+    m_dims.insert(m_dims.end(), b.m_dims.begin() + 1, b.m_dims.end());
+    return *this;
+}
+
+GF2Product::Plan GF2Product::plan(const GF2ExprOptions& options) const {
+    const size_t count = m_operands.size();
+    Plan p{count, std::vector<double>(count * count, 0.0), std::vector<size_t>(count * count, 0)};
+    for (size_t length = 2; length <= count; ++length) {
+        for (size_t i = 0; i + length <= count; ++i) {
+            const size_t j = i + length - 1;
+            double best = std::numeric_limits<double>::infinity();
+            for (size_t s = i; s < j; ++s) {
+                const double c = p.costOf(i, s) + p.costOf(s + 1, j) +
+                                 product_cost(m_dims[i], m_dims[s + 1], m_dims[j + 1], options);
+                if (c < best) {
+                    best = c;
+                    p.splitOf(i, j) = s;
+                }
+            }
+            p.costOf(i, j) = best;
+        }
+    }
+    return p;
+}
+
+double GF2Product::cost(const GF2ExprOptions& options) const {
+    Plan p = plan(options);
+    return p.costOf(0, p.count - 1);
+}
+
+double GF2Product::leftToRightCost(const GF2ExprOptions& options) const {
+    double total = 0.0;
+    for (size_t i = 1; i < m_operands.size(); ++i) {
+        total += product_cost(m_dims[0], m_dims[i], m_dims[i + 1], options);
+    }
+    return total;
+}
+
+std::string GF2Product::order(const GF2ExprOptions& options) const {
+    Plan p = plan(options);
+    auto text = [&](auto&& self, size_t i, size_t j) -> std::string {
+        if (i == j) {
+            return std::to_string(i);
+        }
+        const size_t s = p.splitOf(i, j);
+        return "(" + self(self, i, s) + " " + self(self, s + 1, j) + ")";
+    };
+    return text(text, 0, p.count - 1);
+}
+
+GF2Matrix GF2Product::evaluate(const GF2ExprOptions& options) const {
+    GF2Matrix out(rows(), cols());
+    evaluateInto(out, false, options);
+    return out;
+}
+
+void GF2Product::evaluateInto(GF2Matrix& out, bool accumulate,
+                              const GF2ExprOptions& options) const {
+    if (accumulate) {
+        check_shape(out, rows(), cols());
+    }
+    if (aliases(out, *this)) {
+        GF2Matrix product = evaluate(options);
+        if (accumulate) {
+            xor_into(out, product);
+        } else {
+            out = std::move(product);
+        }
+        return;
+    }
+
+    Plan p = plan(options);
+    GF2Workspace ws;
+    // The product of operands [i, j] into dst, which is sized here unless
+    // it accumulates
+    auto run = [&](auto&& self, size_t i, size_t j, GF2Matrix& dst, bool add) -> void {
+        if (i == j) {
+            if (add) {
+                xor_into(dst, *m_operands[i]);
+            } else {
+                dst = *m_operands[i];
+            }
+            return;
+        }
+        const size_t s = p.splitOf(i, j);
+        GF2Matrix left_product(0, 0), right_product(0, 0);
+        if (i < s) self(self, i, s, left_product, false);
+        if (s + 1 < j) self(self, s + 1, j, right_product, false);
+        const GF2Matrix& left = i < s ? left_product : *m_operands[i];
+        const GF2Matrix& right = s + 1 < j ? right_product : *m_operands[j];
+
+        if (add) {
+            GF2Matrix::addMul(dst, left, right, ws, options.num_threads);
+        } else if (options.engine) {
+            options.engine->multiply(left, right, dst);
+        } else {
+            if (dst.rows() != left.rows() || dst.cols() != right.cols()) {
+                dst = GF2Matrix(left.rows(), right.cols());
+            }
+            left.multiplyInto(right, dst, ws, options.num_threads);
+        }
+    };
+    run(run, 0, m_operands.size() - 1, out, accumulate);
+}
+
+GF2ProductSum::GF2ProductSum(GF2Product term) { m_terms.push_back(std::move(term)); }
+
+GF2ProductSum& GF2ProductSum::operator+=(GF2Product term) {
+    if (term.rows() != rows() || term.cols() != cols()) {
+        throw std::runtime_error("Matrix dimensions incompatible for addition");
+    }
+    m_terms.push_back(std::move(term));
+    return *this;
+}
+
+GF2Matrix GF2ProductSum::evaluate(const GF2ExprOptions& options) const {
+    GF2Matrix out(rows(), cols());
+    evaluateInto(out, false, options);
+    return out;
+}
+
+// The first term is written and the others accumulated. If out is an
+// operand, the sum goes to a new matrix first so every term sees its value
+// from before.
+void GF2ProductSum::evaluateInto(GF2Matrix& out, bool accumulate,
+                                 const GF2ExprOptions& options) const {
+    if (accumulate) {
+        check_shape(out, rows(), cols());
+    }
+    for (const GF2Product& term : m_terms) {
+        if (aliases(out, term)) {
+            GF2Matrix sum = evaluate(options);
+            if (accumulate) {
+                xor_into(out, sum);
+            } else {
+                out = std::move(sum);
+            }
+            return;
+        }
+    }
+    for (size_t t = 0; t < m_terms.size(); ++t) {
+        m_terms[t].evaluateInto(out, accumulate || t > 0, options);
+    }
+}
+
+GF2Product operator*(const GF2Matrix& a, const GF2Matrix& b) {
+    GF2Product p(a);
+    p *= GF2Product(b);
+    return p;
+}
+
+GF2Product operator*(GF2Product a, const GF2Matrix& b) {
+    a *= GF2Product(b);
+    return a;
+}
+
+GF2Product operator*(const GF2Matrix& a, const GF2Product& b) {
+    GF2Product p(a);
+    p *= b;
+    return p;
+}
+
+GF2Product operator*(GF2Product a, const GF2Product& b) {
+    a *= b;
+    return a;
+}
+
+GF2ProductSum operator+(GF2Product a, GF2Product b) {
+    GF2ProductSum s(std::move(a));
+    s += std::move(b);
+    return s;
+}
+
+GF2ProductSum operator+(GF2ProductSum a, GF2Product b) {
+    a += std::move(b);
+    return a;
+}
+
+GF2Matrix& operator^=(GF2Matrix& c, const GF2Product& p) {
+    p.evaluateInto(c, true);
+    return c;
+}
+
+GF2Matrix& operator^=(GF2Matrix& c, const GF2ProductSum& s) {
+    s.evaluateInto(c, true);
+    return c;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "GF2Matrix.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class GF2Engine;
+
+// How a product expression is evaluated
+struct GF2ExprOptions {
+    // Routes each plain product to the method its profile picks, and prices
+    // the parenthesizations with its timings; null for the SIMD kernel and
+    // its word-operation count. The accumulating step of ^= always runs the
+    // fused SIMD addMul, which the engine has no counterpart of.
+    GF2Engine* engine = nullptr;
+    int num_threads = 0; // SIMD kernel; <= 0 for the OpenMP default
+};
+
+// A lazy product A0 * A1 * ... * An-1 of matrices, built by operator* (below)
+// and evaluated only when assigned to a matrix. Then the parenthesization
+// comes from the matrix-chain-order recurrence over the operands' real
+// shapes, so A * B * x with x a single column costs two matrix-vector
+// products instead of a full A * B. The expression keeps pointers to its
+// operands: evaluate it in the statement that built it, or keep the
+// operands alive while it exists.
+class GF2Product {
+public:
+    // A chain of one operand
+    GF2Product(const GF2Matrix& a);
+
+    size_t rows() const { return m_dims.front(); }
+    size_t cols() const { return m_dims.back(); }
+    const std::vector<const GF2Matrix*>& operands() const { return m_operands; }
+
+    // Appends the operands of b; throws std::runtime_error if the inner
+    // dimensions do not match
+    GF2Product& operator*=(const GF2Product& b);
+
+    // The cost of the order evaluate() uses, and of plain left to right, in
+    // the units of the model (word operations, or milliseconds with an
+    // engine)
+    double cost(const GF2ExprOptions& options = GF2ExprOptions()) const;
+    double leftToRightCost(const GF2ExprOptions& options = GF2ExprOptions()) const;
+    // The chosen order, operands numbered from 0: "((0 1) 2)"
+    std::string order(const GF2ExprOptions& options = GF2ExprOptions()) const;
+
+    GF2Matrix evaluate(const GF2ExprOptions& options = GF2ExprOptions()) const;
+    // out = the product, or out ^= it with accumulate (out must then have
+    // the product's shape). The last multiply writes or accumulates into out
+    // directly; out may be one of the operands.
+    void evaluateInto(GF2Matrix& out, bool accumulate = false,
+                      const GF2ExprOptions& options = GF2ExprOptions()) const;
+
+    operator GF2Matrix() const { return evaluate(); }
+
+private:
+    struct Plan;
+
+    std::vector<const GF2Matrix*> m_operands;
+    std::vector<size_t> m_dims; // operand i is m_dims[i] x m_dims[i + 1]
+
+    Plan plan(const GF2ExprOptions& options) const;
+};
+
+// A sum (XOR) of products, each evaluated in its own best order and
+// accumulated into the destination by the fused kernel
+class GF2ProductSum {
+public:
+    GF2ProductSum(GF2Product term);
+
+    size_t rows() const { return m_terms.front().rows(); }
+    size_t cols() const { return m_terms.front().cols(); }
+    const std::vector<GF2Product>& terms() const { return m_terms; }
+
+    // Throws std::runtime_error if the shapes differ
+    GF2ProductSum& operator+=(GF2Product term);
+
+    GF2Matrix evaluate(const GF2ExprOptions& options = GF2ExprOptions()) const;
+    void evaluateInto(GF2Matrix& out, bool accumulate = false,
+                      const GF2ExprOptions& options = GF2ExprOptions()) const;
+
+    operator GF2Matrix() const { return evaluate(); }
+
+private:
+    std::vector<GF2Product> m_terms;
+};
+
+GF2Product operator*(const GF2Matrix& a, const GF2Matrix& b);
+GF2Product operator*(GF2Product a, const GF2Matrix& b);
+GF2Product operator*(const GF2Matrix& a, const GF2Product& b);
+GF2Product operator*(GF2Product a, const GF2Product& b);
+
+GF2ProductSum operator+(GF2Product a, GF2Product b);
+GF2ProductSum operator+(GF2ProductSum a, GF2Product b);
+
+// c ^= a * b * ..., fused: the last multiply accumulates into c
+GF2Matrix& operator^=(GF2Matrix& c, const GF2Product& p);
+GF2Matrix& operator^=(GF2Matrix& c, const GF2ProductSum& s);
@@ -0,0 +1,221 @@
+#include "GF2ExtensionMatrix.hpp"
+#include "GF2Kernels.hpp"
+#include <omp.h>
+#include <stdexcept>
+
+namespace {
+
+// p mod q for polynomials over GF(2) as bit masks
+uint32_t poly_mod(uint32_t p, uint32_t q) {
+    const int dq = 31 - __builtin_clz(q);
+    for (int d = p ? 31 - __builtin_clz(p) : -1; d >= dq; --d) {
+        if ((p >> d) & 1) {
+            p ^= q << (d - dq);
+        }
+    }
+    return p;
+}
+
+// No factor of degree 1 to k / 2
+bool irreducible(uint32_t p, unsigned k) {
+    for (uint32_t q = 2; q < (uint32_t(1) << (k / 2 + 1)); ++q) {
+        if (poly_mod(p, q) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// dst ^= src for planes of one shape: their padding is zero, so the whole
+// storage is XORed at once
+void xor_into(GF2Matrix& dst, const GF2Matrix& src) {
+    row_xor(dst.get_raw_data(), src.get_raw_data(), dst.rows() * dst.row_stride());
+}
+
+// r[0 .. 2n - 1) ^= A * B for the polynomials A = sum a[i] x^i and
+// B = sum b[j] x^j of n planes each. With A = lo + x^h hi (h = n / 2) and
+// likewise B, and P0 = lo * lo', P2 = hi * hi', P1 = (lo + hi) * (lo' + hi'):
+// A * B = P0 (1 + x^h) + P1 x^h + P2 (x^h + x^2h).
+void karatsuba(const GF2Matrix* const* a, const GF2Matrix* const* b, size_t n, GF2Matrix* r,
+               const GF2ExtensionMatrix::PlaneProduct& product) {
+    if (n == 1) {
+        product(r[0], *a[0], *b[0]);
+        return;
+    }
+    const size_t h = n / 2, g = n - h;
+    const size_t rows = r[0].rows(), cols = r[0].cols();
+    {
+        std::vector<GF2Matrix> p(2 * h - 1, GF2Matrix(rows, cols));
+        karatsuba(a, b, h, p.data(), product);
+        for (size_t s = 0; s < p.size(); ++s) {
+            xor_into(r[s], p[s]);
+            xor_into(r[s + h], p[s]);
+        }
+    }
+    {
+        std::vector<GF2Matrix> p(2 * g - 1, GF2Matrix(rows, cols));
+        karatsuba(a + h, b + h, g, p.data(), product);
+        for (size_t s = 0; s < p.size(); ++s) {
+            xor_into(r[s + h], p[s]);
+            xor_into(r[s + 2 * h], p[s]);
+        }
+    }
+    // The high halves have g >= h planes; the low ones are added to the first h
+    std::vector<GF2Matrix> sa, sb;
+    std::vector<const GF2Matrix*> pa(g), pb(g);
+    sa.reserve(g);
+    sb.reserve(g);
+    for (size_t i = 0; i < g; ++i) {
+        sa.push_back(*a[h + i]);
+        sb.push_back(*b[h + i]);
+        if (i < h) {
+            xor_into(sa[i], *a[i]);
+            xor_into(sb[i], *b[i]);
+        }
+        pa[i] = &sa[i];
+        pb[i] = &sb[i];
+    }
+    karatsuba(pa.data(), pb.data(), g, r + h, product);
+}
+
+int resolve_threads(int num_threads) {
+    return num_threads > 0 ? num_threads : omp_get_max_threads();
+}
+
+} // namespace
+
+uint32_t GF2ExtensionMatrix::defaultPolynomial(unsigned k) {
+    static const uint32_t polynomials[MAX_DEGREE + 1] = {
+        0,     0x3,    0x7,    0xB,    0x13,   0x25,   0x43,   0x89,   0x11D,
+        0x211, 0x409,  0x805,  0x1053, 0x201B, 0x4443, 0x8003, 0x1100B};
+    if (k == 0 || k > MAX_DEGREE) {
+        throw std::runtime_error("GF(2^k) degree must be between 1 and 16");
+    }
+    return polynomials[k];
+}
+
+GF2ExtensionMatrix::GF2ExtensionMatrix(size_t rows, size_t cols, unsigned k,
+                                       uint32_t polynomial)
+    : m_rows(rows), m_cols(cols), m_degree(k),
+      m_polynomial(polynomial ? polynomial : defaultPolynomial(k)) {
+    if (k == 0 || k > MAX_DEGREE) {
+        throw std::runtime_error("GF(2^k) degree must be between 1 and 16");
+    }
+    if ((m_polynomial >> k) != 1 || !irreducible(m_polynomial, k)) {
+        throw std::runtime_error("Field polynomial must be irreducible of degree k");
+    }
+    m_planes.assign(k, GF2Matrix(rows, cols));
+}
+
+uint32_t GF2ExtensionMatrix::get(size_t row, size_t col) const {
+    uint32_t value = 0;
+    for (unsigned b = 0; b < m_degree; ++b) {
+        value |= uint32_t(m_planes[b].get(row, col)) << b;
+    }
+    return value;
+}
+
+void GF2ExtensionMatrix::set(size_t row, size_t col, uint32_t value) {
+    if ((value >> m_degree) != 0) {
+        throw std::runtime_error("Element outside the field");
+    }
+    for (unsigned b = 0; b < m_degree; ++b) {
+        m_planes[b].set(row, col, (value >> b) & 1);
+    }
+}
+
+void GF2ExtensionMatrix::randomFill(uint64_t seed, int num_threads) {
+    for (unsigned b = 0; b < m_degree; ++b) {
+        m_planes[b].randomFill(seed + b, num_threads);
+    }
+}
+
+uint32_t GF2ExtensionMatrix::multiplyElements(uint32_t a, uint32_t b) const {
+    uint32_t r = 0;
+    for (unsigned i = 0; i < m_degree; ++i) {
+        if ((b >> i) & 1) {
+            r ^= a << i;
+        }
+    }
+    for (unsigned s = 2 * m_degree - 1; s-- > m_degree;) {
+        if ((r >> s) & 1) {
+            r ^= m_polynomial << (s - m_degree);
+        }
+    }
+    return r;
+}
+
+void GF2ExtensionMatrix::checkProduct(const GF2ExtensionMatrix& other) const {
+    if (m_cols != other.m_rows) {
+        throw std::runtime_error("Matrix dimensions incompatible for multiplication");
+    }
+    if (m_degree != other.m_degree || m_polynomial != other.m_polynomial) {
+        throw std::runtime_error("Matrices over different fields");
+    }
+}
+
+GF2ExtensionMatrix GF2ExtensionMatrix::multiply(const GF2ExtensionMatrix& other,
+                                                int num_threads) const {
+    const int threads = resolve_threads(num_threads);
+    GF2Workspace ws;
+    return multiply(other, [&](GF2Matrix& c, const GF2Matrix& a, const GF2Matrix& b) {
+        GF2Matrix::addMul(c, a, b, ws, threads);
+    });
+}
+
+GF2ExtensionMatrix GF2ExtensionMatrix::multiply(const GF2ExtensionMatrix& other,
+                                                GF2Backend& backend, GF2Kernel kernel) const {
+    GF2Matrix scratch(m_rows, other.m_cols);
+    return multiply(other, [&](GF2Matrix& c, const GF2Matrix& a, const GF2Matrix& b) {
+        backend.multiply(kernel, a, b, scratch);
+        xor_into(c, scratch);
+    });
+}
+
+// The 2k - 1 product planes are reduced from the top: x^s for s >= k is
+// x^(s - k) times the polynomial's terms below x^k
+GF2ExtensionMatrix GF2ExtensionMatrix::multiply(const GF2ExtensionMatrix& other,
+                                                const PlaneProduct& product) const {
+    checkProduct(other);
+    const unsigned k = m_degree;
+    std::vector<GF2Matrix> planes(2 * k - 1, GF2Matrix(m_rows, other.m_cols));
+    std::vector<const GF2Matrix*> a(k), b(k);
+    for (unsigned i = 0; i < k; ++i) {
+        a[i] = &m_planes[i];
+        b[i] = &other.m_planes[i];
+    }
+    karatsuba(a.data(), b.data(), k, planes.data(), product);
+    for (size_t s = 2 * k - 2; s >= k; --s) {
+        for (unsigned t = 0; t < k; ++t) {
+            if ((m_polynomial >> t) & 1) {
+                xor_into(planes[s - k + t], planes[s]);
+            }
+        }
+    }
+
+    GF2ExtensionMatrix result(m_rows, other.m_cols, k, m_polynomial);
+    for (unsigned i = 0; i < k; ++i) {
+        result.m_planes[i] = std::move(planes[i]);
+    }
+    return result;
+}
+
+GF2ExtensionMatrix GF2ExtensionMatrix::multiplySerial(const GF2ExtensionMatrix& other) const {
+    checkProduct(other);
+    GF2ExtensionMatrix result(m_rows, other.m_cols, m_degree, m_polynomial);
+    for (size_t i = 0; i < m_rows; ++i) {
+        for (size_t j = 0; j < other.m_cols; ++j) {
+            uint32_t sum = 0;
+            for (size_t p = 0; p < m_cols; ++p) {
+                sum ^= multiplyElements(get(i, p), other.get(p, j));
+            }
+            result.set(i, j, sum);
+        }
+    }
+    return result;
+}
+
+bool GF2ExtensionMatrix::operator==(const GF2ExtensionMatrix& other) const {
+    return m_rows == other.m_rows && m_cols == other.m_cols && m_degree == other.m_degree &&
+           m_polynomial == other.m_polynomial && m_planes == other.m_planes;
+}
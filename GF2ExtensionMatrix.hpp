@@ -0,0 +1,83 @@
+#pragma once
+
+#include "GF2Backend.hpp"
+#include "GF2Matrix.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// A matrix over GF(2^k), 1 <= k <= 16, stored bitsliced: plane b is the
+// GF2Matrix of bit b of every element, the coefficient of x^b of the
+// element as a polynomial modulo the field polynomial. A product of two
+// such matrices is a product of polynomials whose coefficients are GF(2)
+// matrices, so every kernel of GF2Matrix and of the GPU backends applies
+// to extension fields unchanged:
+//   - the plane products are split Karatsuba-style, 3 half-size products
+//     for 4, so that GF(2^8) takes 27 GF(2) products instead of 64 and
+//     GF(2^16) 81 instead of 256;
+//   - the 2k - 1 planes of the product are reduced modulo the field
+//     polynomial by plane XORs, from the top plane down.
+class GF2ExtensionMatrix {
+public:
+    static constexpr unsigned MAX_DEGREE = 16;
+
+    // c ^= a * b over GF(2), for c of a.rows() x b.cols()
+    using PlaneProduct = std::function<void(GF2Matrix& c, const GF2Matrix& a,
+                                            const GF2Matrix& b)>;
+
+    // A primitive polynomial of degree k (bit i the coefficient of x^i):
+    // 0x11D for GF(2^8) and 0x1100B for GF(2^16), the usual choices of
+    // Reed-Solomon codes. Throws std::runtime_error if k is out of range.
+    static uint32_t defaultPolynomial(unsigned k);
+
+    // An all-zero matrix. polynomial 0 takes defaultPolynomial(k); any other
+    // must be irreducible of degree k. Throws std::runtime_error otherwise.
+    GF2ExtensionMatrix(size_t rows, size_t cols, unsigned k, uint32_t polynomial = 0);
+
+    size_t rows() const { return m_rows; }
+    size_t cols() const { return m_cols; }
+    unsigned degree() const { return m_degree; }
+    uint32_t polynomial() const { return m_polynomial; }
+
+    // Bit b of every element, b < degree()
+    const GF2Matrix& plane(unsigned b) const { return m_planes[b]; }
+    GF2Matrix& plane(unsigned b) { return m_planes[b]; }
+
+    // Elements as integers below 2^degree(); set throws std::runtime_error
+    // for indices or values out of range
+    uint32_t get(size_t row, size_t col) const;
+    void set(size_t row, size_t col, uint32_t value);
+
+    // Independent random planes (GF2Matrix::randomFill with seed + b)
+    void randomFill(uint64_t seed, int num_threads = 0);
+
+    // a * b in the field
+    uint32_t multiplyElements(uint32_t a, uint32_t b) const;
+
+    // this * other, the plane products fused into the accumulating SIMD
+    // multiply (GF2Matrix::addMul) on num_threads threads (<= 0 for the
+    // OpenMP default)
+    GF2ExtensionMatrix multiply(const GF2ExtensionMatrix& other, int num_threads = 0) const;
+    // The same with the plane products on a GPU backend, each into a
+    // scratch plane that is then XORed in
+    GF2ExtensionMatrix multiply(const GF2ExtensionMatrix& other, GF2Backend& backend,
+                                GF2Kernel kernel = GF2Kernel::M4R) const;
+    // The same with any GF(2) product
+    GF2ExtensionMatrix multiply(const GF2ExtensionMatrix& other,
+                                const PlaneProduct& product) const;
+    // Element by element with multiplyElements, as a reference
+    GF2ExtensionMatrix multiplySerial(const GF2ExtensionMatrix& other) const;
+
+    bool operator==(const GF2ExtensionMatrix& other) const;
+
+private:
+    size_t m_rows;
+    size_t m_cols;
+    unsigned m_degree;
+    uint32_t m_polynomial;
+    std::vector<GF2Matrix> m_planes;
+
+    // Throws std::runtime_error if the shapes or fields differ
+    void checkProduct(const GF2ExtensionMatrix& other) const;
+};
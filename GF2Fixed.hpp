@@ -0,0 +1,201 @@
+#pragma once
+
+#include "GF2Matrix.hpp"
+#include "GF2Kernels.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+// An R x C matrix whose shape is fixed at compile time, stored inline
+// (rows of (C + 63) / 64 words, no heap and no row padding), for the many
+// small products of block ciphers and of the inner steps of block Lanczos.
+// Every loop bound is a constant, so the compiler unrolls and vectorizes the
+// kernels; a 64 x 64 product takes under a microsecond. As in
+// GF2Matrix, the bits past the last column are kept zero.
+template <size_t R, size_t C>
+class GF2Fixed {
+public:
+    static constexpr size_t WORDS = (C + 63) / 64;
+
+    // All zero
+    GF2Fixed() = default;
+
+    // Copy of m; throws std::runtime_error if its shape is not R x C
+    explicit GF2Fixed(const GF2Matrix& m) {
+        if (m.rows() != R || m.cols() != C) {
+            throw std::runtime_error("Matrix shape does not match the fixed size");
+        }
+        for (size_t i = 0; i < R; ++i) {
+            const uint64_t* src = m.get_raw_data() + i * m.row_stride();
+            for (size_t w = 0; w < WORDS; ++w) {
+                m_data[i * WORDS + w] = src[w];
+            }
+        }
+    }
+
+    GF2Matrix toMatrix() const {
+        GF2Matrix m(R, C);
+        for (size_t i = 0; i < R; ++i) {
+            uint64_t* dst = m.get_raw_data() + i * m.row_stride();
+            for (size_t w = 0; w < WORDS; ++w) {
+                dst[w] = m_data[i * WORDS + w];
+            }
+        }
+        return m;
+    }
+
+    static GF2Fixed identity() {
+        static_assert(R == C, "Only square matrices have an identity");
+        GF2Fixed m;
+        for (size_t i = 0; i < R; ++i) {
+            m.m_data[i * WORDS + i / 64] = uint64_t(1) << (i % 64);
+        }
+        return m;
+    }
+
+    static constexpr size_t rows() { return R; }
+    static constexpr size_t cols() { return C; }
+    // Row i is row(i)[0, WORDS)
+    const uint64_t* row(size_t i) const { return m_data.data() + i * WORDS; }
+    uint64_t* row(size_t i) { return m_data.data() + i * WORDS; }
+
+    bool get(size_t row, size_t col) const {
+        return (m_data[row * WORDS + col / 64] >> (col % 64)) & 1;
+    }
+    void set(size_t row, size_t col, bool value) {
+        const uint64_t bit = uint64_t(1) << (col % 64);
+        uint64_t& word = m_data[row * WORDS + col / 64];
+        word = value ? word | bit : word & ~bit;
+    }
+
+    // this * b by Four Russians on nibbles. For each word of A, the 16
+    // groups of four rows of B it covers give 16-entry tables of their
+    // combinations (one XOR per entry); each row of the product then adds
+    // one entry per nibble of that word, in registers. Below 16 rows the
+    // tables cost more than they save, and the rows of B are added under a
+    // bit mask instead.
+    template <size_t N>
+    GF2Fixed<R, N> multiply(const GF2Fixed<C, N>& b) const {
+        constexpr size_t NW = GF2Fixed<C, N>::WORDS;
+        GF2Fixed<R, N> c;
+        uint64_t* out = c.row(0);
+        if constexpr (R < 16) {
+            for (size_t k = 0; k < C; ++k) {
+                const uint64_t* b_row = b.row(k);
+                for (size_t i = 0; i < R; ++i) {
+                    const uint64_t mask = 0 - ((m_data[i * WORDS + k / 64] >> (k % 64)) & 1);
+                    for (size_t j = 0; j < NW; ++j) {
+                        out[i * NW + j] ^= mask & b_row[j];
+                    }
+                }
+            }
+        } else {
+            uint64_t tables[16][16 * NW];
+            for (size_t w = 0; w < WORDS; ++w) {
+                for (size_t g = 0; g < 16; ++g) {
+                    uint64_t* table = tables[g];
+                    for (size_t j = 0; j < NW; ++j) {
+                        table[j] = 0;
+                    }
+                    for (size_t e = 1; e < 16; ++e) {
+                        // Entry e is entry e without its lowest bit plus that
+                        // row. Rows past C are left out: A's bits past C are
+                        // zero, so the entries that would hold them are
+                        // never picked.
+                        const size_t k = w * 64 + g * 4 + size_t(__builtin_ctzll(e));
+                        const uint64_t* prev = table + (e & (e - 1)) * NW;
+                        for (size_t j = 0; j < NW; ++j) {
+                            table[e * NW + j] = prev[j] ^ (k < C ? b.row(k)[j] : 0);
+                        }
+                    }
+                }
+                for (size_t i = 0; i < R; ++i) {
+                    const uint64_t a_word = m_data[i * WORDS + w];
+                    for (size_t j = 0; j < NW; ++j) {
+                        uint64_t acc = 0;
+                        for (size_t g = 0; g < 16; ++g) {
+                            acc ^= tables[g][((a_word >> (4 * g)) & 15) * NW + j];
+                        }
+                        out[i * NW + j] ^= acc;
+                    }
+                }
+            }
+        }
+        return c;
+    }
+
+    // By 64 x 64 blocks (transpose_64x64)
+    GF2Fixed<C, R> transpose() const {
+        constexpr size_t RW = GF2Fixed<C, R>::WORDS;
+        GF2Fixed<C, R> t;
+        alignas(64) uint64_t block[64];
+        for (size_t bi = 0; bi < RW; ++bi) {
+            for (size_t bj = 0; bj < WORDS; ++bj) {
+                for (size_t r = 0; r < 64; ++r) {
+                    block[r] = bi * 64 + r < R ? m_data[(bi * 64 + r) * WORDS + bj] : 0;
+                }
+                transpose_64x64(block);
+                for (size_t c = 0; c < 64 && bj * 64 + c < C; ++c) {
+                    t.row(bj * 64 + c)[bi] = block[c];
+                }
+            }
+        }
+        return t;
+    }
+
+    // Gauss-Jordan elimination on [this | I] with branch-free row updates;
+    // throws std::runtime_error if the matrix is singular
+    GF2Fixed inverse() const {
+        static_assert(R == C, "Only square matrices have an inverse");
+        GF2Fixed a = *this;
+        GF2Fixed inv = identity();
+        for (size_t col = 0; col < C; ++col) {
+            const size_t w = col / 64;
+            const uint64_t bit = uint64_t(1) << (col % 64);
+            size_t pivot = col;
+            while (pivot < R && !(a.m_data[pivot * WORDS + w] & bit)) {
+                ++pivot;
+            }
+            if (pivot == R) {
+                throw std::runtime_error("Matrix is singular");
+            }
+            if (pivot != col) {
+                for (size_t j = 0; j < WORDS; ++j) {
+                    std::swap(a.m_data[pivot * WORDS + j], a.m_data[col * WORDS + j]);
+                    std::swap(inv.m_data[pivot * WORDS + j], inv.m_data[col * WORDS + j]);
+                }
+            }
+            // Copies, so the row updates below do not alias them
+            uint64_t a_pivot[WORDS], inv_pivot[WORDS];
+            for (size_t j = 0; j < WORDS; ++j) {
+                a_pivot[j] = a.m_data[col * WORDS + j];
+                inv_pivot[j] = inv.m_data[col * WORDS + j];
+            }
+            // Every row with the bit, the pivot row included, which is then
+            // put back
+            for (size_t i = 0; i < R; ++i) {
+                const uint64_t mask = 0 - ((a.m_data[i * WORDS + w] >> (col % 64)) & 1);
+                for (size_t j = 0; j < WORDS; ++j) {
+                    a.m_data[i * WORDS + j] ^= mask & a_pivot[j];
+                    inv.m_data[i * WORDS + j] ^= mask & inv_pivot[j];
+                }
+            }
+            for (size_t j = 0; j < WORDS; ++j) {
+                a.m_data[col * WORDS + j] = a_pivot[j];
+                inv.m_data[col * WORDS + j] = inv_pivot[j];
+            }
+        }
+        return inv;
+    }
+
+    bool operator==(const GF2Fixed& other) const { return m_data == other.m_data; }
+    bool operator!=(const GF2Fixed& other) const { return m_data != other.m_data; }
+
+private:
+    template <size_t, size_t>
+    friend class GF2Fixed;
+
+    std::array<uint64_t, R * WORDS> m_data{};
+};
@@ -1,448 +1,3289 @@
 #include "GF2GPU.hpp"
+#include "GF2Kernels.hpp"
+#include "GF2Metrics.hpp"
+#include "GF2TiledMatrix.hpp"
+#include "GF2Trace.hpp"
+#include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <cstdlib>
 #include <cstring>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+
+namespace {
+
+// Copies the rows of m into a buffer with the given row stride, zeroing the
+// padding words
+void pack_rows(const GF2Matrix &m, uint64_t *dst, size_t dst_stride) {
+  if (m.row_stride() == dst_stride) {
+    memcpy(dst, m.get_raw_data(), m.rows() * dst_stride * sizeof(uint64_t));
+    return;
+  }
+  for (size_t r = 0; r < m.rows(); ++r) {
+    uint64_t *row = dst + r * dst_stride;
+    memcpy(row, m.get_raw_data() + r * m.row_stride(),
+           m.words_per_row() * sizeof(uint64_t));
+    memset(row + m.words_per_row(), 0,
+           (dst_stride - m.words_per_row()) * sizeof(uint64_t));
+  }
+}
+
+void unpack_rows(const uint64_t *src, size_t src_stride, GF2Matrix &m) {
+  for (size_t r = 0; r < m.rows(); ++r) {
+    memcpy(m.get_raw_data() + r * m.row_stride(), src + r * src_stride,
+           m.words_per_row() * sizeof(uint64_t));
+  }
+}
+
+// GF2_PIPELINE_ARCHIVE, or a file in the temp directory
+std::string pipeline_archive_path() {
+  if (const char *path = std::getenv("GF2_PIPELINE_ARCHIVE")) {
+    return path;
+  }
+  const char *tmp = std::getenv("TMPDIR");
+  std::string dir = tmp && *tmp ? tmp : "/tmp";
+  if (dir.back() != '/') {
+    dir += '/';
+  }
+  return dir + "gf2_pipelines.binarchive";
+}
+
+// GF2_GPU_TUNE=0 turns the launch tuning off
+bool launch_tuning_enabled() {
+  const char *value = std::getenv("GF2_GPU_TUNE");
+  return !value || std::string(value) != "0";
+}
+
+// Bucket of a grid dimension for the launch cache: ceil(log2(n))
+uint32_t size_class(size_t n) {
+  uint32_t c = 0;
+  while ((size_t(1) << c) < n) {
+    ++c;
+  }
+  return c;
+}
+
+// GF2_GPU_STORAGE=shared or private, else private buffers for discrete GPUs
+GF2GPU::Storage default_storage(MTL::Device *device) {
+  if (const char *value = std::getenv("GF2_GPU_STORAGE")) {
+    if (std::string(value) == "shared") {
+      return GF2GPU::Storage::Shared;
+    }
+    if (std::string(value) == "private") {
+      return GF2GPU::Storage::Private;
+    }
+  }
+  return device->hasUnifiedMemory() ? GF2GPU::Storage::Shared
+                                    : GF2GPU::Storage::Private;
+}
+
+// Counted captureOperation operations running on this thread: the ones they
+// call are not counted
+thread_local int capture_depth = 0;
+
+// GF2_GPU_CAPTURE=<operation>[:<iteration>], the iteration 1 if absent
+bool capture_request(std::string &operation, size_t &iteration) {
+  const char *value = std::getenv("GF2_GPU_CAPTURE");
+  if (!value || !*value) {
+    return false;
+  }
+  operation = value;
+  iteration = 1;
+  const size_t colon = operation.find(':');
+  if (colon != std::string::npos) {
+    const std::string count = operation.substr(colon + 1);
+    operation.resize(colon);
+    char *end = nullptr;
+    iteration = std::strtoul(count.c_str(), &end, 10);
+    if (count.empty() || *end != '\0' || iteration == 0) {
+      throw std::runtime_error("GF2_GPU_CAPTURE iteration must be a positive "
+                               "integer: " + count);
+    }
+  }
+  return true;
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+size_t default_stride(size_t cols) {
+  const size_t align = GF2Matrix::ROW_ALIGN_WORDS;
+  return ((cols + 63) / 64 + align - 1) / align * align;
+}
+
+size_t round_up(size_t value, size_t multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+// pack_rows into a block of 'rows' rows, the rows past m's zeroed
+void pack_padded(const GF2Matrix &m, uint64_t *dst, size_t dst_stride,
+                 size_t rows) {
+  pack_rows(m, dst, dst_stride);
+  memset(dst + m.rows() * dst_stride, 0,
+         (rows - m.rows()) * dst_stride * sizeof(uint64_t));
+}
+
+// Temporaries of the GPU Strassen levels, as in GF2MatrixStrassen.cpp: per
+// level X0 (sums of A quadrants, later P1) and X1 (sums of B quadrants)
+size_t strassen_level_words(size_t m, size_t k_words, size_t n_words) {
+  return (m / 2) * std::max(k_words / 2, n_words / 2) +
+         (k_words / 2) * 64 * (n_words / 2);
+}
+
+size_t strassen_scratch_words(size_t m, size_t k_words, size_t n_words,
+                              int levels) {
+  size_t words = 0;
+  for (int l = 0; l < levels; ++l) {
+    words += strassen_level_words(m, k_words, n_words);
+    m /= 2;
+    k_words /= 2;
+    n_words /= 2;
+  }
+  return words;
+}
+
+} // namespace
 
 // Constructor with correct initializer list order
 GF2GPU::GF2GPU(MTL::Device *device)
-    : _device(device), _commandQueue(nullptr), _computePipeline(nullptr),
-      _computePipelineTransposed(nullptr), _computePipelineTiled(nullptr),
-      _computePipelineVectorized(nullptr),
-      // --- NEW: Initialize M4R pipeline pointers ---
-      _computePipelineM4R_MakeTable(nullptr),
-      _computePipelineM4R_Multiply(nullptr)
+    : _device(device), _commandQueue(nullptr), _library(nullptr),
+      _archive(nullptr), _archiveURL(nullptr), _archiveDirty(false),
+      _bufferPool(device), _inFlight(0), _hybridGpuShare(0.5),
+      _launchTuning(launch_tuning_enabled()), _storage(default_storage(device)),
+      _peakAllocated(0), _chain(nullptr), _captureArmed(false)
 {
+  if (_device)
+    _device->retain();
   setupPipeline();
+  std::string operation;
+  size_t iteration = 0;
+  if (capture_request(operation, iteration)) {
+    const char *path = std::getenv("GF2_GPU_CAPTURE_PATH");
+    captureOperation(operation, iteration, path ? path : "");
+  }
+}
+
+std::vector<std::unique_ptr<GF2GPU>> GF2GPU::createAll() {
+  std::vector<std::unique_ptr<GF2GPU>> gpus;
+  MTL::Device *primary = MTL::CreateSystemDefaultDevice();
+  if (primary) {
+    gpus.push_back(std::make_unique<GF2GPU>(primary));
+  }
+  NS::Array *devices = MTL::CopyAllDevices();
+  for (NS::UInteger i = 0; devices && i < devices->count(); ++i) {
+    MTL::Device *device = devices->object<MTL::Device>(i);
+    if (device != primary) {
+      gpus.push_back(std::make_unique<GF2GPU>(device));
+    }
+  }
+  if (devices)
+    devices->release();
+  if (primary)
+    primary->release(); // the backends hold their own references
+  return gpus;
 }
 
 GF2GPU::~GF2GPU() {
-  if (_computePipeline)
-    _computePipeline->release();
-  if (_computePipelineTransposed)
-    _computePipelineTransposed->release();
-  if (_computePipelineTiled)
-    _computePipelineTiled->release();
-  if (_computePipelineVectorized)
-    _computePipelineVectorized->release();
-  // --- NEW: Release M4R pipeline states ---
-  if (_computePipelineM4R_MakeTable)
-    _computePipelineM4R_MakeTable->release();
-  if (_computePipelineM4R_Multiply)
-    _computePipelineM4R_Multiply->release();
+  try {
+    flush();
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+  }
+  // Completion handlers of async submissions still use the pool
+  waitUntilIdle();
+  _bufferPool.clear();
+  for (auto &entry : _pipelines) {
+    if (entry.second)
+      entry.second->release();
+  }
+  saveArchive();
+  if (_archive)
+    _archive->release();
+  if (_archiveURL)
+    _archiveURL->release();
+  if (_library)
+    _library->release();
   if (_commandQueue)
     _commandQueue->release();
+  if (_device)
+    _device->release();
 }
 
+// Loads the library and opens the pipeline archive. The pipelines themselves
+// are created on first use, see namedPipeline().
 void GF2GPU::setupPipeline() {
+  _library = _device->newDefaultLibrary();
+  if (!_library) {
+    std::cerr << "Failed to load Metal library" << std::endl;
+  }
+
+  _commandQueue = _device->newCommandQueue();
+  if (!_commandQueue) {
+    std::cerr << "Failed to create command queue" << std::endl;
+  }
+
+  const std::string path = pipeline_archive_path();
+  if (path.empty()) {
+    return;
+  }
+  _archiveURL = NS::URL::fileURLWithPath(
+      NS::String::string(path.c_str(), NS::UTF8StringEncoding));
+  _archiveURL->retain();
+
+  // An archive is opened from an existing file or created empty
   NS::Error *error = nullptr;
+  MTL::BinaryArchiveDescriptor *descriptor =
+      MTL::BinaryArchiveDescriptor::alloc()->init();
+  if (std::ifstream(path).good()) {
+    descriptor->setUrl(_archiveURL);
+  }
+  _archive = _device->newBinaryArchive(descriptor, &error);
+  if (!_archive && std::ifstream(path).good()) {
+    // Unreadable or stale file: start over with an empty archive
+    descriptor->setUrl(nullptr);
+    error = nullptr;
+    _archive = _device->newBinaryArchive(descriptor, &error);
+  }
+  descriptor->release();
+  if (!_archive) {
+    std::cerr << "Failed to create Metal binary archive";
+    if (error)
+      std::cerr << ": " << error->localizedDescription()->utf8String();
+    std::cerr << std::endl;
+  }
+}
 
-  MTL::Library *library = _device->newDefaultLibrary();
-  if (!library) {
-    std::cerr << "Failed to load Metal library" << std::endl;
+void GF2GPU::saveArchive() {
+  if (!_archive || !_archiveDirty) {
     return;
   }
+  NS::Error *error = nullptr;
+  if (!_archive->serializeToURL(_archiveURL, &error)) {
+    std::cerr << "Failed to write Metal binary archive";
+    if (error)
+      std::cerr << ": " << error->localizedDescription()->utf8String();
+    std::cerr << std::endl;
+  }
+  _archiveDirty = false;
+}
 
-  // --- Setup for original kernel ---
-  auto functionName =
-      NS::String::string("gf2_multiply_batch", NS::ASCIIStringEncoding);
-  MTL::Function *kernelFunction = library->newFunction(functionName);
-  if (kernelFunction) {
-    _computePipeline = _device->newComputePipelineState(kernelFunction, &error);
-    if (!_computePipeline)
-      std::cerr << "Failed to create pipeline for original kernel: "
-                << error->localizedDescription()->utf8String() << std::endl;
-    kernelFunction->release();
-  } else {
-    std::cerr << "Failed to load kernel function: gf2_multiply_batch"
-              << std::endl;
-  }
-
-  // --- Setup for transposed kernel ---
-  auto functionNameTransposed = NS::String::string(
-      "gf2_multiply_transposed_batch", NS::ASCIIStringEncoding);
-  MTL::Function *kernelFunctionTransposed =
-      library->newFunction(functionNameTransposed);
-  if (kernelFunctionTransposed) {
-    _computePipelineTransposed =
-        _device->newComputePipelineState(kernelFunctionTransposed, &error);
-    if (!_computePipelineTransposed)
-      std::cerr << "Failed to create pipeline for transposed kernel: "
-                << error->localizedDescription()->utf8String() << std::endl;
-    kernelFunctionTransposed->release();
-  } else {
-    std::cerr << "Failed to load kernel function: gf2_multiply_transposed_batch"
-              << std::endl;
-  }
-
-  // --- Setup for tiled kernel ---
-  auto functionNameTiled =
-      NS::String::string("gf2_multiply_tiled_kernel", NS::ASCIIStringEncoding);
-  MTL::Function *kernelFunctionTiled = library->newFunction(functionNameTiled);
-  if (kernelFunctionTiled) {
-    _computePipelineTiled =
-        _device->newComputePipelineState(kernelFunctionTiled, &error);
-    if (!_computePipelineTiled)
-      std::cerr << "Failed to create pipeline for tiled kernel: "
-                << error->localizedDescription()->utf8String() << std::endl;
-    kernelFunctionTiled->release();
-  } else {
-    std::cerr << "Failed to load kernel function: gf2_multiply_tiled_kernel"
-              << std::endl;
-  }
-
-  // --- Setup for vectorized kernel ---
-  auto functionNameVectorized = NS::String::string(
-      "gf2_multiply_vectorized_batch", NS::ASCIIStringEncoding);
-  MTL::Function *kernelFunctionVectorized =
-      library->newFunction(functionNameVectorized);
-  if (kernelFunctionVectorized) {
-    _computePipelineVectorized =
-        _device->newComputePipelineState(kernelFunctionVectorized, &error);
-    if (!_computePipelineVectorized)
-      std::cerr << "Failed to create pipeline for vectorized kernel: "
-                << error->localizedDescription()->utf8String() << std::endl;
-    kernelFunctionVectorized->release();
-  } else {
-    std::cerr << "Failed to load kernel function: gf2_multiply_vectorized_batch"
-              << std::endl;
-  }
-
-  // --- NEW: Setup for M4R kernels ---
-  auto functionNameM4R_Table =
-      NS::String::string("m4r_make_tables_kernel", NS::ASCIIStringEncoding);
-  MTL::Function *kernelFunctionM4R_Table = library->newFunction(functionNameM4R_Table);
-  if (kernelFunctionM4R_Table) {
-    _computePipelineM4R_MakeTable =
-        _device->newComputePipelineState(kernelFunctionM4R_Table, &error);
-    if (!_computePipelineM4R_MakeTable)
-      std::cerr << "Failed to create pipeline for M4R table kernel: "
-                << error->localizedDescription()->utf8String() << std::endl;
-    kernelFunctionM4R_Table->release();
-  } else {
-    std::cerr << "Failed to load kernel function: m4r_make_tables_kernel"
-              << std::endl;
-  }
-
-  auto functionNameM4R_Mul =
-      NS::String::string("m4r_multiply_kernel", NS::ASCIIStringEncoding);
-  MTL::Function *kernelFunctionM4R_Mul = library->newFunction(functionNameM4R_Mul);
-  if (kernelFunctionM4R_Mul) {
-    _computePipelineM4R_Multiply =
-        _device->newComputePipelineState(kernelFunctionM4R_Mul, &error);
-    if (!_computePipelineM4R_Multiply)
-      std::cerr << "Failed to create pipeline for M4R multiply kernel: "
-                << error->localizedDescription()->utf8String() << std::endl;
-    kernelFunctionM4R_Mul->release();
+// --- Pipelines ---
+
+const char *GF2GPU::kernelFunction(Kernel kernel) {
+  switch (kernel) {
+  case Kernel::Baseline:
+    return "gf2_multiply_batch";
+  case Kernel::Transposed:
+    return "gf2_multiply_transposed_batch";
+  case Kernel::Tiled:
+    return "gf2_multiply_tiled_kernel";
+  case Kernel::Vectorized:
+    return "gf2_multiply_vectorized_batch";
+  case Kernel::SimdGroup:
+    return "gf2_multiply_simdgroup_batch";
+  case Kernel::M4R:
+    return "m4r_multiply_kernel";
+  }
+  return nullptr;
+}
+
+// The pipeline of kernel function 'name', with function constant 0 set to
+// k_words unless it is 0, usable in indirect command buffers if 'indirect'.
+// Created on first use, looked up in the archive.
+MTL::ComputePipelineState *GF2GPU::namedPipeline(const char *name, uint32_t k_words,
+                                                 bool indirect) {
+  std::lock_guard<std::mutex> lock(_pipelineMutex);
+  PipelineKey key(name, k_words, indirect);
+  auto it = _pipelines.find(key);
+  if (it != _pipelines.end()) {
+    return it->second;
+  }
+  MTL::ComputePipelineState *state = createPipeline(name, k_words, indirect);
+  _pipelines[key] = state;
+  return state;
+}
+
+MTL::ComputePipelineState *GF2GPU::createPipeline(const char *name,
+                                                  uint32_t k_words,
+                                                  bool indirect) {
+  if (!_library) {
+    return nullptr;
+  }
+
+  NS::Error *error = nullptr;
+  auto *functionName = NS::String::string(name, NS::ASCIIStringEncoding);
+  MTL::Function *function = nullptr;
+  if (k_words) {
+    MTL::FunctionConstantValues *constants =
+        MTL::FunctionConstantValues::alloc()->init();
+    constants->setConstantValue(&k_words, MTL::DataTypeUInt, 0);
+    function = _library->newFunction(functionName, constants, &error);
+    constants->release();
   } else {
-    std::cerr << "Failed to load kernel function: m4r_multiply_kernel"
-              << std::endl;
+    function = _library->newFunction(functionName);
+  }
+  if (!function) {
+    std::cerr << "Failed to load kernel function: " << name << std::endl;
+    return nullptr;
   }
 
-  _commandQueue = _device->newCommandQueue();
-  if (!_commandQueue) {
-    std::cerr << "Failed to create command queue" << std::endl;
+  MTL::ComputePipelineDescriptor *descriptor =
+      MTL::ComputePipelineDescriptor::alloc()->init();
+  descriptor->setComputeFunction(function);
+  descriptor->setSupportIndirectCommandBuffers(indirect);
+
+  MTL::ComputePipelineState *state = nullptr;
+  if (_archive) {
+    // A hit skips the backend compilation. A miss compiles the pipeline into
+    // the archive, which the destructor writes back.
+    descriptor->setBinaryArchives(NS::Array::array(_archive));
+    state = _device->newComputePipelineState(
+        descriptor, MTL::PipelineOptionFailOnBinaryArchiveMiss, nullptr, &error);
+    if (!state) {
+      error = nullptr;
+      _archiveDirty |= _archive->addComputePipelineFunctions(descriptor, &error);
+    }
+  }
+  if (!state) {
+    error = nullptr;
+    state = _device->newComputePipelineState(descriptor, MTL::PipelineOptionNone,
+                                             nullptr, &error);
+  }
+  if (!state) {
+    std::cerr << "Failed to create pipeline for " << name;
+    if (k_words)
+      std::cerr << " (" << k_words << " words)";
+    if (error)
+      std::cerr << ": " << error->localizedDescription()->utf8String();
+    std::cerr << std::endl;
   }
 
-  library->release();
+  descriptor->release();
+  function->release();
+  return state;
 }
 
-// --- NEW: Implementation for the M4R multiplication method ---
-void GF2GPU::multiplyGPUM4R(const GF2Matrix &a, const GF2Matrix &b,
-                            GF2Matrix &result) {
-  if (a.cols() != b.rows() || !_computePipelineM4R_MakeTable || !_computePipelineM4R_Multiply) {
-    throw std::runtime_error(
-        "Matrix dimensions incompatible or M4R pipelines not ready.");
+MTL::ComputePipelineState *GF2GPU::pipelineFor(Kernel kernel) {
+  if (kernel == Kernel::M4R && !namedPipeline("m4r_make_tables_kernel")) {
+    return nullptr;
   }
+  return namedPipeline(kernelFunction(kernel));
+}
 
-  // --- M4R Constants ---
-  const size_t K_M4R = 8;
-  const size_t TABLE_ROWS = 1 << K_M4R; // 256
-  const size_t CHUNKS_PER_WORD = 64 / K_M4R; // 8
+// The variant of the kernel specialized for k_words common-dimension words if
+// it reads B^T and k_words is one of SPECIALIZED_K_WORDS, else (or if the
+// variant fails to build) the generic pipeline. M4R and the tiled kernel are
+// never recorded, so 'indirect' is for the word kernels only.
+MTL::ComputePipelineState *GF2GPU::pipelineFor(Kernel kernel, size_t k_words,
+                                               bool indirect) {
+  const bool specializable = kernel == Kernel::Transposed ||
+                             kernel == Kernel::Vectorized ||
+                             kernel == Kernel::SimdGroup;
+  if (specializable &&
+      std::find(std::begin(SPECIALIZED_K_WORDS), std::end(SPECIALIZED_K_WORDS),
+                k_words) != std::end(SPECIALIZED_K_WORDS)) {
+    if (auto *specialized =
+            namedPipeline(kernelFunction(kernel), static_cast<uint32_t>(k_words),
+                          indirect)) {
+      return specialized;
+    }
+  }
+  if (indirect) {
+    return namedPipeline(kernelFunction(kernel), 0, true);
+  }
+  return pipelineFor(kernel);
+}
 
-  // --- Buffer and Table Size Calculations ---
-  size_t num_tables = a.words_per_row() * CHUNKS_PER_WORD;
-  size_t table_row_size_words = b.words_per_row();
-  size_t single_table_size_bytes = TABLE_ROWS * table_row_size_words * sizeof(uint64_t);
-  size_t total_table_size_bytes = num_tables * single_table_size_bytes;
+// One encoded (not yet committed) multiply, and what has to happen once the
+// GPU is done with it. The submission owns its buffers: run() and submit()
+// hand them to the GPU with the commit and complete() takes them back, and a
+// submission dropped before its commit, as when encoding throws, returns
+// them to the pool itself.
+struct GF2GPU::Submission {
+  explicit Submission(GF2GPU &owner) : gpu(owner) {}
+  ~Submission() {
+    if (!committed) {
+      gpu.releaseBuffers(*this);
+    }
+  }
+  Submission(const Submission &) = delete;
+  Submission &operator=(const Submission &) = delete;
 
-  size_t buffer_size_a = a.rows() * a.words_per_row() * sizeof(uint64_t);
-  size_t buffer_size_b = b.rows() * b.words_per_row() * sizeof(uint64_t);
-  size_t buffer_size_result = result.rows() * result.words_per_row() * sizeof(uint64_t);
+  GF2GPU &gpu;
+  bool committed = false;
+  MTL::CommandBuffer *commandBuffer = nullptr;
+  GF2Matrix *result = nullptr;
+  MTL::Buffer *resultBuffer = nullptr;
+  // Shared copy of a private resultBuffer (see stageResult)
+  MTL::Buffer *stagedResult = nullptr;
+  // Buffers to release, with the matrix they were made for (null = pooled)
+  std::vector<std::pair<MTL::Buffer *, const GF2Matrix *>> buffers;
+  // Host data the GPU reads (e.g. B^T), kept alive until completion
+  std::vector<std::unique_ptr<GF2Matrix>> temporaries;
+  // Rows of the result the GPU computes (all of them but in hybrid multiplies)
+  size_t resultRows = SIZE_MAX;
+  GF2GPUTiming timing;
+};
 
-  // --- Create Metal Buffers ---
-  auto *bufferA = _device->newBuffer(a.get_raw_data(), buffer_size_a, MTL::ResourceStorageModeShared);
-  auto *bufferB = _device->newBuffer(b.get_raw_data(), buffer_size_b, MTL::ResourceStorageModeShared);
-  auto *bufferResult = _device->newBuffer(buffer_size_result, MTL::ResourceStorageModeShared);
-  auto *bufferLookupTables = _device->newBuffer(total_table_size_bytes, MTL::ResourceStorageModeShared);
+// --- Buffer helpers ---
 
-  GPUParams params;
-  params.a_rows = static_cast<uint32_t>(a.rows());
-  params.a_cols = static_cast<uint32_t>(a.cols());
-  params.b_cols = static_cast<uint32_t>(b.cols());
-  params.words_per_row_a = static_cast<uint32_t>(a.words_per_row());
-  params.words_per_row_b = static_cast<uint32_t>(b.words_per_row());
-  params.words_per_row_result = static_cast<uint32_t>(result.words_per_row());
+// Page-aligned, page-padded matrix storage (see GF2AlignedAllocator) is wrapped
+// in place with newBufferWithBytesNoCopy, so the kernels read the inputs and
+// write the result in the matrix's own memory. Smaller matrices are copied
+// into a pooled buffer.
+MTL::Buffer *GF2GPU::wrapMatrix(const GF2Matrix &m) {
+  size_t bytes = m.page_aligned_bytes();
+  if (bytes == 0) {
+    return nullptr;
+  }
+  return _device->newBuffer(m.get_raw_data(), bytes,
+                            MTL::ResourceStorageModeShared, nullptr);
+}
 
-  auto *paramsBuffer = _device->newBuffer(&params, sizeof(GPUParams), MTL::ResourceStorageModeShared);
+// The buffer is released with the submission; the copy counts as upload time.
+// With private storage the copy goes to a staging buffer and is blitted into
+// a private one, ahead of the work encoded next.
+MTL::Buffer *GF2GPU::uploadMatrix(Submission &sub, const GF2Matrix &m) {
+  const bool stage = staged();
+  MTL::Buffer *buffer = stage ? nullptr : wrapMatrix(m);
+  if (!buffer) {
+    GF2_TRACE_SCOPE("gpu: upload");
+    auto start = std::chrono::steady_clock::now();
+    size_t size = m.rows() * m.row_stride() * sizeof(uint64_t);
+    buffer = _bufferPool.acquire(size);
+    memcpy(buffer->contents(), m.get_raw_data(), size);
+    if (GF2Metrics::enabled()) {
+      GF2Metrics::add(GF2Counter::GpuBytesToDevice, int64_t(size));
+    }
+    if (stage) {
+      sub.buffers.push_back({buffer, nullptr});
+      buffer = stageIn(sub.commandBuffer, buffer, size);
+    }
+    sub.timing.upload_ms += elapsed_ms(start);
+  }
+  sub.buffers.push_back({buffer, &m});
+  return buffer;
+}
 
-  // --- Command Dispatch ---
-  MTL::CommandBuffer *commandBuffer = _commandQueue->commandBuffer();
+MTL::Buffer *GF2GPU::resultBuffer(GF2Matrix &result) {
+  const size_t size = result.rows() * result.row_stride() * sizeof(uint64_t);
+  if (staged()) {
+    return _bufferPool.acquire(size, MTL::StorageModePrivate);
+  }
+  MTL::Buffer *buffer = wrapMatrix(result);
+  if (!buffer) {
+    buffer = _bufferPool.acquire(size);
+  }
+  return buffer;
+}
 
-  // --- Pass 1: Generate Lookup Tables ---
-  MTL::ComputeCommandEncoder *tableEncoder = commandBuffer->computeCommandEncoder();
-  tableEncoder->setComputePipelineState(_computePipelineM4R_MakeTable);
-  tableEncoder->setBuffer(bufferB, 0, 0);
-  tableEncoder->setBuffer(bufferLookupTables, 0, 1);
-  tableEncoder->setBuffer(paramsBuffer, 0, 2);
-
-  MTL::Size tableGridSize = MTL::Size::Make(b.words_per_row(), num_tables, 1);
-  MTL::Size tableGroupSize = MTL::Size::Make(16, 16, 1); // A common, safe threadgroup size
-  tableEncoder->dispatchThreads(tableGridSize, tableGroupSize);
-  tableEncoder->endEncoding();
-
-  // --- Pass 2: Perform Multiplication ---
-  MTL::ComputeCommandEncoder *mulEncoder = commandBuffer->computeCommandEncoder();
-  mulEncoder->setComputePipelineState(_computePipelineM4R_Multiply);
-  mulEncoder->setBuffer(bufferA, 0, 0);
-  mulEncoder->setBuffer(bufferResult, 0, 1);
-  mulEncoder->setBuffer(bufferLookupTables, 0, 2);
-  mulEncoder->setBuffer(paramsBuffer, 0, 3);
-
-  MTL::Size mulGridSize = MTL::Size::Make(a.rows(), result.words_per_row(), 1);
-  MTL::Size mulGroupSize = MTL::Size::Make(16, 16, 1);
-  mulEncoder->dispatchThreads(mulGridSize, mulGroupSize);
-  mulEncoder->endEncoding();
-
-  // --- Finalize ---
-  commandBuffer->commit();
-  commandBuffer->waitUntilCompleted();
+// --- Storage policy ---
 
-  memcpy(const_cast<uint64_t *>(result.get_raw_data()), bufferResult->contents(), buffer_size_result);
+void GF2GPU::setStorage(Storage storage) { _storage = storage; }
 
-  // --- Release Buffers ---
-  bufferA->release();
-  bufferB->release();
-  bufferResult->release();
-  bufferLookupTables->release();
-  paramsBuffer->release();
+MTL::StorageMode GF2GPU::gpuStorage() const {
+  return _storage == Storage::Private ? MTL::StorageModePrivate
+                                      : MTL::StorageModeShared;
 }
 
+// A pooled private buffer filled from the first 'bytes' bytes of a shared one
+// by a blit in commandBuffer
+MTL::Buffer *GF2GPU::stageIn(MTL::CommandBuffer *commandBuffer,
+                             MTL::Buffer *staging, size_t bytes) {
+  MTL::Buffer *buffer = _bufferPool.acquire(bytes, MTL::StorageModePrivate);
+  encodeCopy(commandBuffer, staging, buffer, bytes);
+  return buffer;
+}
 
-// --- The other multiplication methods remain unchanged ---
+// A private result buffer is blitted into a shared one for readResult(), as
+// the last command of the submission
+void GF2GPU::stageResult(Submission &sub) {
+  if (!sub.resultBuffer ||
+      sub.resultBuffer->storageMode() != MTL::StorageModePrivate) {
+    return;
+  }
+  const size_t rows = std::min(sub.resultRows, sub.result->rows());
+  const size_t bytes = rows * sub.result->row_stride() * sizeof(uint64_t);
+  sub.stagedResult = _bufferPool.acquire(bytes);
+  encodeCopy(sub.commandBuffer, sub.resultBuffer, sub.stagedResult, bytes);
+}
 
-void GF2GPU::multiplyGPUVectorized(const GF2Matrix &a, const GF2Matrix &b,
-                                   GF2Matrix &result) {
-  if (a.cols() != b.rows() || !_computePipelineVectorized) {
-    throw std::runtime_error(
-        "Matrix dimensions incompatible or vectorized pipeline not ready.");
+void GF2GPU::encodeCopy(MTL::CommandBuffer *commandBuffer, MTL::Buffer *src,
+                        MTL::Buffer *dst, size_t bytes) {
+  if (bytes == 0) {
+    return;
   }
+  MTL::BlitCommandEncoder *blit = commandBuffer->blitCommandEncoder();
+  blit->copyFromBuffer(src, 0, dst, 0, bytes);
+  blit->endEncoding();
+}
 
-  // This method also relies on the transposed B matrix for coalesced memory
-  // access.
-  GF2Matrix b_t = b.transpose();
+// Blits on a command buffer of its own and waits for it
+void GF2GPU::copyBuffer(MTL::Buffer *src, MTL::Buffer *dst, size_t bytes) {
+  MTL::CommandBuffer *commandBuffer = _commandQueue->commandBuffer();
+  encodeCopy(commandBuffer, src, dst, bytes);
+  commandBuffer->commit();
+  commandBuffer->waitUntilCompleted();
+  if (commandBuffer->status() == MTL::CommandBufferStatusError) {
+    std::string message;
+    if (commandBuffer->error()) {
+      message = commandBuffer->error()->localizedDescription()->utf8String();
+    }
+    throw std::runtime_error("GPU copy failed: " + message);
+  }
+}
 
-  size_t buffer_size_a = a.rows() * a.words_per_row() * sizeof(uint64_t);
-  size_t buffer_size_b_t = b_t.rows() * b_t.words_per_row() * sizeof(uint64_t);
-  size_t buffer_size_result =
-      result.rows() * result.words_per_row() * sizeof(uint64_t);
+// Pooled buffers are not cleared, so only the words the kernels write are
+// copied back; the padding of 'result' stays zero. Wrapped storage already
+// holds the result.
+void GF2GPU::readResult(MTL::Buffer *buffer, GF2Matrix &result, size_t rows) {
+  const uint64_t *src = static_cast<const uint64_t *>(buffer->contents());
+  uint64_t *dst = result.get_raw_data();
+  if (src == dst) {
+    return;
+  }
+  GF2_TRACE_SCOPE("gpu: readback");
+  rows = std::min(rows, result.rows());
+  if (GF2Metrics::enabled()) {
+    GF2Metrics::add(GF2Counter::GpuBytesFromDevice,
+                    int64_t(rows * result.row_stride() * sizeof(uint64_t)));
+  }
+  if (result.words_per_row() == result.row_stride()) {
+    memcpy(dst, src, rows * result.row_stride() * sizeof(uint64_t));
+    return;
+  }
+  for (size_t r = 0; r < rows; ++r) {
+    memcpy(dst + r * result.row_stride(), src + r * result.row_stride(),
+           result.words_per_row() * sizeof(uint64_t));
+  }
+}
 
-  auto *bufferA = _device->newBuffer(a.get_raw_data(), buffer_size_a,
-                                     MTL::ResourceStorageModeShared);
-  auto *bufferB_T = _device->newBuffer(b_t.get_raw_data(), buffer_size_b_t,
-                                       MTL::ResourceStorageModeShared);
-  auto *bufferResult =
-      _device->newBuffer(buffer_size_result, MTL::ResourceStorageModeShared);
+// Releases a buffer from uploadMatrix/resultBuffer for matrix m, or a plain
+// pooled buffer when m is null
+void GF2GPU::releaseBuffer(MTL::Buffer *buffer, const GF2Matrix *m) {
+  if (m && buffer->contents() == m->get_raw_data()) {
+    buffer->release();
+  } else {
+    _bufferPool.recycle(buffer);
+  }
+}
 
+GF2GPU::GPUParams GF2GPU::makeParams(const GF2Matrix &a, size_t b_cols,
+                                     size_t b_stride,
+                                     const GF2Matrix &result) {
   GPUParams params;
   params.a_rows = static_cast<uint32_t>(a.rows());
   params.a_cols = static_cast<uint32_t>(a.cols());
-  params.b_cols = static_cast<uint32_t>(b.cols());
-  params.words_per_row_a = static_cast<uint32_t>(a.words_per_row());
-  params.words_per_row_b = static_cast<uint32_t>(b_t.words_per_row());
-  params.words_per_row_result = static_cast<uint32_t>(result.words_per_row());
+  params.b_cols = static_cast<uint32_t>(b_cols);
+  params.words_per_row_a = static_cast<uint32_t>(a.row_stride());
+  params.words_per_row_b = static_cast<uint32_t>(b_stride);
+  params.words_per_row_result = static_cast<uint32_t>(result.row_stride());
+  return params;
+}
 
-  auto *paramsBuffer = _device->newBuffer(&params, sizeof(GPUParams),
-                                          MTL::ResourceStorageModeShared);
+// --- Submissions ---
 
-  MTL::CommandBuffer *commandBuffer = _commandQueue->commandBuffer();
-  MTL::ComputeCommandEncoder *encoder = commandBuffer->computeCommandEncoder();
+std::shared_ptr<GF2GPU::Submission> GF2GPU::newSubmission() {
+  auto sub = std::make_shared<Submission>(*this);
+  sub->commandBuffer = _commandQueue->commandBuffer();
+  return sub;
+}
 
-  // Set the VECTORIZED compute pipeline
-  encoder->setComputePipelineState(_computePipelineVectorized);
+void GF2GPU::releaseBuffers(Submission &sub) {
+  if (sub.resultBuffer) {
+    releaseBuffer(sub.resultBuffer, sub.result);
+    sub.resultBuffer = nullptr;
+  }
+  if (sub.stagedResult) {
+    _bufferPool.recycle(sub.stagedResult);
+    sub.stagedResult = nullptr;
+  }
+  for (auto &buffer : sub.buffers) {
+    releaseBuffer(buffer.first, buffer.second);
+  }
+  sub.buffers.clear();
+}
 
-  encoder->setBuffer(bufferA, 0, 0);
-  encoder->setBuffer(bufferB_T, 0, 1);
-  encoder->setBuffer(bufferResult, 0, 2);
-  encoder->setBuffer(paramsBuffer, 0, 3);
+// Reads the result back and returns the buffers. Throws if the command
+// buffer failed. Submissions without a result matrix read their output
+// themselves before this.
+void GF2GPU::complete(Submission &sub) {
+  bool failed =
+      sub.commandBuffer->status() == MTL::CommandBufferStatusError;
+  std::string message;
+  if (failed && sub.commandBuffer->error()) {
+    message = sub.commandBuffer->error()->localizedDescription()->utf8String();
+  }
+  if (!failed && sub.result) {
+    auto start = std::chrono::steady_clock::now();
+    readResult(sub.stagedResult ? sub.stagedResult : sub.resultBuffer,
+               *sub.result, sub.resultRows);
+    sub.timing.readback_ms = elapsed_ms(start);
+  }
+  if (!failed) {
+    GF2_TRACE_GPU("gpu: command buffer", sub.commandBuffer->GPUStartTime(),
+                  sub.commandBuffer->GPUEndTime(), sub.commandBuffer->GPUEndTime());
+    sub.timing.gpu_ms = (sub.commandBuffer->GPUEndTime() -
+                         sub.commandBuffer->GPUStartTime()) * 1000.0;
+    std::lock_guard<std::mutex> lock(_timingMutex);
+    _lastTiming = sub.timing;
+    samplePeakAllocated();
+  }
+  releaseBuffers(sub);
+  sub.temporaries.clear();
+  if (failed) {
+    throw std::runtime_error("GPU command buffer failed: " + message);
+  }
+}
 
-  // The dispatch grid is the same as the transposed version.
-  // Each thread computes one uint64_t word of the result.
-  MTL::Size threadsPerGroup = MTL::Size::Make(16, 16, 1);
-  MTL::Size gridSize = MTL::Size::Make(a.rows(), result.words_per_row(), 1);
+void GF2GPU::run(Submission &sub) {
+  const bool metrics = GF2Metrics::enabled();
+  if (metrics) {
+    GF2Metrics::add(GF2Counter::GpuQueueDepth, 1);
+  }
+  sub.committed = true;
+  sub.commandBuffer->commit();
+  {
+    GF2_TRACE_SCOPE("gpu: wait");
+    sub.commandBuffer->waitUntilCompleted();
+  }
+  if (metrics) {
+    GF2Metrics::add(GF2Counter::GpuQueueDepth, -1);
+  }
+  complete(sub);
+}
 
-  encoder->dispatchThreads(gridSize, threadsPerGroup);
-  encoder->endEncoding();
+void GF2GPU::submit(std::shared_ptr<Submission> sub, CompletionHandler done) {
+  {
+    std::lock_guard<std::mutex> lock(_inFlightMutex);
+    ++_inFlight;
+  }
+  const bool metrics = GF2Metrics::enabled();
+  if (metrics) {
+    GF2Metrics::add(GF2Counter::GpuQueueDepth, 1);
+  }
+  sub->commandBuffer->addCompletedHandler(
+      [this, sub, done, metrics](MTL::CommandBuffer *) {
+        if (metrics) {
+          GF2Metrics::add(GF2Counter::GpuQueueDepth, -1);
+        }
+        std::exception_ptr error;
+        try {
+          complete(*sub);
+        } catch (...) {
+          error = std::current_exception();
+        }
+        if (done) {
+          done(error);
+        }
+        std::lock_guard<std::mutex> lock(_inFlightMutex);
+        if (--_inFlight == 0) {
+          _idle.notify_all();
+        }
+      });
+  sub->committed = true;
+  sub->commandBuffer->commit();
+}
 
-  commandBuffer->commit();
-  commandBuffer->waitUntilCompleted();
+GF2GPUTiming GF2GPU::lastTiming() const {
+  std::lock_guard<std::mutex> lock(_timingMutex);
+  return _lastTiming;
+}
 
-  memcpy(const_cast<uint64_t *>(result.get_raw_data()),
-         bufferResult->contents(), buffer_size_result);
+size_t GF2GPU::allocatedBytes() const {
+  return _device->currentAllocatedSize();
+}
 
-  bufferA->release();
-  bufferB_T->release();
-  bufferResult->release();
-  paramsBuffer->release();
+size_t GF2GPU::peakAllocatedBytes() const {
+  std::lock_guard<std::mutex> lock(_timingMutex);
+  return std::max(_peakAllocated, allocatedBytes());
 }
 
-void GF2GPU::multiplyGPU_transposed(const GF2Matrix &a, const GF2Matrix &b,
-                                    GF2Matrix &result) {
-  if (a.cols() != b.rows() || !_computePipelineTransposed) {
+void GF2GPU::resetPeakAllocated() {
+  std::lock_guard<std::mutex> lock(_timingMutex);
+  _peakAllocated = allocatedBytes();
+}
+
+void GF2GPU::samplePeakAllocated() {
+  _peakAllocated = std::max(_peakAllocated, allocatedBytes());
+}
+
+void GF2GPU::waitUntilIdle() {
+  std::unique_lock<std::mutex> lock(_inFlightMutex);
+  _idle.wait(lock, [this] { return _inFlight == 0; });
+}
+
+// --- Captures ---
+
+void GF2GPU::captureOperation(const std::string &operation, size_t iteration,
+                              const std::string &path) {
+  if (operation.empty() || iteration == 0) {
+    throw std::runtime_error("GPU capture needs an operation and an "
+                             "iteration from 1");
+  }
+  auto request = std::make_unique<CaptureRequest>();
+  request->operation = operation;
+  request->iteration = iteration;
+  request->path = path.empty() ? "gf2_" + operation + "_" +
+                                     std::to_string(iteration) + ".gputrace"
+                               : path;
+  request->calls = 0;
+  std::lock_guard<std::mutex> lock(_captureMutex);
+  _capture = std::move(request);
+  _captureArmed.store(true, std::memory_order_relaxed);
+}
+
+// Counts the call and, on the requested one, spends the request and starts
+// capturing the queue: every command buffer committed to it until
+// endCapture, including those of the operations the captured one calls
+GF2GPU *GF2GPU::beginCapture(const char *operation, bool &capturing) {
+  if (capture_depth > 0) {
+    return nullptr;
+  }
+  std::unique_ptr<CaptureRequest> request;
+  {
+    std::lock_guard<std::mutex> lock(_captureMutex);
+    if (_capture && _capture->operation == operation &&
+        ++_capture->calls == _capture->iteration) {
+      request = std::move(_capture);
+      _captureArmed.store(false, std::memory_order_relaxed);
+    }
+  }
+  if (!request) {
+    ++capture_depth;
+    return this;
+  }
+
+  MTL::CaptureManager *manager = MTL::CaptureManager::sharedCaptureManager();
+  if (!manager->supportsDestination(MTL::CaptureDestinationGPUTraceDocument)) {
+    throw std::runtime_error("GPU capture to a trace document is not "
+                             "supported; set MTL_CAPTURE_ENABLED=1");
+  }
+  MTL::CaptureDescriptor *descriptor = MTL::CaptureDescriptor::alloc()->init();
+  descriptor->setCaptureObject(reinterpret_cast<id>(_commandQueue));
+  descriptor->setDestination(MTL::CaptureDestinationGPUTraceDocument);
+  descriptor->setOutputURL(NS::URL::fileURLWithPath(
+      NS::String::string(request->path.c_str(), NS::UTF8StringEncoding)));
+  NS::Error *error = nullptr;
+  const bool started = manager->startCapture(descriptor, &error);
+  descriptor->release();
+  if (!started) {
     throw std::runtime_error(
-        "Matrix dimensions incompatible or transposed pipeline not ready.");
-  }
-  GF2Matrix b_t = b.transpose();
-  size_t buffer_size_a = a.rows() * a.words_per_row() * sizeof(uint64_t);
-  size_t buffer_size_b_t = b_t.rows() * b_t.words_per_row() * sizeof(uint64_t);
-  size_t buffer_size_result =
-      result.rows() * result.words_per_row() * sizeof(uint64_t);
-  auto *bufferA = _device->newBuffer(a.get_raw_data(), buffer_size_a,
-                                     MTL::ResourceStorageModeShared);
-  auto *bufferB_T = _device->newBuffer(b_t.get_raw_data(), buffer_size_b_t,
-                                       MTL::ResourceStorageModeShared);
-  auto *bufferResult =
-      _device->newBuffer(buffer_size_result, MTL::ResourceStorageModeShared);
-  GPUParams params;
-  params.a_rows = static_cast<uint32_t>(a.rows());
-  params.a_cols = static_cast<uint32_t>(a.cols());
-  params.b_cols = static_cast<uint32_t>(b.cols());
-  params.words_per_row_a = static_cast<uint32_t>(a.words_per_row());
-  params.words_per_row_b = static_cast<uint32_t>(b_t.words_per_row());
-  params.words_per_row_result = static_cast<uint32_t>(result.words_per_row());
-  auto *paramsBuffer = _device->newBuffer(&params, sizeof(GPUParams),
-                                          MTL::ResourceStorageModeShared);
-  MTL::CommandBuffer *commandBuffer = _commandQueue->commandBuffer();
+        "GPU capture failed: " +
+        std::string(error ? error->localizedDescription()->utf8String()
+                          : request->path.c_str()));
+  }
+  ++capture_depth;
+  capturing = true;
+  return this;
+}
+
+void GF2GPU::endCapture(bool capturing) {
+  --capture_depth;
+  if (capturing) {
+    MTL::CaptureManager::sharedCaptureManager()->stopCapture();
+  }
+}
+
+const char *GF2GPU::captureName(Kernel kernel) {
+  switch (kernel) {
+  case Kernel::Baseline:
+    return "Baseline";
+  case Kernel::Transposed:
+    return "Transposed";
+  case Kernel::Tiled:
+    return "Tiled";
+  case Kernel::Vectorized:
+    return "Vectorized";
+  case Kernel::SimdGroup:
+    return "SimdGroup";
+  case Kernel::M4R:
+    return "M4R";
+  }
+  return "";
+}
+
+// --- Encoders ---
+
+// Kernels with one thread (or SIMD-group) per result word reading A and B
+// (or B^T) row by row: the baseline, transposed, vectorized and SIMD-group
+// kernels
+void GF2GPU::encodeWordKernel(Submission &sub, Kernel kernel,
+                              MTL::ComputePipelineState *pipeline,
+                              const GF2Matrix &a, MTL::Buffer *bufferB,
+                              size_t b_stride, size_t b_cols,
+                              GF2Matrix &result, size_t rows) {
+  auto *bufferA = uploadMatrix(sub, a);
+  auto *bufferResult = resultBuffer(result);
+  sub.result = &result;
+  sub.resultBuffer = bufferResult;
+  GPUParams params = makeParams(a, b_cols, b_stride, result);
+  rows = std::min(rows, a.rows());
+  params.a_rows = static_cast<uint32_t>(rows);
+  sub.resultRows = rows;
+
+  // Staged operands are only filled once the command buffer runs, so their
+  // launch shapes are not timed
+  encodeWordDispatch(sub.commandBuffer, kernel, pipeline, bufferA, bufferB,
+                     bufferResult, params, result.words_per_row(), !staged());
+}
+
+// The dispatch of a word kernel over params.a_rows rows of result_words
+// words, the matrices at the given byte offsets into their buffers. With
+// 'tune' the launch shape may be timed on these buffers first, which needs
+// their contents to be ready.
+void GF2GPU::encodeWordDispatch(MTL::CommandBuffer *commandBuffer, Kernel kernel,
+                                MTL::ComputePipelineState *pipeline,
+                                MTL::Buffer *bufferA, MTL::Buffer *bufferB,
+                                MTL::Buffer *bufferResult, const GPUParams &params,
+                                size_t result_words, bool tune, size_t a_offset,
+                                size_t b_offset, size_t result_offset) {
+  GPUBatchParams batch = {1, 0, 0, 0, 0};
+  auto bind = [&](MTL::ComputeCommandEncoder *encoder) {
+    encoder->setBuffer(bufferA, a_offset, 0);
+    encoder->setBuffer(bufferB, b_offset, 1);
+    encoder->setBuffer(bufferResult, result_offset, 2);
+    encoder->setBytes(&params, sizeof(GPUParams), 3);
+    encoder->setBytes(&batch, sizeof(GPUBatchParams), 4);
+  };
+  MTL::Size grid = wordKernelGrid(kernel, params.a_rows, result_words, 1);
+  MTL::Size group =
+      wordKernelGroup(kernel, pipeline, grid, tune ? EncoderBinder(bind) : EncoderBinder());
+
   MTL::ComputeCommandEncoder *encoder = commandBuffer->computeCommandEncoder();
-  encoder->setComputePipelineState(_computePipelineTransposed);
-  encoder->setBuffer(bufferA, 0, 0);
-  encoder->setBuffer(bufferB_T, 0, 1);
-  encoder->setBuffer(bufferResult, 0, 2);
-  encoder->setBuffer(paramsBuffer, 0, 3);
-  MTL::Size threadsPerGroup = MTL::Size::Make(16, 16, 1);
-  MTL::Size gridSize = MTL::Size::Make(a.rows(), result.words_per_row(), 1);
-  encoder->dispatchThreads(gridSize, threadsPerGroup);
+  encoder->setComputePipelineState(pipeline);
+  bind(encoder);
+  encoder->dispatchThreads(grid, group);
   encoder->endEncoding();
-  commandBuffer->commit();
-  commandBuffer->waitUntilCompleted();
-  memcpy(const_cast<uint64_t *>(result.get_raw_data()),
-         bufferResult->contents(), buffer_size_result);
-  bufferA->release();
-  bufferB_T->release();
-  bufferResult->release();
-  paramsBuffer->release();
 }
 
-void GF2GPU::multiplyGPUTiled(const GF2Matrix &a, const GF2Matrix &b,
-                              GF2Matrix &result) {
-  if (a.cols() != b.rows()) {
-    throw std::runtime_error(
-        "Matrix dimensions incompatible for GPU multiplication");
+// Each thread computes one uint64_t word of the result, except in the
+// SIMD-group kernel where 32 consecutive threads in x share one word
+MTL::Size GF2GPU::wordKernelGrid(Kernel kernel, size_t rows, size_t words,
+                                 size_t count) {
+  if (kernel == Kernel::SimdGroup) {
+    return MTL::Size::Make(32 * words, rows, count);
   }
-  if (!_computePipelineTiled) {
-    throw std::runtime_error("Tiled GPU pipeline not initialized.");
-  }
-  size_t words_per_row_a = a.words_per_row();
-  size_t words_per_row_b = b.words_per_row();
-  size_t words_per_row_result = result.words_per_row();
-  size_t buffer_size_a = a.rows() * words_per_row_a * sizeof(uint64_t);
-  size_t buffer_size_b = b.rows() * words_per_row_b * sizeof(uint64_t);
-  size_t buffer_size_result =
-      result.rows() * words_per_row_result * sizeof(uint64_t);
-  auto *bufferA = _device->newBuffer(a.get_raw_data(), buffer_size_a,
-                                     MTL::ResourceStorageModeShared);
-  auto *bufferB = _device->newBuffer(b.get_raw_data(), buffer_size_b,
-                                     MTL::ResourceStorageModeShared);
-  auto *bufferResult =
-      _device->newBuffer(buffer_size_result, MTL::ResourceStorageModeShared);
-  GPUParams params;
-  params.a_rows = static_cast<uint32_t>(a.rows());
-  params.a_cols = static_cast<uint32_t>(a.cols());
-  params.b_cols = static_cast<uint32_t>(b.cols());
-  params.words_per_row_a = static_cast<uint32_t>(words_per_row_a);
-  params.words_per_row_b = static_cast<uint32_t>(words_per_row_b);
-  params.words_per_row_result = static_cast<uint32_t>(words_per_row_result);
-  auto *paramsBuffer = _device->newBuffer(&params, sizeof(GPUParams),
-                                          MTL::ResourceStorageModeShared);
-  MTL::CommandBuffer *commandBuffer = _commandQueue->commandBuffer();
+  return MTL::Size::Make(rows, words, count);
+}
+
+// --- Launch tuning ---
+
+void GF2GPU::setLaunchTuning(bool enabled) { _launchTuning = enabled; }
+
+// Up to 256 threads (a whole number of SIMD-groups), as tall as the grid
+// allows up to 16 and the rest in x, so that tall-skinny grids such as one
+// result word per row still fill the threadgroup. x stays a multiple of
+// x_multiple.
+MTL::Size GF2GPU::fitGroup(MTL::ComputePipelineState *pipeline, MTL::Size grid,
+                           size_t x_multiple) {
+  const size_t width = std::max<size_t>(1, pipeline->threadExecutionWidth());
+  const size_t max_threads =
+      std::max(width, size_t(pipeline->maxTotalThreadsPerThreadgroup()));
+  const size_t total = std::max(width, std::min<size_t>(256, max_threads) / width * width);
+
+  size_t y = 1;
+  while (y * 2 <= std::min<size_t>(16, grid.height) && total / (y * 2) >= x_multiple) {
+    y *= 2;
+  }
+  return MTL::Size::Make(total / y, y, 1);
+}
+
+// Power-of-two shapes from one SIMD-group up to the pipeline's limit (at
+// most 1024 threads), without those at least twice the grid in a dimension
+std::vector<MTL::Size> GF2GPU::candidateGroups(MTL::ComputePipelineState *pipeline,
+                                               MTL::Size grid, size_t x_multiple) {
+  const size_t width = std::max<size_t>(1, pipeline->threadExecutionWidth());
+  const size_t max_threads =
+      std::min<size_t>(1024, pipeline->maxTotalThreadsPerThreadgroup());
+
+  std::vector<MTL::Size> candidates;
+  for (size_t total = width; total <= max_threads; total *= 2) {
+    for (size_t x = x_multiple; x <= total; x *= 2) {
+      size_t y = total / x;
+      if (x * y != total || (x > x_multiple && x >= 2 * grid.width) ||
+          (y > 1 && y >= 2 * grid.height)) {
+        continue;
+      }
+      candidates.push_back(MTL::Size::Make(x, y, 1));
+    }
+  }
+  return candidates;
+}
+
+// The threadgroup size for a word-kernel dispatch. On the first dispatch of a
+// pipeline and grid size class the candidates are timed on the dispatch's
+// own buffers, bound by 'bind' (the kernels only write the result, so the
+// extra runs are harmless), and the fastest by GPU time is cached. Dispatches
+// that take longer than TUNE_MAX_MS keep the fitted shape: the launch shape
+// matters for short kernels, and timing long ones would cost too much.
+// Without 'bind' a cached shape is used if there is one, else the fitted one.
+MTL::Size GF2GPU::wordKernelGroup(Kernel kernel,
+                                  MTL::ComputePipelineState *pipeline,
+                                  MTL::Size grid, const EncoderBinder &bind) {
+  // 32 consecutive threads in x of the SIMD-group kernel share one word
+  const size_t x_multiple = kernel == Kernel::SimdGroup ? 32 : 1;
+  MTL::Size fitted = fitGroup(pipeline, grid, x_multiple);
+  if (!_launchTuning) {
+    return fitted;
+  }
+
+  const LaunchKey key{pipeline, size_class(grid.width), size_class(grid.height),
+                      size_class(grid.depth)};
+  {
+    std::lock_guard<std::mutex> lock(_launchMutex);
+    auto it = _launchGroups.find(key);
+    if (it != _launchGroups.end()) {
+      return it->second;
+    }
+  }
+  if (!bind) {
+    return fitted;
+  }
+
+  auto time_ms = [&](MTL::Size group) {
+    MTL::CommandBuffer *commandBuffer = _commandQueue->commandBuffer();
+    MTL::ComputeCommandEncoder *encoder = commandBuffer->computeCommandEncoder();
+    encoder->setComputePipelineState(pipeline);
+    bind(encoder);
+    encoder->dispatchThreads(grid, group);
+    encoder->endEncoding();
+    commandBuffer->commit();
+    commandBuffer->waitUntilCompleted();
+    if (commandBuffer->status() == MTL::CommandBufferStatusError) {
+      return std::numeric_limits<double>::infinity();
+    }
+    return (commandBuffer->GPUEndTime() - commandBuffer->GPUStartTime()) * 1000.0;
+  };
+
+  constexpr double TUNE_MAX_MS = 50.0;
+  time_ms(fitted); // warm up
+  MTL::Size best = fitted;
+  double best_ms = time_ms(fitted);
+  if (best_ms <= TUNE_MAX_MS) {
+    for (const MTL::Size &group : candidateGroups(pipeline, grid, x_multiple)) {
+      double ms = time_ms(group);
+      if (ms < best_ms) {
+        best = group;
+        best_ms = ms;
+      }
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(_launchMutex);
+  _launchGroups.emplace(key, best);
+  return best;
+}
+
+// dst = src^T, one threadgroup per 64x64 block, including the zero padding
+// words of dst; src starts src_offset bytes into its buffer
+void GF2GPU::encodeTranspose(MTL::CommandBuffer *commandBuffer,
+                             MTL::Buffer *bufferSrc, size_t rows, size_t cols,
+                             size_t src_stride, MTL::Buffer *bufferDst,
+                             size_t dst_stride, size_t src_offset) {
+  GF2TransposeParams params;
+  params.rows = static_cast<uint32_t>(rows);
+  params.cols = static_cast<uint32_t>(cols);
+  params.src_stride = static_cast<uint32_t>(src_stride);
+  params.dst_stride = static_cast<uint32_t>(dst_stride);
+
+  MTL::ComputeCommandEncoder *encoder = commandBuffer->computeCommandEncoder();
+  encoder->setComputePipelineState(namedPipeline("gf2_transpose_kernel"));
+  encoder->setBuffer(bufferSrc, src_offset, 0);
+  encoder->setBuffer(bufferDst, 0, 1);
+  encoder->setBytes(&params, sizeof(GF2TransposeParams), 2);
+  encoder->dispatchThreadgroups(
+      MTL::Size::Make(dst_stride, (cols + 63) / 64, 1),
+      MTL::Size::Make(64, 1, 1));
+  encoder->endEncoding();
+}
+
+void GF2GPU::encodeTiled(Submission &sub, const GF2Matrix &a,
+                         const GF2Matrix &b, GF2Matrix &result) {
+  auto *bufferA = uploadMatrix(sub, a);
+  auto *bufferB = uploadMatrix(sub, b);
+  auto *bufferResult = resultBuffer(result);
+  sub.result = &result;
+  sub.resultBuffer = bufferResult;
+  GPUParams params = makeParams(a, b.cols(), b.row_stride(), result);
+  encodeTiledDispatch(sub.commandBuffer, bufferA, bufferB, bufferResult, params);
+}
+
+void GF2GPU::encodeTiledDispatch(MTL::CommandBuffer *commandBuffer,
+                                 MTL::Buffer *bufferA, MTL::Buffer *bufferB,
+                                 MTL::Buffer *bufferResult,
+                                 const GPUParams &params) {
   MTL::ComputeCommandEncoder *encoder = commandBuffer->computeCommandEncoder();
-  encoder->setComputePipelineState(_computePipelineTiled);
+  encoder->setComputePipelineState(pipelineFor(Kernel::Tiled));
   encoder->setBuffer(bufferA, 0, 0);
   encoder->setBuffer(bufferB, 0, 1);
   encoder->setBuffer(bufferResult, 0, 2);
-  encoder->setBuffer(paramsBuffer, 0, 3);
-  const int TILE_WIDTH = 32;
-  MTL::Size threadsPerGroup = MTL::Size::Make(TILE_WIDTH, TILE_WIDTH, 1);
-  MTL::Size gridSize = MTL::Size::Make(a.rows(), b.cols(), 1);
-  encoder->dispatchThreads(gridSize, threadsPerGroup);
+  encoder->setBytes(&params, sizeof(GPUParams), 3);
+  // Each 16 x 16 threadgroup computes 64 rows by 16 words of C
+  const size_t TILE_ROWS = 64;
+  const size_t TILE_WORDS = 16;
+  const size_t result_words = (params.b_cols + 63) / 64;
+  MTL::Size threadsPerGroup = MTL::Size::Make(16, 16, 1);
+  MTL::Size groups =
+      MTL::Size::Make((result_words + TILE_WORDS - 1) / TILE_WORDS,
+                      (params.a_rows + TILE_ROWS - 1) / TILE_ROWS, 1);
+  encoder->dispatchThreadgroups(groups, threadsPerGroup);
   encoder->endEncoding();
-  commandBuffer->commit();
-  commandBuffer->waitUntilCompleted();
-  memcpy(const_cast<uint64_t *>(result.get_raw_data()),
-         bufferResult->contents(), buffer_size_result);
-  bufferA->release();
-  bufferB->release();
-  bufferResult->release();
-  paramsBuffer->release();
+}
+
+// Words of A per panel such that the 8 tables of 256 entries per word fit
+// in M4R_TABLE_BYTES
+size_t GF2GPU::m4rPanelWords(size_t a_cols, size_t b_stride) {
+  const size_t k_words = std::max<size_t>(1, (a_cols + 63) / 64);
+  const size_t bytes_per_word = 8 * 256 * b_stride * sizeof(uint64_t);
+  return std::min(k_words, std::max<size_t>(1, M4R_TABLE_BYTES / bytes_per_word));
+}
+
+// Encodes the table and multiply passes of every panel. The panels reuse one
+// table buffer; Metal's hazard tracking orders each table pass after the
+// multiply pass that read the previous tables. With 'accumulate' the first
+// panel adds into the result as well.
+void GF2GPU::encodeM4RPanels(MTL::CommandBuffer *commandBuffer,
+                             MTL::Buffer *bufferA, size_t a_offset,
+                             MTL::Buffer *bufferB, size_t b_offset,
+                             MTL::Buffer *bufferResult, size_t result_offset,
+                             MTL::Buffer *bufferTables, const GPUParams &params,
+                             const GPUBatchParams &batch, size_t panel_words,
+                             GF2Semiring semiring, bool accumulate) {
+  const size_t k_words = std::max<uint32_t>(1, (params.a_cols + 63) / 64);
+  const size_t b_words = (params.b_cols + 63) / 64;
+  const bool boolean = semiring == GF2Semiring::OrAnd;
+  const char *tableKernel =
+      boolean ? "m4r_make_tables_boolean_kernel" : "m4r_make_tables_kernel";
+  const char *mulKernel =
+      boolean ? "m4r_multiply_boolean_kernel" : "m4r_multiply_kernel";
+
+  for (size_t k0 = 0; k0 < k_words; k0 += panel_words) {
+    GPUM4RPanel panel;
+    panel.k_word0 = static_cast<uint32_t>(k0);
+    panel.k_words = static_cast<uint32_t>(std::min(panel_words, k_words - k0));
+    panel.accumulate = accumulate || k0 != 0;
+
+    // --- Pass 1: Generate the panel's lookup tables ---
+    MTL::ComputeCommandEncoder *tableEncoder = commandBuffer->computeCommandEncoder();
+    MTL::ComputePipelineState *tablePipeline = namedPipeline(tableKernel);
+    MTL::Size tableGrid = MTL::Size::Make(b_words, panel.k_words * 8, batch.count);
+    tableEncoder->setComputePipelineState(tablePipeline);
+    tableEncoder->setBuffer(bufferB, b_offset, 0);
+    tableEncoder->setBuffer(bufferTables, 0, 1);
+    tableEncoder->setBytes(&params, sizeof(GPUParams), 2);
+    tableEncoder->setBytes(&batch, sizeof(GPUBatchParams), 3);
+    tableEncoder->setBytes(&panel, sizeof(GPUM4RPanel), 4);
+    tableEncoder->dispatchThreads(tableGrid, fitGroup(tablePipeline, tableGrid, 1));
+    tableEncoder->endEncoding();
+
+    // --- Pass 2: Multiply (and accumulate) the panel ---
+    MTL::ComputeCommandEncoder *mulEncoder = commandBuffer->computeCommandEncoder();
+    MTL::ComputePipelineState *mulPipeline = namedPipeline(mulKernel);
+    MTL::Size mulGrid = MTL::Size::Make(params.a_rows, b_words, batch.count);
+    mulEncoder->setComputePipelineState(mulPipeline);
+    mulEncoder->setBuffer(bufferA, a_offset, 0);
+    mulEncoder->setBuffer(bufferResult, result_offset, 1);
+    mulEncoder->setBuffer(bufferTables, 0, 2);
+    mulEncoder->setBytes(&params, sizeof(GPUParams), 3);
+    mulEncoder->setBytes(&batch, sizeof(GPUBatchParams), 4);
+    mulEncoder->setBytes(&panel, sizeof(GPUM4RPanel), 5);
+    // The panels accumulate into the result, so these passes are fitted to
+    // the grid but not timed
+    mulEncoder->dispatchThreads(mulGrid, fitGroup(mulPipeline, mulGrid, 1));
+    mulEncoder->endEncoding();
+  }
+}
+
+void GF2GPU::encodeM4R(Submission &sub, const GF2Matrix &a, const GF2Matrix &b,
+                       GF2Matrix &result, GF2Semiring semiring) {
+  // The tables of one panel: 8 tables of 256 entries per word of A, each
+  // entry a row of B
+  const size_t panel_words = m4rPanelWords(a.cols(), b.row_stride());
+  const size_t table_bytes = panel_words * 8 * 256 * b.row_stride() * sizeof(uint64_t);
+
+  // --- Metal Buffers ---
+  auto *bufferA = uploadMatrix(sub, a);
+  auto *bufferB = uploadMatrix(sub, b);
+  auto *bufferResult = resultBuffer(result);
+  sub.result = &result;
+  sub.resultBuffer = bufferResult;
+  auto *bufferLookupTables = _bufferPool.acquire(table_bytes, gpuStorage());
+  sub.buffers.push_back({bufferLookupTables, nullptr});
+
+  GPUParams params = makeParams(a, b.cols(), b.row_stride(), result);
+  GPUBatchParams batch = {1, 0, 0, 0, 0};
+  encodeM4RPanels(sub.commandBuffer, bufferA, 0, bufferB, 0, bufferResult, 0,
+                  bufferLookupTables, params, batch, panel_words, semiring);
+}
+
+std::shared_ptr<GF2GPU::Submission>
+GF2GPU::encode(Kernel kernel, const GF2Matrix &a, const GF2Matrix &b,
+               GF2Matrix &result) {
+  GF2_TRACE_SCOPE("gpu: encode");
+  auto start = std::chrono::steady_clock::now();
+  if (a.cols() != b.rows()) {
+    throw std::runtime_error(
+        "Matrix dimensions incompatible for GPU multiplication");
+  }
+  if (result.rows() != a.rows() || result.cols() != b.cols()) {
+    throw std::runtime_error("GPU result matrix has the wrong dimensions");
+  }
+  if (needsOutOfCore(a.rows(), a.cols(), b.cols())) {
+    throw std::runtime_error(
+        "Product too large for single GPU buffers; use multiplyGPUOutOfCore");
+  }
+  MTL::ComputePipelineState *pipeline =
+      pipelineFor(kernel, (a.cols() + 63) / 64);
+  if (!pipeline) {
+    throw std::runtime_error("GPU pipeline not initialized.");
+  }
+
+  auto sub = newSubmission();
+
+  switch (kernel) {
+  case Kernel::Baseline: {
+    auto *bufferB = uploadMatrix(*sub, b);
+    encodeWordKernel(*sub, kernel, pipeline, a, bufferB, b.row_stride(), b.cols(),
+                     result);
+    break;
+  }
+  case Kernel::Transposed:
+  case Kernel::Vectorized:
+  case Kernel::SimdGroup: {
+    // These kernels rely on the transposed B matrix for coalesced memory
+    // access. It is produced on the GPU, ahead of the multiply in the same
+    // command buffer, so B^T never leaves the GPU.
+    if (namedPipeline("gf2_transpose_kernel")) {
+      auto *bufferB = uploadMatrix(*sub, b);
+      const size_t b_t_stride = default_stride(b.rows());
+      auto *bufferB_T = _bufferPool.acquire(
+          b.cols() * b_t_stride * sizeof(uint64_t), gpuStorage());
+      sub->buffers.push_back({bufferB_T, nullptr});
+      encodeTranspose(sub->commandBuffer, bufferB, b.rows(), b.cols(),
+                      b.row_stride(), bufferB_T, b_t_stride);
+      encodeWordKernel(*sub, kernel, pipeline, a, bufferB_T, b_t_stride, b.cols(),
+                       result);
+    } else {
+      sub->temporaries.push_back(std::make_unique<GF2Matrix>(b.transpose()));
+      const GF2Matrix &b_t = *sub->temporaries.back();
+      auto *bufferB_T = uploadMatrix(*sub, b_t);
+      encodeWordKernel(*sub, kernel, pipeline, a, bufferB_T, b_t.row_stride(),
+                       b.cols(), result);
+    }
+    break;
+  }
+  case Kernel::Tiled:
+    encodeTiled(*sub, a, b, result);
+    break;
+  case Kernel::M4R:
+    encodeM4R(*sub, a, b, result);
+    break;
+  }
+  stageResult(*sub);
+  sub->timing.host_ms = elapsed_ms(start) - sub->timing.upload_ms;
+  return sub;
+}
+
+std::shared_ptr<GF2GPU::Submission>
+GF2GPU::encode(Kernel kernel, const GF2Matrix &a, const GF2PackedOperand &b,
+               GF2Matrix &result, size_t rows) {
+  if (kernel != Kernel::Transposed && kernel != Kernel::Vectorized &&
+      kernel != Kernel::SimdGroup) {
+    throw std::runtime_error(
+        "Only the kernels reading B^T take a packed B.");
+  }
+  GF2_TRACE_SCOPE("gpu: encode");
+  auto start = std::chrono::steady_clock::now();
+  if (a.cols() != b.rows()) {
+    throw std::runtime_error(
+        "Matrix dimensions incompatible for GPU multiplication");
+  }
+  if (result.rows() != a.rows() || result.cols() != b.cols()) {
+    throw std::runtime_error("GPU result matrix has the wrong dimensions");
+  }
+  if (needsOutOfCore(a.rows(), a.cols(), b.cols())) {
+    throw std::runtime_error(
+        "Product too large for single GPU buffers; use multiplyGPUOutOfCore");
+  }
+  MTL::ComputePipelineState *pipeline =
+      pipelineFor(kernel, (a.cols() + 63) / 64);
+  if (!pipeline) {
+    throw std::runtime_error("GPU pipeline not initialized.");
+  }
+
+  auto sub = newSubmission();
+  // The first use uploads B^T
+  auto upload_start = std::chrono::steady_clock::now();
+  MTL::Buffer *bufferB_T = packedBuffer(b);
+  sub->timing.upload_ms += elapsed_ms(upload_start);
+  encodeWordKernel(*sub, kernel, pipeline, a, bufferB_T,
+                   b.transposed().row_stride(), b.cols(), result, rows);
+  stageResult(*sub);
+  sub->timing.host_ms = elapsed_ms(start) - sub->timing.upload_ms;
+  return sub;
+}
+
+// --- Synchronous entry points ---
+
+void GF2GPU::multiplyGPUM4R(const GF2Matrix &a, const GF2Matrix &b,
+                            GF2Matrix &result) {
+  multiplySync(Kernel::M4R, a, b, result);
+}
+
+void GF2GPU::multiplyGPUBoolean(const GF2Matrix &a, const GF2Matrix &b,
+                                GF2Matrix &result) {
+  CaptureScope capture(*this, "multiplyGPUBoolean");
+  GF2_TRACE_SCOPE("gpu: encode");
+  auto start = std::chrono::steady_clock::now();
+  if (a.cols() != b.rows()) {
+    throw std::runtime_error(
+        "Matrix dimensions incompatible for GPU multiplication");
+  }
+  if (result.rows() != a.rows() || result.cols() != b.cols()) {
+    throw std::runtime_error("GPU result matrix has the wrong dimensions");
+  }
+  if (needsOutOfCore(a.rows(), a.cols(), b.cols())) {
+    throw std::runtime_error(
+        "Product too large for single GPU buffers; no out-of-core boolean path");
+  }
+  if (!namedPipeline("m4r_make_tables_boolean_kernel") ||
+      !namedPipeline("m4r_multiply_boolean_kernel")) {
+    throw std::runtime_error("GPU pipeline not initialized.");
+  }
+
+  auto sub = newSubmission();
+  encodeM4R(*sub, a, b, result, GF2Semiring::OrAnd);
+  stageResult(*sub);
+  sub->timing.host_ms = elapsed_ms(start) - sub->timing.upload_ms;
+  run(*sub);
+}
+
+// Uploaded B^T of a GF2PackedOperand, kept for as long as the operand lives
+struct GF2GPU::PackedOperandBuffer : GF2PackedOperand::DeviceData {
+  MTL::Device *device = nullptr;
+  MTL::Buffer *b_t = nullptr;
+  ~PackedOperandBuffer() override {
+    if (b_t)
+      b_t->release();
+  }
+};
+
+MTL::Buffer *GF2GPU::packedBuffer(const GF2PackedOperand &b) {
+  auto on_device = [this](GF2PackedOperand::DeviceData *data) {
+    auto *cached = dynamic_cast<PackedOperandBuffer *>(data);
+    return cached && cached->device == _device;
+  };
+  // The operand outlives the buffer, so large B^T is wrapped in place. With
+  // private storage it is blitted once into a private buffer instead.
+  auto upload = [this, &b]() {
+    const GF2Matrix &b_t = b.transposed();
+    const size_t bytes = b_t.rows() * b_t.row_stride() * sizeof(uint64_t);
+    auto data = std::make_unique<PackedOperandBuffer>();
+    data->device = _device;
+    data->b_t = wrapMatrix(b_t);
+    if (!data->b_t) {
+      data->b_t = _device->newBuffer(b_t.get_raw_data(), std::max<size_t>(bytes, 1),
+                                     MTL::ResourceStorageModeShared);
+    }
+    if (data->b_t && staged()) {
+      MTL::Buffer *staging = data->b_t;
+      data->b_t = _device->newBuffer(std::max<size_t>(bytes, 1),
+                                     MTL::ResourceStorageModePrivate);
+      if (data->b_t) {
+        try {
+          copyBuffer(staging, data->b_t, bytes);
+        } catch (...) {
+          staging->release();
+          throw;
+        }
+      }
+      staging->release();
+    }
+    if (!data->b_t) {
+      throw std::runtime_error("Failed to allocate Metal buffer");
+    }
+    return std::unique_ptr<GF2PackedOperand::DeviceData>(std::move(data));
+  };
+  return static_cast<PackedOperandBuffer *>(b.device_data(on_device, upload))->b_t;
+}
+
+void GF2GPU::multiplyGPUVectorized(const GF2Matrix &a, const GF2Matrix &b,
+                                   GF2Matrix &result) {
+  multiplySync(Kernel::Vectorized, a, b, result);
+}
+
+void GF2GPU::multiplyGPUVectorized(const GF2Matrix &a,
+                                   const GF2PackedOperand &b,
+                                   GF2Matrix &result) {
+  multiplySync(Kernel::Vectorized, a, b, result);
+}
+
+void GF2GPU::multiplyGPUSimdGroup(const GF2Matrix &a, const GF2Matrix &b,
+                                  GF2Matrix &result) {
+  multiplySync(Kernel::SimdGroup, a, b, result);
+}
+
+void GF2GPU::multiplyGPUSimdGroup(const GF2Matrix &a,
+                                  const GF2PackedOperand &b,
+                                  GF2Matrix &result) {
+  multiplySync(Kernel::SimdGroup, a, b, result);
+}
+
+void GF2GPU::multiplyGPU_transposed(const GF2Matrix &a, const GF2Matrix &b,
+                                    GF2Matrix &result) {
+  multiplySync(Kernel::Transposed, a, b, result);
+}
+
+void GF2GPU::multiplyGPU_transposed(const GF2Matrix &a,
+                                    const GF2PackedOperand &b,
+                                    GF2Matrix &result) {
+  multiplySync(Kernel::Transposed, a, b, result);
+}
+
+void GF2GPU::multiplyGPUTiled(const GF2Matrix &a, const GF2Matrix &b,
+                              GF2Matrix &result) {
+  multiplySync(Kernel::Tiled, a, b, result);
 }
 
 void GF2GPU::multiplyGPU(const GF2Matrix &a, const GF2Matrix &b,
                          GF2Matrix &result) {
+  multiplySync(Kernel::Baseline, a, b, result);
+}
+
+// --- Strassen-Winograd ---
+
+// The workspace holds A (pm x pk words), B (pk * 64 x pn words) and C
+// (pm x pn words) in padded blocks, followed by the temporaries of every
+// level. Words are padded so that each halves 'levels' times into a
+// multiple of 4, keeping every block and quadrant aligned for the ulong4
+// loads of the vectorized kernel. The operands are packed into it on the
+// CPU (into a staging buffer blitted into it for private storage), and C
+// is read back from it once the single command buffer has run.
+void GF2GPU::multiplyGPUStrassen(const GF2Matrix &a, const GF2Matrix &b,
+                                 GF2Matrix &result, Kernel leaf, size_t cutoff) {
+  CaptureScope capture(*this, "multiplyGPUStrassen");
+  if (leaf == Kernel::Tiled) {
+    throw std::runtime_error("The tiled kernel cannot run Strassen leaves");
+  }
   if (a.cols() != b.rows()) {
     throw std::runtime_error(
         "Matrix dimensions incompatible for GPU multiplication");
   }
-  size_t words_per_row_a = a.words_per_row();
-  size_t words_per_row_b = b.words_per_row();
-  size_t words_per_row_result = result.words_per_row();
-  size_t buffer_size_a = a.rows() * words_per_row_a * sizeof(uint64_t);
-  size_t buffer_size_b = b.rows() * words_per_row_b * sizeof(uint64_t);
-  size_t buffer_size_result =
-      result.rows() * words_per_row_result * sizeof(uint64_t);
-  auto *bufferA = _device->newBuffer(a.get_raw_data(), buffer_size_a,
-                                     MTL::ResourceStorageModeShared);
-  auto *bufferB = _device->newBuffer(b.get_raw_data(), buffer_size_b,
-                                     MTL::ResourceStorageModeShared);
-  auto *bufferResult =
-      _device->newBuffer(buffer_size_result, MTL::ResourceStorageModeShared);
+  if (result.rows() != a.rows() || result.cols() != b.cols()) {
+    throw std::runtime_error("GPU result matrix has the wrong dimensions");
+  }
+  cutoff = std::max<size_t>(cutoff, 64);
+
+  // Number of halvings while every dimension stays above the crossover
+  int levels = 0;
+  size_t m = a.rows(), k = a.cols(), n = b.cols();
+  while (m > cutoff && k > cutoff && n > cutoff) {
+    m /= 2;
+    k /= 2;
+    n /= 2;
+    ++levels;
+  }
+  const size_t align = size_t(1) << levels;
+  const size_t pm = round_up(a.rows(), align);
+  const size_t pk = round_up(a.words_per_row(), 4 * align);
+  const size_t pn = round_up(b.words_per_row(), 4 * align);
+  const size_t c_offset = pm * pk + pk * 64 * pn;
+  const size_t workspace_words =
+      c_offset + pm * pn + strassen_scratch_words(pm, pk, pn, levels);
+  if (levels == 0 || needsOutOfCore(pm, pk * 64, pn * 64) ||
+      workspace_words * sizeof(uint64_t) > _device->maxBufferLength()) {
+    multiplySync(leaf, a, b, result);
+    return;
+  }
+
+  GF2_TRACE_SCOPE("gpu: encode");
+  auto start = std::chrono::steady_clock::now();
+  const size_t leaf_k = pk >> levels, leaf_n = pn >> levels;
+  StrassenLeaf kernels = {leaf, pipelineFor(leaf, leaf_k), nullptr, nullptr, 0};
+  const bool m4r = leaf == Kernel::M4R;
+  if (!kernels.pipeline || !namedPipeline("gf2_add_kernel") ||
+      (m4r && !namedPipeline("gf2_copy_kernel")) ||
+      (leaf != Kernel::Baseline && !m4r &&
+       !namedPipeline("gf2_transpose_kernel"))) {
+    throw std::runtime_error("GPU pipeline not initialized.");
+  }
+
+  Submission sub(*this);
+  sub.commandBuffer = _commandQueue->commandBuffer();
+  MTL::Buffer *workspace =
+      _bufferPool.acquire(workspace_words * sizeof(uint64_t), gpuStorage());
+  sub.buffers.push_back({workspace, nullptr});
+  if (leaf != Kernel::Baseline) {
+    kernels.b_copy = _bufferPool.acquire(
+        leaf_k * 64 * leaf_n * sizeof(uint64_t), gpuStorage());
+    sub.buffers.push_back({kernels.b_copy, nullptr});
+  }
+  if (m4r) {
+    kernels.panel_words = m4rPanelWords(leaf_k * 64, leaf_n);
+    kernels.tables = _bufferPool.acquire(
+        kernels.panel_words * 8 * 256 * leaf_n * sizeof(uint64_t), gpuStorage());
+    sub.buffers.push_back({kernels.tables, nullptr});
+  }
+
+  {
+    GF2_TRACE_SCOPE("gpu: upload");
+    auto upload_start = std::chrono::steady_clock::now();
+    const size_t bytes = c_offset * sizeof(uint64_t);
+    MTL::Buffer *input = workspace;
+    if (staged()) {
+      input = _bufferPool.acquire(bytes);
+      sub.buffers.push_back({input, nullptr});
+    }
+    uint64_t *host = static_cast<uint64_t *>(input->contents());
+    pack_padded(a, host, pk, pm);
+    pack_padded(b, host + pm * pk, pn, pk * 64);
+    if (input != workspace) {
+      encodeCopy(sub.commandBuffer, input, workspace, bytes);
+    }
+    sub.timing.upload_ms += elapsed_ms(upload_start);
+  }
+
+  const DeviceBlock block_a = {workspace, 0, pk, pm, pk};
+  const DeviceBlock block_b = {workspace, pm * pk, pn, pk * 64, pn};
+  const DeviceBlock block_c = {workspace, c_offset, pn, pm, pn};
+  encodeStrassen(sub.commandBuffer, block_a, block_b, block_c, levels,
+                 c_offset + pm * pn, kernels);
+
+  // C comes back through a shared buffer unless the workspace is one
+  MTL::Buffer *output = workspace;
+  size_t output_offset = c_offset;
+  if (staged()) {
+    output = _bufferPool.acquire(pm * pn * sizeof(uint64_t));
+    sub.buffers.push_back({output, nullptr});
+    output_offset = 0;
+    MTL::BlitCommandEncoder *blit = sub.commandBuffer->blitCommandEncoder();
+    blit->copyFromBuffer(workspace, c_offset * sizeof(uint64_t), output, 0,
+                         pm * pn * sizeof(uint64_t));
+    blit->endEncoding();
+  }
+  sub.timing.host_ms = elapsed_ms(start) - sub.timing.upload_ms;
+
+  sub.committed = true;
+  sub.commandBuffer->commit();
+  {
+    GF2_TRACE_SCOPE("gpu: wait");
+    sub.commandBuffer->waitUntilCompleted();
+  }
+  if (sub.commandBuffer->status() != MTL::CommandBufferStatusError) {
+    GF2_TRACE_SCOPE("gpu: readback");
+    auto readback_start = std::chrono::steady_clock::now();
+    unpack_rows(static_cast<const uint64_t *>(output->contents()) +
+                    output_offset,
+                pn, result);
+    sub.timing.readback_ms = elapsed_ms(readback_start);
+  }
+  complete(sub);
+}
+
+// The Winograd schedule of strassen_recursive (GF2MatrixStrassen.cpp) with
+// the same two temporaries per level. Each step is its own encoder on the
+// one workspace buffer, so Metal orders every step after the last.
+void GF2GPU::encodeStrassen(MTL::CommandBuffer *commandBuffer,
+                            const DeviceBlock &a, const DeviceBlock &b,
+                            const DeviceBlock &c, int levels, size_t scratch,
+                            const StrassenLeaf &leaf) {
+  if (levels == 0) {
+    encodeStrassenLeaf(commandBuffer, a, b, c, leaf);
+    return;
+  }
+
+  const size_t hm = a.rows / 2;
+  const size_t hk = a.words / 2;
+  const size_t hn = b.words / 2;
+
+  const DeviceBlock a11 = a.quadrant(0, 0), a12 = a.quadrant(0, 1);
+  const DeviceBlock a21 = a.quadrant(1, 0), a22 = a.quadrant(1, 1);
+  const DeviceBlock b11 = b.quadrant(0, 0), b12 = b.quadrant(0, 1);
+  const DeviceBlock b21 = b.quadrant(1, 0), b22 = b.quadrant(1, 1);
+  const DeviceBlock c11 = c.quadrant(0, 0), c12 = c.quadrant(0, 1);
+  const DeviceBlock c21 = c.quadrant(1, 0), c22 = c.quadrant(1, 1);
+
+  // X0 holds sums of A quadrants and later P1; X1 holds sums of B quadrants
+  const size_t x0_words = std::max(hk, hn);
+  const DeviceBlock x0a = {a.buffer, scratch, x0_words, hm, hk};
+  const DeviceBlock x0c = {a.buffer, scratch, x0_words, hm, hn};
+  const DeviceBlock x1 = {a.buffer, scratch + hm * x0_words, hn, hk * 64, hn};
+  const size_t next = scratch + strassen_level_words(a.rows, a.words, b.words);
+  MTL::CommandBuffer *cb = commandBuffer;
+
+  encodeXorBlock(cb, x0a, a11, a21);                        // S3 = A11 + A21
+  encodeXorBlock(cb, x1, b22, b12);                         // T3 = B22 + B12
+  encodeStrassen(cb, x0a, x1, c21, levels - 1, next, leaf); // P7 = S3 * T3
+  encodeXorBlock(cb, x0a, a21, a22);                        // S1 = A21 + A22
+  encodeXorBlock(cb, x1, b12, b11);                         // T1 = B12 + B11
+  encodeStrassen(cb, x0a, x1, c22, levels - 1, next, leaf); // P5 = S1 * T1
+  encodeXorBlock(cb, x0a, x0a, a11);                        // S2 = S1 + A11
+  encodeXorBlock(cb, x1, b22, x1);                          // T2 = B22 + T1
+  encodeStrassen(cb, x0a, x1, c12, levels - 1, next, leaf); // P6 = S2 * T2
+  encodeXorBlock(cb, x0a, a12, x0a);                        // S4 = A12 + S2
+  encodeStrassen(cb, x0a, b22, c11, levels - 1, next, leaf); // P3 = S4 * B22
+  encodeStrassen(cb, a11, b11, x0c, levels - 1, next, leaf); // P1 = A11 * B11
+  encodeXorBlock(cb, c12, x0c, c12);                        // U2 = P1 + P6
+  encodeXorBlock(cb, c21, c12, c21);                        // U3 = U2 + P7
+  encodeXorBlock(cb, c12, c12, c22);                        // U4 = U2 + P5
+  encodeXorBlock(cb, c22, c21, c22);                        // C22 = U3 + P5
+  encodeXorBlock(cb, c12, c12, c11);                        // C12 = U4 + P3
+  encodeXorBlock(cb, x1, x1, b21);                          // T4 = T2 + B21
+  encodeStrassen(cb, a22, x1, c11, levels - 1, next, leaf); // P4 = A22 * T4
+  encodeXorBlock(cb, c21, c21, c11);                        // C21 = U3 + P4
+  encodeStrassen(cb, a12, b21, c11, levels - 1, next, leaf); // P2 = A12 * B21
+  encodeXorBlock(cb, c11, x0c, c11);                        // C11 = P1 + P2
+}
+
+// The baseline kernel reads B in place. The others want it contiguous, as
+// B^T for the dot-product kernels and for M4R because its tables are as
+// wide as B's stride; the X1 sums of the last level already are.
+void GF2GPU::encodeStrassenLeaf(MTL::CommandBuffer *commandBuffer,
+                                const DeviceBlock &a, const DeviceBlock &b,
+                                const DeviceBlock &c, const StrassenLeaf &leaf) {
+  const size_t word = sizeof(uint64_t);
+  GPUParams params;
+  params.a_rows = static_cast<uint32_t>(a.rows);
+  params.a_cols = static_cast<uint32_t>(a.words * 64);
+  params.b_cols = static_cast<uint32_t>(c.words * 64);
+  params.words_per_row_a = static_cast<uint32_t>(a.stride);
+  params.words_per_row_b = static_cast<uint32_t>(b.stride);
+  params.words_per_row_result = static_cast<uint32_t>(c.stride);
+
+  switch (leaf.kernel) {
+  case Kernel::Baseline:
+    encodeWordDispatch(commandBuffer, leaf.kernel, leaf.pipeline, a.buffer,
+                       b.buffer, c.buffer, params, c.words, false,
+                       a.offset * word, b.offset * word, c.offset * word);
+    break;
+  case Kernel::Transposed:
+  case Kernel::Vectorized:
+  case Kernel::SimdGroup:
+    encodeTranspose(commandBuffer, b.buffer, b.rows, b.words * 64, b.stride,
+                    leaf.b_copy, a.words, b.offset * word);
+    params.words_per_row_b = static_cast<uint32_t>(a.words);
+    encodeWordDispatch(commandBuffer, leaf.kernel, leaf.pipeline, a.buffer,
+                       leaf.b_copy, c.buffer, params, c.words, false,
+                       a.offset * word, 0, c.offset * word);
+    break;
+  case Kernel::M4R: {
+    DeviceBlock src = b;
+    if (b.stride != b.words) {
+      src = {leaf.b_copy, 0, b.words, b.rows, b.words};
+      encodeCopyBlock(commandBuffer, src, b);
+      params.words_per_row_b = static_cast<uint32_t>(b.words);
+    }
+    GPUBatchParams batch = {1, 0, 0, 0, 0};
+    encodeM4RPanels(commandBuffer, a.buffer, a.offset * word, src.buffer,
+                    src.offset * word, c.buffer, c.offset * word, leaf.tables,
+                    params, batch, leaf.panel_words);
+    break;
+  }
+  case Kernel::Tiled:
+    throw std::runtime_error("The tiled kernel cannot run Strassen leaves");
+  }
+}
+
+void GF2GPU::encodeXorBlock(MTL::CommandBuffer *commandBuffer,
+                            const DeviceBlock &dst, const DeviceBlock &x,
+                            const DeviceBlock &y) {
+  MTL::ComputePipelineState *pipeline = namedPipeline("gf2_add_kernel");
+  GF2AddParams params;
+  params.rows = static_cast<uint32_t>(dst.rows);
+  params.words = static_cast<uint32_t>(dst.words);
+  params.a_stride = static_cast<uint32_t>(x.stride);
+  params.b_stride = static_cast<uint32_t>(y.stride);
+  params.result_stride = static_cast<uint32_t>(dst.stride);
+
+  MTL::ComputeCommandEncoder *encoder = commandBuffer->computeCommandEncoder();
+  encoder->setComputePipelineState(pipeline);
+  encoder->setBuffer(x.buffer, x.offset * sizeof(uint64_t), 0);
+  encoder->setBuffer(y.buffer, y.offset * sizeof(uint64_t), 1);
+  encoder->setBuffer(dst.buffer, dst.offset * sizeof(uint64_t), 2);
+  encoder->setBytes(&params, sizeof(GF2AddParams), 3);
+  MTL::Size grid = MTL::Size::Make(params.words, params.rows, 1);
+  encoder->dispatchThreads(grid, fitGroup(pipeline, grid, 1));
+  encoder->endEncoding();
+}
+
+void GF2GPU::encodeCopyBlock(MTL::CommandBuffer *commandBuffer,
+                             const DeviceBlock &dst, const DeviceBlock &src) {
+  MTL::ComputePipelineState *pipeline = namedPipeline("gf2_copy_kernel");
+  GF2AddParams params;
+  params.rows = static_cast<uint32_t>(dst.rows);
+  params.words = static_cast<uint32_t>(dst.words);
+  params.a_stride = static_cast<uint32_t>(src.stride);
+  params.b_stride = 0;
+  params.result_stride = static_cast<uint32_t>(dst.stride);
+
+  MTL::ComputeCommandEncoder *encoder = commandBuffer->computeCommandEncoder();
+  encoder->setComputePipelineState(pipeline);
+  encoder->setBuffer(src.buffer, src.offset * sizeof(uint64_t), 0);
+  encoder->setBuffer(dst.buffer, dst.offset * sizeof(uint64_t), 1);
+  encoder->setBytes(&params, sizeof(GF2AddParams), 2);
+  MTL::Size grid = MTL::Size::Make(params.words, params.rows, 1);
+  encoder->dispatchThreads(grid, fitGroup(pipeline, grid, 1));
+  encoder->endEncoding();
+}
+
+// --- GF2Backend ---
+
+std::string GF2GPU::deviceName() const {
+  if (!_device || !_device->name()) {
+    return "unknown Metal device";
+  }
+  return _device->name()->utf8String();
+}
+
+bool GF2GPU::supports(Kernel kernel) { return pipelineFor(kernel) != nullptr; }
+
+void GF2GPU::multiply(Kernel kernel, const GF2Matrix &a, const GF2Matrix &b,
+                      GF2Matrix &result) {
+  multiplySync(kernel, a, b, result);
+}
+
+void GF2GPU::multiplyBlock(const GF2Matrix &a, const uint64_t *x,
+                           uint64_t *y) {
+  CaptureScope capture(*this, "multiplyBlock");
+  runBlockKernel("gf2_matvec_block_kernel", a, x, a.cols(), y, a.rows(),
+                 MTL::Size::Make(a.rows(), 1, 1));
+}
+
+void GF2GPU::leftMultiplyBlock(const GF2Matrix &a, const uint64_t *x,
+                               uint64_t *y) {
+  CaptureScope capture(*this, "leftMultiplyBlock");
+  runBlockKernel("gf2_matvec_left_block_kernel", a, x, a.rows(), y,
+                 64 * a.words_per_row(),
+                 MTL::Size::Make(64, a.words_per_row(), 1));
+}
+
+// b is the B^T operand of the transposed kernel as it is
+void GF2GPU::multiplyABt(const GF2Matrix &a, const GF2Matrix &b,
+                         GF2Matrix &result) {
+  CaptureScope capture(*this, "multiplyABt");
+  if (a.cols() != b.cols()) {
+    throw std::runtime_error(
+        "Matrix dimensions incompatible for GPU multiplication");
+  }
+  if (result.rows() != a.rows() || result.cols() != b.rows()) {
+    throw std::runtime_error("GPU result matrix has the wrong dimensions");
+  }
+  if (needsOutOfCore(a.rows(), a.cols(), b.rows())) {
+    outOfCore(Kernel::Transposed, a, nullptr, &b, result,
+              OUT_OF_CORE_BLOCK_BYTES);
+    return;
+  }
+  GF2_TRACE_SCOPE("gpu: encode");
+  auto start = std::chrono::steady_clock::now();
+  MTL::ComputePipelineState *pipeline =
+      pipelineFor(Kernel::Transposed, (a.cols() + 63) / 64);
+  if (!pipeline) {
+    throw std::runtime_error("GPU pipeline not initialized.");
+  }
+
+  auto sub = newSubmission();
+  auto *bufferB = uploadMatrix(*sub, b);
+  encodeWordKernel(*sub, Kernel::Transposed, pipeline, a, bufferB,
+                   b.row_stride(), b.rows(), result);
+  stageResult(*sub);
+  sub->timing.host_ms = elapsed_ms(start) - sub->timing.upload_ms;
+  run(*sub);
+}
+
+void GF2GPU::multiplyAtB(const GF2Matrix &a, const GF2Matrix &b,
+                         GF2Matrix &result) {
+  CaptureScope capture(*this, "multiplyAtB");
+  GF2_TRACE_SCOPE("gpu: encode");
+  auto start = std::chrono::steady_clock::now();
+  if (a.rows() != b.rows()) {
+    throw std::runtime_error(
+        "Matrix dimensions incompatible for GPU multiplication");
+  }
+  if (result.rows() != a.cols() || result.cols() != b.cols()) {
+    throw std::runtime_error("GPU result matrix has the wrong dimensions");
+  }
+  if (needsOutOfCore(a.cols(), a.rows(), b.cols())) {
+    throw std::runtime_error(
+        "Product too large for single GPU buffers; no out-of-core A^T * B path");
+  }
+  if (result.rows() == 0 || result.cols() == 0) {
+    return;
+  }
+  MTL::ComputePipelineState *pipeline =
+      namedPipeline("gf2_multiply_at_b_kernel");
+  if (!pipeline) {
+    throw std::runtime_error("GPU pipeline not initialized.");
+  }
+
+  auto sub = newSubmission();
+  auto *bufferA = uploadMatrix(*sub, a);
+  auto *bufferB = uploadMatrix(*sub, b);
+  auto *bufferResult = resultBuffer(result);
+  sub->result = &result;
+  sub->resultBuffer = bufferResult;
+  sub->resultRows = result.rows();
+
+  GF2AtBParams params;
+  params.rows = static_cast<uint32_t>(a.rows());
+  params.cols = static_cast<uint32_t>(a.cols());
+  params.a_words = static_cast<uint32_t>(a.words_per_row());
+  params.b_words = static_cast<uint32_t>(b.words_per_row());
+  params.a_stride = static_cast<uint32_t>(a.row_stride());
+  params.b_stride = static_cast<uint32_t>(b.row_stride());
+  params.result_stride = static_cast<uint32_t>(result.row_stride());
+
+  const MTL::Size grid =
+      MTL::Size::Make(64, b.words_per_row(), a.words_per_row());
+  MTL::ComputeCommandEncoder *encoder =
+      sub->commandBuffer->computeCommandEncoder();
+  encoder->setComputePipelineState(pipeline);
+  encoder->setBuffer(bufferA, 0, 0);
+  encoder->setBuffer(bufferB, 0, 1);
+  encoder->setBuffer(bufferResult, 0, 2);
+  encoder->setBytes(&params, sizeof(GF2AtBParams), 3);
+  encoder->dispatchThreads(grid, fitGroup(pipeline, grid, 1));
+  encoder->endEncoding();
+  stageResult(*sub);
+  sub->timing.host_ms = elapsed_ms(start) - sub->timing.upload_ms;
+  run(*sub);
+}
+
+void GF2GPU::multiplyAAt(const GF2Matrix &a, GF2Matrix &result,
+                         GF2Triangle triangle, bool mirror) {
+  CaptureScope capture(*this, "multiplyAAt");
+  GF2_TRACE_SCOPE("gpu: encode");
+  auto start = std::chrono::steady_clock::now();
+  if (result.rows() != a.rows() || result.cols() != a.rows()) {
+    throw std::runtime_error("GPU result matrix has the wrong dimensions");
+  }
+  if (needsOutOfCore(a.rows(), a.cols(), a.rows())) {
+    throw std::runtime_error(
+        "Product too large for single GPU buffers; no out-of-core A A^T path");
+  }
+  if (result.rows() == 0) {
+    return;
+  }
+  MTL::ComputePipelineState *pipeline =
+      namedPipeline("gf2_multiply_aat_kernel");
+  if (!pipeline) {
+    throw std::runtime_error("GPU pipeline not initialized.");
+  }
+
+  auto sub = newSubmission();
+  auto *bufferA = uploadMatrix(*sub, a);
+  auto *bufferResult = resultBuffer(result);
+  sub->result = &result;
+  sub->resultBuffer = bufferResult;
+  sub->resultRows = result.rows();
+
+  GF2AAtParams params;
+  params.rows = static_cast<uint32_t>(a.rows());
+  params.words = static_cast<uint32_t>(a.words_per_row());
+  params.stride = static_cast<uint32_t>(a.row_stride());
+  params.result_stride = static_cast<uint32_t>(result.row_stride());
+  params.upper = triangle == GF2Triangle::Upper ? 1 : 0;
+
+  const MTL::Size grid =
+      MTL::Size::Make(a.rows(), result.words_per_row(), 1);
+  MTL::ComputeCommandEncoder *encoder =
+      sub->commandBuffer->computeCommandEncoder();
+  encoder->setComputePipelineState(pipeline);
+  encoder->setBuffer(bufferA, 0, 0);
+  encoder->setBuffer(bufferResult, 0, 1);
+  encoder->setBytes(&params, sizeof(GF2AAtParams), 2);
+  encoder->dispatchThreads(grid, fitGroup(pipeline, grid, 1));
+  encoder->endEncoding();
+  stageResult(*sub);
+  sub->timing.host_ms = elapsed_ms(start) - sub->timing.upload_ms;
+  run(*sub);
+  if (mirror) {
+    result.mirrorTriangle(triangle);
+  }
+}
+
+// The tile storage of each operand is a matrix of unpadded tile rows, so it
+// is uploaded and read back like any other
+void GF2GPU::multiplyTiled(const GF2TiledMatrix &a, const GF2TiledMatrix &b,
+                           GF2TiledMatrix &result) {
+  CaptureScope capture(*this, "multiplyTiled");
+  GF2_TRACE_SCOPE("gpu: encode");
+  auto start = std::chrono::steady_clock::now();
+  if (a.cols() != b.rows() || a.tile() != b.tile()) {
+    throw std::runtime_error(
+        "Matrix dimensions incompatible for GPU multiplication");
+  }
+  if (result.rows() != a.rows() || result.cols() != b.cols() ||
+      result.tile() != a.tile()) {
+    throw std::runtime_error("GPU result matrix has the wrong dimensions");
+  }
+  if (result.storage().rows() == 0) {
+    return;
+  }
+  if (a.storage().rows() == 0) {
+    memset(result.storage().get_raw_data(), 0,
+           result.storage().rows() * result.storage().row_stride() *
+               sizeof(uint64_t));
+    return;
+  }
+  MTL::ComputePipelineState *pipeline =
+      namedPipeline("gf2_multiply_morton_kernel");
+  if (!pipeline) {
+    throw std::runtime_error("GPU pipeline not initialized.");
+  }
+
+  auto sub = newSubmission();
+  auto *bufferA = uploadMatrix(*sub, a.storage());
+  auto *bufferB = uploadMatrix(*sub, b.storage());
+  auto *bufferResult = resultBuffer(result.storage());
+  sub->result = &result.storage();
+  sub->resultBuffer = bufferResult;
+  sub->resultRows = result.storage().rows();
+
+  GF2MortonParams params;
+  params.tile = static_cast<uint32_t>(a.tile());
+  params.tile_words = static_cast<uint32_t>(a.tileWords());
+  params.m_tiles = static_cast<uint32_t>(result.tileRows());
+  params.k_tiles = static_cast<uint32_t>(a.tileCols());
+  params.n_tiles = static_cast<uint32_t>(result.tileCols());
+
+  MTL::ComputeCommandEncoder *encoder =
+      sub->commandBuffer->computeCommandEncoder();
+  encoder->setComputePipelineState(pipeline);
+  encoder->setBuffer(bufferA, 0, 0);
+  encoder->setBuffer(bufferB, 0, 1);
+  encoder->setBuffer(bufferResult, 0, 2);
+  encoder->setBytes(&params, sizeof(GF2MortonParams), 3);
+  encoder->dispatchThreadgroups(
+      MTL::Size::Make(result.tileCols(), result.tileRows(), 1),
+      MTL::Size::Make(a.tile(), 1, 1));
+  encoder->endEncoding();
+  stageResult(*sub);
+  sub->timing.host_ms = elapsed_ms(start) - sub->timing.upload_ms;
+  run(*sub);
+}
+
+// x goes into a pooled buffer, y comes back from one; a is wrapped or
+// uploaded like a multiply operand
+void GF2GPU::runBlockKernel(const char *name, const GF2Matrix &a,
+                            const uint64_t *x, size_t x_words, uint64_t *y,
+                            size_t y_words, MTL::Size grid) {
+  auto start = std::chrono::steady_clock::now();
+  if (a.rows() > UINT32_MAX || a.cols() > UINT32_MAX) {
+    throw std::runtime_error("Matrix too large for the GPU block kernels");
+  }
+  if (y_words == 0) {
+    return;
+  }
+  if (x_words == 0 || a.words_per_row() == 0) {
+    memset(y, 0, y_words * sizeof(uint64_t));
+    return;
+  }
+  MTL::ComputePipelineState *pipeline = namedPipeline(name);
+  if (!pipeline) {
+    throw std::runtime_error("GPU pipeline not initialized.");
+  }
+
+  Submission sub(*this);
+  sub.commandBuffer = _commandQueue->commandBuffer();
+  MTL::Buffer *bufferA = uploadMatrix(sub, a);
+  auto upload_start = std::chrono::steady_clock::now();
+  MTL::Buffer *bufferX = _bufferPool.acquire(x_words * sizeof(uint64_t));
+  sub.buffers.push_back({bufferX, nullptr});
+  memcpy(bufferX->contents(), x, x_words * sizeof(uint64_t));
+  sub.timing.upload_ms += elapsed_ms(upload_start);
+  MTL::Buffer *bufferY = _bufferPool.acquire(y_words * sizeof(uint64_t));
+  sub.buffers.push_back({bufferY, nullptr});
+
+  GF2BlockParams params;
+  params.rows = static_cast<uint32_t>(a.rows());
+  params.cols = static_cast<uint32_t>(a.cols());
+  params.words = static_cast<uint32_t>(a.words_per_row());
+  params.stride = static_cast<uint32_t>(a.row_stride());
+
+  MTL::ComputeCommandEncoder *encoder =
+      sub.commandBuffer->computeCommandEncoder();
+  encoder->setComputePipelineState(pipeline);
+  encoder->setBuffer(bufferA, 0, 0);
+  encoder->setBuffer(bufferX, 0, 1);
+  encoder->setBuffer(bufferY, 0, 2);
+  encoder->setBytes(&params, sizeof(GF2BlockParams), 3);
+  encoder->dispatchThreads(grid, fitGroup(pipeline, grid, 1));
+  encoder->endEncoding();
+  sub.timing.host_ms = elapsed_ms(start) - sub.timing.upload_ms;
+
+  sub.committed = true;
+  sub.commandBuffer->commit();
+  sub.commandBuffer->waitUntilCompleted();
+  if (sub.commandBuffer->status() != MTL::CommandBufferStatusError) {
+    auto readback_start = std::chrono::steady_clock::now();
+    memcpy(y, bufferY->contents(), y_words * sizeof(uint64_t));
+    sub.timing.readback_ms = elapsed_ms(readback_start);
+  }
+  complete(sub);
+}
+
+void GF2GPU::multiplySync(Kernel kernel, const GF2Matrix &a,
+                          const GF2Matrix &b, GF2Matrix &result) {
+  CaptureScope capture(*this, captureName(kernel));
+  if (needsOutOfCore(a.rows(), a.cols(), b.cols())) {
+    multiplyGPUOutOfCore(kernel, a, b, result);
+    return;
+  }
+  run(*encode(kernel, a, b, result));
+}
+
+void GF2GPU::multiplySync(Kernel kernel, const GF2Matrix &a,
+                          const GF2PackedOperand &b, GF2Matrix &result) {
+  CaptureScope capture(*this, captureName(kernel));
+  if (needsOutOfCore(a.rows(), a.cols(), b.cols())) {
+    if (a.cols() != b.rows() || result.rows() != a.rows() ||
+        result.cols() != b.cols()) {
+      throw std::runtime_error(
+          "Matrix dimensions incompatible for GPU multiplication");
+    }
+    outOfCore(kernel, a, nullptr, &b.transposed(), result,
+              OUT_OF_CORE_BLOCK_BYTES);
+    return;
+  }
+  run(*encode(kernel, a, b, result));
+}
+
+// --- Out-of-core entry point ---
+
+namespace {
+
+// Copies 'rows' rows of 'words' words, zeroing the rest of each dst row
+void copy_rows(const uint64_t *src, size_t src_stride, size_t words, size_t rows,
+               uint64_t *dst, size_t dst_stride) {
+  for (size_t r = 0; r < rows; ++r) {
+    memcpy(dst + r * dst_stride, src + r * src_stride, words * sizeof(uint64_t));
+    memset(dst + r * dst_stride + words, 0,
+           (dst_stride - words) * sizeof(uint64_t));
+  }
+}
+
+bool reads_b_transposed(GF2GPU::Kernel kernel) {
+  return kernel == GF2GPU::Kernel::Transposed ||
+         kernel == GF2GPU::Kernel::Vectorized ||
+         kernel == GF2GPU::Kernel::SimdGroup;
+}
+
+} // namespace
+
+// Whether one of the buffers of a single-dispatch multiply would exceed the
+// device's buffer limit, or a dimension the 32-bit kernel parameters
+bool GF2GPU::needsOutOfCore(size_t a_rows, size_t a_cols, size_t b_cols) const {
+  const size_t limit = _device->maxBufferLength();
+  const size_t word = sizeof(uint64_t);
+  return a_rows > UINT32_MAX || a_cols > UINT32_MAX || b_cols > UINT32_MAX ||
+         a_rows * default_stride(a_cols) * word > limit ||
+         a_cols * default_stride(b_cols) * word > limit ||
+         b_cols * default_stride(a_cols) * word > limit ||
+         a_rows * default_stride(b_cols) * word > limit;
+}
+
+void GF2GPU::multiplyGPUOutOfCore(Kernel kernel, const GF2Matrix &a,
+                                  const GF2Matrix &b, GF2Matrix &result,
+                                  size_t block_bytes) {
+  CaptureScope capture(*this, "multiplyGPUOutOfCore");
+  if (a.cols() != b.rows()) {
+    throw std::runtime_error(
+        "Matrix dimensions incompatible for GPU multiplication");
+  }
+  if (result.rows() != a.rows() || result.cols() != b.cols()) {
+    throw std::runtime_error("GPU result matrix has the wrong dimensions");
+  }
+  if (reads_b_transposed(kernel)) {
+    // Column block j of C needs the rows of block j of B^T, which are
+    // contiguous in host memory
+    auto start = std::chrono::steady_clock::now();
+    GF2Matrix b_t = b.transpose();
+    double transpose_ms = elapsed_ms(start);
+    outOfCore(kernel, a, nullptr, &b_t, result, block_bytes);
+    std::lock_guard<std::mutex> lock(_timingMutex);
+    _lastTiming.host_ms += transpose_ms;
+  } else {
+    outOfCore(kernel, a, &b, nullptr, result, block_bytes);
+  }
+}
+
+// Either b (for the kernels reading B) or b_t is given
+// host_ms counts the encoding of the blocks only; the rest of the time is
+// spent in the copies or waiting for a slot of the ring.
+void GF2GPU::outOfCore(Kernel kernel, const GF2Matrix &a, const GF2Matrix *b,
+                       const GF2Matrix *b_t, GF2Matrix &result,
+                       size_t block_bytes) {
+  const size_t k = a.cols();
+  const size_t n = result.cols();
+  if (a.rows() == 0 || n == 0) {
+    return;
+  }
+  if (k > UINT32_MAX) {
+    throw std::runtime_error("Common dimension too large for the GPU kernels");
+  }
+  MTL::ComputePipelineState *pipeline = pipelineFor(kernel, (k + 63) / 64);
+  if (!pipeline) {
+    throw std::runtime_error("GPU pipeline not initialized.");
+  }
+
+  // Block sizes: multiples of 64 rows and of 64 columns of C (of a whole
+  // aligned row stride when there is room) such that the A, B and C blocks
+  // each stay within the budget
+  const size_t budget_words =
+      std::min<size_t>(block_bytes, _device->maxBufferLength()) / sizeof(uint64_t);
+  const size_t k_stride = default_stride(k);
+  const size_t k_rows = std::max<size_t>(k, 1);
+  const size_t stride_cols = 64 * GF2Matrix::ROW_ALIGN_WORDS;
+  auto round_down = [](size_t x, size_t m) { return std::max(m, x / m * m); };
+
+  size_t n_block = b_t ? budget_words / k_stride : budget_words / k_rows * 64;
+  n_block = n_block >= stride_cols ? round_down(n_block, stride_cols)
+                                   : round_down(n_block, 64);
+  n_block = std::min(n_block, (n + 63) / 64 * 64);
+  const size_t c_stride = default_stride(n_block);
+  const size_t b_stride = b_t ? k_stride : c_stride;
+  const size_t b_block_words = (b_t ? n_block : k_rows) * b_stride;
+  const size_t m_block = std::min(
+      a.rows(), round_down(budget_words / std::max(k_stride, c_stride), 64));
+
+  // The minimum blocks (64 rows or columns) must still fit in a buffer
+  const size_t max_words = _device->maxBufferLength() / sizeof(uint64_t);
+  if (m_block * k_stride > max_words || b_block_words > max_words ||
+      m_block * c_stride > max_words) {
+    throw std::runtime_error("Common dimension too large for the GPU buffers");
+  }
+
+  const size_t panel_words = m4rPanelWords(k, c_stride);
+  const size_t table_bytes = panel_words * 8 * 256 * c_stride * sizeof(uint64_t);
+
+  // One slot of the ring: its blocks and the command buffer using them. The
+  // kernels use the private copies of the blocks with private storage, else
+  // the blocks themselves.
+  const bool stage = staged();
+  struct Slot {
+    MTL::Buffer *a = nullptr, *b = nullptr, *c = nullptr, *tables = nullptr;
+    MTL::Buffer *deviceA = nullptr, *deviceB = nullptr, *deviceC = nullptr;
+    MTL::CommandBuffer *commandBuffer = nullptr;
+    size_t a_block = SIZE_MAX, b_block = SIZE_MAX;
+    size_t row0 = 0, rows = 0, col0 = 0, cols = 0;
+  };
+  std::vector<Slot> slots(OUT_OF_CORE_RING);
+  GF2GPUTiming timing;
+  std::string error;
+
+  // Waits for the slot's block and copies its part of C out
+  auto drain = [&](Slot &slot) {
+    if (!slot.commandBuffer) {
+      return;
+    }
+    slot.commandBuffer->waitUntilCompleted();
+    if (slot.commandBuffer->status() == MTL::CommandBufferStatusError) {
+      if (error.empty()) {
+        error = slot.commandBuffer->error()
+                    ? slot.commandBuffer->error()->localizedDescription()->utf8String()
+                    : "unknown error";
+      }
+    } else {
+      GF2_TRACE_GPU("gpu: out-of-core block", slot.commandBuffer->GPUStartTime(),
+                    slot.commandBuffer->GPUEndTime(), slot.commandBuffer->GPUEndTime());
+      timing.gpu_ms += (slot.commandBuffer->GPUEndTime() -
+                        slot.commandBuffer->GPUStartTime()) * 1000.0;
+      auto readback_start = std::chrono::steady_clock::now();
+      const uint64_t *c = static_cast<const uint64_t *>(slot.c->contents());
+      const size_t words = (slot.cols + 63) / 64;
+      for (size_t r = 0; r < slot.rows; ++r) {
+        memcpy(result.get_raw_data() + (slot.row0 + r) * result.row_stride() + slot.col0 / 64,
+               c + r * c_stride, words * sizeof(uint64_t));
+      }
+      timing.readback_ms += elapsed_ms(readback_start);
+    }
+    slot.commandBuffer->release();
+    slot.commandBuffer = nullptr;
+  };
+
+  auto release_slots = [&]() {
+    for (Slot &slot : slots) {
+      drain(slot);
+      for (MTL::Buffer *buffer : {slot.a, slot.b, slot.c, slot.tables}) {
+        if (buffer)
+          _bufferPool.recycle(buffer);
+      }
+      if (stage) {
+        for (MTL::Buffer *buffer : {slot.deviceA, slot.deviceB, slot.deviceC}) {
+          if (buffer)
+            _bufferPool.recycle(buffer);
+        }
+      }
+    }
+  };
+
+  try {
+    for (Slot &slot : slots) {
+      slot.a = _bufferPool.acquire(m_block * k_stride * sizeof(uint64_t));
+      slot.b = _bufferPool.acquire(b_block_words * sizeof(uint64_t));
+      slot.c = _bufferPool.acquire(m_block * c_stride * sizeof(uint64_t));
+      if (kernel == Kernel::M4R) {
+        slot.tables = _bufferPool.acquire(table_bytes, gpuStorage());
+      }
+      if (stage) {
+        slot.deviceA = _bufferPool.acquire(slot.a->length(), MTL::StorageModePrivate);
+        slot.deviceB = _bufferPool.acquire(slot.b->length(), MTL::StorageModePrivate);
+        slot.deviceC = _bufferPool.acquire(slot.c->length(), MTL::StorageModePrivate);
+      } else {
+        slot.deviceA = slot.a;
+        slot.deviceB = slot.b;
+        slot.deviceC = slot.c;
+      }
+    }
+
+    size_t next = 0;
+    for (size_t i = 0, row0 = 0; row0 < a.rows() && error.empty(); ++i, row0 += m_block) {
+      for (size_t j = 0, col0 = 0; col0 < n && error.empty(); ++j, col0 += n_block) {
+        Slot &slot = slots[next++ % slots.size()];
+        drain(slot);
+        slot.row0 = row0;
+        slot.rows = std::min(m_block, a.rows() - row0);
+        slot.col0 = col0;
+        slot.cols = std::min(n_block, n - col0);
+        const size_t words = (slot.cols + 63) / 64;
+
+        auto upload_start = std::chrono::steady_clock::now();
+        const bool new_a = slot.a_block != i;
+        const bool new_b = slot.b_block != j;
+        if (new_a) {
+          copy_rows(a.get_raw_data() + row0 * a.row_stride(), a.row_stride(),
+                    a.words_per_row(), slot.rows,
+                    static_cast<uint64_t *>(slot.a->contents()), k_stride);
+          slot.a_block = i;
+        }
+        if (new_b) {
+          uint64_t *dst = static_cast<uint64_t *>(slot.b->contents());
+          if (b_t) {
+            copy_rows(b_t->get_raw_data() + col0 * b_t->row_stride(),
+                      b_t->row_stride(), b_t->words_per_row(), slot.cols, dst,
+                      b_stride);
+          } else {
+            copy_rows(b->get_raw_data() + col0 / 64, b->row_stride(), words,
+                      b->rows(), dst, b_stride);
+          }
+          slot.b_block = j;
+        }
+        timing.upload_ms += elapsed_ms(upload_start);
+
+        GPUParams params;
+        params.a_rows = static_cast<uint32_t>(slot.rows);
+        params.a_cols = static_cast<uint32_t>(k);
+        params.b_cols = static_cast<uint32_t>(slot.cols);
+        params.words_per_row_a = static_cast<uint32_t>(k_stride);
+        params.words_per_row_b = static_cast<uint32_t>(b_stride);
+        params.words_per_row_result = static_cast<uint32_t>(c_stride);
+
+        auto encode_start = std::chrono::steady_clock::now();
+        MTL::CommandBuffer *commandBuffer = _commandQueue->commandBuffer();
+        commandBuffer->retain();
+        if (stage && new_a) {
+          encodeCopy(commandBuffer, slot.a, slot.deviceA,
+                     slot.rows * k_stride * sizeof(uint64_t));
+        }
+        if (stage && new_b) {
+          encodeCopy(commandBuffer, slot.b, slot.deviceB,
+                     b_block_words * sizeof(uint64_t));
+        }
+        switch (kernel) {
+        case Kernel::Tiled:
+          encodeTiledDispatch(commandBuffer, slot.deviceA, slot.deviceB,
+                              slot.deviceC, params);
+          break;
+        case Kernel::M4R: {
+          GPUBatchParams batch = {1, 0, 0, 0, 0};
+          encodeM4RPanels(commandBuffer, slot.deviceA, 0, slot.deviceB, 0,
+                          slot.deviceC, 0, slot.tables, params, batch,
+                          panel_words);
+          break;
+        }
+        default:
+          encodeWordDispatch(commandBuffer, kernel, pipeline, slot.deviceA,
+                             slot.deviceB, slot.deviceC, params, words, !stage);
+          break;
+        }
+        if (stage) {
+          encodeCopy(commandBuffer, slot.deviceC, slot.c,
+                     slot.rows * c_stride * sizeof(uint64_t));
+        }
+        commandBuffer->commit();
+        slot.commandBuffer = commandBuffer;
+        timing.host_ms += elapsed_ms(encode_start);
+      }
+    }
+  } catch (...) {
+    release_slots();
+    throw;
+  }
+  release_slots();
+
+  {
+    std::lock_guard<std::mutex> lock(_timingMutex);
+    _lastTiming = timing;
+    samplePeakAllocated();
+  }
+  if (!error.empty()) {
+    throw std::runtime_error("GPU command buffer failed: " + error);
+  }
+}
+
+// --- Hybrid CPU + GPU entry point ---
+
+void GF2GPU::multiplyHybrid(const GF2Matrix &a, const GF2Matrix &b,
+                            GF2Matrix &result, Kernel kernel, int num_threads) {
+  CaptureScope capture(*this, "multiplyHybrid");
+  GF2PackedOperand packed(b);
+  multiplyHybrid(a, packed, result, kernel, num_threads);
+}
+
+void GF2GPU::multiplyHybrid(const GF2Matrix &a, const GF2PackedOperand &b,
+                            GF2Matrix &result, Kernel kernel, int num_threads) {
+  CaptureScope capture(*this, "multiplyHybrid");
+  // The split is on row blocks of the CPU kernel, and each side gets at
+  // least one so that both throughputs keep being measured
+  const size_t block = GF2Matrix::PARALLEL_ROW_BLOCK;
+  const size_t rows = a.rows();
+  if (rows < 2 * block) {
+    a.multiplyInto(b, result, num_threads);
+    return;
+  }
+  const double share = _hybridGpuShare.load();
+  size_t gpu_rows = static_cast<size_t>(share * rows + block / 2) / block * block;
+  gpu_rows = std::min(std::max(gpu_rows, block), (rows - block) / block * block);
+
+  // The GPU computes the first gpu_rows rows while this thread runs the CPU
+  // kernel over the rest; both write straight into result
+  auto sub = encode(kernel, a, b, result, gpu_rows);
+  sub->committed = true;
+  sub->commandBuffer->commit();
+
+  auto cpu_start = std::chrono::steady_clock::now();
+  std::exception_ptr cpu_error;
+  try {
+    a.multiplyRowsInto(b, result, gpu_rows, rows, num_threads);
+  } catch (...) {
+    cpu_error = std::current_exception();
+  }
+  const double cpu_ms = elapsed_ms(cpu_start);
+
+  sub->commandBuffer->waitUntilCompleted();
+  complete(*sub);
+  if (cpu_error) {
+    std::rethrow_exception(cpu_error);
+  }
+
+  // Rows per millisecond on each side give the split that would have made
+  // both finish together; move halfway towards it
+  const GF2GPUTiming &t = sub->timing;
+  const double gpu_ms = t.host_ms + t.upload_ms + t.gpu_ms + t.readback_ms;
+  if (gpu_ms > 0.0 && cpu_ms > 0.0) {
+    const double gpu_rate = gpu_rows / gpu_ms;
+    const double cpu_rate = (rows - gpu_rows) / cpu_ms;
+    const double target = gpu_rate / (gpu_rate + cpu_rate);
+    _hybridGpuShare.store(0.5 * share + 0.5 * target);
+  }
+}
+
+double GF2GPU::hybridGpuShare() const { return _hybridGpuShare.load(); }
+
+void GF2GPU::setHybridGpuShare(double share) {
+  _hybridGpuShare.store(std::min(1.0, std::max(0.0, share)));
+}
+
+// --- Device-resident matrices ---
+
+GF2GPUMatrix::~GF2GPUMatrix() {
+  // A pending command buffer keeps its own reference to the buffer
+  if (_buffer)
+    _buffer->release();
+}
+
+GF2GPUMatrix::GF2GPUMatrix(GF2GPUMatrix &&other) noexcept
+    : _buffer(other._buffer), _rows(other._rows), _cols(other._cols),
+      _stride(other._stride) {
+  other._buffer = nullptr;
+}
+
+GF2GPUMatrix &GF2GPUMatrix::operator=(GF2GPUMatrix &&other) noexcept {
+  if (this != &other) {
+    if (_buffer)
+      _buffer->release();
+    _buffer = other._buffer;
+    _rows = other._rows;
+    _cols = other._cols;
+    _stride = other._stride;
+    other._buffer = nullptr;
+  }
+  return *this;
+}
+
+// Uninitialized storage; the kernels write every word they are dispatched for
+GF2GPUMatrix GF2GPU::newDeviceMatrix(size_t rows, size_t cols) {
+  const size_t stride = default_stride(cols);
+  const size_t bytes = std::max<size_t>(rows * stride, 1) * sizeof(uint64_t);
+  MTL::Buffer *buffer = _device->newBuffer(
+      bytes, staged() ? MTL::ResourceStorageModePrivate
+                      : MTL::ResourceStorageModeShared);
+  if (!buffer) {
+    throw std::runtime_error("Failed to allocate Metal buffer");
+  }
+  return GF2GPUMatrix(buffer, rows, cols, stride);
+}
+
+// Called with _chainMutex held
+MTL::CommandBuffer *GF2GPU::chainCommandBuffer() {
+  if (!_chain) {
+    _chain = _commandQueue->commandBuffer();
+    _chain->retain();
+  }
+  return _chain;
+}
+
+// The copy happens now, into a buffer no pending work uses: on the CPU, or
+// for a private buffer by a blit from a staging buffer
+GF2GPUMatrix GF2GPU::upload(const GF2Matrix &m) {
+  GF2GPUMatrix handle = newDeviceMatrix(m.rows(), m.cols());
+  MTL::Buffer *buffer = handle.buffer();
+  if (buffer->storageMode() != MTL::StorageModePrivate) {
+    pack_rows(m, static_cast<uint64_t *>(buffer->contents()), handle.row_stride());
+    return handle;
+  }
+  MTL::Buffer *staging = _bufferPool.acquire(buffer->length());
+  pack_rows(m, static_cast<uint64_t *>(staging->contents()), handle.row_stride());
+  try {
+    copyBuffer(staging, buffer, buffer->length());
+  } catch (...) {
+    _bufferPool.recycle(staging);
+    throw;
+  }
+  _bufferPool.recycle(staging);
+  return handle;
+}
+
+GF2GPUMatrix GF2GPU::zeros(size_t rows, size_t cols) {
+  GF2GPUMatrix handle = newDeviceMatrix(rows, cols);
+  MTL::Buffer *buffer = handle.buffer();
+  if (buffer->storageMode() != MTL::StorageModePrivate) {
+    memset(buffer->contents(), 0, buffer->length());
+    return handle;
+  }
+  std::lock_guard<std::mutex> lock(_chainMutex);
+  MTL::BlitCommandEncoder *blit = chainCommandBuffer()->blitCommandEncoder();
+  blit->fillBuffer(buffer, NS::Range::Make(0, buffer->length()), 0);
+  blit->endEncoding();
+  return handle;
+}
+
+GF2GPUMatrix GF2GPU::random(size_t rows, size_t cols, uint64_t seed) {
+  GF2GPUMatrix handle = newDeviceMatrix(rows, cols);
+  randomFill(handle, seed);
+  return handle;
+}
+
+// One thread per Philox output, two words, over the whole row stride, so
+// the padding is written zero too
+void GF2GPU::randomFill(GF2GPUMatrix &m, uint64_t seed) {
+  if (m.empty()) {
+    throw std::runtime_error("Empty GPU matrix");
+  }
+  if (m.rows() > UINT32_MAX || m.row_stride() > UINT32_MAX) {
+    throw std::runtime_error("Matrix too large for the GPU random fill");
+  }
+  MTL::ComputePipelineState *pipeline = namedPipeline("gf2_random_kernel");
+  if (!pipeline) {
+    throw std::runtime_error("GPU pipeline not initialized.");
+  }
+  GF2RandomParams params;
+  params.rows = static_cast<uint32_t>(m.rows());
+  params.words = static_cast<uint32_t>(m.words_per_row());
+  params.stride = static_cast<uint32_t>(m.row_stride());
+  params.seed_lo = static_cast<uint32_t>(seed);
+  params.seed_hi = static_cast<uint32_t>(seed >> 32);
+  params.last_bits = static_cast<uint32_t>(m.cols() % 64);
+  if (params.rows == 0 || params.stride == 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(_chainMutex);
+  MTL::ComputeCommandEncoder *encoder =
+      chainCommandBuffer()->computeCommandEncoder();
+  encoder->setComputePipelineState(pipeline);
+  encoder->setBuffer(m.buffer(), 0, 0);
+  encoder->setBytes(&params, sizeof(GF2RandomParams), 1);
+  MTL::Size grid = MTL::Size::Make((params.stride + 1) / 2, params.rows, 1);
+  encoder->dispatchThreads(grid, fitGroup(pipeline, grid, 1));
+  encoder->endEncoding();
+}
+
+void GF2GPU::download(const GF2GPUMatrix &m, GF2Matrix &out) {
+  if (out.rows() != m.rows() || out.cols() != m.cols()) {
+    throw std::runtime_error("Download target has the wrong dimensions");
+  }
+  flush();
+  MTL::Buffer *buffer = m.buffer();
+  if (buffer->storageMode() != MTL::StorageModePrivate) {
+    unpack_rows(static_cast<const uint64_t *>(buffer->contents()),
+                m.row_stride(), out);
+    return;
+  }
+  MTL::Buffer *staging = _bufferPool.acquire(buffer->length());
+  try {
+    copyBuffer(buffer, staging, buffer->length());
+    unpack_rows(static_cast<const uint64_t *>(staging->contents()),
+                m.row_stride(), out);
+  } catch (...) {
+    _bufferPool.recycle(staging);
+    throw;
+  }
+  _bufferPool.recycle(staging);
+}
+
+GF2Matrix GF2GPU::download(const GF2GPUMatrix &m) {
+  GF2Matrix out(m.rows(), m.cols());
+  download(m, out);
+  return out;
+}
+
+GF2GPUMatrix GF2GPU::multiply(const GF2GPUMatrix &a, const GF2GPUMatrix &b,
+                              Kernel kernel) {
+  if (a.empty() || b.empty()) {
+    throw std::runtime_error("Empty GPU matrix");
+  }
+  if (a.cols() != b.rows()) {
+    throw std::runtime_error(
+        "Matrix dimensions incompatible for GPU multiplication");
+  }
+  GF2GPUMatrix result = newDeviceMatrix(a.rows(), b.cols());
+  std::lock_guard<std::mutex> lock(_chainMutex);
+  encodeMultiply(chainCommandBuffer(), a, b, result, kernel, nullptr);
+  return result;
+}
+
+// With a b_t scratch handle, B^T goes into it (allocated on first use), so a
+// sequence of products of one shape allocates it once
+void GF2GPU::encodeMultiply(MTL::CommandBuffer *commandBuffer,
+                            const GF2GPUMatrix &a, const GF2GPUMatrix &b,
+                            GF2GPUMatrix &result, Kernel kernel,
+                            GF2GPUMatrix *b_t_scratch) {
+  MTL::ComputePipelineState *pipeline =
+      pipelineFor(kernel, (a.cols() + 63) / 64);
+  if (!pipeline) {
+    throw std::runtime_error("GPU pipeline not initialized.");
+  }
+
   GPUParams params;
   params.a_rows = static_cast<uint32_t>(a.rows());
   params.a_cols = static_cast<uint32_t>(a.cols());
   params.b_cols = static_cast<uint32_t>(b.cols());
-  params.words_per_row_a = static_cast<uint32_t>(words_per_row_a);
-  params.words_per_row_b = static_cast<uint32_t>(words_per_row_b);
-  params.words_per_row_result = static_cast<uint32_t>(words_per_row_result);
-  auto *paramsBuffer = _device->newBuffer(&params, sizeof(GPUParams),
-                                          MTL::ResourceStorageModeShared);
+  params.words_per_row_a = static_cast<uint32_t>(a.row_stride());
+  params.words_per_row_b = static_cast<uint32_t>(b.row_stride());
+  params.words_per_row_result = static_cast<uint32_t>(result.row_stride());
+
+  // The inputs may still be produced by the pending work, so the launch
+  // shapes are not timed here
+  switch (kernel) {
+  case Kernel::Baseline:
+    encodeWordDispatch(commandBuffer, kernel, pipeline, a.buffer(), b.buffer(),
+                       result.buffer(), params, result.words_per_row(), false);
+    break;
+  case Kernel::Transposed:
+  case Kernel::Vectorized:
+  case Kernel::SimdGroup: {
+    if (!namedPipeline("gf2_transpose_kernel")) {
+      throw std::runtime_error("GPU transpose pipeline not initialized.");
+    }
+    GF2GPUMatrix local;
+    GF2GPUMatrix &b_t = b_t_scratch ? *b_t_scratch : local;
+    if (b_t.empty()) {
+      b_t = newDeviceMatrix(b.cols(), b.rows());
+    }
+    encodeTranspose(commandBuffer, b.buffer(), b.rows(), b.cols(),
+                    b.row_stride(), b_t.buffer(), b_t.row_stride());
+    params.words_per_row_b = static_cast<uint32_t>(b_t.row_stride());
+    encodeWordDispatch(commandBuffer, kernel, pipeline, a.buffer(), b_t.buffer(),
+                       result.buffer(), params, result.words_per_row(), false);
+    break;
+  }
+  case Kernel::Tiled:
+    encodeTiledDispatch(commandBuffer, a.buffer(), b.buffer(), result.buffer(),
+                        params);
+    break;
+  case Kernel::M4R: {
+    const size_t panel_words = m4rPanelWords(a.cols(), b.row_stride());
+    const size_t table_bytes =
+        panel_words * 8 * 256 * b.row_stride() * sizeof(uint64_t);
+    MTL::Buffer *bufferTables =
+        _device->newBuffer(table_bytes, MTL::ResourceStorageModePrivate);
+    if (!bufferTables) {
+      throw std::runtime_error("Failed to allocate Metal buffer");
+    }
+    GPUBatchParams batch = {1, 0, 0, 0, 0};
+    encodeM4RPanels(commandBuffer, a.buffer(), 0, b.buffer(), 0, result.buffer(),
+                    0, bufferTables, params, batch, panel_words);
+    bufferTables->release();
+    break;
+  }
+  }
+}
+
+GF2GPUMatrix GF2GPU::power(const GF2GPUMatrix &a, uint64_t n, Kernel kernel) {
+  if (a.empty()) {
+    throw std::runtime_error("Empty GPU matrix");
+  }
+  if (a.rows() != a.cols()) {
+    throw std::runtime_error("Only square matrices have powers");
+  }
+  if (n == 0) {
+    GF2Matrix identity(a.rows(), a.cols());
+    for (size_t i = 0; i < a.rows(); ++i) {
+      identity.set(i, i, true);
+    }
+    return upload(identity);
+  }
+  const size_t bytes = a.rows() * a.row_stride() * sizeof(uint64_t);
+  GF2GPUMatrix square = newDeviceMatrix(a.rows(), a.cols());
+  GF2GPUMatrix spare = newDeviceMatrix(a.rows(), a.cols());
+  GF2GPUMatrix result;
+  GF2GPUMatrix b_t;
+
+  // The steps run in encoding order, so a buffer is rewritten only after
+  // the products reading it
+  std::lock_guard<std::mutex> lock(_chainMutex);
+  MTL::CommandBuffer *commandBuffer = chainCommandBuffer();
+  encodeCopy(commandBuffer, a.buffer(), square.buffer(), bytes);
+  for (;;) {
+    if (n & 1) {
+      if (result.empty()) {
+        result = newDeviceMatrix(a.rows(), a.cols());
+        encodeCopy(commandBuffer, square.buffer(), result.buffer(), bytes);
+      } else {
+        encodeMultiply(commandBuffer, result, square, spare, kernel, &b_t);
+        std::swap(result, spare);
+      }
+    }
+    n >>= 1;
+    if (n == 0) {
+      return result;
+    }
+    encodeMultiply(commandBuffer, square, square, spare, kernel, &b_t);
+    std::swap(square, spare);
+  }
+}
+
+GF2GPUMatrix GF2GPU::add(const GF2GPUMatrix &a, const GF2GPUMatrix &b) {
+  if (a.empty() || b.empty()) {
+    throw std::runtime_error("Empty GPU matrix");
+  }
+  if (a.rows() != b.rows() || a.cols() != b.cols()) {
+    throw std::runtime_error("Matrix dimensions don't match for addition");
+  }
+  MTL::ComputePipelineState *pipeline = namedPipeline("gf2_add_kernel");
+  if (!pipeline) {
+    throw std::runtime_error("GPU pipeline not initialized.");
+  }
+
+  GF2GPUMatrix result = newDeviceMatrix(a.rows(), a.cols());
+  GF2AddParams params;
+  params.rows = static_cast<uint32_t>(a.rows());
+  params.words = static_cast<uint32_t>(a.words_per_row());
+  params.a_stride = static_cast<uint32_t>(a.row_stride());
+  params.b_stride = static_cast<uint32_t>(b.row_stride());
+  params.result_stride = static_cast<uint32_t>(result.row_stride());
+
+  std::lock_guard<std::mutex> lock(_chainMutex);
+  MTL::ComputeCommandEncoder *encoder =
+      chainCommandBuffer()->computeCommandEncoder();
+  encoder->setComputePipelineState(pipeline);
+  encoder->setBuffer(a.buffer(), 0, 0);
+  encoder->setBuffer(b.buffer(), 0, 1);
+  encoder->setBuffer(result.buffer(), 0, 2);
+  encoder->setBytes(&params, sizeof(GF2AddParams), 3);
+  MTL::Size grid = MTL::Size::Make(params.words, params.rows, 1);
+  encoder->dispatchThreads(grid, fitGroup(pipeline, grid, 1));
+  encoder->endEncoding();
+  return result;
+}
+
+GF2GPUMatrix GF2GPU::transpose(const GF2GPUMatrix &m) {
+  if (m.empty()) {
+    throw std::runtime_error("Empty GPU matrix");
+  }
+  if (!namedPipeline("gf2_transpose_kernel")) {
+    throw std::runtime_error("GPU transpose pipeline not initialized.");
+  }
+  GF2GPUMatrix result = newDeviceMatrix(m.cols(), m.rows());
+  std::lock_guard<std::mutex> lock(_chainMutex);
+  encodeTranspose(chainCommandBuffer(), m.buffer(), m.rows(), m.cols(),
+                  m.row_stride(), result.buffer(), result.row_stride());
+  return result;
+}
+
+void GF2GPU::flush() {
+  MTL::CommandBuffer *commandBuffer;
+  {
+    std::lock_guard<std::mutex> lock(_chainMutex);
+    commandBuffer = _chain;
+    _chain = nullptr;
+  }
+  if (!commandBuffer) {
+    return;
+  }
+  commandBuffer->commit();
+  {
+    GF2_TRACE_SCOPE("gpu: wait");
+    commandBuffer->waitUntilCompleted();
+  }
+
+  bool failed = commandBuffer->status() == MTL::CommandBufferStatusError;
+  std::string message;
+  if (failed && commandBuffer->error()) {
+    message = commandBuffer->error()->localizedDescription()->utf8String();
+  }
+  GF2_TRACE_GPU("gpu: chain", commandBuffer->GPUStartTime(), commandBuffer->GPUEndTime(),
+                commandBuffer->GPUEndTime());
+  GF2GPUTiming timing;
+  timing.gpu_ms =
+      (commandBuffer->GPUEndTime() - commandBuffer->GPUStartTime()) * 1000.0;
+  commandBuffer->release();
+  if (failed) {
+    throw std::runtime_error("GPU command buffer failed: " + message);
+  }
+  std::lock_guard<std::mutex> lock(_timingMutex);
+  _lastTiming = timing;
+  samplePeakAllocated();
+}
+
+// --- Elimination ---
+
+size_t GF2GPU::rank(const GF2Matrix &a) {
+  CaptureScope capture(*this, "rank");
+  return eliminate(a, nullptr);
+}
+
+GF2Matrix GF2GPU::echelonForm(const GF2Matrix &a) {
+  CaptureScope capture(*this, "echelonForm");
+  GF2Matrix echelon(a.rows(), a.cols());
+  eliminate(a, &echelon);
+  return echelon;
+}
+
+// Rows stay where they are: the pivot rows of a panel are marked used, and
+// the echelon form is read out in pivot order at the end. The CPU reduces
+// the panel words of the unused rows against the panel's pivots found so
+// far, recording in mask[i] the pivot rows that clear row i. A pivot row's
+// own mask turns it into a row of the echelon form with its leading one in
+// its pivot column. The GPU computes W += mask * T for the gathered pivot
+// rows T, from the panel's word on; left of it the unused rows are zero.
+// Each command buffer ends with the copy of the next panel's words, so the
+// CPU waits once per panel.
+size_t GF2GPU::eliminate(const GF2Matrix &a, GF2Matrix *echelon) {
+  const size_t m = a.rows(), words = a.words_per_row();
+  if (m == 0 || words == 0) {
+    return 0;
+  }
+  if (m > UINT32_MAX || m * default_stride(a.cols()) * sizeof(uint64_t) >
+                            _device->maxBufferLength()) {
+    throw std::runtime_error("Matrix too large for GPU elimination");
+  }
+  if (!namedPipeline("gf2_copy_kernel") ||
+      !namedPipeline("gf2_gather_rows_kernel") ||
+      !namedPipeline("m4r_make_tables_kernel") ||
+      !namedPipeline("m4r_multiply_kernel")) {
+    throw std::runtime_error("GPU pipeline not initialized.");
+  }
+  GF2_TRACE_SCOPE("gpu: eliminate");
+
+  GF2GPUMatrix w = upload(a);
+  const size_t stride = w.row_stride();
+  std::vector<MTL::Buffer *> pooled;
+  auto acquire = [&](size_t bytes, MTL::StorageMode mode = MTL::StorageModeShared) {
+    pooled.push_back(_bufferPool.acquire(bytes, mode));
+    return pooled.back();
+  };
+  auto wait = [](MTL::CommandBuffer *commandBuffer) {
+    commandBuffer->commit();
+    commandBuffer->waitUntilCompleted();
+    if (commandBuffer->status() == MTL::CommandBufferStatusError) {
+      std::string message;
+      if (commandBuffer->error()) {
+        message = commandBuffer->error()->localizedDescription()->utf8String();
+      }
+      throw std::runtime_error("GPU command buffer failed: " + message);
+    }
+  };
+
+  std::vector<size_t> pivot_rows;
+  try {
+    MTL::Buffer *bufferWords = acquire(m * sizeof(uint64_t), MTL::StorageModeShared);
+    MTL::Buffer *bufferMask = acquire(m * sizeof(uint64_t), MTL::StorageModeShared);
+    MTL::Buffer *bufferRows = acquire(64 * sizeof(uint32_t), MTL::StorageModeShared);
+    MTL::Buffer *bufferPivots =
+        acquire(64 * words * sizeof(uint64_t), gpuStorage());
+    MTL::Buffer *bufferTables =
+        acquire(8 * 256 * words * sizeof(uint64_t), gpuStorage());
+    const uint64_t *panel_words =
+        static_cast<const uint64_t *>(bufferWords->contents());
+    uint64_t *mask = static_cast<uint64_t *>(bufferMask->contents());
+    uint32_t *rows = static_cast<uint32_t *>(bufferRows->contents());
+    std::vector<char> used(m, 0);
+
+    // Word c of every row into bufferWords
+    auto encodePanelWords = [&](MTL::CommandBuffer *commandBuffer, size_t c) {
+      encodeCopyBlock(commandBuffer, {bufferWords, 0, 1, m, 1},
+                      {w.buffer(), c, stride, m, 1});
+    };
+
+    MTL::CommandBuffer *commandBuffer = _commandQueue->commandBuffer();
+    encodePanelWords(commandBuffer, 0);
+    for (size_t c = 0; c < words; ++c) {
+      wait(commandBuffer);
+
+      // value[t] = the pivot rows in combo[t] summed (bit t: row rows[t]),
+      // its lowest bit the pivot column; slot[col] = t
+      uint64_t value[64], combo[64];
+      int slot[64];
+      std::fill(slot, slot + 64, -1);
+      size_t found = 0;
+      std::fill(mask, mask + m, 0);
+      for (size_t i = 0; i < m; ++i) {
+        if (used[i]) {
+          continue;
+        }
+        uint64_t v = panel_words[i], x = 0;
+        while (v && slot[__builtin_ctzll(v)] >= 0) {
+          const int t = slot[__builtin_ctzll(v)];
+          v ^= value[t];
+          x ^= combo[t];
+        }
+        if (v) {
+          value[found] = v;
+          combo[found] = x ^ (uint64_t(1) << found);
+          slot[__builtin_ctzll(v)] = static_cast<int>(found);
+          rows[found] = static_cast<uint32_t>(i);
+          mask[i] = x;
+          used[i] = 1;
+          ++found;
+        } else {
+          mask[i] = x;
+        }
+      }
+
+      commandBuffer = _commandQueue->commandBuffer();
+      if (found > 0) {
+        for (size_t col = 0; col < 64; ++col) {
+          if (slot[col] >= 0) {
+            pivot_rows.push_back(rows[slot[col]]);
+          }
+        }
+
+        // T = the pivot rows from word c on
+        const size_t width = words - c;
+        GF2GatherParams gather;
+        gather.rows = static_cast<uint32_t>(found);
+        gather.words = static_cast<uint32_t>(width);
+        gather.src_stride = static_cast<uint32_t>(stride);
+        gather.dst_stride = static_cast<uint32_t>(width);
+        MTL::ComputePipelineState *pipeline =
+            namedPipeline("gf2_gather_rows_kernel");
+        MTL::ComputeCommandEncoder *encoder =
+            commandBuffer->computeCommandEncoder();
+        encoder->setComputePipelineState(pipeline);
+        encoder->setBuffer(w.buffer(), c * sizeof(uint64_t), 0);
+        encoder->setBuffer(bufferPivots, 0, 1);
+        encoder->setBuffer(bufferRows, 0, 2);
+        encoder->setBytes(&gather, sizeof(GF2GatherParams), 3);
+        MTL::Size grid = MTL::Size::Make(width, found, 1);
+        encoder->dispatchThreads(grid, fitGroup(pipeline, grid, 1));
+        encoder->endEncoding();
+
+        // W += mask * T, a product with a common dimension of 'found'
+        GPUParams params;
+        params.a_rows = static_cast<uint32_t>(m);
+        params.a_cols = static_cast<uint32_t>(found);
+        params.b_cols = static_cast<uint32_t>(width * 64);
+        params.words_per_row_a = 1;
+        params.words_per_row_b = static_cast<uint32_t>(width);
+        params.words_per_row_result = static_cast<uint32_t>(stride);
+        GPUBatchParams batch = {1, 0, 0, 0, 0};
+        encodeM4RPanels(commandBuffer, bufferMask, 0, bufferPivots, 0,
+                        w.buffer(), c * sizeof(uint64_t), bufferTables, params,
+                        batch, 1, GF2Semiring::XorAnd, true);
+      }
+      if (pivot_rows.size() == m) {
+        break;
+      }
+      if (c + 1 < words) {
+        encodePanelWords(commandBuffer, c + 1);
+      }
+    }
+    wait(commandBuffer);
+  } catch (...) {
+    for (MTL::Buffer *buffer : pooled) {
+      _bufferPool.recycle(buffer);
+    }
+    throw;
+  }
+  for (MTL::Buffer *buffer : pooled) {
+    _bufferPool.recycle(buffer);
+  }
+
+  if (echelon) {
+    GF2Matrix reduced = download(w);
+    for (size_t j = 0; j < pivot_rows.size(); ++j) {
+      std::copy_n(reduced.get_raw_data() + pivot_rows[j] * reduced.row_stride(),
+                  reduced.words_per_row(),
+                  echelon->get_raw_data() + j * echelon->row_stride());
+    }
+  }
+  return pivot_rows.size();
+}
+
+// --- Recorded plans ---
+
+GF2GPUPlan::~GF2GPUPlan() {
+  for (MTL::Buffer *buffer : {_a, _b, _bTransposed, _result, _params}) {
+    if (buffer)
+      buffer->release();
+  }
+  if (_commands)
+    _commands->release();
+}
+
+// The parameter structs live in slots of this size of the plan's parameter
+// buffer, which keeps the offsets of constant buffers aligned
+constexpr size_t PLAN_PARAM_SLOT = 256;
+
+std::unique_ptr<GF2GPUPlan> GF2GPU::recordPlan(Kernel kernel, size_t a_rows,
+                                               size_t a_cols, size_t b_cols) {
+  if (kernel == Kernel::Tiled || kernel == Kernel::M4R) {
+    throw std::runtime_error("Only the word kernels can be recorded into a plan");
+  }
+  if (needsOutOfCore(a_rows, a_cols, b_cols)) {
+    throw std::runtime_error(
+        "Product too large for single GPU buffers; use multiplyGPUOutOfCore");
+  }
+  const bool transposed = kernel != Kernel::Baseline;
+  MTL::ComputePipelineState *pipeline =
+      pipelineFor(kernel, (a_cols + 63) / 64, true);
+  MTL::ComputePipelineState *transposePipeline =
+      transposed ? namedPipeline("gf2_transpose_kernel", 0, true) : nullptr;
+  if (!pipeline || (transposed && !transposePipeline)) {
+    throw std::runtime_error("GPU pipeline not initialized.");
+  }
+
+  std::unique_ptr<GF2GPUPlan> plan(new GF2GPUPlan());
+  plan->_kernel = kernel;
+  plan->_aRows = a_rows;
+  plan->_aCols = a_cols;
+  plan->_bCols = b_cols;
+  plan->_aStride = default_stride(a_cols);
+  plan->_bStride = default_stride(b_cols);
+  plan->_resultStride = default_stride(b_cols);
+  const size_t b_t_stride = default_stride(a_cols);
+
+  auto new_buffer = [this](size_t bytes, MTL::ResourceOptions options) {
+    MTL::Buffer *buffer =
+        _device->newBuffer(std::max<size_t>(bytes, 1), options);
+    if (!buffer) {
+      throw std::runtime_error("Failed to allocate Metal buffer");
+    }
+    return buffer;
+  };
+  // The host sees A, B and C; the padding words start out zero
+  auto host_buffer = [&](size_t words) {
+    MTL::Buffer *buffer =
+        new_buffer(words * sizeof(uint64_t), MTL::ResourceStorageModeShared);
+    memset(buffer->contents(), 0, buffer->length());
+    return buffer;
+  };
+  plan->_a = host_buffer(a_rows * plan->_aStride);
+  plan->_b = host_buffer(a_cols * plan->_bStride);
+  plan->_result = host_buffer(a_rows * plan->_resultStride);
+  if (transposed) {
+    // Written whole by the transpose, padding included
+    plan->_bTransposed = new_buffer(b_cols * b_t_stride * sizeof(uint64_t),
+                                    MTL::ResourceStorageModePrivate);
+  }
+
+  GPUParams params;
+  params.a_rows = static_cast<uint32_t>(a_rows);
+  params.a_cols = static_cast<uint32_t>(a_cols);
+  params.b_cols = static_cast<uint32_t>(b_cols);
+  params.words_per_row_a = static_cast<uint32_t>(plan->_aStride);
+  params.words_per_row_b =
+      static_cast<uint32_t>(transposed ? b_t_stride : plan->_bStride);
+  params.words_per_row_result = static_cast<uint32_t>(plan->_resultStride);
+  GPUBatchParams batch = {1, 0, 0, 0, 0};
+  GF2TransposeParams transposeParams;
+  transposeParams.rows = static_cast<uint32_t>(a_cols);
+  transposeParams.cols = static_cast<uint32_t>(b_cols);
+  transposeParams.src_stride = static_cast<uint32_t>(plan->_bStride);
+  transposeParams.dst_stride = static_cast<uint32_t>(b_t_stride);
+
+  plan->_params = new_buffer(3 * PLAN_PARAM_SLOT, MTL::ResourceStorageModeShared);
+  char *slots = static_cast<char *>(plan->_params->contents());
+  memcpy(slots, &params, sizeof(GPUParams));
+  memcpy(slots + PLAN_PARAM_SLOT, &batch, sizeof(GPUBatchParams));
+  memcpy(slots + 2 * PLAN_PARAM_SLOT, &transposeParams,
+         sizeof(GF2TransposeParams));
+
+  MTL::IndirectCommandBufferDescriptor *descriptor =
+      MTL::IndirectCommandBufferDescriptor::alloc()->init();
+  descriptor->setCommandTypes(MTL::IndirectCommandTypeConcurrentDispatch |
+                              MTL::IndirectCommandTypeConcurrentDispatchThreads);
+  descriptor->setInheritPipelineState(false);
+  descriptor->setInheritBuffers(false);
+  descriptor->setMaxKernelBufferBindCount(5);
+  plan->_commandCount = transposed ? 2 : 1;
+  plan->_commands = _device->newIndirectCommandBuffer(
+      descriptor, plan->_commandCount, MTL::ResourceStorageModeShared);
+  descriptor->release();
+  if (!plan->_commands) {
+    throw std::runtime_error("Failed to create indirect command buffer");
+  }
+
+  NS::UInteger index = 0;
+  if (transposed) {
+    MTL::IndirectComputeCommand *command =
+        plan->_commands->indirectComputeCommand(index++);
+    command->setComputePipelineState(transposePipeline);
+    command->setKernelBuffer(plan->_b, 0, 0);
+    command->setKernelBuffer(plan->_bTransposed, 0, 1);
+    command->setKernelBuffer(plan->_params, 2 * PLAN_PARAM_SLOT, 2);
+    command->concurrentDispatchThreadgroups(
+        MTL::Size::Make(b_t_stride, (b_cols + 63) / 64, 1),
+        MTL::Size::Make(64, 1, 1));
+  }
+
+  MTL::IndirectComputeCommand *command =
+      plan->_commands->indirectComputeCommand(index);
+  command->setComputePipelineState(pipeline);
+  command->setKernelBuffer(plan->_a, 0, 0);
+  command->setKernelBuffer(transposed ? plan->_bTransposed : plan->_b, 0, 1);
+  command->setKernelBuffer(plan->_result, 0, 2);
+  command->setKernelBuffer(plan->_params, 0, 3);
+  command->setKernelBuffer(plan->_params, PLAN_PARAM_SLOT, 4);
+  // The buffers hold no data yet, so the launch shape is the cached or
+  // fitted one rather than timed here
+  MTL::Size grid = wordKernelGrid(kernel, a_rows, (b_cols + 63) / 64, 1);
+  command->concurrentDispatchThreads(
+      grid, wordKernelGroup(kernel, pipeline, grid, EncoderBinder()));
+  if (transposed) {
+    // Waits for B^T
+    command->setBarrier();
+  }
+  return plan;
+}
+
+void GF2GPU::runPlan(GF2GPUPlan &plan, const GF2Matrix &a, const GF2Matrix &b,
+                     GF2Matrix &result) {
+  CaptureScope capture(*this, "runPlan");
+  if (a.rows() != plan.a_rows() || a.cols() != plan.a_cols() ||
+      b.rows() != plan.a_cols() || b.cols() != plan.b_cols()) {
+    throw std::runtime_error("Operands do not match the recorded plan");
+  }
+  if (result.rows() != a.rows() || result.cols() != b.cols()) {
+    throw std::runtime_error("GPU result matrix has the wrong dimensions");
+  }
+  auto start = std::chrono::steady_clock::now();
+  pack_rows(a, plan.a_data(), plan.a_stride());
+  pack_rows(b, plan.b_data(), plan.b_stride());
+  const double upload_ms = elapsed_ms(start);
+
+  runPlan(plan);
+
+  start = std::chrono::steady_clock::now();
+  unpack_rows(plan.result_data(), plan.result_stride(), result);
+  std::lock_guard<std::mutex> lock(_timingMutex);
+  _lastTiming.upload_ms = upload_ms;
+  _lastTiming.readback_ms = elapsed_ms(start);
+}
+
+// One command buffer with a single encoder that executes the recorded
+// commands; nothing is bound or dispatched on the host
+void GF2GPU::runPlan(GF2GPUPlan &plan) {
+  CaptureScope capture(*this, "runPlan");
   MTL::CommandBuffer *commandBuffer = _commandQueue->commandBuffer();
   MTL::ComputeCommandEncoder *encoder = commandBuffer->computeCommandEncoder();
-  encoder->setComputePipelineState(_computePipeline);
-  encoder->setBuffer(bufferA, 0, 0);
-  encoder->setBuffer(bufferB, 0, 1);
-  encoder->setBuffer(bufferResult, 0, 2);
-  encoder->setBuffer(paramsBuffer, 0, 3);
-  MTL::Size threadsPerGroup = MTL::Size::Make(16, 16, 1);
-  MTL::Size gridSize = MTL::Size::Make(a.rows(), words_per_row_result, 1);
-  encoder->dispatchThreads(gridSize, threadsPerGroup);
+  // The encoder does not see the buffers bound inside the indirect command
+  // buffer, so they are declared here
+  encoder->useResource(plan._a, MTL::ResourceUsageRead);
+  encoder->useResource(plan._b, MTL::ResourceUsageRead);
+  if (plan._bTransposed) {
+    encoder->useResource(plan._bTransposed,
+                         MTL::ResourceUsageRead | MTL::ResourceUsageWrite);
+  }
+  encoder->useResource(plan._result, MTL::ResourceUsageWrite);
+  encoder->useResource(plan._params, MTL::ResourceUsageRead);
+  encoder->executeCommandsInBuffer(plan._commands,
+                                   NS::Range::Make(0, plan._commandCount));
   encoder->endEncoding();
   commandBuffer->commit();
-  commandBuffer->waitUntilCompleted();
-  memcpy(const_cast<uint64_t *>(result.get_raw_data()),
-         bufferResult->contents(), buffer_size_result);
-  bufferA->release();
-  bufferB->release();
-  bufferResult->release();
-  paramsBuffer->release();
+  {
+    GF2_TRACE_SCOPE("gpu: wait");
+    commandBuffer->waitUntilCompleted();
+  }
+
+  if (commandBuffer->status() == MTL::CommandBufferStatusError) {
+    std::string message;
+    if (commandBuffer->error()) {
+      message = commandBuffer->error()->localizedDescription()->utf8String();
+    }
+    throw std::runtime_error("GPU command buffer failed: " + message);
+  }
+  GF2_TRACE_GPU("gpu: plan", commandBuffer->GPUStartTime(), commandBuffer->GPUEndTime(),
+                commandBuffer->GPUEndTime());
+  GF2GPUTiming timing;
+  timing.gpu_ms =
+      (commandBuffer->GPUEndTime() - commandBuffer->GPUStartTime()) * 1000.0;
+  std::lock_guard<std::mutex> lock(_timingMutex);
+  _lastTiming = timing;
+  samplePeakAllocated();
+}
+
+// --- Batched entry point ---
+
+void GF2GPU::multiplyGPUBatched(Kernel kernel, const std::vector<GF2Matrix> &a,
+                                const std::vector<GF2Matrix> &b,
+                                std::vector<GF2Matrix> &results) {
+  CaptureScope capture(*this, "multiplyGPUBatched");
+  auto start = std::chrono::steady_clock::now();
+  GF2GPUTiming timing;
+  if (a.size() != b.size()) {
+    throw std::runtime_error("Batched GPU multiply needs as many B as A");
+  }
+  if (kernel == Kernel::Tiled) {
+    throw std::runtime_error("The tiled GPU kernel has no batched form.");
+  }
+  const size_t count = a.size();
+  if (count == 0) {
+    results.clear();
+    return;
+  }
+
+  const size_t a_rows = a[0].rows(), a_cols = a[0].cols();
+  const size_t b_rows = b[0].rows(), b_cols = b[0].cols();
+  if (a_cols != b_rows) {
+    throw std::runtime_error(
+        "Matrix dimensions incompatible for GPU multiplication");
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if (a[i].rows() != a_rows || a[i].cols() != a_cols ||
+        b[i].rows() != b_rows || b[i].cols() != b_cols) {
+      throw std::runtime_error("Batched GPU multiply needs equal shapes");
+    }
+  }
+  MTL::ComputePipelineState *pipeline = pipelineFor(kernel, (a_cols + 63) / 64);
+  if (!pipeline) {
+    throw std::runtime_error("GPU pipeline not initialized.");
+  }
+
+  bool reuse = results.size() == count;
+  for (size_t i = 0; reuse && i < count; ++i) {
+    reuse = results[i].rows() == a_rows && results[i].cols() == b_cols;
+  }
+  if (!reuse) {
+    results.assign(count, GF2Matrix(a_rows, b_cols));
+  }
+
+  // All products are packed back to back with the default row strides; the
+  // transposed, vectorized and SIMD-group kernels read B^T
+  const bool transposed = kernel == Kernel::Transposed ||
+                          kernel == Kernel::Vectorized ||
+                          kernel == Kernel::SimdGroup;
+  const size_t a_stride = default_stride(a_cols);
+  const size_t b_packed_rows = transposed ? b_cols : b_rows;
+  const size_t b_stride = default_stride(transposed ? b_rows : b_cols);
+  const size_t result_stride = default_stride(b_cols);
+  const size_t result_words = (b_cols + 63) / 64;
+
+  GPUBatchParams batch;
+  batch.count = static_cast<uint32_t>(count);
+  batch.a_words = static_cast<uint32_t>(a_rows * a_stride);
+  batch.b_words = static_cast<uint32_t>(b_packed_rows * b_stride);
+  batch.result_words = static_cast<uint32_t>(a_rows * result_stride);
+  batch.table_words = 0;
+
+  // The submission only holds the buffers, so that they go back to the pool
+  // if packing or encoding throws
+  auto sub = newSubmission();
+  auto acquire = [&](size_t bytes, MTL::StorageMode mode = MTL::StorageModeShared) {
+    MTL::Buffer *buffer = _bufferPool.acquire(bytes, mode);
+    sub->buffers.push_back({buffer, nullptr});
+    return buffer;
+  };
+  auto *bufferA = acquire(count * batch.a_words * sizeof(uint64_t));
+  auto *bufferB = acquire(count * batch.b_words * sizeof(uint64_t));
+  auto *bufferResult = acquire(count * batch.result_words * sizeof(uint64_t));
+
+  // Packing the operands is their upload; the B^T transposes are part of it
+  auto upload_start = std::chrono::steady_clock::now();
+  uint64_t *a_data = static_cast<uint64_t *>(bufferA->contents());
+  uint64_t *b_data = static_cast<uint64_t *>(bufferB->contents());
+  for (size_t i = 0; i < count; ++i) {
+    pack_rows(a[i], a_data + i * batch.a_words, a_stride);
+    uint64_t *b_dst = b_data + i * batch.b_words;
+    if (transposed) {
+      memset(b_dst, 0, batch.b_words * sizeof(uint64_t));
+      transpose_matrix(b[i].get_raw_data(), b[i].row_stride(), b_dst,
+                       b_stride, b_rows, b_cols);
+    } else {
+      pack_rows(b[i], b_dst, b_stride);
+    }
+  }
+
+  // With private storage the kernels use blitted copies of the packed
+  // operands and of the result
+  MTL::CommandBuffer *commandBuffer = sub->commandBuffer;
+  const bool stage = staged();
+  MTL::Buffer *deviceA = bufferA, *deviceB = bufferB, *deviceResult = bufferResult;
+  if (stage) {
+    deviceA = stageIn(commandBuffer, bufferA, count * batch.a_words * sizeof(uint64_t));
+    sub->buffers.push_back({deviceA, nullptr});
+    deviceB = stageIn(commandBuffer, bufferB, count * batch.b_words * sizeof(uint64_t));
+    sub->buffers.push_back({deviceB, nullptr});
+    deviceResult = acquire(count * batch.result_words * sizeof(uint64_t),
+                           MTL::StorageModePrivate);
+  }
+  timing.upload_ms = elapsed_ms(upload_start);
+
+  GPUParams params;
+  params.a_rows = static_cast<uint32_t>(a_rows);
+  params.a_cols = static_cast<uint32_t>(a_cols);
+  params.b_cols = static_cast<uint32_t>(b_cols);
+  params.words_per_row_a = static_cast<uint32_t>(a_stride);
+  params.words_per_row_b = static_cast<uint32_t>(b_stride);
+  params.words_per_row_result = static_cast<uint32_t>(result_stride);
+
+  MTL::Buffer *bufferLookupTables = nullptr;
+
+  if (kernel != Kernel::M4R) {
+    // One dispatch for the whole batch, the product index in z
+    auto bind = [&](MTL::ComputeCommandEncoder *encoder) {
+      encoder->setBuffer(deviceA, 0, 0);
+      encoder->setBuffer(deviceB, 0, 1);
+      encoder->setBuffer(deviceResult, 0, 2);
+      encoder->setBytes(&params, sizeof(GPUParams), 3);
+      encoder->setBytes(&batch, sizeof(GPUBatchParams), 4);
+    };
+    MTL::Size grid = wordKernelGrid(kernel, a_rows, result_words, count);
+    MTL::Size group = wordKernelGroup(kernel, pipeline, grid,
+                                      stage ? EncoderBinder() : EncoderBinder(bind));
+
+    MTL::ComputeCommandEncoder *encoder = commandBuffer->computeCommandEncoder();
+    encoder->setComputePipelineState(pipeline);
+    bind(encoder);
+    encoder->dispatchThreads(grid, group);
+    encoder->endEncoding();
+  } else {
+    // Every product needs its own tables, so the batch is split into chunks
+    // whose panel tables fit in MAX_BATCH_TABLE_BYTES; the chunks reuse one
+    // table buffer and are ordered by Metal's hazard tracking
+    const size_t panel_words = m4rPanelWords(a_cols, b_stride);
+    const size_t table_words = panel_words * 8 * 256 * b_stride;
+    const size_t chunk = std::max<size_t>(
+        1, std::min(count, MAX_BATCH_TABLE_BYTES / (table_words * sizeof(uint64_t))));
+    bufferLookupTables = acquire(chunk * table_words * sizeof(uint64_t), gpuStorage());
+    batch.table_words = static_cast<uint32_t>(table_words);
+
+    for (size_t c0 = 0; c0 < count; c0 += chunk) {
+      GPUBatchParams part = batch;
+      part.count = static_cast<uint32_t>(std::min(chunk, count - c0));
+      encodeM4RPanels(commandBuffer, deviceA, c0 * batch.a_words * sizeof(uint64_t),
+                      deviceB, c0 * batch.b_words * sizeof(uint64_t), deviceResult,
+                      c0 * batch.result_words * sizeof(uint64_t), bufferLookupTables,
+                      params, part, panel_words);
+    }
+  }
+  if (stage) {
+    encodeCopy(commandBuffer, deviceResult, bufferResult,
+               count * batch.result_words * sizeof(uint64_t));
+  }
+
+  timing.host_ms = elapsed_ms(start) - timing.upload_ms;
+  sub->committed = true;
+  commandBuffer->commit();
+  {
+    GF2_TRACE_SCOPE("gpu: wait");
+    commandBuffer->waitUntilCompleted();
+  }
+  GF2_TRACE_GPU("gpu: batch", commandBuffer->GPUStartTime(), commandBuffer->GPUEndTime(),
+                commandBuffer->GPUEndTime());
+  timing.gpu_ms =
+      (commandBuffer->GPUEndTime() - commandBuffer->GPUStartTime()) * 1000.0;
+
+  auto readback_start = std::chrono::steady_clock::now();
+  const uint64_t *result_data =
+      static_cast<const uint64_t *>(bufferResult->contents());
+  for (size_t i = 0; i < count; ++i) {
+    unpack_rows(result_data + i * batch.result_words, result_stride, results[i]);
+  }
+  timing.readback_ms = elapsed_ms(readback_start);
+  {
+    std::lock_guard<std::mutex> lock(_timingMutex);
+    _lastTiming = timing;
+    samplePeakAllocated();
+  }
+
+  releaseBuffers(*sub);
+}
+
+// --- Asynchronous entry points ---
+
+void GF2GPU::multiplyAsync(Kernel kernel, const GF2Matrix &a,
+                           const GF2Matrix &b, GF2Matrix &result,
+                           CompletionHandler done) {
+  CaptureScope capture(*this, captureName(kernel));
+  submit(encode(kernel, a, b, result), std::move(done));
+}
+
+void GF2GPU::multiplyAsync(Kernel kernel, const GF2Matrix &a,
+                           const GF2PackedOperand &b, GF2Matrix &result,
+                           CompletionHandler done) {
+  CaptureScope capture(*this, captureName(kernel));
+  submit(encode(kernel, a, b, result), std::move(done));
+}
+
+std::future<void> GF2GPU::multiplyAsync(Kernel kernel, const GF2Matrix &a,
+                                        const GF2Matrix &b,
+                                        GF2Matrix &result) {
+  auto promise = std::make_shared<std::promise<void>>();
+  std::future<void> future = promise->get_future();
+  multiplyAsync(kernel, a, b, result, [promise](std::exception_ptr error) {
+    if (error) {
+      promise->set_exception(error);
+    } else {
+      promise->set_value();
+    }
+  });
+  return future;
+}
+
+std::future<void> GF2GPU::multiplyAsync(Kernel kernel, const GF2Matrix &a,
+                                        const GF2PackedOperand &b,
+                                        GF2Matrix &result) {
+  auto promise = std::make_shared<std::promise<void>>();
+  std::future<void> future = promise->get_future();
+  multiplyAsync(kernel, a, b, result, [promise](std::exception_ptr error) {
+    if (error) {
+      promise->set_exception(error);
+    } else {
+      promise->set_value();
+    }
+  });
+  return future;
 }
 
 // Benchmark and other helpers remain unchanged
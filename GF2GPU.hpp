@@ -2,47 +2,405 @@
 
 #include "Foundation/Foundation.hpp"
 #include "Metal/Metal.hpp"
+#include "GF2Backend.hpp"
 #include "GF2Matrix.hpp"
+#include "GF2PackedOperand.hpp"
+#include "GF2MetalBufferPool.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
 #include <vector>
 
-class GF2GPU {
+// A matrix held in a GPU buffer, bit-packed like GF2Matrix with rows padded
+// to row_stride() words. Handles come from GF2GPU::upload() and from the
+// device operations of GF2GPU; they own their buffer and are move-only. With
+// GF2GPU::Storage::Private the buffer is not visible to the CPU.
+class GF2GPUMatrix {
 public:
+    GF2GPUMatrix() = default;
+    ~GF2GPUMatrix();
+    GF2GPUMatrix(GF2GPUMatrix&& other) noexcept;
+    GF2GPUMatrix& operator=(GF2GPUMatrix&& other) noexcept;
+    GF2GPUMatrix(const GF2GPUMatrix&) = delete;
+    GF2GPUMatrix& operator=(const GF2GPUMatrix&) = delete;
+
+    size_t rows() const { return _rows; }
+    size_t cols() const { return _cols; }
+    size_t words_per_row() const { return (_cols + 63) / 64; }
+    size_t row_stride() const { return _stride; }
+    bool empty() const { return _buffer == nullptr; }
+    MTL::Buffer* buffer() const { return _buffer; }
+
+private:
+    friend class GF2GPU;
+    GF2GPUMatrix(MTL::Buffer* buffer, size_t rows, size_t cols, size_t stride)
+        : _buffer(buffer), _rows(rows), _cols(cols), _stride(stride) {}
+
+    MTL::Buffer* _buffer = nullptr;
+    size_t _rows = 0;
+    size_t _cols = 0;
+    size_t _stride = 0;
+};
+
+class GF2GPUPlan;
+
+// The Metal backend. It has every kernel and, beyond GF2Backend, batched,
+// asynchronous, hybrid, device-resident and out-of-core multiplies.
+class GF2GPU : public GF2Backend {
+public:
+    // The device is retained for the lifetime of the GF2GPU
     GF2GPU(MTL::Device* device);
-    ~GF2GPU();
+    ~GF2GPU() override;
+
+    // One backend per Metal device on the host (MTL::CopyAllDevices), each
+    // with its own queue and pipelines, the system default device first.
+    // Empty if there is no device.
+    static std::vector<std::unique_ptr<GF2GPU>> createAll();
+
+    // The multiply kernels, for the generic entry points
+    using Kernel = GF2Kernel;
+
+    // --- GF2Backend ---
+    const char* backendName() const override { return "Metal"; }
+    std::string deviceName() const override;
+    bool supports(Kernel kernel) override;
+    using GF2Backend::multiply;
+    void multiply(Kernel kernel, const GF2Matrix& a, const GF2Matrix& b,
+                  GF2Matrix& result) override;
+    // One thread per row of a, and one per (column j of x, word of a) for
+    // x^T * a (gf2_matvec.metal)
+    void multiplyBlock(const GF2Matrix& a, const uint64_t* x, uint64_t* y) override;
+    void leftMultiplyBlock(const GF2Matrix& a, const uint64_t* x, uint64_t* y) override;
+    // a * b^T with the transposed kernel (out-of-core ones transpose b on the
+    // CPU), and a^T * b with gf2_multiply_at_b_kernel (gf2_matvec.metal),
+    // which throws std::runtime_error for products that need the
+    // out-of-core path
+    void multiplyABt(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result) override;
+    void multiplyAtB(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result) override;
+    // gf2_multiply_aat_kernel (gf2_matvec.metal); throws std::runtime_error
+    // for products that need the out-of-core path
+    void multiplyAAt(const GF2Matrix& a, GF2Matrix& result, GF2Triangle triangle,
+                     bool mirror) override;
+    // gf2_multiply_morton_kernel (gf2_multiply_morton.metal)
+    void multiplyTiled(const GF2TiledMatrix& a, const GF2TiledMatrix& b,
+                       GF2TiledMatrix& result) override;
     
     // Original GPU-accelerated matrix multiplication (Baseline)
     void multiplyGPU(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result);
     
     // High-performance version using the transposition strategy
     void multiplyGPU_transposed(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result);
+    // Same with a prepared B: B^T is uploaded on first use and kept with it
+    void multiplyGPU_transposed(const GF2Matrix& a, const GF2PackedOperand& b, GF2Matrix& result);
     
-    // Tiled GPU-accelerated matrix multiplication
+    // Tiled GPU-accelerated matrix multiplication: threadgroup tiles of whole
+    // words of A and B, several result words per thread
     void multiplyGPUTiled(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result);
 
     // Vectorized version combining transposition and vector types
     void multiplyGPUVectorized(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result);
+    void multiplyGPUVectorized(const GF2Matrix& a, const GF2PackedOperand& b, GF2Matrix& result);
+
+    // One SIMD-group per result word: the lanes split the common dimension
+    // of A and B^T and combine their parities with SIMD shuffles
+    void multiplyGPUSimdGroup(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result);
+    void multiplyGPUSimdGroup(const GF2Matrix& a, const GF2PackedOperand& b, GF2Matrix& result);
 
     void multiplyGPUM4R(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result);
+
+    // Strassen-Winograd recursion on the GPU: halvings while every dimension
+    // stays above cutoff, the seven sub-products and the block XORs of every
+    // level encoded into one command buffer over one device workspace (the
+    // padded operands, the product and two temporaries per level), and the
+    // leaf products run by the given kernel. Each level trades one of eight
+    // block products for block XORs. Products too small for a halving go to
+    // multiply(); the tiled kernel cannot run the leaves (std::runtime_error).
+    void multiplyGPUStrassen(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result,
+                             Kernel leaf = Kernel::M4R,
+                             size_t cutoff = STRASSEN_GPU_CUTOFF);
+
+    static constexpr size_t STRASSEN_GPU_CUTOFF = 4096;
+
+    // Boolean product (GF2Semiring::OrAnd) with the M4R kernels, whose
+    // boolean variants build tables of ORs and OR them into the result.
+    // Throws std::runtime_error for products that need the out-of-core path.
+    void multiplyGPUBoolean(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result);
     
+    // Many independent products of equal shapes (a[i] * b[i]) in one command
+    // buffer: the operands are packed back to back and a single dispatch
+    // covers the whole batch, the product index in the grid's z dimension.
+    // results is resized to the batch. Not available for the tiled kernel.
+    void multiplyGPUBatched(Kernel kernel, const std::vector<GF2Matrix>& a,
+                            const std::vector<GF2Matrix>& b, std::vector<GF2Matrix>& results);
+
+    // Products whose matrices do not fit in single buffers (maxBufferLength)
+    // or whose dimensions exceed 32 bits: C is computed in blocks of rows by
+    // columns, the matching blocks of A and B (or B^T) are copied into a ring
+    // of buffers of at most block_bytes each, and up to OUT_OF_CORE_RING
+    // blocks are in flight while the next is filled. The common dimension is
+    // not split. The synchronous entry points switch to this on their own.
+    void multiplyGPUOutOfCore(Kernel kernel, const GF2Matrix& a, const GF2Matrix& b,
+                              GF2Matrix& result, size_t block_bytes = OUT_OF_CORE_BLOCK_BYTES);
+
+    static constexpr size_t OUT_OF_CORE_BLOCK_BYTES = size_t(128) << 20;
+    static constexpr size_t OUT_OF_CORE_RING = 3;
+
+    // Memory budget of the per-product M4R tables of one batched dispatch
+    static constexpr size_t MAX_BATCH_TABLE_BYTES = size_t(256) << 20;
+
+    // The M4R kernels build the tables of a panel of A words at a time and
+    // accumulate the panel products into the result, so the table buffer of
+    // one product stays within this budget whatever the size of A.
+    static constexpr size_t M4R_TABLE_BYTES = size_t(64) << 20;
+
+    // Asynchronous multiply: encodes and commits the work and returns without
+    // waiting for the GPU. a, b and result must stay alive and unmodified
+    // until the future is ready (or the handler has run, on a Metal thread).
+    // Several submissions may be in flight, so preparing the next job on the
+    // CPU overlaps with the GPU running the previous one.
+    using CompletionHandler = std::function<void(std::exception_ptr error)>;
+    std::future<void> multiplyAsync(Kernel kernel, const GF2Matrix& a, const GF2Matrix& b,
+                                    GF2Matrix& result);
+    std::future<void> multiplyAsync(Kernel kernel, const GF2Matrix& a, const GF2PackedOperand& b,
+                                    GF2Matrix& result);
+    void multiplyAsync(Kernel kernel, const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result,
+                       CompletionHandler done);
+    void multiplyAsync(Kernel kernel, const GF2Matrix& a, const GF2PackedOperand& b,
+                       GF2Matrix& result, CompletionHandler done);
+
+    // Heterogeneous multiply: the GPU (with a kernel reading B^T) computes the
+    // first rows of the result while the SIMD CPU kernel on num_threads
+    // threads (<= 0 for the OpenMP default) computes the others, both writing
+    // their rows of result in place. The rows are split in proportion to the
+    // throughput both sides showed in the previous calls.
+    void multiplyHybrid(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result,
+                        Kernel kernel = Kernel::Vectorized, int num_threads = 0);
+    void multiplyHybrid(const GF2Matrix& a, const GF2PackedOperand& b, GF2Matrix& result,
+                        Kernel kernel = Kernel::Vectorized, int num_threads = 0);
+
+    // Fraction of the rows the next hybrid multiply gives to the GPU
+    double hybridGpuShare() const;
+    void setHybridGpuShare(double share);
+
+    // --- Device-resident matrices ---
+    //
+    // The operations on GF2GPUMatrix handles are encoded into one pending
+    // command buffer and return at once, so a whole expression such as
+    // (A * B) * C runs as a single submission with its intermediates on the
+    // GPU. download() and flush() commit the pending work and wait for it.
+    GF2GPUMatrix upload(const GF2Matrix& m);
+    GF2GPUMatrix zeros(size_t rows, size_t cols);
+    // The bits GF2Matrix::randomFill(seed) gives a rows x cols matrix,
+    // generated on the GPU from the same Philox stream (gf2_random.metal),
+    // so device-resident operands never pass through host memory and can be
+    // checked against the CPU's. randomFill overwrites the whole of m.
+    GF2GPUMatrix random(size_t rows, size_t cols, uint64_t seed);
+    void randomFill(GF2GPUMatrix& m, uint64_t seed);
+    void download(const GF2GPUMatrix& m, GF2Matrix& out);
+    GF2Matrix download(const GF2GPUMatrix& m);
+    GF2GPUMatrix multiply(const GF2GPUMatrix& a, const GF2GPUMatrix& b,
+                          Kernel kernel = Kernel::Vectorized);
+    // a^n by repeated squaring on the GPU. The square, the product, a spare
+    // and the kernel's B^T rotate through the multiplies, so the buffers are
+    // allocated once rather than per step.
+    GF2GPUMatrix power(const GF2GPUMatrix& a, uint64_t n, Kernel kernel = Kernel::Vectorized);
+    GF2GPUMatrix add(const GF2GPUMatrix& a, const GF2GPUMatrix& b);
+    GF2GPUMatrix transpose(const GF2GPUMatrix& m);
+    void flush();
+
+    // --- Elimination ---
+    //
+    // Rank and row echelon form with the matrix resident on the GPU, in
+    // panels of 64 columns as in M4RI. Per panel the GPU copies out the
+    // panel's word of every row, the CPU picks the panel's pivots and for
+    // each row the pivot rows to add to it, and the GPU gathers the pivot
+    // rows and adds them with the M4R table and lookup kernels, accumulating
+    // into the matrix. Only a word per row goes to the CPU and back per
+    // panel. Throws std::runtime_error if the matrix does not fit a buffer.
+    size_t rank(const GF2Matrix& a);
+    // The rank() rows of a row echelon form of a, then zero rows. Not
+    // reduced, and so not always the rows of GF2Matrix::echelonForm(false),
+    // but of the same row space.
+    GF2Matrix echelonForm(const GF2Matrix& a);
+
+    // --- Recorded plans ---
+    //
+    // A loop running one kernel on one shape many times can record the
+    // dispatches once into an indirect command buffer (with the transpose of
+    // B first for the kernels reading B^T) and replay it, so a call no longer
+    // encodes anything. Only the word kernels (Baseline, Transposed,
+    // Vectorized, SimdGroup) can be recorded.
+    std::unique_ptr<GF2GPUPlan> recordPlan(Kernel kernel, size_t a_rows, size_t a_cols,
+                                           size_t b_cols);
+    // Copies a and b into the plan's buffers, replays it and copies the
+    // result out
+    void runPlan(GF2GPUPlan& plan, const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result);
+    // Replays the plan on what its buffers hold (see GF2GPUPlan::a_data())
+    void runPlan(GF2GPUPlan& plan);
+
+    // Where the buffers the kernels read and write live. With unified memory
+    // (Apple silicon) they are shared with the CPU and page-aligned matrices
+    // are wrapped in place. A discrete GPU would read shared buffers across
+    // PCIe on every access, so there the operands are blitted into Private
+    // (VRAM) buffers from shared staging buffers and the results blitted back
+    // into one. The default follows hasUnifiedMemory(); GF2_GPU_STORAGE=shared
+    // or private overrides it. Recorded plans keep their shared buffers.
+    enum class Storage { Shared, Private };
+    Storage storage() const { return _storage; }
+    void setStorage(Storage storage);
+
+    // Threadgroup shapes of the word kernels are measured per pipeline and
+    // grid size class on first use and the fastest is kept for later
+    // dispatches. Without tuning (or with GF2_GPU_TUNE=0) the shape is derived
+    // from the pipeline's limits and the grid.
+    void setLaunchTuning(bool enabled);
+
+    // Blocks until every asynchronous submission has completed
+    void waitUntilIdle();
+
+    // --- Captures ---
+    //
+    // Programmatic GPU captures of single operations, for Xcode: the
+    // iteration-th call (counting from 1) of the named operation runs inside
+    // an MTLCaptureManager capture of the command queue, written as a
+    // .gputrace document to path (default gf2_<operation>_<iteration>.gputrace,
+    // which must not exist yet). The request is then spent.
+    //   - The multiplies through multiply(), multiplyGPU*() and
+    //     multiplyAsync() are named by their kernel: Baseline, Transposed,
+    //     Tiled, Vectorized, SimdGroup, M4R.
+    //   - The other operations are named by their method: multiplyGPUBoolean,
+    //     multiplyGPUStrassen, multiplyGPUBatched, multiplyGPUOutOfCore,
+    //     multiplyHybrid, multiplyABt, multiplyAtB, multiplyAAt,
+    //     multiplyTiled, multiplyBlock, leftMultiplyBlock, rank, echelonForm,
+    //     runPlan.
+    // Operations called by the captured one are part of its capture and not
+    // counted. GF2_GPU_CAPTURE=<operation>[:<iteration>], with
+    // GF2_GPU_CAPTURE_PATH for the path, makes the same request at
+    // construction. Outside Xcode, Metal writes trace documents only with
+    // MTL_CAPTURE_ENABLED=1 in the environment; the operation throws
+    // std::runtime_error if the capture cannot start. Without a request an
+    // operation pays one relaxed atomic load.
+    void captureOperation(const std::string& operation, size_t iteration = 1,
+                          const std::string& path = std::string());
+
+    // Phases of the most recently completed multiply (of any entry point)
+    GF2GPUTiming lastTiming() const override;
+
+    // currentAllocatedSize() of the device; the peak is sampled as each
+    // command buffer completes, before its buffers are returned
+    size_t allocatedBytes() const override;
+    size_t peakAllocatedBytes() const override;
+    void resetPeakAllocated() override;
+
     // Performance profiling
     float benchmark(const GF2Matrix& a, const GF2Matrix& b, int iterations = 10);
     
     // Validation
     bool validate(const GF2Matrix& a, const GF2Matrix& b);
+
+    MTL::Device* device() const { return _device; }
+
+    // Buffers reused across calls (e.g. to change its cache limit)
+    GF2MetalBufferPool& bufferPool() { return _bufferPool; }
     
 private:
     MTL::Device* _device;
     MTL::CommandQueue* _commandQueue;
-    MTL::ComputePipelineState* _computePipeline;
-    MTL::ComputePipelineState* _computePipelineTransposed;
-    MTL::ComputePipelineState* _computePipelineTiled;
-    MTL::ComputePipelineState* _computePipelineVectorized; // <-- ADDED
 
-    MTL::ComputePipelineState* _computePipelineM4R_MakeTable;
-    MTL::ComputePipelineState* _computePipelineM4R_Multiply;
+    // Pipelines by kernel function name and specialization (0 = generic),
+    // created on first use. Failures are kept as nullptr. Pipelines for
+    // indirect command buffers are variants of their own.
+    MTL::Library* _library;
+    using PipelineKey = std::tuple<std::string, uint32_t, bool>;
+    std::map<PipelineKey, MTL::ComputePipelineState*> _pipelines;
+    std::mutex _pipelineMutex;
+
+    // Variants of the kernels reading B^T with the number of common-dimension
+    // words fixed through a function constant, for these shapes
+    static constexpr uint32_t SPECIALIZED_K_WORDS[] = {1, 2, 4, 8, 16, 64, 256};
+
+    // Compiled pipelines kept across runs in a Metal binary archive, so later
+    // launches skip the backend compilation. The file is GF2_PIPELINE_ARCHIVE
+    // (empty to disable) or gf2_pipelines.binarchive in the temp directory;
+    // new pipelines are written back on destruction.
+    MTL::BinaryArchive* _archive;
+    NS::URL* _archiveURL;
+    bool _archiveDirty;
+
+    GF2MetalBufferPool _bufferPool;
+
+    // Asynchronous submissions not yet completed
+    size_t _inFlight;
+    std::mutex _inFlightMutex;
+    std::condition_variable _idle;
+
+    std::atomic<double> _hybridGpuShare;
+
+    // Tuned threadgroup sizes by pipeline and log2 class of each grid dimension
+    using LaunchKey = std::tuple<MTL::ComputePipelineState*, uint32_t, uint32_t, uint32_t>;
+    std::map<LaunchKey, MTL::Size> _launchGroups;
+    std::mutex _launchMutex;
+    std::atomic<bool> _launchTuning;
+
+    std::atomic<Storage> _storage;
+
+    GF2GPUTiming _lastTiming;
+    size_t _peakAllocated; // guarded by _timingMutex, like _lastTiming
+    mutable std::mutex _timingMutex;
+
+    // Raises _peakAllocated to the current allocation; _timingMutex held
+    void samplePeakAllocated();
 
+    // Command buffer collecting the device-resident operations (null if none)
+    MTL::CommandBuffer* _chain;
+    std::mutex _chainMutex;
 
-    // This struct is used by all GPU methods
+    // The pending captureOperation request, and the calls of its operation
+    // so far; _captureArmed is set while there is one
+    struct CaptureRequest {
+        std::string operation;
+        size_t iteration;
+        std::string path;
+        size_t calls;
+    };
+    std::unique_ptr<CaptureRequest> _capture;
+    std::atomic<bool> _captureArmed;
+    std::mutex _captureMutex;
+
+    // Counts the operation running while it lives, unless it runs inside
+    // another counted one, and captures it if it is the requested call
+    class CaptureScope {
+    public:
+        CaptureScope(GF2GPU& gpu, const char* operation) : _gpu(nullptr), _capturing(false) {
+            if (gpu._captureArmed.load(std::memory_order_relaxed)) {
+                _gpu = gpu.beginCapture(operation, _capturing);
+            }
+        }
+        ~CaptureScope() {
+            if (_gpu) _gpu->endCapture(_capturing);
+        }
+        CaptureScope(const CaptureScope&) = delete;
+        CaptureScope& operator=(const CaptureScope&) = delete;
+
+    private:
+        GF2GPU* _gpu;
+        bool _capturing;
+    };
+    // Returns this if the call was counted, setting capturing if its
+    // capture has started; null for a nested call
+    GF2GPU* beginCapture(const char* operation, bool& capturing);
+    void endCapture(bool capturing);
+    static const char* captureName(Kernel kernel);
+
+    // This struct is used by all GPU methods. The words_per_row fields are
+    // the row strides of the buffers (GF2Matrix::row_stride()).
     struct GPUParams {
         uint32_t a_rows;
         uint32_t a_cols;
@@ -51,9 +409,277 @@ private:
         uint32_t words_per_row_b;
         uint32_t words_per_row_result;
     };
+
+    // Shape of the source of the GPU transpose
+    struct GF2TransposeParams {
+        uint32_t rows;
+        uint32_t cols;
+        uint32_t src_stride;
+        uint32_t dst_stride;
+    };
+
+    // Word offsets of product z in batched dispatches (count = 1 otherwise)
+    struct GPUBatchParams {
+        uint32_t count;
+        uint32_t a_words;
+        uint32_t b_words;
+        uint32_t result_words;
+        uint32_t table_words;
+    };
+
+    // Word-wise XOR of two matrices of the same shape
+    struct GF2AddParams {
+        uint32_t rows;
+        uint32_t words;
+        uint32_t a_stride;
+        uint32_t b_stride;
+        uint32_t result_stride;
+    };
+
+    // A matrix filled by gf2_random_kernel
+    struct GF2RandomParams {
+        uint32_t rows;
+        uint32_t words;
+        uint32_t stride;
+        uint32_t seed_lo;
+        uint32_t seed_hi;
+        uint32_t last_bits;
+    };
+
+    // Rows of src, by index, copied into consecutive rows of dst
+    struct GF2GatherParams {
+        uint32_t rows;
+        uint32_t words;
+        uint32_t src_stride;
+        uint32_t dst_stride;
+    };
+
+    // A and the lengths of x and y of the block products
+    struct GF2BlockParams {
+        uint32_t rows;
+        uint32_t cols;
+        uint32_t words;
+        uint32_t stride;
+    };
+
+    // Shape of an a^T * b product
+    struct GF2AtBParams {
+        uint32_t rows;   // of a and b, the common dimension
+        uint32_t cols;   // of a, the rows of the result
+        uint32_t a_words;
+        uint32_t b_words;
+        uint32_t a_stride;
+        uint32_t b_stride;
+        uint32_t result_stride;
+    };
+
+    // Shape of one triangle of a * a^T
+    struct GF2AAtParams {
+        uint32_t rows; // of a, and the rows and columns of the result
+        uint32_t words;
+        uint32_t stride;
+        uint32_t result_stride;
+        uint32_t upper;
+    };
+
+    // Tile grids of a product in the tiled layout
+    struct GF2MortonParams {
+        uint32_t tile;
+        uint32_t tile_words;
+        uint32_t m_tiles;
+        uint32_t k_tiles;
+        uint32_t n_tiles;
+    };
+
+    // Panel of A words covered by one M4R pass
+    struct GPUM4RPanel {
+        uint32_t k_word0;
+        uint32_t k_words;
+        uint32_t accumulate;
+    };
     
+    struct Submission;
+
+    // A window of rows x words words into a device buffer, at a word offset
+    struct DeviceBlock {
+        MTL::Buffer* buffer;
+        size_t offset;
+        size_t stride;
+        size_t rows;
+        size_t words;
+
+        DeviceBlock quadrant(size_t r, size_t c) const {
+            return {buffer, offset + r * (rows / 2) * stride + c * (words / 2), stride,
+                    rows / 2, words / 2};
+        }
+    };
+    // The leaf kernel of a GPU Strassen product and the buffers its leaves
+    // share: B (M4R) or B^T (the kernels reading it) of a leaf made
+    // contiguous, and the M4R tables
+    struct StrassenLeaf {
+        Kernel kernel;
+        MTL::ComputePipelineState* pipeline;
+        MTL::Buffer* b_copy;
+        MTL::Buffer* tables;
+        size_t panel_words;
+    };
+    // dst = x ^ y (gf2_add_kernel), and dst = src (gf2_copy_kernel)
+    void encodeXorBlock(MTL::CommandBuffer* commandBuffer, const DeviceBlock& dst,
+                        const DeviceBlock& x, const DeviceBlock& y);
+    void encodeCopyBlock(MTL::CommandBuffer* commandBuffer, const DeviceBlock& dst,
+                         const DeviceBlock& src);
+    // c = a * b, 'levels' more halvings before the leaf products; scratch
+    // is the word offset of this level's temporaries in the workspace
+    void encodeStrassen(MTL::CommandBuffer* commandBuffer, const DeviceBlock& a,
+                        const DeviceBlock& b, const DeviceBlock& c, int levels,
+                        size_t scratch, const StrassenLeaf& leaf);
+    void encodeStrassenLeaf(MTL::CommandBuffer* commandBuffer, const DeviceBlock& a,
+                            const DeviceBlock& b, const DeviceBlock& c,
+                            const StrassenLeaf& leaf);
+
+    // result = a * b on device matrices, encoded into commandBuffer; B^T of
+    // the kernels reading it goes into *b_t_scratch if given
+    void encodeMultiply(MTL::CommandBuffer* commandBuffer, const GF2GPUMatrix& a,
+                        const GF2GPUMatrix& b, GF2GPUMatrix& result, Kernel kernel,
+                        GF2GPUMatrix* b_t_scratch);
+
+    // Runs a kernel of gf2_matvec.metal on a, x (x_words words) and y
+    // (y_words words) over the given grid and waits for it
+    void runBlockKernel(const char* name, const GF2Matrix& a, const uint64_t* x, size_t x_words,
+                        uint64_t* y, size_t y_words, MTL::Size grid);
+
+    // Buffers over a matrix: its own storage wrapped without a copy when it is
+    // page aligned, else a pooled buffer holding a copy (or room for a result)
+    MTL::Buffer* wrapMatrix(const GF2Matrix& m);
+    // Storage mode of the buffers only the GPU touches
+    MTL::StorageMode gpuStorage() const;
+    bool staged() const { return gpuStorage() == MTL::StorageModePrivate; }
+    MTL::Buffer* stageIn(MTL::CommandBuffer* commandBuffer, MTL::Buffer* staging, size_t bytes);
+    void stageResult(Submission& sub);
+    static void encodeCopy(MTL::CommandBuffer* commandBuffer, MTL::Buffer* src, MTL::Buffer* dst,
+                           size_t bytes);
+    void copyBuffer(MTL::Buffer* src, MTL::Buffer* dst, size_t bytes);
+    MTL::Buffer* uploadMatrix(Submission& sub, const GF2Matrix& m);
+    MTL::Buffer* resultBuffer(GF2Matrix& result);
+    void readResult(MTL::Buffer* buffer, GF2Matrix& result, size_t rows = SIZE_MAX);
+    void releaseBuffer(MTL::Buffer* buffer, const GF2Matrix* m);
+    static GPUParams makeParams(const GF2Matrix& a, size_t b_cols, size_t b_stride,
+                                const GF2Matrix& result);
+
+    struct PackedOperandBuffer;
+    MTL::Buffer* packedBuffer(const GF2PackedOperand& b);
+
+    // Encoding, submission and completion of one multiply
+    static const char* kernelFunction(Kernel kernel);
+    MTL::ComputePipelineState* namedPipeline(const char* name, uint32_t k_words = 0,
+                                             bool indirect = false);
+    MTL::ComputePipelineState* createPipeline(const char* name, uint32_t k_words, bool indirect);
+    MTL::ComputePipelineState* pipelineFor(Kernel kernel);
+    MTL::ComputePipelineState* pipelineFor(Kernel kernel, size_t k_words, bool indirect = false);
+    std::shared_ptr<Submission> encode(Kernel kernel, const GF2Matrix& a, const GF2Matrix& b,
+                                       GF2Matrix& result);
+    std::shared_ptr<Submission> encode(Kernel kernel, const GF2Matrix& a,
+                                       const GF2PackedOperand& b, GF2Matrix& result,
+                                       size_t rows = SIZE_MAX);
+    void encodeWordKernel(Submission& sub, Kernel kernel, MTL::ComputePipelineState* pipeline,
+                          const GF2Matrix& a, MTL::Buffer* bufferB, size_t b_stride,
+                          size_t b_cols, GF2Matrix& result, size_t rows = SIZE_MAX);
+    void encodeWordDispatch(MTL::CommandBuffer* commandBuffer, Kernel kernel,
+                            MTL::ComputePipelineState* pipeline, MTL::Buffer* bufferA,
+                            MTL::Buffer* bufferB, MTL::Buffer* bufferResult,
+                            const GPUParams& params, size_t result_words, bool tune,
+                            size_t a_offset = 0, size_t b_offset = 0,
+                            size_t result_offset = 0);
+    static MTL::Size wordKernelGrid(Kernel kernel, size_t rows, size_t words, size_t count);
+    using EncoderBinder = std::function<void(MTL::ComputeCommandEncoder*)>;
+    MTL::Size wordKernelGroup(Kernel kernel, MTL::ComputePipelineState* pipeline, MTL::Size grid,
+                              const EncoderBinder& bind);
+    static MTL::Size fitGroup(MTL::ComputePipelineState* pipeline, MTL::Size grid,
+                              size_t x_multiple);
+    static std::vector<MTL::Size> candidateGroups(MTL::ComputePipelineState* pipeline,
+                                                  MTL::Size grid, size_t x_multiple);
+    void encodeTranspose(MTL::CommandBuffer* commandBuffer, MTL::Buffer* bufferSrc, size_t rows,
+                         size_t cols, size_t src_stride, MTL::Buffer* bufferDst,
+                         size_t dst_stride, size_t src_offset = 0);
+    void encodeTiled(Submission& sub, const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result);
+    void encodeTiledDispatch(MTL::CommandBuffer* commandBuffer, MTL::Buffer* bufferA,
+                             MTL::Buffer* bufferB, MTL::Buffer* bufferResult,
+                             const GPUParams& params);
+    void encodeM4R(Submission& sub, const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result,
+                   GF2Semiring semiring = GF2Semiring::XorAnd);
+    static size_t m4rPanelWords(size_t a_cols, size_t b_stride);
+    void encodeM4RPanels(MTL::CommandBuffer* commandBuffer, MTL::Buffer* bufferA, size_t a_offset,
+                         MTL::Buffer* bufferB, size_t b_offset, MTL::Buffer* bufferResult,
+                         size_t result_offset, MTL::Buffer* bufferTables,
+                         const GPUParams& params, const GPUBatchParams& batch,
+                         size_t panel_words, GF2Semiring semiring = GF2Semiring::XorAnd,
+                         bool accumulate = false);
+    bool needsOutOfCore(size_t a_rows, size_t a_cols, size_t b_cols) const;
+    // rank() and, into *echelon if given, echelonForm()
+    size_t eliminate(const GF2Matrix& a, GF2Matrix* echelon);
+    void multiplySync(Kernel kernel, const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result);
+    void multiplySync(Kernel kernel, const GF2Matrix& a, const GF2PackedOperand& b,
+                      GF2Matrix& result);
+    void outOfCore(Kernel kernel, const GF2Matrix& a, const GF2Matrix* b, const GF2Matrix* b_t,
+                   GF2Matrix& result, size_t block_bytes);
+    GF2GPUMatrix newDeviceMatrix(size_t rows, size_t cols);
+    MTL::CommandBuffer* chainCommandBuffer();
+    // A submission on a new command buffer of the queue
+    std::shared_ptr<Submission> newSubmission();
+    // Hands the buffers of a submission back to the pool (or releases the
+    // wrapped ones)
+    void releaseBuffers(Submission& sub);
+    void complete(Submission& sub);
+    void run(Submission& sub);
+    void submit(std::shared_ptr<Submission> sub, CompletionHandler done);
+
     void setupPipeline();
+    void saveArchive();
     MTL::Buffer* createBuffer(const uint64_t* data, size_t size);
     MTL::Buffer* createResultBuffer(size_t size);
 };
 
+// One multiply of a fixed kernel and shape recorded by GF2GPU::recordPlan():
+// the indirect command buffer of its dispatches and the buffers they are
+// bound to. Between runs, A and B can be written straight into the plan's
+// buffers, with rows padded to the given strides, and C read from it. The
+// GF2GPU that recorded a plan must outlive it.
+class GF2GPUPlan {
+public:
+    ~GF2GPUPlan();
+    GF2GPUPlan(const GF2GPUPlan&) = delete;
+    GF2GPUPlan& operator=(const GF2GPUPlan&) = delete;
+
+    GF2GPU::Kernel kernel() const { return _kernel; }
+    size_t a_rows() const { return _aRows; }
+    size_t a_cols() const { return _aCols; }
+    size_t b_cols() const { return _bCols; }
+
+    uint64_t* a_data() { return static_cast<uint64_t*>(_a->contents()); }
+    size_t a_stride() const { return _aStride; }
+    uint64_t* b_data() { return static_cast<uint64_t*>(_b->contents()); }
+    size_t b_stride() const { return _bStride; }
+    const uint64_t* result_data() const { return static_cast<const uint64_t*>(_result->contents()); }
+    size_t result_stride() const { return _resultStride; }
+
+private:
+    friend class GF2GPU;
+    GF2GPUPlan() = default;
+
+    GF2GPU::Kernel _kernel = GF2GPU::Kernel::Vectorized;
+    size_t _aRows = 0;
+    size_t _aCols = 0;
+    size_t _bCols = 0;
+    size_t _aStride = 0;
+    size_t _bStride = 0;
+    size_t _resultStride = 0;
+
+    MTL::IndirectCommandBuffer* _commands = nullptr;
+    NS::UInteger _commandCount = 0;
+    MTL::Buffer* _a = nullptr;
+    MTL::Buffer* _b = nullptr;
+    MTL::Buffer* _bTransposed = nullptr; // null for the baseline kernel
+    MTL::Buffer* _result = nullptr;
+    // The parameter structs, since recorded commands cannot use setBytes
+    MTL::Buffer* _params = nullptr;
+};
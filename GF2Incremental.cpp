@@ -0,0 +1,157 @@
+#include "GF2Incremental.hpp"
+#include "GF2Kernels.hpp"
+#include "GF2MatrixView.hpp"
+#include <algorithm>
+#include <cstring>
+#include <omp.h>
+#include <stdexcept>
+
+namespace {
+
+// Below this many changed rows of A each is its own pass over B; from it on
+// a block of up to 64 shares the Four Russians tables of leftMultiplyBlock
+constexpr size_t BLOCK_MIN_ROWS = 6;
+
+// Rows of C per task of the correction
+constexpr size_t CORRECTION_ROWS = 256;
+
+} // namespace
+
+GF2IncrementalProduct::GF2IncrementalProduct(GF2Matrix a, GF2Matrix b, int num_threads)
+    : m_a(std::move(a)), m_b(std::move(b)), m_c(0, 0),
+      m_threads(num_threads > 0 ? num_threads : omp_get_max_threads()),
+      m_marked_a(m_a.rows(), 0), m_marked_b(m_b.rows(), 0) {
+    if (m_a.cols() != m_b.rows()) {
+        throw std::runtime_error("Matrix dimensions incompatible for multiplication");
+    }
+    m_c = m_a.multiplySIMDParallel(m_b, m_threads);
+}
+
+uint64_t* GF2IncrementalProduct::editRowOfA(size_t r) {
+    if (r >= m_a.rows()) {
+        throw std::runtime_error("Row index out of range");
+    }
+    if (!m_marked_a[r]) {
+        m_marked_a[r] = 1;
+        m_dirty_a.push_back(r);
+    }
+    return m_a.get_raw_data() + r * m_a.row_stride();
+}
+
+uint64_t* GF2IncrementalProduct::editRowOfB(size_t r) {
+    if (r >= m_b.rows()) {
+        throw std::runtime_error("Row index out of range");
+    }
+    uint64_t* row = m_b.get_raw_data() + r * m_b.row_stride();
+    if (!m_marked_b[r]) {
+        m_marked_b[r] = 1;
+        m_dirty_b.push_back(r);
+        m_old_b.insert(m_old_b.end(), row, row + m_b.words_per_row());
+    }
+    return row;
+}
+
+void GF2IncrementalProduct::setRowOfA(size_t r, const uint64_t* words) {
+    std::memcpy(editRowOfA(r), words, m_a.words_per_row() * sizeof(uint64_t));
+}
+
+void GF2IncrementalProduct::setRowOfB(size_t r, const uint64_t* words) {
+    std::memcpy(editRowOfB(r), words, m_b.words_per_row() * sizeof(uint64_t));
+}
+
+// Before the rows of A: the correction uses the current A everywhere, which
+// leaves the unchanged rows right and the changed ones to be recomputed
+void GF2IncrementalProduct::update() {
+    correctForB();
+    recomputeRowsOfA();
+}
+
+void GF2IncrementalProduct::recompute() {
+    m_c = m_a.multiplySIMDParallel(m_b, m_threads);
+    m_rows_recomputed += m_c.rows();
+    for (size_t r : m_dirty_a) m_marked_a[r] = 0;
+    for (size_t r : m_dirty_b) m_marked_b[r] = 0;
+    m_dirty_a.clear();
+    m_dirty_b.clear();
+    m_old_b.clear();
+}
+
+// C ^= G * D, G the columns of A at the changed rows of B (m x d) and D the
+// changes of those rows (d x n)
+void GF2IncrementalProduct::correctForB() {
+    const size_t d = m_dirty_b.size();
+    const size_t m = m_a.rows(), n = m_b.cols(), words = m_b.words_per_row();
+    if (d > 0 && m > 0 && n > 0) {
+        GF2Matrix g(m, d);
+        for (size_t i = 0; i < m; ++i) {
+            const uint64_t* a_row = m_a.get_raw_data() + i * m_a.row_stride();
+            uint64_t* g_row = g.get_raw_data() + i * g.row_stride();
+            for (size_t j = 0; j < d; ++j) {
+                const size_t col = m_dirty_b[j];
+                g_row[j / 64] |= ((a_row[col / 64] >> (col % 64)) & 1) << (j % 64);
+            }
+        }
+        GF2Matrix delta(d, n);
+        for (size_t j = 0; j < d; ++j) {
+            const uint64_t* now = m_b.get_raw_data() + m_dirty_b[j] * m_b.row_stride();
+            const uint64_t* old = m_old_b.data() + j * words;
+            uint64_t* out = delta.get_raw_data() + j * delta.row_stride();
+            for (size_t w = 0; w < words; ++w) {
+                out[w] = now[w] ^ old[w];
+            }
+        }
+
+        const long long blocks = static_cast<long long>((m + CORRECTION_ROWS - 1) /
+                                                        CORRECTION_ROWS);
+        #pragma omp parallel for schedule(static) num_threads(m_threads)
+        for (long long bb = 0; bb < blocks; ++bb) {
+            const size_t r0 = size_t(bb) * CORRECTION_ROWS;
+            const size_t r1 = std::min(m, r0 + CORRECTION_ROWS);
+            GF2Matrix::multiplyM4RInto(g.view(r0, r1, 0, d), delta, m_c.mutableView(r0, r1, 0, n),
+                                       true);
+        }
+        m_correction_rank += d;
+    }
+    for (size_t r : m_dirty_b) m_marked_b[r] = 0;
+    m_dirty_b.clear();
+    m_old_b.clear();
+}
+
+// Row r of C = row r of A times B
+void GF2IncrementalProduct::recomputeRowsOfA() {
+    const size_t count = m_dirty_a.size();
+    const size_t k = m_a.cols();
+    const size_t words = m_c.words_per_row();
+    auto c_row = [&](size_t r) { return m_c.get_raw_data() + r * m_c.row_stride(); };
+    auto a_row = [&](size_t r) { return m_a.get_raw_data() + r * m_a.row_stride(); };
+
+    size_t done = 0;
+    if (count >= BLOCK_MIN_ROWS) {
+        // Up to 64 rows of A as the 64 columns of a k x 64 block, one word per
+        // row of B
+        std::vector<uint64_t> rows(64 * m_a.row_stride());
+        std::vector<uint64_t> x(k);
+        std::vector<uint64_t> y(64 * words);
+        for (; count - done >= BLOCK_MIN_ROWS; done += std::min<size_t>(64, count - done)) {
+            const size_t g = std::min<size_t>(64, count - done);
+            std::fill(rows.begin(), rows.end(), 0);
+            for (size_t j = 0; j < g; ++j) {
+                std::memcpy(rows.data() + j * m_a.row_stride(), a_row(m_dirty_a[done + j]),
+                            m_a.words_per_row() * sizeof(uint64_t));
+            }
+            transpose_matrix(rows.data(), m_a.row_stride(), x.data(), 1, 64, k);
+            m_b.leftMultiplyBlock(x.data(), y.data(), m_threads);
+            for (size_t j = 0; j < g; ++j) {
+                std::memcpy(c_row(m_dirty_a[done + j]), y.data() + j * words,
+                            words * sizeof(uint64_t));
+            }
+        }
+    }
+    for (; done < count; ++done) {
+        m_b.leftMultiplyVector(a_row(m_dirty_a[done]), c_row(m_dirty_a[done]), m_threads);
+    }
+
+    m_rows_recomputed += count;
+    for (size_t r : m_dirty_a) m_marked_a[r] = 0;
+    m_dirty_a.clear();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "GF2Matrix.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// C = A * B kept up to date while rows of A or of B change, at the cost of
+// the changed rows instead of a new product. Rows are edited in place
+// through editRowOfA and editRowOfB, which mark them; update() then
+//   - adds A * (new B - old B) over the changed rows of B: the columns of A
+//     at those rows times the changes, a rank-d correction that Four
+//     Russians tables of the changes apply with one lookup per row of C and
+//     8 changed rows;
+//   - and recomputes the changed rows of A as row products with B: by
+//     XORing the rows of B their bits select, or for 6 rows or more by the
+//     table-based leftMultiplyBlock over 64 rows at a time.
+// So 10 changed rows of A in a 16384 x 16384 system cost one pass over B,
+// about 20 ms on one core, not a cubic multiply. Not for concurrent use.
+class GF2IncrementalProduct {
+public:
+    // Computes the first product; throws std::runtime_error if the shapes
+    // do not match. num_threads <= 0 uses the OpenMP default.
+    GF2IncrementalProduct(GF2Matrix a, GF2Matrix b, int num_threads = 0);
+
+    const GF2Matrix& a() const { return m_a; }
+    const GF2Matrix& b() const { return m_b; }
+    // A * B as of the last update()
+    const GF2Matrix& product() const { return m_c; }
+
+    // Row r of A or B to change in place (words_per_row() words, padding to
+    // stay zero), marked for the next update(). B's row is saved the first
+    // time it is edited, for the correction. Throw std::runtime_error if r is
+    // out of range.
+    uint64_t* editRowOfA(size_t r);
+    uint64_t* editRowOfB(size_t r);
+    // Row r set to 'words', marked the same way
+    void setRowOfA(size_t r, const uint64_t* words);
+    void setRowOfB(size_t r, const uint64_t* words);
+
+    size_t pendingRowsOfA() const { return m_dirty_a.size(); }
+    size_t pendingRowsOfB() const { return m_dirty_b.size(); }
+
+    // Brings product() up to date with the edits since the last call
+    void update();
+    // Recomputes the whole product and drops the marks
+    void recompute();
+
+    // Totals over the updates: rows of C recomputed, and the rank of the
+    // corrections applied for B
+    size_t rowsRecomputed() const { return m_rows_recomputed; }
+    size_t correctionRank() const { return m_correction_rank; }
+
+private:
+    GF2Matrix m_a;
+    GF2Matrix m_b;
+    GF2Matrix m_c;
+    int m_threads;
+
+    std::vector<size_t> m_dirty_a;
+    std::vector<char> m_marked_a;
+    std::vector<size_t> m_dirty_b;
+    std::vector<char> m_marked_b;
+    std::vector<uint64_t> m_old_b; // row m_dirty_b[i] before its edits, at i * words
+
+    size_t m_rows_recomputed = 0;
+    size_t m_correction_rank = 0;
+
+    void correctForB();
+    void recomputeRowsOfA();
+};
@@ -0,0 +1,388 @@
+#pragma once
+
+#include "GF2Matrix.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Low-level CPU kernels shared by the GF2Matrix multiplication methods.
+// They work on raw, bit-packed row-major word buffers with an explicit row
+// stride (in 64-bit words) so that they can be applied to whole matrices as
+// well as to sub-blocks of larger buffers.
+
+// The addition of a semiring, on 64 entries at once
+template <GF2Semiring S>
+inline uint64_t semiring_add(uint64_t x, uint64_t y) {
+    return S == GF2Semiring::XorAnd ? x ^ y : x | y;
+}
+
+// --- Dot-product (A * B^T) kernels ---
+
+// Fold masks of the six parity-tree stages (shift 32, 16, ..., 1). Each stage
+// keeps the low half of every 2s-bit group from one word and the high half
+// from the other.
+inline constexpr uint64_t PARITY_TREE_MASKS[6] = {
+    0x00000000FFFFFFFFULL, 0x0000FFFF0000FFFFULL, 0x00FF00FF00FF00FFULL,
+    0x0F0F0F0F0F0F0F0FULL, 0x3333333333333333ULL, 0x5555555555555555ULL,
+};
+
+// 6-bit bit-reversal. The parity tree leaves the parity of input slot s at
+// bit bitrev(s), so column c is accumulated into slot PARITY_TREE_SLOT[c].
+inline constexpr uint8_t PARITY_TREE_SLOT[64] = {
+     0, 32, 16, 48,  8, 40, 24, 56,  4, 36, 20, 52, 12, 44, 28, 60,
+     2, 34, 18, 50, 10, 42, 26, 58,  6, 38, 22, 54, 14, 46, 30, 62,
+     1, 33, 17, 49,  9, 41, 25, 57,  5, 37, 21, 53, 13, 45, 29, 61,
+     3, 35, 19, 51, 11, 43, 27, 59,  7, 39, 23, 55, 15, 47, 31, 63,
+};
+
+// Computes the result words [jw0, jw1) of rows [i0, i1) of C = A * B from A
+// and B^T over the common-dimension words [k0, k1). b_cols is the number of
+// valid rows of B^T. With accumulate the words are XORed into C instead of
+// being stored. The _or kernels compute the Boolean product instead: the
+// ANDs are ORed together, the parity tree becomes an OR tree, and accumulate
+// ORs into C.
+using SimdBlockKernel = void (*)(const uint64_t* a, size_t a_stride,
+                                 const uint64_t* b_t, size_t b_t_stride,
+                                 uint64_t* c, size_t c_stride, size_t b_cols,
+                                 size_t i0, size_t i1, size_t jw0, size_t jw1,
+                                 size_t k0, size_t k1, bool accumulate);
+
+// Optional re-layout of B^T for kernels that do not read it row by row. The
+// packed operand holds k_words * 64 words per result word (that is also the
+// b_t_stride the block kernel is then called with), n_words * k_words * 64
+// words in total. The block kernel may be run over any k range within the
+// packed k_words.
+using SimdPackKernel = void (*)(const uint64_t* b_t, size_t b_t_stride, size_t b_cols,
+                                size_t k_words, uint64_t* packed);
+
+// One implementation per instruction set, each in its own translation unit
+// compiled with that instruction set's flags
+void simd_block_scalar(const uint64_t* a, size_t a_stride, const uint64_t* b_t, size_t b_t_stride,
+                       uint64_t* c, size_t c_stride, size_t b_cols, size_t i0, size_t i1,
+                       size_t jw0, size_t jw1, size_t k0, size_t k1, bool accumulate);
+void simd_block_scalar_or(const uint64_t* a, size_t a_stride, const uint64_t* b_t,
+                          size_t b_t_stride, uint64_t* c, size_t c_stride, size_t b_cols,
+                          size_t i0, size_t i1, size_t jw0, size_t jw1, size_t k0, size_t k1,
+                          bool accumulate);
+#if defined(__x86_64__) || defined(_M_X64)
+void simd_block_avx2(const uint64_t* a, size_t a_stride, const uint64_t* b_t, size_t b_t_stride,
+                     uint64_t* c, size_t c_stride, size_t b_cols, size_t i0, size_t i1,
+                     size_t jw0, size_t jw1, size_t k0, size_t k1, bool accumulate);
+void simd_block_avx512(const uint64_t* a, size_t a_stride, const uint64_t* b_t, size_t b_t_stride,
+                       uint64_t* c, size_t c_stride, size_t b_cols, size_t i0, size_t i1,
+                       size_t jw0, size_t jw1, size_t k0, size_t k1, bool accumulate);
+void simd_block_avx2_or(const uint64_t* a, size_t a_stride, const uint64_t* b_t,
+                        size_t b_t_stride, uint64_t* c, size_t c_stride, size_t b_cols,
+                        size_t i0, size_t i1, size_t jw0, size_t jw1, size_t k0, size_t k1,
+                        bool accumulate);
+void simd_block_avx512_or(const uint64_t* a, size_t a_stride, const uint64_t* b_t,
+                          size_t b_t_stride, uint64_t* c, size_t c_stride, size_t b_cols,
+                          size_t i0, size_t i1, size_t jw0, size_t jw1, size_t k0, size_t k1,
+                          bool accumulate);
+void simd_block_gfni(const uint64_t* a, size_t a_stride, const uint64_t* b_t, size_t b_t_stride,
+                     uint64_t* c, size_t c_stride, size_t b_cols, size_t i0, size_t i1,
+                     size_t jw0, size_t jw1, size_t k0, size_t k1, bool accumulate);
+void simd_pack_gfni(const uint64_t* b_t, size_t b_t_stride, size_t b_cols,
+                    size_t k_words, uint64_t* packed);
+#elif defined(__aarch64__)
+void simd_block_neon(const uint64_t* a, size_t a_stride, const uint64_t* b_t, size_t b_t_stride,
+                     uint64_t* c, size_t c_stride, size_t b_cols, size_t i0, size_t i1,
+                     size_t jw0, size_t jw1, size_t k0, size_t k1, bool accumulate);
+void simd_block_neon_or(const uint64_t* a, size_t a_stride, const uint64_t* b_t,
+                        size_t b_t_stride, uint64_t* c, size_t c_stride, size_t b_cols,
+                        size_t i0, size_t i1, size_t jw0, size_t jw1, size_t k0, size_t k1,
+                        bool accumulate);
+void simd_block_neon_eor3(const uint64_t* a, size_t a_stride, const uint64_t* b_t, size_t b_t_stride,
+                          uint64_t* c, size_t c_stride, size_t b_cols, size_t i0, size_t i1,
+                          size_t jw0, size_t jw1, size_t k0, size_t k1, bool accumulate);
+#ifdef GF2_HAVE_SVE2
+void simd_block_sve2(const uint64_t* a, size_t a_stride, const uint64_t* b_t, size_t b_t_stride,
+                     uint64_t* c, size_t c_stride, size_t b_cols, size_t i0, size_t i1,
+                     size_t jw0, size_t jw1, size_t k0, size_t k1, bool accumulate);
+#endif
+#endif
+
+// The dot-product kernel chosen for this CPU at first use. The choice can be
+// forced with GF2_SIMD_KERNEL=scalar|avx2|avx512|gfni|neon|neon-eor3|sve2 (if supported).
+// When pack_b is set, block expects the packed B^T instead of B^T itself.
+// k_align is the number of common-dimension words one vector step consumes;
+// ranges that are a multiple of it run without a tail loop. block_or is the
+// Boolean kernel on the unpacked B^T, or null for kernels whose arithmetic
+// is GF(2) only (GFNI's affine parities, EOR3, SVE2's EOR reductions).
+struct SimdKernel {
+    const char* name;
+    SimdBlockKernel block;
+    SimdPackKernel pack_b;
+    size_t k_align;
+    SimdBlockKernel block_or;
+};
+const SimdKernel& simd_kernel();
+
+// The kernel of the given semiring: simd_kernel() for GF(2). For the Boolean
+// semiring, simd_kernel() if it has a block_or, else the first kernel of
+// simd_kernels() that does, with block_or as block and no pack_b.
+const SimdKernel& simd_kernel(GF2Semiring semiring);
+
+// Every kernel this CPU can run, best first; scalar is always last
+std::vector<SimdKernel> simd_kernels();
+
+// The register-tile kernels (GF2Microkernel.hpp) of the instruction set of
+// row_kernel(), named "<isa>-<rows>x<cols>x<unroll>", in no order of
+// preference: which is fastest is for a calibration to find. Each has a
+// block_or and no pack_b.
+std::vector<SimdKernel> simd_tile_kernels();
+
+std::vector<SimdKernel> simd_tiles_scalar();
+#if defined(__x86_64__) || defined(_M_X64)
+std::vector<SimdKernel> simd_tiles_avx2();
+std::vector<SimdKernel> simd_tiles_avx512();
+#elif defined(__aarch64__)
+std::vector<SimdKernel> simd_tiles_neon();
+#endif
+
+// --- Row operations ---
+
+// dst ^= src over 'words' words, the step of row reduction; the loop is left
+// to the compiler to vectorize
+inline void row_xor(uint64_t* __restrict dst, const uint64_t* __restrict src, size_t words) {
+    #pragma omp simd
+    for (size_t j = 0; j < words; ++j) {
+        dst[j] ^= src[j];
+    }
+}
+
+// Whole-row kernels, one set per instruction set like the dot-product
+// kernels, behind GF2Matrix::rowXor and the other row operations:
+// dst ^= src, dst ^= src & mask, swapping two rows, the number of ones,
+// and the index of the first nonzero word (words if there is none). Rows
+// may be unaligned; their words must not overlap. hash_stripes is the
+// content hash below. pack_bytes packs 64 bytes per word, a nonzero byte
+// being a one, and unpack_bytes writes the bits of each word as 64 bytes of
+// 0 or 1 (GF2Matrix::fromBytes); reverse_bits reverses the bit order within
+// each byte, for MSB-first bit streams. lookup_nibbles maps each byte
+// through a linear map given as two 16-byte tables, of its low nibble and
+// of its high one, whose entries are XORed (GF2NarrowMatrix products).
+struct RowKernel {
+    const char* name;
+    void (*xor_rows)(uint64_t* dst, const uint64_t* src, size_t words);
+    void (*xor_masked)(uint64_t* dst, const uint64_t* src, const uint64_t* mask, size_t words);
+    void (*swap)(uint64_t* a, uint64_t* b, size_t words);
+    size_t (*weight)(const uint64_t* row, size_t words);
+    size_t (*first_nonzero)(const uint64_t* row, size_t words);
+    void (*hash_stripes)(uint64_t* acc, const uint64_t* data, size_t stripes, size_t stripe0);
+    void (*pack_bytes)(uint64_t* dst, const uint8_t* src, size_t words);
+    void (*unpack_bytes)(uint8_t* dst, const uint64_t* src, size_t words);
+    void (*reverse_bits)(uint8_t* dst, const uint8_t* src, size_t bytes);
+    void (*lookup_nibbles)(uint8_t* dst, const uint8_t* src, const uint8_t* table, size_t bytes);
+};
+
+// The set of the instruction set of simd_kernel(), so GF2_SIMD_KERNEL
+// selects it too: AVX-512 for avx512 and gfni, AVX2, NEON for the Arm
+// kernels, else scalar. AVX-512F has no byte shuffles or compares, so its
+// weight, byte packing and nibble lookups are the AVX2 ones.
+const RowKernel& row_kernel();
+
+void row_xor_scalar(uint64_t* dst, const uint64_t* src, size_t words);
+void row_xor_masked_scalar(uint64_t* dst, const uint64_t* src, const uint64_t* mask,
+                           size_t words);
+void row_swap_scalar(uint64_t* a, uint64_t* b, size_t words);
+size_t row_weight_scalar(const uint64_t* row, size_t words);
+size_t row_first_nonzero_scalar(const uint64_t* row, size_t words);
+void hash_stripes_scalar(uint64_t* acc, const uint64_t* data, size_t stripes, size_t stripe0);
+void pack_bytes_scalar(uint64_t* dst, const uint8_t* src, size_t words);
+void unpack_bytes_scalar(uint8_t* dst, const uint64_t* src, size_t words);
+void reverse_bits_scalar(uint8_t* dst, const uint8_t* src, size_t bytes);
+void lookup_nibbles_scalar(uint8_t* dst, const uint8_t* src, const uint8_t* table,
+                           size_t bytes);
+#if defined(__x86_64__) || defined(_M_X64)
+void row_xor_avx2(uint64_t* dst, const uint64_t* src, size_t words);
+void row_xor_masked_avx2(uint64_t* dst, const uint64_t* src, const uint64_t* mask,
+                         size_t words);
+void row_swap_avx2(uint64_t* a, uint64_t* b, size_t words);
+size_t row_weight_avx2(const uint64_t* row, size_t words);
+size_t row_first_nonzero_avx2(const uint64_t* row, size_t words);
+void hash_stripes_avx2(uint64_t* acc, const uint64_t* data, size_t stripes, size_t stripe0);
+void pack_bytes_avx2(uint64_t* dst, const uint8_t* src, size_t words);
+void unpack_bytes_avx2(uint8_t* dst, const uint64_t* src, size_t words);
+void reverse_bits_avx2(uint8_t* dst, const uint8_t* src, size_t bytes);
+void lookup_nibbles_avx2(uint8_t* dst, const uint8_t* src, const uint8_t* table,
+                         size_t bytes);
+void row_xor_avx512(uint64_t* dst, const uint64_t* src, size_t words);
+void row_xor_masked_avx512(uint64_t* dst, const uint64_t* src, const uint64_t* mask,
+                           size_t words);
+void row_swap_avx512(uint64_t* a, uint64_t* b, size_t words);
+size_t row_first_nonzero_avx512(const uint64_t* row, size_t words);
+void hash_stripes_avx512(uint64_t* acc, const uint64_t* data, size_t stripes, size_t stripe0);
+#elif defined(__aarch64__)
+void row_xor_neon(uint64_t* dst, const uint64_t* src, size_t words);
+void row_xor_masked_neon(uint64_t* dst, const uint64_t* src, const uint64_t* mask,
+                         size_t words);
+void row_swap_neon(uint64_t* a, uint64_t* b, size_t words);
+size_t row_weight_neon(const uint64_t* row, size_t words);
+size_t row_first_nonzero_neon(const uint64_t* row, size_t words);
+void hash_stripes_neon(uint64_t* acc, const uint64_t* data, size_t stripes, size_t stripe0);
+void pack_bytes_neon(uint64_t* dst, const uint8_t* src, size_t words);
+void unpack_bytes_neon(uint8_t* dst, const uint64_t* src, size_t words);
+void reverse_bits_neon(uint8_t* dst, const uint8_t* src, size_t bytes);
+void lookup_nibbles_neon(uint8_t* dst, const uint8_t* src, const uint8_t* table,
+                         size_t bytes);
+#endif
+
+// --- Content hash ---
+
+// The accumulation of GF2Matrix::contentHash, after XXH3: eight 64-bit
+// lanes take a stripe of eight words d at a time, lane i adding
+// lo32(k) * hi32(k) for k = d[i] ^ key and lane i ^ 1 adding d[i] itself.
+// The key of lane i in stripe s of a block is HASH_SECRET[s + i]; after the
+// last stripe of a block every lane is scrambled, acc = (acc ^ acc >> 47 ^
+// HASH_SECRET[HASH_BLOCK_STRIPES + i]) * HASH_PRIME32, so that the order of
+// stripes matters across blocks too. The 32-bit multiplies are those of
+// VPMULUDQ and VMLAL, and every kernel gives the same lanes. stripe0 is the
+// index of the first stripe in the stream, for its position in the block.
+constexpr size_t HASH_STRIPE_WORDS = 8;
+constexpr size_t HASH_BLOCK_STRIPES = 16;
+constexpr uint64_t HASH_PRIME32 = 0x9E3779B1ULL;
+
+struct GF2HashSecret {
+    uint64_t words[HASH_BLOCK_STRIPES + HASH_STRIPE_WORDS];
+};
+
+// SplitMix64 from a fixed seed
+constexpr GF2HashSecret make_hash_secret() {
+    GF2HashSecret secret{};
+    uint64_t x = 0x243F6A8885A308D3ULL;
+    for (uint64_t& word : secret.words) {
+        x += 0x9E3779B97F4A7C15ULL;
+        uint64_t z = x;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        word = z ^ (z >> 31);
+    }
+    return secret;
+}
+inline constexpr GF2HashSecret HASH_SECRET = make_hash_secret();
+
+// --- Transpose ---
+
+// In-place transpose of a 64x64 bit block held as 64 words (row r in block[r])
+void transpose_64x64(uint64_t* block);
+#if defined(__x86_64__) || defined(_M_X64)
+// Its butterfly stages of shifts 32 down to 4 on AVX2, run when row_kernel()
+// is not the scalar set; transpose_64x64 finishes the last two
+void transpose_64x64_stages_avx2(uint64_t* block);
+#endif
+
+// dst (cols x rows bits) = transpose of src (rows x cols bits). Bits of src
+// beyond column 'cols' are ignored; dst padding bits are written as zero.
+void transpose_matrix(const uint64_t* src, size_t src_stride,
+                      uint64_t* dst, size_t dst_stride,
+                      size_t rows, size_t cols);
+
+// --- Batches of 64 x 64 matrices ---
+
+// Matrices of a batch are interleaved word by word in groups of BATCH_LANES:
+// row r of matrix l of a group is word r * BATCH_LANES + l, so one 512-bit
+// vector holds row r of eight matrices (a NEON vector of two).
+constexpr size_t BATCH_LANES = 8;
+constexpr size_t BATCH_GROUP_WORDS = 64 * BATCH_LANES;
+
+// c = a * b and dst = src^T, matrix by matrix, over 'groups' groups. c must
+// not alias a or b; dst may be src.
+using BatchMultiplyKernel = void (*)(const uint64_t* a, const uint64_t* b, uint64_t* c,
+                                     size_t groups);
+using BatchTransposeKernel = void (*)(const uint64_t* src, uint64_t* dst, size_t groups);
+
+// Portable versions, whose loops over the lanes the compiler vectorizes
+void batch_multiply_scalar(const uint64_t* a, const uint64_t* b, uint64_t* c, size_t groups);
+void batch_transpose_scalar(const uint64_t* src, uint64_t* dst, size_t groups);
+#if defined(__x86_64__) || defined(_M_X64)
+void batch_multiply_avx512(const uint64_t* a, const uint64_t* b, uint64_t* c, size_t groups);
+void batch_transpose_avx512(const uint64_t* src, uint64_t* dst, size_t groups);
+#endif
+
+// --- Method of Four Russians ---
+
+// Number of bits of A consumed by a single table lookup.
+constexpr size_t M4R_BITS = 8;
+
+// Number of tables built per pass, so that one pass consumes a full word of A.
+constexpr size_t M4R_TABLES = 64 / M4R_BITS;
+
+// Number of entries in each lookup table (2^M4R_BITS).
+constexpr size_t M4R_TABLE_ROWS = size_t(1) << M4R_BITS;
+
+// Width (in words) of the column panel of B for which the tables are built.
+// It is chosen so that all M4R_TABLES tables of a panel fit in the L2 cache.
+size_t m4r_panel_words(size_t n_words);
+
+// Table of all 2^bits linear combinations of the 'bits' rows of B starting
+// at b_rows, restricted to a panel of 'width' words: entry g (width words at
+// table + g * width) is the XOR of the rows whose bit is set in g.
+void m4r_build_table(const uint64_t* b_rows, size_t b_stride,
+                     size_t bits, size_t width, uint64_t* table);
+// The same table of Boolean combinations: entry g is the OR of the rows
+// whose bit is set in g
+void m4r_build_table_or(const uint64_t* b_rows, size_t b_stride,
+                        size_t bits, size_t width, uint64_t* table);
+
+// C = A * B (or C ^= A * B when accumulate is true) using the Method of Four
+// Russians. A is m x k bits, B is k x (n_words * 64) bits and C is
+// m x (n_words * 64) bits. Bits of A beyond column k are ignored. In the
+// Boolean semiring the tables hold ORs and the entries are ORed into C.
+void m4r_multiply_block(const uint64_t* a, size_t a_stride,
+                        const uint64_t* b, size_t b_stride,
+                        uint64_t* c, size_t c_stride,
+                        size_t m, size_t k, size_t n_words,
+                        bool accumulate, GF2Semiring semiring = GF2Semiring::XorAnd);
+
+// --- n x 64 blocks ---
+
+// An n x 64 block holds row k in word k (bit j is column j); a 64 x 64
+// matrix is a block of 64 words. Both kernels use OpenMP on long blocks.
+
+// c (64 x 64) = x^T * y: every word of y is XORed into one entry of each of
+// eight 256-entry tables, picked by the bytes of the word of x
+void block_transpose_mul_64(const uint64_t* x, const uint64_t* y, size_t n, uint64_t* c);
+
+// y = v * d (or y ^= v * d with accumulate) for a 64 x 64 d: one lookup per
+// byte of v in the M4R tables of d. y may be v.
+void block_mul_64(const uint64_t* v, const uint64_t* d, size_t n, uint64_t* y, bool accumulate);
+
+// --- Carry-less products ---
+
+// The word planes of GF2PolyMatrix products: lo[i * c_stride + j] and
+// hi[i * c_stride + j] ^= the low and high words of the carry-less dot
+// product, the XOR over p < k of the 128-bit products of a[i * a_stride + p]
+// and b_t[j * b_t_stride + p] as polynomials over GF(2), for i < m, j < n
+using ClmulBlockKernel = void (*)(const uint64_t* a, size_t a_stride, const uint64_t* b_t,
+                                  size_t b_t_stride, uint64_t* lo, uint64_t* hi,
+                                  size_t c_stride, size_t m, size_t n, size_t k);
+
+// The kernel chosen for this CPU at first use, like simd_kernel(); the
+// choice can be forced with GF2_CLMUL_KERNEL=scalar|pclmul|vpclmul|pmull
+// (if supported)
+struct ClmulKernel {
+    const char* name;
+    ClmulBlockKernel block;
+};
+const ClmulKernel& clmul_kernel();
+
+// Every kernel this CPU can run, best first; scalar is always last
+std::vector<ClmulKernel> clmul_kernels();
+
+// Shift-and-add, one bit of a at a time
+void clmul_block_scalar(const uint64_t* a, size_t a_stride, const uint64_t* b_t,
+                        size_t b_t_stride, uint64_t* lo, uint64_t* hi, size_t c_stride,
+                        size_t m, size_t n, size_t k);
+#if defined(__x86_64__) || defined(_M_X64)
+void clmul_block_pclmul(const uint64_t* a, size_t a_stride, const uint64_t* b_t,
+                        size_t b_t_stride, uint64_t* lo, uint64_t* hi, size_t c_stride,
+                        size_t m, size_t n, size_t k);
+void clmul_block_vpclmul(const uint64_t* a, size_t a_stride, const uint64_t* b_t,
+                         size_t b_t_stride, uint64_t* lo, uint64_t* hi, size_t c_stride,
+                         size_t m, size_t n, size_t k);
+#elif defined(__aarch64__)
+void clmul_block_pmull(const uint64_t* a, size_t a_stride, const uint64_t* b_t,
+                       size_t b_t_stride, uint64_t* lo, uint64_t* hi, size_t c_stride,
+                       size_t m, size_t n, size_t k);
+#endif
@@ -0,0 +1,167 @@
+#include "GF2LowRankMatrix.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+// Forward elimination of the rows of f, each row operation f_j ^= f_i
+// matched by g_i ^= g_j: with f_j' = f_j + f_i, f_j g_j^T = f_j' g_j^T +
+// f_i g_j^T, so the sum of the products f_i g_i^T is unchanged. The rows of
+// f left nonzero are independent (each has a one at its pivot that every
+// later row lacks); the others, and their rows of g, are dropped.
+void eliminate(GF2Matrix& f, GF2Matrix& g) {
+    const size_t r = f.rows();
+    std::vector<size_t> kept;
+    for (size_t i = 0; i < r; ++i) {
+        const size_t pivot = f.firstSetBit(i);
+        if (pivot == f.cols()) continue;
+        kept.push_back(i);
+        for (size_t j = i + 1; j < r; ++j) {
+            if (f.get(j, pivot)) {
+                f.rowXor(j, i, pivot / 64);
+                g.rowXor(i, j);
+            }
+        }
+    }
+    if (kept.size() == r) {
+        return;
+    }
+    GF2Matrix f_kept(kept.size(), f.cols()), g_kept(kept.size(), g.cols());
+    for (size_t x = 0; x < kept.size(); ++x) {
+        f_kept.rowXor(x, f, kept[x]);
+        g_kept.rowXor(x, g, kept[x]);
+    }
+    f = std::move(f_kept);
+    g = std::move(g_kept);
+}
+
+// Rows [0, src.rows()) of src, each ANDed with mask, into dst from row row0
+void copy_rows_masked(GF2Matrix& dst, size_t row0, const GF2Matrix& src,
+                      const std::vector<uint64_t>& mask) {
+    uint64_t* out = dst.get_raw_data();
+    for (size_t i = 0; i < src.rows(); ++i) {
+        const uint64_t* row = src.get_raw_data() + i * src.row_stride();
+        uint64_t* dst_row = out + (row0 + i) * dst.row_stride();
+        for (size_t w = 0; w < src.words_per_row(); ++w) {
+            dst_row[w] = row[w] & mask[w];
+        }
+    }
+}
+
+std::vector<uint64_t> identity_diagonal(size_t n) {
+    std::vector<uint64_t> diagonal((n + 63) / 64, ~uint64_t(0));
+    if (n % 64 != 0) {
+        diagonal.back() = (uint64_t(1) << (n % 64)) - 1;
+    }
+    return diagonal;
+}
+
+} // namespace
+
+GF2LowRankMatrix::GF2LowRankMatrix(size_t n)
+    : m_n(n), m_diagonal(identity_diagonal(n)), m_ut(0, n), m_vt(0, n) {}
+
+GF2LowRankMatrix::GF2LowRankMatrix(const GF2Matrix& u, const GF2Matrix& v)
+    : GF2LowRankMatrix(identity_diagonal(u.rows()), u, v) {}
+
+GF2LowRankMatrix::GF2LowRankMatrix(const std::vector<uint64_t>& diagonal, const GF2Matrix& u,
+                                   const GF2Matrix& v)
+    : m_n(u.rows()), m_diagonal(diagonal), m_ut(u.transpose()), m_vt(v.transpose()) {
+    if (u.rows() != v.rows() || u.cols() != v.cols()) {
+        throw std::runtime_error("Low-rank factors of different shapes");
+    }
+    if (diagonal.size() != (m_n + 63) / 64) {
+        throw std::runtime_error("Diagonal length does not match the matrix");
+    }
+    if (m_n % 64 != 0) {
+        m_diagonal.back() &= (uint64_t(1) << (m_n % 64)) - 1;
+    }
+}
+
+size_t GF2LowRankMatrix::storage_bytes() const {
+    const size_t factor_words = m_ut.rows() * m_ut.row_stride() + m_vt.rows() * m_vt.row_stride();
+    return (m_diagonal.size() + factor_words) * sizeof(uint64_t);
+}
+
+GF2Matrix GF2LowRankMatrix::toDense(int num_threads) const {
+    GF2Matrix dense = rank() > 0 ? m_ut.multiplyAtB(m_vt, num_threads) : GF2Matrix(m_n, m_n);
+    for (size_t i = 0; i < m_n; ++i) {
+        if ((m_diagonal[i / 64] >> (i % 64)) & 1) {
+            dense.set(i, i, !dense.get(i, i));
+        }
+    }
+    return dense;
+}
+
+void GF2LowRankMatrix::multiplyVector(const uint64_t* x, uint64_t* y, int num_threads) const {
+    const size_t words = m_diagonal.size();
+    if (rank() > 0) {
+        std::vector<uint64_t> t((rank() + 63) / 64);
+        m_vt.multiplyVector(x, t.data(), num_threads);
+        m_ut.leftMultiplyVector(t.data(), y, num_threads);
+    } else {
+        std::fill_n(y, words, 0);
+    }
+    for (size_t w = 0; w < words; ++w) {
+        y[w] ^= m_diagonal[w] & x[w];
+    }
+}
+
+// V is transposed back for the product, O(n r) against the O(n k r) of the
+// passes over b
+GF2Matrix GF2LowRankMatrix::multiply(const GF2Matrix& b, int num_threads) const {
+    if (b.rows() != m_n) {
+        throw std::runtime_error("Matrix dimensions incompatible for multiplication");
+    }
+    GF2Matrix result(0, 0);
+    if (rank() > 0) {
+        const GF2Matrix v = m_vt.transpose();
+        result = m_ut.multiplyAtB(v.multiplyAtB(b, num_threads), num_threads);
+    } else {
+        result = GF2Matrix(m_n, b.cols());
+    }
+    for (size_t i = 0; i < m_n; ++i) {
+        if ((m_diagonal[i / 64] >> (i % 64)) & 1) {
+            result.rowXor(i, b, i);
+        }
+    }
+    return result;
+}
+
+// In the transposed factors: U^T = [U2^T D1; U1^T] and
+// V^T = [V2^T; V1^T D2 + (V1^T U2) V2^T]
+GF2LowRankMatrix GF2LowRankMatrix::compose(const GF2LowRankMatrix& other,
+                                           int num_threads) const {
+    if (other.m_n != m_n) {
+        throw std::runtime_error("Matrix dimensions incompatible for multiplication");
+    }
+    const size_t r1 = rank(), r2 = other.rank();
+    const std::vector<uint64_t> all = identity_diagonal(m_n);
+    GF2Matrix ut(r1 + r2, m_n), vt(r1 + r2, m_n);
+    copy_rows_masked(ut, 0, other.m_ut, m_diagonal);
+    copy_rows_masked(ut, r2, m_ut, all);
+    copy_rows_masked(vt, 0, other.m_vt, all);
+    copy_rows_masked(vt, r2, m_vt, other.m_diagonal);
+    if (r1 > 0 && r2 > 0) {
+        const GF2Matrix w = m_vt.multiplyABt(other.m_ut, num_threads)
+                                .multiplySIMDParallel(other.m_vt, num_threads);
+        for (size_t i = 0; i < r1; ++i) {
+            vt.rowXor(r2 + i, w, i);
+        }
+    }
+    eliminate(ut, vt);
+    eliminate(vt, ut);
+
+    GF2LowRankMatrix result(m_n);
+    for (size_t w = 0; w < m_diagonal.size(); ++w) {
+        result.m_diagonal[w] = m_diagonal[w] & other.m_diagonal[w];
+    }
+    result.m_ut = std::move(ut);
+    result.m_vt = std::move(vt);
+    return result;
+}
+
+void GF2LowRankMatrix::compress() {
+    eliminate(m_ut, m_vt);
+    eliminate(m_vt, m_ut);
+}
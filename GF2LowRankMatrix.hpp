@@ -0,0 +1,61 @@
+#pragma once
+
+#include "GF2Matrix.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A square n x n GF(2) matrix D + U V^T: D diagonal (the identity unless
+// given), U and V of n x r, so the work and memory scale with n r instead of
+// n^2. The factors are kept transposed, as the r x n matrices U^T and V^T
+// whose rows are the columns of U and V (a row of n x r bits would take a
+// whole cache line). With x a vector or an n x k matrix:
+//   - D x + U (V^T x) costs O(n r) for a vector and O(n k r) for a matrix,
+//     V^T x being the table-driven multiplyAtB of a narrow V (r <= 128);
+//   - a composition is again of this form, of rank r1 + r2 at most, in
+//     O(n r1 r2), and is compressed to the rank of its U V^T.
+class GF2LowRankMatrix {
+public:
+    // The n x n identity (rank 0)
+    explicit GF2LowRankMatrix(size_t n);
+    // I + U V^T. Throws std::runtime_error unless U and V have the same shape.
+    GF2LowRankMatrix(const GF2Matrix& u, const GF2Matrix& v);
+    // D + U V^T with bit i of diagonal (n bits, (n + 63) / 64 words) the
+    // entry (i, i) of D
+    GF2LowRankMatrix(const std::vector<uint64_t>& diagonal, const GF2Matrix& u,
+                     const GF2Matrix& v);
+
+    size_t size() const { return m_n; }
+    // Number of columns of U and V (an upper bound on the rank of U V^T,
+    // equal to it after compress())
+    size_t rank() const { return m_ut.rows(); }
+    const std::vector<uint64_t>& diagonal() const { return m_diagonal; }
+    // U^T and V^T, rank() x size()
+    const GF2Matrix& ut() const { return m_ut; }
+    const GF2Matrix& vt() const { return m_vt; }
+    // Bytes of the diagonal and the factors
+    size_t storage_bytes() const;
+
+    GF2Matrix toDense(int num_threads = 0) const;
+
+    // y = this * x for vectors of (size() + 63) / 64 words: V^T x, then U times
+    // that, then the diagonal. y must not be x.
+    void multiplyVector(const uint64_t* x, uint64_t* y, int num_threads = 0) const;
+    // this * b for b of size() rows. num_threads <= 0 uses the OpenMP default.
+    GF2Matrix multiply(const GF2Matrix& b, int num_threads = 0) const;
+    // this * other: D1 D2 + [D1 U2 | U1] [V2 | D2 V1 + V2 (U2^T V1)]^T,
+    // compressed. Throws std::runtime_error if the sizes differ.
+    GF2LowRankMatrix compose(const GF2LowRankMatrix& other, int num_threads = 0) const;
+
+    // Drops dependent columns of U, then of V, until both have independent
+    // columns, so rank() is that of U V^T: row operations on U^T or V^T,
+    // each matched by its inverse transpose on the other to keep U V^T
+    // (O(n r^2)).
+    void compress();
+
+private:
+    size_t m_n;
+    std::vector<uint64_t> m_diagonal;
+    GF2Matrix m_ut;
+    GF2Matrix m_vt;
+};
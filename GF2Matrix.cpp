@@ -1,18 +1,38 @@
 #include "GF2Matrix.hpp"
+#include "GF2Numa.hpp"
+#include "GF2Random.hpp"
+#include <algorithm>
 #include <iostream>
 #include <cstring>
 // #include <immintrin.h> 
 
-GF2Matrix::GF2Matrix(size_t rows, size_t cols) : m_rows(rows), m_cols(cols) {
-    // Each row is padded to be a multiple of 64 bits for efficient SIMD access.
+GF2Matrix::GF2Matrix(size_t rows, size_t cols, size_t row_align_words)
+    : m_rows(rows), m_cols(cols) {
+    // Each row is padded to be a multiple of 64 bits, and the row stride to a
+    // multiple of row_align_words so rows are whole SIMD vectors.
+    row_align_words = std::max<size_t>(1, row_align_words);
     m_words_per_row = (cols + 63) / 64;
-    m_data.resize(rows * m_words_per_row, 0);
+    m_row_stride = (m_words_per_row + row_align_words - 1) / row_align_words * row_align_words;
+    m_data.resize(rows * m_row_stride);
+    gf2_first_touch_zero(m_data.data(), rows, m_row_stride);
+}
+
+size_t GF2Matrix::page_aligned_bytes() const {
+    // GF2AlignedAllocator page-aligns and page-pads allocations from
+    // GF2_PAGE_ALIGN_MIN_BYTES up; the capacity is what was allocated
+    const size_t bytes = m_data.capacity() * sizeof(uint64_t);
+    const size_t page = gf2_page_size();
+    if (bytes < GF2_PAGE_ALIGN_MIN_BYTES ||
+        reinterpret_cast<uintptr_t>(m_data.data()) % page != 0) {
+        return 0;
+    }
+    return (bytes + page - 1) / page * page;
 }
 
 bool GF2Matrix::get(size_t row, size_t col) const {
     if (row >= m_rows || col >= m_cols) return false;
     
-    size_t word_index = row * m_words_per_row + (col / 64);
+    size_t word_index = row * m_row_stride + (col / 64);
     size_t bit_index = col % 64;
     
     return (m_data[word_index] >> bit_index) & 1ULL;
@@ -20,8 +40,9 @@ bool GF2Matrix::get(size_t row, size_t col) const {
 
 void GF2Matrix::set(size_t row, size_t col, bool value) {
     if (row >= m_rows || col >= m_cols) return;
+    invalidateStructure();
     
-    size_t word_index = row * m_words_per_row + (col / 64);
+    size_t word_index = row * m_row_stride + (col / 64);
     size_t bit_index = col % 64;
     
     if (value) {
@@ -33,24 +54,22 @@ void GF2Matrix::set(size_t row, size_t col, bool value) {
 
 void GF2Matrix::randomFill() {
     std::random_device rd;
-    std::mt19937_64 gen(rd());
-    std::uniform_int_distribution<uint64_t> dis;
-    
-    for (auto& word : m_data) {
-        word = dis(gen);
-    }
+    randomFill((uint64_t(rd()) << 32) | rd());
 }
 
-GF2Matrix GF2Matrix::transpose() const {
-    GF2Matrix result(m_cols, m_rows);
+void GF2Matrix::randomFill(uint64_t seed, int num_threads) {
+    invalidateStructure();
+    gf2_random_fill(m_data.data(), m_rows, m_words_per_row, m_row_stride, seed, num_threads);
+    clearPadding();
+}
+
+void GF2Matrix::clearPadding() {
+    if (m_cols % 64 == 0) return;
+
+    uint64_t mask = (1ULL << (m_cols % 64)) - 1;
     for (size_t i = 0; i < m_rows; ++i) {
-        for (size_t j = 0; j < m_cols; ++j) {
-            if (get(i, j)) {
-                result.set(j, i, true);
-            }
-        }
+        m_data[i * m_row_stride + m_words_per_row - 1] &= mask;
     }
-    return result;
 }
 
 GF2Matrix GF2Matrix::multiplySerial(const GF2Matrix& other) const {
@@ -75,33 +94,6 @@ GF2Matrix GF2Matrix::multiplySerial(const GF2Matrix& other) const {
     return result;
 }
 
-// Forward declare the platform-specific SIMD functions
-#if defined(__x86_64__) || defined(_M_X64)
-void multiply_simd_x86(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result);
-#elif defined(__aarch64__)
-void multiply_simd_neon(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result);
-#endif
-
-GF2Matrix GF2Matrix::multiplySIMD(const GF2Matrix& other) const {
-    if (m_cols != other.m_rows) {
-        throw std::runtime_error("Matrix dimensions incompatible for multiplication");
-    }
-    
-    GF2Matrix result(m_rows, other.m_cols);
-
-#if defined(__x86_64__) || defined(_M_X64)
-    // Dispatch to the AVX implementation on x86-64
-    multiply_simd_x86(*this, other, result);
-#elif defined(__aarch64__)
-    // Dispatch to the NEON implementation on ARM64
-    multiply_simd_neon(*this, other, result);
-#else
-    // Fallback for other architectures
-    return multiplySerial(other);
-#endif
-    return result;
-}
-
 bool GF2Matrix::operator==(const GF2Matrix& other) const {
     if (m_rows != other.m_rows || m_cols != other.m_cols) {
         return false;
@@ -109,7 +101,7 @@ bool GF2Matrix::operator==(const GF2Matrix& other) const {
     
     // Compare row by row, ignoring padding
     for (size_t i = 0; i < m_rows; ++i) {
-        if (memcmp(m_data.data() + i * m_words_per_row, other.m_data.data() + i * other.m_words_per_row, m_words_per_row * sizeof(uint64_t)) != 0) {
+        if (memcmp(m_data.data() + i * m_row_stride, other.m_data.data() + i * other.m_row_stride, m_words_per_row * sizeof(uint64_t)) != 0) {
             return false;
         }
     }
@@ -1,26 +1,173 @@
 #pragma once
 
+#include "GF2AlignedAllocator.hpp"
 #include <vector>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <random>
+#include <string>
+
+// Tile sizes of the cache-blocked SIMD multiply. Zero fields are derived from
+// the detected cache geometry by resolve().
+struct GF2TileConfig {
+    size_t rows = 0;    // rows of A per tile
+    size_t words = 0;   // result words (64 columns of B) per tile
+    size_t k_words = 0; // common-dimension words per tile
+
+    // Fills the zero fields so the A tile (rows x k_words) uses half of L1
+    // and the B^T tile (words * 64 x k_words) half of L2
+    GF2TileConfig resolve() const;
+};
+
+// Scratch buffers of multiplyInto/addMul. They grow to the largest shape seen
+// and are then reused, so repeated multiplies of the same shapes do not
+// allocate. A workspace must not be shared by concurrent calls.
+struct GF2Workspace {
+    std::vector<uint64_t, GF2AlignedAllocator<uint64_t>> b_t;      // B^T, padded rows
+    std::vector<uint64_t, GF2AlignedAllocator<uint64_t>> packed_b; // kernel layout of B^T
+};
+
+// Arithmetic of a product. XorAnd is GF(2): c_ij is the parity of the
+// a_ik & b_kj. OrAnd is the Boolean semiring: c_ij is set if any a_ik & b_kj
+// is, the product of adjacency matrices (reachability). Addition is then
+// idempotent, so accumulating products ORs them into c instead of XORing.
+enum class GF2Semiring { XorAnd, OrAnd };
+
+// Which triangle of a square matrix the triangular products and solves read
+// (GF2Matrix::triangularMultiply); the bits of the other one are ignored
+enum class GF2Triangle { Lower, Upper };
+
+// Bit order within the bytes of a packed bit stream (GF2Matrix::fromBits).
+// MsbFirst puts the first column in the high bit of a byte, as network and
+// big-endian formats and numpy.packbits do; LsbFirst in the low bit, as
+// packbits(bitorder='little') and this library's own words do.
+enum class GF2BitOrder { MsbFirst, LsbFirst };
+
+class GF2PackedOperand;
+class GF2TaskPool;
+class GF2Transposed;
+class GF2MatrixView;
+class GF2MutableMatrixView;
+struct GF2PLE;
+struct GF2Structure;
+
+// A 128-bit hash of a matrix's shape and bits (GF2Matrix::contentHash)
+struct GF2ContentHash {
+    uint64_t lo = 0;
+    uint64_t hi = 0;
+
+    bool operator==(const GF2ContentHash& o) const { return lo == o.lo && hi == o.hi; }
+    bool operator!=(const GF2ContentHash& o) const { return !(*this == o); }
+};
 
 class GF2Matrix {
 public:
-    // Constructor
-    GF2Matrix(size_t rows, size_t cols);
+    // Default row alignment in words: rows start on a 64-byte boundary and
+    // span whole AVX-512 vectors
+    static constexpr size_t ROW_ALIGN_WORDS = GF2_STORAGE_ALIGNMENT / sizeof(uint64_t);
+
+    // Constructor. Rows are padded to a multiple of row_align_words words;
+    // the padding (bits past cols and words past words_per_row) is kept zero.
+    GF2Matrix(size_t rows, size_t cols, size_t row_align_words = ROW_ALIGN_WORDS);
     
-    // Accessors
+    // Accessors. Row r starts at get_raw_data() + r * row_stride() and holds
+    // words_per_row() significant words. Writers through get_raw_data() must
+    // leave the padding zero. The non-const get_raw_data() drops the cached
+    // structure() and contentHash().
     size_t rows() const { return m_rows; }
     size_t cols() const { return m_cols; }
     size_t words_per_row() const { return m_words_per_row; }
+    size_t row_stride() const { return m_row_stride; }
     const uint64_t* get_raw_data() const { return m_data.data(); }
+    uint64_t* get_raw_data() {
+        invalidateStructure();
+        return m_data.data();
+    }
+
+    // Length in bytes of the storage allocation if it is page aligned and a
+    // whole number of pages (so the GPU can use it in place), else 0
+    size_t page_aligned_bytes() const;
+
+    // Windows of rows [row0, row1) and columns [col0, col1) into this
+    // matrix, without a copy (see GF2MatrixView.hpp). A writable window
+    // starts at a multiple of 64 columns and ends at one or at cols().
+    GF2MatrixView view(size_t row0, size_t row1, size_t col0, size_t col1) const;
+    GF2MutableMatrixView mutableView(size_t row0, size_t row1, size_t col0, size_t col1);
     
     // Get/set bit at position (row, col)
     bool get(size_t row, size_t col) const;
     void set(size_t row, size_t col, bool value);
+
+    // Bulk import and export with the row kernels' byte packing (movemask
+    // on x86, VTST and pairwise adds on Arm), parallel over rows on
+    // num_threads OpenMP threads (<= 0 for the default). Rows of the array
+    // are row_bytes apart, 0 for tightly packed rows; a shorter stride
+    // throws std::runtime_error. Byte arrays hold one byte per bit, a
+    // nonzero byte being a one; toBytes writes 0 or 1.
+    static GF2Matrix fromBytes(const uint8_t* bytes, size_t rows, size_t cols,
+                               size_t row_bytes = 0, int num_threads = 0);
+    void toBytes(uint8_t* bytes, size_t row_bytes = 0, int num_threads = 0) const;
+    // Packed bit streams: each row (cols + 7) / 8 bytes, starting on a byte.
+    // fromBits ignores the bits past cols in a row's last byte; toBits
+    // writes them zero.
+    static GF2Matrix fromBits(const uint8_t* bits, size_t rows, size_t cols,
+                              GF2BitOrder order = GF2BitOrder::MsbFirst, size_t row_bytes = 0,
+                              int num_threads = 0);
+    void toBits(uint8_t* bits, GF2BitOrder order = GF2BitOrder::MsbFirst, size_t row_bytes = 0,
+                int num_threads = 0) const;
     
+    // Whole-row operations with the row kernels of the selected SIMD kernel's
+    // instruction set (GF2Kernels.hpp), for elimination and updates: checked
+    // once per call instead of once per bit. A word range is [word0, word1)
+    // of the words_per_row() words; word1 past the row is clamped. Throw
+    // std::runtime_error for a row out of range.
+    void rowXor(size_t dst, size_t src, size_t word0 = 0, size_t word1 = SIZE_MAX);
+    // Row dst ^= row r of src (same cols())
+    void rowXor(size_t dst, const GF2Matrix& src, size_t r, size_t word0 = 0,
+                size_t word1 = SIZE_MAX);
+    // Row dst ^= row src & mask, mask holding words_per_row() words
+    void rowXorMasked(size_t dst, size_t src, const uint64_t* mask);
+    void rowSwap(size_t r0, size_t r1);
+    // Column of the first one in the row at or after column 'from', or cols()
+    size_t firstSetBit(size_t row, size_t from = 0) const;
+
+    // Hamming weights: of a row, of every row, of every column, of the matrix
+    size_t rowWeight(size_t row) const;
+    std::vector<size_t> rowWeights() const;
+    std::vector<size_t> columnWeights() const;
+    size_t popcount() const;
+
+    // What the contents look like to a dispatcher (GF2Structure below),
+    // scanned in one pass over the rows on the first call and then cached on
+    // the matrix; copies share it. Every non-const member (get_raw_data(),
+    // set(), the row operations, randomFill(), writable views) drops it, so
+    // the next call scans again. Writes through a pointer or view taken
+    // before the scan must be followed by invalidateStructure(). Safe to
+    // call from several threads on an unchanging matrix.
+    const GF2Structure& structure() const;
+    // Drops the cached structure() and contentHash()
+    void invalidateStructure() {
+        m_structure.reset();
+        m_hash.reset();
+    }
+
+    // A hash of the shape and the bits, the same for equal matrices whatever
+    // their row stride: the XXH3-style accumulation of GF2Kernels.hpp over
+    // each row padded with zeros to whole stripes of eight words, with the
+    // dispatched row kernel (AVX-512, AVX2, NEON or scalar, all giving the
+    // same value). The rows are hashed in chunks of fixed size on OpenMP
+    // threads, so the value does not depend on the thread count either.
+    // Cached and dropped like structure(). Not collision resistant against
+    // inputs built to collide.
+    GF2ContentHash contentHash() const;
+
     // Fill with random bits
     void randomFill();
+    // The same bits for the same seed, on any machine and thread count: the
+    // counter-based gf2_random_fill stream (GF2Random.hpp), generated in
+    // parallel over OpenMP threads (num_threads <= 0 for the default)
+    void randomFill(uint64_t seed, int num_threads = 0);
     
     // Matrix multiplication (serial implementation)
     GF2Matrix multiplySerial(const GF2Matrix& other) const;
@@ -28,8 +175,212 @@ public:
     // Matrix multiplication (SIMD implementation)
     GF2Matrix multiplySIMD(const GF2Matrix& other) const;
 
-    // Transpose the matrix
-    GF2Matrix transpose() const;
+    // Matrix multiplication (SIMD implementation, OpenMP across row blocks of
+    // A and column blocks of B^T; num_threads <= 0 uses the OpenMP default)
+    GF2Matrix multiplySIMDParallel(const GF2Matrix& other, int num_threads = 0) const;
+
+    // multiplySIMDParallel with one of the register-tile kernels named by
+    // simdTileNames() instead of the dispatched kernel (GF2Engine times them
+    // all); throws std::runtime_error for another name
+    GF2Matrix multiplySIMDTile(const GF2Matrix& other, const std::string& tile,
+                               int num_threads = 0) const;
+
+    // out = this * other into a caller-owned matrix of the right shape, with
+    // the SIMD kernel. num_threads > 1 (or <= 0 for the OpenMP default)
+    // splits the work like multiplySIMDParallel.
+    void multiplyInto(const GF2Matrix& other, GF2Matrix& out, GF2Workspace& ws,
+                      int num_threads = 1) const;
+
+    // c ^= a * b, fused: the product is accumulated straight into c
+    static void addMul(GF2Matrix& c, const GF2Matrix& a, const GF2Matrix& b, GF2Workspace& ws,
+                       int num_threads = 1);
+
+    // The same multiplies with a B prepared once by GF2PackedOperand, so the
+    // per-call cost scales with A only
+    GF2Matrix multiplySIMD(const GF2PackedOperand& other) const;
+    GF2Matrix multiplySIMDParallel(const GF2PackedOperand& other, int num_threads = 0) const;
+    void multiplyInto(const GF2PackedOperand& other, GF2Matrix& out, int num_threads = 1) const;
+    static void addMul(GF2Matrix& c, const GF2Matrix& a, const GF2PackedOperand& b,
+                       int num_threads = 1);
+
+    // The same products, the Four Russians and Strassen ones and the
+    // transpose on views (GF2MatrixView.hpp), whose word-aligned windows
+    // the kernels read and write in place. The output must not overlap an
+    // operand. multiplyM4RInto adds to out if accumulate is set. The SIMD
+    // and Four Russians products on views take the semiring; Strassen's
+    // subtractions exist in GF(2) only.
+    static void multiplyInto(const GF2MatrixView& a, const GF2MatrixView& b,
+                             const GF2MutableMatrixView& out, GF2Workspace& ws,
+                             int num_threads = 1, GF2Semiring semiring = GF2Semiring::XorAnd);
+    static void addMul(const GF2MutableMatrixView& c, const GF2MatrixView& a,
+                       const GF2MatrixView& b, GF2Workspace& ws, int num_threads = 1,
+                       GF2Semiring semiring = GF2Semiring::XorAnd);
+    static void addMul(const GF2MutableMatrixView& c, const GF2MatrixView& a,
+                       const GF2PackedOperand& b, int num_threads = 1);
+    static void multiplyM4RInto(const GF2MatrixView& a, const GF2MatrixView& b,
+                                const GF2MutableMatrixView& out, bool accumulate = false,
+                                GF2Semiring semiring = GF2Semiring::XorAnd);
+    static void multiplyStrassenInto(const GF2MatrixView& a, const GF2MatrixView& b,
+                                     const GF2MutableMatrixView& out, size_t cutoff = 1024,
+                                     GF2TaskPool* pool = nullptr);
+    static void transposeInto(const GF2MatrixView& src, const GF2MutableMatrixView& dst);
+
+    // Only the rows [row0, row1) of out = this * other; the other rows of out
+    // are left as they are, so another device may fill them concurrently
+    void multiplyRowsInto(const GF2PackedOperand& other, GF2Matrix& out, size_t row0,
+                          size_t row1, int num_threads = 1) const;
+
+    // Work partition of the parallel multiply. A column block spans eight
+    // result words (one cache line) so threads never share an output word.
+    static constexpr size_t PARALLEL_ROW_BLOCK = 64;
+    static constexpr size_t PARALLEL_COL_BLOCK = 8 * 64;
+
+    // Matrix multiplication (SIMD implementation, blocked over i, j and k so
+    // the working set stays in L1/L2; tiles are spread across OpenMP threads)
+    GF2Matrix multiplySIMDTiled(const GF2Matrix& other, const GF2TileConfig& tiles = GF2TileConfig(),
+                                int num_threads = 0) const;
+    GF2Matrix multiplySIMDTiled(const GF2PackedOperand& other,
+                                const GF2TileConfig& tiles = GF2TileConfig(),
+                                int num_threads = 0) const;
+
+    // this * B^T for other = B.transpose(), B with cols() columns:
+    // multiplyABt on the rows of B as they are, or multiplyAAt mirrored
+    // when B is this matrix
+    GF2Matrix multiplySIMD(const GF2Transposed& other) const;
+    GF2Matrix multiplySIMDParallel(const GF2Transposed& other, int num_threads = 0) const;
+
+    // Products with a transposed operand, without the transpose: this * b^T
+    // (b with cols() columns) runs the dot-product kernel on b's rows as
+    // they are. this^T * b (b with rows() rows) takes each 64-column block
+    // of a matrix of up to 128 columns as the x of leftMultiplyBlock against
+    // b; wider ones are transposed, which then costs less than the passes
+    // over b. For Gram matrices (A A^T, A^T A) and parity checks (H^T x for
+    // a block of syndromes). transpose_result returns
+    // the transpose of the product instead (b * this^T, or b^T * this),
+    // made by the same kernels with the operands swapped. Throws
+    // std::runtime_error if the shapes do not match.
+    GF2Matrix multiplyABt(const GF2Matrix& b, int num_threads = 0,
+                          bool transpose_result = false) const;
+    GF2Matrix multiplyAtB(const GF2Matrix& b, int num_threads = 0,
+                          bool transpose_result = false) const;
+
+    // The Gram matrix this * this^T (rows() x rows(), symmetric), SYRK-style:
+    // only the result words of one triangle are computed, each by the
+    // dot-product kernel on this as its own B^T, so it costs about half of
+    // multiplyABt(*this). The other triangle is left zero, or filled in by
+    // mirrorTriangle if mirror is set.
+    GF2Matrix multiplyAAt(GF2Triangle triangle = GF2Triangle::Lower, bool mirror = false,
+                          int num_threads = 0) const;
+
+    // Copies the given triangle of a square matrix onto the other one, a
+    // transposed 64 x 64 block at a time, which makes it symmetric. Throws
+    // std::runtime_error if the matrix is not square.
+    void mirrorTriangle(GF2Triangle triangle, int num_threads = 0);
+
+    // Matrix multiplication (Method of Four Russians)
+    GF2Matrix multiplyM4R(const GF2Matrix& other,
+                          GF2Semiring semiring = GF2Semiring::XorAnd) const;
+
+    // Boolean product (GF2Semiring::OrAnd) with the SIMD kernel, OpenMP as
+    // in multiplySIMDParallel
+    GF2Matrix multiplyBoolean(const GF2Matrix& other, int num_threads = 0) const;
+
+    // Transitive closure of the relation whose adjacency matrix this is (bit
+    // (i, j) set for an edge i -> j): bit (i, j) of the result is set if j
+    // is reachable from i by a path of one or more edges, or of zero edges
+    // as well with reflexive. The reflexive closure is A | I squared (Boolean)
+    // until a square changes nothing: s squares cover the paths of up to 2^s
+    // edges, so it takes at most about log2(rows()) products. The other one
+    // is A times that. Throws std::runtime_error if the matrix is not square.
+    GF2Matrix transitiveClosure(bool reflexive = false, int num_threads = 0) const;
+
+    // Matrix multiplication (Strassen-Winograd recursion down to an M4R base
+    // case once any dimension drops to 'cutoff' or below). With a pool
+    // (GF2TaskPool.hpp) the seven products of the top levels run as its
+    // tasks, at the cost of a buffer per product.
+    GF2Matrix multiplyStrassen(const GF2Matrix& other, size_t cutoff = 1024,
+                               GF2TaskPool* pool = nullptr) const;
+
+    // Name of the dot-product kernel picked for this CPU (scalar, avx2,
+    // avx512, gfni, neon, neon-eor3, sve2), and of the one that runs Boolean
+    // products (scalar, avx2, avx512, neon)
+    static const char* simdKernelName();
+    static const char* booleanKernelName();
+    // The register-tile kernels of this CPU's instruction set, e.g.
+    // "avx2-4x2x1" for tiles of 4 rows of A by 2 columns, k unrolled once
+    static std::vector<std::string> simdTileNames();
+
+    // The transpose, in O(1): the matrix itself read in column-major
+    // orientation (GF2Transposed below), which the products pick their
+    // kernel by. It becomes a row-major GF2Matrix, a physical transpose,
+    // only when converted to one.
+    GF2Transposed transpose() const;
+
+    // Products with vectors and with n x 64 blocks of vectors (one word per
+    // row, bit j in column j; see GF2Kernels.hpp), which read the matrix
+    // once. A vector has a word per 64 entries. num_threads <= 0 uses the
+    // OpenMP default.
+    //
+    // y = this * x: x has words_per_row() words, y (rows() + 63) / 64
+    void multiplyVector(const uint64_t* x, uint64_t* y, int num_threads = 0) const;
+    // y = x^T * this: x has (rows() + 63) / 64 words, y words_per_row()
+    void leftMultiplyVector(const uint64_t* x, uint64_t* y, int num_threads = 0) const;
+    // y = this * x for a cols() x 64 block x; y has rows() words. The SIMD
+    // dot-product kernel runs against x^T, 64 rows of cols() bits.
+    void multiplyBlock(const uint64_t* x, uint64_t* y, int num_threads = 0) const;
+    // y = x^T * this for a rows() x 64 block x: 64 rows of words_per_row()
+    // words. Every row of the matrix is XORed into one entry of each of
+    // eight tables, picked by the bytes of its word of x, and the tables are
+    // then folded into the 64 rows, a column panel at a time.
+    void leftMultiplyBlock(const uint64_t* x, uint64_t* y, int num_threads = 0) const;
+
+    // this^n of a square matrix by repeated squaring: about log2(n) squares
+    // plus a multiply per set bit of n, through buffers reused across the
+    // steps. Throws std::runtime_error if the matrix is not square. For many
+    // powers of one matrix, GF2MatrixPowers keeps the squares.
+    GF2Matrix power(uint64_t n, int num_threads = 0) const;
+    // y = this^n * x for a vector x of (rows() + 63) / 64 words; y may be x
+    void applyPower(uint64_t n, const uint64_t* x, uint64_t* y, int num_threads = 0) const;
+
+    // PLE decomposition P * A = L * E (see GF2PLE), by recursive column
+    // splitting whose trailing updates are SIMD multiplies, down to blocks
+    // of 512 columns eliminated with Four Russians tables. num_threads <= 0
+    // uses the OpenMP default.
+    GF2PLE ple(int num_threads = 0) const;
+
+    // Rank over GF(2), from the PLE decomposition
+    size_t rank(int num_threads = 0) const;
+
+    // Row echelon form: the rank() independent rows first, then zero rows.
+    // In the reduced form every pivot column is a unit vector.
+    GF2Matrix echelonForm(bool reduced = true, int num_threads = 0) const;
+
+    // A solution X of a * X = b for all columns of b at once (free variables
+    // zero), by one PLE of a and triangular solves on the whole block of
+    // right-hand sides. Throws std::runtime_error if there is none. The
+    // overload taking a PLE reuses one factorization across calls.
+    static GF2Matrix solve(const GF2Matrix& a, const GF2Matrix& b, int num_threads = 0);
+    static GF2Matrix solve(const GF2PLE& a, const GF2Matrix& b, int num_threads = 0);
+
+    // In place on the rows of b, for a square t of b.rows() rows of which
+    // only the triangle (and the diagonal unless unit_diagonal, which takes
+    // it as all ones) is read: b = t * b, and b = t^-1 * b. Both recurse on
+    // halves of t, the off-diagonal block a multiply (addMul) and the zero
+    // one skipped, down to blocks of TRIANGULAR_BASE_ROWS rows done with
+    // Four Russians tables of four rows of b at a time. The columns of b
+    // are split into blocks of whole cache lines, one per OpenMP thread
+    // (num_threads <= 0 for the default). Throw std::runtime_error if the
+    // shapes do not match, or for a solve with a zero on the diagonal.
+    static void triangularMultiply(const GF2MatrixView& t, GF2Triangle triangle,
+                                   const GF2MutableMatrixView& b, bool unit_diagonal = false,
+                                   int num_threads = 0);
+    static void triangularSolve(const GF2MatrixView& t, GF2Triangle triangle,
+                                const GF2MutableMatrixView& b, bool unit_diagonal = false,
+                                int num_threads = 0);
+    static constexpr size_t TRIANGULAR_BASE_ROWS = 256;
+
+    // Inverse of a square matrix; throws std::runtime_error if it is singular
+    GF2Matrix inverse(int num_threads = 0) const;
     
     // Matrix comparison
     bool operator==(const GF2Matrix& other) const;
@@ -41,13 +392,92 @@ private:
     size_t m_rows;
     size_t m_cols;
     size_t m_words_per_row;
-    std::vector<uint64_t> m_data;
+    size_t m_row_stride;
+    std::vector<uint64_t, GF2UninitializedAllocator<uint64_t>> m_data;
+    mutable std::shared_ptr<const GF2Structure> m_structure; // null until structure()
+    mutable std::shared_ptr<const GF2ContentHash> m_hash;    // null until contentHash()
+    
+    // Zero the unused bits past the last column of every row
+    void clearPadding();
     
     // Internal multiplication helpers
     static uint64_t popcnt64(uint64_t x);
     static uint64_t parity64(uint64_t x); // This function is not used in the provided code, but kept for completeness if it was intended.
 };
 
+// A matrix in column-major orientation: the transpose of the row-major
+// GF2Matrix it refers to, made by GF2Matrix::transpose() without moving a
+// bit. Its rows are the columns of that matrix. The products read it as it
+// is stored: A * B^T is the dot-product kernel on the rows of B
+// (GF2Matrix::multiplySIMD above), A^T * B the row-XOR kernels of
+// multiplyAtB, and only A^T * B^T transposes an operand, the smaller one.
+// Converting to a GF2Matrix transposes. It keeps a pointer to the matrix:
+// use it in the statement that built it, or keep the matrix alive and
+// unchanged while it exists.
+class GF2Transposed {
+public:
+    explicit GF2Transposed(const GF2Matrix& m) : m_m(&m) {}
+
+    size_t rows() const { return m_m->cols(); }
+    size_t cols() const { return m_m->rows(); }
+    bool get(size_t row, size_t col) const { return m_m->get(col, row); }
+
+    // The row-major matrix this is the transpose of, also in O(1)
+    const GF2Matrix& transpose() const { return *m_m; }
+
+    // The same bits in a row-major matrix, transposed 64 x 64 blocks at a
+    // time
+    GF2Matrix materialize() const;
+    operator GF2Matrix() const { return materialize(); }
+
+    // this * b, as GF2Matrix::multiplyAtB on the matrix referred to, and
+    // this * b^T, with the smaller of the two matrices transposed. Throw
+    // std::runtime_error if the shapes do not match.
+    GF2Matrix multiply(const GF2Matrix& b, int num_threads = 0) const;
+    GF2Matrix multiply(const GF2Transposed& b, int num_threads = 0) const;
+
+private:
+    const GF2Matrix* m_m;
+};
+
+inline GF2Transposed GF2Matrix::transpose() const { return GF2Transposed(*this); }
+
+// P * A = L * E for an m x n matrix A of rank r. P permutes the rows of A,
+// L (m x r) is unit lower trapezoidal and E (r x n) is in row echelon form,
+// row j having its leading one in column pivots[j]. The pivot columns are
+// the Q of a PLUQ factorization: L times the pivot columns of E is PLU.
+struct GF2PLE {
+    std::vector<size_t> rows;   // row i of P * A is row rows[i] of A
+    std::vector<size_t> pivots; // ascending
+    GF2Matrix L;
+    GF2Matrix E;
+
+    size_t rank() const { return pivots.size(); }
+};
+
+// The structure of a matrix that lets a product skip work (see
+// GF2Matrix::structure()): its rows of zeros, in single rows and in blocks
+// of 64, how many ones it has, and the identity prefix, the largest p whose
+// first p columns are those of an identity over zero rows, as in the
+// [I | P] generator of a systematic code. With identity_prefix p, A * B has
+// B's first p rows over A's rows past p times B, and B's first p columns
+// carry over A's.
+struct GF2Structure {
+    size_t ones = 0;
+    size_t zero_rows = 0;
+    size_t zero_row_blocks = 0;           // of 64 rows, all zero
+    std::vector<uint64_t> nonzero_rows;   // bit r set when row r has a one
+    std::vector<uint64_t> nonzero_blocks; // bit b set when rows [64b, 64b + 64) have one
+    size_t identity_prefix = 0;
+    double density = 0.0;                 // ones / (rows * cols)
+
+    bool zero() const { return ones == 0; }
+    bool rowIsZero(size_t r) const { return !((nonzero_rows[r / 64] >> (r % 64)) & 1); }
+    bool blockIsZero(size_t b) const { return !((nonzero_blocks[b / 64] >> (b % 64)) & 1); }
+
+    static GF2Structure scan(const GF2Matrix& m, int num_threads = 0);
+};
+
 // GPU kernel interface
 #ifdef __METAL_VERSION__
 kernel void gf2_multiply(
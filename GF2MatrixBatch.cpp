@@ -0,0 +1,171 @@
+#include "GF2MatrixBatch.hpp"
+#include "GF2Kernels.hpp"
+#include "GF2CpuInfo.hpp"
+#include <algorithm>
+#include <cstring>
+#include <omp.h>
+#include <random>
+#include <stdexcept>
+
+namespace {
+
+// Butterfly masks of the transpose stages (shift 32, 16, ..., 1)
+constexpr uint64_t TRANSPOSE_MASKS[6] = {
+    0x00000000FFFFFFFFULL, 0x0000FFFF0000FFFFULL, 0x00FF00FF00FF00FFULL,
+    0x0F0F0F0F0F0F0F0FULL, 0x3333333333333333ULL, 0x5555555555555555ULL,
+};
+
+struct BatchKernels {
+    const char* name;
+    BatchMultiplyKernel multiply;
+    BatchTransposeKernel transpose;
+};
+
+// The AVX-512 kernels wherever the dot-product kernel is an AVX-512 one, so
+// GF2_SIMD_KERNEL=scalar selects the portable ones here too
+const BatchKernels& batch_kernels() {
+    static const BatchKernels kernels = [] {
+#if defined(__x86_64__) || defined(_M_X64)
+        const char* simd = simd_kernel().name;
+        if (GF2CpuInfo::get().avx512f &&
+            (std::strcmp(simd, "avx512") == 0 || std::strcmp(simd, "gfni") == 0)) {
+            return BatchKernels{"avx512", batch_multiply_avx512, batch_transpose_avx512};
+        }
+#endif
+        return BatchKernels{"scalar", batch_multiply_scalar, batch_transpose_scalar};
+    }();
+    return kernels;
+}
+
+int resolve_threads(int num_threads) {
+    return num_threads > 0 ? num_threads : omp_get_max_threads();
+}
+
+} // namespace
+
+// Lane by lane through GF2Fixed's nibble tables, which beat masked row XORs
+// two lanes per vector
+void batch_multiply_scalar(const uint64_t* a, const uint64_t* b, uint64_t* c, size_t groups) {
+    for (size_t g = 0; g < groups; ++g) {
+        const uint64_t* ag = a + g * BATCH_GROUP_WORDS;
+        const uint64_t* bg = b + g * BATCH_GROUP_WORDS;
+        uint64_t* cg = c + g * BATCH_GROUP_WORDS;
+        for (size_t l = 0; l < BATCH_LANES; ++l) {
+            GF2Fixed<64, 64> x, y;
+            for (size_t r = 0; r < 64; ++r) {
+                x.row(r)[0] = ag[r * BATCH_LANES + l];
+                y.row(r)[0] = bg[r * BATCH_LANES + l];
+            }
+            const GF2Fixed<64, 64> z = x.multiply(y);
+            for (size_t r = 0; r < 64; ++r) {
+                cg[r * BATCH_LANES + l] = z.row(r)[0];
+            }
+        }
+    }
+}
+
+void batch_transpose_scalar(const uint64_t* src, uint64_t* dst, size_t groups) {
+    if (dst != src) {
+        std::copy_n(src, groups * BATCH_GROUP_WORDS, dst);
+    }
+    for (size_t g = 0; g < groups; ++g) {
+        uint64_t* x = dst + g * BATCH_GROUP_WORDS;
+        size_t stage = 0;
+        for (size_t j = 32; j >= 1; j >>= 1, ++stage) {
+            const uint64_t mask = TRANSPOSE_MASKS[stage];
+            for (size_t k = 0; k < 64; k = (k + j + 1) & ~j) {
+                uint64_t* lo = x + k * BATCH_LANES;
+                uint64_t* hi = x + (k + j) * BATCH_LANES;
+                #pragma omp simd
+                for (size_t l = 0; l < BATCH_LANES; ++l) {
+                    const uint64_t t = ((lo[l] >> j) ^ hi[l]) & mask;
+                    lo[l] ^= t << j;
+                    hi[l] ^= t;
+                }
+            }
+        }
+    }
+}
+
+GF2MatrixBatch::GF2MatrixBatch(size_t count)
+    : m_count(count), m_data(groups() * BATCH_GROUP_WORDS, 0) {}
+
+GF2Fixed<64, 64> GF2MatrixBatch::get(size_t i) const {
+    GF2Fixed<64, 64> m;
+    for (size_t r = 0; r < 64; ++r) {
+        m.row(r)[0] = row(i, r);
+    }
+    return m;
+}
+
+void GF2MatrixBatch::set(size_t i, const GF2Fixed<64, 64>& m) {
+    for (size_t r = 0; r < 64; ++r) {
+        setRow(i, r, m.row(r)[0]);
+    }
+}
+
+void GF2MatrixBatch::randomFill(uint64_t seed) {
+    std::mt19937_64 gen(seed);
+    for (size_t i = 0; i < m_count; ++i) {
+        for (size_t r = 0; r < 64; ++r) {
+            setRow(i, r, gen());
+        }
+    }
+}
+
+void GF2MatrixBatch::multiply(const GF2MatrixBatch& a, const GF2MatrixBatch& b, GF2MatrixBatch& c,
+                              int num_threads) {
+    if (a.m_count != b.m_count || c.m_count != a.m_count) {
+        throw std::runtime_error("Batch sizes differ");
+    }
+    if (&c == &a || &c == &b) {
+        throw std::runtime_error("Output batch must not alias an operand");
+    }
+    const BatchMultiplyKernel kernel = batch_kernels().multiply;
+    const long long groups = static_cast<long long>(a.groups());
+    const uint64_t* a_data = a.m_data.data();
+    const uint64_t* b_data = b.m_data.data();
+    uint64_t* c_data = c.m_data.data();
+
+    #pragma omp parallel for schedule(static) num_threads(resolve_threads(num_threads))
+    for (long long g = 0; g < groups; ++g) {
+        const size_t offset = static_cast<size_t>(g) * BATCH_GROUP_WORDS;
+        kernel(a_data + offset, b_data + offset, c_data + offset, 1);
+    }
+}
+
+GF2MatrixBatch GF2MatrixBatch::multiply(const GF2MatrixBatch& other, int num_threads) const {
+    GF2MatrixBatch c(m_count);
+    multiply(*this, other, c, num_threads);
+    return c;
+}
+
+void GF2MatrixBatch::transpose(const GF2MatrixBatch& src, GF2MatrixBatch& dst, int num_threads) {
+    if (dst.m_count != src.m_count) {
+        throw std::runtime_error("Batch sizes differ");
+    }
+    const BatchTransposeKernel kernel = batch_kernels().transpose;
+    const long long groups = static_cast<long long>(src.groups());
+    const uint64_t* src_data = src.m_data.data();
+    uint64_t* dst_data = dst.m_data.data();
+
+    #pragma omp parallel for schedule(static) num_threads(resolve_threads(num_threads))
+    for (long long g = 0; g < groups; ++g) {
+        const size_t offset = static_cast<size_t>(g) * BATCH_GROUP_WORDS;
+        kernel(src_data + offset, dst_data + offset, 1);
+    }
+}
+
+GF2MatrixBatch GF2MatrixBatch::transpose(int num_threads) const {
+    GF2MatrixBatch t(m_count);
+    transpose(*this, t, num_threads);
+    return t;
+}
+
+const char* GF2MatrixBatch::kernelName() {
+    return batch_kernels().name;
+}
+
+bool GF2MatrixBatch::operator==(const GF2MatrixBatch& other) const {
+    return m_count == other.m_count && m_data == other.m_data;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "GF2AlignedAllocator.hpp"
+#include "GF2Fixed.hpp"
+#include "GF2Kernels.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Many independent 64 x 64 matrices in structure-of-arrays form: groups of
+// eight matrices interleaved word by word (see BATCH_LANES in
+// GF2Kernels.hpp), so one AVX-512 vector holds the same row of eight
+// matrices and a NEON vector that of two. The batched kernels then work on
+// whole vectors of matrices, and their throughput grows with the vector
+// width instead of being bound by per-matrix overhead. The matrices past
+// size() in the last group are zero.
+class GF2MatrixBatch {
+public:
+    static constexpr size_t LANES = BATCH_LANES;
+
+    // count all-zero matrices
+    explicit GF2MatrixBatch(size_t count);
+
+    size_t size() const { return m_count; }
+    // Groups of LANES matrices; matrix i is lane i % LANES of group i / LANES
+    size_t groups() const { return (m_count + LANES - 1) / LANES; }
+    const uint64_t* get_raw_data() const { return m_data.data(); }
+    uint64_t* get_raw_data() { return m_data.data(); }
+
+    // Row r of matrix i
+    uint64_t row(size_t i, size_t r) const { return m_data[index(i, r)]; }
+    void setRow(size_t i, size_t r, uint64_t word) { m_data[index(i, r)] = word; }
+
+    GF2Fixed<64, 64> get(size_t i) const;
+    void set(size_t i, const GF2Fixed<64, 64>& m);
+
+    // The same bits for the same seed
+    void randomFill(uint64_t seed);
+
+    // c[i] = a[i] * b[i] for every i, the groups spread over OpenMP threads
+    // (num_threads <= 0 for the OpenMP default). Throws std::runtime_error
+    // if the sizes differ or c is a or b.
+    static void multiply(const GF2MatrixBatch& a, const GF2MatrixBatch& b, GF2MatrixBatch& c,
+                         int num_threads = 0);
+    GF2MatrixBatch multiply(const GF2MatrixBatch& other, int num_threads = 0) const;
+
+    // Every matrix transposed; dst may be src
+    static void transpose(const GF2MatrixBatch& src, GF2MatrixBatch& dst, int num_threads = 0);
+    GF2MatrixBatch transpose(int num_threads = 0) const;
+
+    // Name of the batched kernels picked for this CPU (avx512, scalar)
+    static const char* kernelName();
+
+    bool operator==(const GF2MatrixBatch& other) const;
+
+private:
+    size_t m_count;
+    std::vector<uint64_t, GF2AlignedAllocator<uint64_t>> m_data;
+
+    static size_t index(size_t i, size_t r) {
+        return (i / LANES) * BATCH_GROUP_WORDS + r * LANES + i % LANES;
+    }
+};
@@ -0,0 +1,331 @@
+#include "GF2Matrix.hpp"
+#include "GF2MatrixView.hpp"
+#include "GF2Kernels.hpp"
+#include <algorithm>
+#include <numeric>
+#include <omp.h>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// PLE decomposition in the manner of M4RI (Albrecht, Bard, Pernet). Matrices
+// of up to PLE_BASE_COLS columns are eliminated directly, eight pivots at a
+// time, with a Four Russians table of their combinations. Wider ones are
+// split in two column halves; the left half is factored first, and the
+// right half is brought up to date with a triangular solve and one multiply
+// before it is factored in turn, so most of the work runs in the SIMD
+// multiply kernels.
+
+namespace {
+
+// Widest column block eliminated directly (a cache line per row)
+constexpr size_t PLE_BASE_COLS = 8 * 64;
+
+// Row updates with less work than this (rows x words) stay on one thread
+constexpr size_t PARALLEL_MIN_WORDS = size_t(1) << 16;
+
+inline bool bit(const uint64_t* row, size_t col) {
+    return (row[col / 64] >> (col % 64)) & 1;
+}
+
+inline void flip(uint64_t* row, size_t col) {
+    row[col / 64] ^= uint64_t(1) << (col % 64);
+}
+
+// The 'count' (<= 64) bits of row from column col on, in the low bits
+inline uint64_t load_bits(const uint64_t* row, size_t col, size_t count) {
+    const size_t w = col / 64, s = col % 64;
+    uint64_t value = row[w] >> s;
+    if (s != 0 && s + count > 64) {
+        value |= row[w + 1] << (64 - s);
+    }
+    return count == 64 ? value : value & ((uint64_t(1) << count) - 1);
+}
+
+// ORs 'count' (<= 64) bits into row from column col on
+inline void or_bits(uint64_t* row, size_t col, uint64_t value, size_t count) {
+    const size_t w = col / 64, s = col % 64;
+    row[w] |= value << s;
+    if (s != 0 && s + count > 64) {
+        row[w + 1] |= value >> (64 - s);
+    }
+}
+
+// dst[dst_col, dst_col + count) |= src[src_col, src_col + count); the
+// destination bits are expected to be zero
+void copy_bits(const uint64_t* src, size_t src_col, uint64_t* dst, size_t dst_col, size_t count) {
+    for (size_t x = 0; x < count; x += 64) {
+        const size_t n = std::min<size_t>(64, count - x);
+        or_bits(dst, dst_col + x, load_bits(src, src_col + x, n), n);
+    }
+}
+
+inline const uint64_t* row_of(const GF2Matrix& m, size_t i) {
+    return m.get_raw_data() + i * m.row_stride();
+}
+
+inline uint64_t* row_of(GF2Matrix& m, size_t i) {
+    return m.get_raw_data() + i * m.row_stride();
+}
+
+inline const uint64_t* row_of(const GF2MatrixView& m, size_t i) {
+    return m.get_raw_data() + i * m.row_stride();
+}
+
+// Overwrites the rows [r0, r0 + src.rows()) of dst, which has src's width
+void store_rows(GF2Matrix& dst, size_t r0, const GF2Matrix& src) {
+    for (size_t i = 0; i < src.rows(); ++i) {
+        std::copy_n(row_of(src, i), src.words_per_row(), row_of(dst, r0 + i));
+    }
+}
+
+// Gaussian elimination of a narrow matrix, M4R_BITS pivots per pass. Each
+// pivot is searched for among the rows below the pivots found so far, which
+// are first reduced by the pass's earlier pivots. Once a pass has its
+// pivots, every remaining row is cleared at their columns with one lookup in
+// the table of pivot-row combinations.
+GF2PLE ple_base(const GF2MatrixView& a, int threads) {
+    const size_t m = a.rows(), n = a.cols();
+    GF2Matrix w = a.copy(); // the pivot rows end up on top: E
+    GF2Matrix l(m, std::min(m, n));
+    std::vector<size_t> perm(m);
+    std::iota(perm.begin(), perm.end(), size_t(0));
+    std::vector<size_t> pivots;
+
+    const size_t words = w.words_per_row();
+    std::vector<uint64_t> table(M4R_TABLE_ROWS * words);
+    std::vector<uint8_t> coefficients(M4R_TABLE_ROWS);
+
+    size_t r = 0, col = 0;
+    while (r < m && col < n) {
+        size_t strip[M4R_BITS];
+        size_t found = 0;
+        while (found < M4R_BITS && r + found < m && col < n) {
+            size_t pivot = m;
+            for (size_t i = r + found; i < m && pivot == m; ++i) {
+                uint64_t* row = row_of(w, i);
+                for (size_t p = 0; p < found; ++p) {
+                    if (bit(row, strip[p])) {
+                        const size_t w0 = strip[p] / 64;
+                        row_xor(row + w0, row_of(w, r + p) + w0, words - w0);
+                        flip(row_of(l, i), r + p);
+                    }
+                }
+                if (bit(row, col)) {
+                    pivot = i;
+                }
+            }
+            if (pivot == m) {
+                ++col;
+                continue;
+            }
+            const size_t target = r + found;
+            if (pivot != target) {
+                std::swap_ranges(row_of(w, pivot), row_of(w, pivot) + words, row_of(w, target));
+                std::swap_ranges(row_of(l, pivot), row_of(l, pivot) + l.words_per_row(),
+                                 row_of(l, target));
+                std::swap(perm[pivot], perm[target]);
+            }
+            flip(row_of(l, target), target);
+            pivots.push_back(col);
+            strip[found++] = col++;
+        }
+        if (found == 0) {
+            break;
+        }
+
+        // Rows at and below r are zero left of the pass's first pivot column,
+        // so the table starts at its word
+        const size_t w0 = strip[0] / 64;
+        const size_t width = words - w0;
+        m4r_build_table(row_of(w, r) + w0, w.row_stride(), found, width, table.data());
+        // The pivot rows are triangular at their columns, so combination c
+        // leaves a distinct pattern there: coefficients[pattern] = c
+        for (size_t c = 0; c < (size_t(1) << found); ++c) {
+            const uint64_t* entry = table.data() + c * width;
+            size_t pattern = 0;
+            for (size_t p = 0; p < found; ++p) {
+                pattern |= size_t(bit(entry, strip[p] - w0 * 64)) << p;
+            }
+            coefficients[pattern] = uint8_t(c);
+        }
+
+        const size_t first = r + found;
+        const long long end = static_cast<long long>(m);
+        #pragma omp parallel for schedule(static) num_threads(threads) \
+            if ((m - first) * width >= PARALLEL_MIN_WORDS)
+        for (long long ii = static_cast<long long>(first); ii < end; ++ii) {
+            const size_t i = static_cast<size_t>(ii);
+            uint64_t* row = row_of(w, i);
+            size_t pattern = 0;
+            for (size_t p = 0; p < found; ++p) {
+                pattern |= size_t(bit(row, strip[p])) << p;
+            }
+            if (pattern == 0) {
+                continue;
+            }
+            const size_t c = coefficients[pattern];
+            row_xor(row + w0, table.data() + c * width, width);
+            uint64_t* l_row = row_of(l, i);
+            for (size_t p = 0; p < found; ++p) {
+                if ((c >> p) & 1) {
+                    flip(l_row, r + p);
+                }
+            }
+        }
+        r = first;
+    }
+
+    return GF2PLE{std::move(perm), std::move(pivots), l.view(0, m, 0, r).copy(),
+                  w.view(0, r, 0, n).copy()};
+}
+
+// Splits at a word boundary near the middle. With A = [A0 | A1] and
+// P0 * A0 = L0 * E0, the permuted A1 is split into the rows T beside the
+// pivots and the rows B below them: T' = L00^-1 * T and B' = B + L10 * T'
+// (one multiply), and B' is factored on its own. Then
+// P * A = [L00 0; P1 * L10 L1] * [E0 T'; 0 E1].
+GF2PLE ple_recursive(const GF2MatrixView& a, int threads) {
+    const size_t m = a.rows(), n = a.cols();
+    if (n <= PLE_BASE_COLS || m <= 64) {
+        return ple_base(a, threads);
+    }
+    const size_t n0 = (n / 2 + 63) / 64 * 64, n1 = n - n0;
+    const GF2PLE left = ple_recursive(a.view(0, m, 0, n0), threads);
+    const size_t r0 = left.rank();
+
+    GF2Matrix top(r0, n1), bottom(m - r0, n1);
+    for (size_t i = 0; i < m; ++i) {
+        uint64_t* dst = i < r0 ? row_of(top, i) : row_of(bottom, i - r0);
+        copy_bits(row_of(a, left.rows[i]), n0, dst, 0, n1);
+    }
+    if (r0 > 0) {
+        GF2Matrix::triangularSolve(left.L.view(0, r0, 0, r0), GF2Triangle::Lower, top, true,
+                                   threads);
+        if (m > r0) {
+            GF2Workspace ws;
+            GF2Matrix::addMul(bottom, left.L.view(r0, m, 0, r0), top, ws, threads);
+        }
+    }
+    const GF2PLE right = ple_recursive(bottom, threads);
+    const size_t r1 = right.rank();
+
+    std::vector<size_t> rows(m);
+    std::vector<size_t> pivots = left.pivots;
+    GF2Matrix l(m, r0 + r1), e(r0 + r1, n);
+    for (size_t i = 0; i < r0; ++i) {
+        rows[i] = left.rows[i];
+        copy_bits(row_of(left.L, i), 0, row_of(l, i), 0, r0);
+        copy_bits(row_of(left.E, i), 0, row_of(e, i), 0, n0);
+        copy_bits(row_of(top, i), 0, row_of(e, i), n0, n1);
+    }
+    for (size_t i = 0; i < m - r0; ++i) {
+        rows[r0 + i] = left.rows[r0 + right.rows[i]];
+        copy_bits(row_of(left.L, r0 + right.rows[i]), 0, row_of(l, r0 + i), 0, r0);
+        copy_bits(row_of(right.L, i), 0, row_of(l, r0 + i), r0, r1);
+    }
+    for (size_t j = 0; j < r1; ++j) {
+        pivots.push_back(n0 + right.pivots[j]);
+        copy_bits(row_of(right.E, j), 0, row_of(e, r0 + j), n0, n1);
+    }
+    return GF2PLE{std::move(rows), std::move(pivots), std::move(l), std::move(e)};
+}
+
+// U = the pivot columns of E (unit upper triangular), gathered as rows of E^T
+GF2Matrix pivot_block(const GF2PLE& f) {
+    const size_t r = f.rank();
+    const GF2Matrix e_t = f.E.transpose();
+    GF2Matrix u_t(r, r);
+    for (size_t j = 0; j < r; ++j) {
+        std::copy_n(row_of(e_t, f.pivots[j]), e_t.words_per_row(), row_of(u_t, j));
+    }
+    return u_t.transpose();
+}
+
+int resolve_threads(int num_threads) {
+    return num_threads > 0 ? num_threads : omp_get_max_threads();
+}
+
+} // namespace
+
+GF2PLE GF2Matrix::ple(int num_threads) const {
+    return ple_recursive(*this, resolve_threads(num_threads));
+}
+
+size_t GF2Matrix::rank(int num_threads) const {
+    return ple(num_threads).rank();
+}
+
+GF2Matrix GF2Matrix::echelonForm(bool reduced, int num_threads) const {
+    const int threads = resolve_threads(num_threads);
+    GF2PLE f = ple_recursive(*this, threads);
+    const size_t r = f.rank();
+    if (reduced && r > 0) {
+        // U^-1 * E has unit vectors in the pivot columns
+        triangularSolve(pivot_block(f), GF2Triangle::Upper, f.E, true, threads);
+    }
+    GF2Matrix out(m_rows, m_cols);
+    store_rows(out, 0, f.E);
+    return out;
+}
+
+// With P * A = L * E and L = [L1; L2] split after the rank r: Y = L1^-1 *
+// (P * B)_top, the rows below must satisfy (P * B)_bottom = L2 * Y, and
+// X at the pivot rows is U^-1 * Y for the pivot columns U of E
+GF2Matrix GF2Matrix::solve(const GF2PLE& f, const GF2Matrix& b, int num_threads) {
+    const size_t m = f.L.rows(), n = f.E.cols(), r = f.rank();
+    if (b.rows() != m) {
+        throw std::runtime_error("Right-hand side rows do not match the system");
+    }
+    const int threads = resolve_threads(num_threads);
+
+    GF2Matrix y(r, b.cols()), rest(m - r, b.cols());
+    for (size_t i = 0; i < m; ++i) {
+        uint64_t* dst = i < r ? row_of(y, i) : row_of(rest, i - r);
+        std::copy_n(row_of(b, f.rows[i]), b.words_per_row(), dst);
+    }
+    if (r > 0) {
+        triangularSolve(f.L.view(0, r, 0, r), GF2Triangle::Lower, y, true, threads);
+        if (m > r) {
+            GF2Workspace ws;
+            GF2Matrix::addMul(rest, f.L.view(r, m, 0, r), y, ws, threads);
+        }
+    }
+    for (size_t i = 0; i < rest.rows(); ++i) {
+        const uint64_t* row = row_of(rest, i);
+        if (std::any_of(row, row + rest.words_per_row(), [](uint64_t w) { return w != 0; })) {
+            throw std::runtime_error("Linear system has no solution");
+        }
+    }
+    if (r > 0) {
+        triangularSolve(pivot_block(f), GF2Triangle::Upper, y, true, threads);
+    }
+
+    GF2Matrix x(n, b.cols());
+    for (size_t j = 0; j < r; ++j) {
+        std::copy_n(row_of(y, j), y.words_per_row(), row_of(x, f.pivots[j]));
+    }
+    return x;
+}
+
+GF2Matrix GF2Matrix::solve(const GF2Matrix& a, const GF2Matrix& b, int num_threads) {
+    if (a.rows() != b.rows()) {
+        throw std::runtime_error("Right-hand side rows do not match the system");
+    }
+    return solve(a.ple(num_threads), b, num_threads);
+}
+
+GF2Matrix GF2Matrix::inverse(int num_threads) const {
+    if (m_rows != m_cols) {
+        throw std::runtime_error("Only square matrices have an inverse");
+    }
+    const GF2PLE f = ple(num_threads);
+    if (f.rank() < m_rows) {
+        throw std::runtime_error("Matrix is singular");
+    }
+    GF2Matrix identity(m_rows, m_cols);
+    for (size_t i = 0; i < m_rows; ++i) {
+        identity.set(i, i, true);
+    }
+    return solve(f, identity, num_threads);
+}
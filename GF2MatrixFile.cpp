@@ -0,0 +1,223 @@
+#include "GF2MatrixFile.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "The .gf2 format is little endian; big-endian hosts would need byte swaps"
+#endif
+
+namespace {
+
+constexpr char MAGIC[8] = {'G', 'F', '2', 'M', 'A', 'T', 'R', 'X'};
+constexpr uint64_t CHECKSUM_PRIME = 0x9E3779B97F4A7C15ULL;
+
+uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+// Whether the shape and offsets of a version 1 header fit in a file of
+// file_bytes bytes (and in size_t)
+bool consistent(const GF2FileHeader& h, size_t file_bytes) {
+    if (h.row_stride < (h.cols + 63) / 64 || h.data_offset < sizeof(GF2FileHeader) ||
+        h.alignment == 0 || h.data_offset % h.alignment != 0 || h.data_offset > file_bytes) {
+        return false;
+    }
+    const uint64_t max_words = (file_bytes - h.data_offset) / sizeof(uint64_t);
+    return h.rows == 0 || h.row_stride <= max_words / h.rows;
+}
+
+std::runtime_error file_error(const std::string& what, const std::string& path) {
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+// The header of the open file fd, checked against the file's size; closes
+// fd and throws if it is not a readable version 1 .gf2 file
+GF2FileHeader read_header(int fd, const std::string& path) {
+    struct stat st;
+    GF2FileHeader header{};
+    const bool read_ok = ::fstat(fd, &st) == 0 &&
+                         ::pread(fd, &header, sizeof(header), 0) == ssize_t(sizeof(header));
+    if (!read_ok) {
+        ::close(fd);
+        throw std::runtime_error("Not a .gf2 file: " + path);
+    }
+
+    std::string problem;
+    const size_t file_bytes = static_cast<size_t>(st.st_size);
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        problem = "Not a .gf2 file: ";
+    } else if (header.version != GF2_FILE_VERSION || header.header_bytes != sizeof(header)) {
+        problem = "Unsupported .gf2 version in ";
+    } else if (!consistent(header, file_bytes)) {
+        problem = "Truncated or inconsistent .gf2 file: ";
+    }
+    if (!problem.empty()) {
+        ::close(fd);
+        throw std::runtime_error(problem + path);
+    }
+    return header;
+}
+
+} // namespace
+
+GF2FileHeader gf2_make_header(size_t rows, size_t cols, size_t row_stride, uint64_t checksum) {
+    GF2FileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = GF2_FILE_VERSION;
+    header.header_bytes = sizeof(GF2FileHeader);
+    header.rows = rows;
+    header.cols = cols;
+    header.row_stride = row_stride;
+    header.alignment = GF2_FILE_ALIGNMENT;
+    header.data_offset = GF2_FILE_ALIGNMENT;
+    header.checksum = checksum;
+    return header;
+}
+
+int gf2_open(const std::string& path, GF2FileHeader& header) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw file_error("Could not open", path);
+    }
+    header = read_header(fd, path);
+    return fd;
+}
+
+void GF2Checksum::update(const uint64_t* words, size_t n) {
+    size_t i = 0;
+    // Up to the next multiple of four words, then whole groups
+    for (; i < n && (m_count + i) % 4 != 0; ++i) {
+        uint64_t& h = m_lanes[(m_count + i) % 4];
+        h = rotl(h ^ words[i], 29) * CHECKSUM_PRIME;
+    }
+    for (; i + 4 <= n; i += 4) {
+        for (int l = 0; l < 4; ++l) {
+            m_lanes[l] = rotl(m_lanes[l] ^ words[i + l], 29) * CHECKSUM_PRIME;
+        }
+    }
+    for (; i < n; ++i) {
+        uint64_t& h = m_lanes[(m_count + i) % 4];
+        h = rotl(h ^ words[i], 29) * CHECKSUM_PRIME;
+    }
+    m_count += n;
+}
+
+uint64_t GF2Checksum::value() const {
+    uint64_t sum = m_count;
+    for (int l = 0; l < 4; ++l) {
+        sum = rotl(sum ^ m_lanes[l], 31) * CHECKSUM_PRIME;
+    }
+    return sum ^ (sum >> 32);
+}
+
+uint64_t gf2_checksum(const uint64_t* words, size_t n) {
+    GF2Checksum checksum;
+    checksum.update(words, n);
+    return checksum.value();
+}
+
+void gf2_save(const GF2Matrix& m, const std::string& path) {
+    const size_t words = m.rows() * m.row_stride();
+    const GF2FileHeader header = gf2_make_header(m.rows(), m.cols(), m.row_stride(),
+                                                 gf2_checksum(m.get_raw_data(), words));
+
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        throw file_error("Could not create", path);
+    }
+    // The header, zeros up to data_offset, then the rows in one write
+    static const char zeros[GF2_FILE_ALIGNMENT] = {};
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+              std::fwrite(zeros, header.data_offset - sizeof(header), 1, file) == 1;
+    if (ok && words > 0) {
+        ok = std::fwrite(m.get_raw_data(), sizeof(uint64_t), words, file) == words;
+    }
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) {
+        throw file_error("Could not write", path);
+    }
+}
+
+GF2MappedMatrix::GF2MappedMatrix(const std::string& path, bool verify) {
+    GF2FileHeader header;
+    const int fd = gf2_open(path, header);
+    m_rows = header.rows;
+    m_cols = header.cols;
+    m_row_stride = header.row_stride;
+    m_checksum = header.checksum;
+    m_map_bytes = header.data_offset + m_rows * m_row_stride * sizeof(uint64_t);
+    // The mapping outlives the descriptor
+    void* map = ::mmap(nullptr, m_map_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        throw file_error("Could not map", path);
+    }
+    m_map = map;
+    m_data = reinterpret_cast<const uint64_t*>(static_cast<const char*>(map) + header.data_offset);
+
+    if (verify && !this->verify()) {
+        ::munmap(m_map, m_map_bytes);
+        m_map = nullptr;
+        throw std::runtime_error("Checksum mismatch in " + path);
+    }
+}
+
+GF2MappedMatrix::~GF2MappedMatrix() {
+    if (m_map) {
+        ::munmap(m_map, m_map_bytes);
+    }
+}
+
+GF2MappedMatrix::GF2MappedMatrix(GF2MappedMatrix&& other) noexcept
+    : m_map(std::exchange(other.m_map, nullptr)), m_map_bytes(other.m_map_bytes),
+      m_data(other.m_data), m_rows(other.m_rows), m_cols(other.m_cols),
+      m_row_stride(other.m_row_stride), m_checksum(other.m_checksum) {}
+
+GF2MappedMatrix& GF2MappedMatrix::operator=(GF2MappedMatrix&& other) noexcept {
+    if (this != &other) {
+        if (m_map) {
+            ::munmap(m_map, m_map_bytes);
+        }
+        m_map = std::exchange(other.m_map, nullptr);
+        m_map_bytes = other.m_map_bytes;
+        m_data = other.m_data;
+        m_rows = other.m_rows;
+        m_cols = other.m_cols;
+        m_row_stride = other.m_row_stride;
+        m_checksum = other.m_checksum;
+    }
+    return *this;
+}
+
+GF2MatrixView GF2MappedMatrix::view() const {
+    return GF2MatrixView(m_data, m_rows, m_cols, 0, m_row_stride, m_row_stride);
+}
+
+// The bits past the last column are masked, should a writer other than
+// gf2_save have left them set
+GF2Matrix GF2MappedMatrix::copy() const {
+    GF2Matrix m(m_rows, m_cols);
+    const size_t words = m.words_per_row();
+    const uint64_t tail_mask = (m_cols % 64) ? ((1ULL << (m_cols % 64)) - 1) : ~0ULL;
+    for (size_t i = 0; i < m_rows && words > 0; ++i) {
+        uint64_t* dst = m.get_raw_data() + i * m.row_stride();
+        std::memcpy(dst, m_data + i * m_row_stride, words * sizeof(uint64_t));
+        dst[words - 1] &= tail_mask;
+    }
+    return m;
+}
+
+bool GF2MappedMatrix::verify() const {
+    return gf2_checksum(m_data, m_rows * m_row_stride) == m_checksum;
+}
+
+GF2Matrix gf2_load(const std::string& path) {
+    return GF2MappedMatrix(path, true).copy();
+}
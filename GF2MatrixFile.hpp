@@ -0,0 +1,102 @@
+#pragma once
+
+#include "GF2Matrix.hpp"
+#include "GF2MatrixView.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// The .gf2 file format, version 1: a 64-byte header, then from data_offset
+// the rows x row_stride words of the matrix exactly as GF2Matrix holds them
+// (row r at word r * row_stride, bit j of a word is column 64w + j, padding
+// zero). All fields are little endian. data_offset is a multiple of
+// alignment, a multiple of the page size, so a mapped file's rows are as
+// aligned as a GF2Matrix's and the file can be used in place.
+struct GF2FileHeader {
+    char magic[8];         // "GF2MATRX"
+    uint32_t version;      // GF2_FILE_VERSION
+    uint32_t header_bytes; // sizeof(GF2FileHeader)
+    uint64_t rows;
+    uint64_t cols;
+    uint64_t row_stride;   // words per row, at least (cols + 63) / 64
+    uint64_t alignment;    // bytes; data_offset is a multiple of it
+    uint64_t data_offset;  // bytes from the start of the file
+    uint64_t checksum;     // gf2_checksum of the rows * row_stride words
+};
+static_assert(sizeof(GF2FileHeader) == 64, "The .gf2 header is 64 bytes");
+
+constexpr uint32_t GF2_FILE_VERSION = 1;
+constexpr size_t GF2_FILE_ALIGNMENT = 4096;
+
+// 64-bit checksum of a run of words: word i goes into lane i % 4 of four
+// interleaved multiply-rotate lanes, so it runs at memory speed, and the
+// lanes are mixed with the count at the end. update() may be called on
+// consecutive pieces of the run.
+class GF2Checksum {
+public:
+    void update(const uint64_t* words, size_t n);
+    uint64_t value() const;
+
+private:
+    uint64_t m_lanes[4] = {0x9E3779B97F4A7C15ULL, ~0x9E3779B97F4A7C15ULL,
+                           0x7F4A7C159E3779B9ULL, 0};
+    uint64_t m_count = 0;
+};
+
+uint64_t gf2_checksum(const uint64_t* words, size_t n);
+
+// The version 1 header of a rows x cols matrix whose rows are row_stride
+// words apart, at data offset GF2_FILE_ALIGNMENT
+GF2FileHeader gf2_make_header(size_t rows, size_t cols, size_t row_stride, uint64_t checksum);
+
+// Opens a .gf2 file for reading and fills header; returns the descriptor,
+// which the caller closes. Throws std::runtime_error as GF2MappedMatrix
+// does.
+int gf2_open(const std::string& path, GF2FileHeader& header);
+
+// Writes m to path in the .gf2 format; throws std::runtime_error if the file
+// cannot be written
+void gf2_save(const GF2Matrix& m, const std::string& path);
+
+// A .gf2 file mapped read-only into memory. Opening it reads only the
+// header; the rows are paged in as they are touched, so a large matrix is
+// usable at once and view() hands it to the kernels without a copy. The
+// mapping lives as long as the object, which is move-only. Throws
+// std::runtime_error if the file cannot be opened, is not a .gf2 file of a
+// supported version, or is shorter than its header says. With verify (or
+// a later verify() call) the data is checked against the header checksum,
+// which reads the whole file.
+class GF2MappedMatrix {
+public:
+    explicit GF2MappedMatrix(const std::string& path, bool verify = false);
+    ~GF2MappedMatrix();
+    GF2MappedMatrix(GF2MappedMatrix&& other) noexcept;
+    GF2MappedMatrix& operator=(GF2MappedMatrix&& other) noexcept;
+    GF2MappedMatrix(const GF2MappedMatrix&) = delete;
+    GF2MappedMatrix& operator=(const GF2MappedMatrix&) = delete;
+
+    size_t rows() const { return m_rows; }
+    size_t cols() const { return m_cols; }
+    size_t row_stride() const { return m_row_stride; }
+    const uint64_t* get_raw_data() const { return m_data; }
+
+    // The whole matrix, in place
+    GF2MatrixView view() const;
+    // A GF2Matrix holding a copy of the rows
+    GF2Matrix copy() const;
+
+    // Whether the rows match the header checksum
+    bool verify() const;
+
+private:
+    void* m_map = nullptr;
+    size_t m_map_bytes = 0;
+    const uint64_t* m_data = nullptr;
+    size_t m_rows = 0;
+    size_t m_cols = 0;
+    size_t m_row_stride = 0;
+    uint64_t m_checksum = 0;
+};
+
+// The matrix of a .gf2 file, read into memory and verified (a mapped copy)
+GF2Matrix gf2_load(const std::string& path);
@@ -0,0 +1,241 @@
+#include "GF2Matrix.hpp"
+#include "GF2MatrixView.hpp"
+#include "GF2Kernels.hpp"
+#include "GF2CpuInfo.hpp"
+#include "GF2Trace.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+// The tables of one panel are kept within half of the per-core L2 so that
+// the lookups in the multiply pass never leave the L2 cache.
+size_t m4r_panel_words(size_t n_words) {
+    const size_t bytes_per_word = M4R_TABLES * M4R_TABLE_ROWS * sizeof(uint64_t);
+    size_t panel = std::max<size_t>(1, GF2CpuInfo::get().l2_bytes / 2 / bytes_per_word);
+    return std::min(panel, std::max<size_t>(1, n_words));
+}
+
+// Entries are filled in Gray-code order so that each one costs a single row
+// XOR.
+void m4r_build_table(const uint64_t* b_rows, size_t b_stride,
+                     size_t bits, size_t width, uint64_t* table) {
+    std::memset(table, 0, width * sizeof(uint64_t));
+
+    size_t prev_gray = 0;
+    for (size_t g = 1; g < (size_t(1) << bits); ++g) {
+        size_t gray = g ^ (g >> 1);
+        size_t changed_bit = __builtin_ctzll(g);
+
+        const uint64_t* src = table + prev_gray * width;
+        const uint64_t* b_row = b_rows + changed_bit * b_stride;
+        uint64_t* dst = table + gray * width;
+        for (size_t j = 0; j < width; ++j) {
+            dst[j] = src[j] ^ b_row[j];
+        }
+        prev_gray = gray;
+    }
+}
+
+// Without a Gray code, since an OR cannot be undone: entry g extends the
+// entry of g without its lowest bit by the row of that bit
+void m4r_build_table_or(const uint64_t* b_rows, size_t b_stride,
+                        size_t bits, size_t width, uint64_t* table) {
+    std::memset(table, 0, width * sizeof(uint64_t));
+
+    for (size_t g = 1; g < (size_t(1) << bits); ++g) {
+        const uint64_t* src = table + (g & (g - 1)) * width;
+        const uint64_t* b_row = b_rows + size_t(__builtin_ctzll(g)) * b_stride;
+        uint64_t* dst = table + g * width;
+        for (size_t j = 0; j < width; ++j) {
+            dst[j] = src[j] | b_row[j];
+        }
+    }
+}
+
+namespace {
+
+template <GF2Semiring S>
+void m4r_multiply(const uint64_t* a, size_t a_stride,
+                  const uint64_t* b, size_t b_stride,
+                  uint64_t* c, size_t c_stride,
+                  size_t m, size_t k, size_t n_words,
+                  bool accumulate) {
+    if (!accumulate) {
+        for (size_t i = 0; i < m; ++i) {
+            std::memset(c + i * c_stride, 0, n_words * sizeof(uint64_t));
+        }
+    }
+    if (m == 0 || k == 0 || n_words == 0) return;
+
+    const size_t panel = m4r_panel_words(n_words);
+    const size_t k_words = (k + 63) / 64;
+    std::vector<uint64_t> tables(M4R_TABLES * M4R_TABLE_ROWS * panel);
+
+    for (size_t p0 = 0; p0 < n_words; p0 += panel) {
+        const size_t width = std::min(panel, n_words - p0);
+        const size_t table_size = M4R_TABLE_ROWS * width;
+        GF2_TRACE_SCOPE("m4r: panel");
+
+        for (size_t kw = 0; kw < k_words; ++kw) {
+            // Bits of A (rows of B) covered by this word
+            const size_t word_bits = std::min<size_t>(64, k - kw * 64);
+            const size_t num_tables = (word_bits + M4R_BITS - 1) / M4R_BITS;
+            const uint64_t mask = word_bits == 64 ? ~0ULL : ((1ULL << word_bits) - 1);
+
+            for (size_t t = 0; t < num_tables; ++t) {
+                size_t row0 = kw * 64 + t * M4R_BITS;
+                size_t bits = std::min(M4R_BITS, k - row0);
+                if constexpr (S == GF2Semiring::XorAnd) {
+                    m4r_build_table(b + row0 * b_stride + p0, b_stride, bits, width,
+                                    tables.data() + t * table_size);
+                } else {
+                    m4r_build_table_or(b + row0 * b_stride + p0, b_stride, bits, width,
+                                       tables.data() + t * table_size);
+                }
+            }
+
+            for (size_t i = 0; i < m; ++i) {
+                uint64_t a_word = a[i * a_stride + kw] & mask;
+                if (a_word == 0) continue;
+
+                uint64_t* c_row = c + i * c_stride + p0;
+
+                if (num_tables == M4R_TABLES) {
+                    // Full word: add one entry from each of the eight tables
+                    const uint64_t* t0 = tables.data() + 0 * table_size + ((a_word >> 0) & 0xFF) * width;
+                    const uint64_t* t1 = tables.data() + 1 * table_size + ((a_word >> 8) & 0xFF) * width;
+                    const uint64_t* t2 = tables.data() + 2 * table_size + ((a_word >> 16) & 0xFF) * width;
+                    const uint64_t* t3 = tables.data() + 3 * table_size + ((a_word >> 24) & 0xFF) * width;
+                    const uint64_t* t4 = tables.data() + 4 * table_size + ((a_word >> 32) & 0xFF) * width;
+                    const uint64_t* t5 = tables.data() + 5 * table_size + ((a_word >> 40) & 0xFF) * width;
+                    const uint64_t* t6 = tables.data() + 6 * table_size + ((a_word >> 48) & 0xFF) * width;
+                    const uint64_t* t7 = tables.data() + 7 * table_size + ((a_word >> 56) & 0xFF) * width;
+                    for (size_t j = 0; j < width; ++j) {
+                        if constexpr (S == GF2Semiring::XorAnd) {
+                            c_row[j] ^= t0[j] ^ t1[j] ^ t2[j] ^ t3[j] ^ t4[j] ^ t5[j] ^ t6[j] ^ t7[j];
+                        } else {
+                            c_row[j] |= t0[j] | t1[j] | t2[j] | t3[j] | t4[j] | t5[j] | t6[j] | t7[j];
+                        }
+                    }
+                } else {
+                    // Partial last word of the common dimension
+                    for (size_t t = 0; t < num_tables; ++t) {
+                        size_t key = (a_word >> (t * M4R_BITS)) & (M4R_TABLE_ROWS - 1);
+                        if (key == 0) continue;
+                        const uint64_t* entry = tables.data() + t * table_size + key * width;
+                        for (size_t j = 0; j < width; ++j) {
+                            c_row[j] = semiring_add<S>(c_row[j], entry[j]);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+void m4r_multiply_block(const uint64_t* a, size_t a_stride,
+                        const uint64_t* b, size_t b_stride,
+                        uint64_t* c, size_t c_stride,
+                        size_t m, size_t k, size_t n_words,
+                        bool accumulate, GF2Semiring semiring) {
+    if (semiring == GF2Semiring::XorAnd) {
+        m4r_multiply<GF2Semiring::XorAnd>(a, a_stride, b, b_stride, c, c_stride, m, k, n_words,
+                                          accumulate);
+    } else {
+        m4r_multiply<GF2Semiring::OrAnd>(a, a_stride, b, b_stride, c, c_stride, m, k, n_words,
+                                         accumulate);
+    }
+}
+
+// Blocks shorter than this are not worth a parallel region
+constexpr size_t BLOCK_PARALLEL_WORDS = size_t(1) << 14;
+
+void block_transpose_mul_64(const uint64_t* x, const uint64_t* y, size_t n, uint64_t* c) {
+    std::fill(c, c + 64, 0);
+    const long long count = static_cast<long long>(n);
+
+    #pragma omp parallel if (n >= BLOCK_PARALLEL_WORDS)
+    {
+        // tables[b * 256 + v]: XOR of the y[k] whose x[k] has byte b equal to v
+        std::vector<uint64_t> tables(M4R_TABLES * M4R_TABLE_ROWS, 0);
+        #pragma omp for schedule(static) nowait
+        for (long long k = 0; k < count; ++k) {
+            const uint64_t xk = x[k], yk = y[k];
+            for (size_t b = 0; b < M4R_TABLES; ++b) {
+                tables[b * M4R_TABLE_ROWS + ((xk >> (b * M4R_BITS)) & 0xFF)] ^= yk;
+            }
+        }
+        // Bit j of entry v of table b belongs to row 8b + j of c
+        uint64_t part[64] = {};
+        for (size_t b = 0; b < M4R_TABLES; ++b) {
+            for (size_t v = 1; v < M4R_TABLE_ROWS; ++v) {
+                const uint64_t entry = tables[b * M4R_TABLE_ROWS + v];
+                for (size_t bits = v; bits; bits &= bits - 1) {
+                    part[b * M4R_BITS + size_t(__builtin_ctzll(bits))] ^= entry;
+                }
+            }
+        }
+        #pragma omp critical
+        for (size_t i = 0; i < 64; ++i) {
+            c[i] ^= part[i];
+        }
+    }
+}
+
+void block_mul_64(const uint64_t* v, const uint64_t* d, size_t n, uint64_t* y, bool accumulate) {
+    uint64_t tables[M4R_TABLES * M4R_TABLE_ROWS];
+    for (size_t b = 0; b < M4R_TABLES; ++b) {
+        m4r_build_table(d + b * M4R_BITS, 1, M4R_BITS, 1, tables + b * M4R_TABLE_ROWS);
+    }
+    const long long count = static_cast<long long>(n);
+
+    #pragma omp parallel for schedule(static) if (n >= BLOCK_PARALLEL_WORDS)
+    for (long long k = 0; k < count; ++k) {
+        const uint64_t w = v[k];
+        uint64_t sum = 0;
+        for (size_t b = 0; b < M4R_TABLES; ++b) {
+            sum ^= tables[b * M4R_TABLE_ROWS + ((w >> (b * M4R_BITS)) & 0xFF)];
+        }
+        y[k] = accumulate ? y[k] ^ sum : sum;
+    }
+}
+
+GF2Matrix GF2Matrix::multiplyM4R(const GF2Matrix& other, GF2Semiring semiring) const {
+    if (m_cols != other.m_rows) {
+        throw std::runtime_error("Matrix dimensions incompatible for multiplication");
+    }
+
+    GF2Matrix result(m_rows, other.m_cols);
+    multiplyM4RInto(*this, other, result, false, semiring);
+    return result;
+}
+
+void GF2Matrix::multiplyM4RInto(const GF2MatrixView& a, const GF2MatrixView& b,
+                                const GF2MutableMatrixView& out, bool accumulate,
+                                GF2Semiring semiring) {
+    if (a.cols() != b.rows()) {
+        throw std::runtime_error("Matrix dimensions incompatible for multiplication");
+    }
+    if (out.rows() != a.rows() || out.cols() != b.cols()) {
+        throw std::runtime_error("Output matrix has the wrong dimensions");
+    }
+
+    if (out.overlaps(a) || out.overlaps(b)) {
+        throw std::runtime_error("Output matrix must not alias an operand");
+    }
+
+    GF2_TRACE_SCOPE("m4r: multiply");
+    GF2Matrix a_copy(0, 0), b_copy(0, 0);
+    const GF2MatrixView a_in = a.aligned(a_copy);
+    const GF2MatrixView b_in = b.aligned(b_copy);
+    m4r_multiply_block(a_in.get_raw_data(), a_in.row_stride(),
+                       b_in.get_raw_data(), b_in.row_stride(),
+                       out.get_raw_data(), out.row_stride(),
+                       a.rows(), a.cols(), out.words_per_row(), accumulate, semiring);
+
+    // B may carry stale bits beyond its last column; keep C's padding zero
+    out.clearPadding();
+}
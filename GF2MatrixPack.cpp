@@ -0,0 +1,132 @@
+#include "GF2Matrix.hpp"
+#include "GF2Kernels.hpp"
+#include <cstring>
+#include <omp.h>
+#include <stdexcept>
+
+namespace {
+
+// Conversions of fewer bits than this run on one thread
+constexpr size_t PARALLEL_MIN_BITS = size_t(1) << 22;
+
+int resolve_threads(int num_threads) {
+    return num_threads > 0 ? num_threads : omp_get_max_threads();
+}
+
+size_t bytes_stride(size_t row_bytes, size_t cols) {
+    if (row_bytes == 0) {
+        return cols;
+    }
+    if (row_bytes < cols) {
+        throw std::runtime_error("Byte row stride shorter than a row");
+    }
+    return row_bytes;
+}
+
+size_t bits_stride(size_t row_bytes, size_t cols) {
+    const size_t bytes = (cols + 7) / 8;
+    if (row_bytes == 0) {
+        return bytes;
+    }
+    if (row_bytes < bytes) {
+        throw std::runtime_error("Bit stream row stride shorter than a row");
+    }
+    return row_bytes;
+}
+
+} // namespace
+
+// Whole words of a row through the kernel and the last partial one bit by bit
+GF2Matrix GF2Matrix::fromBytes(const uint8_t* bytes, size_t rows, size_t cols, size_t row_bytes,
+                               int num_threads) {
+    const size_t stride = bytes_stride(row_bytes, cols);
+    GF2Matrix m(rows, cols);
+    const RowKernel& kernel = row_kernel();
+    const size_t full = cols / 64;
+    uint64_t* data = m.m_data.data();
+    const long long n = static_cast<long long>(rows);
+    #pragma omp parallel for schedule(static) num_threads(resolve_threads(num_threads)) \
+        if (rows * cols >= PARALLEL_MIN_BITS)
+    for (long long rr = 0; rr < n; ++rr) {
+        const size_t r = size_t(rr);
+        const uint8_t* src = bytes + r * stride;
+        uint64_t* row = data + r * m.m_row_stride;
+        kernel.pack_bytes(row, src, full);
+        if (full < m.m_words_per_row) {
+            uint64_t word = 0;
+            for (size_t c = full * 64; c < cols; ++c) {
+                word |= uint64_t(src[c] != 0) << (c % 64);
+            }
+            row[full] = word;
+        }
+    }
+    return m;
+}
+
+void GF2Matrix::toBytes(uint8_t* bytes, size_t row_bytes, int num_threads) const {
+    const size_t stride = bytes_stride(row_bytes, m_cols);
+    const RowKernel& kernel = row_kernel();
+    const size_t full = m_cols / 64;
+    const long long n = static_cast<long long>(m_rows);
+    #pragma omp parallel for schedule(static) num_threads(resolve_threads(num_threads)) \
+        if (m_rows * m_cols >= PARALLEL_MIN_BITS)
+    for (long long rr = 0; rr < n; ++rr) {
+        const size_t r = size_t(rr);
+        uint8_t* dst = bytes + r * stride;
+        const uint64_t* row = m_data.data() + r * m_row_stride;
+        kernel.unpack_bytes(dst, row, full);
+        for (size_t c = full * 64; c < m_cols; ++c) {
+            dst[c] = uint8_t((row[full] >> (c % 64)) & 1);
+        }
+    }
+}
+
+// Byte i of a row's words holds columns 8i to 8i + 7 from the low bit up
+// (the words are little-endian), so an LSB-first stream is the row's bytes
+// and an MSB-first one those bytes with their bits reversed
+GF2Matrix GF2Matrix::fromBits(const uint8_t* bits, size_t rows, size_t cols, GF2BitOrder order,
+                              size_t row_bytes, int num_threads) {
+    const size_t stride = bits_stride(row_bytes, cols);
+    const size_t bytes = (cols + 7) / 8;
+    GF2Matrix m(rows, cols);
+    const RowKernel& kernel = row_kernel();
+    const uint64_t last_mask = cols % 64 ? (uint64_t(1) << (cols % 64)) - 1 : ~uint64_t(0);
+    uint64_t* data = m.m_data.data();
+    const long long n = static_cast<long long>(rows);
+    #pragma omp parallel for schedule(static) num_threads(resolve_threads(num_threads)) \
+        if (rows * cols >= PARALLEL_MIN_BITS)
+    for (long long rr = 0; rr < n; ++rr) {
+        const size_t r = size_t(rr);
+        uint64_t* row = data + r * m.m_row_stride;
+        uint8_t* dst = reinterpret_cast<uint8_t*>(row);
+        if (order == GF2BitOrder::MsbFirst) {
+            kernel.reverse_bits(dst, bits + r * stride, bytes);
+        } else {
+            std::memcpy(dst, bits + r * stride, bytes);
+        }
+        if (m.m_words_per_row > 0) {
+            row[m.m_words_per_row - 1] &= last_mask;
+        }
+    }
+    return m;
+}
+
+// The padding is zero, so the bits past cols come out zero
+void GF2Matrix::toBits(uint8_t* bits, GF2BitOrder order, size_t row_bytes,
+                       int num_threads) const {
+    const size_t stride = bits_stride(row_bytes, m_cols);
+    const size_t bytes = (m_cols + 7) / 8;
+    const RowKernel& kernel = row_kernel();
+    const long long n = static_cast<long long>(m_rows);
+    #pragma omp parallel for schedule(static) num_threads(resolve_threads(num_threads)) \
+        if (m_rows * m_cols >= PARALLEL_MIN_BITS)
+    for (long long rr = 0; rr < n; ++rr) {
+        const size_t r = size_t(rr);
+        const uint8_t* src = reinterpret_cast<const uint8_t*>(m_data.data() + r * m_row_stride);
+        if (order == GF2BitOrder::MsbFirst) {
+            kernel.reverse_bits(bits + r * stride, src, bytes);
+        } else {
+            std::memcpy(bits + r * stride, src, bytes);
+        }
+    }
+}
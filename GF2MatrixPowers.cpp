@@ -0,0 +1,197 @@
+#include "GF2MatrixPowers.hpp"
+#include "GF2MatrixView.hpp"
+#include <cstring>
+#include <omp.h>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+GF2Matrix identity(size_t n) {
+    GF2Matrix m(n, n);
+    for (size_t i = 0; i < n; ++i) {
+        m.set(i, i, true);
+    }
+    return m;
+}
+
+void check_square(const GF2Matrix& a) {
+    if (a.rows() != a.cols()) {
+        throw std::runtime_error("Only square matrices have powers");
+    }
+}
+
+// out = a * b in the Boolean semiring. On one thread the Four Russians
+// tables beat the dot-product kernel (they skip the parity, here OR, tree),
+// so they run then; more threads share the blocks of the SIMD product.
+void boolean_multiply(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& out, GF2Workspace& ws,
+                      int num_threads) {
+    const int threads = num_threads > 0 ? num_threads : omp_get_max_threads();
+    if (threads == 1) {
+        GF2Matrix::multiplyM4RInto(a, b, out, false, GF2Semiring::OrAnd);
+    } else {
+        GF2Matrix::multiplyInto(a, b, out, ws, threads, GF2Semiring::OrAnd);
+    }
+}
+
+} // namespace
+
+// Square and multiply from the low bit up. The square, the running product
+// and one spare matrix rotate through every multiply, and one workspace
+// holds the transposes, so nothing is allocated after the first steps.
+GF2Matrix GF2Matrix::power(uint64_t n, int num_threads) const {
+    check_square(*this);
+    if (n == 0) {
+        return identity(m_rows);
+    }
+    GF2Workspace ws;
+    GF2Matrix square = *this;
+    GF2Matrix result(0, 0);
+    GF2Matrix spare(m_rows, m_cols);
+    bool have_result = false;
+    for (;;) {
+        if (n & 1) {
+            if (have_result) {
+                result.multiplyInto(square, spare, ws, num_threads);
+                std::swap(result, spare);
+            } else {
+                result = square;
+                have_result = true;
+            }
+        }
+        n >>= 1;
+        if (n == 0) {
+            return result;
+        }
+        square.multiplyInto(square, spare, ws, num_threads);
+        std::swap(square, spare);
+    }
+}
+
+void GF2Matrix::applyPower(uint64_t n, const uint64_t* x, uint64_t* y, int num_threads) const {
+    check_square(*this);
+    const size_t words = (m_rows + 63) / 64;
+    if (n == 0) {
+        std::memmove(y, x, words * sizeof(uint64_t));
+        return;
+    }
+    // The squares as in power(); a set bit costs a matrix-vector product
+    // instead of a multiply
+    GF2Workspace ws;
+    GF2Matrix square = *this;
+    GF2Matrix spare(m_rows, m_cols);
+    std::vector<uint64_t> in(x, x + words);
+    for (;;) {
+        if (n & 1) {
+            square.multiplyVector(in.data(), y, num_threads);
+            std::memcpy(in.data(), y, words * sizeof(uint64_t));
+        }
+        n >>= 1;
+        if (n == 0) {
+            return;
+        }
+        square.multiplyInto(square, spare, ws, num_threads);
+        std::swap(square, spare);
+    }
+}
+
+GF2Matrix GF2Matrix::transitiveClosure(bool reflexive, int num_threads) const {
+    if (m_rows != m_cols) {
+        throw std::runtime_error("Only square matrices have a transitive closure");
+    }
+    GF2Workspace ws;
+    GF2Matrix closure = *this;
+    for (size_t i = 0; i < m_rows; ++i) {
+        closure.set(i, i, true);
+    }
+    GF2Matrix spare(m_rows, m_cols);
+    for (size_t paths = 1; paths + 1 < m_rows; paths *= 2) {
+        boolean_multiply(closure, closure, spare, ws, num_threads);
+        std::swap(closure, spare);
+        if (closure == spare) {
+            break;
+        }
+    }
+    if (reflexive) {
+        return closure;
+    }
+    boolean_multiply(*this, closure, spare, ws, num_threads);
+    return spare;
+}
+
+GF2MatrixPowers::GF2MatrixPowers(GF2Matrix a, int num_threads) : m_threads(num_threads) {
+    check_square(a);
+    m_squares.push_back(std::move(a));
+}
+
+const GF2Matrix& GF2MatrixPowers::square(size_t i) {
+    if (i >= 64) {
+        throw std::runtime_error("Square index out of range");
+    }
+    const size_t n = size();
+    m_squares.reserve(i + 1);
+    while (m_squares.size() <= i) {
+        GF2Matrix next(n, n);
+        m_squares.back().multiplyInto(m_squares.back(), next, m_ws, m_threads);
+        m_squares.push_back(std::move(next));
+    }
+    return m_squares[i];
+}
+
+GF2Matrix GF2MatrixPowers::power(uint64_t n) {
+    const size_t size = this->size();
+    if (n == 0) {
+        return identity(size);
+    }
+    GF2Matrix result(0, 0);
+    GF2Matrix spare(size, size);
+    bool have_result = false;
+    for (size_t i = 0; n; ++i, n >>= 1) {
+        if (!(n & 1)) {
+            continue;
+        }
+        const GF2Matrix& s = square(i);
+        if (have_result) {
+            result.multiplyInto(s, spare, m_ws, m_threads);
+            std::swap(result, spare);
+        } else {
+            result = s;
+            have_result = true;
+        }
+    }
+    return result;
+}
+
+template <class Step>
+void GF2MatrixPowers::applyBits(uint64_t n, const uint64_t* x, uint64_t* y, size_t words,
+                                Step&& step) {
+    m_scratch.assign(x, x + words);
+    bool in_scratch = true;
+    for (size_t i = 0; n; ++i, n >>= 1) {
+        if (!(n & 1)) {
+            continue;
+        }
+        // Alternates between m_scratch and y, in place of a copy per step
+        if (in_scratch) {
+            step(i, m_scratch.data(), y);
+        } else {
+            step(i, y, m_scratch.data());
+        }
+        in_scratch = !in_scratch;
+    }
+    if (in_scratch) {
+        std::memcpy(y, m_scratch.data(), words * sizeof(uint64_t));
+    }
+}
+
+void GF2MatrixPowers::apply(uint64_t n, const uint64_t* x, uint64_t* y) {
+    applyBits(n, x, y, (size() + 63) / 64, [&](size_t i, const uint64_t* in, uint64_t* out) {
+        square(i).multiplyVector(in, out, m_threads);
+    });
+}
+
+void GF2MatrixPowers::applyBlock(uint64_t n, const uint64_t* x, uint64_t* y) {
+    applyBits(n, x, y, size(), [&](size_t i, const uint64_t* in, uint64_t* out) {
+        square(i).multiplyBlock(in, out, m_threads);
+    });
+}
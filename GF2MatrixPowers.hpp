@@ -0,0 +1,44 @@
+#pragma once
+
+#include "GF2Matrix.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The squares A^(2^i) of a square matrix, kept for repeated powers and
+// jump-aheads of one matrix (an LFSR or xorshift transition, say). Squares
+// are computed on first use, each from the previous one, so a query costs
+// only the multiplies (or matrix-vector products) of its set bits once the
+// squares up to its top bit exist. Not for concurrent use.
+class GF2MatrixPowers {
+public:
+    // Throws std::runtime_error if a is not square. num_threads <= 0 uses
+    // the OpenMP default.
+    explicit GF2MatrixPowers(GF2Matrix a, int num_threads = 0);
+
+    size_t size() const { return m_squares.front().rows(); }
+    // Squares computed so far
+    size_t cached() const { return m_squares.size(); }
+
+    // A^(2^i)
+    const GF2Matrix& square(size_t i);
+
+    // A^n
+    GF2Matrix power(uint64_t n);
+    // y = A^n * x for a vector x of (size() + 63) / 64 words; y may be x
+    void apply(uint64_t n, const uint64_t* x, uint64_t* y);
+    // y = A^n * x for a size() x 64 block x (see GF2Matrix::multiplyBlock),
+    // 64 states advanced at once; y may be x
+    void applyBlock(uint64_t n, const uint64_t* x, uint64_t* y);
+
+private:
+    std::vector<GF2Matrix> m_squares; // A^(2^i) at index i
+    GF2Workspace m_ws;
+    int m_threads;
+    std::vector<uint64_t> m_scratch;  // the other half of the ping-pong
+
+    // y = (product of the squares of the set bits of n) * x, with step(i,
+    // in, out) computing out = A^(2^i) * in
+    template <class Step>
+    void applyBits(uint64_t n, const uint64_t* x, uint64_t* y, size_t words, Step&& step);
+};
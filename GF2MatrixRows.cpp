@@ -0,0 +1,173 @@
+#include "GF2Matrix.hpp"
+#include "GF2Kernels.hpp"
+#include "GF2CpuInfo.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// Matrices smaller than this many words are counted on one thread
+constexpr size_t PARALLEL_MIN_WORDS = size_t(1) << 16;
+
+} // namespace
+
+const RowKernel& row_kernel() {
+    static const RowKernel kernel = [] {
+        const char* simd = simd_kernel().name;
+#if defined(__x86_64__) || defined(_M_X64)
+        const GF2CpuInfo& cpu = GF2CpuInfo::get();
+        if (cpu.avx512f && cpu.avx2 &&
+            (std::strcmp(simd, "avx512") == 0 || std::strcmp(simd, "gfni") == 0)) {
+            return RowKernel{"avx512", row_xor_avx512, row_xor_masked_avx512, row_swap_avx512,
+                             row_weight_avx2, row_first_nonzero_avx512, hash_stripes_avx512,
+                             pack_bytes_avx2, unpack_bytes_avx2, reverse_bits_avx2,
+                             lookup_nibbles_avx2};
+        }
+        if (cpu.avx2 && std::strcmp(simd, "scalar") != 0) {
+            return RowKernel{"avx2", row_xor_avx2, row_xor_masked_avx2, row_swap_avx2,
+                             row_weight_avx2, row_first_nonzero_avx2, hash_stripes_avx2,
+                             pack_bytes_avx2, unpack_bytes_avx2, reverse_bits_avx2,
+                             lookup_nibbles_avx2};
+        }
+#elif defined(__aarch64__)
+        if (GF2CpuInfo::get().neon && std::strcmp(simd, "scalar") != 0) {
+            return RowKernel{"neon", row_xor_neon, row_xor_masked_neon, row_swap_neon,
+                             row_weight_neon, row_first_nonzero_neon, hash_stripes_neon,
+                             pack_bytes_neon, unpack_bytes_neon, reverse_bits_neon,
+                             lookup_nibbles_neon};
+        }
+#endif
+        (void)simd;
+        return RowKernel{"scalar", row_xor_scalar, row_xor_masked_scalar, row_swap_scalar,
+                         row_weight_scalar, row_first_nonzero_scalar, hash_stripes_scalar,
+                         pack_bytes_scalar, unpack_bytes_scalar, reverse_bits_scalar,
+                         lookup_nibbles_scalar};
+    }();
+    return kernel;
+}
+
+void GF2Matrix::rowXor(size_t dst, size_t src, size_t word0, size_t word1) {
+    rowXor(dst, *this, src, word0, word1);
+}
+
+void GF2Matrix::rowXor(size_t dst, const GF2Matrix& src, size_t r, size_t word0, size_t word1) {
+    if (dst >= m_rows || r >= src.m_rows) {
+        throw std::runtime_error("Row index out of range");
+    }
+    if (src.m_cols != m_cols) {
+        throw std::runtime_error("Rows of different lengths");
+    }
+    invalidateStructure();
+    word1 = std::min(word1, m_words_per_row);
+    if (word0 >= word1 || (&src == this && dst == r)) {
+        // x ^= x is zero; the kernels require distinct rows
+        if (word0 < word1) {
+            std::memset(m_data.data() + dst * m_row_stride + word0, 0,
+                        (word1 - word0) * sizeof(uint64_t));
+        }
+        return;
+    }
+    row_kernel().xor_rows(m_data.data() + dst * m_row_stride + word0,
+                          src.m_data.data() + r * src.m_row_stride + word0, word1 - word0);
+}
+
+void GF2Matrix::rowXorMasked(size_t dst, size_t src, const uint64_t* mask) {
+    if (dst >= m_rows || src >= m_rows) {
+        throw std::runtime_error("Row index out of range");
+    }
+    invalidateStructure();
+    uint64_t* d = m_data.data() + dst * m_row_stride;
+    if (dst == src) {
+        for (size_t w = 0; w < m_words_per_row; ++w) d[w] &= ~mask[w];
+        return;
+    }
+    // Mask bits past the last column meet the zero padding of src
+    row_kernel().xor_masked(d, m_data.data() + src * m_row_stride, mask, m_words_per_row);
+}
+
+void GF2Matrix::rowSwap(size_t r0, size_t r1) {
+    if (r0 >= m_rows || r1 >= m_rows) {
+        throw std::runtime_error("Row index out of range");
+    }
+    if (r0 != r1) {
+        invalidateStructure();
+        row_kernel().swap(m_data.data() + r0 * m_row_stride, m_data.data() + r1 * m_row_stride,
+                          m_words_per_row);
+    }
+}
+
+size_t GF2Matrix::firstSetBit(size_t row, size_t from) const {
+    if (row >= m_rows) {
+        throw std::runtime_error("Row index out of range");
+    }
+    if (from >= m_cols) {
+        return m_cols;
+    }
+    const uint64_t* r = m_data.data() + row * m_row_stride;
+    const size_t w0 = from / 64;
+    const uint64_t first = r[w0] & (~uint64_t(0) << (from % 64));
+    if (first) {
+        return w0 * 64 + size_t(__builtin_ctzll(first));
+    }
+    const size_t w = w0 + 1 + row_kernel().first_nonzero(r + w0 + 1, m_words_per_row - w0 - 1);
+    return w < m_words_per_row ? w * 64 + size_t(__builtin_ctzll(r[w])) : m_cols;
+}
+
+size_t GF2Matrix::rowWeight(size_t row) const {
+    if (row >= m_rows) {
+        throw std::runtime_error("Row index out of range");
+    }
+    return row_kernel().weight(m_data.data() + row * m_row_stride, m_words_per_row);
+}
+
+std::vector<size_t> GF2Matrix::rowWeights() const {
+    std::vector<size_t> weights(m_rows);
+    const RowKernel& kernel = row_kernel();
+    const long long rows = static_cast<long long>(m_rows);
+    #pragma omp parallel for schedule(static) if (m_rows * m_words_per_row >= PARALLEL_MIN_WORDS)
+    for (long long r = 0; r < rows; ++r) {
+        weights[size_t(r)] = kernel.weight(m_data.data() + size_t(r) * m_row_stride,
+                                           m_words_per_row);
+    }
+    return weights;
+}
+
+// A 64 x 64 block at a time, transposed so that a word holds 64 bits of a
+// column; threads take word columns, so no two write the same count
+std::vector<size_t> GF2Matrix::columnWeights() const {
+    std::vector<size_t> weights(m_cols, 0);
+    const long long words = static_cast<long long>(m_words_per_row);
+    #pragma omp parallel for schedule(static) if (m_rows * m_words_per_row >= PARALLEL_MIN_WORDS)
+    for (long long ww = 0; ww < words; ++ww) {
+        const size_t w = size_t(ww);
+        const size_t cols = std::min<size_t>(64, m_cols - w * 64);
+        uint64_t block[64];
+        for (size_t r0 = 0; r0 < m_rows; r0 += 64) {
+            const size_t n = std::min<size_t>(64, m_rows - r0);
+            for (size_t i = 0; i < 64; ++i) {
+                block[i] = i < n ? m_data[(r0 + i) * m_row_stride + w] : 0;
+            }
+            transpose_64x64(block);
+            for (size_t c = 0; c < cols; ++c) {
+                weights[w * 64 + c] += size_t(__builtin_popcountll(block[c]));
+            }
+        }
+    }
+    return weights;
+}
+
+// The padding is zero, so the whole storage is counted, in chunks
+size_t GF2Matrix::popcount() const {
+    const RowKernel& kernel = row_kernel();
+    const size_t words = m_rows * m_row_stride;
+    const long long chunks = static_cast<long long>((words + PARALLEL_MIN_WORDS - 1) /
+                                                    PARALLEL_MIN_WORDS);
+    size_t total = 0;
+    #pragma omp parallel for schedule(static) reduction(+ : total) if (chunks > 1)
+    for (long long cc = 0; cc < chunks; ++cc) {
+        const size_t w0 = size_t(cc) * PARALLEL_MIN_WORDS;
+        total += kernel.weight(m_data.data() + w0, std::min(PARALLEL_MIN_WORDS, words - w0));
+    }
+    return total;
+}
@@ -0,0 +1,603 @@
+#include "GF2Matrix.hpp"
+#include "GF2PackedOperand.hpp"
+#include "GF2MatrixView.hpp"
+#include "GF2Kernels.hpp"
+#include "GF2CpuInfo.hpp"
+#include "GF2Numa.hpp"
+#include "GF2Trace.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Drivers for the dot-product (A * B^T) multiply. B is transposed once (into
+// a GF2Workspace), then the output is walked in blocks that are handed to the
+// per-ISA block kernel selected at runtime.
+
+namespace {
+
+// The first supported kernel, or the one GF2_SIMD_KERNEL names if it is
+// supported
+SimdKernel select_simd_kernel() {
+    const std::vector<SimdKernel> supported = simd_kernels();
+    const char* forced = std::getenv("GF2_SIMD_KERNEL");
+    if (forced) {
+        for (const SimdKernel& kernel : supported) {
+            if (std::strcmp(forced, kernel.name) == 0) return kernel;
+        }
+    }
+    return supported.front();
+}
+
+// The B operand in the layout the selected kernel reads: B^T, or B^T
+// repacked by the kernel's pack_b, held in the workspace. k_words is the
+// common dimension the kernel is run over: A's words rounded up to the
+// kernel's vector step, as far as A's row storage and the zero padding of
+// B^T allow, so padded rows need no tail loop. The A words past its columns
+// (padding, or columns beside a view) meet zero bits of B^T.
+struct PreparedB {
+    const uint64_t* data;
+    size_t stride;
+    size_t k_words;
+};
+
+// Grows a buffer every thread reads to hold words, its storage interleaved
+// over the NUMA nodes
+template <typename Vector>
+void reserve_shared(Vector& v, size_t words) {
+    if (v.capacity() >= words) return;
+    Vector fresh;
+    fresh.reserve(words);
+    gf2_numa_interleave(fresh.data(), words * sizeof(uint64_t));
+    v.swap(fresh);
+}
+
+// The kernel operand for a B^T already in memory, b_cols rows of
+// b_t_words words (its storage, zero past the columns) at b_t_stride:
+// packed into the workspace if the kernel has a layout of its own
+PreparedB prepare_b_t(const SimdKernel& kernel, const GF2MatrixView& a, const uint64_t* b_t,
+                      size_t b_t_stride, size_t b_t_words, size_t b_cols, GF2Workspace& ws) {
+    const size_t step = kernel.k_align;
+    size_t k_words = (a.words_per_row() + step - 1) / step * step;
+    k_words = std::min({k_words, a.storage_words(), b_t_words});
+
+    if (!kernel.pack_b) {
+        return {b_t, b_t_stride, k_words};
+    }
+
+    GF2_TRACE_SCOPE("simd: pack B");
+    const size_t n_words = (b_cols + 63) / 64;
+    reserve_shared(ws.packed_b, n_words * k_words * 64);
+    ws.packed_b.resize(n_words * k_words * 64);
+    kernel.pack_b(b_t, b_t_stride, b_cols, k_words, ws.packed_b.data());
+    return {ws.packed_b.data(), k_words * 64, k_words};
+}
+
+PreparedB prepare_b(const SimdKernel& kernel, const GF2MatrixView& a, const GF2MatrixView& b,
+                    GF2Workspace& ws) {
+    const size_t align = GF2Matrix::ROW_ALIGN_WORDS;
+    const size_t b_t_stride = ((b.rows() + 63) / 64 + align - 1) / align * align;
+
+    // assign() keeps the capacity, so same-shape calls do not allocate; the
+    // padding words must be zero for the rounded-up k range
+    {
+        GF2_TRACE_SCOPE("simd: transpose B");
+        reserve_shared(ws.b_t, b.cols() * b_t_stride);
+        ws.b_t.assign(b.cols() * b_t_stride, 0);
+        transpose_matrix(b.get_raw_data(), b.row_stride(), ws.b_t.data(), b_t_stride,
+                         b.rows(), b.cols());
+    }
+    return prepare_b_t(kernel, a, ws.b_t.data(), b_t_stride, b_t_stride, b.cols(), ws);
+}
+
+int resolve_threads(int num_threads) {
+#ifdef _OPENMP
+    return num_threads > 0 ? num_threads : omp_get_max_threads();
+#else
+    (void)num_threads;
+    return 1;
+#endif
+}
+
+// C = A * B (or C ^= A * B) split into PARALLEL_ROW_BLOCK x PARALLEL_COL_BLOCK
+// blocks across the threads, restricted to the rows [row0, row1) of C
+void multiply_blocks(const SimdKernel& kernel, const GF2MatrixView& a, const PreparedB& b_t,
+                     size_t b_cols, const GF2MutableMatrixView& c, bool accumulate, int threads,
+                     size_t row0 = 0, size_t row1 = SIZE_MAX) {
+    const size_t row_block = GF2Matrix::PARALLEL_ROW_BLOCK;
+    const size_t word_block = GF2Matrix::PARALLEL_COL_BLOCK / 64;
+    const size_t rows = std::min(row1, a.rows());
+    row0 = std::min(row0, rows);
+    const size_t result_words = c.words_per_row();
+    const size_t row_blocks = (rows - row0 + row_block - 1) / row_block;
+    const size_t col_blocks = (result_words + word_block - 1) / word_block;
+    const long long num_blocks = static_cast<long long>(row_blocks * col_blocks);
+    const SimdBlockKernel block = kernel.block;
+    const uint64_t* a_data = a.get_raw_data();
+    uint64_t* c_data = c.get_raw_data();
+
+    auto run_block = [&](long long blk) {
+        size_t i0 = row0 + (static_cast<size_t>(blk) / col_blocks) * row_block;
+        size_t jw0 = (static_cast<size_t>(blk) % col_blocks) * word_block;
+        block(a_data, a.row_stride(), b_t.data, b_t.stride,
+              c_data, c.row_stride(), b_cols,
+              i0, std::min(i0 + row_block, rows),
+              jw0, std::min(jw0 + word_block, result_words),
+              0, b_t.k_words, accumulate);
+    };
+
+    // Column blocks are whole cache lines of result words (8 x 64 columns),
+    // so no two threads ever write into the same result word. The static
+    // schedule gives thread t the t-th band of rows, those it first touched;
+    // on a hybrid CPU the blocks go to whichever thread is free instead.
+    const bool dynamic = gf2_dynamic_schedule();
+    #pragma omp parallel num_threads(threads)
+    {
+        gf2_numa_pin_thread();
+        gf2_set_thread_qos(GF2ThreadQos::Compute);
+        if (dynamic) {
+            #pragma omp for schedule(dynamic, 1)
+            for (long long blk = 0; blk < num_blocks; ++blk) {
+                run_block(blk);
+            }
+        } else {
+            #pragma omp for schedule(static)
+            for (long long blk = 0; blk < num_blocks; ++blk) {
+                run_block(blk);
+            }
+        }
+    }
+}
+
+// View of a prepared operand for the given A; k_words as in prepare_b
+PreparedB prepared_b(const SimdKernel& kernel, const GF2MatrixView& a,
+                     const GF2PackedOperand& b) {
+    const size_t step = kernel.k_align;
+    size_t k_words = (a.words_per_row() + step - 1) / step * step;
+    k_words = std::min({k_words, a.storage_words(), b.kernel_words()});
+    return {b.kernel_data(), b.kernel_stride(), k_words};
+}
+
+void run_multiply(const SimdKernel& kernel, const GF2MatrixView& a, const PreparedB& b_t,
+                  size_t b_cols, const GF2MutableMatrixView& c, bool accumulate, int threads) {
+    GF2_TRACE_SCOPE("simd: multiply");
+    if (threads == 1) {
+        kernel.block(a.get_raw_data(), a.row_stride(), b_t.data, b_t.stride,
+                     c.get_raw_data(), c.row_stride(), b_cols,
+                     0, a.rows(), 0, c.words_per_row(), 0, b_t.k_words, accumulate);
+    } else {
+        multiply_blocks(kernel, a, b_t, b_cols, c, accumulate, threads);
+    }
+}
+
+GF2Matrix run_tiled(const SimdKernel& kernel, const GF2MatrixView& a, const PreparedB& b_t,
+                    size_t b_cols, const GF2TileConfig& tiles, int num_threads) {
+    GF2_TRACE_SCOPE("simd: tiled multiply");
+    GF2Matrix result(a.rows(), b_cols);
+    const GF2TileConfig t = tiles.resolve();
+    const SimdBlockKernel block = kernel.block;
+
+    const size_t rows = a.rows();
+    const size_t result_words = result.words_per_row();
+    const size_t k_words = b_t.k_words;
+    const size_t k_tile = (t.k_words + kernel.k_align - 1) / kernel.k_align * kernel.k_align;
+    const size_t row_tiles = (rows + t.rows - 1) / t.rows;
+    const size_t col_tiles = (result_words + t.words - 1) / t.words;
+    const long long num_tiles = static_cast<long long>(row_tiles * col_tiles);
+    const int threads = resolve_threads(num_threads);
+    const uint64_t* a_data = a.get_raw_data();
+    uint64_t* c_data = result.get_raw_data();
+
+    // Each (i, j) tile is owned by one thread; the k loop runs inside it so
+    // the A tile stays in L1 and the B^T tile in L2 while they are reused.
+    auto run_tile = [&](long long tile) {
+        size_t i0 = (static_cast<size_t>(tile) / col_tiles) * t.rows;
+        size_t jw0 = (static_cast<size_t>(tile) % col_tiles) * t.words;
+        size_t i1 = std::min(i0 + t.rows, rows);
+        size_t jw1 = std::min(jw0 + t.words, result_words);
+
+        for (size_t k0 = 0; k0 < k_words; k0 += k_tile) {
+            size_t k1 = std::min(k0 + k_tile, k_words);
+            block(a_data, a.row_stride(),
+                  b_t.data, b_t.stride,
+                  c_data, result.row_stride(), b_cols,
+                  i0, i1, jw0, jw1, k0, k1, k0 != 0);
+        }
+    };
+    const bool dynamic = gf2_dynamic_schedule();
+    #pragma omp parallel num_threads(threads)
+    {
+        gf2_set_thread_qos(GF2ThreadQos::Compute);
+        if (dynamic) {
+            #pragma omp for schedule(dynamic, 1)
+            for (long long tile = 0; tile < num_tiles; ++tile) {
+                run_tile(tile);
+            }
+        } else {
+            #pragma omp for schedule(static)
+            for (long long tile = 0; tile < num_tiles; ++tile) {
+                run_tile(tile);
+            }
+        }
+    }
+    return result;
+}
+
+void check_operands(const GF2MatrixView& a, size_t b_rows) {
+    if (a.cols() != b_rows) {
+        throw std::runtime_error("Matrix dimensions incompatible for multiplication");
+    }
+}
+
+void check_output(const GF2MatrixView& a, size_t b_cols, const GF2MutableMatrixView& c) {
+    if (c.rows() != a.rows() || c.cols() != b_cols) {
+        throw std::runtime_error("Output matrix has the wrong dimensions");
+    }
+    if (c.overlaps(a)) {
+        throw std::runtime_error("Output matrix must not alias an operand");
+    }
+}
+
+void multiply_into(const GF2MatrixView& a, const GF2MatrixView& b,
+                   const GF2MutableMatrixView& c, GF2Workspace& ws, bool accumulate,
+                   int num_threads, GF2Semiring semiring = GF2Semiring::XorAnd) {
+    check_operands(a, b.rows());
+    check_output(a, b.cols(), c);
+    if (c.overlaps(b)) {
+        throw std::runtime_error("Output matrix must not alias an operand");
+    }
+
+    GF2Matrix a_copy(0, 0), b_copy(0, 0);
+    const GF2MatrixView a_in = a.aligned(a_copy);
+    const SimdKernel& kernel = simd_kernel(semiring);
+    const PreparedB b_t = prepare_b(kernel, a_in, b.aligned(b_copy), ws);
+    run_multiply(kernel, a_in, b_t, b.cols(), c, accumulate, resolve_threads(num_threads));
+}
+
+void multiply_into(const GF2MatrixView& a, const GF2PackedOperand& b,
+                   const GF2MutableMatrixView& c, bool accumulate, int num_threads) {
+    check_operands(a, b.rows());
+    check_output(a, b.cols(), c);
+
+    GF2Matrix a_copy(0, 0);
+    const GF2MatrixView a_in = a.aligned(a_copy);
+    const SimdKernel& kernel = simd_kernel();
+    run_multiply(kernel, a_in, prepared_b(kernel, a_in, b), b.cols(), c, accumulate,
+                 resolve_threads(num_threads));
+}
+
+} // namespace
+
+std::vector<SimdKernel> simd_kernels() {
+    const GF2CpuInfo& cpu = GF2CpuInfo::get();
+
+    // Candidates in order of preference
+    struct Candidate {
+        SimdKernel kernel;
+        bool supported;
+    };
+    const Candidate candidates[] = {
+#if defined(__x86_64__) || defined(_M_X64)
+        {{"gfni", simd_block_gfni, simd_pack_gfni, 1, nullptr}, cpu.gfni && cpu.avx512bw},
+        {{"avx512", simd_block_avx512, nullptr, 8, simd_block_avx512_or}, cpu.avx512f},
+        {{"avx2", simd_block_avx2, nullptr, 4, simd_block_avx2_or}, cpu.avx2},
+#elif defined(__aarch64__)
+#ifdef GF2_HAVE_SVE2
+        // At 128 bits SVE2 has no width advantage over NEON with EOR3
+        {{"sve2", simd_block_sve2, nullptr, 1, nullptr}, cpu.sve2 && cpu.sve_vector_bytes > 16},
+#endif
+        {{"neon-eor3", simd_block_neon_eor3, nullptr, 4, nullptr}, cpu.sha3},
+        {{"neon", simd_block_neon, nullptr, 2, simd_block_neon_or}, cpu.neon},
+#endif
+        {{"scalar", simd_block_scalar, nullptr, 1, simd_block_scalar_or}, true},
+    };
+
+    std::vector<SimdKernel> supported;
+    for (const auto& c : candidates) {
+        if (c.supported) supported.push_back(c.kernel);
+    }
+    return supported;
+}
+
+const SimdKernel& simd_kernel() {
+    static const SimdKernel kernel = select_simd_kernel();
+    return kernel;
+}
+
+const SimdKernel& simd_kernel(GF2Semiring semiring) {
+    if (semiring == GF2Semiring::XorAnd) {
+        return simd_kernel();
+    }
+    static const SimdKernel kernel = [] {
+        SimdKernel k = simd_kernel();
+        if (!k.block_or) {
+            for (const SimdKernel& candidate : simd_kernels()) {
+                if (candidate.block_or) {
+                    k = candidate;
+                    break;
+                }
+            }
+        }
+        return SimdKernel{k.name, k.block_or, nullptr, k.k_align, k.block_or};
+    }();
+    return kernel;
+}
+
+std::vector<SimdKernel> simd_tile_kernels() {
+    const char* isa = row_kernel().name;
+#if defined(__x86_64__) || defined(_M_X64)
+    if (std::strcmp(isa, "avx512") == 0) return simd_tiles_avx512();
+    if (std::strcmp(isa, "avx2") == 0) return simd_tiles_avx2();
+#elif defined(__aarch64__)
+    if (std::strcmp(isa, "neon") == 0) return simd_tiles_neon();
+#endif
+    (void)isa;
+    return simd_tiles_scalar();
+}
+
+const char* GF2Matrix::simdKernelName() {
+    return simd_kernel().name;
+}
+
+const char* GF2Matrix::booleanKernelName() {
+    return simd_kernel(GF2Semiring::OrAnd).name;
+}
+
+std::vector<std::string> GF2Matrix::simdTileNames() {
+    std::vector<std::string> names;
+    for (const SimdKernel& kernel : simd_tile_kernels()) names.push_back(kernel.name);
+    return names;
+}
+
+GF2PackedOperand::GF2PackedOperand(const GF2Matrix& b)
+    : m_rows(b.rows()), m_cols(b.cols()), m_b_t(b.transpose()), m_kernel_words(m_b_t.row_stride()) {
+    const SimdKernel& kernel = simd_kernel();
+    if (!kernel.pack_b) return;
+
+    // Packed for the widest common dimension any A of matching shape is run
+    // with (see prepared_b); narrower A strides use a prefix of it
+    const size_t step = kernel.k_align;
+    m_kernel_words = std::min(((m_rows + 63) / 64 + step - 1) / step * step, m_b_t.row_stride());
+    reserve_shared(m_packed, (m_cols + 63) / 64 * m_kernel_words * 64);
+    m_packed.resize((m_cols + 63) / 64 * m_kernel_words * 64);
+    kernel.pack_b(m_b_t.get_raw_data(), m_b_t.row_stride(), m_cols, m_kernel_words, m_packed.data());
+}
+
+const uint64_t* GF2PackedOperand::kernel_data() const {
+    return m_packed.empty() ? m_b_t.get_raw_data() : m_packed.data();
+}
+
+size_t GF2PackedOperand::kernel_stride() const {
+    return m_packed.empty() ? m_b_t.row_stride() : m_kernel_words * 64;
+}
+
+GF2Matrix GF2Matrix::multiplySIMD(const GF2Matrix& other) const {
+    check_operands(*this, other.m_rows);
+
+    GF2Matrix result(m_rows, other.m_cols);
+    GF2Workspace ws;
+    multiply_into(*this, other, result, ws, false, 1);
+    return result;
+}
+
+GF2Matrix GF2Matrix::multiplySIMD(const GF2PackedOperand& other) const {
+    check_operands(*this, other.rows());
+
+    GF2Matrix result(m_rows, other.cols());
+    multiply_into(*this, other, result, false, 1);
+    return result;
+}
+
+GF2Matrix GF2Matrix::multiplySIMDParallel(const GF2Matrix& other, int num_threads) const {
+    check_operands(*this, other.m_rows);
+
+    GF2Matrix result(m_rows, other.m_cols);
+    GF2Workspace ws;
+    const SimdKernel& kernel = simd_kernel();
+    const PreparedB b_t = prepare_b(kernel, *this, other, ws);
+    multiply_blocks(kernel, *this, b_t, other.m_cols, result, false, resolve_threads(num_threads));
+    return result;
+}
+
+GF2Matrix GF2Matrix::multiplySIMDTile(const GF2Matrix& other, const std::string& tile,
+                                      int num_threads) const {
+    check_operands(*this, other.m_rows);
+
+    static const std::vector<SimdKernel> tiles = simd_tile_kernels();
+    auto it = std::find_if(tiles.begin(), tiles.end(),
+                           [&](const SimdKernel& kernel) { return tile == kernel.name; });
+    if (it == tiles.end()) {
+        throw std::runtime_error("Unknown register tile: " + tile);
+    }
+    GF2Matrix result(m_rows, other.m_cols);
+    GF2Workspace ws;
+    const PreparedB b_t = prepare_b(*it, *this, other, ws);
+    run_multiply(*it, *this, b_t, other.m_cols, result, false, resolve_threads(num_threads));
+    return result;
+}
+
+GF2Matrix GF2Matrix::multiplySIMDParallel(const GF2PackedOperand& other, int num_threads) const {
+    check_operands(*this, other.rows());
+
+    GF2Matrix result(m_rows, other.cols());
+    const SimdKernel& kernel = simd_kernel();
+    multiply_blocks(kernel, *this, prepared_b(kernel, *this, other), other.cols(), result, false,
+                    resolve_threads(num_threads));
+    return result;
+}
+
+void GF2Matrix::multiplyInto(const GF2Matrix& other, GF2Matrix& out, GF2Workspace& ws,
+                             int num_threads) const {
+    multiply_into(*this, other, out, ws, false, num_threads);
+}
+
+void GF2Matrix::multiplyInto(const GF2PackedOperand& other, GF2Matrix& out, int num_threads) const {
+    multiply_into(*this, other, out, false, num_threads);
+}
+
+void GF2Matrix::multiplyRowsInto(const GF2PackedOperand& other, GF2Matrix& out, size_t row0,
+                                 size_t row1, int num_threads) const {
+    check_operands(*this, other.rows());
+    check_output(*this, other.cols(), out);
+    if (row0 > row1 || row1 > m_rows) {
+        throw std::runtime_error("Row range out of bounds");
+    }
+
+    const SimdKernel& kernel = simd_kernel();
+    multiply_blocks(kernel, *this, prepared_b(kernel, *this, other), other.cols(), out, false,
+                    resolve_threads(num_threads), row0, row1);
+}
+
+void GF2Matrix::addMul(GF2Matrix& c, const GF2Matrix& a, const GF2Matrix& b, GF2Workspace& ws,
+                       int num_threads) {
+    multiply_into(a, b, c, ws, true, num_threads);
+}
+
+void GF2Matrix::addMul(GF2Matrix& c, const GF2Matrix& a, const GF2PackedOperand& b,
+                       int num_threads) {
+    multiply_into(a, b, c, true, num_threads);
+}
+
+void GF2Matrix::multiplyInto(const GF2MatrixView& a, const GF2MatrixView& b,
+                             const GF2MutableMatrixView& out, GF2Workspace& ws,
+                             int num_threads, GF2Semiring semiring) {
+    multiply_into(a, b, out, ws, false, num_threads, semiring);
+}
+
+void GF2Matrix::addMul(const GF2MutableMatrixView& c, const GF2MatrixView& a,
+                       const GF2MatrixView& b, GF2Workspace& ws, int num_threads,
+                       GF2Semiring semiring) {
+    multiply_into(a, b, c, ws, true, num_threads, semiring);
+}
+
+GF2Matrix GF2Matrix::multiplyBoolean(const GF2Matrix& other, int num_threads) const {
+    check_operands(*this, other.m_rows);
+
+    GF2Matrix result(m_rows, other.m_cols);
+    GF2Workspace ws;
+    multiply_into(*this, other, result, ws, false, num_threads, GF2Semiring::OrAnd);
+    return result;
+}
+
+void GF2Matrix::addMul(const GF2MutableMatrixView& c, const GF2MatrixView& a,
+                       const GF2PackedOperand& b, int num_threads) {
+    multiply_into(a, b, c, true, num_threads);
+}
+
+// B is already the B^T operand of the dot-product kernel: its rows are the
+// columns of the product
+GF2Matrix GF2Matrix::multiplyABt(const GF2Matrix& b, int num_threads,
+                                 bool transpose_result) const {
+    if (transpose_result) {
+        return b.multiplyABt(*this, num_threads);
+    }
+    if (m_cols != b.m_cols) {
+        throw std::runtime_error("Matrix dimensions incompatible for multiplication");
+    }
+    GF2Matrix result(m_rows, b.m_rows);
+    GF2Workspace ws;
+    const SimdKernel& kernel = simd_kernel();
+    const PreparedB b_t = prepare_b_t(kernel, *this, b.get_raw_data(), b.m_row_stride,
+                                      b.m_row_stride, b.m_rows, ws);
+    run_multiply(kernel, *this, b_t, b.m_rows, result, false, resolve_threads(num_threads));
+    return result;
+}
+
+GF2Matrix GF2Matrix::multiplySIMD(const GF2Transposed& other) const {
+    return &other.transpose() == this ? multiplyAAt(GF2Triangle::Lower, true, 1)
+                                      : multiplyABt(other.transpose(), 1);
+}
+
+GF2Matrix GF2Matrix::multiplySIMDParallel(const GF2Transposed& other, int num_threads) const {
+    return &other.transpose() == this ? multiplyAAt(GF2Triangle::Lower, true, num_threads)
+                                      : multiplyABt(other.transpose(), num_threads);
+}
+
+// B^T is this matrix itself. A row block of 64 rows is one result word (a
+// diagonal one), so the lower triangle of row block r is its words [0, r]
+// and the upper one [r, words); those are cut into cache lines of words at
+// multiples of PARALLEL_COL_BLOCK. Only the diagonal words hold entries of
+// the other triangle, cleared at the end.
+GF2Matrix GF2Matrix::multiplyAAt(GF2Triangle triangle, bool mirror, int num_threads) const {
+    GF2Matrix result(m_rows, m_rows);
+    if (m_rows == 0) {
+        return result;
+    }
+    const bool lower = triangle == GF2Triangle::Lower;
+    const size_t word_block = PARALLEL_COL_BLOCK / 64;
+    const size_t result_words = result.words_per_row();
+    std::vector<std::pair<size_t, size_t>> blocks; // (row block, first word)
+    for (size_t r = 0; r < result_words; ++r) {
+        const size_t w0 = lower ? 0 : r, w1 = lower ? r + 1 : result_words;
+        for (size_t w = w0; w < w1; w = (w / word_block + 1) * word_block) {
+            blocks.emplace_back(r, w);
+        }
+    }
+
+    GF2Workspace ws;
+    const SimdKernel& kernel = simd_kernel();
+    const PreparedB b_t = prepare_b_t(kernel, *this, m_data.data(), m_row_stride, m_row_stride,
+                                      m_rows, ws);
+    const SimdBlockKernel block = kernel.block;
+    const long long count = static_cast<long long>(blocks.size());
+    uint64_t* c = result.m_data.data();
+    {
+        GF2_TRACE_SCOPE("simd: multiply");
+        #pragma omp parallel for schedule(static) num_threads(resolve_threads(num_threads))
+        for (long long x = 0; x < count; ++x) {
+            const size_t r = blocks[size_t(x)].first, w = blocks[size_t(x)].second;
+            const size_t w1 = lower ? r + 1 : result_words;
+            block(m_data.data(), m_row_stride, b_t.data, b_t.stride, c, result.m_row_stride,
+                  m_rows, r * 64, std::min(r * 64 + 64, m_rows), w,
+                  std::min(w1, (w / word_block + 1) * word_block), 0, b_t.k_words, false);
+        }
+    }
+
+    for (size_t i = 0; i < m_rows; ++i) {
+        const uint64_t diagonal = uint64_t(1) << (i % 64);
+        c[i * result.m_row_stride + i / 64] &= lower ? (diagonal << 1) - 1 : ~(diagonal - 1);
+    }
+    if (mirror) {
+        result.mirrorTriangle(triangle, num_threads);
+    }
+    return result;
+}
+
+GF2TileConfig GF2TileConfig::resolve() const {
+    const GF2CpuInfo& cpu = GF2CpuInfo::get();
+    GF2TileConfig t = *this;
+
+    if (t.rows == 0) t.rows = 16;
+    if (t.k_words == 0) {
+        t.k_words = std::max<size_t>(4, cpu.l1d_bytes / 2 / (t.rows * sizeof(uint64_t)));
+    }
+    if (t.words == 0) {
+        t.words = std::max<size_t>(1, cpu.l2_bytes / 2 / (t.k_words * 64 * sizeof(uint64_t)));
+    }
+    return t;
+}
+
+GF2Matrix GF2Matrix::multiplySIMDTiled(const GF2Matrix& other, const GF2TileConfig& tiles,
+                                       int num_threads) const {
+    check_operands(*this, other.m_rows);
+
+    GF2Workspace ws;
+    const SimdKernel& kernel = simd_kernel();
+    const PreparedB b_t = prepare_b(kernel, *this, other, ws);
+    return run_tiled(kernel, *this, b_t, other.m_cols, tiles, num_threads);
+}
+
+GF2Matrix GF2Matrix::multiplySIMDTiled(const GF2PackedOperand& other, const GF2TileConfig& tiles,
+                                       int num_threads) const {
+    check_operands(*this, other.rows());
+
+    const SimdKernel& kernel = simd_kernel();
+    return run_tiled(kernel, *this, prepared_b(kernel, *this, other), other.cols(), tiles,
+                     num_threads);
+}
@@ -1,56 +1,335 @@
-// Only compile this file for aarch64 architecture
+// Only compile this file for aarch64 architecture. Plain NEON (baseline
+// ARMv8-A) version, the fallback for cores without EOR3 such as Cortex-A53.
 #if defined(__aarch64__)
 
-#include "GF2Matrix.hpp"
+#include "GF2Kernels.hpp"
+#include "GF2Microkernel.hpp"
 #include <arm_neon.h>
-#include <vector>
-
-// This function is declared in GF2Matrix.cpp and called by multiplySIMD
-void multiply_simd_neon(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result) {
-    // Transposing the 'b' matrix is crucial for performance. It allows us to
-    // process both matrices row-by-row, which is ideal for SIMD memory access.
-    GF2Matrix b_transposed = b.transpose();
-
-    size_t a_rows = a.rows();
-    size_t b_cols = b.cols(); // This is equal to b_transposed.rows()
-    size_t common_dim_words = a.words_per_row();
-
-    const uint64_t* a_data = a.get_raw_data();
-    const uint64_t* b_t_data = b_transposed.get_raw_data();
-
-    for (size_t i = 0; i < a_rows; ++i) {
-        for (size_t j = 0; j < b_cols; ++j) {
-            const uint64_t* a_row_ptr = a_data + i * common_dim_words;
-            const uint64_t* b_t_row_ptr = b_t_data + j * common_dim_words;
-
-            // Use 128-bit NEON vectors, which can hold two 64-bit integers.
-            uint64x2_t acc = vdupq_n_u64(0);
-
-            // Process 2 words (128 bits) at a time.
-            size_t k = 0;
-            for (; k + 1 < common_dim_words; k += 2) {
-                uint64x2_t a_vec = vld1q_u64(a_row_ptr + k);
-                uint64x2_t b_vec = vld1q_u64(b_t_row_ptr + k);
-                
-                // Bitwise AND followed by a vector XOR.
-                uint64x2_t and_res = vandq_u64(a_vec, b_vec);
-                acc = veorq_u64(acc, and_res);
+#include <algorithm>
+#include <utility>
+
+// Number of rows of A and of columns (B^T rows) processed together by the
+// register-blocked microkernel
+static constexpr int MICROKERNEL_ROWS = 4;
+static constexpr int MICROKERNEL_COLS = 2;
+
+// The semiring addition on vectors
+template <GF2Semiring S>
+static inline uint64x2_t add(uint64x2_t x, uint64x2_t y) {
+    return S == GF2Semiring::XorAnd ? veorq_u64(x, y) : vorrq_u64(x, y);
+}
+
+// Reduces 64 accumulators to one word whose bit c is the parity of acc[bitrev(c)].
+// Each stage folds pairs of words into one: the low half of every 2s-bit group
+// keeps the folded bits of the first word, the high half those of the second.
+// The two 64-bit lanes are reduced independently and combined at the end.
+// The Boolean kernel folds with OR, making bit c whether acc[bitrev(c)] is
+// nonzero.
+template <GF2Semiring S>
+static inline uint64_t parity_tree(uint64x2_t* acc) {
+    size_t n = 64;
+    for (int stage = 0, s = 32; s >= 1; ++stage, s >>= 1, n >>= 1) {
+        const uint64x2_t mask = vdupq_n_u64(PARITY_TREE_MASKS[stage]);
+        const int64x2_t left = vdupq_n_s64(s);
+        const int64x2_t right = vdupq_n_s64(-s);
+        for (size_t t = 0; t < n / 2; ++t) {
+            uint64x2_t lo = add<S>(acc[2 * t], vshlq_u64(acc[2 * t], right));
+            uint64x2_t hi = add<S>(acc[2 * t + 1], vshlq_u64(acc[2 * t + 1], left));
+            acc[t] = vbslq_u64(mask, lo, hi);
+        }
+    }
+
+    return semiring_add<S>(vgetq_lane_u64(acc[0], 0), vgetq_lane_u64(acc[0], 1));
+}
+
+// ROWS x COLS dot products of A rows with B^T rows over k_words words. Each
+// B^T vector is loaded once for all ROWS rows and each A vector once for all
+// COLS columns.
+template <GF2Semiring S, int ROWS, int COLS>
+static inline void dot_neon(const uint64_t* const* a_rows, const uint64_t* const* b_rows,
+                            size_t k_words, uint64x2_t (*sum)[COLS]) {
+    for (int r = 0; r < ROWS; ++r) {
+        for (int c = 0; c < COLS; ++c) sum[r][c] = vdupq_n_u64(0);
+    }
+
+    // Process 2 words (128 bits) at a time.
+    size_t k = 0;
+    for (; k + 1 < k_words; k += 2) {
+        uint64x2_t b_vec[COLS];
+        for (int c = 0; c < COLS; ++c) b_vec[c] = vld1q_u64(b_rows[c] + k);
+        for (int r = 0; r < ROWS; ++r) {
+            uint64x2_t a_vec = vld1q_u64(a_rows[r] + k);
+            for (int c = 0; c < COLS; ++c) {
+                sum[r][c] = add<S>(sum[r][c], vandq_u64(a_vec, b_vec[c]));
+            }
+        }
+    }
+
+    // The last word, if the number of words is odd, goes into lane 0
+    if (k < k_words) {
+        for (int r = 0; r < ROWS; ++r) {
+            for (int c = 0; c < COLS; ++c) {
+                uint64_t t = a_rows[r][k] & b_rows[c][k];
+                sum[r][c] = add<S>(sum[r][c], vcombine_u64(vcreate_u64(t), vcreate_u64(0)));
+            }
+        }
+    }
+}
+
+// Computes the full result words [jw0, jw1) of ROWS consecutive rows starting
+// at row i, over the common-dimension words [k0, k1), MICROKERNEL_COLS columns
+// per pass. The AND/XOR partial sums stay in vector accumulators and are only
+// reduced once per output word by the parity tree. Parities over disjoint k
+// ranges XOR together, so with 'accumulate' the words are XORed into the
+// result instead of stored.
+template <GF2Semiring S, int ROWS>
+static void microkernel_neon(const uint64_t* a, size_t a_stride,
+                             const uint64_t* b_t, size_t b_t_stride,
+                             uint64_t* c, size_t c_stride, size_t b_cols,
+                             size_t i, size_t jw0, size_t jw1,
+                             size_t k0, size_t k1, bool accumulate) {
+    uint64x2_t acc[ROWS][64];
+    const size_t k_words = k1 - k0;
+
+    const uint64_t* a_rows[ROWS];
+    for (int r = 0; r < ROWS; ++r) {
+        a_rows[r] = a + (i + r) * a_stride + k0;
+    }
+
+    for (size_t jw = jw0; jw < jw1; ++jw) {
+        const size_t cols = std::min<size_t>(64, b_cols - jw * 64);
+
+        for (size_t col = 0; col < 64; col += MICROKERNEL_COLS) {
+            uint64x2_t sum[ROWS][MICROKERNEL_COLS];
+            const uint64_t* b_rows[MICROKERNEL_COLS];
+            for (int n = 0; n < MICROKERNEL_COLS; ++n) {
+                b_rows[n] = b_t + (jw * 64 + col + n) * b_t_stride + k0;
             }
 
-            // Horizontally XOR the two 64-bit lanes of the accumulator vector.
-            uint64_t temp_res = vgetq_lane_u64(acc, 0) ^ vgetq_lane_u64(acc, 1);
+            if (col + MICROKERNEL_COLS <= cols) {
+                dot_neon<S, ROWS, MICROKERNEL_COLS>(a_rows, b_rows, k_words, sum);
+            } else {
+                // Last, partial group of columns
+                for (int n = 0; n < MICROKERNEL_COLS; ++n) {
+                    uint64x2_t one[ROWS][1];
+                    if (col + n < cols) {
+                        dot_neon<S, ROWS, 1>(a_rows, b_rows + n, k_words, one);
+                    } else {
+                        for (int r = 0; r < ROWS; ++r) one[r][0] = vdupq_n_u64(0);
+                    }
+                    for (int r = 0; r < ROWS; ++r) sum[r][n] = one[r][0];
+                }
+            }
 
-            // Handle the last word if the number of words is odd.
-            if (k < common_dim_words) {
-                temp_res ^= (a_row_ptr[k] & b_t_row_ptr[k]);
+            for (int r = 0; r < ROWS; ++r) {
+                for (int n = 0; n < MICROKERNEL_COLS; ++n) {
+                    acc[r][PARITY_TREE_SLOT[col + n]] = sum[r][n];
+                }
             }
+        }
 
-            // The final result bit is the parity of the total number of set bits.
-            // __builtin_popcountll is a highly optimized compiler intrinsic for this.
-            result.set(i, j, __builtin_popcountll(temp_res) % 2);
+        // One store per 64 output bits
+        for (int r = 0; r < ROWS; ++r) {
+            uint64_t word = parity_tree<S>(acc[r]);
+            uint64_t& out = c[(i + r) * c_stride + jw];
+            out = accumulate ? semiring_add<S>(out, word) : word;
         }
     }
 }
 
-#endif // defined(__aarch64__)
+template <GF2Semiring S>
+static void block_neon(const uint64_t* a, size_t a_stride,
+                       const uint64_t* b_t, size_t b_t_stride,
+                       uint64_t* c, size_t c_stride, size_t b_cols,
+                       size_t i0, size_t i1, size_t jw0, size_t jw1,
+                       size_t k0, size_t k1, bool accumulate) {
+    size_t i = i0;
+    for (; i + MICROKERNEL_ROWS <= i1; i += MICROKERNEL_ROWS) {
+        microkernel_neon<S, MICROKERNEL_ROWS>(a, a_stride, b_t, b_t_stride, c, c_stride, b_cols,
+                                              i, jw0, jw1, k0, k1, accumulate);
+    }
+    for (; i < i1; ++i) {
+        microkernel_neon<S, 1>(a, a_stride, b_t, b_t_stride, c, c_stride, b_cols,
+                               i, jw0, jw1, k0, k1, accumulate);
+    }
+}
+
+void simd_block_neon(const uint64_t* a, size_t a_stride,
+                     const uint64_t* b_t, size_t b_t_stride,
+                     uint64_t* c, size_t c_stride, size_t b_cols,
+                     size_t i0, size_t i1, size_t jw0, size_t jw1,
+                     size_t k0, size_t k1, bool accumulate) {
+    block_neon<GF2Semiring::XorAnd>(a, a_stride, b_t, b_t_stride, c, c_stride, b_cols,
+                                    i0, i1, jw0, jw1, k0, k1, accumulate);
+}
+
+void simd_block_neon_or(const uint64_t* a, size_t a_stride,
+                        const uint64_t* b_t, size_t b_t_stride,
+                        uint64_t* c, size_t c_stride, size_t b_cols,
+                        size_t i0, size_t i1, size_t jw0, size_t jw1,
+                        size_t k0, size_t k1, bool accumulate) {
+    block_neon<GF2Semiring::OrAnd>(a, a_stride, b_t, b_t_stride, c, c_stride, b_cols,
+                                   i0, i1, jw0, jw1, k0, k1, accumulate);
+}
+
+// --- Register-tile kernels ---
+
+namespace {
+
+struct NeonTile {
+    using Reg = uint64x2_t;
+    static constexpr size_t WORDS = 2;
+    static Reg zero() { return vdupq_n_u64(0); }
+    static Reg load(const uint64_t* p) { return vld1q_u64(p); }
+    static Reg lane0(uint64_t x) { return vcombine_u64(vcreate_u64(x), vcreate_u64(0)); }
+    template <GF2Semiring S>
+    static Reg add(Reg x, Reg y) { return ::add<S>(x, y); }
+    template <GF2Semiring S>
+    static Reg add_and(Reg acc, Reg a, Reg b) { return ::add<S>(acc, vandq_u64(a, b)); }
+    template <GF2Semiring S>
+    static uint64_t reduce(Reg* acc) { return parity_tree<S>(acc); }
+};
+
+} // namespace
+
+std::vector<SimdKernel> simd_tiles_neon() {
+    return GF2_TILE_KERNELS(NeonTile, "neon");
+}
 
+// --- Row kernels ---
+
+void row_xor_neon(uint64_t* dst, const uint64_t* src, size_t words) {
+    size_t w = 0;
+    for (; w + 2 <= words; w += 2) {
+        vst1q_u64(dst + w, veorq_u64(vld1q_u64(dst + w), vld1q_u64(src + w)));
+    }
+    for (; w < words; ++w) dst[w] ^= src[w];
+}
+
+void row_xor_masked_neon(uint64_t* dst, const uint64_t* src, const uint64_t* mask,
+                         size_t words) {
+    size_t w = 0;
+    for (; w + 2 <= words; w += 2) {
+        const uint64x2_t x = vandq_u64(vld1q_u64(src + w), vld1q_u64(mask + w));
+        vst1q_u64(dst + w, veorq_u64(vld1q_u64(dst + w), x));
+    }
+    for (; w < words; ++w) dst[w] ^= src[w] & mask[w];
+}
+
+void row_swap_neon(uint64_t* a, uint64_t* b, size_t words) {
+    size_t w = 0;
+    for (; w + 2 <= words; w += 2) {
+        const uint64x2_t x = vld1q_u64(a + w);
+        vst1q_u64(a + w, vld1q_u64(b + w));
+        vst1q_u64(b + w, x);
+    }
+    for (; w < words; ++w) std::swap(a[w], b[w]);
+}
+
+// CNT per byte, widened pairwise into the two 64-bit lanes
+size_t row_weight_neon(const uint64_t* row, size_t words) {
+    uint64x2_t total = vdupq_n_u64(0);
+    size_t w = 0;
+    for (; w + 2 <= words; w += 2) {
+        const uint8x16_t bytes = vcntq_u8(vreinterpretq_u8_u64(vld1q_u64(row + w)));
+        total = vaddq_u64(total, vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(bytes))));
+    }
+    size_t weight = size_t(vgetq_lane_u64(total, 0) + vgetq_lane_u64(total, 1));
+    for (; w < words; ++w) weight += size_t(__builtin_popcountll(row[w]));
+    return weight;
+}
+
+size_t row_first_nonzero_neon(const uint64_t* row, size_t words) {
+    size_t w = 0;
+    for (; w + 2 <= words; w += 2) {
+        const uint64x2_t v = vld1q_u64(row + w);
+        if ((vgetq_lane_u64(v, 0) | vgetq_lane_u64(v, 1)) != 0) break;
+    }
+    while (w < words && row[w] == 0) ++w;
+    return w;
+}
+
+// Lanes in pairs: the products by VMLAL of the narrowed halves, the swap of
+// lanes i and i ^ 1 by VEXT
+void hash_stripes_neon(uint64_t* acc, const uint64_t* data, size_t stripes, size_t stripe0) {
+    const uint64_t* secret = HASH_SECRET.words;
+    const uint32x2_t prime = vdup_n_u32(uint32_t(HASH_PRIME32));
+    uint64x2_t lanes[4];
+    for (int j = 0; j < 4; ++j) lanes[j] = vld1q_u64(acc + 2 * j);
+    size_t s = stripe0 % HASH_BLOCK_STRIPES;
+    for (size_t t = 0; t < stripes; ++t, data += HASH_STRIPE_WORDS) {
+        for (int j = 0; j < 4; ++j) {
+            const uint64x2_t d = vld1q_u64(data + 2 * j);
+            const uint64x2_t k = veorq_u64(d, vld1q_u64(secret + s + 2 * j));
+            lanes[j] = vaddq_u64(lanes[j], vextq_u64(d, d, 1));
+            lanes[j] = vmlal_u32(lanes[j], vmovn_u64(k), vshrn_n_u64(k, 32));
+        }
+        if (++s == HASH_BLOCK_STRIPES) {
+            s = 0;
+            for (int j = 0; j < 4; ++j) {
+                const uint64x2_t x =
+                    veorq_u64(veorq_u64(lanes[j], vshrq_n_u64(lanes[j], 47)),
+                              vld1q_u64(secret + HASH_BLOCK_STRIPES + 2 * j));
+                const uint64x2_t hi = vmull_u32(vshrn_n_u64(x, 32), prime);
+                lanes[j] = vaddq_u64(vmull_u32(vmovn_u64(x), prime), vshlq_n_u64(hi, 32));
+            }
+        }
+    }
+    for (int j = 0; j < 4; ++j) vst1q_u64(acc + 2 * j, lanes[j]);
+}
+
+
+// --- Byte packing ---
+
+// VTST makes a nonzero byte all ones; keeping bit j % 8 of byte j and three
+// rounds of pairwise adds leave the eight bytes of the word
+void pack_bytes_neon(uint64_t* dst, const uint8_t* src, size_t words) {
+    static const uint8_t BITS[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t bit = vld1q_u8(BITS);
+    for (size_t w = 0; w < words; ++w, src += 64) {
+        uint8x16_t m[4];
+        for (int j = 0; j < 4; ++j) {
+            const uint8x16_t x = vld1q_u8(src + 16 * j);
+            m[j] = vandq_u8(vtstq_u8(x, x), bit);
+        }
+        const uint8x16_t sum = vpaddq_u8(vpaddq_u8(m[0], m[1]), vpaddq_u8(m[2], m[3]));
+        dst[w] = vgetq_lane_u64(vreinterpretq_u64_u8(vpaddq_u8(sum, sum)), 0);
+    }
+}
+
+// Two bytes of the word at a time, each copied to eight lanes that keep
+// bit j % 8 and become one where it is set
+void unpack_bytes_neon(uint8_t* dst, const uint64_t* src, size_t words) {
+    static const uint8_t BITS[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t bit = vld1q_u8(BITS);
+    for (size_t w = 0; w < words; ++w, dst += 64) {
+        for (int j = 0; j < 4; ++j) {
+            const uint8x16_t x = vcombine_u8(vdup_n_u8(uint8_t(src[w] >> (16 * j))),
+                                             vdup_n_u8(uint8_t(src[w] >> (16 * j + 8))));
+            vst1q_u8(dst + 16 * j, vshrq_n_u8(vtstq_u8(x, bit), 7));
+        }
+    }
+}
+
+void reverse_bits_neon(uint8_t* dst, const uint8_t* src, size_t bytes) {
+    size_t i = 0;
+    for (; i + 16 <= bytes; i += 16) {
+        vst1q_u8(dst + i, vrbitq_u8(vld1q_u8(src + i)));
+    }
+    reverse_bits_scalar(dst + i, src + i, bytes - i);
+}
+
+// 16 bytes per pair of TBLs
+void lookup_nibbles_neon(uint8_t* dst, const uint8_t* src, const uint8_t* table, size_t bytes) {
+    const uint8x16_t t_lo = vld1q_u8(table), t_hi = vld1q_u8(table + 16);
+    const uint8x16_t nibble = vdupq_n_u8(0x0F);
+    size_t i = 0;
+    for (; i + 16 <= bytes; i += 16) {
+        const uint8x16_t x = vld1q_u8(src + i);
+        vst1q_u8(dst + i, veorq_u8(vqtbl1q_u8(t_lo, vandq_u8(x, nibble)),
+                                   vqtbl1q_u8(t_hi, vshrq_n_u8(x, 4))));
+    }
+    lookup_nibbles_scalar(dst + i, src + i, table, bytes - i);
+}
+
+#endif // defined(__aarch64__)
@@ -0,0 +1,158 @@
+// Only compile this file for aarch64 architecture. It is built with
+// -march=armv8.2-a+sha3 and only called after the runtime dispatch has
+// confirmed the SHA3 extension (EOR3), e.g. on Apple M-series and Neoverse.
+#if defined(__aarch64__)
+
+#include "GF2Kernels.hpp"
+#include <arm_neon.h>
+#include <algorithm>
+
+// Number of rows of A and of columns (B^T rows) processed together by the
+// register-blocked microkernel
+static constexpr int MICROKERNEL_ROWS = 4;
+static constexpr int MICROKERNEL_COLS = 2;
+
+// Same parity fold tree as the plain NEON kernel
+static inline uint64_t parity_tree(uint64x2_t* acc) {
+    size_t n = 64;
+    for (int stage = 0, s = 32; s >= 1; ++stage, s >>= 1, n >>= 1) {
+        const uint64x2_t mask = vdupq_n_u64(PARITY_TREE_MASKS[stage]);
+        const int64x2_t left = vdupq_n_s64(s);
+        const int64x2_t right = vdupq_n_s64(-s);
+        for (size_t t = 0; t < n / 2; ++t) {
+            uint64x2_t lo = veorq_u64(acc[2 * t], vshlq_u64(acc[2 * t], right));
+            uint64x2_t hi = veorq_u64(acc[2 * t + 1], vshlq_u64(acc[2 * t + 1], left));
+            acc[t] = vbslq_u64(mask, lo, hi);
+        }
+    }
+
+    return vgetq_lane_u64(acc[0], 0) ^ vgetq_lane_u64(acc[0], 1);
+}
+
+// ROWS x COLS dot products of A rows with B^T rows over k_words words. Each
+// B^T vector is loaded once for all ROWS rows and each A vector once for all
+// COLS columns. EOR3 folds two AND products into the sum per instruction.
+template <int ROWS, int COLS>
+static inline void dot_eor3(const uint64_t* const* a_rows, const uint64_t* const* b_rows,
+                            size_t k_words, uint64x2_t (*sum)[COLS]) {
+    for (int r = 0; r < ROWS; ++r) {
+        for (int c = 0; c < COLS; ++c) sum[r][c] = vdupq_n_u64(0);
+    }
+
+    // Process 4 words (two 128-bit vectors) per EOR3
+    size_t k = 0;
+    for (; k + 3 < k_words; k += 4) {
+        uint64x2_t b_lo[COLS], b_hi[COLS];
+        for (int c = 0; c < COLS; ++c) {
+            b_lo[c] = vld1q_u64(b_rows[c] + k);
+            b_hi[c] = vld1q_u64(b_rows[c] + k + 2);
+        }
+        for (int r = 0; r < ROWS; ++r) {
+            uint64x2_t a_lo = vld1q_u64(a_rows[r] + k);
+            uint64x2_t a_hi = vld1q_u64(a_rows[r] + k + 2);
+            for (int c = 0; c < COLS; ++c) {
+                sum[r][c] = veor3q_u64(sum[r][c], vandq_u64(a_lo, b_lo[c]), vandq_u64(a_hi, b_hi[c]));
+            }
+        }
+    }
+
+    for (; k + 1 < k_words; k += 2) {
+        uint64x2_t b_vec[COLS];
+        for (int c = 0; c < COLS; ++c) b_vec[c] = vld1q_u64(b_rows[c] + k);
+        for (int r = 0; r < ROWS; ++r) {
+            uint64x2_t a_vec = vld1q_u64(a_rows[r] + k);
+            for (int c = 0; c < COLS; ++c) {
+                sum[r][c] = veorq_u64(sum[r][c], vandq_u64(a_vec, b_vec[c]));
+            }
+        }
+    }
+
+    // The last word, if the number of words is odd, goes into lane 0
+    if (k < k_words) {
+        for (int r = 0; r < ROWS; ++r) {
+            for (int c = 0; c < COLS; ++c) {
+                uint64_t t = a_rows[r][k] & b_rows[c][k];
+                sum[r][c] = veorq_u64(sum[r][c], vcombine_u64(vcreate_u64(t), vcreate_u64(0)));
+            }
+        }
+    }
+}
+
+// Computes the full result words [jw0, jw1) of ROWS consecutive rows starting
+// at row i, over the common-dimension words [k0, k1), MICROKERNEL_COLS columns
+// per pass. The AND/XOR partial sums stay in vector accumulators and are only
+// reduced once per output word by the parity tree. Parities over disjoint k
+// ranges XOR together, so with 'accumulate' the words are XORed into the
+// result instead of stored.
+template <int ROWS>
+static void microkernel_eor3(const uint64_t* a, size_t a_stride,
+                             const uint64_t* b_t, size_t b_t_stride,
+                             uint64_t* c, size_t c_stride, size_t b_cols,
+                             size_t i, size_t jw0, size_t jw1,
+                             size_t k0, size_t k1, bool accumulate) {
+    uint64x2_t acc[ROWS][64];
+    const size_t k_words = k1 - k0;
+
+    const uint64_t* a_rows[ROWS];
+    for (int r = 0; r < ROWS; ++r) {
+        a_rows[r] = a + (i + r) * a_stride + k0;
+    }
+
+    for (size_t jw = jw0; jw < jw1; ++jw) {
+        const size_t cols = std::min<size_t>(64, b_cols - jw * 64);
+
+        for (size_t col = 0; col < 64; col += MICROKERNEL_COLS) {
+            uint64x2_t sum[ROWS][MICROKERNEL_COLS];
+            const uint64_t* b_rows[MICROKERNEL_COLS];
+            for (int n = 0; n < MICROKERNEL_COLS; ++n) {
+                b_rows[n] = b_t + (jw * 64 + col + n) * b_t_stride + k0;
+            }
+
+            if (col + MICROKERNEL_COLS <= cols) {
+                dot_eor3<ROWS, MICROKERNEL_COLS>(a_rows, b_rows, k_words, sum);
+            } else {
+                // Last, partial group of columns
+                for (int n = 0; n < MICROKERNEL_COLS; ++n) {
+                    uint64x2_t one[ROWS][1];
+                    if (col + n < cols) {
+                        dot_eor3<ROWS, 1>(a_rows, b_rows + n, k_words, one);
+                    } else {
+                        for (int r = 0; r < ROWS; ++r) one[r][0] = vdupq_n_u64(0);
+                    }
+                    for (int r = 0; r < ROWS; ++r) sum[r][n] = one[r][0];
+                }
+            }
+
+            for (int r = 0; r < ROWS; ++r) {
+                for (int n = 0; n < MICROKERNEL_COLS; ++n) {
+                    acc[r][PARITY_TREE_SLOT[col + n]] = sum[r][n];
+                }
+            }
+        }
+
+        // One store per 64 output bits
+        for (int r = 0; r < ROWS; ++r) {
+            uint64_t word = parity_tree(acc[r]);
+            uint64_t& out = c[(i + r) * c_stride + jw];
+            out = accumulate ? (out ^ word) : word;
+        }
+    }
+}
+
+void simd_block_neon_eor3(const uint64_t* a, size_t a_stride,
+                          const uint64_t* b_t, size_t b_t_stride,
+                          uint64_t* c, size_t c_stride, size_t b_cols,
+                          size_t i0, size_t i1, size_t jw0, size_t jw1,
+                          size_t k0, size_t k1, bool accumulate) {
+    size_t i = i0;
+    for (; i + MICROKERNEL_ROWS <= i1; i += MICROKERNEL_ROWS) {
+        microkernel_eor3<MICROKERNEL_ROWS>(a, a_stride, b_t, b_t_stride, c, c_stride, b_cols,
+                                           i, jw0, jw1, k0, k1, accumulate);
+    }
+    for (; i < i1; ++i) {
+        microkernel_eor3<1>(a, a_stride, b_t, b_t_stride, c, c_stride, b_cols,
+                            i, jw0, jw1, k0, k1, accumulate);
+    }
+}
+
+#endif // defined(__aarch64__)
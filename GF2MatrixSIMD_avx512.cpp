@@ -0,0 +1,312 @@
+// Only compile this file for x86_64 architecture. It is built with
+// -mavx512f and only called after the runtime dispatch has confirmed
+// AVX-512F support (including OS support for the ZMM state).
+#if defined(__x86_64__) || defined(_M_X64)
+
+#include "GF2Kernels.hpp"
+#include "GF2Microkernel.hpp"
+
+// GCC 12 warns about the _mm512_undefined_* placeholders inside its own
+// AVX-512 intrinsics headers (a known false positive)
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include <immintrin.h>
+#include <algorithm>
+
+// Number of rows of A processed together by the register-blocked microkernel
+static constexpr int MICROKERNEL_ROWS = 4;
+
+// VPTERNLOGQ truth tables (operands a = 0xF0, b = 0xCC, c = 0xAA)
+static constexpr int TERNLOG_A_XOR_B_AND_C = 0x78; // a ^ (b & c)
+static constexpr int TERNLOG_A_OR_B_AND_C = 0xF8;  // a | (b & c)
+static constexpr int TERNLOG_SELECT = 0xCA;        // a ? b : c
+
+// The semiring addition on vectors, and acc + (a & b) in one VPTERNLOGQ
+template <GF2Semiring S>
+static inline __m512i add(__m512i x, __m512i y) {
+    return S == GF2Semiring::XorAnd ? _mm512_xor_si512(x, y) : _mm512_or_si512(x, y);
+}
+
+template <GF2Semiring S>
+static inline __m512i add_and(__m512i acc, __m512i a, __m512i b) {
+    return _mm512_ternarylogic_epi64(
+        acc, a, b, S == GF2Semiring::XorAnd ? TERNLOG_A_XOR_B_AND_C : TERNLOG_A_OR_B_AND_C);
+}
+
+// Same fold as the AVX2 parity tree, with the blend done by one VPTERNLOGQ
+// and eight independent 64-bit lanes combined at the end (an OR tree for
+// the Boolean kernel).
+template <GF2Semiring S>
+static inline uint64_t parity_tree(__m512i* acc) {
+    size_t n = 64;
+    for (int stage = 0, s = 32; s >= 1; ++stage, s >>= 1, n >>= 1) {
+        const __m512i mask = _mm512_set1_epi64(static_cast<long long>(PARITY_TREE_MASKS[stage]));
+        const __m128i shift = _mm_cvtsi32_si128(s);
+        for (size_t t = 0; t < n / 2; ++t) {
+            __m512i lo = add<S>(acc[2 * t], _mm512_srl_epi64(acc[2 * t], shift));
+            __m512i hi = add<S>(acc[2 * t + 1], _mm512_sll_epi64(acc[2 * t + 1], shift));
+            acc[t] = _mm512_ternarylogic_epi64(mask, lo, hi, TERNLOG_SELECT);
+        }
+    }
+
+    const __m256i y0 = _mm512_castsi512_si256(acc[0]), y1 = _mm512_extracti64x4_epi64(acc[0], 1);
+    __m256i y = S == GF2Semiring::XorAnd ? _mm256_xor_si256(y0, y1) : _mm256_or_si256(y0, y1);
+    const __m128i x0 = _mm256_castsi256_si128(y), x1 = _mm256_extracti128_si256(y, 1);
+    __m128i x = S == GF2Semiring::XorAnd ? _mm_xor_si128(x0, x1) : _mm_or_si128(x0, x1);
+    return semiring_add<S>(static_cast<uint64_t>(_mm_cvtsi128_si64(x)),
+                           static_cast<uint64_t>(_mm_extract_epi64(x, 1)));
+}
+
+// AVX-512 version of the register-blocked microkernel. Each step folds
+// acc ^= a & b into a single VPTERNLOGQ, and the tail of the common dimension
+// is read with a masked load instead of a scalar loop.
+template <GF2Semiring S, int ROWS>
+static void microkernel_avx512(const uint64_t* a, size_t a_stride,
+                               const uint64_t* b_t, size_t b_t_stride,
+                               uint64_t* c, size_t c_stride, size_t b_cols,
+                               size_t i, size_t jw0, size_t jw1,
+                               size_t k0, size_t k1, bool accumulate) {
+    alignas(64) __m512i acc[ROWS][64];
+    const size_t k_words = k1 - k0;
+    const __mmask8 tail_mask = static_cast<__mmask8>((1u << (k_words % 8)) - 1);
+
+    const uint64_t* a_rows[ROWS];
+    for (int r = 0; r < ROWS; ++r) {
+        a_rows[r] = a + (i + r) * a_stride + k0;
+    }
+
+    for (size_t jw = jw0; jw < jw1; ++jw) {
+        const size_t cols = std::min<size_t>(64, b_cols - jw * 64);
+
+        for (size_t col = 0; col < 64; ++col) {
+            __m512i sum[ROWS];
+            for (int r = 0; r < ROWS; ++r) sum[r] = _mm512_setzero_si512();
+
+            if (col < cols) {
+                const uint64_t* b_t_row_ptr = b_t + (jw * 64 + col) * b_t_stride + k0;
+
+                size_t k = 0;
+                for (; k + 7 < k_words; k += 8) {
+                    __m512i b_vec = _mm512_loadu_si512(b_t_row_ptr + k);
+                    for (int r = 0; r < ROWS; ++r) {
+                        __m512i a_vec = _mm512_loadu_si512(a_rows[r] + k);
+                        sum[r] = add_and<S>(sum[r], a_vec, b_vec);
+                    }
+                }
+
+                if (tail_mask) {
+                    __m512i b_vec = _mm512_maskz_loadu_epi64(tail_mask, b_t_row_ptr + k);
+                    for (int r = 0; r < ROWS; ++r) {
+                        __m512i a_vec = _mm512_maskz_loadu_epi64(tail_mask, a_rows[r] + k);
+                        sum[r] = add_and<S>(sum[r], a_vec, b_vec);
+                    }
+                }
+            }
+
+            for (int r = 0; r < ROWS; ++r) acc[r][PARITY_TREE_SLOT[col]] = sum[r];
+        }
+
+        // One store per 64 output bits
+        for (int r = 0; r < ROWS; ++r) {
+            uint64_t word = parity_tree<S>(acc[r]);
+            uint64_t& out = c[(i + r) * c_stride + jw];
+            out = accumulate ? semiring_add<S>(out, word) : word;
+        }
+    }
+}
+
+template <GF2Semiring S>
+static void block_avx512(const uint64_t* a, size_t a_stride,
+                         const uint64_t* b_t, size_t b_t_stride,
+                         uint64_t* c, size_t c_stride, size_t b_cols,
+                         size_t i0, size_t i1, size_t jw0, size_t jw1,
+                         size_t k0, size_t k1, bool accumulate) {
+    size_t i = i0;
+    for (; i + MICROKERNEL_ROWS <= i1; i += MICROKERNEL_ROWS) {
+        microkernel_avx512<S, MICROKERNEL_ROWS>(a, a_stride, b_t, b_t_stride, c, c_stride, b_cols,
+                                                i, jw0, jw1, k0, k1, accumulate);
+    }
+    for (; i < i1; ++i) {
+        microkernel_avx512<S, 1>(a, a_stride, b_t, b_t_stride, c, c_stride, b_cols,
+                                 i, jw0, jw1, k0, k1, accumulate);
+    }
+}
+
+void simd_block_avx512(const uint64_t* a, size_t a_stride,
+                       const uint64_t* b_t, size_t b_t_stride,
+                       uint64_t* c, size_t c_stride, size_t b_cols,
+                       size_t i0, size_t i1, size_t jw0, size_t jw1,
+                       size_t k0, size_t k1, bool accumulate) {
+    block_avx512<GF2Semiring::XorAnd>(a, a_stride, b_t, b_t_stride, c, c_stride, b_cols,
+                                      i0, i1, jw0, jw1, k0, k1, accumulate);
+}
+
+void simd_block_avx512_or(const uint64_t* a, size_t a_stride,
+                          const uint64_t* b_t, size_t b_t_stride,
+                          uint64_t* c, size_t c_stride, size_t b_cols,
+                          size_t i0, size_t i1, size_t jw0, size_t jw1,
+                          size_t k0, size_t k1, bool accumulate) {
+    block_avx512<GF2Semiring::OrAnd>(a, a_stride, b_t, b_t_stride, c, c_stride, b_cols,
+                                     i0, i1, jw0, jw1, k0, k1, accumulate);
+}
+
+// Rows of a group of products computed together, sharing each load of B
+static constexpr int BATCH_ROWS = 8;
+
+// Row r of each product is the XOR of the rows k of B whose bit k is set in
+// row r of A: one VPTESTMQ gives the lanes with the bit, and a masked XOR
+// adds row k of B in just those lanes.
+void batch_multiply_avx512(const uint64_t* a, const uint64_t* b, uint64_t* c, size_t groups) {
+    for (size_t g = 0; g < groups; ++g) {
+        const uint64_t* ag = a + g * BATCH_GROUP_WORDS;
+        const uint64_t* bg = b + g * BATCH_GROUP_WORDS;
+        uint64_t* cg = c + g * BATCH_GROUP_WORDS;
+        for (size_t r = 0; r < 64; r += BATCH_ROWS) {
+            __m512i a_rows[BATCH_ROWS], sum[BATCH_ROWS];
+            for (int i = 0; i < BATCH_ROWS; ++i) {
+                a_rows[i] = _mm512_load_si512(ag + (r + i) * BATCH_LANES);
+                sum[i] = _mm512_setzero_si512();
+            }
+            __m512i bit = _mm512_set1_epi64(1);
+            for (size_t k = 0; k < 64; ++k) {
+                const __m512i b_row = _mm512_load_si512(bg + k * BATCH_LANES);
+                for (int i = 0; i < BATCH_ROWS; ++i) {
+                    const __mmask8 lanes = _mm512_test_epi64_mask(a_rows[i], bit);
+                    sum[i] = _mm512_mask_xor_epi64(sum[i], lanes, sum[i], b_row);
+                }
+                bit = _mm512_add_epi64(bit, bit);
+            }
+            for (int i = 0; i < BATCH_ROWS; ++i) {
+                _mm512_store_si512(cg + (r + i) * BATCH_LANES, sum[i]);
+            }
+        }
+    }
+}
+
+// The butterfly of transpose_64x64 with a vector of eight matrices per row
+void batch_transpose_avx512(const uint64_t* src, uint64_t* dst, size_t groups) {
+    static const uint64_t masks[6] = {
+        0x00000000FFFFFFFFULL, 0x0000FFFF0000FFFFULL, 0x00FF00FF00FF00FFULL,
+        0x0F0F0F0F0F0F0F0FULL, 0x3333333333333333ULL, 0x5555555555555555ULL,
+    };
+    for (size_t g = 0; g < groups; ++g) {
+        __m512i x[64];
+        for (size_t r = 0; r < 64; ++r) {
+            x[r] = _mm512_load_si512(src + g * BATCH_GROUP_WORDS + r * BATCH_LANES);
+        }
+        size_t stage = 0;
+        for (unsigned j = 32; j >= 1; j >>= 1, ++stage) {
+            const __m512i mask = _mm512_set1_epi64(static_cast<long long>(masks[stage]));
+            const __m128i shift = _mm_cvtsi32_si128(static_cast<int>(j));
+            for (size_t k = 0; k < 64; k = (k + j + 1) & ~size_t(j)) {
+                const __m512i t = _mm512_and_si512(
+                    _mm512_xor_si512(_mm512_srl_epi64(x[k], shift), x[k + j]), mask);
+                x[k] = _mm512_xor_si512(x[k], _mm512_sll_epi64(t, shift));
+                x[k + j] = _mm512_xor_si512(x[k + j], t);
+            }
+        }
+        for (size_t r = 0; r < 64; ++r) {
+            _mm512_store_si512(dst + g * BATCH_GROUP_WORDS + r * BATCH_LANES, x[r]);
+        }
+    }
+}
+
+// --- Register-tile kernels ---
+
+namespace {
+
+// Each step is one VPTERNLOGQ, as in microkernel_avx512
+struct Avx512Tile {
+    using Reg = __m512i;
+    static constexpr size_t WORDS = 8;
+    static Reg zero() { return _mm512_setzero_si512(); }
+    static Reg load(const uint64_t* p) { return _mm512_loadu_si512(p); }
+    static Reg lane0(uint64_t x) {
+        return _mm512_maskz_set1_epi64(1, static_cast<long long>(x));
+    }
+    template <GF2Semiring S>
+    static Reg add(Reg x, Reg y) { return ::add<S>(x, y); }
+    template <GF2Semiring S>
+    static Reg add_and(Reg acc, Reg a, Reg b) { return ::add_and<S>(acc, a, b); }
+    template <GF2Semiring S>
+    static uint64_t reduce(Reg* acc) { return parity_tree<S>(acc); }
+};
+
+} // namespace
+
+std::vector<SimdKernel> simd_tiles_avx512() {
+    return GF2_TILE_KERNELS(Avx512Tile, "avx512");
+}
+
+// --- Row kernels ---
+
+// Eight words a step, the tail under a lane mask
+void row_xor_avx512(uint64_t* dst, const uint64_t* src, size_t words) {
+    for (size_t w = 0; w < words; w += 8) {
+        const __mmask8 lanes = words - w >= 8 ? __mmask8(0xFF) : __mmask8((1u << (words - w)) - 1);
+        const __m512i d = _mm512_maskz_loadu_epi64(lanes, dst + w);
+        const __m512i x = _mm512_maskz_loadu_epi64(lanes, src + w);
+        _mm512_mask_storeu_epi64(dst + w, lanes, _mm512_xor_si512(d, x));
+    }
+}
+
+void row_xor_masked_avx512(uint64_t* dst, const uint64_t* src, const uint64_t* mask,
+                           size_t words) {
+    for (size_t w = 0; w < words; w += 8) {
+        const __mmask8 lanes = words - w >= 8 ? __mmask8(0xFF) : __mmask8((1u << (words - w)) - 1);
+        const __m512i d = _mm512_maskz_loadu_epi64(lanes, dst + w);
+        const __m512i x = _mm512_maskz_loadu_epi64(lanes, src + w);
+        const __m512i m = _mm512_maskz_loadu_epi64(lanes, mask + w);
+        _mm512_mask_storeu_epi64(dst + w, lanes,
+                                 _mm512_ternarylogic_epi64(d, x, m, TERNLOG_A_XOR_B_AND_C));
+    }
+}
+
+void row_swap_avx512(uint64_t* a, uint64_t* b, size_t words) {
+    for (size_t w = 0; w < words; w += 8) {
+        const __mmask8 lanes = words - w >= 8 ? __mmask8(0xFF) : __mmask8((1u << (words - w)) - 1);
+        const __m512i x = _mm512_maskz_loadu_epi64(lanes, a + w);
+        const __m512i y = _mm512_maskz_loadu_epi64(lanes, b + w);
+        _mm512_mask_storeu_epi64(a + w, lanes, y);
+        _mm512_mask_storeu_epi64(b + w, lanes, x);
+    }
+}
+
+size_t row_first_nonzero_avx512(const uint64_t* row, size_t words) {
+    for (size_t w = 0; w < words; w += 8) {
+        const __mmask8 lanes = words - w >= 8 ? __mmask8(0xFF) : __mmask8((1u << (words - w)) - 1);
+        const __m512i v = _mm512_maskz_loadu_epi64(lanes, row + w);
+        const __mmask8 nonzero = _mm512_test_epi64_mask(v, v);
+        if (nonzero) {
+            return w + size_t(__builtin_ctz(nonzero));
+        }
+    }
+    return words;
+}
+
+// The eight lanes in one vector, as hash_stripes_avx2
+void hash_stripes_avx512(uint64_t* acc, const uint64_t* data, size_t stripes, size_t stripe0) {
+    const uint64_t* secret = HASH_SECRET.words;
+    const __m512i prime = _mm512_set1_epi64(int64_t(HASH_PRIME32));
+    const __m512i scramble_key = _mm512_loadu_si512(secret + HASH_BLOCK_STRIPES);
+    __m512i lanes = _mm512_loadu_si512(acc);
+    size_t s = stripe0 % HASH_BLOCK_STRIPES;
+    for (size_t t = 0; t < stripes; ++t, data += HASH_STRIPE_WORDS) {
+        const __m512i d = _mm512_loadu_si512(data);
+        const __m512i k = _mm512_xor_si512(d, _mm512_loadu_si512(secret + s));
+        lanes = _mm512_add_epi64(lanes, _mm512_shuffle_epi32(d, _MM_PERM_BADC));
+        lanes = _mm512_add_epi64(lanes, _mm512_mul_epu32(k, _mm512_srli_epi64(k, 32)));
+        if (++s == HASH_BLOCK_STRIPES) {
+            s = 0;
+            const __m512i x = _mm512_ternarylogic_epi64(lanes, _mm512_srli_epi64(lanes, 47),
+                                                        scramble_key, 0x96);
+            const __m512i lo = _mm512_mul_epu32(x, prime);
+            const __m512i hi = _mm512_mul_epu32(_mm512_srli_epi64(x, 32), prime);
+            lanes = _mm512_add_epi64(lo, _mm512_slli_epi64(hi, 32));
+        }
+    }
+    _mm512_storeu_si512(acc, lanes);
+}
+
+#endif // defined(__x86_64__) || defined(_M_X64)
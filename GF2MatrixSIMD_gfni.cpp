@@ -0,0 +1,177 @@
+// Only compile this file for x86_64 architecture. It is built with
+// -mavx512bw -mgfni and only called after the runtime dispatch has confirmed
+// GFNI and AVX-512BW support (the 512-bit GF2P8AFFINEQB form needs both).
+#if defined(__x86_64__) || defined(_M_X64)
+
+#include "GF2Kernels.hpp"
+
+// GCC 12 warns about the _mm512_undefined_* placeholders inside its own
+// AVX-512 intrinsics headers (a known false positive)
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include <immintrin.h>
+#include <algorithm>
+#include <vector>
+
+// GF2P8AFFINEQB computes, for every byte x of a 64-bit lane, the product
+// M * x of the lane's 8x8 bit matrix M with x, where output bit j is the
+// parity of (byte 7-j of M) & x. The kernel below uses it as an 8x8 block
+// multiply:
+//
+//   x    = bits [8K, 8K+8) of one row of A (eight rows per lane)
+//   M    = the 8x8 block of B^T for output columns [8J, 8J+8) and those bits
+//   M*x  = the contribution of that block to eight bits of the result row
+//
+// so one instruction does 8 rows x 64 columns x 8 bits of the product.
+
+// Rows of A per lane (one byte each)
+static constexpr size_t GFNI_ROWS = 8;
+
+// Register blocking: row groups of GFNI_ROWS and result words per pass
+static constexpr int GFNI_ROW_GROUPS = 2;
+static constexpr int GFNI_WORDS = 4;
+
+// 8x8 byte transpose of w[0..7]: byte b of w[r] becomes byte r of w[b].
+// Same butterfly as transpose_64x64, on bytes instead of bits.
+static inline void transpose_bytes_8x8(uint64_t* w) {
+    static const uint64_t masks[3] = {
+        0x00000000FFFFFFFFULL, 0x0000FFFF0000FFFFULL, 0x00FF00FF00FF00FFULL,
+    };
+    for (size_t stage = 0, j = 4; j >= 1; j >>= 1, ++stage) {
+        const unsigned shift = static_cast<unsigned>(8 * j);
+        for (size_t k = 0; k < 8; k = (k + j + 1) & ~j) {
+            uint64_t t = ((w[k] >> shift) ^ w[k + j]) & masks[stage];
+            w[k] ^= t << shift;
+            w[k + j] ^= t;
+        }
+    }
+}
+
+void simd_pack_gfni(const uint64_t* b_t, size_t b_t_stride, size_t b_cols,
+                    size_t k_words, uint64_t* packed) {
+    const size_t n_words = (b_cols + 63) / 64;
+
+    for (size_t jw = 0; jw < n_words; ++jw) {
+        for (size_t kw = 0; kw < k_words; ++kw) {
+            uint64_t* out = packed + (jw * k_words + kw) * 64;
+
+            // Lane l of the matrices for this word covers columns 8l..8l+7
+            for (size_t l = 0; l < 8; ++l) {
+                uint64_t w[8];
+                for (size_t b = 0; b < 8; ++b) {
+                    // Byte 7-j of the matrix is column j of the block
+                    size_t col = jw * 64 + 8 * l + (7 - b);
+                    w[b] = col < b_cols ? b_t[col * b_t_stride + kw] : 0;
+                }
+                transpose_bytes_8x8(w);
+                for (size_t byte = 0; byte < 8; ++byte) {
+                    out[byte * 8 + l] = w[byte];
+                }
+            }
+        }
+    }
+}
+
+// Computes GROUPS x GFNI_ROWS rows by WORDS result words. The A rows are
+// pre-transposed so that a_packed[(g * k_words + kw) * 8 + K] holds byte K of
+// word kw of the eight rows of group g.
+template <int GROUPS, int WORDS>
+static void microkernel_gfni(const uint64_t* a_packed, size_t k_words,
+                             const uint64_t* packed_b, size_t packed_b_stride,
+                             uint64_t* c, size_t c_stride, size_t i, size_t rows,
+                             size_t jw, size_t k0, bool accumulate) {
+    __m512i acc[GROUPS][WORDS];
+    for (int g = 0; g < GROUPS; ++g) {
+        for (int w = 0; w < WORDS; ++w) acc[g][w] = _mm512_setzero_si512();
+    }
+
+    for (size_t kw = 0; kw < k_words; ++kw) {
+        for (size_t byte = 0; byte < 8; ++byte) {
+            __m512i m[WORDS];
+            for (int w = 0; w < WORDS; ++w) {
+                m[w] = _mm512_loadu_si512(packed_b + (jw + w) * packed_b_stride + (k0 + kw) * 64 + byte * 8);
+            }
+            for (int g = 0; g < GROUPS; ++g) {
+                const __m512i x = _mm512_set1_epi64(
+                    static_cast<long long>(a_packed[(g * k_words + kw) * 8 + byte]));
+                for (int w = 0; w < WORDS; ++w) {
+                    acc[g][w] = _mm512_xor_si512(acc[g][w], _mm512_gf2p8affine_epi64_epi8(x, m[w], 0));
+                }
+            }
+        }
+    }
+
+    // Lane l, byte r of acc[g][w] is byte l of result word jw + w of row 8g + r
+    for (int g = 0; g < GROUPS; ++g) {
+        for (int w = 0; w < WORDS; ++w) {
+            alignas(64) uint64_t lanes[8];
+            _mm512_store_si512(lanes, acc[g][w]);
+            transpose_bytes_8x8(lanes);
+
+            for (size_t r = 0; r < GFNI_ROWS; ++r) {
+                size_t row = g * GFNI_ROWS + r;
+                if (row >= rows) break;
+                uint64_t& out = c[(i + row) * c_stride + jw + w];
+                out = accumulate ? (out ^ lanes[r]) : lanes[r];
+            }
+        }
+    }
+}
+
+template <int GROUPS>
+static void microkernel_gfni_row(const uint64_t* a_packed, size_t k_words,
+                                 const uint64_t* packed_b, size_t packed_b_stride,
+                                 uint64_t* c, size_t c_stride, size_t i, size_t rows,
+                                 size_t jw0, size_t jw1, size_t k0, bool accumulate) {
+    size_t jw = jw0;
+    for (; jw + GFNI_WORDS <= jw1; jw += GFNI_WORDS) {
+        microkernel_gfni<GROUPS, GFNI_WORDS>(a_packed, k_words, packed_b, packed_b_stride,
+                                             c, c_stride, i, rows, jw, k0, accumulate);
+    }
+    for (; jw < jw1; ++jw) {
+        microkernel_gfni<GROUPS, 1>(a_packed, k_words, packed_b, packed_b_stride,
+                                    c, c_stride, i, rows, jw, k0, accumulate);
+    }
+}
+
+void simd_block_gfni(const uint64_t* a, size_t a_stride,
+                     const uint64_t* b_t, size_t b_t_stride,
+                     uint64_t* c, size_t c_stride, size_t b_cols,
+                     size_t i0, size_t i1, size_t jw0, size_t jw1,
+                     size_t k0, size_t k1, bool accumulate) {
+    (void)b_cols; // columns past b_cols have all-zero matrices in the packed B
+    if (i0 >= i1 || jw0 >= jw1) return;
+
+    // Byte-transpose the block's rows of A once; it is reused for every word
+    const size_t k_words = k1 - k0;
+    const size_t groups = (i1 - i0 + GFNI_ROWS - 1) / GFNI_ROWS;
+    thread_local std::vector<uint64_t> a_packed;
+    a_packed.resize(groups * k_words * 8);
+
+    for (size_t g = 0; g < groups; ++g) {
+        for (size_t kw = 0; kw < k_words; ++kw) {
+            uint64_t* w = a_packed.data() + (g * k_words + kw) * 8;
+            for (size_t r = 0; r < GFNI_ROWS; ++r) {
+                size_t row = i0 + g * GFNI_ROWS + r;
+                w[r] = row < i1 ? a[row * a_stride + k0 + kw] : 0;
+            }
+            transpose_bytes_8x8(w);
+        }
+    }
+
+    const size_t step = GFNI_ROW_GROUPS * GFNI_ROWS;
+    size_t i = i0;
+    for (; i + step <= i1; i += step) {
+        const uint64_t* ap = a_packed.data() + ((i - i0) / GFNI_ROWS) * k_words * 8;
+        microkernel_gfni_row<GFNI_ROW_GROUPS>(ap, k_words, b_t, b_t_stride, c, c_stride,
+                                              i, step, jw0, jw1, k0, accumulate);
+    }
+    for (; i < i1; i += GFNI_ROWS) {
+        const uint64_t* ap = a_packed.data() + ((i - i0) / GFNI_ROWS) * k_words * 8;
+        microkernel_gfni_row<1>(ap, k_words, b_t, b_t_stride, c, c_stride,
+                                i, std::min(GFNI_ROWS, i1 - i), jw0, jw1, k0, accumulate);
+    }
+}
+
+#endif // defined(__x86_64__) || defined(_M_X64)
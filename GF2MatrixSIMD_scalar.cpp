@@ -0,0 +1,244 @@
+// Portable dot-product kernel, compiled with the baseline flags of the target.
+// It is the dispatch fallback on CPUs without any of the vector kernels and on
+// architectures that have none.
+
+#include "GF2Kernels.hpp"
+#include "GF2Microkernel.hpp"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+// Number of rows of A processed together by the register-blocked microkernel
+static constexpr int MICROKERNEL_ROWS = 4;
+
+// Scalar version of the parity fold tree used by the vector kernels. Folded
+// with OR instead of XOR, bit c is whether acc[bitrev(c)] is nonzero.
+template <GF2Semiring S>
+static inline uint64_t parity_tree(uint64_t* acc) {
+    size_t n = 64;
+    for (int stage = 0, s = 32; s >= 1; ++stage, s >>= 1, n >>= 1) {
+        const uint64_t mask = PARITY_TREE_MASKS[stage];
+        for (size_t t = 0; t < n / 2; ++t) {
+            uint64_t lo = semiring_add<S>(acc[2 * t], acc[2 * t] >> s);
+            uint64_t hi = semiring_add<S>(acc[2 * t + 1], acc[2 * t + 1] << s);
+            acc[t] = (mask & lo) | (~mask & hi);
+        }
+    }
+    return acc[0];
+}
+
+template <GF2Semiring S, int ROWS>
+static void microkernel_scalar(const uint64_t* a, size_t a_stride,
+                               const uint64_t* b_t, size_t b_t_stride,
+                               uint64_t* c, size_t c_stride, size_t b_cols,
+                               size_t i, size_t jw0, size_t jw1,
+                               size_t k0, size_t k1, bool accumulate) {
+    uint64_t acc[ROWS][64];
+    const size_t k_words = k1 - k0;
+
+    const uint64_t* a_rows[ROWS];
+    for (int r = 0; r < ROWS; ++r) {
+        a_rows[r] = a + (i + r) * a_stride + k0;
+    }
+
+    for (size_t jw = jw0; jw < jw1; ++jw) {
+        const size_t cols = std::min<size_t>(64, b_cols - jw * 64);
+
+        for (size_t col = 0; col < 64; ++col) {
+            uint64_t sum[ROWS] = {};
+
+            if (col < cols) {
+                const uint64_t* b_t_row_ptr = b_t + (jw * 64 + col) * b_t_stride + k0;
+                for (size_t k = 0; k < k_words; ++k) {
+                    for (int r = 0; r < ROWS; ++r) {
+                        sum[r] = semiring_add<S>(sum[r], a_rows[r][k] & b_t_row_ptr[k]);
+                    }
+                }
+            }
+
+            for (int r = 0; r < ROWS; ++r) acc[r][PARITY_TREE_SLOT[col]] = sum[r];
+        }
+
+        for (int r = 0; r < ROWS; ++r) {
+            uint64_t word = parity_tree<S>(acc[r]);
+            uint64_t& out = c[(i + r) * c_stride + jw];
+            out = accumulate ? semiring_add<S>(out, word) : word;
+        }
+    }
+}
+
+template <GF2Semiring S>
+static void block_scalar(const uint64_t* a, size_t a_stride,
+                         const uint64_t* b_t, size_t b_t_stride,
+                         uint64_t* c, size_t c_stride, size_t b_cols,
+                         size_t i0, size_t i1, size_t jw0, size_t jw1,
+                         size_t k0, size_t k1, bool accumulate) {
+    size_t i = i0;
+    for (; i + MICROKERNEL_ROWS <= i1; i += MICROKERNEL_ROWS) {
+        microkernel_scalar<S, MICROKERNEL_ROWS>(a, a_stride, b_t, b_t_stride, c, c_stride, b_cols,
+                                                i, jw0, jw1, k0, k1, accumulate);
+    }
+    for (; i < i1; ++i) {
+        microkernel_scalar<S, 1>(a, a_stride, b_t, b_t_stride, c, c_stride, b_cols,
+                                 i, jw0, jw1, k0, k1, accumulate);
+    }
+}
+
+void simd_block_scalar(const uint64_t* a, size_t a_stride,
+                       const uint64_t* b_t, size_t b_t_stride,
+                       uint64_t* c, size_t c_stride, size_t b_cols,
+                       size_t i0, size_t i1, size_t jw0, size_t jw1,
+                       size_t k0, size_t k1, bool accumulate) {
+    block_scalar<GF2Semiring::XorAnd>(a, a_stride, b_t, b_t_stride, c, c_stride, b_cols,
+                                      i0, i1, jw0, jw1, k0, k1, accumulate);
+}
+
+void simd_block_scalar_or(const uint64_t* a, size_t a_stride,
+                          const uint64_t* b_t, size_t b_t_stride,
+                          uint64_t* c, size_t c_stride, size_t b_cols,
+                          size_t i0, size_t i1, size_t jw0, size_t jw1,
+                          size_t k0, size_t k1, bool accumulate) {
+    block_scalar<GF2Semiring::OrAnd>(a, a_stride, b_t, b_t_stride, c, c_stride, b_cols,
+                                     i0, i1, jw0, jw1, k0, k1, accumulate);
+}
+
+// --- Register-tile kernels ---
+
+namespace {
+
+// One word per "register": the tiles are then the unroll-and-jam of the
+// scalar loop, which the compiler may still vectorize
+struct ScalarTile {
+    using Reg = uint64_t;
+    static constexpr size_t WORDS = 1;
+    static Reg zero() { return 0; }
+    static Reg load(const uint64_t* p) { return *p; }
+    static Reg lane0(uint64_t x) { return x; }
+    template <GF2Semiring S>
+    static Reg add(Reg x, Reg y) { return semiring_add<S>(x, y); }
+    template <GF2Semiring S>
+    static Reg add_and(Reg acc, Reg a, Reg b) { return semiring_add<S>(acc, a & b); }
+    template <GF2Semiring S>
+    static uint64_t reduce(Reg* acc) { return parity_tree<S>(acc); }
+};
+
+} // namespace
+
+std::vector<SimdKernel> simd_tiles_scalar() {
+    return GF2_TILE_KERNELS(ScalarTile, "scalar");
+}
+
+// --- Row kernels ---
+
+void row_xor_scalar(uint64_t* dst, const uint64_t* src, size_t words) {
+    for (size_t w = 0; w < words; ++w) {
+        dst[w] ^= src[w];
+    }
+}
+
+void row_xor_masked_scalar(uint64_t* dst, const uint64_t* src, const uint64_t* mask,
+                           size_t words) {
+    for (size_t w = 0; w < words; ++w) {
+        dst[w] ^= src[w] & mask[w];
+    }
+}
+
+void row_swap_scalar(uint64_t* a, uint64_t* b, size_t words) {
+    for (size_t w = 0; w < words; ++w) {
+        std::swap(a[w], b[w]);
+    }
+}
+
+size_t row_weight_scalar(const uint64_t* row, size_t words) {
+    size_t weight = 0;
+    for (size_t w = 0; w < words; ++w) {
+        weight += size_t(__builtin_popcountll(row[w]));
+    }
+    return weight;
+}
+
+size_t row_first_nonzero_scalar(const uint64_t* row, size_t words) {
+    size_t w = 0;
+    while (w < words && row[w] == 0) ++w;
+    return w;
+}
+
+void hash_stripes_scalar(uint64_t* acc, const uint64_t* data, size_t stripes, size_t stripe0) {
+    const uint64_t* secret = HASH_SECRET.words;
+    size_t s = stripe0 % HASH_BLOCK_STRIPES;
+    for (size_t t = 0; t < stripes; ++t, data += HASH_STRIPE_WORDS) {
+        for (size_t i = 0; i < HASH_STRIPE_WORDS; ++i) {
+            const uint64_t k = data[i] ^ secret[s + i];
+            acc[i ^ 1] += data[i];
+            acc[i] += (k & 0xFFFFFFFF) * (k >> 32);
+        }
+        if (++s == HASH_BLOCK_STRIPES) {
+            s = 0;
+            for (size_t i = 0; i < HASH_STRIPE_WORDS; ++i) {
+                acc[i] = (acc[i] ^ (acc[i] >> 47) ^ secret[HASH_BLOCK_STRIPES + i]) * HASH_PRIME32;
+            }
+        }
+    }
+}
+
+// --- Byte packing ---
+
+// Eight bytes per step: a byte's high bit set where it is nonzero (adding
+// 0x7F to the low seven bits carries into the high one, which the OR keeps),
+// then the eight high bits gathered into the top byte by one multiply
+void pack_bytes_scalar(uint64_t* dst, const uint8_t* src, size_t words) {
+    for (size_t w = 0; w < words; ++w, src += 64) {
+        uint64_t word = 0;
+        for (size_t b = 0; b < 8; ++b) {
+            uint64_t x;
+            std::memcpy(&x, src + 8 * b, sizeof(x));
+            const uint64_t t =
+                (((x & 0x7F7F7F7F7F7F7F7FULL) + 0x7F7F7F7F7F7F7F7FULL) | x) & 0x8080808080808080ULL;
+            word |= (((t >> 7) * 0x0102040810204080ULL) >> 56) << (8 * b);
+        }
+        dst[w] = word;
+    }
+}
+
+// The reverse: a byte of the word copied to all eight bytes, byte i keeping
+// bit i, and each nonzero byte turned into a one
+void unpack_bytes_scalar(uint8_t* dst, const uint64_t* src, size_t words) {
+    for (size_t w = 0; w < words; ++w, dst += 64) {
+        for (size_t b = 0; b < 8; ++b) {
+            const uint64_t y =
+                (((src[w] >> (8 * b)) & 0xFF) * 0x0101010101010101ULL) & 0x8040201008040201ULL;
+            const uint64_t x = (((y + 0x7F7F7F7F7F7F7F7FULL) | y) >> 7) & 0x0101010101010101ULL;
+            std::memcpy(dst + 8 * b, &x, sizeof(x));
+        }
+    }
+}
+
+namespace {
+
+uint64_t reverse_byte_bits(uint64_t x) {
+    x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+    return ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+}
+
+} // namespace
+
+void reverse_bits_scalar(uint8_t* dst, const uint8_t* src, size_t bytes) {
+    size_t i = 0;
+    for (; i + 8 <= bytes; i += 8) {
+        uint64_t x;
+        std::memcpy(&x, src + i, sizeof(x));
+        x = reverse_byte_bits(x);
+        std::memcpy(dst + i, &x, sizeof(x));
+    }
+    for (; i < bytes; ++i) {
+        dst[i] = uint8_t(reverse_byte_bits(src[i]));
+    }
+}
+
+void lookup_nibbles_scalar(uint8_t* dst, const uint8_t* src, const uint8_t* table,
+                           size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) {
+        dst[i] = table[src[i] & 0x0F] ^ table[16 + (src[i] >> 4)];
+    }
+}
@@ -0,0 +1,132 @@
+// Only compile this file for aarch64 architecture. It is built with
+// -march=armv8-a+sve2 and only called after the runtime dispatch has
+// confirmed SVE2 with vectors wider than NEON's 128 bits.
+#if defined(__aarch64__)
+
+#include "GF2Kernels.hpp"
+#include <arm_sve.h>
+#include <algorithm>
+
+// SVE vectors are sizeless and cannot be kept in arrays, so the vector kernel
+// reduces every dot product to a scalar word (EORV) right away and the parity
+// tree runs on the 64 scalar words of a result word. The vector length is only
+// known at runtime; the common-dimension tail is handled with predicates.
+
+// Number of rows of A and of columns (B^T rows) processed together by the
+// register-blocked microkernel (2 x 2 named accumulators)
+static constexpr int MICROKERNEL_ROWS = 2;
+
+// Scalar version of the parity fold tree used by the vector kernels
+static inline uint64_t parity_tree(uint64_t* acc) {
+    size_t n = 64;
+    for (int stage = 0, s = 32; s >= 1; ++stage, s >>= 1, n >>= 1) {
+        const uint64_t mask = PARITY_TREE_MASKS[stage];
+        for (size_t t = 0; t < n / 2; ++t) {
+            uint64_t lo = acc[2 * t] ^ (acc[2 * t] >> s);
+            uint64_t hi = acc[2 * t + 1] ^ (acc[2 * t + 1] << s);
+            acc[t] = (mask & lo) | (~mask & hi);
+        }
+    }
+    return acc[0];
+}
+
+// Dot products of two A rows with two B^T rows. Two vectors of the common
+// dimension are folded into each sum per EOR3.
+static inline void dot_sve2_2x2(const uint64_t* a0, const uint64_t* a1,
+                                const uint64_t* b0, const uint64_t* b1,
+                                size_t k_words, uint64_t* out) {
+    const size_t vl = svcntd();
+    svuint64_t s00 = svdup_n_u64(0), s01 = svdup_n_u64(0);
+    svuint64_t s10 = svdup_n_u64(0), s11 = svdup_n_u64(0);
+
+    for (size_t k = 0; k < k_words; k += 2 * vl) {
+        const svbool_t p_lo = svwhilelt_b64(k, k_words);
+        const svbool_t p_hi = svwhilelt_b64(k + vl, k_words);
+
+        // Inactive lanes load as zero, so the tail adds nothing to the sums
+        svuint64_t b0_lo = svld1_u64(p_lo, b0 + k), b0_hi = svld1_u64(p_hi, b0 + k + vl);
+        svuint64_t b1_lo = svld1_u64(p_lo, b1 + k), b1_hi = svld1_u64(p_hi, b1 + k + vl);
+        svuint64_t a0_lo = svld1_u64(p_lo, a0 + k), a0_hi = svld1_u64(p_hi, a0 + k + vl);
+        svuint64_t a1_lo = svld1_u64(p_lo, a1 + k), a1_hi = svld1_u64(p_hi, a1 + k + vl);
+
+        s00 = sveor3_u64(s00, svand_u64_z(p_lo, a0_lo, b0_lo), svand_u64_z(p_hi, a0_hi, b0_hi));
+        s01 = sveor3_u64(s01, svand_u64_z(p_lo, a0_lo, b1_lo), svand_u64_z(p_hi, a0_hi, b1_hi));
+        s10 = sveor3_u64(s10, svand_u64_z(p_lo, a1_lo, b0_lo), svand_u64_z(p_hi, a1_hi, b0_hi));
+        s11 = sveor3_u64(s11, svand_u64_z(p_lo, a1_lo, b1_lo), svand_u64_z(p_hi, a1_hi, b1_hi));
+    }
+
+    const svbool_t all = svptrue_b64();
+    out[0] = sveorv_u64(all, s00);
+    out[1] = sveorv_u64(all, s01);
+    out[2] = sveorv_u64(all, s10);
+    out[3] = sveorv_u64(all, s11);
+}
+
+static inline uint64_t dot_sve2_1x1(const uint64_t* a, const uint64_t* b, size_t k_words) {
+    const size_t vl = svcntd();
+    svuint64_t sum = svdup_n_u64(0);
+
+    for (size_t k = 0; k < k_words; k += vl) {
+        const svbool_t p = svwhilelt_b64(k, k_words);
+        sum = sveor_u64_m(p, sum, svand_u64_z(p, svld1_u64(p, a + k), svld1_u64(p, b + k)));
+    }
+    return sveorv_u64(svptrue_b64(), sum);
+}
+
+// Computes the full result words [jw0, jw1) of one or two rows starting at
+// row i, over the common-dimension words [k0, k1), two columns per pass.
+static void microkernel_sve2(const uint64_t* a, size_t a_stride,
+                             const uint64_t* b_t, size_t b_t_stride,
+                             uint64_t* c, size_t c_stride, size_t b_cols,
+                             size_t i, size_t rows, size_t jw0, size_t jw1,
+                             size_t k0, size_t k1, bool accumulate) {
+    uint64_t acc[MICROKERNEL_ROWS][64];
+    const size_t k_words = k1 - k0;
+    const uint64_t* a0 = a + i * a_stride + k0;
+    const uint64_t* a1 = a + (i + rows - 1) * a_stride + k0;
+
+    for (size_t jw = jw0; jw < jw1; ++jw) {
+        const size_t cols = std::min<size_t>(64, b_cols - jw * 64);
+
+        for (size_t col = 0; col < 64; col += 2) {
+            const uint64_t* b0 = b_t + (jw * 64 + col) * b_t_stride + k0;
+            const uint64_t* b1 = b0 + b_t_stride;
+            uint64_t sum[4] = {0, 0, 0, 0};
+
+            if (rows == 2 && col + 2 <= cols) {
+                dot_sve2_2x2(a0, a1, b0, b1, k_words, sum);
+            } else {
+                for (size_t r = 0; r < rows; ++r) {
+                    const uint64_t* a_row = r ? a1 : a0;
+                    if (col < cols) sum[2 * r] = dot_sve2_1x1(a_row, b0, k_words);
+                    if (col + 1 < cols) sum[2 * r + 1] = dot_sve2_1x1(a_row, b1, k_words);
+                }
+            }
+
+            for (size_t r = 0; r < rows; ++r) {
+                acc[r][PARITY_TREE_SLOT[col]] = sum[2 * r];
+                acc[r][PARITY_TREE_SLOT[col + 1]] = sum[2 * r + 1];
+            }
+        }
+
+        // One store per 64 output bits
+        for (size_t r = 0; r < rows; ++r) {
+            uint64_t word = parity_tree(acc[r]);
+            uint64_t& out = c[(i + r) * c_stride + jw];
+            out = accumulate ? (out ^ word) : word;
+        }
+    }
+}
+
+void simd_block_sve2(const uint64_t* a, size_t a_stride,
+                     const uint64_t* b_t, size_t b_t_stride,
+                     uint64_t* c, size_t c_stride, size_t b_cols,
+                     size_t i0, size_t i1, size_t jw0, size_t jw1,
+                     size_t k0, size_t k1, bool accumulate) {
+    for (size_t i = i0; i < i1; i += MICROKERNEL_ROWS) {
+        microkernel_sve2(a, a_stride, b_t, b_t_stride, c, c_stride, b_cols,
+                         i, std::min<size_t>(MICROKERNEL_ROWS, i1 - i), jw0, jw1, k0, k1, accumulate);
+    }
+}
+
+#endif // defined(__aarch64__)
@@ -1,55 +1,369 @@
-// Only compile this file for x86_64 architecture
+// Only compile this file for x86_64 architecture. It is built with -mavx2 and
+// only called after the runtime dispatch has confirmed AVX2 support.
 #if defined(__x86_64__) || defined(_M_X64)
 
-#include "GF2Matrix.hpp"
+#include "GF2Kernels.hpp"
+#include "GF2Microkernel.hpp"
 #include <immintrin.h>
-#include <vector>
-
-// This function is declared in GF2Matrix.cpp and called by multiplySIMD
-void multiply_simd_x86(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result) {
-    // Use the same transpose optimization for the x86 implementation
-    GF2Matrix b_transposed = b.transpose();
-
-    size_t a_rows = a.rows();
-    size_t b_cols = b.cols();
-    size_t common_dim_words = a.words_per_row();
-
-    const uint64_t* a_data = a.get_raw_data();
-    const uint64_t* b_t_data = b_transposed.get_raw_data();
-
-    for (size_t i = 0; i < a_rows; ++i) {
-        for (size_t j = 0; j < b_cols; ++j) {
-            const uint64_t* a_row_ptr = a_data + i * common_dim_words;
-            const uint64_t* b_t_row_ptr = b_t_data + j * common_dim_words;
-
-            // Use 256-bit AVX2 vectors (four 64-bit integers)
-            __m256i acc = _mm256_setzero_si256();
-
-            size_t k = 0;
-            for (; k + 3 < common_dim_words; k += 4) {
-                __m256i a_vec = _mm256_loadu_si256((__m256i*)(a_row_ptr + k));
-                __m256i b_vec = _mm256_loadu_si256((__m256i*)(b_t_row_ptr + k));
-                __m256i and_res = _mm256_and_si256(a_vec, b_vec);
-                acc = _mm256_xor_si256(acc, and_res);
-            }
+#include <algorithm>
+#include <utility>
+
+// Number of rows of A processed together by the register-blocked microkernel
+static constexpr int MICROKERNEL_ROWS = 4;
+
+// The semiring addition on vectors
+template <GF2Semiring S>
+static inline __m256i add(__m256i x, __m256i y) {
+    return S == GF2Semiring::XorAnd ? _mm256_xor_si256(x, y) : _mm256_or_si256(x, y);
+}
+
+// Reduces 64 accumulators to one word whose bit c is the parity of acc[bitrev(c)].
+// Each stage folds pairs of words into one: the low half of every 2s-bit group
+// keeps the folded bits of the first word, the high half those of the second.
+// The four 64-bit lanes are reduced independently and combined at the end.
+// The Boolean kernel folds with OR, making bit c whether acc[bitrev(c)] is
+// nonzero.
+template <GF2Semiring S>
+static inline uint64_t parity_tree(__m256i* acc) {
+    size_t n = 64;
+    for (int stage = 0, s = 32; s >= 1; ++stage, s >>= 1, n >>= 1) {
+        const __m256i mask = _mm256_set1_epi64x(static_cast<long long>(PARITY_TREE_MASKS[stage]));
+        const __m128i shift = _mm_cvtsi32_si128(s);
+        for (size_t t = 0; t < n / 2; ++t) {
+            __m256i lo = add<S>(acc[2 * t], _mm256_srl_epi64(acc[2 * t], shift));
+            __m256i hi = add<S>(acc[2 * t + 1], _mm256_sll_epi64(acc[2 * t + 1], shift));
+            acc[t] = _mm256_or_si256(_mm256_and_si256(mask, lo), _mm256_andnot_si256(mask, hi));
+        }
+    }
 
-            // Horizontal XOR reduction of the accumulator
-            __m128i xmm_acc_low = _mm256_extracti128_si256(acc, 0);
-            __m128i xmm_acc_high = _mm256_extracti128_si256(acc, 1);
-            __m128i xmm_acc = _mm_xor_si128(xmm_acc_low, xmm_acc_high);
-            
-            uint64_t temp_res = _mm_extract_epi64(xmm_acc, 0) ^ _mm_extract_epi64(xmm_acc, 1);
+    const __m128i lo = _mm256_extracti128_si256(acc[0], 0), hi = _mm256_extracti128_si256(acc[0], 1);
+    __m128i x = S == GF2Semiring::XorAnd ? _mm_xor_si128(lo, hi) : _mm_or_si128(lo, hi);
+    return semiring_add<S>(static_cast<uint64_t>(_mm_extract_epi64(x, 0)),
+                           static_cast<uint64_t>(_mm_extract_epi64(x, 1)));
+}
 
-            // Handle remaining words
-            for (; k < common_dim_words; ++k) {
-                temp_res ^= (a_row_ptr[k] & b_t_row_ptr[k]);
+// Computes the full result words [jw0, jw1) of ROWS consecutive rows starting
+// at row i, over the common-dimension words [k0, k1). The AND/XOR partial sums
+// stay in vector accumulators and are only reduced once per output word by the
+// parity tree. Parities over disjoint k ranges XOR together, so with
+// 'accumulate' the words are XORed into the result instead of stored.
+template <GF2Semiring S, int ROWS>
+static void microkernel_avx2(const uint64_t* a, size_t a_stride,
+                             const uint64_t* b_t, size_t b_t_stride,
+                             uint64_t* c, size_t c_stride, size_t b_cols,
+                             size_t i, size_t jw0, size_t jw1,
+                             size_t k0, size_t k1, bool accumulate) {
+    alignas(32) __m256i acc[ROWS][64];
+    const size_t k_words = k1 - k0;
+
+    const uint64_t* a_rows[ROWS];
+    for (int r = 0; r < ROWS; ++r) {
+        a_rows[r] = a + (i + r) * a_stride + k0;
+    }
+
+    for (size_t jw = jw0; jw < jw1; ++jw) {
+        const size_t cols = std::min<size_t>(64, b_cols - jw * 64);
+
+        for (size_t col = 0; col < 64; ++col) {
+            __m256i sum[ROWS];
+            for (int r = 0; r < ROWS; ++r) sum[r] = _mm256_setzero_si256();
+
+            if (col < cols) {
+                const uint64_t* b_t_row_ptr = b_t + (jw * 64 + col) * b_t_stride + k0;
+
+                size_t k = 0;
+                for (; k + 3 < k_words; k += 4) {
+                    __m256i b_vec = _mm256_loadu_si256((const __m256i*)(b_t_row_ptr + k));
+                    for (int r = 0; r < ROWS; ++r) {
+                        __m256i a_vec = _mm256_loadu_si256((const __m256i*)(a_rows[r] + k));
+                        sum[r] = add<S>(sum[r], _mm256_and_si256(a_vec, b_vec));
+                    }
+                }
+
+                // Remaining words go into lane 0
+                for (; k < k_words; ++k) {
+                    for (int r = 0; r < ROWS; ++r) {
+                        uint64_t t = a_rows[r][k] & b_t_row_ptr[k];
+                        sum[r] = add<S>(sum[r], _mm256_set_epi64x(0, 0, 0, static_cast<long long>(t)));
+                    }
+                }
             }
 
-            // Final parity check
-            result.set(i, j, _mm_popcnt_u64(temp_res) % 2);
+            for (int r = 0; r < ROWS; ++r) acc[r][PARITY_TREE_SLOT[col]] = sum[r];
+        }
+
+        // One store per 64 output bits
+        for (int r = 0; r < ROWS; ++r) {
+            uint64_t word = parity_tree<S>(acc[r]);
+            uint64_t& out = c[(i + r) * c_stride + jw];
+            out = accumulate ? semiring_add<S>(out, word) : word;
         }
     }
 }
 
-#endif // defined(__x86_64__) || defined(_M_X64)
+template <GF2Semiring S>
+static void block_avx2(const uint64_t* a, size_t a_stride,
+                       const uint64_t* b_t, size_t b_t_stride,
+                       uint64_t* c, size_t c_stride, size_t b_cols,
+                       size_t i0, size_t i1, size_t jw0, size_t jw1,
+                       size_t k0, size_t k1, bool accumulate) {
+    size_t i = i0;
+    for (; i + MICROKERNEL_ROWS <= i1; i += MICROKERNEL_ROWS) {
+        microkernel_avx2<S, MICROKERNEL_ROWS>(a, a_stride, b_t, b_t_stride, c, c_stride, b_cols,
+                                              i, jw0, jw1, k0, k1, accumulate);
+    }
+    for (; i < i1; ++i) {
+        microkernel_avx2<S, 1>(a, a_stride, b_t, b_t_stride, c, c_stride, b_cols,
+                               i, jw0, jw1, k0, k1, accumulate);
+    }
+}
+
+void simd_block_avx2(const uint64_t* a, size_t a_stride,
+                     const uint64_t* b_t, size_t b_t_stride,
+                     uint64_t* c, size_t c_stride, size_t b_cols,
+                     size_t i0, size_t i1, size_t jw0, size_t jw1,
+                     size_t k0, size_t k1, bool accumulate) {
+    block_avx2<GF2Semiring::XorAnd>(a, a_stride, b_t, b_t_stride, c, c_stride, b_cols,
+                                    i0, i1, jw0, jw1, k0, k1, accumulate);
+}
+
+void simd_block_avx2_or(const uint64_t* a, size_t a_stride,
+                        const uint64_t* b_t, size_t b_t_stride,
+                        uint64_t* c, size_t c_stride, size_t b_cols,
+                        size_t i0, size_t i1, size_t jw0, size_t jw1,
+                        size_t k0, size_t k1, bool accumulate) {
+    block_avx2<GF2Semiring::OrAnd>(a, a_stride, b_t, b_t_stride, c, c_stride, b_cols,
+                                   i0, i1, jw0, jw1, k0, k1, accumulate);
+}
+
+// --- Register-tile kernels ---
+
+namespace {
+
+struct Avx2Tile {
+    using Reg = __m256i;
+    static constexpr size_t WORDS = 4;
+    static Reg zero() { return _mm256_setzero_si256(); }
+    static Reg load(const uint64_t* p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
+    static Reg lane0(uint64_t x) { return _mm256_set_epi64x(0, 0, 0, static_cast<long long>(x)); }
+    template <GF2Semiring S>
+    static Reg add(Reg x, Reg y) { return ::add<S>(x, y); }
+    template <GF2Semiring S>
+    static Reg add_and(Reg acc, Reg a, Reg b) { return ::add<S>(acc, _mm256_and_si256(a, b)); }
+    template <GF2Semiring S>
+    static uint64_t reduce(Reg* acc) { return parity_tree<S>(acc); }
+};
+
+} // namespace
+
+std::vector<SimdKernel> simd_tiles_avx2() {
+    return GF2_TILE_KERNELS(Avx2Tile, "avx2");
+}
+
+// --- Row kernels ---
+
+void row_xor_avx2(uint64_t* dst, const uint64_t* src, size_t words) {
+    size_t w = 0;
+    for (; w + 4 <= words; w += 4) {
+        const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + w));
+        const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + w));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + w), _mm256_xor_si256(d, x));
+    }
+    for (; w < words; ++w) dst[w] ^= src[w];
+}
+
+void row_xor_masked_avx2(uint64_t* dst, const uint64_t* src, const uint64_t* mask,
+                         size_t words) {
+    size_t w = 0;
+    for (; w + 4 <= words; w += 4) {
+        const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + w));
+        const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + w));
+        const __m256i m = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mask + w));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + w),
+                            _mm256_xor_si256(d, _mm256_and_si256(x, m)));
+    }
+    for (; w < words; ++w) dst[w] ^= src[w] & mask[w];
+}
+
+void row_swap_avx2(uint64_t* a, uint64_t* b, size_t words) {
+    size_t w = 0;
+    for (; w + 4 <= words; w += 4) {
+        const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + w));
+        const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + w));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(a + w), y);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(b + w), x);
+    }
+    for (; w < words; ++w) std::swap(a[w], b[w]);
+}
+
+// Ones per byte from a nibble table (VPSHUFB), summed into the four 64-bit
+// lanes by VPSADBW every 31 vectors, before a byte count could overflow
+size_t row_weight_avx2(const uint64_t* row, size_t words) {
+    const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                           0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0F);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i total = zero;
+    size_t w = 0;
+    while (w + 4 <= words) {
+        __m256i bytes = zero;
+        for (int i = 0; i < 31 && w + 4 <= words; ++i, w += 4) {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + w));
+            const __m256i lo = _mm256_shuffle_epi8(table, _mm256_and_si256(v, low));
+            const __m256i hi =
+                _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+            bytes = _mm256_add_epi8(bytes, _mm256_add_epi8(lo, hi));
+        }
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(bytes, zero));
+    }
+    size_t weight = size_t(_mm256_extract_epi64(total, 0)) + size_t(_mm256_extract_epi64(total, 1)) +
+                    size_t(_mm256_extract_epi64(total, 2)) + size_t(_mm256_extract_epi64(total, 3));
+    for (; w < words; ++w) weight += size_t(__builtin_popcountll(row[w]));
+    return weight;
+}
+
+size_t row_first_nonzero_avx2(const uint64_t* row, size_t words) {
+    size_t w = 0;
+    for (; w + 4 <= words; w += 4) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + w));
+        if (!_mm256_testz_si256(v, v)) break;
+    }
+    while (w < words && row[w] == 0) ++w;
+    return w;
+}
+
+// acc * HASH_PRIME32 from the two 32-bit halves of every lane
+static inline __m256i hash_scramble_avx2(__m256i acc, __m256i key) {
+    const __m256i prime = _mm256_set1_epi64x(int64_t(HASH_PRIME32));
+    const __m256i x = _mm256_xor_si256(_mm256_xor_si256(acc, _mm256_srli_epi64(acc, 47)), key);
+    const __m256i lo = _mm256_mul_epu32(x, prime);
+    const __m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), prime);
+    return _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32));
+}
+
+// Lanes 0-3 and 4-7 in one vector each; the swap of lanes i and i ^ 1
+// stays within 128-bit halves
+void hash_stripes_avx2(uint64_t* acc, const uint64_t* data, size_t stripes, size_t stripe0) {
+    const uint64_t* secret = HASH_SECRET.words;
+    __m256i acc0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc));
+    __m256i acc1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + 4));
+    size_t s = stripe0 % HASH_BLOCK_STRIPES;
+    for (size_t t = 0; t < stripes; ++t, data += HASH_STRIPE_WORDS) {
+        const __m256i d0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+        const __m256i d1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 4));
+        const __m256i k0 = _mm256_xor_si256(
+            d0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret + s)));
+        const __m256i k1 = _mm256_xor_si256(
+            d1, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret + s + 4)));
+        acc0 = _mm256_add_epi64(acc0, _mm256_shuffle_epi32(d0, _MM_SHUFFLE(1, 0, 3, 2)));
+        acc1 = _mm256_add_epi64(acc1, _mm256_shuffle_epi32(d1, _MM_SHUFFLE(1, 0, 3, 2)));
+        acc0 = _mm256_add_epi64(acc0, _mm256_mul_epu32(k0, _mm256_srli_epi64(k0, 32)));
+        acc1 = _mm256_add_epi64(acc1, _mm256_mul_epu32(k1, _mm256_srli_epi64(k1, 32)));
+        if (++s == HASH_BLOCK_STRIPES) {
+            s = 0;
+            const uint64_t* key = secret + HASH_BLOCK_STRIPES;
+            acc0 = hash_scramble_avx2(
+                acc0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(key)));
+            acc1 = hash_scramble_avx2(
+                acc1, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(key + 4)));
+        }
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc), acc0);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + 4), acc1);
+}
+
+
+// --- Byte packing ---
 
+// VPMOVMSKB of the bytes equal to zero, inverted: 32 bytes to 32 bits
+void pack_bytes_avx2(uint64_t* dst, const uint8_t* src, size_t words) {
+    const __m256i zero = _mm256_setzero_si256();
+    for (size_t w = 0; w < words; ++w, src += 64) {
+        const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+        const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 32));
+        const uint32_t zlo = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, zero)));
+        const uint32_t zhi = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, zero)));
+        dst[w] = ~(uint64_t(zlo) | uint64_t(zhi) << 32);
+    }
+}
+
+// 32 bits to 32 bytes: VPSHUFB copies byte j / 8 of the bits to byte j,
+// which keeps bit j % 8 and becomes one where it is set
+void unpack_bytes_avx2(uint8_t* dst, const uint64_t* src, size_t words) {
+    const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                                            2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+    const __m256i bit = _mm256_set1_epi64x(int64_t(0x8040201008040201ULL));
+    const __m256i one = _mm256_set1_epi8(1);
+    for (size_t w = 0; w < words; ++w, dst += 64) {
+        for (int h = 0; h < 2; ++h) {
+            const __m256i x = _mm256_shuffle_epi8(
+                _mm256_set1_epi32(int32_t(uint32_t(src[w] >> (32 * h)))), spread);
+            const __m256i set = _mm256_cmpeq_epi8(_mm256_and_si256(x, bit), bit);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 32 * h),
+                                _mm256_and_si256(set, one));
+        }
+    }
+}
+
+// Each nibble reversed by a VPSHUFB table and moved to the other half
+void reverse_bits_avx2(uint8_t* dst, const uint8_t* src, size_t bytes) {
+    const __m256i rev_lo = _mm256_setr_epi8(0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE,
+                                            0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF,
+                                            0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE,
+                                            0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF);
+    const __m256i rev_hi = _mm256_slli_epi16(rev_lo, 4);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 32 <= bytes; i += 32) {
+        const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        const __m256i lo = _mm256_and_si256(x, nibble);
+        const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                            _mm256_or_si256(_mm256_shuffle_epi8(rev_hi, lo),
+                                            _mm256_shuffle_epi8(rev_lo, hi)));
+    }
+    reverse_bits_scalar(dst + i, src + i, bytes - i);
+}
+
+// 32 bytes per pair of VPSHUFBs, each table in both lanes
+void lookup_nibbles_avx2(uint8_t* dst, const uint8_t* src, const uint8_t* table, size_t bytes) {
+    const __m256i t_lo = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(table)));
+    const __m256i t_hi = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(table + 16)));
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 32 <= bytes; i += 32) {
+        const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        const __m256i lo = _mm256_and_si256(x, nibble);
+        const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                            _mm256_xor_si256(_mm256_shuffle_epi8(t_lo, lo),
+                                             _mm256_shuffle_epi8(t_hi, hi)));
+    }
+    lookup_nibbles_scalar(dst + i, src + i, table, bytes - i);
+}
+
+// --- Transpose ---
+
+// Rows k..k+3 and k+j..k+j+3 of a butterfly stage are contiguous while
+// j >= 4, so one vector swaps four row pairs
+void transpose_64x64_stages_avx2(uint64_t* block) {
+    for (size_t stage = 0, j = 32; j >= 4; j >>= 1, ++stage) {
+        const __m256i mask = _mm256_set1_epi64x(static_cast<long long>(PARITY_TREE_MASKS[stage]));
+        const __m128i shift = _mm_cvtsi32_si128(static_cast<int>(j));
+        for (size_t k = 0; k < 64; k = (k + j + 4) & ~(j | 3)) {
+            __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + k));
+            __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + k + j));
+            __m256i t = _mm256_and_si256(_mm256_xor_si256(_mm256_srl_epi64(lo, shift), hi), mask);
+            lo = _mm256_xor_si256(lo, _mm256_sll_epi64(t, shift));
+            hi = _mm256_xor_si256(hi, t);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(block + k), lo);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(block + k + j), hi);
+        }
+    }
+}
+
+#endif // defined(__x86_64__) || defined(_M_X64)
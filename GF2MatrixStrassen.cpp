@@ -0,0 +1,312 @@
+#include "GF2Matrix.hpp"
+#include "GF2MatrixView.hpp"
+#include "GF2Kernels.hpp"
+#include "GF2TaskPool.hpp"
+#include "GF2Trace.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+// Strassen-Winograd multiplication over GF(2). Addition and subtraction are
+// both XOR, so the 15 block additions of the Winograd variant become block
+// XORs. All recursion levels share one pre-allocated scratch area.
+
+namespace {
+
+// A strided window into a word buffer (rows x words)
+struct Block {
+    uint64_t* data;
+    size_t stride;
+    size_t rows;
+    size_t words;
+
+    Block quadrant(size_t r, size_t c) const {
+        size_t hr = rows / 2;
+        size_t hw = words / 2;
+        return {data + r * hr * stride + c * hw, stride, hr, hw};
+    }
+};
+
+// dst = x ^ y
+void xor_block(const Block& dst, const Block& x, const Block& y) {
+    for (size_t i = 0; i < dst.rows; ++i) {
+        uint64_t* d = dst.data + i * dst.stride;
+        const uint64_t* px = x.data + i * x.stride;
+        const uint64_t* py = y.data + i * y.stride;
+        for (size_t j = 0; j < dst.words; ++j) {
+            d[j] = px[j] ^ py[j];
+        }
+    }
+}
+
+// Scratch words needed by one recursion level for these block dimensions
+size_t level_scratch_words(size_t m, size_t k_words, size_t n_words) {
+    size_t x0 = (m / 2) * std::max(k_words / 2, n_words / 2);
+    size_t x1 = (k_words / 2) * 64 * (n_words / 2);
+    return x0 + x1;
+}
+
+// C = A * B where A is (m x k_words*64), B is (k_words*64 x n_words*64).
+// 'levels' more halvings are performed before falling back to M4R.
+void strassen_recursive(const Block& a, const Block& b, const Block& c,
+                        int levels, uint64_t* scratch) {
+    if (levels == 0) {
+        m4r_multiply_block(a.data, a.stride, b.data, b.stride, c.data, c.stride,
+                           a.rows, a.words * 64, c.words, false);
+        return;
+    }
+
+    const size_t hm = a.rows / 2;
+    const size_t hk = a.words / 2;
+    const size_t hn = b.words / 2;
+
+    Block a11 = a.quadrant(0, 0), a12 = a.quadrant(0, 1);
+    Block a21 = a.quadrant(1, 0), a22 = a.quadrant(1, 1);
+    Block b11 = b.quadrant(0, 0), b12 = b.quadrant(0, 1);
+    Block b21 = b.quadrant(1, 0), b22 = b.quadrant(1, 1);
+    Block c11 = c.quadrant(0, 0), c12 = c.quadrant(0, 1);
+    Block c21 = c.quadrant(1, 0), c22 = c.quadrant(1, 1);
+
+    // X0 holds sums of A quadrants and later P1; X1 holds sums of B quadrants
+    size_t x0_words = std::max(hk, hn);
+    Block x0a = {scratch, x0_words, hm, hk};
+    Block x0c = {scratch, x0_words, hm, hn};
+    Block x1 = {scratch + hm * x0_words, hn, hk * 64, hn};
+    uint64_t* next = scratch + level_scratch_words(a.rows, a.words, b.words);
+
+    xor_block(x0a, a11, a21);                            // S3 = A11 + A21
+    xor_block(x1, b22, b12);                             // T3 = B22 + B12
+    strassen_recursive(x0a, x1, c21, levels - 1, next);  // P7 = S3 * T3
+    xor_block(x0a, a21, a22);                            // S1 = A21 + A22
+    xor_block(x1, b12, b11);                             // T1 = B12 + B11
+    strassen_recursive(x0a, x1, c22, levels - 1, next);  // P5 = S1 * T1
+    xor_block(x0a, x0a, a11);                            // S2 = S1 + A11
+    xor_block(x1, b22, x1);                              // T2 = B22 + T1
+    strassen_recursive(x0a, x1, c12, levels - 1, next);  // P6 = S2 * T2
+    xor_block(x0a, a12, x0a);                            // S4 = A12 + S2
+    strassen_recursive(x0a, b22, c11, levels - 1, next); // P3 = S4 * B22
+    strassen_recursive(a11, b11, x0c, levels - 1, next); // P1 = A11 * B11
+    xor_block(c12, x0c, c12);                            // U2 = P1 + P6
+    xor_block(c21, c12, c21);                            // U3 = U2 + P7
+    xor_block(c12, c12, c22);                            // U4 = U2 + P5
+    xor_block(c22, c21, c22);                            // C22 = U3 + P5
+    xor_block(c12, c12, c11);                            // C12 = U4 + P3
+    xor_block(x1, x1, b21);                              // T4 = T2 + B21
+    strassen_recursive(a22, x1, c11, levels - 1, next);  // P4 = A22 * T4
+    xor_block(c21, c21, c11);                            // C21 = U3 + P4
+    strassen_recursive(a12, b21, c11, levels - 1, next); // P2 = A12 * B21
+    xor_block(c11, x0c, c11);                            // C11 = P1 + P2
+}
+
+// Scratch words of strassen_recursive over 'levels' halvings
+size_t serial_scratch_words(size_t m, size_t k_words, size_t n_words, int levels) {
+    size_t words = 0;
+    for (int l = 0; l < levels; ++l) {
+        words += level_scratch_words(m, k_words, n_words);
+        m /= 2;
+        k_words /= 2;
+        n_words /= 2;
+    }
+    return words;
+}
+
+// Words of one product of strassen_parallel: its S and T sums, its result P
+// and the scratch of its own recursion
+size_t product_words(size_t m, size_t k_words, size_t n_words, int levels, int parallel);
+
+size_t parallel_scratch_words(size_t m, size_t k_words, size_t n_words, int levels,
+                              int parallel) {
+    if (parallel == 0) {
+        return serial_scratch_words(m, k_words, n_words, levels);
+    }
+    return 7 * product_words(m / 2, k_words / 2, n_words / 2, levels - 1, parallel - 1);
+}
+
+size_t product_words(size_t m, size_t k_words, size_t n_words, int levels, int parallel) {
+    return m * k_words + k_words * 64 * n_words + m * n_words +
+           parallel_scratch_words(m, k_words, n_words, levels, parallel);
+}
+
+// strassen_recursive with the seven products of the top 'parallel' levels
+// as tasks of the pool. The Winograd schedule reuses two temporaries, which
+// serializes the products, so here each product gets its own sums S and T
+// and its own result P, and C is formed from the Ps once all are done:
+//   C11 = P1 + P2, C12 = P1 + P6 + P5 + P3,
+//   C21 = P1 + P6 + P7 + P4, C22 = P1 + P6 + P7 + P5.
+void strassen_parallel(const Block& a, const Block& b, const Block& c, int levels,
+                       int parallel, uint64_t* scratch, GF2TaskPool& pool) {
+    if (parallel == 0) {
+        strassen_recursive(a, b, c, levels, scratch);
+        return;
+    }
+
+    const size_t hm = a.rows / 2;
+    const size_t hk = a.words / 2;
+    const size_t hn = b.words / 2;
+    const Block a11 = a.quadrant(0, 0), a12 = a.quadrant(0, 1);
+    const Block a21 = a.quadrant(1, 0), a22 = a.quadrant(1, 1);
+    const Block b11 = b.quadrant(0, 0), b12 = b.quadrant(0, 1);
+    const Block b21 = b.quadrant(1, 0), b22 = b.quadrant(1, 1);
+    const size_t words = product_words(hm, hk, hn, levels - 1, parallel - 1);
+
+    Block p[7];
+    pool.parallelFor(0, 7, 1, [&](size_t i) {
+        uint64_t* base = scratch + i * words;
+        const Block s = {base, hk, hm, hk};
+        const Block t = {base + hm * hk, hn, hk * 64, hn};
+        p[i] = {t.data + hk * 64 * hn, hn, hm, hn};
+        uint64_t* next = p[i].data + hm * hn;
+        Block x = a11, y = b11;
+        switch (i) {
+            case 0: break;                                     // P1 = A11 * B11
+            case 1: x = a12; y = b21; break;                   // P2 = A12 * B21
+            case 2:                                            // P3 = S4 * B22
+                xor_block(s, a11, a12);
+                xor_block(s, s, a21);
+                xor_block(s, s, a22);
+                x = s;
+                y = b22;
+                break;
+            case 3:                                            // P4 = A22 * T4
+                xor_block(t, b11, b12);
+                xor_block(t, t, b21);
+                xor_block(t, t, b22);
+                x = a22;
+                y = t;
+                break;
+            case 4:                                            // P5 = S1 * T1
+                xor_block(s, a21, a22);
+                xor_block(t, b12, b11);
+                x = s;
+                y = t;
+                break;
+            case 5:                                            // P6 = S2 * T2
+                xor_block(s, a21, a22);
+                xor_block(s, s, a11);
+                xor_block(t, b12, b11);
+                xor_block(t, t, b22);
+                x = s;
+                y = t;
+                break;
+            default:                                           // P7 = S3 * T3
+                xor_block(s, a11, a21);
+                xor_block(t, b22, b12);
+                x = s;
+                y = t;
+                break;
+        }
+        strassen_parallel(x, y, p[i], levels - 1, parallel - 1, next, pool);
+    });
+
+    // U = P1 + P6 is shared by three quadrants
+    pool.parallelFor(0, 4, 1, [&](size_t q) {
+        const Block dst = c.quadrant(q / 2, q % 2);
+        if (q == 0) {
+            xor_block(dst, p[0], p[1]);
+            return;
+        }
+        xor_block(dst, p[0], p[5]);
+        const int terms[3][2] = {{4, 2}, {6, 3}, {6, 4}};
+        xor_block(dst, dst, p[terms[q - 1][0]]);
+        xor_block(dst, dst, p[terms[q - 1][1]]);
+    });
+}
+
+size_t round_up(size_t value, size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+} // namespace
+
+GF2Matrix GF2Matrix::multiplyStrassen(const GF2Matrix& other, size_t cutoff,
+                                      GF2TaskPool* pool) const {
+    if (m_cols != other.m_rows) {
+        throw std::runtime_error("Matrix dimensions incompatible for multiplication");
+    }
+
+    GF2Matrix result(m_rows, other.m_cols);
+    multiplyStrassenInto(*this, other, result, cutoff, pool);
+    return result;
+}
+
+void GF2Matrix::multiplyStrassenInto(const GF2MatrixView& a_view, const GF2MatrixView& b_view,
+                                     const GF2MutableMatrixView& out, size_t cutoff,
+                                     GF2TaskPool* pool) {
+    if (a_view.cols() != b_view.rows()) {
+        throw std::runtime_error("Matrix dimensions incompatible for multiplication");
+    }
+    if (out.rows() != a_view.rows() || out.cols() != b_view.cols()) {
+        throw std::runtime_error("Output matrix has the wrong dimensions");
+    }
+    if (out.overlaps(a_view) || out.overlaps(b_view)) {
+        throw std::runtime_error("Output matrix must not alias an operand");
+    }
+    cutoff = std::max<size_t>(cutoff, 64);
+    GF2_TRACE_SCOPE("strassen");
+
+    // Number of halvings while every dimension stays above the crossover
+    int levels = 0;
+    size_t m = a_view.rows(), k = a_view.cols(), n = b_view.cols();
+    while (m > cutoff && k > cutoff && n > cutoff) {
+        m /= 2;
+        k /= 2;
+        n /= 2;
+        ++levels;
+    }
+
+    if (levels == 0) {
+        multiplyM4RInto(a_view, b_view, out);
+        return;
+    }
+
+    GF2Matrix a_copy(0, 0), b_copy(0, 0);
+    const GF2MatrixView src_a = a_view.aligned(a_copy);
+    const GF2MatrixView src_b = b_view.aligned(b_copy);
+    const size_t a_words = src_a.words_per_row();
+    const size_t b_words = src_b.words_per_row();
+
+    // Pad every dimension so it halves evenly 'levels' times
+    const size_t align = size_t(1) << levels;
+    const size_t pm = round_up(src_a.rows(), align);
+    const size_t pk = round_up(a_words, align);
+    const size_t pn = round_up(b_words, align);
+
+    // Parallel levels until there are about two products per worker: one
+    // level gives 7 tasks, two 49
+    int parallel = 0;
+    if (pool && pool->size() > 1) {
+        parallel = std::min(levels, pool->size() > 7 ? 2 : 1);
+    }
+    const size_t scratch_words = pm * pk + pk * 64 * pn + pm * pn +
+                                 parallel_scratch_words(pm, pk, pn, levels, parallel);
+    std::vector<uint64_t> scratch(scratch_words, 0);
+
+    Block a = {scratch.data(), pk, pm, pk};
+    Block b = {a.data + pm * pk, pn, pk * 64, pn};
+    Block c = {b.data + pk * 64 * pn, pn, pm, pn};
+
+    // Copy the operands into the padded blocks, masking A's unused columns
+    const uint64_t tail_mask = (src_a.cols() % 64) ? ((1ULL << (src_a.cols() % 64)) - 1) : ~0ULL;
+    for (size_t i = 0; i < src_a.rows(); ++i) {
+        std::memcpy(a.data + i * a.stride, src_a.get_raw_data() + i * src_a.row_stride(),
+                    a_words * sizeof(uint64_t));
+        a.data[i * a.stride + a_words - 1] &= tail_mask;
+    }
+    for (size_t i = 0; i < src_b.rows(); ++i) {
+        std::memcpy(b.data + i * b.stride, src_b.get_raw_data() + i * src_b.row_stride(),
+                    b_words * sizeof(uint64_t));
+    }
+
+    if (parallel > 0) {
+        pool->run([&] { strassen_parallel(a, b, c, levels, parallel, c.data + pm * pn, *pool); });
+    } else {
+        strassen_recursive(a, b, c, levels, c.data + pm * pn);
+    }
+
+    for (size_t i = 0; i < out.rows(); ++i) {
+        std::memcpy(out.get_raw_data() + i * out.row_stride(), c.data + i * c.stride,
+                    out.words_per_row() * sizeof(uint64_t));
+    }
+    out.clearPadding();
+}
@@ -0,0 +1,224 @@
+#include "GF2MatrixStream.hpp"
+#include "GF2Matrix.hpp"
+#include "GF2MatrixFile.hpp"
+#include "GF2MatrixView.hpp"
+#include "GF2PackedOperand.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <future>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Closes the descriptor on every way out
+struct FileDescriptor {
+    int fd;
+    ~FileDescriptor() {
+        if (fd >= 0) ::close(fd);
+    }
+};
+
+void read_fully(int fd, void* buffer, size_t bytes, size_t offset, const std::string& path) {
+    char* out = static_cast<char*>(buffer);
+    while (bytes > 0) {
+        const ssize_t n = ::pread(fd, out, bytes, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            throw std::runtime_error("Could not read " + path);
+        }
+        out += n;
+        bytes -= size_t(n);
+        offset += size_t(n);
+    }
+}
+
+void write_fully(int fd, const void* buffer, size_t bytes, size_t offset,
+                 const std::string& path) {
+    const char* in = static_cast<const char*>(buffer);
+    while (bytes > 0) {
+        const ssize_t n = ::pwrite(fd, in, bytes, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            throw std::runtime_error("Could not write " + path);
+        }
+        in += n;
+        bytes -= size_t(n);
+        offset += size_t(n);
+    }
+}
+
+// Row stride GF2Matrix gives a row of 'cols' columns
+size_t stride_of(size_t cols) {
+    const size_t align = GF2Matrix::ROW_ALIGN_WORDS;
+    return ((cols + 63) / 64 + align - 1) / align * align;
+}
+
+// A .gf2 file open for panel reads
+struct InputFile {
+    std::string path;
+    GF2FileHeader header;
+    FileDescriptor file{-1};
+
+    explicit InputFile(const std::string& p) : path(p) { file.fd = gf2_open(path, header); }
+
+    // Rows [r0, r1) and columns [c0, c1) as a matrix of their own; c0 is a
+    // multiple of 64 and c1 one or the last column, so whole words are read.
+    // Whole rows at the file's stride are read in one call.
+    GF2Matrix read(size_t r0, size_t r1, size_t c0, size_t c1) const {
+        GF2Matrix m(r1 - r0, c1 - c0);
+        const size_t stride = header.row_stride;
+        const size_t w0 = c0 / 64, words = m.words_per_row();
+        const size_t offset = header.data_offset + (r0 * stride + w0) * sizeof(uint64_t);
+        if (words == stride && m.row_stride() == stride) {
+            read_fully(file.fd, m.get_raw_data(), m.rows() * stride * sizeof(uint64_t), offset,
+                       path);
+        } else {
+            for (size_t i = 0; i < m.rows(); ++i) {
+                read_fully(file.fd, m.get_raw_data() + i * m.row_stride(),
+                           words * sizeof(uint64_t), offset + i * stride * sizeof(uint64_t),
+                           path);
+            }
+        }
+        return m;
+    }
+};
+
+} // namespace
+
+// The panels are sized from the budget: B's side gets half of it, two
+// buffers each holding a panel and the B^T (and kernel layout) prepared from
+// it in the read thread, so a third of a buffer is the panel itself. If all
+// of B fits in that half it is read once. The other half holds two row
+// panels of A and two of C, in whole PARALLEL_ROW_BLOCKs.
+GF2StreamStats gf2_multiply_files(const std::string& a_path, const std::string& b_path,
+                                  const std::string& c_path, const GF2StreamConfig& config) {
+    const Clock::time_point start = Clock::now();
+    const InputFile a_file(a_path), b_file(b_path);
+    const size_t m = a_file.header.rows, k = a_file.header.cols, n = b_file.header.cols;
+    if (b_file.header.rows != k) {
+        throw std::runtime_error("Matrix dimensions incompatible for multiplication");
+    }
+
+    const size_t budget = config.memory_bytes;
+    const size_t word_block = GF2Matrix::PARALLEL_COL_BLOCK / 64;
+    const size_t b_row_words = (n + 63) / 64;
+    size_t panel_words = std::max<size_t>(word_block,
+                                          budget / 4 / 3 / (std::max<size_t>(k, 1) * 8));
+    panel_words = panel_words / word_block * word_block;
+    const bool b_resident = 3 * k * stride_of(n) * 8 <= budget / 2 || panel_words >= b_row_words;
+    if (b_resident) {
+        panel_words = std::max<size_t>(b_row_words, 1);
+    }
+    const size_t col_panels = b_row_words == 0 ? 1 : (b_row_words + panel_words - 1) / panel_words;
+
+    const size_t row_block = GF2Matrix::PARALLEL_ROW_BLOCK;
+    const size_t row_bytes = (stride_of(k) + stride_of(n)) * sizeof(uint64_t);
+    size_t panel_rows = std::max<size_t>(row_block, budget / 2 / 2 / row_bytes);
+    panel_rows = std::min(panel_rows / row_block * row_block, std::max<size_t>(m, 1));
+    const size_t row_panels = (m + panel_rows - 1) / panel_rows;
+
+    GF2StreamStats stats;
+    stats.row_panels = row_panels;
+    stats.col_panels = col_panels;
+    std::atomic<size_t> bytes_read{0};
+
+    auto read_a = [&](size_t i) {
+        const size_t r0 = i * panel_rows, r1 = std::min(m, r0 + panel_rows);
+        GF2Matrix panel = a_file.read(r0, r1, 0, k);
+        bytes_read += (r1 - r0) * panel.words_per_row() * sizeof(uint64_t);
+        return panel;
+    };
+    auto read_b = [&](size_t j) {
+        const size_t c0 = j * panel_words * 64, c1 = std::min(n, c0 + panel_words * 64);
+        GF2Matrix panel = b_file.read(0, k, c0, c1);
+        bytes_read += k * panel.words_per_row() * sizeof(uint64_t);
+        return GF2PackedOperand(panel);
+    };
+
+    // C: the header's checksum is filled in once the last panel is out
+    const size_t c_stride = stride_of(n);
+    FileDescriptor c_file{::open(c_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)};
+    if (c_file.fd < 0) {
+        throw std::runtime_error("Could not create " + c_path);
+    }
+    const size_t c_bytes = GF2_FILE_ALIGNMENT + m * c_stride * sizeof(uint64_t);
+    if (::ftruncate(c_file.fd, static_cast<off_t>(c_bytes)) != 0) {
+        throw std::runtime_error("Could not write " + c_path);
+    }
+    GF2Checksum checksum;
+    auto write_c = [&](size_t i, const GF2Matrix& panel) {
+        const size_t words = panel.rows() * c_stride;
+        write_fully(c_file.fd, panel.get_raw_data(), words * sizeof(uint64_t),
+                    GF2_FILE_ALIGNMENT + i * panel_rows * c_stride * sizeof(uint64_t), c_path);
+        checksum.update(panel.get_raw_data(), words);
+    };
+
+    auto wait = [&](auto& future) {
+        const Clock::time_point t = Clock::now();
+        future.wait();
+        stats.stall_seconds += seconds_since(t);
+        return future.get();
+    };
+
+    std::future<GF2Matrix> next_a = std::async(std::launch::async, read_a, 0);
+    std::future<GF2PackedOperand> next_b = std::async(std::launch::async, read_b, 0);
+    std::unique_ptr<GF2PackedOperand> resident;
+    std::future<void> pending_write;
+    GF2Matrix writing(0, 0);
+
+    for (size_t i = 0; i < row_panels; ++i) {
+        const GF2Matrix a = wait(next_a);
+        if (i + 1 < row_panels) {
+            next_a = std::async(std::launch::async, read_a, i + 1);
+        }
+        GF2Matrix c(a.rows(), n);
+        for (size_t j = 0; j < col_panels; ++j) {
+            std::unique_ptr<GF2PackedOperand> b;
+            if (!resident) {
+                b = std::make_unique<GF2PackedOperand>(wait(next_b));
+                // The next panel in use order: j + 1 of this row panel, or the
+                // first one again for the next
+                if (j + 1 < col_panels) {
+                    next_b = std::async(std::launch::async, read_b, j + 1);
+                } else if (!b_resident && i + 1 < row_panels) {
+                    next_b = std::async(std::launch::async, read_b, 0);
+                }
+                if (b_resident) {
+                    resident = std::move(b);
+                }
+            }
+            const GF2PackedOperand& panel = resident ? *resident : *b;
+            const size_t c0 = j * panel_words * 64, c1 = std::min(n, c0 + panel_words * 64);
+            const Clock::time_point t = Clock::now();
+            GF2Matrix::addMul(c.mutableView(0, c.rows(), c0, c1), a, panel, config.num_threads);
+            stats.compute_seconds += seconds_since(t);
+        }
+        if (pending_write.valid()) {
+            wait(pending_write);
+        }
+        writing = std::move(c);
+        pending_write = std::async(std::launch::async, write_c, i, std::cref(writing));
+    }
+    if (pending_write.valid()) {
+        wait(pending_write);
+    }
+
+    const GF2FileHeader header = gf2_make_header(m, n, c_stride, checksum.value());
+    write_fully(c_file.fd, &header, sizeof(header), 0, c_path);
+
+    stats.bytes_read = bytes_read;
+    stats.bytes_written = c_bytes;
+    stats.wall_seconds = seconds_since(start);
+    return stats;
+}
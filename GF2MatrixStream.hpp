@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Memory budget and threads of gf2_multiply_files
+struct GF2StreamConfig {
+    // Bytes of panel buffers held at once (two of A, of B and of C); the
+    // panels are sized to fit it
+    size_t memory_bytes = size_t(1) << 30;
+    // OpenMP threads of the panel multiplies; <= 0 for the OpenMP default
+    int num_threads = 0;
+};
+
+// Where the time of a streamed multiply went. compute_seconds is the panel
+// multiplies; stall_seconds the waits for a read or a write that had not
+// finished when the compute needed it, which is zero when the I/O keeps up.
+struct GF2StreamStats {
+    double wall_seconds = 0.0;
+    double compute_seconds = 0.0;
+    double stall_seconds = 0.0;
+    size_t bytes_read = 0;
+    size_t bytes_written = 0;
+    size_t row_panels = 0;
+    size_t col_panels = 0;
+};
+
+// C = A * B for .gf2 files (GF2MatrixFile.hpp) larger than memory: C is
+// computed in row panels of A by column panels of B read from disk, each
+// pair multiplied by the in-memory SIMD kernel into a row panel of C that
+// is then written out. The next panel is read while the current one is
+// multiplied, and a finished C panel is written while the next is computed,
+// so the run is bound by the slower of the disk and the kernel. B is read
+// once per row panel of A unless a single column panel holds it, when it
+// stays in memory. Throws std::runtime_error if a file cannot be read or
+// written or the shapes do not match; c_path is then left incomplete.
+GF2StreamStats gf2_multiply_files(const std::string& a_path, const std::string& b_path,
+                                  const std::string& c_path,
+                                  const GF2StreamConfig& config = GF2StreamConfig());
@@ -0,0 +1,174 @@
+#include "GF2Matrix.hpp"
+#include "GF2Kernels.hpp"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <omp.h>
+
+namespace {
+
+// Matrices smaller than this many words are scanned on one thread
+constexpr size_t PARALLEL_MIN_WORDS = size_t(1) << 16;
+
+// Stripes of a content-hash chunk (256 KB), in whole rows
+constexpr size_t HASH_CHUNK_STRIPES = 4096;
+
+constexpr uint64_t HASH_PRIME64_1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t HASH_PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t HASH_PRIME64_3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t HASH_PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t HASH_PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t avalanche(uint64_t h) {
+    h ^= h >> 37;
+    h *= 0x165667919E3779F9ULL;
+    return h ^ (h >> 32);
+}
+
+inline uint64_t fold_multiply(uint64_t x, uint64_t y) {
+    const unsigned __int128 p = static_cast<unsigned __int128>(x) * y;
+    return uint64_t(p) ^ uint64_t(p >> 64);
+}
+
+// The lanes of rows [r0, r1), each row zero-padded to whole stripes: in
+// one call where the stride is that padded length already
+void hash_chunk(const GF2Matrix& m, size_t r0, size_t r1, uint64_t* acc) {
+    static const uint64_t INIT[HASH_STRIPE_WORDS] = {
+        uint64_t(0xC2B2AE3D), HASH_PRIME64_1, HASH_PRIME64_2, HASH_PRIME64_3,
+        HASH_PRIME64_4,       uint64_t(0x85EBCA77), HASH_PRIME64_5, HASH_PRIME32};
+    std::copy(INIT, INIT + HASH_STRIPE_WORDS, acc);
+    const RowKernel& kernel = row_kernel();
+    const size_t words = m.words_per_row();
+    const size_t padded = (words + HASH_STRIPE_WORDS - 1) / HASH_STRIPE_WORDS * HASH_STRIPE_WORDS;
+    const uint64_t* data = m.get_raw_data() + r0 * m.row_stride();
+    if (m.row_stride() == padded) {
+        kernel.hash_stripes(acc, data, (r1 - r0) * padded / HASH_STRIPE_WORDS, 0);
+        return;
+    }
+    const size_t full = words / HASH_STRIPE_WORDS;
+    size_t stripe = 0;
+    for (size_t r = r0; r < r1; ++r, data += m.row_stride()) {
+        kernel.hash_stripes(acc, data, full, stripe);
+        stripe += full;
+        if (full * HASH_STRIPE_WORDS < words) {
+            uint64_t tail[HASH_STRIPE_WORDS] = {};
+            std::copy(data + full * HASH_STRIPE_WORDS, data + words, tail);
+            kernel.hash_stripes(acc, tail, 1, stripe++);
+        }
+    }
+}
+
+} // namespace
+
+// One pass over the rows records their weights and first ones, 64 rows per
+// iteration so every word of the masks has one writer. The identity prefix
+// p then needs rows [0, p) to start at their own index and have no other
+// one before column p, and no later row to start before p.
+GF2Structure GF2Structure::scan(const GF2Matrix& m, int num_threads) {
+    const size_t rows = m.rows(), cols = m.cols();
+    const RowKernel& kernel = row_kernel();
+    GF2Structure s;
+    s.nonzero_rows.assign((rows + 63) / 64, 0);
+    s.nonzero_blocks.assign((s.nonzero_rows.size() + 63) / 64, 0);
+    std::vector<size_t> first(rows, cols);
+
+    const long long groups = static_cast<long long>(s.nonzero_rows.size());
+    const int threads = num_threads > 0 ? num_threads : omp_get_max_threads();
+    size_t ones = 0;
+    #pragma omp parallel for schedule(static) reduction(+ : ones) num_threads(threads) \
+        if (rows * m.words_per_row() >= PARALLEL_MIN_WORDS)
+    for (long long gg = 0; gg < groups; ++gg) {
+        const size_t r0 = size_t(gg) * 64, r1 = std::min(rows, r0 + 64);
+        uint64_t mask = 0;
+        for (size_t r = r0; r < r1; ++r) {
+            const size_t w = kernel.weight(m.get_raw_data() + r * m.row_stride(), m.words_per_row());
+            if (w) {
+                mask |= uint64_t(1) << (r - r0);
+                first[r] = m.firstSetBit(r);
+            }
+            ones += w;
+        }
+        s.nonzero_rows[size_t(gg)] = mask;
+    }
+
+    for (size_t g = 0; g < s.nonzero_rows.size(); ++g) {
+        const size_t in_group = std::min<size_t>(64, rows - g * 64);
+        s.zero_rows += in_group - size_t(__builtin_popcountll(s.nonzero_rows[g]));
+        if (s.nonzero_rows[g]) {
+            s.nonzero_blocks[g / 64] |= uint64_t(1) << (g % 64);
+        } else {
+            ++s.zero_row_blocks;
+        }
+    }
+    s.ones = ones;
+    s.density = rows && cols ? double(ones) / (double(rows) * double(cols)) : 0.0;
+
+    // The longest run of rows starting on the diagonal, the smallest second
+    // one of each prefix of it, and the smallest first one of each suffix
+    size_t run = 0;
+    while (run < std::min(rows, cols) && first[run] == run) ++run;
+    std::vector<size_t> later_first(rows + 1, cols);
+    for (size_t r = rows; r-- > 0;) {
+        later_first[r] = std::min(later_first[r + 1], first[r]);
+    }
+    size_t second = cols;
+    for (size_t p = 1; p <= run; ++p) {
+        second = std::min(second, m.firstSetBit(p - 1, p));
+        if (second >= p && later_first[p] >= p) {
+            s.identity_prefix = p;
+        }
+    }
+    return s;
+}
+
+// Each chunk's lanes start over and are chained into the total in chunk
+// order; the total's lanes are folded in pairs into each half, the shape
+// mixed in
+GF2ContentHash GF2Matrix::contentHash() const {
+    std::shared_ptr<const GF2ContentHash> h = std::atomic_load(&m_hash);
+    if (h) {
+        return *h;
+    }
+    const size_t row_stripes =
+        std::max<size_t>(1, (m_words_per_row + HASH_STRIPE_WORDS - 1) / HASH_STRIPE_WORDS);
+    const size_t chunk_rows = std::max<size_t>(1, HASH_CHUNK_STRIPES / row_stripes);
+    const size_t chunks = m_words_per_row == 0 ? 0 : (m_rows + chunk_rows - 1) / chunk_rows;
+    std::vector<uint64_t> lanes(chunks * HASH_STRIPE_WORDS);
+    const long long count = static_cast<long long>(chunks);
+    const bool parallel = chunks > 1 && m_rows * m_row_stride >= PARALLEL_MIN_WORDS;
+    #pragma omp parallel for schedule(static) if (parallel)
+    for (long long c = 0; c < count; ++c) {
+        const size_t r0 = size_t(c) * chunk_rows;
+        hash_chunk(*this, r0, std::min(m_rows, r0 + chunk_rows),
+                   lanes.data() + size_t(c) * HASH_STRIPE_WORDS);
+    }
+
+    uint64_t total[HASH_STRIPE_WORDS] = {};
+    for (size_t c = 0; c < chunks; ++c) {
+        for (size_t i = 0; i < HASH_STRIPE_WORDS; ++i) {
+            const uint64_t x = lanes[c * HASH_STRIPE_WORDS + i] + c * HASH_PRIME64_2;
+            total[i] = avalanche(total[i] ^ x) * HASH_PRIME64_1;
+        }
+    }
+    const uint64_t* secret = HASH_SECRET.words;
+    uint64_t lo = m_rows * HASH_PRIME64_1 ^ m_cols * HASH_PRIME64_4;
+    uint64_t hi = ~(m_rows * HASH_PRIME64_3 ^ m_cols * HASH_PRIME64_2);
+    for (size_t i = 0; i < HASH_STRIPE_WORDS; i += 2) {
+        lo += fold_multiply(total[i] ^ secret[i], total[i + 1] ^ secret[i + 1]);
+        hi += fold_multiply(total[i] ^ secret[i + 8], total[i + 1] ^ secret[i + 9]);
+    }
+    GF2ContentHash hash{avalanche(lo), avalanche(hi)};
+    auto computed = std::make_shared<const GF2ContentHash>(hash);
+    std::atomic_compare_exchange_strong(&m_hash, &h, computed);
+    return hash;
+}
+
+const GF2Structure& GF2Matrix::structure() const {
+    std::shared_ptr<const GF2Structure> s = std::atomic_load(&m_structure);
+    if (!s) {
+        auto scanned = std::make_shared<const GF2Structure>(GF2Structure::scan(*this));
+        // A concurrent first call may have stored its scan already
+        s = std::atomic_compare_exchange_strong(&m_structure, &s, scanned) ? scanned : s;
+    }
+    return *s;
+}
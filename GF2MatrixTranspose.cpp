@@ -0,0 +1,193 @@
+#include "GF2Matrix.hpp"
+#include "GF2MatrixView.hpp"
+#include "GF2Kernels.hpp"
+#include "GF2Trace.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Word-level bit-matrix transpose. Every 64x64 bit block is gathered into 64
+// words, transposed in registers with the recursive mask-and-shift (butterfly)
+// method and scattered to its mirrored position in the destination.
+
+// Number of 64x64 blocks along each side of a tile. A tile of 8x8 blocks is
+// 32 KiB of source plus 32 KiB of destination, which stays L1/L2 resident.
+static constexpr size_t TRANSPOSE_TILE_BLOCKS = 8;
+
+// One butterfly stage: for every pair of rows (k, k + j) with bit j of k
+// clear, swap the high j bits of row k with the low j bits of row k + j.
+static inline void transpose_stage_scalar(uint64_t* x, size_t j, uint64_t mask) {
+    for (size_t k = 0; k < 64; k = (k + j + 1) & ~j) {
+        uint64_t t = ((x[k] >> j) ^ x[k + j]) & mask;
+        x[k] ^= t << j;
+        x[k + j] ^= t;
+    }
+}
+
+void transpose_64x64(uint64_t* block) {
+    const uint64_t* masks = PARITY_TREE_MASKS;
+    size_t stage = 0;
+    size_t j = 32;
+
+#if defined(__x86_64__) || defined(_M_X64)
+    // The AVX2 stages live with the other AVX2 kernels, built with -mavx2
+    static const bool avx2 = std::strcmp(row_kernel().name, "scalar") != 0;
+    if (avx2) {
+        transpose_64x64_stages_avx2(block);
+        stage = 4;
+        j = 2;
+    }
+#elif defined(__ARM_NEON)
+    // Rows k, k+1 and k+j, k+j+1 are contiguous while j >= 2
+    for (; j >= 2; j >>= 1, ++stage) {
+        const uint64x2_t mask = vdupq_n_u64(masks[stage]);
+        const int64x2_t left = vdupq_n_s64(static_cast<int64_t>(j));
+        const int64x2_t right = vdupq_n_s64(-static_cast<int64_t>(j));
+        for (size_t k = 0; k < 64; k = (k + j + 2) & ~(j | 1)) {
+            uint64x2_t lo = vld1q_u64(block + k);
+            uint64x2_t hi = vld1q_u64(block + k + j);
+            uint64x2_t t = vandq_u64(veorq_u64(vshlq_u64(lo, right), hi), mask);
+            vst1q_u64(block + k, veorq_u64(lo, vshlq_u64(t, left)));
+            vst1q_u64(block + k + j, veorq_u64(hi, t));
+        }
+    }
+#endif
+
+    for (; j >= 1; j >>= 1, ++stage) {
+        transpose_stage_scalar(block, j, masks[stage]);
+    }
+}
+
+void transpose_matrix(const uint64_t* src, size_t src_stride,
+                      uint64_t* dst, size_t dst_stride,
+                      size_t rows, size_t cols) {
+    const size_t block_rows = (rows + 63) / 64; // source row blocks = dst words
+    const size_t block_cols = (cols + 63) / 64; // source words = dst row blocks
+    const size_t tile_rows = (block_rows + TRANSPOSE_TILE_BLOCKS - 1) / TRANSPOSE_TILE_BLOCKS;
+    const size_t tile_cols = (block_cols + TRANSPOSE_TILE_BLOCKS - 1) / TRANSPOSE_TILE_BLOCKS;
+    const long long num_tiles = static_cast<long long>(tile_rows * tile_cols);
+
+    #pragma omp parallel for schedule(static) if (num_tiles > 1)
+    for (long long tile = 0; tile < num_tiles; ++tile) {
+        const size_t bi0 = (static_cast<size_t>(tile) / tile_cols) * TRANSPOSE_TILE_BLOCKS;
+        const size_t bj0 = (static_cast<size_t>(tile) % tile_cols) * TRANSPOSE_TILE_BLOCKS;
+        const size_t bi1 = std::min(bi0 + TRANSPOSE_TILE_BLOCKS, block_rows);
+        const size_t bj1 = std::min(bj0 + TRANSPOSE_TILE_BLOCKS, block_cols);
+
+        alignas(64) uint64_t block[64];
+        for (size_t bi = bi0; bi < bi1; ++bi) {
+            const size_t r0 = bi * 64;
+            const size_t nr = std::min<size_t>(64, rows - r0);
+            for (size_t bj = bj0; bj < bj1; ++bj) {
+                const size_t c0 = bj * 64;
+                const size_t nc = std::min<size_t>(64, cols - c0);
+
+                // Rows past the end are zero so the destination padding stays clear
+                for (size_t r = 0; r < nr; ++r) {
+                    block[r] = src[(r0 + r) * src_stride + bj];
+                }
+                std::fill(block + nr, block + 64, 0);
+
+                transpose_64x64(block);
+
+                // Source padding bits land in rows >= cols, which are dropped
+                for (size_t c = 0; c < nc; ++c) {
+                    dst[(c0 + c) * dst_stride + bi] = block[c];
+                }
+            }
+        }
+    }
+}
+
+GF2Matrix GF2Transposed::materialize() const {
+    GF2_TRACE_SCOPE("transpose");
+    GF2Matrix result(rows(), cols());
+    transpose_matrix(m_m->get_raw_data(), m_m->row_stride(),
+                     result.get_raw_data(), result.row_stride(),
+                     m_m->rows(), m_m->cols());
+    return result;
+}
+
+GF2Matrix GF2Transposed::multiply(const GF2Matrix& b, int num_threads) const {
+    return m_m->multiplyAtB(b, num_threads);
+}
+
+// A^T * B^T is A^T materialized times B^T, or A^T times B^T materialized;
+// the transpose of fewer bits is the cheaper one
+GF2Matrix GF2Transposed::multiply(const GF2Transposed& b, int num_threads) const {
+    const GF2Matrix& a = *m_m;
+    const GF2Matrix& b_t = b.transpose();
+    if (a.rows() != b_t.cols()) {
+        throw std::runtime_error("Matrix dimensions incompatible for multiplication");
+    }
+    if (a.cols() <= b_t.rows()) {
+        return materialize().multiplyABt(b_t, num_threads);
+    }
+    return a.multiplyAtB(b.materialize(), num_threads);
+}
+
+void GF2Matrix::transposeInto(const GF2MatrixView& src, const GF2MutableMatrixView& dst) {
+    if (dst.rows() != src.cols() || dst.cols() != src.rows()) {
+        throw std::runtime_error("Output matrix has the wrong dimensions");
+    }
+    if (dst.overlaps(src)) {
+        throw std::runtime_error("Output matrix must not alias an operand");
+    }
+    GF2_TRACE_SCOPE("transpose");
+    GF2Matrix copy(0, 0);
+    const GF2MatrixView in = src.aligned(copy);
+    transpose_matrix(in.get_raw_data(), in.row_stride(), dst.get_raw_data(), dst.row_stride(),
+                     in.rows(), in.cols());
+}
+
+// Block (i, j) of the kept triangle is transposed over block (j, i), each
+// thread filling whole row blocks of the other triangle. A diagonal block
+// is its kept half ORed with that half's transpose.
+void GF2Matrix::mirrorTriangle(GF2Triangle triangle, int num_threads) {
+    if (m_rows != m_cols) {
+        throw std::runtime_error("Only square matrices have triangles to mirror");
+    }
+    const bool lower = triangle == GF2Triangle::Lower;
+    const long long row_blocks = static_cast<long long>(m_words_per_row);
+    uint64_t* data = m_data.data();
+    const size_t stride = m_row_stride;
+    const size_t n = m_rows;
+#ifdef _OPENMP
+    const int threads = num_threads > 0 ? num_threads : omp_get_max_threads();
+#else
+    (void)num_threads;
+#endif
+    invalidateStructure();
+    #pragma omp parallel for schedule(static, 1) num_threads(threads)
+    for (long long jj = 0; jj < row_blocks; ++jj) {
+        const size_t j = size_t(jj);
+        const size_t rows_j = std::min<size_t>(64, n - j * 64);
+        alignas(64) uint64_t block[64];
+        const size_t i0 = lower ? j : 0, i1 = lower ? size_t(row_blocks) : j + 1;
+        for (size_t i = i0; i < i1; ++i) {
+            const size_t rows_i = std::min<size_t>(64, n - i * 64);
+            for (size_t r = 0; r < 64; ++r) {
+                uint64_t word = r < rows_i ? data[(i * 64 + r) * stride + j] : 0;
+                if (i == j && r < rows_i) {
+                    const uint64_t diagonal = uint64_t(1) << r;
+                    word &= lower ? (diagonal << 1) - 1 : ~(diagonal - 1);
+                    data[(i * 64 + r) * stride + j] = word;
+                }
+                block[r] = word;
+            }
+            transpose_64x64(block);
+            for (size_t r = 0; r < rows_j; ++r) {
+                uint64_t& dst = data[(j * 64 + r) * stride + i];
+                dst = i == j ? dst | block[r] : block[r];
+            }
+        }
+    }
+}
@@ -0,0 +1,172 @@
+#include "GF2Matrix.hpp"
+#include "GF2MatrixView.hpp"
+#include "GF2Kernels.hpp"
+#include <algorithm>
+#include <omp.h>
+#include <stdexcept>
+#include <vector>
+
+// Triangular products and solves, b = T * b and b = T^-1 * b in place. With
+// T split after r0 rows and b likewise:
+//
+//   lower multiply: b1 = T11 * b1; b1 ^= T10 * b0; b0 = T00 * b0
+//   upper multiply: b0 = T00 * b0; b0 ^= T01 * b1; b1 = T11 * b1
+//   lower solve:    b0 = T00^-1 * b0; b1 ^= T10 * b0; b1 = T11^-1 * b1
+//   upper solve:    b1 = T11^-1 * b1; b0 ^= T01 * b1; b0 = T00^-1 * b0
+//
+// each step reading only halves it has not yet overwritten (or, for the
+// solves, those already solved). The zero block of T is never touched.
+
+namespace {
+
+// Rows of b per table in the blocks at the base of the recursion. A table
+// serves only the rows past its group, fewer than a multiply's, so it is
+// smaller than M4R_BITS: at 256 rows 16 entries of 4 rows beat 256 of 8.
+constexpr size_t GROUP_BITS = 4;
+
+inline uint64_t* row_of(const GF2MutableMatrixView& m, size_t i) {
+    return m.get_raw_data() + i * m.row_stride();
+}
+
+// The 'count' (<= 64) bits of row i of t from column col on, in the low bits
+inline uint64_t load_bits(const GF2MatrixView& t, size_t i, size_t col, size_t count) {
+    const uint64_t* row = t.get_raw_data() + i * t.row_stride();
+    const size_t bit = t.bit_offset() + col;
+    const size_t w = bit / 64, s = bit % 64;
+    uint64_t value = row[w] >> s;
+    if (s != 0 && s + count > 64) {
+        value |= row[w + 1] << (64 - s);
+    }
+    return count == 64 ? value : value & ((uint64_t(1) << count) - 1);
+}
+
+// One block of up to TRIANGULAR_BASE_ROWS rows, a group of GROUP_BITS rows of
+// b at a time in the order the dependencies run: upward for a lower multiply
+// and an upper solve, downward otherwise. A multiply tabulates the group's
+// rows as they are and overwrites each with the combination its row of T
+// picks within the group; a solve substitutes within the group and then
+// tabulates the solved rows. Either way the rows on the far side of the
+// diagonal (below the group for lower T, above it for upper) then each take
+// one table entry for their bits of T in the group's columns.
+void triangular_base(const GF2MatrixView& t, bool lower, bool solve, bool unit,
+                     const GF2MutableMatrixView& b, uint64_t* table) {
+    const size_t r = t.rows();
+    const size_t words = b.words_per_row();
+    const size_t groups = (r + GROUP_BITS - 1) / GROUP_BITS;
+    const bool upward = lower != solve;
+    for (size_t s = 0; s < groups; ++s) {
+        const size_t g0 = (upward ? groups - 1 - s : s) * GROUP_BITS;
+        const size_t n = std::min(GROUP_BITS, r - g0);
+        if (solve) {
+            for (size_t x = 0; x < n; ++x) {
+                const size_t p = lower ? x : n - 1 - x;
+                const uint64_t bits = load_bits(t, g0 + p, g0, n);
+                uint64_t* dst = row_of(b, g0 + p);
+                for (size_t q = lower ? 0 : p + 1; q < (lower ? p : n); ++q) {
+                    if ((bits >> q) & 1) {
+                        row_xor(dst, row_of(b, g0 + q), words);
+                    }
+                }
+            }
+            m4r_build_table(row_of(b, g0), b.row_stride(), n, words, table);
+        } else {
+            m4r_build_table(row_of(b, g0), b.row_stride(), n, words, table);
+            for (size_t p = 0; p < n; ++p) {
+                const uint64_t diagonal = uint64_t(1) << p;
+                uint64_t bits = load_bits(t, g0 + p, g0, n);
+                bits &= lower ? (diagonal << 1) - 1 : ~(diagonal - 1);
+                bits |= unit ? diagonal : 0;
+                std::copy_n(table + bits * words, words, row_of(b, g0 + p));
+            }
+        }
+        const size_t i0 = lower ? g0 + n : 0, i1 = lower ? r : g0;
+        for (size_t i = i0; i < i1; ++i) {
+            const uint64_t bits = load_bits(t, i, g0, n);
+            if (bits != 0) {
+                row_xor(row_of(b, i), table + bits * words, words);
+            }
+        }
+    }
+}
+
+void triangular_recursive(const GF2MatrixView& t, bool lower, bool solve, bool unit,
+                          const GF2MutableMatrixView& b, uint64_t* table, GF2Workspace& ws,
+                          int threads) {
+    const size_t r = t.rows();
+    if (r <= GF2Matrix::TRIANGULAR_BASE_ROWS) {
+        triangular_base(t, lower, solve, unit, b, table);
+        return;
+    }
+    const size_t r0 = (r / 2 + 63) / 64 * 64;
+    const GF2MatrixView t00 = t.view(0, r0, 0, r0), t11 = t.view(r0, r, r0, r);
+    const GF2MutableMatrixView b0 = b.mutableView(0, r0, 0, b.cols());
+    const GF2MutableMatrixView b1 = b.mutableView(r0, r, 0, b.cols());
+    const bool top_first = lower == solve;
+    triangular_recursive(top_first ? t00 : t11, lower, solve, unit, top_first ? b0 : b1, table,
+                         ws, threads);
+    if (lower) {
+        GF2Matrix::addMul(b1, t.view(r0, r, 0, r0), b0, ws, threads);
+    } else {
+        GF2Matrix::addMul(b0, t.view(0, r0, r0, r), b1, ws, threads);
+    }
+    triangular_recursive(top_first ? t11 : t00, lower, solve, unit, top_first ? b1 : b0, table,
+                         ws, threads);
+}
+
+int resolve_threads(int num_threads) {
+    return num_threads > 0 ? num_threads : omp_get_max_threads();
+}
+
+// Column blocks of whole cache lines (GF2Matrix::PARALLEL_COL_BLOCK), one
+// per thread; a single block keeps the threads for its multiplies instead
+void triangular(const GF2MatrixView& t, GF2Triangle triangle, const GF2MutableMatrixView& b,
+                bool unit, bool solve, int num_threads) {
+    if (t.rows() != t.cols()) {
+        throw std::runtime_error("Triangular matrix must be square");
+    }
+    if (t.rows() != b.rows()) {
+        throw std::runtime_error("Matrix dimensions incompatible for multiplication");
+    }
+    const bool lower = triangle == GF2Triangle::Lower;
+    if (solve && !unit) {
+        for (size_t i = 0; i < t.rows(); ++i) {
+            if (!t.get(i, i)) {
+                throw std::runtime_error("Triangular matrix is singular");
+            }
+        }
+    }
+    if (t.rows() == 0 || b.cols() == 0) {
+        return;
+    }
+
+    const int threads = resolve_threads(num_threads);
+    const size_t line = GF2Matrix::PARALLEL_COL_BLOCK / 64;
+    const size_t words = b.words_per_row();
+    const size_t share = (words + size_t(threads) - 1) / size_t(threads);
+    const size_t block_words = std::max(line, (share + line - 1) / line * line);
+    const long long blocks = static_cast<long long>((words + block_words - 1) / block_words);
+    const int inner_threads = blocks > 1 ? 1 : threads;
+    #pragma omp parallel for schedule(static) num_threads(threads) if (blocks > 1)
+    for (long long x = 0; x < blocks; ++x) {
+        const size_t c0 = size_t(x) * block_words * 64;
+        const size_t c1 = std::min(b.cols(), c0 + block_words * 64);
+        const GF2MutableMatrixView block = b.mutableView(0, b.rows(), c0, c1);
+        std::vector<uint64_t> table((size_t(1) << GROUP_BITS) * block.words_per_row());
+        GF2Workspace ws;
+        triangular_recursive(t, lower, solve, unit, block, table.data(), ws, inner_threads);
+    }
+}
+
+} // namespace
+
+void GF2Matrix::triangularMultiply(const GF2MatrixView& t, GF2Triangle triangle,
+                                   const GF2MutableMatrixView& b, bool unit_diagonal,
+                                   int num_threads) {
+    triangular(t, triangle, b, unit_diagonal, false, num_threads);
+}
+
+void GF2Matrix::triangularSolve(const GF2MatrixView& t, GF2Triangle triangle,
+                                const GF2MutableMatrixView& b, bool unit_diagonal,
+                                int num_threads) {
+    triangular(t, triangle, b, unit_diagonal, true, num_threads);
+}
@@ -0,0 +1,224 @@
+#include "GF2Matrix.hpp"
+#include "GF2Kernels.hpp"
+#include <algorithm>
+#include <cstring>
+#include <omp.h>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+// Rows of A per task of multiplyBlock
+constexpr size_t BLOCK_ROWS = 256;
+
+// Words of A one panel of leftMultiplyBlock covers: the eight 256-entry
+// tables of a word take 16 KiB, so a panel's stay in L2
+constexpr size_t LEFT_PANEL_WORDS = 8;
+
+// Below this many rows, building the tables costs more than the row XORs
+// they save, and the set bits of x are handled one by one
+constexpr size_t LEFT_TABLE_MIN_ROWS = 512;
+
+// Widest A (in words) whose A^T * B goes through the tables: each word is
+// a pass over B, and at 16384 x 8192 two of them cost less than B^T
+constexpr size_t AT_B_TABLE_MAX_WORDS = 2;
+
+// Result words one thread of leftMultiplyVector owns
+constexpr size_t LEFT_CHUNK_WORDS = 64;
+
+int resolve_threads(int num_threads) {
+    return num_threads > 0 ? num_threads : omp_get_max_threads();
+}
+
+// dst[0, dst_rows) (rows of width words at dst_stride) ^= the tables of one
+// panel: row 8t + b gets the XOR of the entries of table t whose index has
+// bit b set. The tables are folded in place, halving them once per bit.
+void fold_tables(uint64_t* tables, size_t width, uint64_t* dst, size_t dst_stride,
+                 size_t dst_rows = 64) {
+    for (size_t t = 0; t < M4R_TABLES; ++t) {
+        uint64_t* table = tables + t * M4R_TABLE_ROWS * width;
+        for (size_t half = M4R_TABLE_ROWS / 2, b = M4R_BITS - 1; half > 0; half /= 2, --b) {
+            uint64_t* out = dst + (t * M4R_BITS + b) * dst_stride;
+            for (size_t g = half; g < 2 * half && t * M4R_BITS + b < dst_rows; ++g) {
+                row_xor(out, table + g * width, width);
+            }
+            for (size_t g = 0; g < half; ++g) {
+                row_xor(table + g * width, table + (g + half) * width, width);
+            }
+        }
+    }
+}
+
+// The blocks of x^T * A for 'blocks' blocks of x: block z has its word r at
+// x + z + r * x_stride, and its 64 result rows (of A's words) at
+// y + 64 * z * y_stride, y_stride apart, the last one cut at y_rows rows.
+// y must be zero. A task is a block and a panel of A words, whose tables
+// of the panel's rows are then folded into the block's rows of y.
+void left_multiply_blocks(const GF2Matrix& m, const uint64_t* x, size_t x_stride, size_t blocks,
+                          uint64_t* y, size_t y_stride, size_t y_rows, int num_threads) {
+    const size_t words = m.words_per_row();
+    const size_t rows = m.rows();
+    const uint64_t* a = m.get_raw_data();
+    const size_t stride = m.row_stride();
+    if (words == 0 || blocks == 0) {
+        return;
+    }
+
+    const int threads = resolve_threads(num_threads);
+    // At least one task per thread where the rows are wide enough
+    const size_t panel_words = std::max<size_t>(
+        1, std::min(LEFT_PANEL_WORDS, (words * blocks + size_t(threads) - 1) / size_t(threads)));
+    const size_t panels = (words + panel_words - 1) / panel_words;
+    const long long tasks = static_cast<long long>(panels * blocks);
+    const bool use_tables = rows >= LEFT_TABLE_MIN_ROWS;
+
+    #pragma omp parallel num_threads(threads)
+    {
+        // Entry g of table t: the XOR of the panels of the rows whose byte t
+        // of x is g
+        std::vector<uint64_t> tables(use_tables ? M4R_TABLES * M4R_TABLE_ROWS * panel_words : 0);
+
+        #pragma omp for schedule(dynamic, 1)
+        for (long long task = 0; task < tasks; ++task) {
+            const size_t z = static_cast<size_t>(task) / panels;
+            const size_t p0 = (static_cast<size_t>(task) % panels) * panel_words;
+            const size_t width = std::min(panel_words, words - p0);
+            const uint64_t* xz = x + z;
+            uint64_t* yz = y + 64 * z * y_stride + p0;
+            if (!use_tables) {
+                // Bits of x past y_rows are zero
+                for (size_t r = 0; r < rows; ++r) {
+                    for (uint64_t bits = xz[r * x_stride]; bits; bits &= bits - 1) {
+                        row_xor(yz + size_t(__builtin_ctzll(bits)) * y_stride,
+                                a + r * stride + p0, width);
+                    }
+                }
+                continue;
+            }
+
+            std::fill(tables.begin(), tables.begin() + M4R_TABLES * M4R_TABLE_ROWS * width, 0);
+            for (size_t r = 0; r < rows; ++r) {
+                const uint64_t* row = a + r * stride + p0;
+                const uint64_t word = xz[r * x_stride];
+                for (size_t t = 0; t < M4R_TABLES; ++t) {
+                    const size_t g = (word >> (t * M4R_BITS)) & 0xFF;
+                    if (g) {
+                        row_xor(tables.data() + (t * M4R_TABLE_ROWS + g) * width, row, width);
+                    }
+                }
+            }
+            fold_tables(tables.data(), width, yz, y_stride, std::min<size_t>(64, y_rows - 64 * z));
+        }
+    }
+}
+
+} // namespace
+
+void GF2Matrix::multiplyVector(const uint64_t* x, uint64_t* y, int num_threads) const {
+    const size_t words = m_words_per_row;
+    const long long groups = static_cast<long long>((m_rows + 63) / 64);
+
+    // 64 rows per iteration, so every word of y has one writer
+    #pragma omp parallel for schedule(static) num_threads(resolve_threads(num_threads))
+    for (long long gg = 0; gg < groups; ++gg) {
+        const size_t r0 = static_cast<size_t>(gg) * 64;
+        const size_t r1 = std::min(m_rows, r0 + 64);
+        uint64_t out = 0;
+        for (size_t r = r0; r < r1; ++r) {
+            const uint64_t* row = m_data.data() + r * m_row_stride;
+            uint64_t acc = 0;
+            #pragma omp simd reduction(^ : acc)
+            for (size_t w = 0; w < words; ++w) {
+                acc ^= row[w] & x[w];
+            }
+            out |= uint64_t(__builtin_popcountll(acc) & 1) << (r - r0);
+        }
+        y[gg] = out;
+    }
+}
+
+void GF2Matrix::leftMultiplyVector(const uint64_t* x, uint64_t* y, int num_threads) const {
+    const size_t words = m_words_per_row;
+    const long long chunks = static_cast<long long>((words + LEFT_CHUNK_WORDS - 1) / LEFT_CHUNK_WORDS);
+
+    // Column chunks of y, each the XOR of the same chunk of the rows picked by x
+    #pragma omp parallel for schedule(static) num_threads(resolve_threads(num_threads))
+    for (long long cc = 0; cc < chunks; ++cc) {
+        const size_t w0 = static_cast<size_t>(cc) * LEFT_CHUNK_WORDS;
+        const size_t width = std::min(LEFT_CHUNK_WORDS, words - w0);
+        std::memset(y + w0, 0, width * sizeof(uint64_t));
+        for (size_t xw = 0; xw * 64 < m_rows; ++xw) {
+            uint64_t bits = x[xw];
+            if (xw * 64 + 64 > m_rows) {
+                bits &= (uint64_t(1) << (m_rows - xw * 64)) - 1;
+            }
+            for (; bits; bits &= bits - 1) {
+                const size_t r = xw * 64 + size_t(__builtin_ctzll(bits));
+                row_xor(y + w0, m_data.data() + r * m_row_stride + w0, width);
+            }
+        }
+    }
+}
+
+void GF2Matrix::multiplyBlock(const uint64_t* x, uint64_t* y, int num_threads) const {
+    // y is the rows() x 64 product A * X, so the dot-product kernel runs on
+    // A and X^T: 64 rows of cols() bits, transposed from x once
+    if (m_words_per_row == 0) {
+        std::memset(y, 0, m_rows * sizeof(uint64_t));
+        return;
+    }
+    const SimdKernel& kernel = simd_kernel();
+    const size_t stride = m_row_stride;
+    std::vector<uint64_t, GF2AlignedAllocator<uint64_t>> x_t(64 * stride, 0);
+    transpose_matrix(x, 1, x_t.data(), stride, m_cols, 64);
+
+    size_t k_words = (m_words_per_row + kernel.k_align - 1) / kernel.k_align * kernel.k_align;
+    k_words = std::min(k_words, stride);
+    const uint64_t* b_t = x_t.data();
+    size_t b_t_stride = stride;
+    std::vector<uint64_t, GF2AlignedAllocator<uint64_t>> packed;
+    if (kernel.pack_b) {
+        packed.resize(k_words * 64);
+        kernel.pack_b(x_t.data(), stride, 64, k_words, packed.data());
+        b_t = packed.data();
+        b_t_stride = k_words * 64;
+    }
+
+    const long long blocks = static_cast<long long>((m_rows + BLOCK_ROWS - 1) / BLOCK_ROWS);
+    #pragma omp parallel for schedule(static) num_threads(resolve_threads(num_threads))
+    for (long long bb = 0; bb < blocks; ++bb) {
+        const size_t i0 = static_cast<size_t>(bb) * BLOCK_ROWS;
+        const size_t i1 = std::min(m_rows, i0 + BLOCK_ROWS);
+        kernel.block(m_data.data(), stride, b_t, b_t_stride, y, 1, 64, i0, i1, 0, 1, 0, k_words,
+                     false);
+    }
+}
+
+void GF2Matrix::leftMultiplyBlock(const uint64_t* x, uint64_t* y, int num_threads) const {
+    std::memset(y, 0, 64 * m_words_per_row * sizeof(uint64_t));
+    left_multiply_blocks(*this, x, 1, 1, y, m_words_per_row, 64, num_threads);
+}
+
+// Up to AT_B_TABLE_MAX_WORDS, column block z of A (word z of its rows, 64
+// columns) is a block of x for x^T * B, giving rows [64z, 64z + 64) of the
+// product, and neither operand is transposed. Past it the transposes cost
+// less than the passes over B, and A^T runs the dot-product kernel against
+// B^T; A^T A needs a single transpose.
+GF2Matrix GF2Matrix::multiplyAtB(const GF2Matrix& b, int num_threads,
+                                 bool transpose_result) const {
+    if (transpose_result) {
+        return b.multiplyAtB(*this, num_threads);
+    }
+    if (m_rows != b.m_rows) {
+        throw std::runtime_error("Matrix dimensions incompatible for multiplication");
+    }
+    if (m_words_per_row > AT_B_TABLE_MAX_WORDS) {
+        const GF2Matrix a_t = transpose();
+        return &b == this ? a_t.multiplyABt(a_t, num_threads)
+                          : a_t.multiplySIMDParallel(b, num_threads);
+    }
+    GF2Matrix result(m_cols, b.m_cols);
+    left_multiply_blocks(b, m_data.data(), m_row_stride, m_words_per_row, result.m_data.data(),
+                         result.m_row_stride, m_cols, num_threads);
+    return result;
+}
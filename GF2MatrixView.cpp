@@ -0,0 +1,126 @@
+#include "GF2MatrixView.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+GF2MatrixView::GF2MatrixView(const GF2Matrix& m)
+    : GF2MatrixView(m.get_raw_data(), m.rows(), m.cols(), 0, m.row_stride(), m.row_stride()) {}
+
+GF2MatrixView GF2MatrixView::view(size_t row0, size_t row1, size_t col0, size_t col1) const {
+    if (row0 > row1 || row1 > m_rows || col0 > col1 || col1 > m_cols) {
+        throw std::runtime_error("View range out of bounds");
+    }
+    const size_t bit = m_bit_offset + col0;
+    const uint64_t* data = m_data + row0 * m_row_stride + bit / 64;
+    return GF2MatrixView(data, row1 - row0, col1 - col0, bit % 64, m_row_stride,
+                         m_storage_words - bit / 64);
+}
+
+bool GF2MatrixView::get(size_t row, size_t col) const {
+    if (row >= m_rows || col >= m_cols) return false;
+
+    const size_t bit = m_bit_offset + col;
+    return (m_data[row * m_row_stride + bit / 64] >> (bit % 64)) & 1ULL;
+}
+
+// Views at the same row stride overlap where their row and word ranges do,
+// counting the words of the upper one that run past the end of a row into
+// the next; views at different strides are compared by their address ranges
+bool GF2MatrixView::overlaps(const GF2MatrixView& other) const {
+    if (m_rows == 0 || other.m_rows == 0 || words_per_row() == 0 || other.words_per_row() == 0) {
+        return false;
+    }
+    const uintptr_t x0 = reinterpret_cast<uintptr_t>(m_data);
+    const uintptr_t y0 = reinterpret_cast<uintptr_t>(other.m_data);
+    const uintptr_t x1 = x0 + ((m_rows - 1) * m_row_stride + words_per_row()) * sizeof(uint64_t);
+    const uintptr_t y1 =
+        y0 + ((other.m_rows - 1) * other.m_row_stride + other.words_per_row()) * sizeof(uint64_t);
+    if (x1 <= y0 || y1 <= x0) {
+        return false;
+    }
+    if (m_row_stride != other.m_row_stride) {
+        return true;
+    }
+    // The upper view starts dr rows and dw words past the lower one
+    const bool this_first = x0 <= y0;
+    const GF2MatrixView& lo = this_first ? *this : other;
+    const GF2MatrixView& hi = this_first ? other : *this;
+    const size_t offset = (this_first ? y0 - x0 : x0 - y0) / sizeof(uint64_t);
+    const size_t dr = offset / m_row_stride, dw = offset % m_row_stride;
+    return (dr < lo.m_rows && dw < lo.words_per_row()) ||
+           (dw + hi.words_per_row() > m_row_stride && dr + 1 < lo.m_rows);
+}
+
+GF2Matrix GF2MatrixView::copy() const {
+    GF2Matrix out(m_rows, m_cols);
+    const size_t words = out.words_per_row();
+    const size_t s = m_bit_offset;
+    const uint64_t tail_mask = (m_cols % 64) ? ((1ULL << (m_cols % 64)) - 1) : ~0ULL;
+    for (size_t i = 0; i < m_rows; ++i) {
+        const uint64_t* src = m_data + i * m_row_stride;
+        uint64_t* dst = out.get_raw_data() + i * out.row_stride();
+        if (s == 0) {
+            std::copy_n(src, words, dst);
+        } else {
+            // Word w of the copy is the high bits of source word w and the
+            // low bits of word w + 1, which exists only while it holds columns
+            const size_t src_words = words_per_row();
+            for (size_t w = 0; w < words; ++w) {
+                uint64_t value = src[w] >> s;
+                if (w + 1 < src_words) {
+                    value |= src[w + 1] << (64 - s);
+                }
+                dst[w] = value;
+            }
+        }
+        if (words > 0) {
+            dst[words - 1] &= tail_mask;
+        }
+    }
+    return out;
+}
+
+GF2MatrixView GF2MatrixView::aligned(GF2Matrix& storage) const {
+    if (word_aligned()) {
+        return *this;
+    }
+    storage = copy();
+    return storage;
+}
+
+GF2MutableMatrixView::GF2MutableMatrixView(GF2Matrix& m) : GF2MatrixView(m) {
+    m.invalidateStructure();
+}
+
+GF2MutableMatrixView GF2MutableMatrixView::mutableView(size_t row0, size_t row1, size_t col0,
+                                                       size_t col1) const {
+    if (col0 % 64 != 0 || (col1 % 64 != 0 && col1 != m_cols)) {
+        throw std::runtime_error("Writable views must span whole words");
+    }
+    return GF2MutableMatrixView(view(row0, row1, col0, col1));
+}
+
+void GF2MutableMatrixView::set(size_t row, size_t col, bool value) const {
+    if (row >= m_rows || col >= m_cols) return;
+
+    uint64_t& word = get_raw_data()[row * m_row_stride + col / 64];
+    const uint64_t bit = 1ULL << (col % 64);
+    word = value ? word | bit : word & ~bit;
+}
+
+void GF2MutableMatrixView::clearPadding() const {
+    if (m_cols % 64 == 0) return;
+
+    const uint64_t mask = (1ULL << (m_cols % 64)) - 1;
+    const size_t last = words_per_row() - 1;
+    for (size_t i = 0; i < m_rows; ++i) {
+        get_raw_data()[i * m_row_stride + last] &= mask;
+    }
+}
+
+GF2MatrixView GF2Matrix::view(size_t row0, size_t row1, size_t col0, size_t col1) const {
+    return GF2MatrixView(*this).view(row0, row1, col0, col1);
+}
+
+GF2MutableMatrixView GF2Matrix::mutableView(size_t row0, size_t row1, size_t col0, size_t col1) {
+    return GF2MutableMatrixView(*this).mutableView(row0, row1, col0, col1);
+}
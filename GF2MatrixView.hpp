@@ -0,0 +1,93 @@
+#pragma once
+
+#include "GF2Matrix.hpp"
+#include <cstddef>
+#include <cstdint>
+
+// A non-owning window into a GF2Matrix: the rows [row0, row1) and columns
+// [col0, col1), read in place at the matrix's row stride, so blocked and
+// recursive algorithms can hand parts of a matrix to the kernels without
+// copying them. A view is valid as long as its matrix is alive and keeps its
+// shape.
+//
+// Views whose first column is a multiple of 64 are word aligned and are used
+// in place. Any other first column is the slow path: the kernels work on a
+// shifted copy of such a view (copy()).
+class GF2MatrixView {
+public:
+    // The whole matrix
+    GF2MatrixView(const GF2Matrix& m);
+
+    // Rows [row0, row1) and columns [col0, col1) of this view; throws
+    // std::runtime_error if the ranges are reversed or out of bounds
+    GF2MatrixView view(size_t row0, size_t row1, size_t col0, size_t col1) const;
+
+    // Row r starts at get_raw_data() + r * row_stride(); column 0 is bit
+    // bit_offset() of that word. words_per_row() words hold the columns,
+    // the last one possibly bits of columns of the matrix past the view.
+    size_t rows() const { return m_rows; }
+    size_t cols() const { return m_cols; }
+    size_t words_per_row() const { return (m_bit_offset + m_cols + 63) / 64; }
+    size_t row_stride() const { return m_row_stride; }
+    size_t bit_offset() const { return m_bit_offset; }
+    bool word_aligned() const { return m_bit_offset == 0; }
+    const uint64_t* get_raw_data() const { return m_data; }
+    // Words of each row that lie in the matrix's row storage and may be read
+    // past words_per_row() (by a kernel's vector step); at least
+    // words_per_row()
+    size_t storage_words() const { return m_storage_words; }
+
+    bool get(size_t row, size_t col) const;
+
+    // Whether this view and other share a word of storage
+    bool overlaps(const GF2MatrixView& other) const;
+
+    // The view's bits as a matrix of its own
+    GF2Matrix copy() const;
+    // This view if it is word aligned, else a view of its copy, made in
+    // 'storage'
+    GF2MatrixView aligned(GF2Matrix& storage) const;
+
+protected:
+    friend class GF2MappedMatrix;
+    friend class GF2ShmMatrix;
+
+    GF2MatrixView(const uint64_t* data, size_t rows, size_t cols, size_t bit_offset,
+                  size_t row_stride, size_t storage_words)
+        : m_data(data), m_rows(rows), m_cols(cols), m_bit_offset(bit_offset),
+          m_row_stride(row_stride), m_storage_words(storage_words) {}
+
+    const uint64_t* m_data;
+    size_t m_rows;
+    size_t m_cols;
+    size_t m_bit_offset;
+    size_t m_row_stride;
+    size_t m_storage_words;
+};
+
+// A view the kernels may write: the output of multiplyInto, addMul and
+// transposeInto. Its first column is a multiple of 64 and its last word
+// belongs to it alone (it ends at a multiple of 64 or at the matrix's last
+// column), so whole-word writes never touch columns outside it, and the
+// writers keep the bits past the matrix's last column zero.
+class GF2MutableMatrixView : public GF2MatrixView {
+public:
+    // The whole matrix; drops its cached structure()
+    GF2MutableMatrixView(GF2Matrix& m);
+
+    // As GF2MatrixView::view; throws std::runtime_error if col0 is not a
+    // multiple of 64, or col1 is neither that nor cols()
+    GF2MutableMatrixView mutableView(size_t row0, size_t row1, size_t col0, size_t col1) const;
+
+    uint64_t* get_raw_data() const { return const_cast<uint64_t*>(m_data); }
+
+    void set(size_t row, size_t col, bool value) const;
+    // Zero the bits past the last column of every row, for writers of whole
+    // words
+    void clearPadding() const;
+
+private:
+    friend class GF2ShmMatrix;
+
+    explicit GF2MutableMatrixView(const GF2MatrixView& v) : GF2MatrixView(v) {}
+};
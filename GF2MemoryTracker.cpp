@@ -0,0 +1,76 @@
+#include "GF2MemoryTracker.hpp"
+#include "GF2AlignedAllocator.hpp"
+#include "GF2Backend.hpp"
+#include <fstream>
+#include <string>
+
+namespace {
+
+// A "Name:   1234 kB" line of /proc/self/status in bytes, or -1
+long long status_bytes(const char* name) {
+#if defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    const std::string prefix = std::string(name) + ":";
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, prefix.size(), prefix) == 0) {
+            return std::stoll(line.substr(prefix.size())) * 1024;
+        }
+    }
+#else
+    (void)name;
+#endif
+    return -1;
+}
+
+// Sets VmHWM back to the current RSS (Linux 4.0 and later)
+bool reset_rss_peak() {
+#if defined(__linux__)
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+    clear_refs.close();
+    return !clear_refs.fail();
+#else
+    return false;
+#endif
+}
+
+} // namespace
+
+void GF2MemoryTracker::start(GF2Backend* gpu) {
+    _gpu = gpu;
+    if (_gpu) {
+        _gpu->resetPeakAllocated();
+    }
+    _rss_base = reset_rss_peak() ? status_bytes("VmRSS") : -1;
+    GF2StorageUsage& usage = GF2StorageUsage::get();
+    usage.resetPeak();
+    _host_base = usage.live.load();
+}
+
+GF2MemorySample GF2MemoryTracker::stop() {
+    GF2MemorySample sample;
+    const size_t host_peak = GF2StorageUsage::get().peak.load();
+    sample.host_bytes = host_peak > _host_base ? double(host_peak - _host_base) : 0.0;
+    if (_rss_base >= 0) {
+        const long long rss_peak = status_bytes("VmHWM");
+        if (rss_peak >= 0) {
+            sample.rss_bytes = rss_peak > _rss_base ? double(rss_peak - _rss_base) : 0.0;
+        }
+    }
+    if (_gpu) {
+        sample.gpu_bytes = double(_gpu->peakAllocatedBytes());
+    }
+    return sample;
+}
+
+std::string GF2MemoryTracker::describe(GF2Backend* gpu) const {
+    std::string sources = "allocator";
+    if (reset_rss_peak()) {
+        sources += " rss";
+    }
+    if (gpu) {
+        sources += " gpu";
+    }
+    return sources;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+class GF2Backend;
+
+// Peak memory of a timed region. The host figures are what the region
+// needed on top of what was allocated when it began (the operands are
+// already there); the GPU figure is all the backend held, as its pooled
+// buffers stay allocated between runs. Negative = not measured.
+struct GF2MemorySample {
+    double host_bytes = -1.0; // GF2AlignedAllocator storage (matrices, workspaces)
+    double rss_bytes = -1.0;  // resident set, allocations of any kind (Linux)
+    double gpu_bytes = -1.0;  // device memory of the GPU backend
+
+    bool valid() const { return host_bytes >= 0.0; }
+};
+
+// Peak memory of a region from three sources: the aligned allocator's own
+// count, which is exact but sees only GF2 storage; the process's resident
+// high-water mark (VmHWM, reset through /proc/self/clear_refs), which sees
+// everything but in pages; and the backend's allocated device memory.
+class GF2MemoryTracker {
+public:
+    // Resets the peaks; gpu may be null
+    void start(GF2Backend* gpu = nullptr);
+    GF2MemorySample stop();
+
+    // "allocator rss gpu", the sources a sample will have
+    std::string describe(GF2Backend* gpu) const;
+
+private:
+    GF2Backend* _gpu = nullptr;
+    size_t _host_base = 0;
+    long long _rss_base = -1; // bytes, -1 if the peak can't be reset
+};
@@ -0,0 +1,83 @@
+#include "GF2MetalBufferPool.hpp"
+#include "GF2AlignedAllocator.hpp"
+#include "GF2Metrics.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+GF2MetalBufferPool::GF2MetalBufferPool(MTL::Device* device, size_t max_cached_bytes)
+    : _device(device), _maxCachedBytes(max_cached_bytes), _cachedBytes(0) {}
+
+GF2MetalBufferPool::~GF2MetalBufferPool() { clear(); }
+
+size_t GF2MetalBufferPool::bucketSize(size_t bytes) {
+    const size_t page = gf2_page_size();
+    if (bytes <= page) return page;
+
+    // Four classes per octave: round up to a quarter of the leading power of two
+    size_t top = size_t(1) << (63 - __builtin_clzll(bytes));
+    size_t step = std::max(top / 4, page);
+    return (bytes + step - 1) / step * step;
+}
+
+MTL::Buffer* GF2MetalBufferPool::acquire(size_t bytes, MTL::StorageMode mode) {
+    const size_t size = bucketSize(bytes);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _free.find({mode, size});
+        if (it != _free.end() && !it->second.empty()) {
+            MTL::Buffer* buffer = it->second.back();
+            it->second.pop_back();
+            _cachedBytes -= size;
+            if (GF2Metrics::enabled()) {
+                GF2Metrics::add(GF2Counter::BufferPoolHits, 1);
+            }
+            return buffer;
+        }
+    }
+    if (GF2Metrics::enabled()) {
+        GF2Metrics::add(GF2Counter::BufferPoolMisses, 1);
+    }
+
+    // The storage mode sits at bit 4 of the options (MTLResourceStorageModeShift)
+    MTL::Buffer* buffer = _device->newBuffer(size, MTL::ResourceOptions(NS::UInteger(mode) << 4));
+    if (!buffer) {
+        throw std::runtime_error("Failed to allocate Metal buffer");
+    }
+    return buffer;
+}
+
+void GF2MetalBufferPool::recycle(MTL::Buffer* buffer) {
+    if (!buffer) return;
+
+    const size_t size = buffer->length();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_cachedBytes + size <= _maxCachedBytes) {
+            _free[{buffer->storageMode(), size}].push_back(buffer);
+            _cachedBytes += size;
+            return;
+        }
+    }
+    buffer->release();
+}
+
+void GF2MetalBufferPool::clear() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto& bucket : _free) {
+        for (MTL::Buffer* buffer : bucket.second) {
+            buffer->release();
+        }
+    }
+    _free.clear();
+    _cachedBytes = 0;
+}
+
+void GF2MetalBufferPool::setMaxCachedBytes(size_t bytes) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _maxCachedBytes = bytes;
+}
+
+size_t GF2MetalBufferPool::cachedBytes() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _cachedBytes;
+}
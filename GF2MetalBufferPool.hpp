@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Foundation/Foundation.hpp"
+#include "Metal/Metal.hpp"
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Size-bucketed cache of MTLBuffers. Creating a buffer maps fresh pages,
+// which at 64-512 sized matrices costs more than the kernel itself, so GF2GPU
+// takes its per-call buffers from here and hands them back once the command
+// buffer has completed. Buffers of different storage modes are kept apart.
+//
+// Sizes are rounded up to one of four classes per power of two (at most 25%
+// slack), with a minimum of one page. Returned buffers beyond the cache limit
+// are released instead of kept.
+class GF2MetalBufferPool {
+public:
+    static constexpr size_t DEFAULT_MAX_CACHED_BYTES = size_t(1) << 30;
+
+    explicit GF2MetalBufferPool(MTL::Device* device,
+                                size_t max_cached_bytes = DEFAULT_MAX_CACHED_BYTES);
+    ~GF2MetalBufferPool();
+
+    GF2MetalBufferPool(const GF2MetalBufferPool&) = delete;
+    GF2MetalBufferPool& operator=(const GF2MetalBufferPool&) = delete;
+
+    // A buffer of at least 'bytes' bytes. Its contents are undefined.
+    MTL::Buffer* acquire(size_t bytes, MTL::StorageMode mode = MTL::StorageModeShared);
+
+    // Hands a buffer obtained from acquire() back to the pool. The GPU must be
+    // done with it.
+    void recycle(MTL::Buffer* buffer);
+
+    // Releases all cached buffers
+    void clear();
+
+    void setMaxCachedBytes(size_t bytes);
+    size_t cachedBytes() const;
+
+private:
+    static size_t bucketSize(size_t bytes);
+
+    MTL::Device* _device;
+    size_t _maxCachedBytes;
+    size_t _cachedBytes;
+    // By storage mode and bucket size
+    std::map<std::pair<MTL::StorageMode, size_t>, std::vector<MTL::Buffer*>> _free;
+    mutable std::mutex _mutex;
+};
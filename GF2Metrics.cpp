@@ -0,0 +1,413 @@
+#include "GF2Metrics.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <tuple>
+#include <unordered_map>
+
+namespace {
+
+using Histogram = GF2LatencyHistogram;
+
+// The counts of one series on one thread
+struct Cell {
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> ns{0};
+    std::atomic<uint64_t> bit_ops{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> buckets[Histogram::BUCKETS] = {};
+};
+
+// The cells and counters one thread writes. The cells are made by their
+// thread and published with a release store for snapshot() to read.
+struct Shard {
+    std::atomic<Cell*> cells[GF2Metrics::MAX_SERIES] = {};
+    std::atomic<int64_t> counters[size_t(GF2Counter::Count)] = {};
+};
+
+// Only a shard's own thread adds to it, so a load and a store do
+template <typename T>
+inline void bump(std::atomic<T>& value, T delta) {
+    value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+struct SeriesInfo {
+    std::string backend, method, shape;
+};
+
+// Never destroyed: threads may record during static destruction
+struct Registry {
+    std::mutex mutex;
+    std::vector<SeriesInfo> series;
+    std::map<std::tuple<std::string, std::string, std::string>, size_t> index;
+    std::vector<Shard*> shards; // live and retired
+    std::vector<Shard*> retired; // of exited threads, for new ones to take
+
+    static Registry& get() {
+        static Registry* registry = new Registry;
+        return *registry;
+    }
+};
+
+// The calling thread's shard, handed on to a later thread when it exits;
+// its counts stay in the sums either way
+struct ShardHolder {
+    Shard* shard;
+    ShardHolder() {
+        Registry& r = Registry::get();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        if (!r.retired.empty()) {
+            shard = r.retired.back();
+            r.retired.pop_back();
+        } else {
+            shard = new Shard;
+            r.shards.push_back(shard);
+        }
+    }
+    ~ShardHolder() {
+        Registry& r = Registry::get();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.retired.push_back(shard);
+    }
+};
+
+Shard& thread_shard() {
+    thread_local ShardHolder holder;
+    return *holder.shard;
+}
+
+struct CacheKey {
+    const char* backend;
+    const char* method;
+    uint64_t shape; // the three log2 classes, 16 bits each
+
+    bool operator==(const CacheKey& o) const {
+        return backend == o.backend && method == o.method && shape == o.shape;
+    }
+};
+
+struct CacheKeyHash {
+    size_t operator()(const CacheKey& key) const {
+        const size_t h = std::hash<const void*>()(key.backend) * 31 +
+                         std::hash<const void*>()(key.method);
+        return h * 1000003 + std::hash<uint64_t>()(key.shape);
+    }
+};
+
+// ceil(log2(n)), 0 for n <= 1
+uint64_t size_class(size_t n) {
+    uint64_t c = 0;
+    while ((size_t(1) << c) < n) {
+        ++c;
+    }
+    return c;
+}
+
+std::string shape_label(uint64_t shape) {
+    std::ostringstream out;
+    for (int d = 0; d < 3; ++d) {
+        out << (d ? "x" : "") << (uint64_t(1) << ((shape >> (32 - 16 * d)) & 0xFFFF));
+    }
+    return out.str();
+}
+
+bool enabled_by_environment() {
+    const char* value = std::getenv("GF2_METRICS");
+    return !value || std::string(value) != "0";
+}
+
+// A Prometheus label value
+void write_label(std::ostream& out, const char* name, const std::string& value) {
+    out << name << "=\"";
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            out << '\\' << c;
+        } else if (c == '\n') {
+            out << "\\n";
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+void write_labels(std::ostream& out, const GF2MetricSeries& s, const char* extra = nullptr,
+                  const std::string& extra_value = std::string()) {
+    out << '{';
+    write_label(out, "backend", s.backend);
+    out << ',';
+    write_label(out, "method", s.method);
+    out << ',';
+    write_label(out, "shape", s.shape);
+    if (extra) {
+        out << ',';
+        write_label(out, extra, extra_value);
+    }
+    out << '}';
+}
+
+// Prometheus buckets of the exported histograms, in log2 nanoseconds
+constexpr unsigned FIRST_EXPORTED_BUCKET = 10;
+constexpr unsigned LAST_EXPORTED_BUCKET = 36;
+constexpr double EXPORTED_QUANTILES[] = {0.5, 0.9, 0.99, 0.999};
+
+} // namespace
+
+std::atomic<bool> GF2Metrics::s_enabled{enabled_by_environment()};
+
+// --- GF2LatencyHistogram ---
+
+size_t GF2LatencyHistogram::bucketOf(uint64_t ns) {
+    if (ns < (uint64_t(1) << SUB_BITS)) {
+        return size_t(ns);
+    }
+    const unsigned e = 63 - unsigned(__builtin_clzll(ns));
+    if (e > MAX_EXPONENT) {
+        return BUCKETS - 1;
+    }
+    const size_t sub = size_t(ns >> (e - SUB_BITS)) & ((size_t(1) << SUB_BITS) - 1);
+    return (size_t(e - SUB_BITS + 1) << SUB_BITS) + sub;
+}
+
+uint64_t GF2LatencyHistogram::bucketLower(size_t bucket) {
+    const size_t sub_buckets = size_t(1) << SUB_BITS;
+    if (bucket < sub_buckets) {
+        return bucket;
+    }
+    const unsigned e = unsigned(bucket >> SUB_BITS) + SUB_BITS - 1;
+    return uint64_t(sub_buckets + (bucket & (sub_buckets - 1))) << (e - SUB_BITS);
+}
+
+uint64_t GF2LatencyHistogram::bucketUpper(size_t bucket) {
+    return bucket + 1 < BUCKETS ? bucketLower(bucket + 1) : UINT64_MAX;
+}
+
+double GF2LatencyHistogram::percentile(double q) const {
+    if (count == 0) {
+        return 0.0;
+    }
+    const double target = std::min(std::max(q, 0.0), 1.0) * double(count);
+    uint64_t seen = 0;
+    for (size_t b = 0; b < BUCKETS; ++b) {
+        seen += counts[b];
+        if (counts[b] > 0 && double(seen) >= target) {
+            const uint64_t upper = bucketUpper(b);
+            return double(upper == UINT64_MAX ? bucketLower(b) : upper) / 1e9;
+        }
+    }
+    return double(bucketLower(BUCKETS - 1)) / 1e9;
+}
+
+uint64_t GF2LatencyHistogram::countBelow(uint64_t ns) const {
+    uint64_t below = 0;
+    for (size_t b = 0; b < BUCKETS && bucketUpper(b) <= ns; ++b) {
+        below += counts[b];
+    }
+    return below;
+}
+
+// --- GF2Metrics ---
+
+void GF2Metrics::setEnabled(bool enabled) { s_enabled.store(enabled, std::memory_order_relaxed); }
+
+size_t GF2Metrics::series(const char* backend, const char* method, size_t m, size_t k,
+                          size_t n) {
+    const CacheKey key{backend, method,
+                       (size_class(m) << 32) | (size_class(k) << 16) | size_class(n)};
+    thread_local std::unordered_map<CacheKey, size_t, CacheKeyHash> cache;
+    const auto cached = cache.find(key);
+    if (cached != cache.end()) {
+        return cached->second;
+    }
+
+    SeriesInfo info{backend, method, shape_label(key.shape)};
+    Registry& r = Registry::get();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    auto it = r.index.find({info.backend, info.method, info.shape});
+    if (it == r.index.end()) {
+        if (r.series.size() + 1 >= MAX_SERIES) {
+            info = {"other", "other", "other"};
+            it = r.index.find({info.backend, info.method, info.shape});
+        }
+        if (it == r.index.end()) {
+            it = r.index.emplace(std::make_tuple(info.backend, info.method, info.shape),
+                                 r.series.size()).first;
+            r.series.push_back(info);
+        }
+    }
+    cache.emplace(key, it->second);
+    return it->second;
+}
+
+void GF2Metrics::record(size_t series, uint64_t ns, uint64_t bit_ops, uint64_t bytes) {
+    Shard& shard = thread_shard();
+    Cell* cell = shard.cells[series].load(std::memory_order_relaxed);
+    if (!cell) {
+        cell = new Cell;
+        shard.cells[series].store(cell, std::memory_order_release);
+    }
+    bump(cell->calls, uint64_t(1));
+    bump(cell->ns, ns);
+    bump(cell->bit_ops, bit_ops);
+    bump(cell->bytes, bytes);
+    bump(cell->buckets[Histogram::bucketOf(ns)], uint64_t(1));
+}
+
+void GF2Metrics::add(GF2Counter counter, int64_t delta) {
+    bump(thread_shard().counters[size_t(counter)], delta);
+}
+
+// A snapshot taken while threads record may see a cell's calls and buckets
+// one call apart; every count is exact once they stop
+GF2MetricsSnapshot GF2Metrics::snapshot() {
+    GF2MetricsSnapshot snap;
+    Registry& r = Registry::get();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    snap.series.resize(r.series.size());
+    for (size_t i = 0; i < r.series.size(); ++i) {
+        snap.series[i].backend = r.series[i].backend;
+        snap.series[i].method = r.series[i].method;
+        snap.series[i].shape = r.series[i].shape;
+    }
+    for (const Shard* shard : r.shards) {
+        for (size_t c = 0; c < size_t(GF2Counter::Count); ++c) {
+            snap.counters[c] += shard->counters[c].load(std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < r.series.size(); ++i) {
+            const Cell* cell = shard->cells[i].load(std::memory_order_acquire);
+            if (!cell) {
+                continue;
+            }
+            GF2MetricSeries& s = snap.series[i];
+            s.latency.count += cell->calls.load(std::memory_order_relaxed);
+            s.latency.sum_ns += cell->ns.load(std::memory_order_relaxed);
+            s.bit_ops += cell->bit_ops.load(std::memory_order_relaxed);
+            s.bytes += cell->bytes.load(std::memory_order_relaxed);
+            for (size_t b = 0; b < Histogram::BUCKETS; ++b) {
+                s.latency.counts[b] += cell->buckets[b].load(std::memory_order_relaxed);
+            }
+        }
+    }
+    snap.series.erase(std::remove_if(snap.series.begin(), snap.series.end(),
+                                     [](const GF2MetricSeries& s) {
+                                         return s.latency.count == 0;
+                                     }),
+                      snap.series.end());
+    return snap;
+}
+
+// --- GF2MetricsSnapshot ---
+
+double GF2MetricsSnapshot::bufferPoolHitRate() const {
+    const int64_t hits = counter(GF2Counter::BufferPoolHits);
+    const int64_t acquires = hits + counter(GF2Counter::BufferPoolMisses);
+    return acquires > 0 ? double(hits) / double(acquires) : 0.0;
+}
+
+GF2MetricSeries GF2MetricsSnapshot::total(const std::string& backend,
+                                          const std::string& method) const {
+    GF2MetricSeries sum;
+    sum.backend = backend;
+    sum.method = method;
+    sum.shape = "all";
+    for (const GF2MetricSeries& s : series) {
+        if (s.backend != backend || s.method != method) {
+            continue;
+        }
+        sum.bit_ops += s.bit_ops;
+        sum.bytes += s.bytes;
+        sum.latency.count += s.latency.count;
+        sum.latency.sum_ns += s.latency.sum_ns;
+        for (size_t b = 0; b < GF2LatencyHistogram::BUCKETS; ++b) {
+            sum.latency.counts[b] += s.latency.counts[b];
+        }
+    }
+    return sum;
+}
+
+void GF2MetricsSnapshot::writePrometheus(std::ostream& out) const {
+    out << "# HELP gf2_multiply_duration_seconds Time of GF2Engine products.\n"
+        << "# TYPE gf2_multiply_duration_seconds histogram\n";
+    for (const GF2MetricSeries& s : series) {
+        for (unsigned e = FIRST_EXPORTED_BUCKET; e <= LAST_EXPORTED_BUCKET; ++e) {
+            std::ostringstream le;
+            le << double(uint64_t(1) << e) / 1e9;
+            out << "gf2_multiply_duration_seconds_bucket";
+            write_labels(out, s, "le", le.str());
+            out << ' ' << s.latency.countBelow(uint64_t(1) << e) << '\n';
+        }
+        out << "gf2_multiply_duration_seconds_bucket";
+        write_labels(out, s, "le", "+Inf");
+        out << ' ' << s.latency.count << '\n';
+        out << "gf2_multiply_duration_seconds_sum";
+        write_labels(out, s);
+        out << ' ' << double(s.latency.sum_ns) / 1e9 << '\n';
+        out << "gf2_multiply_duration_seconds_count";
+        write_labels(out, s);
+        out << ' ' << s.latency.count << '\n';
+    }
+
+    out << "# HELP gf2_multiply_duration_quantile_seconds Percentiles of the product times "
+           "(within 6.25%).\n"
+        << "# TYPE gf2_multiply_duration_quantile_seconds gauge\n";
+    for (const GF2MetricSeries& s : series) {
+        for (double q : EXPORTED_QUANTILES) {
+            std::ostringstream label;
+            label << q;
+            out << "gf2_multiply_duration_quantile_seconds";
+            write_labels(out, s, "quantile", label.str());
+            out << ' ' << s.latency.percentile(q) << '\n';
+        }
+    }
+
+    out << "# HELP gf2_multiply_bit_ops_total Bit products (m * k * n) multiplied.\n"
+        << "# TYPE gf2_multiply_bit_ops_total counter\n";
+    for (const GF2MetricSeries& s : series) {
+        out << "gf2_multiply_bit_ops_total";
+        write_labels(out, s);
+        out << ' ' << s.bit_ops << '\n';
+    }
+    out << "# HELP gf2_multiply_bytes_total Bytes of the operands and products.\n"
+        << "# TYPE gf2_multiply_bytes_total counter\n";
+    for (const GF2MetricSeries& s : series) {
+        out << "gf2_multiply_bytes_total";
+        write_labels(out, s);
+        out << ' ' << s.bytes << '\n';
+    }
+
+    struct Exported {
+        const char* name;
+        const char* type;
+        const char* help;
+        GF2Counter counter;
+    };
+    static const Exported counters[] = {
+        {"gf2_gpu_bytes_to_device_total", "counter", "Bytes copied to GPU devices.",
+         GF2Counter::GpuBytesToDevice},
+        {"gf2_gpu_bytes_from_device_total", "counter", "Bytes copied back from GPU devices.",
+         GF2Counter::GpuBytesFromDevice},
+        {"gf2_gpu_queue_depth", "gauge", "GPU command buffers committed and not completed.",
+         GF2Counter::GpuQueueDepth},
+        {"gf2_gpu_buffer_pool_hits_total", "counter", "Metal buffers reused from the pool.",
+         GF2Counter::BufferPoolHits},
+        {"gf2_gpu_buffer_pool_misses_total", "counter", "Metal buffers newly allocated.",
+         GF2Counter::BufferPoolMisses},
+    };
+    for (const Exported& c : counters) {
+        out << "# HELP " << c.name << ' ' << c.help << '\n'
+            << "# TYPE " << c.name << ' ' << c.type << '\n'
+            << c.name << ' ' << counter(c.counter) << '\n';
+    }
+    out << "# HELP gf2_gpu_buffer_pool_hit_ratio Share of buffer acquires served by the pool.\n"
+        << "# TYPE gf2_gpu_buffer_pool_hit_ratio gauge\n"
+        << "gf2_gpu_buffer_pool_hit_ratio " << bufferPoolHitRate() << '\n';
+}
+
+std::string GF2MetricsSnapshot::prometheus() const {
+    std::ostringstream out;
+    writePrometheus(out);
+    return out.str();
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Live metrics of the multiplies for services that embed the library:
+//   - per series (backend, method, shape bucket): a latency histogram, the
+//     calls, the bit products (m * k * n) and the operand and result bytes,
+//     recorded by GF2Engine::run around every product it runs;
+//   - process-wide counters: bytes moved to and from GPU devices, GPU
+//     command buffers in flight and Metal buffer-pool hits and misses.
+//
+// Every thread records into a shard of its own with relaxed single-writer
+// stores, so recording takes no lock once a thread has made the series'
+// cell; snapshot() sums the shards. The histograms are log-linear (HDR
+// style) over nanoseconds: 16 sub-buckets per power of two, so a
+// percentile is within 6.25% of the true value, up to 2^40 ns. Recording
+// is on unless GF2_METRICS=0; off, a recording point costs one relaxed
+// load.
+
+// A latency distribution of one series
+struct GF2LatencyHistogram {
+    static constexpr unsigned SUB_BITS = 4;
+    static constexpr unsigned MAX_EXPONENT = 39;
+    static constexpr size_t BUCKETS = ((MAX_EXPONENT - SUB_BITS + 2) << SUB_BITS);
+
+    std::vector<uint64_t> counts = std::vector<uint64_t>(BUCKETS);
+    uint64_t count = 0;
+    uint64_t sum_ns = 0;
+
+    // The bucket of a latency, and the latencies [lower, upper) of a bucket
+    static size_t bucketOf(uint64_t ns);
+    static uint64_t bucketLower(size_t bucket);
+    static uint64_t bucketUpper(size_t bucket);
+
+    // The latency at or below which a share q of the calls took, as the
+    // upper bound of its bucket, in seconds; 0 when empty
+    double percentile(double q) const;
+    double meanSeconds() const { return count ? double(sum_ns) / double(count) / 1e9 : 0.0; }
+    // Calls that took less than ns nanoseconds, exact when ns is a bucket
+    // boundary (as every power of two is)
+    uint64_t countBelow(uint64_t ns) const;
+};
+
+struct GF2MetricSeries {
+    std::string backend; // "CPU", or the GPU backend's name
+    std::string method;
+    std::string shape;   // m x k x n, each rounded up to a power of two
+    uint64_t bit_ops = 0;
+    uint64_t bytes = 0;
+    GF2LatencyHistogram latency;
+};
+
+// Process-wide counters, by index into GF2MetricsSnapshot::counters
+enum class GF2Counter {
+    GpuBytesToDevice,
+    GpuBytesFromDevice,
+    GpuQueueDepth, // a gauge: command buffers committed and not completed
+    BufferPoolHits,
+    BufferPoolMisses,
+    Count
+};
+
+struct GF2MetricsSnapshot {
+    std::vector<GF2MetricSeries> series;
+    int64_t counters[size_t(GF2Counter::Count)] = {};
+
+    int64_t counter(GF2Counter c) const { return counters[size_t(c)]; }
+    // Hits over acquires of the buffer pools; 0 before any
+    double bufferPoolHitRate() const;
+    // The series of a backend and method summed over shapes
+    GF2MetricSeries total(const std::string& backend, const std::string& method) const;
+
+    // Prometheus text exposition format (version 0.0.4): the histograms as
+    // gf2_multiply_duration_seconds, bucketed at the powers of two of
+    // nanoseconds from 2^10 (about 1 us) to 2^36 (about 69 s); their 0.5,
+    // 0.9, 0.99 and 0.999 percentiles as
+    // gf2_multiply_duration_quantile_seconds; and the counters
+    void writePrometheus(std::ostream& out) const;
+    std::string prometheus() const;
+};
+
+class GF2Metrics {
+public:
+    static bool enabled() { return s_enabled.load(std::memory_order_relaxed); }
+    static void setEnabled(bool enabled);
+
+    // The index of a series, made on first use. backend and method must
+    // outlive the process's use of metrics (string literals, the names of
+    // GF2Engine and the GPU backends); a thread looks them up by pointer
+    // in a cache of its own. Past MAX_SERIES - 1 series, the new ones all
+    // go into one labelled "other".
+    static constexpr size_t MAX_SERIES = 1024;
+    static size_t series(const char* backend, const char* method, size_t m, size_t k, size_t n);
+
+    // One call of a series that took ns nanoseconds over the given operands
+    static void record(size_t series, uint64_t ns, uint64_t bit_ops, uint64_t bytes);
+    static void add(GF2Counter counter, int64_t delta);
+
+    static GF2MetricsSnapshot snapshot();
+
+private:
+    static std::atomic<bool> s_enabled;
+};
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "GF2Kernels.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+// The register-tile family of dot-product microkernels, written once over
+// the vector registers of an instruction set and instantiated for a set of
+// tile shapes in each of the per-ISA translation units, with their flags.
+// A tile takes MR rows of A against NR rows of B^T at a time, keeping the
+// MR x NR partial sums in registers so every A vector is loaded once for NR
+// columns and every B^T vector once for MR rows, and unrolls the common
+// dimension KU vectors deep into independent sums, which shortens the
+// dependency chain of each accumulator. Which shape is fastest depends on
+// the register file, the load ports and the shape of the product, so the
+// instantiations are listed by simd_tile_kernels() for GF2Engine to time.
+//
+// V describes the registers: Reg, WORDS (64-bit words per register) and
+//   static Reg zero(), load(const uint64_t*) (unaligned), lane0(uint64_t)
+//   (the word in lane 0, the other lanes zero),
+//   template <GF2Semiring S> static Reg add(Reg, Reg), add_and(acc, a, b)
+//   (acc + (a & b)) and uint64_t reduce(Reg* acc) (the parity tree of 64
+//   accumulators, PARITY_TREE_SLOT order).
+// Only include it from those translation units, with V in an anonymous
+// namespace so that the instantiations of different flags never merge.
+
+// sum[r][n] = the dot products of a_rows[r] with b_rows[n] over k_words
+// words, in lanes still to be reduced. The words past the last whole
+// register are combined into lane 0.
+template <typename V, GF2Semiring S, int MR, int NR, int KU>
+inline void tile_dot(const uint64_t* const* a_rows, const uint64_t* const* b_rows,
+                     size_t k_words, typename V::Reg (*sum)[NR]) {
+    using Reg = typename V::Reg;
+    constexpr size_t W = V::WORDS;
+    Reg part[KU][MR][NR];
+    for (int u = 0; u < KU; ++u) {
+        for (int r = 0; r < MR; ++r) {
+            for (int n = 0; n < NR; ++n) part[u][r][n] = V::zero();
+        }
+    }
+
+    size_t k = 0;
+    for (; k + KU * W <= k_words; k += KU * W) {
+        for (int u = 0; u < KU; ++u) {
+            Reg b_vec[NR];
+            for (int n = 0; n < NR; ++n) b_vec[n] = V::load(b_rows[n] + k + u * W);
+            for (int r = 0; r < MR; ++r) {
+                const Reg a_vec = V::load(a_rows[r] + k + u * W);
+                for (int n = 0; n < NR; ++n) {
+                    part[u][r][n] = V::template add_and<S>(part[u][r][n], a_vec, b_vec[n]);
+                }
+            }
+        }
+    }
+    for (; k + W <= k_words; k += W) {
+        Reg b_vec[NR];
+        for (int n = 0; n < NR; ++n) b_vec[n] = V::load(b_rows[n] + k);
+        for (int r = 0; r < MR; ++r) {
+            const Reg a_vec = V::load(a_rows[r] + k);
+            for (int n = 0; n < NR; ++n) {
+                part[0][r][n] = V::template add_and<S>(part[0][r][n], a_vec, b_vec[n]);
+            }
+        }
+    }
+
+    for (int r = 0; r < MR; ++r) {
+        for (int n = 0; n < NR; ++n) {
+            Reg s = part[0][r][n];
+            for (int u = 1; u < KU; ++u) s = V::template add<S>(s, part[u][r][n]);
+            sum[r][n] = s;
+        }
+    }
+    if (k == k_words) return;
+    for (int r = 0; r < MR; ++r) {
+        for (int n = 0; n < NR; ++n) {
+            uint64_t t = 0;
+            for (size_t w = k; w < k_words; ++w) {
+                t = semiring_add<S>(t, a_rows[r][w] & b_rows[n][w]);
+            }
+            sum[r][n] = V::template add<S>(sum[r][n], V::lane0(t));
+        }
+    }
+}
+
+// The result words [jw0, jw1) of the MR rows from row i, over the
+// common-dimension words [k0, k1), NR columns per pass; the partial sums are
+// reduced once per output word as in the hand-written microkernels
+template <typename V, GF2Semiring S, int MR, int NR, int KU>
+void tile_microkernel(const uint64_t* a, size_t a_stride,
+                      const uint64_t* b_t, size_t b_t_stride,
+                      uint64_t* c, size_t c_stride, size_t b_cols,
+                      size_t i, size_t jw0, size_t jw1,
+                      size_t k0, size_t k1, bool accumulate) {
+    static_assert(64 % NR == 0, "the columns of a result word must split into whole tiles");
+    using Reg = typename V::Reg;
+    alignas(64) Reg acc[MR][64];
+    const size_t k_words = k1 - k0;
+
+    const uint64_t* a_rows[MR];
+    for (int r = 0; r < MR; ++r) {
+        a_rows[r] = a + (i + r) * a_stride + k0;
+    }
+
+    for (size_t jw = jw0; jw < jw1; ++jw) {
+        const size_t cols = std::min<size_t>(64, b_cols - jw * 64);
+
+        for (size_t col = 0; col < 64; col += NR) {
+            Reg sum[MR][NR];
+            if (col + NR <= cols) {
+                const uint64_t* b_rows[NR];
+                for (int n = 0; n < NR; ++n) {
+                    b_rows[n] = b_t + (jw * 64 + col + n) * b_t_stride + k0;
+                }
+                tile_dot<V, S, MR, NR, KU>(a_rows, b_rows, k_words, sum);
+            } else {
+                // Last, partial group of columns
+                for (int n = 0; n < NR; ++n) {
+                    Reg one[MR][1];
+                    if (col + n < cols) {
+                        const uint64_t* b_row = b_t + (jw * 64 + col + n) * b_t_stride + k0;
+                        tile_dot<V, S, MR, 1, KU>(a_rows, &b_row, k_words, one);
+                    } else {
+                        for (int r = 0; r < MR; ++r) one[r][0] = V::zero();
+                    }
+                    for (int r = 0; r < MR; ++r) sum[r][n] = one[r][0];
+                }
+            }
+
+            for (int r = 0; r < MR; ++r) {
+                for (int n = 0; n < NR; ++n) acc[r][PARITY_TREE_SLOT[col + n]] = sum[r][n];
+            }
+        }
+
+        for (int r = 0; r < MR; ++r) {
+            uint64_t word = V::template reduce<S>(acc[r]);
+            uint64_t& out = c[(i + r) * c_stride + jw];
+            out = accumulate ? semiring_add<S>(out, word) : word;
+        }
+    }
+}
+
+// A SimdBlockKernel made of tile_microkernel, the rows past the last whole
+// tile one at a time
+template <typename V, GF2Semiring S, int MR, int NR, int KU>
+void tile_block(const uint64_t* a, size_t a_stride,
+                const uint64_t* b_t, size_t b_t_stride,
+                uint64_t* c, size_t c_stride, size_t b_cols,
+                size_t i0, size_t i1, size_t jw0, size_t jw1,
+                size_t k0, size_t k1, bool accumulate) {
+    size_t i = i0;
+    for (; i + MR <= i1; i += MR) {
+        tile_microkernel<V, S, MR, NR, KU>(a, a_stride, b_t, b_t_stride, c, c_stride, b_cols,
+                                           i, jw0, jw1, k0, k1, accumulate);
+    }
+    for (; i < i1; ++i) {
+        tile_microkernel<V, S, 1, NR, KU>(a, a_stride, b_t, b_t_stride, c, c_stride, b_cols,
+                                          i, jw0, jw1, k0, k1, accumulate);
+    }
+}
+
+// The SimdKernel of one tile, named "<isa>-<MR>x<NR>x<KU>"
+#define GF2_TILE_KERNEL(V, isa, MR, NR, KU)                                      \
+    SimdKernel {                                                                 \
+        isa "-" #MR "x" #NR "x" #KU, tile_block<V, GF2Semiring::XorAnd, MR, NR, KU>, \
+            nullptr, V::WORDS, tile_block<V, GF2Semiring::OrAnd, MR, NR, KU>     \
+    }
+
+// The tiles every instruction set is instantiated for: the 4 x 1 of the
+// hand-written kernels, taller and wider tiles, and the k unrolls of two
+#define GF2_TILE_KERNELS(V, isa)                                                 \
+    {                                                                            \
+        GF2_TILE_KERNEL(V, isa, 4, 1, 1), GF2_TILE_KERNEL(V, isa, 8, 1, 1),      \
+        GF2_TILE_KERNEL(V, isa, 2, 2, 1), GF2_TILE_KERNEL(V, isa, 4, 2, 1),      \
+        GF2_TILE_KERNEL(V, isa, 2, 4, 1), GF2_TILE_KERNEL(V, isa, 1, 8, 1),      \
+        GF2_TILE_KERNEL(V, isa, 4, 1, 2), GF2_TILE_KERNEL(V, isa, 2, 2, 2),      \
+    }
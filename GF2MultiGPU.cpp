@@ -0,0 +1,297 @@
+#include "GF2MultiGPU.hpp"
+#include "GF2MatrixView.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+
+// Parts of a split are whole 64-row blocks
+constexpr size_t SPLIT_ROWS = 64;
+
+void copy_rows(const GF2Matrix& part, GF2Matrix& result, size_t row0) {
+    const size_t words = result.words_per_row();
+    for (size_t i = 0; i < part.rows(); ++i) {
+        std::memcpy(result.get_raw_data() + (row0 + i) * result.row_stride(),
+                    part.get_raw_data() + i * part.row_stride(), words * sizeof(uint64_t));
+    }
+}
+
+} // namespace
+
+GF2MultiGPU::GF2MultiGPU(std::vector<std::unique_ptr<GF2GPU>> gpus) : _gpus(std::move(gpus)) {
+    if (_gpus.empty()) {
+        throw std::runtime_error("GF2MultiGPU needs at least one device");
+    }
+    _shares.assign(_gpus.size(), 1.0 / double(_gpus.size()));
+}
+
+std::vector<double> GF2MultiGPU::shares() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _shares;
+}
+
+void GF2MultiGPU::setShares(const std::vector<double>& shares) {
+    if (shares.size() != _gpus.size()) {
+        throw std::runtime_error("One share per device expected");
+    }
+    const double total = std::accumulate(shares.begin(), shares.end(), 0.0);
+    if (!(total > 0.0) || *std::min_element(shares.begin(), shares.end()) < 0.0) {
+        throw std::runtime_error("Shares must be non-negative with a positive sum");
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (size_t d = 0; d < shares.size(); ++d) {
+        _shares[d] = shares[d] / total;
+    }
+}
+
+std::string GF2MultiGPU::deviceName() const {
+    std::string name;
+    for (const auto& gpu : _gpus) {
+        name += (name.empty() ? "" : " + ") + gpu->deviceName();
+    }
+    return name;
+}
+
+bool GF2MultiGPU::supports(Kernel kernel) {
+    for (const auto& gpu : _gpus) {
+        if (!gpu->supports(kernel)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Device d takes rows [bounds[d], bounds[d + 1]), at least one block each
+void GF2MultiGPU::multiply(Kernel kernel, const GF2Matrix& a, const GF2Matrix& b,
+                           GF2Matrix& result) {
+    if (a.cols() != b.rows()) {
+        throw std::runtime_error("Matrix dimensions don't match for multiplication");
+    }
+    if (result.rows() != a.rows() || result.cols() != b.cols()) {
+        throw std::runtime_error("Output matrix has the wrong dimensions");
+    }
+    const size_t devices = _gpus.size(), rows = a.rows();
+    if (devices == 1 || rows < devices * MIN_ROWS_PER_DEVICE) {
+        onPrimary().multiply(kernel, a, b, result);
+        return;
+    }
+
+    const std::vector<double> share = shares();
+    const size_t blocks = (rows + SPLIT_ROWS - 1) / SPLIT_ROWS;
+    std::vector<size_t> bounds(devices + 1, 0);
+    double cumulative = 0.0;
+    for (size_t d = 1; d < devices; ++d) {
+        cumulative += share[d - 1];
+        size_t block = static_cast<size_t>(cumulative * double(blocks) + 0.5);
+        block = std::max(block, bounds[d - 1] / SPLIT_ROWS + 1);
+        block = std::min(block, blocks - (devices - d));
+        bounds[d] = block * SPLIT_ROWS;
+    }
+    bounds[devices] = rows;
+
+    std::vector<GF2Matrix> a_parts, c_parts;
+    a_parts.reserve(devices);
+    c_parts.reserve(devices);
+    for (size_t d = 0; d < devices; ++d) {
+        a_parts.push_back(GF2MatrixView(a).view(bounds[d], bounds[d + 1], 0, a.cols()).copy());
+        c_parts.emplace_back(bounds[d + 1] - bounds[d], b.cols());
+    }
+    std::vector<std::vector<Item>> items(devices);
+    std::vector<double> work(devices);
+    for (size_t d = 0; d < devices; ++d) {
+        items[d].push_back(Item{&a_parts[d], &b, &c_parts[d]});
+        work[d] = double(bounds[d + 1] - bounds[d]);
+    }
+    const std::vector<double> ms = runOnDevices(kernel, items);
+    for (size_t d = 0; d < devices; ++d) {
+        copy_rows(c_parts[d], result, bounds[d]);
+    }
+    updateShares(work, ms);
+}
+
+void GF2MultiGPU::multiplyBatch(Kernel kernel, const std::vector<const GF2Matrix*>& as,
+                                const std::vector<const GF2Matrix*>& bs,
+                                const std::vector<GF2Matrix*>& results) {
+    if (as.size() != bs.size() || as.size() != results.size()) {
+        throw std::runtime_error("Batch operand counts differ");
+    }
+    std::vector<double> work(as.size());
+    for (size_t i = 0; i < as.size(); ++i) {
+        if (as[i]->cols() != bs[i]->rows()) {
+            throw std::runtime_error("Matrix dimensions don't match for multiplication");
+        }
+        if (results[i]->rows() != as[i]->rows() || results[i]->cols() != bs[i]->cols()) {
+            throw std::runtime_error("Output matrix has the wrong dimensions");
+        }
+        work[i] = double(as[i]->rows()) * double(as[i]->cols()) * double(bs[i]->cols());
+    }
+    std::vector<size_t> order(as.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_t x, size_t y) { return work[x] > work[y]; });
+
+    // A device's share is its throughput relative to the others, so
+    // load / share is when it would be done
+    const std::vector<double> share = shares();
+    const size_t devices = _gpus.size();
+    std::vector<std::vector<Item>> items(devices);
+    std::vector<double> load(devices, 0.0);
+    for (size_t i : order) {
+        size_t best = 0;
+        double best_finish = 0.0;
+        for (size_t d = 0; d < devices; ++d) {
+            const double finish = share[d] > 0.0 ? (load[d] + work[i]) / share[d] : HUGE_VAL;
+            if (d == 0 || finish < best_finish) {
+                best = d;
+                best_finish = finish;
+            }
+        }
+        load[best] += work[i];
+        items[best].push_back(Item{as[i], bs[i], results[i]});
+    }
+    const std::vector<double> ms = runOnDevices(kernel, items);
+    updateShares(load, ms);
+}
+
+// Submissions go out from this thread, device after device, and complete
+// on Metal's; a failed submission stops the rest, and what was submitted
+// is waited for before the first error is thrown
+std::vector<double> GF2MultiGPU::runOnDevices(Kernel kernel,
+                                              const std::vector<std::vector<Item>>& items) {
+    using Clock = std::chrono::steady_clock;
+    const size_t devices = _gpus.size();
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t in_flight = 0;
+    std::exception_ptr error;
+    bool submitted_all = true;
+    std::vector<Clock::time_point> start(devices), finish(devices);
+    std::vector<double> ms(devices, 0.0);
+
+    for (size_t d = 0; d < devices && submitted_all; ++d) {
+        start[d] = Clock::now();
+        for (const Item& item : items[d]) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ++in_flight;
+            }
+            try {
+                _gpus[d]->multiplyAsync(kernel, *item.a, *item.b, *item.result,
+                                        [&, d](std::exception_ptr e) {
+                                            std::lock_guard<std::mutex> lock(mutex);
+                                            if (e && !error) error = e;
+                                            finish[d] = Clock::now();
+                                            if (--in_flight == 0) done.notify_all();
+                                        });
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                --in_flight;
+                if (!error) error = std::current_exception();
+                submitted_all = false;
+                break;
+            }
+        }
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return in_flight == 0; });
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    GF2GPUTiming timing;
+    for (size_t d = 0; d < devices; ++d) {
+        if (items[d].empty()) continue;
+        ms[d] = std::chrono::duration<double, std::milli>(finish[d] - start[d]).count();
+        const GF2GPUTiming t = _gpus[d]->lastTiming();
+        timing.host_ms = std::max(timing.host_ms, t.host_ms);
+        timing.upload_ms = std::max(timing.upload_ms, t.upload_ms);
+        timing.gpu_ms = std::max(timing.gpu_ms, t.gpu_ms);
+        timing.readback_ms = std::max(timing.readback_ms, t.readback_ms);
+    }
+    std::lock_guard<std::mutex> state(_mutex);
+    _timing = timing;
+    _split = true;
+    return ms;
+}
+
+// Devices that had no work, or no measurable time, keep their share
+void GF2MultiGPU::updateShares(const std::vector<double>& work, const std::vector<double>& ms) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    double measured_share = 0.0, rate_sum = 0.0;
+    size_t measured = 0;
+    for (size_t d = 0; d < _shares.size(); ++d) {
+        if (work[d] > 0.0 && ms[d] > 0.0) {
+            measured_share += _shares[d];
+            rate_sum += work[d] / ms[d];
+            ++measured;
+        }
+    }
+    if (measured < 2) {
+        return;
+    }
+    for (size_t d = 0; d < _shares.size(); ++d) {
+        if (work[d] > 0.0 && ms[d] > 0.0) {
+            const double target = measured_share * (work[d] / ms[d]) / rate_sum;
+            _shares[d] = 0.5 * _shares[d] + 0.5 * target;
+        }
+    }
+}
+
+GF2GPU& GF2MultiGPU::onPrimary() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _split = false;
+    return primary();
+}
+
+void GF2MultiGPU::multiplyBlock(const GF2Matrix& a, const uint64_t* x, uint64_t* y) {
+    onPrimary().multiplyBlock(a, x, y);
+}
+
+void GF2MultiGPU::leftMultiplyBlock(const GF2Matrix& a, const uint64_t* x, uint64_t* y) {
+    onPrimary().leftMultiplyBlock(a, x, y);
+}
+
+void GF2MultiGPU::multiplyABt(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result) {
+    onPrimary().multiplyABt(a, b, result);
+}
+
+void GF2MultiGPU::multiplyAtB(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result) {
+    onPrimary().multiplyAtB(a, b, result);
+}
+
+void GF2MultiGPU::multiplyAAt(const GF2Matrix& a, GF2Matrix& result, GF2Triangle triangle,
+                              bool mirror) {
+    onPrimary().multiplyAAt(a, result, triangle, mirror);
+}
+
+void GF2MultiGPU::multiplyTiled(const GF2TiledMatrix& a, const GF2TiledMatrix& b,
+                                GF2TiledMatrix& result) {
+    onPrimary().multiplyTiled(a, b, result);
+}
+
+GF2GPUTiming GF2MultiGPU::lastTiming() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _split ? _timing : _gpus.front()->lastTiming();
+}
+
+size_t GF2MultiGPU::allocatedBytes() const {
+    size_t bytes = 0;
+    for (const auto& gpu : _gpus) bytes += gpu->allocatedBytes();
+    return bytes;
+}
+
+size_t GF2MultiGPU::peakAllocatedBytes() const {
+    size_t bytes = 0;
+    for (const auto& gpu : _gpus) bytes += gpu->peakAllocatedBytes();
+    return bytes;
+}
+
+void GF2MultiGPU::resetPeakAllocated() {
+    for (const auto& gpu : _gpus) gpu->resetPeakAllocated();
+}
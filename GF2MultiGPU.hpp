@@ -0,0 +1,89 @@
+#pragma once
+
+#include "GF2GPU.hpp"
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Every Metal device of a host as one backend, for a Mac Pro with several
+// GPUs or a Mac with an eGPU. multiply() splits the rows of A over the
+// devices in proportion to the throughput each showed on the previous
+// splits, runs the parts at once (asynchronously, one command queue and
+// set of pipelines per device) and gathers them into the result.
+// multiplyBatch() spreads independent products over the devices the same
+// way. Products of fewer than MIN_ROWS_PER_DEVICE rows per device, and the
+// other GF2Backend operations, run on the primary (system default) device.
+class GF2MultiGPU : public GF2Backend {
+public:
+    // Rows of A every device gets at least before a product is split
+    static constexpr size_t MIN_ROWS_PER_DEVICE = 256;
+
+    // gpus must hold at least one backend; the first is the primary
+    explicit GF2MultiGPU(std::vector<std::unique_ptr<GF2GPU>> gpus);
+
+    size_t deviceCount() const { return _gpus.size(); }
+    GF2GPU& device(size_t i) { return *_gpus[i]; }
+    GF2GPU& primary() { return *_gpus.front(); }
+
+    // The share of rows (or of bit operations, for batches) the next split
+    // gives each device, summing to 1; all equal before the first split
+    std::vector<double> shares() const;
+    void setShares(const std::vector<double>& shares);
+
+    // The products results[i] = as[i] * bs[i], each on one device: the
+    // largest first, each to the device that would finish it soonest at
+    // its measured throughput. Sizes must match as in multiply().
+    void multiplyBatch(Kernel kernel, const std::vector<const GF2Matrix*>& as,
+                       const std::vector<const GF2Matrix*>& bs,
+                       const std::vector<GF2Matrix*>& results);
+
+    // --- GF2Backend ---
+    const char* backendName() const override { return "Metal"; }
+    // The devices' names joined by " + "
+    std::string deviceName() const override;
+    bool supports(Kernel kernel) override;
+    using GF2Backend::multiply;
+    void multiply(Kernel kernel, const GF2Matrix& a, const GF2Matrix& b,
+                  GF2Matrix& result) override;
+    void multiplyBlock(const GF2Matrix& a, const uint64_t* x, uint64_t* y) override;
+    void leftMultiplyBlock(const GF2Matrix& a, const uint64_t* x, uint64_t* y) override;
+    void multiplyABt(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result) override;
+    void multiplyAtB(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result) override;
+    void multiplyAAt(const GF2Matrix& a, GF2Matrix& result, GF2Triangle triangle,
+                     bool mirror) override;
+    void multiplyTiled(const GF2TiledMatrix& a, const GF2TiledMatrix& b,
+                       GF2TiledMatrix& result) override;
+    // Of a split multiply, each phase's longest among the devices
+    GF2GPUTiming lastTiming() const override;
+    // Summed over the devices
+    size_t allocatedBytes() const override;
+    size_t peakAllocatedBytes() const override;
+    void resetPeakAllocated() override;
+
+private:
+    // The devices' work items of one split: each runs its items in order
+    // with multiplyAsync and the elapsed time of each device is measured
+    // from its first submission to its last completion
+    struct Item {
+        const GF2Matrix* a;
+        const GF2Matrix* b;
+        GF2Matrix* result;
+    };
+    std::vector<double> runOnDevices(Kernel kernel,
+                                     const std::vector<std::vector<Item>>& items);
+    // Moves the shares halfway towards the split that would have made every
+    // device finish together, from the work and time of each
+    void updateShares(const std::vector<double>& work, const std::vector<double>& ms);
+
+    // The primary device, for a call whose timing lastTiming() then reports
+    // as the primary's own
+    GF2GPU& onPrimary();
+
+    std::vector<std::unique_ptr<GF2GPU>> _gpus;
+    mutable std::mutex _mutex;
+    std::vector<double> _shares;
+    GF2GPUTiming _timing;
+    bool _split = false; // whether the last multiply was split
+};
@@ -0,0 +1,335 @@
+#include "GF2NarrowMatrix.hpp"
+#include "GF2Kernels.hpp"
+#include <algorithm>
+#include <cstring>
+#include <omp.h>
+#include <stdexcept>
+
+namespace {
+
+// Four Russians tables of one pass, kept within L2
+constexpr size_t TABLE_BYTES = size_t(256) << 10;
+// Products and conversions of fewer rows than this run on one thread
+constexpr size_t PARALLEL_MIN_ROWS = size_t(1) << 14;
+
+int resolve_threads(int num_threads, size_t rows) {
+    if (rows < PARALLEL_MIN_ROWS) {
+        return 1;
+    }
+    return num_threads > 0 ? num_threads : omp_get_max_threads();
+}
+
+size_t cell_bytes_for(size_t cols) {
+    return cols <= 8 ? 1 : cols <= 16 ? 2 : 4;
+}
+
+uint32_t col_mask(size_t cols) {
+    return cols >= 32 ? ~uint32_t(0) : (uint32_t(1) << cols) - 1;
+}
+
+template <typename Cell>
+Cell load(const uint8_t* p) {
+    Cell x;
+    std::memcpy(&x, p, sizeof(x));
+    return x;
+}
+
+template <typename Cell>
+void store(uint8_t* p, Cell x) {
+    std::memcpy(p, &x, sizeof(x));
+}
+
+// Calls f with a value of the cell type of the given width
+template <typename F>
+void with_cell(size_t cell_bytes, F&& f) {
+    if (cell_bytes == 1) {
+        f(uint8_t());
+    } else if (cell_bytes == 2) {
+        f(uint16_t());
+    } else {
+        f(uint32_t());
+    }
+}
+
+} // namespace
+
+GF2NarrowMatrix::GF2NarrowMatrix(size_t rows, size_t cols)
+    : m_rows(rows), m_cols(cols), m_cell_bytes(cell_bytes_for(cols)) {
+    if (cols > MAX_COLS) {
+        throw std::runtime_error("Narrow matrices have at most 32 columns");
+    }
+    m_cells.resize(rows * m_cell_bytes);
+}
+
+GF2NarrowMatrix GF2NarrowMatrix::fromMatrix(const GF2Matrix& m, int num_threads) {
+    GF2NarrowMatrix n(m.rows(), m.cols());
+    if (m.cols() == 0) {
+        return n;
+    }
+    const uint64_t* src = m.get_raw_data();
+    const size_t stride = m.row_stride();
+    const long long rows = static_cast<long long>(m.rows());
+    with_cell(n.m_cell_bytes, [&](auto cell) {
+        using Cell = decltype(cell);
+        uint8_t* dst = n.m_cells.data();
+        const int threads = resolve_threads(num_threads, m.rows());
+        #pragma omp parallel for schedule(static) num_threads(threads)
+        for (long long r = 0; r < rows; ++r) {
+            store(dst + size_t(r) * sizeof(Cell), Cell(src[size_t(r) * stride]));
+        }
+    });
+    return n;
+}
+
+GF2Matrix GF2NarrowMatrix::toMatrix(int num_threads) const {
+    GF2Matrix m(m_rows, m_cols);
+    if (m_cols == 0) {
+        return m;
+    }
+    uint64_t* dst = m.get_raw_data();
+    const size_t stride = m.row_stride();
+    const long long rows = static_cast<long long>(m_rows);
+    with_cell(m_cell_bytes, [&](auto cell) {
+        using Cell = decltype(cell);
+        const uint8_t* src = m_cells.data();
+        const int threads = resolve_threads(num_threads, m_rows);
+        #pragma omp parallel for schedule(static) num_threads(threads)
+        for (long long r = 0; r < rows; ++r) {
+            dst[size_t(r) * stride] = load<Cell>(src + size_t(r) * sizeof(Cell));
+        }
+    });
+    return m;
+}
+
+uint32_t GF2NarrowMatrix::row(size_t r) const {
+    if (r >= m_rows) {
+        throw std::runtime_error("Matrix index out of bounds");
+    }
+    uint32_t bits = 0;
+    std::memcpy(&bits, m_cells.data() + r * m_cell_bytes, m_cell_bytes);
+    return bits;
+}
+
+void GF2NarrowMatrix::setRow(size_t r, uint32_t bits) {
+    if (r >= m_rows) {
+        throw std::runtime_error("Matrix index out of bounds");
+    }
+    bits &= col_mask(m_cols);
+    std::memcpy(m_cells.data() + r * m_cell_bytes, &bits, m_cell_bytes);
+}
+
+bool GF2NarrowMatrix::get(size_t row, size_t col) const {
+    if (row >= m_rows || col >= m_cols) return false;
+    return (m_cells[row * m_cell_bytes + col / 8] >> (col % 8)) & 1;
+}
+
+void GF2NarrowMatrix::set(size_t row, size_t col, bool value) {
+    if (row >= m_rows || col >= m_cols) {
+        throw std::runtime_error("Matrix index out of bounds");
+    }
+    uint8_t& byte = m_cells[row * m_cell_bytes + col / 8];
+    const uint8_t bit = uint8_t(1u << (col % 8));
+    byte = value ? byte | bit : byte & uint8_t(~bit);
+}
+
+// Table g of a panel holds at entry x the XOR of the panel's words of the
+// rows 8g + j of b for the bits j of x, built from the entry without the
+// lowest bit. A cell has no bits past cols(), so a last group of fewer
+// than eight rows needs only the entries of those rows.
+GF2Matrix GF2NarrowMatrix::multiply(const GF2Matrix& b, int num_threads) const {
+    if (m_cols != b.rows()) {
+        throw std::runtime_error("Matrix dimensions incompatible for multiplication");
+    }
+    GF2Matrix result(m_rows, b.cols());
+    const size_t words = b.words_per_row();
+    if (m_rows == 0 || m_cols == 0 || words == 0) {
+        return result;
+    }
+    const RowKernel& kernel = row_kernel();
+    const int threads = resolve_threads(num_threads, m_rows);
+    const long long rows = static_cast<long long>(m_rows);
+    uint64_t* c = result.get_raw_data();
+    const size_t c_stride = result.row_stride();
+
+    with_cell(m_cell_bytes, [&](auto cell) {
+        using Cell = decltype(cell);
+        const uint8_t* a = m_cells.data();
+
+        if (m_rows < TABLE_MIN_ROWS) {
+            for (size_t i = 0; i < m_rows; ++i) {
+                for (uint32_t x = load<Cell>(a + i * sizeof(Cell)); x != 0; x &= x - 1) {
+                    kernel.xor_rows(c + i * c_stride,
+                                    b.get_raw_data() + size_t(__builtin_ctz(x)) * b.row_stride(),
+                                    words);
+                }
+            }
+            return;
+        }
+
+        const size_t groups = (m_cols + 7) / 8;
+        const size_t panel = std::max<size_t>(1, TABLE_BYTES / (groups * 256 * sizeof(uint64_t)));
+        std::vector<uint64_t, GF2AlignedAllocator<uint64_t>> tables(groups * 256 * panel);
+        for (size_t w0 = 0; w0 < words; w0 += panel) {
+            const size_t pw = std::min(panel, words - w0);
+            for (size_t g = 0; g < groups; ++g) {
+                const size_t count = size_t(1) << std::min<size_t>(8, m_cols - 8 * g);
+                uint64_t* t = tables.data() + g * 256 * panel;
+                std::fill(t, t + pw, 0);
+                for (size_t x = 1; x < count; ++x) {
+                    const uint64_t* prev = t + (x & (x - 1)) * panel;
+                    const uint64_t* src =
+                        b.get_raw_data() + (8 * g + size_t(__builtin_ctz(unsigned(x)))) *
+                                               b.row_stride() + w0;
+                    for (size_t w = 0; w < pw; ++w) {
+                        t[x * panel + w] = prev[w] ^ src[w];
+                    }
+                }
+            }
+            #pragma omp parallel for schedule(static) num_threads(threads)
+            for (long long ii = 0; ii < rows; ++ii) {
+                const size_t i = size_t(ii);
+                const uint32_t x = load<Cell>(a + i * sizeof(Cell));
+                uint64_t* dst = c + i * c_stride + w0;
+                std::memcpy(dst, tables.data() + (x & 0xFF) * panel, pw * sizeof(uint64_t));
+                for (size_t g = 1; g < groups; ++g) {
+                    const size_t entry = g * 256 + ((x >> (8 * g)) & 0xFF);
+                    kernel.xor_rows(dst, tables.data() + entry * panel, pw);
+                }
+            }
+        }
+    });
+    return result;
+}
+
+// Table q holds at entry x the XOR of the rows 4q + j of b for the bits j
+// of x. From eight bits to eight bits those are the two 16-byte tables of
+// the row kernel's lookup_nibbles; otherwise each cell takes one lookup
+// per nibble.
+GF2NarrowMatrix GF2NarrowMatrix::multiply(const GF2NarrowMatrix& b, int num_threads) const {
+    if (m_cols != b.m_rows) {
+        throw std::runtime_error("Matrix dimensions incompatible for multiplication");
+    }
+    GF2NarrowMatrix result(m_rows, b.m_cols);
+    if (m_rows == 0 || m_cols == 0 || b.m_cols == 0) {
+        return result;
+    }
+    const size_t nibbles = (m_cols + 3) / 4;
+    uint32_t tables[8][16] = {};
+    for (size_t q = 0; q < nibbles; ++q) {
+        for (size_t x = 1; x < 16; ++x) {
+            const size_t j = 4 * q + size_t(__builtin_ctz(unsigned(x)));
+            tables[q][x] = tables[q][x & (x - 1)] ^ (j < m_cols ? b.row(j) : 0);
+        }
+    }
+    const int threads = resolve_threads(num_threads, m_rows);
+
+    if (m_cell_bytes == 1 && result.m_cell_bytes == 1) {
+        uint8_t table[32];
+        for (size_t x = 0; x < 16; ++x) {
+            table[x] = uint8_t(tables[0][x]);
+            table[16 + x] = uint8_t(tables[1][x]);
+        }
+        const RowKernel& kernel = row_kernel();
+        const size_t chunk = (m_rows + size_t(threads) - 1) / size_t(threads);
+        #pragma omp parallel for schedule(static) num_threads(threads)
+        for (int t = 0; t < threads; ++t) {
+            const size_t r0 = std::min(m_rows, size_t(t) * chunk);
+            const size_t r1 = std::min(m_rows, r0 + chunk);
+            kernel.lookup_nibbles(result.m_cells.data() + r0, m_cells.data() + r0, table, r1 - r0);
+        }
+        return result;
+    }
+
+    const long long rows = static_cast<long long>(m_rows);
+    with_cell(m_cell_bytes, [&](auto a_cell) {
+        using ACell = decltype(a_cell);
+        with_cell(result.m_cell_bytes, [&](auto c_cell) {
+            using CCell = decltype(c_cell);
+            const uint8_t* a = m_cells.data();
+            uint8_t* c = result.m_cells.data();
+            #pragma omp parallel for schedule(static) num_threads(threads)
+            for (long long ii = 0; ii < rows; ++ii) {
+                const size_t i = size_t(ii);
+                const uint32_t x = load<ACell>(a + i * sizeof(ACell));
+                uint32_t y = 0;
+                for (size_t q = 0; q < nibbles; ++q) {
+                    y ^= tables[q][(x >> (4 * q)) & 0xF];
+                }
+                store(c + i * sizeof(CCell), CCell(y));
+            }
+        });
+    });
+    return result;
+}
+
+// Table g of a chunk holds at entry x the XOR of the rows 8g + j of b for
+// the bits j of x; each row of a adds one entry per byte of the chunk to
+// its cell. Rows of b past b.rows() are zero, and so are the bits of a
+// past a.cols().
+GF2NarrowMatrix GF2NarrowMatrix::multiply(const GF2Matrix& a, const GF2NarrowMatrix& b,
+                                          int num_threads) {
+    if (a.cols() != b.m_rows) {
+        throw std::runtime_error("Matrix dimensions incompatible for multiplication");
+    }
+    GF2NarrowMatrix result(a.rows(), b.m_cols);
+    if (a.rows() == 0 || a.cols() == 0 || b.m_cols == 0) {
+        return result;
+    }
+    if (a.cols() >= DOT_MIN_COLS) {
+        return fromMatrix(a.multiplySIMDParallel(b.toMatrix(), num_threads), num_threads);
+    }
+    const int threads = resolve_threads(num_threads, a.rows());
+    const long long rows = static_cast<long long>(a.rows());
+    const size_t a_stride = a.row_stride();
+
+    with_cell(result.m_cell_bytes, [&](auto cell) {
+        using Cell = decltype(cell);
+        uint8_t* c = result.m_cells.data();
+
+        if (a.rows() < TABLE_MIN_ROWS) {
+            for (size_t i = 0; i < a.rows(); ++i) {
+                const uint64_t* row = a.get_raw_data() + i * a_stride;
+                uint32_t y = 0;
+                for (size_t w = 0; w < a.words_per_row(); ++w) {
+                    for (uint64_t x = row[w]; x != 0; x &= x - 1) {
+                        y ^= b.row(64 * w + size_t(__builtin_ctzll(x)));
+                    }
+                }
+                store(c + i * sizeof(Cell), Cell(y));
+            }
+            return;
+        }
+
+        const size_t bytes = (a.cols() + 7) / 8;
+        const size_t chunk = TABLE_BYTES / (256 * sizeof(uint32_t));
+        std::vector<uint32_t> tables(std::min(chunk, bytes) * 256);
+        for (size_t g0 = 0; g0 < bytes; g0 += chunk) {
+            const size_t gn = std::min(chunk, bytes - g0);
+            for (size_t g = 0; g < gn; ++g) {
+                uint32_t* t = tables.data() + g * 256;
+                const size_t row0 = 8 * (g0 + g);
+                const size_t count = size_t(1) << std::min<size_t>(8, b.m_rows - row0);
+                for (size_t x = 1; x < count; ++x) {
+                    t[x] = t[x & (x - 1)] ^ b.row(row0 + size_t(__builtin_ctz(unsigned(x))));
+                }
+            }
+            #pragma omp parallel for schedule(static) num_threads(threads)
+            for (long long ii = 0; ii < rows; ++ii) {
+                const size_t i = size_t(ii);
+                const uint8_t* row =
+                    reinterpret_cast<const uint8_t*>(a.get_raw_data() + i * a_stride) + g0;
+                uint32_t y = g0 == 0 ? 0 : load<Cell>(c + i * sizeof(Cell));
+                for (size_t g = 0; g < gn; ++g) {
+                    y ^= tables[g * 256 + row[g]];
+                }
+                store(c + i * sizeof(Cell), Cell(y));
+            }
+        }
+    });
+    return result;
+}
+
+bool GF2NarrowMatrix::operator==(const GF2NarrowMatrix& other) const {
+    return m_rows == other.m_rows && m_cols == other.m_cols &&
+           std::memcmp(m_cells.data(), other.m_cells.data(), m_cells.size()) == 0;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "GF2AlignedAllocator.hpp"
+#include "GF2Matrix.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A matrix of at most 32 columns stored as one cell of 8, 16 or 32 bits per
+// row, the narrowest that holds cols() bits, the cells packed one after the
+// other. Column c is bit c of a row's cell (little-endian, as in the words
+// of GF2Matrix) and the bits past cols() are zero. A tall matrix of eight
+// columns then takes one byte per row, where a GF2Matrix row takes a word
+// padded to a 64-byte stride, and its products stream that much less.
+//
+// The products treat a narrow operand as a linear map of cells and apply it
+// by table lookups: the tables of the XORs of every subset of eight rows of
+// the other operand (Four Russians), or, between two narrow matrices, of
+// every subset of four rows, one table per nibble of a cell. For cells of
+// eight bits into eight bits the two nibble tables are 16 bytes each and
+// the lookups run as PSHUFB on x86 and TBL on Arm (RowKernel::lookup_nibbles).
+class GF2NarrowMatrix {
+public:
+    static constexpr size_t MAX_COLS = 32;
+
+    // Four Russians tables are built for at least this many rows of the
+    // narrow side; below it the rows are XORed in directly
+    static constexpr size_t TABLE_MIN_ROWS = 256;
+    // A dense left operand of at least this many columns is multiplied by
+    // the SIMD dot-product kernel instead, whose cost per row grows with
+    // the words of a row rather than its bytes
+    static constexpr size_t DOT_MIN_COLS = 1024;
+
+    // An all-zero matrix; throws std::runtime_error if cols > MAX_COLS
+    GF2NarrowMatrix(size_t rows, size_t cols);
+
+    // Conversions from and to row-major, over OpenMP threads (num_threads
+    // <= 0 for the default). fromMatrix throws std::runtime_error for a
+    // matrix of more than MAX_COLS columns.
+    static GF2NarrowMatrix fromMatrix(const GF2Matrix& m, int num_threads = 0);
+    GF2Matrix toMatrix(int num_threads = 0) const;
+
+    size_t rows() const { return m_rows; }
+    size_t cols() const { return m_cols; }
+    // 1, 2 or 4
+    size_t cell_bytes() const { return m_cell_bytes; }
+    // Cell r at data() + r * cell_bytes(); writers must leave the bits past
+    // cols() zero
+    const uint8_t* data() const { return m_cells.data(); }
+    uint8_t* data() { return m_cells.data(); }
+
+    // Row r as the low cols() bits; setRow drops the bits past cols()
+    uint32_t row(size_t r) const;
+    void setRow(size_t r, uint32_t bits);
+    bool get(size_t row, size_t col) const;
+    void set(size_t row, size_t col, bool value);
+
+    // this * b (b with cols() rows): each row of the product is the XOR of
+    // one table row per eight rows of b, over panels of b's columns whose
+    // tables fit in L2
+    GF2Matrix multiply(const GF2Matrix& b, int num_threads = 0) const;
+    // this * b between narrow matrices: one nibble table lookup per four
+    // columns of this
+    GF2NarrowMatrix multiply(const GF2NarrowMatrix& b, int num_threads = 0) const;
+    // a * b (a with b.rows() columns): one byte table lookup per eight
+    // columns of a, over chunks of those columns whose tables fit in L2, or
+    // from DOT_MIN_COLS columns multiplySIMDParallel into a GF2Matrix that
+    // is then packed. All three throw std::runtime_error if the shapes do
+    // not match.
+    static GF2NarrowMatrix multiply(const GF2Matrix& a, const GF2NarrowMatrix& b,
+                                    int num_threads = 0);
+
+    bool operator==(const GF2NarrowMatrix& other) const;
+
+private:
+    size_t m_rows;
+    size_t m_cols;
+    size_t m_cell_bytes;
+    std::vector<uint8_t, GF2AlignedAllocator<uint8_t>> m_cells;
+};
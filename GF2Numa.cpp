@@ -0,0 +1,162 @@
+#include "GF2Numa.hpp"
+#include "GF2AlignedAllocator.hpp"
+#include "GF2CpuInfo.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <omp.h>
+#include <string>
+#if defined(__APPLE__)
+#include <pthread.h>
+#include <sys/qos.h>
+#endif
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Matrices smaller than this are zeroed by the calling thread
+constexpr size_t FIRST_TOUCH_MIN_BYTES = size_t(2) << 20;
+
+// The CPUs of a sysfs list ("0-3,8-11")
+std::vector<int> parse_cpu_list(const std::string& list) {
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos) end = list.size();
+        const std::string range = list.substr(pos, end - pos);
+        int lo = 0, hi = 0;
+        const int n = std::sscanf(range.c_str(), "%d-%d", &lo, &hi);
+        if (n == 1) hi = lo;
+        for (int c = lo; n >= 1 && c <= hi; ++c) {
+            cpus.push_back(c);
+        }
+        pos = end + 1;
+    }
+    return cpus;
+}
+
+std::string read_line(const std::string& path) {
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+// This thread's pinning, as (index, team size); -1 = not pinned yet
+thread_local int pinned_index = -1;
+thread_local int pinned_team = 0;
+
+// This thread's GF2ThreadQos plus one; 0 = never set
+thread_local int thread_qos = 0;
+
+} // namespace
+
+const GF2NumaTopology& GF2NumaTopology::get() {
+    static const GF2NumaTopology topology = [] {
+        GF2NumaTopology t;
+        const char* numa = std::getenv("GF2_NUMA");
+        if (numa && std::strcmp(numa, "off") == 0) {
+            return t;
+        }
+#if defined(__linux__)
+        for (int node : parse_cpu_list(read_line("/sys/devices/system/node/online"))) {
+            std::vector<int> cpus = parse_cpu_list(
+                read_line("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"));
+            if (!cpus.empty()) {
+                t.node_cpus.push_back(std::move(cpus));
+            }
+        }
+#endif
+        t.pin = t.node_cpus.size() > 1 && !std::getenv("OMP_PROC_BIND") &&
+                !std::getenv("OMP_PLACES");
+        return t;
+    }();
+    return topology;
+}
+
+void gf2_numa_pin_thread() {
+    const GF2NumaTopology& topology = GF2NumaTopology::get();
+    if (!topology.pin) return;
+    const int index = omp_get_thread_num(), team = omp_get_num_threads();
+    if (index == pinned_index && team == pinned_team) return;
+    pinned_index = index;
+    pinned_team = team;
+#if defined(__linux__)
+    const size_t nodes = topology.nodes();
+    const size_t node = size_t(index) * nodes / size_t(team);
+    // The team's threads on this node, in order, over its CPUs
+    const size_t first = (node * size_t(team) + nodes - 1) / nodes;
+    const std::vector<int>& cpus = topology.node_cpus[node];
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpus[(size_t(index) - first) % cpus.size()], &set);
+    sched_setaffinity(0, sizeof(set), &set);
+#endif
+}
+
+bool gf2_dynamic_schedule() {
+    static const bool dynamic = [] {
+        const char* schedule = std::getenv("GF2_SCHEDULE");
+        if (schedule && std::strcmp(schedule, "static") == 0) return false;
+        if (schedule && std::strcmp(schedule, "dynamic") == 0) return true;
+        return GF2CpuInfo::get().hybrid() && GF2NumaTopology::get().nodes() <= 1;
+    }();
+    return dynamic;
+}
+
+void gf2_set_thread_qos(GF2ThreadQos qos) {
+    const int value = int(qos) + 1;
+    if (value == thread_qos) return;
+    thread_qos = value;
+#if defined(__APPLE__)
+    pthread_set_qos_class_self_np(qos == GF2ThreadQos::Compute ? QOS_CLASS_USER_INITIATED
+                                                               : QOS_CLASS_UTILITY,
+                                  0);
+#endif
+}
+
+void gf2_numa_interleave(void* ptr, size_t bytes) {
+#if defined(__linux__) && defined(SYS_mbind)
+    const GF2NumaTopology& topology = GF2NumaTopology::get();
+    const size_t page = gf2_page_size();
+    if (topology.nodes() < 2 || bytes == 0 || reinterpret_cast<uintptr_t>(ptr) % page != 0) {
+        return;
+    }
+    constexpr int MPOL_INTERLEAVE_MODE = 3; // MPOL_INTERLEAVE of <linux/mempolicy.h>
+    unsigned long mask[16] = {};
+    // The nodes' own numbers, which need not be 0..nodes-1
+    for (int node : parse_cpu_list(read_line("/sys/devices/system/node/online"))) {
+        if (node >= 0 && node < int(sizeof(mask) * 8)) {
+            mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+        }
+    }
+    const size_t length = (bytes + page - 1) / page * page;
+    syscall(SYS_mbind, ptr, length, MPOL_INTERLEAVE_MODE, mask, sizeof(mask) * 8, 0);
+#else
+    (void)ptr;
+    (void)bytes;
+#endif
+}
+
+void gf2_first_touch_zero(uint64_t* data, size_t rows, size_t row_stride) {
+    const size_t bytes = rows * row_stride * sizeof(uint64_t);
+    if (bytes == 0) return;
+    if (bytes < FIRST_TOUCH_MIN_BYTES || omp_get_max_threads() == 1) {
+        std::memset(data, 0, bytes);
+        return;
+    }
+    #pragma omp parallel
+    {
+        gf2_numa_pin_thread();
+        #pragma omp for schedule(static)
+        for (long long i = 0; i < static_cast<long long>(rows); ++i) {
+            std::memset(data + size_t(i) * row_stride, 0, row_stride * sizeof(uint64_t));
+        }
+    }
+}
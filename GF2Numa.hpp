@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// NUMA placement for multi-socket hosts. A matrix's rows are zeroed by the
+// OpenMP threads that will multiply them (first touch), so each socket's row
+// bands live in its own memory; the B^T workspaces every thread reads are
+// interleaved across the nodes; and the threads of these regions are pinned,
+// spread over the nodes, so thread t stays on the socket that holds its
+// rows. All of it is off on a single node, when GF2_NUMA=off, and the
+// pinning also when OMP_PROC_BIND or OMP_PLACES leaves it to the runtime.
+struct GF2NumaTopology {
+    std::vector<std::vector<int>> node_cpus; // online CPUs of each node with any
+    bool pin = false; // whether gf2_numa_pin_thread pins
+
+    size_t nodes() const { return node_cpus.size(); }
+    static const GF2NumaTopology& get();
+};
+
+// Pins the calling OpenMP thread to the CPU of its index in the team,
+// thread t of T on node t * nodes / T; call at the top of a parallel region.
+// Cached per thread, so it costs a comparison after the first call.
+void gf2_numa_pin_thread();
+
+// Asks for the pages of [ptr, ptr + bytes) to be interleaved over the nodes
+// (mbind(MPOL_INTERLEAVE)); ptr is page aligned. A no-op on one node.
+void gf2_numa_interleave(void* ptr, size_t bytes);
+
+// Scheduling on hybrid CPUs (GF2CpuInfo::hybrid()), whose efficiency cores
+// run the kernels at a fraction of the speed of the performance cores. A
+// static split of a parallel multiply gives every thread the same share,
+// so the team waits on the threads that landed on E-cores; the parallel
+// SIMD kernels hand out their blocks dynamically there instead, and the
+// fast cores take more of them. GF2_SCHEDULE=static or dynamic forces
+// either; the default is dynamic only on a hybrid single-node machine,
+// where the static schedule's first-touch placement buys nothing.
+bool gf2_dynamic_schedule();
+
+// What a thread is for, as the QoS class of the thread on macOS: Compute
+// is QOS_CLASS_USER_INITIATED, which the scheduler keeps on the P-cores
+// while they are free, and Background is QOS_CLASS_UTILITY, which it
+// prefers to run on the E-cores, used for work off the critical path such
+// as generating the next operands. Cached per thread, so it costs a
+// comparison after the first call. A no-op elsewhere.
+enum class GF2ThreadQos { Compute, Background };
+void gf2_set_thread_qos(GF2ThreadQos qos);
+
+// Zeroes rows x row_stride words, rows split over the OpenMP threads in the
+// static schedule of the parallel multiply, so their pages are first touched
+// by the thread (and node) that will work on them
+void gf2_first_touch_zero(uint64_t* data, size_t rows, size_t row_stride);
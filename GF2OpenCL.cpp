@@ -0,0 +1,684 @@
+#include "GF2OpenCL.hpp"
+#include "GF2Metrics.hpp"
+#include "GF2TiledMatrix.hpp"
+#include "GF2Trace.hpp"
+#include "gf2_opencl_source.hpp" // GF2_OPENCL_SOURCE, generated from gf2_opencl.cl
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace {
+
+// The kernel argument structs of gf2_opencl.cl
+struct GPUParams {
+    cl_uint a_rows;
+    cl_uint a_cols;
+    cl_uint b_cols;
+    cl_uint words_per_row_a;
+    cl_uint words_per_row_b;
+    cl_uint words_per_row_result;
+};
+
+struct GF2TransposeParams {
+    cl_uint rows;
+    cl_uint cols;
+    cl_uint src_stride;
+    cl_uint dst_stride;
+};
+
+struct GPUM4RPanel {
+    cl_uint k_word0;
+    cl_uint k_words;
+    cl_uint accumulate;
+};
+
+struct GF2BlockParams {
+    cl_uint rows;
+    cl_uint cols;
+    cl_uint words;
+    cl_uint stride;
+};
+
+struct GF2AtBParams {
+    cl_uint rows;
+    cl_uint cols;
+    cl_uint a_words;
+    cl_uint b_words;
+    cl_uint a_stride;
+    cl_uint b_stride;
+    cl_uint result_stride;
+};
+
+struct GF2AAtParams {
+    cl_uint rows;
+    cl_uint words;
+    cl_uint stride;
+    cl_uint result_stride;
+    cl_uint upper;
+};
+
+struct GF2MortonParams {
+    cl_uint tile;
+    cl_uint tile_words;
+    cl_uint m_tiles;
+    cl_uint k_tiles;
+    cl_uint n_tiles;
+};
+
+void check(cl_int err, const char* what) {
+    if (err != CL_SUCCESS) {
+        throw std::runtime_error(std::string("OpenCL: ") + what + " failed (error " +
+                                 std::to_string(err) + ")");
+    }
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+// The row stride of the device buffers, as on Metal
+size_t default_stride(size_t cols) {
+    const size_t align = GF2Matrix::ROW_ALIGN_WORDS;
+    return ((cols + 63) / 64 + align - 1) / align * align;
+}
+
+// The rows of m at the given stride, zero padded; m's own storage when it
+// already has that stride
+const uint64_t* packed_rows(const GF2Matrix& m, size_t stride, std::vector<uint64_t>& scratch) {
+    if (m.row_stride() == stride) {
+        return m.get_raw_data();
+    }
+    scratch.assign(m.rows() * stride, 0);
+    for (size_t r = 0; r < m.rows(); ++r) {
+        memcpy(scratch.data() + r * stride, m.get_raw_data() + r * m.row_stride(),
+               m.words_per_row() * sizeof(uint64_t));
+    }
+    return scratch.data();
+}
+
+template <typename T>
+void set_arg(cl_kernel kernel, cl_uint index, const T& value) {
+    check(clSetKernelArg(kernel, index, sizeof(T), &value), "clSetKernelArg");
+}
+
+cl_kernel create_kernel(cl_program program, const char* name) {
+    cl_int err = CL_SUCCESS;
+    cl_kernel kernel = clCreateKernel(program, name, &err);
+    check(err, name);
+    return kernel;
+}
+
+} // namespace
+
+// Releases the buffer at the end of the multiply, also on exceptions, and
+// takes its bytes off the backend's count
+struct GF2OpenCL::ScopedBuffer {
+    cl_mem mem = nullptr;
+    size_t bytes = 0;
+    size_t* live = nullptr;
+    ~ScopedBuffer() {
+        if (mem) {
+            clReleaseMemObject(mem);
+        }
+        if (live) {
+            *live -= bytes;
+        }
+    }
+};
+
+GF2OpenCL::GF2OpenCL()
+    : _device(nullptr), _context(nullptr), _queue(nullptr), _program(nullptr),
+      _transpose(nullptr), _transposed(nullptr), _vectorized(nullptr), _m4rTables(nullptr),
+      _m4rMultiply(nullptr), _matvec(nullptr), _matvecLeft(nullptr), _multiplyAtB(nullptr),
+      _multiplyAAt(nullptr), _multiplyMorton(nullptr), _allocated(0),
+      _peakAllocated(0) {
+    cl_uint platform_count = 0;
+    if (clGetPlatformIDs(0, nullptr, &platform_count) != CL_SUCCESS || platform_count == 0) {
+        throw std::runtime_error("No OpenCL platform");
+    }
+    std::vector<cl_platform_id> platforms(platform_count);
+    check(clGetPlatformIDs(platform_count, platforms.data(), nullptr), "clGetPlatformIDs");
+    for (cl_platform_id platform : platforms) {
+        if (clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, 1, &_device, nullptr) == CL_SUCCESS) {
+            break;
+        }
+        _device = nullptr;
+    }
+    if (!_device) {
+        throw std::runtime_error("No OpenCL GPU");
+    }
+
+    cl_int err = CL_SUCCESS;
+    _context = clCreateContext(nullptr, 1, &_device, nullptr, nullptr, &err);
+    check(err, "clCreateContext");
+    try {
+        _queue = clCreateCommandQueue(_context, _device, CL_QUEUE_PROFILING_ENABLE, &err);
+        check(err, "clCreateCommandQueue");
+
+        const char* source = GF2_OPENCL_SOURCE;
+        _program = clCreateProgramWithSource(_context, 1, &source, nullptr, &err);
+        check(err, "clCreateProgramWithSource");
+        if (clBuildProgram(_program, 1, &_device, "", nullptr, nullptr) != CL_SUCCESS) {
+            size_t log_size = 0;
+            clGetProgramBuildInfo(_program, _device, CL_PROGRAM_BUILD_LOG, 0, nullptr, &log_size);
+            std::string log(log_size, '\0');
+            clGetProgramBuildInfo(_program, _device, CL_PROGRAM_BUILD_LOG, log_size, &log[0],
+                                  nullptr);
+            throw std::runtime_error("Failed to build gf2_opencl.cl:\n" + log);
+        }
+
+        _transpose = create_kernel(_program, "gf2_transpose_kernel");
+        _transposed = create_kernel(_program, "gf2_multiply_transposed_kernel");
+        _vectorized = create_kernel(_program, "gf2_multiply_vectorized_kernel");
+        _m4rTables = create_kernel(_program, "m4r_make_tables_kernel");
+        _m4rMultiply = create_kernel(_program, "m4r_multiply_kernel");
+        _matvec = create_kernel(_program, "gf2_matvec_block_kernel");
+        _matvecLeft = create_kernel(_program, "gf2_matvec_left_block_kernel");
+        _multiplyAtB = create_kernel(_program, "gf2_multiply_at_b_kernel");
+        _multiplyAAt = create_kernel(_program, "gf2_multiply_aat_kernel");
+        _multiplyMorton = create_kernel(_program, "gf2_multiply_morton_kernel");
+    } catch (...) {
+        release();
+        throw;
+    }
+}
+
+GF2OpenCL::~GF2OpenCL() { release(); }
+
+void GF2OpenCL::release() {
+    for (cl_kernel* kernel : {&_transpose, &_transposed, &_vectorized, &_m4rTables, &_m4rMultiply,
+                              &_matvec, &_matvecLeft, &_multiplyAtB, &_multiplyAAt,
+                              &_multiplyMorton}) {
+        if (*kernel) {
+            clReleaseKernel(*kernel);
+            *kernel = nullptr;
+        }
+    }
+    if (_program) {
+        clReleaseProgram(_program);
+        _program = nullptr;
+    }
+    if (_queue) {
+        clReleaseCommandQueue(_queue);
+        _queue = nullptr;
+    }
+    if (_context) {
+        clReleaseContext(_context);
+        _context = nullptr;
+    }
+}
+
+std::string GF2OpenCL::deviceName() const {
+    size_t size = 0;
+    if (clGetDeviceInfo(_device, CL_DEVICE_NAME, 0, nullptr, &size) != CL_SUCCESS || size == 0) {
+        return "unknown OpenCL device";
+    }
+    std::string name(size, '\0');
+    clGetDeviceInfo(_device, CL_DEVICE_NAME, size, &name[0], nullptr);
+    name.resize(strlen(name.c_str()));
+    return name;
+}
+
+bool GF2OpenCL::supports(Kernel kernel) {
+    return kernel == Kernel::Transposed || kernel == Kernel::Vectorized || kernel == Kernel::M4R;
+}
+
+GF2GPUTiming GF2OpenCL::lastTiming() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _lastTiming;
+}
+
+size_t GF2OpenCL::allocatedBytes() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _allocated;
+}
+
+size_t GF2OpenCL::peakAllocatedBytes() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _peakAllocated;
+}
+
+void GF2OpenCL::resetPeakAllocated() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _peakAllocated = _allocated;
+}
+
+void GF2OpenCL::createBuffer(ScopedBuffer& buffer, cl_mem_flags flags, size_t bytes,
+                             const void* host, const char* what) {
+    cl_int err = CL_SUCCESS;
+    buffer.mem = clCreateBuffer(_context, flags, bytes, const_cast<void*>(host), &err);
+    check(err, what);
+    buffer.bytes = bytes;
+    buffer.live = &_allocated;
+    _allocated += bytes;
+    _peakAllocated = std::max(_peakAllocated, _allocated);
+}
+
+void GF2OpenCL::multiply(Kernel kernel, const GF2Matrix& a, const GF2Matrix& b,
+                         GF2Matrix& result) {
+    if (!supports(kernel)) {
+        throw std::runtime_error("Kernel not supported by the OpenCL backend");
+    }
+    if (a.cols() != b.rows()) {
+        throw std::runtime_error("Matrix dimensions don't match for multiplication");
+    }
+    if (result.rows() != a.rows() || result.cols() != b.cols()) {
+        throw std::runtime_error("Result matrix has wrong dimensions");
+    }
+    if (a.rows() == 0 || b.cols() == 0) {
+        return;
+    }
+    if (a.cols() == 0) {
+        memset(result.get_raw_data(), 0, result.rows() * result.row_stride() * sizeof(uint64_t));
+        return;
+    }
+
+    const size_t stride_a = default_stride(a.cols());
+    const size_t stride_b = default_stride(b.cols());
+    runProduct(a, stride_a, b, stride_b, result, stride_b, [&](cl_mem ma, cl_mem mb, cl_mem mc) {
+        if (kernel == Kernel::M4R) {
+            multiplyM4R(ma, mb, mc, a, b, result);
+        } else {
+            multiplyTransposed(kernel == Kernel::Vectorized ? _vectorized : _transposed, ma, mb,
+                               mc, a, b, result);
+        }
+    });
+}
+
+// b at A's stride is the B^T the transposed kernel reads
+void GF2OpenCL::multiplyABt(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result) {
+    if (a.cols() != b.cols()) {
+        throw std::runtime_error("Matrix dimensions don't match for multiplication");
+    }
+    if (result.rows() != a.rows() || result.cols() != b.rows()) {
+        throw std::runtime_error("Result matrix has wrong dimensions");
+    }
+    if (a.rows() == 0 || b.rows() == 0) {
+        return;
+    }
+    if (a.cols() == 0) {
+        memset(result.get_raw_data(), 0, result.rows() * result.row_stride() * sizeof(uint64_t));
+        return;
+    }
+
+    const size_t stride_a = default_stride(a.cols());
+    const size_t stride_c = default_stride(b.rows());
+    runProduct(a, stride_a, b, stride_a, result, stride_c, [&](cl_mem ma, cl_mem mb, cl_mem mc) {
+        GPUParams params = {cl_uint(a.rows()), cl_uint(a.cols()), cl_uint(b.rows()),
+                            cl_uint(stride_a), cl_uint(stride_a), cl_uint(stride_c)};
+        set_arg(_transposed, 0, ma);
+        set_arg(_transposed, 1, mb);
+        set_arg(_transposed, 2, mc);
+        set_arg(_transposed, 3, params);
+        const size_t global[2] = {result.rows(), stride_c};
+        cl_event event = nullptr;
+        check(clEnqueueNDRangeKernel(_queue, _transposed, 2, nullptr, global, nullptr, 0, nullptr,
+                                     &event),
+              "multiply kernel");
+        _events.push_back(event);
+    });
+}
+
+void GF2OpenCL::multiplyAtB(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result) {
+    if (a.rows() != b.rows()) {
+        throw std::runtime_error("Matrix dimensions don't match for multiplication");
+    }
+    if (result.rows() != a.cols() || result.cols() != b.cols()) {
+        throw std::runtime_error("Result matrix has wrong dimensions");
+    }
+    if (a.cols() == 0 || b.cols() == 0) {
+        return;
+    }
+    if (a.rows() == 0) {
+        memset(result.get_raw_data(), 0, result.rows() * result.row_stride() * sizeof(uint64_t));
+        return;
+    }
+
+    const size_t stride_a = default_stride(a.cols());
+    const size_t stride_b = default_stride(b.cols());
+    runProduct(a, stride_a, b, stride_b, result, stride_b, [&](cl_mem ma, cl_mem mb, cl_mem mc) {
+        GF2AtBParams params = {cl_uint(a.rows()),         cl_uint(a.cols()),
+                               cl_uint(a.words_per_row()), cl_uint(b.words_per_row()),
+                               cl_uint(stride_a),          cl_uint(stride_b),
+                               cl_uint(stride_b)};
+        set_arg(_multiplyAtB, 0, ma);
+        set_arg(_multiplyAtB, 1, mb);
+        set_arg(_multiplyAtB, 2, mc);
+        set_arg(_multiplyAtB, 3, params);
+        const size_t global[3] = {64, b.words_per_row(), a.words_per_row()};
+        cl_event event = nullptr;
+        check(clEnqueueNDRangeKernel(_queue, _multiplyAtB, 3, nullptr, global, nullptr, 0,
+                                     nullptr, &event),
+              "gf2_multiply_at_b_kernel");
+        _events.push_back(event);
+    });
+}
+
+// runProduct uploads a as both operands; the kernel reads the first only
+void GF2OpenCL::multiplyAAt(const GF2Matrix& a, GF2Matrix& result, GF2Triangle triangle,
+                            bool mirror) {
+    if (result.rows() != a.rows() || result.cols() != a.rows()) {
+        throw std::runtime_error("Result matrix has wrong dimensions");
+    }
+    if (a.rows() == 0) {
+        return;
+    }
+    if (a.cols() == 0) {
+        memset(result.get_raw_data(), 0, result.rows() * result.row_stride() * sizeof(uint64_t));
+        return;
+    }
+
+    const size_t stride_a = default_stride(a.cols());
+    const size_t stride_c = default_stride(a.rows());
+    runProduct(a, stride_a, a, stride_a, result, stride_c, [&](cl_mem ma, cl_mem, cl_mem mc) {
+        GF2AAtParams params = {cl_uint(a.rows()), cl_uint(a.words_per_row()), cl_uint(stride_a),
+                               cl_uint(stride_c),
+                               cl_uint(triangle == GF2Triangle::Upper ? 1 : 0)};
+        set_arg(_multiplyAAt, 0, ma);
+        set_arg(_multiplyAAt, 1, mc);
+        set_arg(_multiplyAAt, 2, params);
+        const size_t global[2] = {a.rows(), stride_c};
+        cl_event event = nullptr;
+        check(clEnqueueNDRangeKernel(_queue, _multiplyAAt, 2, nullptr, global, nullptr, 0,
+                                     nullptr, &event),
+              "gf2_multiply_aat_kernel");
+        _events.push_back(event);
+    });
+    if (mirror) {
+        result.mirrorTriangle(triangle);
+    }
+}
+
+// The tile storage is unpadded rows of tiles, uploaded at its own stride
+void GF2OpenCL::multiplyTiled(const GF2TiledMatrix& a, const GF2TiledMatrix& b,
+                              GF2TiledMatrix& result) {
+    if (a.cols() != b.rows() || a.tile() != b.tile()) {
+        throw std::runtime_error("Matrix dimensions don't match for multiplication");
+    }
+    if (result.rows() != a.rows() || result.cols() != b.cols() || result.tile() != a.tile()) {
+        throw std::runtime_error("Result matrix has wrong dimensions");
+    }
+    GF2Matrix& c = result.storage();
+    if (c.rows() == 0) {
+        return;
+    }
+    if (a.storage().rows() == 0) {
+        memset(c.get_raw_data(), 0, c.rows() * c.row_stride() * sizeof(uint64_t));
+        return;
+    }
+
+    const size_t stride = a.tileWords();
+    runProduct(a.storage(), stride, b.storage(), stride, c, stride,
+               [&](cl_mem ma, cl_mem mb, cl_mem mc) {
+        GF2MortonParams params = {cl_uint(a.tile()), cl_uint(a.tileWords()),
+                                  cl_uint(result.tileRows()), cl_uint(a.tileCols()),
+                                  cl_uint(result.tileCols())};
+        set_arg(_multiplyMorton, 0, ma);
+        set_arg(_multiplyMorton, 1, mb);
+        set_arg(_multiplyMorton, 2, mc);
+        set_arg(_multiplyMorton, 3, params);
+        const size_t global[2] = {result.tileCols() * a.tile(), result.tileRows()};
+        const size_t local[2] = {a.tile(), 1};
+        cl_event event = nullptr;
+        check(clEnqueueNDRangeKernel(_queue, _multiplyMorton, 2, nullptr, global, local, 0,
+                                     nullptr, &event),
+              "gf2_multiply_morton_kernel");
+        _events.push_back(event);
+    });
+}
+
+// The operands go into new buffers at the given strides, encode enqueues the
+// kernels (their events in _events), and the result comes back through one
+void GF2OpenCL::runProduct(const GF2Matrix& a, size_t stride_a, const GF2Matrix& b,
+                           size_t stride_b, GF2Matrix& result, size_t stride_c,
+                           const std::function<void(cl_mem, cl_mem, cl_mem)>& encode) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    GF2GPUTiming timing;
+    auto host_start = std::chrono::steady_clock::now();
+
+    std::vector<uint64_t> scratch_a, scratch_b;
+    const uint64_t* data_a = packed_rows(a, stride_a, scratch_a);
+    const uint64_t* data_b = packed_rows(b, stride_b, scratch_b);
+    timing.host_ms = elapsed_ms(host_start);
+
+    auto upload_start = std::chrono::steady_clock::now();
+    ScopedBuffer buf_a, buf_b, buf_result;
+    createBuffer(buf_a, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                 a.rows() * stride_a * sizeof(uint64_t), data_a, "clCreateBuffer(A)");
+    createBuffer(buf_b, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                 b.rows() * stride_b * sizeof(uint64_t), data_b, "clCreateBuffer(B)");
+    createBuffer(buf_result, CL_MEM_WRITE_ONLY, result.rows() * stride_c * sizeof(uint64_t),
+                 nullptr, "clCreateBuffer(C)");
+    timing.upload_ms = elapsed_ms(upload_start);
+    const bool metrics = GF2Metrics::enabled();
+    if (metrics) {
+        GF2Metrics::add(GF2Counter::GpuBytesToDevice,
+                        int64_t((a.rows() * stride_a + b.rows() * stride_b) * sizeof(uint64_t)));
+        GF2Metrics::add(GF2Counter::GpuQueueDepth, 1);
+    }
+
+    _events.clear();
+    try {
+        encode(buf_a.mem, buf_b.mem, buf_result.mem);
+        check(clFinish(_queue), "clFinish");
+    } catch (...) {
+        clFinish(_queue);
+        for (cl_event event : _events) {
+            clReleaseEvent(event);
+        }
+        _events.clear();
+        if (metrics) {
+            GF2Metrics::add(GF2Counter::GpuQueueDepth, -1);
+        }
+        throw;
+    }
+    if (metrics) {
+        GF2Metrics::add(GF2Counter::GpuQueueDepth, -1);
+    }
+
+    // GPU time from the first kernel's start to the last one's end
+    cl_ulong first = 0, last = 0;
+    std::vector<std::pair<cl_ulong, cl_ulong>> intervals(_events.size());
+    for (size_t i = 0; i < _events.size(); ++i) {
+        cl_ulong start = 0, end = 0;
+        clGetEventProfilingInfo(_events[i], CL_PROFILING_COMMAND_START, sizeof(start), &start,
+                                nullptr);
+        clGetEventProfilingInfo(_events[i], CL_PROFILING_COMMAND_END, sizeof(end), &end, nullptr);
+        first = i == 0 ? start : std::min(first, start);
+        last = std::max(last, end);
+        intervals[i] = {start, end};
+        clReleaseEvent(_events[i]);
+    }
+    _events.clear();
+#ifdef GF2_TRACE
+    for (const auto& interval : intervals) {
+        GF2_TRACE_GPU("opencl: kernel", double(interval.first) / 1e9,
+                      double(interval.second) / 1e9, double(last) / 1e9);
+    }
+#endif
+    timing.gpu_ms = double(last - first) / 1e6;
+
+    auto readback_start = std::chrono::steady_clock::now();
+    if (result.row_stride() == stride_c) {
+        check(clEnqueueReadBuffer(_queue, buf_result.mem, CL_TRUE, 0,
+                                  result.rows() * stride_c * sizeof(uint64_t),
+                                  result.get_raw_data(), 0, nullptr, nullptr),
+              "clEnqueueReadBuffer");
+    } else {
+        std::vector<uint64_t> packed(result.rows() * stride_c);
+        check(clEnqueueReadBuffer(_queue, buf_result.mem, CL_TRUE, 0,
+                                  packed.size() * sizeof(uint64_t), packed.data(), 0, nullptr,
+                                  nullptr),
+              "clEnqueueReadBuffer");
+        for (size_t r = 0; r < result.rows(); ++r) {
+            memcpy(result.get_raw_data() + r * result.row_stride(), packed.data() + r * stride_c,
+                   result.words_per_row() * sizeof(uint64_t));
+        }
+    }
+    timing.readback_ms = elapsed_ms(readback_start);
+    if (metrics) {
+        GF2Metrics::add(GF2Counter::GpuBytesFromDevice,
+                        int64_t(result.rows() * stride_c * sizeof(uint64_t)));
+    }
+
+    _lastTiming = timing;
+}
+
+void GF2OpenCL::multiplyBlock(const GF2Matrix& a, const uint64_t* x, uint64_t* y) {
+    const size_t global[2] = {a.rows(), 1};
+    runBlockKernel(_matvec, a, x, a.cols(), y, a.rows(), global);
+}
+
+void GF2OpenCL::leftMultiplyBlock(const GF2Matrix& a, const uint64_t* x, uint64_t* y) {
+    const size_t global[2] = {64, a.words_per_row()};
+    runBlockKernel(_matvecLeft, a, x, a.rows(), y, 64 * a.words_per_row(), global);
+}
+
+void GF2OpenCL::runBlockKernel(cl_kernel kernel, const GF2Matrix& a, const uint64_t* x,
+                               size_t x_words, uint64_t* y, size_t y_words,
+                               const size_t global[2]) {
+    if (a.rows() > UINT32_MAX || a.cols() > UINT32_MAX) {
+        throw std::runtime_error("Matrix too large for the GPU block kernels");
+    }
+    if (y_words == 0) {
+        return;
+    }
+    if (x_words == 0 || a.words_per_row() == 0) {
+        memset(y, 0, y_words * sizeof(uint64_t));
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    GF2GPUTiming timing;
+    const size_t stride = default_stride(a.cols());
+    auto upload_start = std::chrono::steady_clock::now();
+    std::vector<uint64_t> scratch;
+    const uint64_t* data = packed_rows(a, stride, scratch);
+    ScopedBuffer buf_a, buf_x, buf_y;
+    createBuffer(buf_a, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                 a.rows() * stride * sizeof(uint64_t), data, "clCreateBuffer(A)");
+    createBuffer(buf_x, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, x_words * sizeof(uint64_t), x,
+                 "clCreateBuffer(x)");
+    createBuffer(buf_y, CL_MEM_WRITE_ONLY, y_words * sizeof(uint64_t), nullptr,
+                 "clCreateBuffer(y)");
+    timing.upload_ms = elapsed_ms(upload_start);
+
+    GF2BlockParams params = {cl_uint(a.rows()), cl_uint(a.cols()), cl_uint(a.words_per_row()),
+                             cl_uint(stride)};
+    set_arg(kernel, 0, buf_a.mem);
+    set_arg(kernel, 1, buf_x.mem);
+    set_arg(kernel, 2, buf_y.mem);
+    set_arg(kernel, 3, params);
+    cl_event event = nullptr;
+    check(clEnqueueNDRangeKernel(_queue, kernel, 2, nullptr, global, nullptr, 0, nullptr, &event),
+          "block kernel");
+    const cl_int finished = clFinish(_queue);
+    cl_ulong begin = 0, end = 0;
+    clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(begin), &begin, nullptr);
+    clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(end), &end, nullptr);
+    clReleaseEvent(event);
+    check(finished, "clFinish");
+    GF2_TRACE_GPU("opencl: block kernel", double(begin) / 1e9, double(end) / 1e9,
+                  double(end) / 1e9);
+    timing.gpu_ms = double(end - begin) / 1e6;
+
+    auto readback_start = std::chrono::steady_clock::now();
+    check(clEnqueueReadBuffer(_queue, buf_y.mem, CL_TRUE, 0, y_words * sizeof(uint64_t), y, 0,
+                              nullptr, nullptr),
+          "clEnqueueReadBuffer");
+    timing.readback_ms = elapsed_ms(readback_start);
+    _lastTiming = timing;
+}
+
+// B^T by the transpose kernel, then one work-item per word of C
+void GF2OpenCL::multiplyTransposed(cl_kernel kernel, cl_mem a, cl_mem b, cl_mem result,
+                                   const GF2Matrix& ma, const GF2Matrix& mb,
+                                   const GF2Matrix& mresult) {
+    const size_t stride_a = default_stride(ma.cols());
+    const size_t stride_b = default_stride(mb.cols());
+
+    // B^T is b_cols x a_cols, at A's stride
+    ScopedBuffer b_transposed;
+    createBuffer(b_transposed, CL_MEM_READ_WRITE, mb.cols() * stride_a * sizeof(uint64_t),
+                 nullptr, "clCreateBuffer(B^T)");
+
+    GF2TransposeParams tparams = {cl_uint(mb.rows()), cl_uint(mb.cols()), cl_uint(stride_b),
+                                  cl_uint(stride_a)};
+    set_arg(_transpose, 0, b);
+    set_arg(_transpose, 1, b_transposed.mem);
+    set_arg(_transpose, 2, tparams);
+    const size_t tglobal[2] = {64 * stride_a, (mb.cols() + 63) / 64};
+    const size_t tlocal[2] = {64, 1};
+    cl_event event = nullptr;
+    check(clEnqueueNDRangeKernel(_queue, _transpose, 2, nullptr, tglobal, tlocal, 0, nullptr,
+                                 &event),
+          "gf2_transpose_kernel");
+    _events.push_back(event);
+
+    GPUParams params = {cl_uint(ma.rows()), cl_uint(ma.cols()), cl_uint(mb.cols()),
+                        cl_uint(stride_a), cl_uint(stride_a), cl_uint(stride_b)};
+    set_arg(kernel, 0, a);
+    set_arg(kernel, 1, b_transposed.mem);
+    set_arg(kernel, 2, result);
+    set_arg(kernel, 3, params);
+    const size_t global[2] = {mresult.rows(), stride_b};
+    check(clEnqueueNDRangeKernel(_queue, kernel, 2, nullptr, global, nullptr, 0, nullptr, &event),
+          "multiply kernel");
+    _events.push_back(event);
+
+    // b_transposed is released on return; the queue must be done with it
+    check(clFinish(_queue), "clFinish");
+}
+
+// Panels of A words whose tables fit in M4R_TABLE_BYTES, the first writing
+// C and the others XORing into it
+void GF2OpenCL::multiplyM4R(cl_mem a, cl_mem b, cl_mem result, const GF2Matrix& ma,
+                            const GF2Matrix& mb, const GF2Matrix& mresult) {
+    const size_t stride_a = default_stride(ma.cols());
+    const size_t stride_b = default_stride(mb.cols());
+    const size_t k_words = (ma.cols() + 63) / 64;
+    const size_t bytes_per_word = size_t(8) * 256 * stride_b * sizeof(uint64_t);
+    const size_t panel_words =
+        std::min(k_words, std::max<size_t>(1, M4R_TABLE_BYTES / bytes_per_word));
+
+    ScopedBuffer tables;
+    createBuffer(tables, CL_MEM_READ_WRITE, panel_words * bytes_per_word, nullptr,
+                 "clCreateBuffer(M4R tables)");
+
+    GPUParams params = {cl_uint(ma.rows()), cl_uint(ma.cols()), cl_uint(mb.cols()),
+                        cl_uint(stride_a), cl_uint(stride_b), cl_uint(stride_b)};
+    for (size_t k0 = 0; k0 < k_words; k0 += panel_words) {
+        GPUM4RPanel panel = {cl_uint(k0), cl_uint(std::min(panel_words, k_words - k0)),
+                             cl_uint(k0 > 0)};
+
+        set_arg(_m4rTables, 0, b);
+        set_arg(_m4rTables, 1, tables.mem);
+        set_arg(_m4rTables, 2, params);
+        set_arg(_m4rTables, 3, panel);
+        const size_t tglobal[2] = {stride_b, size_t(panel.k_words) * 8};
+        cl_event event = nullptr;
+        check(clEnqueueNDRangeKernel(_queue, _m4rTables, 2, nullptr, tglobal, nullptr, 0, nullptr,
+                                     &event),
+              "m4r_make_tables_kernel");
+        _events.push_back(event);
+
+        set_arg(_m4rMultiply, 0, a);
+        set_arg(_m4rMultiply, 1, result);
+        set_arg(_m4rMultiply, 2, tables.mem);
+        set_arg(_m4rMultiply, 3, params);
+        set_arg(_m4rMultiply, 4, panel);
+        const size_t global[2] = {mresult.rows(), stride_b};
+        check(clEnqueueNDRangeKernel(_queue, _m4rMultiply, 2, nullptr, global, nullptr, 0,
+                                     nullptr, &event),
+              "m4r_multiply_kernel");
+        _events.push_back(event);
+    }
+
+    // The in-order queue runs the passes one after the other; the tables are
+    // released on return
+    check(clFinish(_queue), "clFinish");
+}
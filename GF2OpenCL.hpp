@@ -0,0 +1,98 @@
+#pragma once
+
+#include "GF2Backend.hpp"
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#define CL_TARGET_OPENCL_VERSION 120
+#ifdef __APPLE__
+#include <OpenCL/opencl.h>
+#else
+#include <CL/cl.h>
+#endif
+
+// The OpenCL backend, for Linux hosts without Metal. It runs OpenCL C ports
+// (gf2_opencl.cl, compiled at startup) of the transposed, vectorized and M4R
+// kernels on the first GPU of any platform, the products with blocks of
+// vectors and A B^T, A^T B and A A^T. B^T for the first two is made on the
+// device.
+class GF2OpenCL : public GF2Backend {
+public:
+    // Throws std::runtime_error if there is no GPU or the kernels don't build
+    GF2OpenCL();
+    ~GF2OpenCL() override;
+
+    GF2OpenCL(const GF2OpenCL&) = delete;
+    GF2OpenCL& operator=(const GF2OpenCL&) = delete;
+
+    const char* backendName() const override { return "OpenCL"; }
+    std::string deviceName() const override;
+    bool supports(Kernel kernel) override;
+    using GF2Backend::multiply;
+    void multiply(Kernel kernel, const GF2Matrix& a, const GF2Matrix& b,
+                  GF2Matrix& result) override;
+    void multiplyBlock(const GF2Matrix& a, const uint64_t* x, uint64_t* y) override;
+    void leftMultiplyBlock(const GF2Matrix& a, const uint64_t* x, uint64_t* y) override;
+    void multiplyABt(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result) override;
+    void multiplyAtB(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result) override;
+    void multiplyAAt(const GF2Matrix& a, GF2Matrix& result, GF2Triangle triangle,
+                     bool mirror) override;
+    void multiplyTiled(const GF2TiledMatrix& a, const GF2TiledMatrix& b,
+                       GF2TiledMatrix& result) override;
+    GF2GPUTiming lastTiming() const override;
+    // Of the buffers the backend creates; the driver's own are not counted
+    size_t allocatedBytes() const override;
+    size_t peakAllocatedBytes() const override;
+    void resetPeakAllocated() override;
+
+    // Bytes of M4R tables per pass, as on Metal
+    static constexpr size_t M4R_TABLE_BYTES = size_t(64) << 20;
+
+private:
+    struct ScopedBuffer;
+
+    // Releases whatever the constructor created
+    void release();
+    // buffer = a new device buffer of 'bytes', counted in _allocated until
+    // it is released; _mutex held
+    void createBuffer(ScopedBuffer& buffer, cl_mem_flags flags, size_t bytes,
+                      const void* host, const char* what);
+    // A product of a and b into result, their device rows at the given
+    // strides, with the kernels encode enqueues on the device buffers
+    void runProduct(const GF2Matrix& a, size_t stride_a, const GF2Matrix& b, size_t stride_b,
+                    GF2Matrix& result, size_t stride_c,
+                    const std::function<void(cl_mem, cl_mem, cl_mem)>& encode);
+    void multiplyTransposed(cl_kernel kernel, cl_mem a, cl_mem b, cl_mem result,
+                            const GF2Matrix& ma, const GF2Matrix& mb,
+                            const GF2Matrix& mresult);
+    void multiplyM4R(cl_mem a, cl_mem b, cl_mem result, const GF2Matrix& ma,
+                     const GF2Matrix& mb, const GF2Matrix& mresult);
+    // One kernel of the block products over a 2D NDRange of 'global'
+    void runBlockKernel(cl_kernel kernel, const GF2Matrix& a, const uint64_t* x, size_t x_words,
+                        uint64_t* y, size_t y_words, const size_t global[2]);
+
+    cl_device_id _device;
+    cl_context _context;
+    cl_command_queue _queue;
+    cl_program _program;
+    cl_kernel _transpose;
+    cl_kernel _transposed;
+    cl_kernel _vectorized;
+    cl_kernel _m4rTables;
+    cl_kernel _m4rMultiply;
+    cl_kernel _matvec;
+    cl_kernel _matvecLeft;
+    cl_kernel _multiplyAtB;
+    cl_kernel _multiplyAAt;
+    cl_kernel _multiplyMorton;
+
+    // One multiply at a time: the kernels' arguments are shared state
+    mutable std::mutex _mutex;
+    GF2GPUTiming _lastTiming;
+    // Kernels of the current multiply, for the GPU time
+    std::vector<cl_event> _events;
+    // Bytes of the live buffers, and their most since resetPeakAllocated()
+    size_t _allocated;
+    size_t _peakAllocated;
+};
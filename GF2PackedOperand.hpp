@@ -0,0 +1,69 @@
+#pragma once
+
+#include "GF2Matrix.hpp"
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// The right-hand operand B of A * B, prepared once for many multiplies with
+// different A matrices: B^T and, if the selected SIMD kernel reads B in a
+// layout of its own, the packed form of B^T. The GPU entry points keep their
+// uploaded copy next to it (see device_data()). B is copied, so later changes
+// to it are not seen by the operand.
+class GF2PackedOperand {
+public:
+    explicit GF2PackedOperand(const GF2Matrix& b);
+
+    // Shape of B
+    size_t rows() const { return m_rows; }
+    size_t cols() const { return m_cols; }
+
+    // B^T (cols() x rows() bits)
+    const GF2Matrix& transposed() const { return m_b_t; }
+
+    // The operand of the SIMD block kernel (B^T or its packed form) and its
+    // row stride. It covers common-dimension words [0, kernel_words()).
+    const uint64_t* kernel_data() const;
+    size_t kernel_stride() const;
+    size_t kernel_words() const { return m_kernel_words; }
+
+    // Device-side state a GPU backend attaches on first use, e.g. the
+    // uploaded B^T buffer. Released together with the operand.
+    struct DeviceData {
+        virtual ~DeviceData() = default;
+    };
+    DeviceData* device_data() const {
+        std::lock_guard<std::mutex> lock(m_device->mutex);
+        return m_device->data.get();
+    }
+    // The attached state if usable(state) holds, else make()'s, attached in
+    // its place. Both run under the operand's mutex, so threads sharing the
+    // operand upload it once. Replaced state is kept until the operand is
+    // destroyed, as another thread may still be using it.
+    template <typename Usable, typename Make>
+    DeviceData* device_data(Usable usable, Make make) const {
+        std::lock_guard<std::mutex> lock(m_device->mutex);
+        if (!m_device->data || !usable(m_device->data.get())) {
+            std::unique_ptr<DeviceData> data = make();
+            if (m_device->data) {
+                m_device->retired.push_back(std::move(m_device->data));
+            }
+            m_device->data = std::move(data);
+        }
+        return m_device->data.get();
+    }
+
+private:
+    size_t m_rows;
+    size_t m_cols;
+    GF2Matrix m_b_t;
+    std::vector<uint64_t, GF2AlignedAllocator<uint64_t>> m_packed;
+    size_t m_kernel_words;
+
+    struct DeviceSlot {
+        std::mutex mutex;
+        std::unique_ptr<DeviceData> data;
+        std::vector<std::unique_ptr<DeviceData>> retired;
+    };
+    std::unique_ptr<DeviceSlot> m_device = std::make_unique<DeviceSlot>();
+};
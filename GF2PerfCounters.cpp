@@ -0,0 +1,242 @@
+#include "GF2PerfCounters.hpp"
+#include <cerrno>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(__APPLE__)
+#include <dlfcn.h>
+#endif
+
+namespace {
+
+#if defined(__linux__)
+const char* const COUNTER_NAMES[] = {"cycles", "instructions", "l1d-misses",
+                                     "llc-misses", "branch-misses"};
+constexpr size_t COUNTERS = sizeof(COUNTER_NAMES) / sizeof(COUNTER_NAMES[0]);
+
+double* counter_field(GF2PerfSample& sample, size_t index) {
+    double* fields[COUNTERS] = {&sample.cycles, &sample.instructions,
+                                &sample.l1d_misses, &sample.llc_misses,
+                                &sample.branch_misses};
+    return fields[index];
+}
+
+struct Event {
+    uint32_t type;
+    uint64_t config;
+};
+
+// In COUNTER_NAMES order
+const Event EVENTS[COUNTERS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                             (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+// User-space counts of this thread and the threads it creates from now on.
+// Separate events rather than a group, as inherited groups can't be read.
+int open_event(const Event& event) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = event.type;
+    attr.config = event.config;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // Counters are multiplexed when there are more events than registers
+    attr.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+#elif defined(__APPLE__)
+// The private kperf framework's thread counters. The fixed class is cycles
+// and instructions: in that order on Apple silicon, the other way around on
+// Intel.
+constexpr uint32_t KPC_CLASS_FIXED_MASK = 1u << 0;
+#if defined(__aarch64__)
+constexpr size_t FIXED_CYCLES = 0, FIXED_INSTRUCTIONS = 1;
+#else
+constexpr size_t FIXED_CYCLES = 1, FIXED_INSTRUCTIONS = 0;
+#endif
+
+struct Kpc {
+    int (*set_counting)(uint32_t classes) = nullptr;
+    int (*set_thread_counting)(uint32_t classes) = nullptr;
+    uint32_t (*get_counter_count)(uint32_t classes) = nullptr;
+    int (*get_thread_counters)(uint32_t tid, uint32_t count,
+                               uint64_t* counters) = nullptr;
+
+    bool loaded() const {
+        return set_counting && set_thread_counting && get_counter_count &&
+               get_thread_counters;
+    }
+};
+
+const Kpc& kpc() {
+    static const Kpc library = [] {
+        Kpc k;
+        void* handle = dlopen(
+            "/System/Library/PrivateFrameworks/kperf.framework/kperf",
+            RTLD_LAZY);
+        if (handle) {
+            k.set_counting = reinterpret_cast<int (*)(uint32_t)>(
+                dlsym(handle, "kpc_set_counting"));
+            k.set_thread_counting = reinterpret_cast<int (*)(uint32_t)>(
+                dlsym(handle, "kpc_set_thread_counting"));
+            k.get_counter_count = reinterpret_cast<uint32_t (*)(uint32_t)>(
+                dlsym(handle, "kpc_get_counter_count"));
+            k.get_thread_counters =
+                reinterpret_cast<int (*)(uint32_t, uint32_t, uint64_t*)>(
+                    dlsym(handle, "kpc_get_thread_counters"));
+        }
+        return k;
+    }();
+    return library;
+}
+
+bool read_fixed(std::vector<uint64_t>& counters) {
+    counters.assign(kpc().get_counter_count(KPC_CLASS_FIXED_MASK), 0);
+    return !counters.empty() &&
+           kpc().get_thread_counters(0, uint32_t(counters.size()),
+                                     counters.data()) == 0;
+}
+#endif
+
+} // namespace
+
+double GF2PerfSample::ipc() const {
+    return cycles > 0.0 && instructions >= 0.0 ? instructions / cycles : -1.0;
+}
+
+double GF2PerfSample::perWord(double misses, size_t output_words) {
+    return misses >= 0.0 && output_words > 0 ? misses / double(output_words)
+                                             : -1.0;
+}
+
+GF2PerfCounters::~GF2PerfCounters() {
+    close();
+}
+
+bool GF2PerfCounters::open(std::string* error) {
+    close();
+#if defined(__linux__)
+    for (size_t i = 0; i < COUNTERS; ++i) {
+        _fds.push_back(open_event(EVENTS[i]));
+    }
+    if (_fds[0] < 0) {
+        if (error) {
+            *error = std::string("perf_event_open: ") + std::strerror(errno) +
+                     " (see /proc/sys/kernel/perf_event_paranoid)";
+        }
+        close();
+        return false;
+    }
+    _open = true;
+#elif defined(__APPLE__)
+    if (!kpc().loaded()) {
+        if (error) {
+            *error = "kperf framework not found";
+        }
+        return false;
+    }
+    if (kpc().set_counting(KPC_CLASS_FIXED_MASK) != 0 ||
+        kpc().set_thread_counting(KPC_CLASS_FIXED_MASK) != 0 ||
+        !read_fixed(_begin)) {
+        if (error) {
+            *error = "kperf counters need root";
+        }
+        return false;
+    }
+    _open = true;
+#else
+    if (error) {
+        *error = "no counter interface on this platform";
+    }
+#endif
+    return _open;
+}
+
+void GF2PerfCounters::close() {
+#if defined(__linux__)
+    for (int fd : _fds) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+#endif
+    _fds.clear();
+    _begin.clear();
+    _open = false;
+}
+
+std::string GF2PerfCounters::describe() const {
+    std::string names;
+#if defined(__linux__)
+    for (size_t i = 0; i < _fds.size(); ++i) {
+        if (_fds[i] >= 0) {
+            names += std::string(names.empty() ? "" : " ") + COUNTER_NAMES[i];
+        }
+    }
+#elif defined(__APPLE__)
+    if (_open) {
+        names = "cycles instructions";
+    }
+#endif
+    return names;
+}
+
+void GF2PerfCounters::start() {
+    if (!_open) {
+        return;
+    }
+#if defined(__linux__)
+    for (int fd : _fds) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#elif defined(__APPLE__)
+    read_fixed(_begin);
+#endif
+}
+
+GF2PerfSample GF2PerfCounters::stop() {
+    GF2PerfSample sample;
+    if (!_open) {
+        return sample;
+    }
+#if defined(__linux__)
+    for (size_t i = 0; i < _fds.size(); ++i) {
+        if (_fds[i] < 0) {
+            continue;
+        }
+        ioctl(_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t value[3] = {0, 0, 0}; // count, time enabled, time running
+        if (read(_fds[i], value, sizeof(value)) == ssize_t(sizeof(value)) &&
+            value[2] > 0) {
+            *counter_field(sample, i) =
+                double(value[0]) * double(value[1]) / double(value[2]);
+        }
+    }
+#elif defined(__APPLE__)
+    std::vector<uint64_t> end;
+    if (read_fixed(end) && end.size() == _begin.size() &&
+        end.size() > FIXED_CYCLES && end.size() > FIXED_INSTRUCTIONS) {
+        sample.cycles = double(end[FIXED_CYCLES] - _begin[FIXED_CYCLES]);
+        sample.instructions =
+            double(end[FIXED_INSTRUCTIONS] - _begin[FIXED_INSTRUCTIONS]);
+    }
+#endif
+    return sample;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Hardware counters of one timed region. Negative = not counted on this
+// machine.
+struct GF2PerfSample {
+    double cycles = -1.0;
+    double instructions = -1.0;
+    double l1d_misses = -1.0; // L1 data cache read misses
+    double llc_misses = -1.0; // last-level cache misses
+    double branch_misses = -1.0;
+
+    bool valid() const { return cycles >= 0.0; }
+    // Instructions per cycle, or -1
+    double ipc() const;
+    // Misses per 64-bit word of the product, or -1
+    static double perWord(double misses, size_t output_words);
+};
+
+// Cycles, instructions, cache and branch misses of the calling thread,
+// through perf_event_open on Linux and the kperf fixed counters (cycles and
+// instructions only; root required) on macOS. Linux counters are inherited by
+// threads created after open(), not by a thread pool that already runs.
+class GF2PerfCounters {
+public:
+    GF2PerfCounters() = default;
+    ~GF2PerfCounters();
+
+    GF2PerfCounters(const GF2PerfCounters&) = delete;
+    GF2PerfCounters& operator=(const GF2PerfCounters&) = delete;
+
+    // False, with the reason in 'error', if this machine doesn't let us
+    // count cycles
+    bool open(std::string* error = nullptr);
+    void close();
+    bool isOpen() const { return _open; }
+    // The counters open, e.g. "cycles instructions llc-misses"
+    std::string describe() const;
+
+    // Around the timed region; stop() returns an empty sample when closed
+    void start();
+    GF2PerfSample stop();
+
+private:
+    bool _open = false;
+    std::vector<int> _fds;        // perf_event descriptors, -1 if unavailable (Linux)
+    std::vector<uint64_t> _begin; // fixed counters at start() (macOS)
+};
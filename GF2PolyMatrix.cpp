@@ -0,0 +1,313 @@
+#include "GF2PolyMatrix.hpp"
+#include "GF2CpuInfo.hpp"
+#include "GF2Kernels.hpp"
+#include "GF2Random.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <omp.h>
+#include <stdexcept>
+
+namespace {
+
+// The first supported kernel, or the one GF2_CLMUL_KERNEL names if it is
+// supported
+ClmulKernel select_clmul_kernel() {
+    const std::vector<ClmulKernel> supported = clmul_kernels();
+    const char* forced = std::getenv("GF2_CLMUL_KERNEL");
+    if (forced) {
+        for (const ClmulKernel& kernel : supported) {
+            if (std::strcmp(forced, kernel.name) == 0) return kernel;
+        }
+    }
+    return supported.front();
+}
+
+int resolve_threads(int num_threads) {
+    return num_threads > 0 ? num_threads : omp_get_max_threads();
+}
+
+// Entries per side of the tiles of a plane product, one tile per task
+constexpr size_t CLMUL_TILE = 64;
+
+// Common-dimension words per kernel call, so that the CLMUL_TILE rows of a
+// tile of B^T (128 KiB) stay in L2 across the rows of A
+constexpr size_t CLMUL_K_WORDS = 256;
+
+// The planes of a product: m x k for A, n x k for B^T, m x n for the result
+struct PlaneShape {
+    size_t m, n, k;
+};
+
+// lo, hi ^= the carry-less product of the planes a and b_t, in tiles over
+// the threads
+void plane_product(const uint64_t* a, const uint64_t* b_t, uint64_t* lo, uint64_t* hi,
+                   const PlaneShape& s, int threads) {
+    const ClmulKernel& kernel = clmul_kernel();
+    const size_t tiles_n = (s.n + CLMUL_TILE - 1) / CLMUL_TILE;
+    const long long tiles = static_cast<long long>((s.m + CLMUL_TILE - 1) / CLMUL_TILE * tiles_n);
+    #pragma omp parallel for schedule(static) num_threads(threads) if (tiles > 1)
+    for (long long t = 0; t < tiles; ++t) {
+        const size_t i0 = size_t(t) / tiles_n * CLMUL_TILE, j0 = size_t(t) % tiles_n * CLMUL_TILE;
+        const size_t m = std::min(CLMUL_TILE, s.m - i0), n = std::min(CLMUL_TILE, s.n - j0);
+        const size_t c = i0 * s.n + j0;
+        for (size_t k0 = 0; k0 < s.k; k0 += CLMUL_K_WORDS) {
+            kernel.block(a + i0 * s.k + k0, s.k, b_t + j0 * s.k + k0, s.k, lo + c, hi + c, s.n, m,
+                         n, std::min(CLMUL_K_WORDS, s.k - k0));
+        }
+    }
+}
+
+// r[0 .. 2n) ^= A * B for the polynomials A = sum a[t] x^(64 t) and
+// B = sum b[t] x^(64 t) of n planes each (b holding B^T). With
+// A = lo + x^(64 h) hi (h = n / 2) and likewise B, and P0 = lo * lo',
+// P2 = hi * hi', P1 = (lo + hi) * (lo' + hi'), writing y = x^(64 h):
+// A * B = P0 (1 + y) + P1 y + P2 (y + y^2).
+void karatsuba(const uint64_t* const* a, const uint64_t* const* b, size_t n, uint64_t* const* r,
+               const PlaneShape& s, size_t min_words, int threads) {
+    if (n < min_words || n == 1) {
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = 0; j < n; ++j) {
+                plane_product(a[i], b[j], r[i + j], r[i + j + 1], s, threads);
+            }
+        }
+        return;
+    }
+    const size_t h = n / 2, g = n - h;
+    const size_t c_words = s.m * s.n;
+    for (size_t half = 0; half < 2; ++half) {
+        const size_t planes = half == 0 ? h : g, shift = half == 0 ? 0 : h;
+        std::vector<uint64_t> p(2 * planes * c_words);
+        std::vector<uint64_t*> pr(2 * planes);
+        for (size_t x = 0; x < pr.size(); ++x) pr[x] = p.data() + x * c_words;
+        karatsuba(a + shift, b + shift, planes, pr.data(), s, min_words, threads);
+        for (size_t x = 0; x < pr.size(); ++x) {
+            row_xor(r[x + 2 * shift], pr[x], c_words);
+            row_xor(r[x + h], pr[x], c_words);
+        }
+    }
+    // The high halves have g >= h planes; the low ones are added to the first h
+    std::vector<uint64_t> sa(g * s.m * s.k), sb(g * s.n * s.k);
+    std::vector<const uint64_t*> pa(g), pb(g);
+    for (size_t i = 0; i < g; ++i) {
+        uint64_t* x = sa.data() + i * s.m * s.k;
+        uint64_t* y = sb.data() + i * s.n * s.k;
+        std::copy_n(a[h + i], s.m * s.k, x);
+        std::copy_n(b[h + i], s.n * s.k, y);
+        if (i < h) {
+            row_xor(x, a[i], s.m * s.k);
+            row_xor(y, b[i], s.n * s.k);
+        }
+        pa[i] = x;
+        pb[i] = y;
+    }
+    karatsuba(pa.data(), pb.data(), g, r + h, s, min_words, threads);
+}
+
+} // namespace
+
+// The shift-and-add fallback: a's bit s contributes b << s to the product
+void clmul_block_scalar(const uint64_t* a, size_t a_stride, const uint64_t* b_t,
+                        size_t b_t_stride, uint64_t* lo, uint64_t* hi, size_t c_stride,
+                        size_t m, size_t n, size_t k) {
+    for (size_t i = 0; i < m; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            uint64_t sum_lo = 0, sum_hi = 0;
+            for (size_t p = 0; p < k; ++p) {
+                const uint64_t x = a[i * a_stride + p], y = b_t[j * b_t_stride + p];
+                sum_lo ^= (x & 1) ? y : 0;
+                for (unsigned bit = 1; bit < 64; ++bit) {
+                    const uint64_t mask = 0 - ((x >> bit) & 1);
+                    sum_lo ^= (y << bit) & mask;
+                    sum_hi ^= (y >> (64 - bit)) & mask;
+                }
+            }
+            lo[i * c_stride + j] ^= sum_lo;
+            hi[i * c_stride + j] ^= sum_hi;
+        }
+    }
+}
+
+std::vector<ClmulKernel> clmul_kernels() {
+    const GF2CpuInfo& cpu = GF2CpuInfo::get();
+
+    // Candidates in order of preference
+    struct Candidate {
+        ClmulKernel kernel;
+        bool supported;
+    };
+    const Candidate candidates[] = {
+#if defined(__x86_64__) || defined(_M_X64)
+        {{"vpclmul", clmul_block_vpclmul}, cpu.vpclmulqdq && cpu.avx512f},
+        {{"pclmul", clmul_block_pclmul}, cpu.pclmul},
+#elif defined(__aarch64__)
+        {{"pmull", clmul_block_pmull}, cpu.pmull},
+#endif
+        {{"scalar", clmul_block_scalar}, true},
+    };
+
+    std::vector<ClmulKernel> supported;
+    for (const auto& c : candidates) {
+        if (c.supported) supported.push_back(c.kernel);
+    }
+    return supported;
+}
+
+const ClmulKernel& clmul_kernel() {
+    static const ClmulKernel kernel = select_clmul_kernel();
+    return kernel;
+}
+
+GF2PolyMatrix::GF2PolyMatrix(size_t rows, size_t cols, size_t length)
+    : m_rows(rows), m_cols(cols), m_length(length) {
+    if (length == 0) {
+        throw std::runtime_error("Polynomial matrix length must be positive");
+    }
+    m_data.assign(words() * rows * cols, 0);
+}
+
+GF2PolyMatrix GF2PolyMatrix::fromCoefficients(const std::vector<GF2Matrix>& coefficients) {
+    if (coefficients.empty()) {
+        throw std::runtime_error("Polynomial matrix needs at least one coefficient");
+    }
+    const size_t rows = coefficients[0].rows(), cols = coefficients[0].cols();
+    GF2PolyMatrix result(rows, cols, coefficients.size());
+    for (size_t d = 0; d < coefficients.size(); ++d) {
+        const GF2Matrix& c = coefficients[d];
+        if (c.rows() != rows || c.cols() != cols) {
+            throw std::runtime_error("Polynomial matrix coefficients of different shapes");
+        }
+        uint64_t* plane = result.plane(d / 64);
+        for (size_t i = 0; i < rows; ++i) {
+            const uint64_t* row = c.get_raw_data() + i * c.row_stride();
+            for (size_t j = 0; j < cols; ++j) {
+                plane[i * cols + j] |= ((row[j / 64] >> (j % 64)) & 1) << (d % 64);
+            }
+        }
+    }
+    return result;
+}
+
+GF2Matrix GF2PolyMatrix::coefficient(size_t d) const {
+    GF2Matrix c(m_rows, m_cols);
+    if (d >= m_length) {
+        return c;
+    }
+    const uint64_t* words = plane(d / 64);
+    for (size_t i = 0; i < m_rows; ++i) {
+        uint64_t* row = c.get_raw_data() + i * c.row_stride();
+        for (size_t j = 0; j < m_cols; ++j) {
+            row[j / 64] |= ((words[i * m_cols + j] >> (d % 64)) & 1) << (j % 64);
+        }
+    }
+    return c;
+}
+
+bool GF2PolyMatrix::get(size_t row, size_t col, size_t d) const {
+    if (row >= m_rows || col >= m_cols || d >= m_length) return false;
+    return (plane(d / 64)[row * m_cols + col] >> (d % 64)) & 1;
+}
+
+void GF2PolyMatrix::set(size_t row, size_t col, size_t d, bool value) {
+    if (row >= m_rows || col >= m_cols || d >= m_length) {
+        throw std::runtime_error("Matrix index out of bounds");
+    }
+    uint64_t& word = plane(d / 64)[row * m_cols + col];
+    const uint64_t bit = uint64_t(1) << (d % 64);
+    word = value ? word | bit : word & ~bit;
+}
+
+void GF2PolyMatrix::randomFill(uint64_t seed, int num_threads) {
+    if (m_rows == 0 || m_cols == 0) {
+        return;
+    }
+    gf2_random_fill(m_data.data(), words() * m_rows, m_cols, m_cols, seed, num_threads);
+    if (m_length % 64 != 0) {
+        const uint64_t mask = (uint64_t(1) << (m_length % 64)) - 1;
+        uint64_t* top = plane(words() - 1);
+        for (size_t x = 0; x < m_rows * m_cols; ++x) {
+            top[x] &= mask;
+        }
+    }
+}
+
+GF2PolyMatrix GF2PolyMatrix::multiply(const GF2PolyMatrix& other, int num_threads) const {
+    return product(other, KARATSUBA_MIN_WORDS, num_threads);
+}
+
+GF2PolyMatrix GF2PolyMatrix::multiplyClassical(const GF2PolyMatrix& other,
+                                               int num_threads) const {
+    return product(other, SIZE_MAX, num_threads);
+}
+
+// Both operands are padded with zero planes to the same number of words.
+// The 2w product planes cover degrees up to 128w - 2; those past the
+// result's length are zero and dropped.
+GF2PolyMatrix GF2PolyMatrix::product(const GF2PolyMatrix& other, size_t karatsuba_min_words,
+                                     int num_threads) const {
+    if (m_cols != other.m_rows) {
+        throw std::runtime_error("Matrix dimensions incompatible for multiplication");
+    }
+    GF2PolyMatrix result(m_rows, other.m_cols, m_length + other.m_length - 1);
+    const PlaneShape s{m_rows, other.m_cols, m_cols};
+    if (s.m == 0 || s.n == 0 || s.k == 0) {
+        return result;
+    }
+    const int threads = resolve_threads(num_threads);
+    const size_t w = std::max(words(), other.words());
+
+    // B^T of every plane of other, and a zero plane of either shape
+    std::vector<uint64_t> b_t(other.words() * s.n * s.k);
+    std::vector<uint64_t> zero(std::max(s.m, s.n) * s.k, 0);
+    std::vector<const uint64_t*> a(w, zero.data()), b(w, zero.data());
+    for (size_t t = 0; t < w; ++t) {
+        if (t < words()) {
+            a[t] = plane(t);
+        }
+        if (t < other.words()) {
+            const uint64_t* src = other.plane(t);
+            uint64_t* dst = b_t.data() + t * s.n * s.k;
+            for (size_t p = 0; p < s.k; ++p) {
+                for (size_t j = 0; j < s.n; ++j) {
+                    dst[j * s.k + p] = src[p * s.n + j];
+                }
+            }
+            b[t] = dst;
+        }
+    }
+
+    const size_t c_words = s.m * s.n;
+    std::vector<uint64_t> r(2 * w * c_words, 0);
+    std::vector<uint64_t*> pr(2 * w);
+    for (size_t t = 0; t < pr.size(); ++t) pr[t] = r.data() + t * c_words;
+    karatsuba(a.data(), b.data(), w, pr.data(), s, karatsuba_min_words, threads);
+    std::copy_n(r.data(), result.m_data.size(), result.m_data.data());
+    return result;
+}
+
+GF2PolyMatrix GF2PolyMatrix::multiplySerial(const GF2PolyMatrix& other) const {
+    if (m_cols != other.m_rows) {
+        throw std::runtime_error("Matrix dimensions incompatible for multiplication");
+    }
+    GF2PolyMatrix result(m_rows, other.m_cols, m_length + other.m_length - 1);
+    for (size_t i = 0; i < m_rows; ++i) {
+        for (size_t j = 0; j < other.m_cols; ++j) {
+            for (size_t p = 0; p < m_cols; ++p) {
+                for (size_t da = 0; da < m_length; ++da) {
+                    if (!get(i, p, da)) continue;
+                    for (size_t db = 0; db < other.m_length; ++db) {
+                        if (other.get(p, j, db)) {
+                            result.set(i, j, da + db, !result.get(i, j, da + db));
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return result;
+}
+
+bool GF2PolyMatrix::operator==(const GF2PolyMatrix& other) const {
+    return m_rows == other.m_rows && m_cols == other.m_cols && m_length == other.m_length &&
+           m_data == other.m_data;
+}
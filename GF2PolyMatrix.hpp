@@ -0,0 +1,76 @@
+#pragma once
+
+#include "GF2AlignedAllocator.hpp"
+#include "GF2Matrix.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A matrix over GF(2)[x] whose entries are polynomials of degree below
+// length(), packed in words() word planes: plane t holds word t of every
+// entry, row-major, and bit b of that word is the coefficient of
+// x^(64 t + b). Bits from length() on are zero. A product of two such
+// matrices is a product of polynomials whose coefficients are matrices of
+// 64-bit polynomials, and each product of two planes is a matrix product
+// whose scalar products are carry-less (clmul_kernel(): VPCLMULQDQ,
+// PCLMULQDQ or PMULL), the low and high words of every entry going to two
+// consecutive planes of the result:
+//   - from KARATSUBA_MIN_WORDS planes on, the planes are split
+//     Karatsuba-style, 3 half-size products for 4, which for w planes
+//     takes about w^1.58 plane products instead of w^2;
+//   - below it, or in multiplyClassical, every pair of planes is multiplied.
+// This is the matrix polynomial product of Block Wiedemann (the generator
+// and its updates), where the entries have thousands of coefficients.
+class GF2PolyMatrix {
+public:
+    static constexpr size_t KARATSUBA_MIN_WORDS = 2;
+
+    // An all-zero matrix of entries of degree below length. Throws
+    // std::runtime_error if length is 0.
+    GF2PolyMatrix(size_t rows, size_t cols, size_t length);
+
+    // The matrix sum_d coefficients[d] x^d. Throws std::runtime_error if
+    // there are none or their shapes differ.
+    static GF2PolyMatrix fromCoefficients(const std::vector<GF2Matrix>& coefficients);
+
+    size_t rows() const { return m_rows; }
+    size_t cols() const { return m_cols; }
+    size_t length() const { return m_length; }
+    size_t words() const { return (m_length + 63) / 64; }
+
+    // Word t of every entry, rows() x cols() words, t < words()
+    const uint64_t* plane(size_t t) const { return m_data.data() + t * m_rows * m_cols; }
+    uint64_t* plane(size_t t) { return m_data.data() + t * m_rows * m_cols; }
+
+    // The coefficient of x^d of every entry (zero for d >= length())
+    GF2Matrix coefficient(size_t d) const;
+
+    // The coefficient of x^d of entry (row, col); set throws
+    // std::runtime_error for indices out of range
+    bool get(size_t row, size_t col, size_t d) const;
+    void set(size_t row, size_t col, size_t d, bool value);
+
+    // Planes from the gf2_random_fill stream of the seed, as one matrix of
+    // words() * rows() rows of cols() words, cut to length()
+    void randomFill(uint64_t seed, int num_threads = 0);
+
+    // this * other, of length length() + other.length() - 1, on num_threads
+    // threads (<= 0 for the OpenMP default). Throws std::runtime_error if
+    // the shapes do not match.
+    GF2PolyMatrix multiply(const GF2PolyMatrix& other, int num_threads = 0) const;
+    // The same without the Karatsuba split
+    GF2PolyMatrix multiplyClassical(const GF2PolyMatrix& other, int num_threads = 0) const;
+    // Coefficient by coefficient, as a reference
+    GF2PolyMatrix multiplySerial(const GF2PolyMatrix& other) const;
+
+    bool operator==(const GF2PolyMatrix& other) const;
+
+private:
+    size_t m_rows;
+    size_t m_cols;
+    size_t m_length;
+    std::vector<uint64_t, GF2AlignedAllocator<uint64_t>> m_data;
+
+    GF2PolyMatrix product(const GF2PolyMatrix& other, size_t karatsuba_min_words,
+                          int num_threads) const;
+};
@@ -0,0 +1,86 @@
+// Only compile this file for aarch64 architecture. It is built with
+// -march=armv8-a+aes and only called after the runtime dispatch has
+// confirmed PMULL (the 64-bit polynomial multiply of the crypto extension).
+#if defined(__aarch64__)
+
+#include "GF2Kernels.hpp"
+#include <arm_neon.h>
+#include <algorithm>
+
+// Rows of A and of B^T per register tile: 2 x 2 dot products share each load
+static constexpr size_t TILE_ROWS = 2;
+static constexpr size_t TILE_COLS = 2;
+
+static inline uint64x2_t pmull_low(uint64x2_t x, uint64x2_t y) {
+    return vreinterpretq_u64_p128(vmull_p64(vgetq_lane_u64(x, 0), vgetq_lane_u64(y, 0)));
+}
+
+static inline uint64x2_t pmull_high(uint64x2_t x, uint64x2_t y) {
+    return vreinterpretq_u64_p128(
+        vmull_high_p64(vreinterpretq_p64_u64(x), vreinterpretq_p64_u64(y)));
+}
+
+// Two words of each operand per step, the low halves multiplied by PMULL and
+// the high halves by PMULL2, into 128-bit accumulators
+template <size_t R, size_t C>
+static inline void clmul_tile(const uint64_t* a, size_t a_stride, const uint64_t* b_t,
+                              size_t b_t_stride, uint64_t* lo, uint64_t* hi, size_t c_stride,
+                              size_t k) {
+    uint64x2_t acc[R][C];
+    for (size_t r = 0; r < R; ++r) {
+        for (size_t c = 0; c < C; ++c) acc[r][c] = vdupq_n_u64(0);
+    }
+    size_t p = 0;
+    for (; p + 2 <= k; p += 2) {
+        uint64x2_t x[R], y[C];
+        for (size_t r = 0; r < R; ++r) x[r] = vld1q_u64(a + r * a_stride + p);
+        for (size_t c = 0; c < C; ++c) y[c] = vld1q_u64(b_t + c * b_t_stride + p);
+        for (size_t r = 0; r < R; ++r) {
+            for (size_t c = 0; c < C; ++c) {
+                acc[r][c] = veorq_u64(acc[r][c], pmull_low(x[r], y[c]));
+                acc[r][c] = veorq_u64(acc[r][c], pmull_high(x[r], y[c]));
+            }
+        }
+    }
+    if (p < k) {
+        for (size_t r = 0; r < R; ++r) {
+            for (size_t c = 0; c < C; ++c) {
+                const poly128_t product = vmull_p64(a[r * a_stride + p], b_t[c * b_t_stride + p]);
+                acc[r][c] = veorq_u64(acc[r][c], vreinterpretq_u64_p128(product));
+            }
+        }
+    }
+    for (size_t r = 0; r < R; ++r) {
+        for (size_t c = 0; c < C; ++c) {
+            lo[r * c_stride + c] ^= vgetq_lane_u64(acc[r][c], 0);
+            hi[r * c_stride + c] ^= vgetq_lane_u64(acc[r][c], 1);
+        }
+    }
+}
+
+void clmul_block_pmull(const uint64_t* a, size_t a_stride, const uint64_t* b_t,
+                       size_t b_t_stride, uint64_t* lo, uint64_t* hi, size_t c_stride,
+                       size_t m, size_t n, size_t k) {
+    for (size_t i = 0; i < m; i += TILE_ROWS) {
+        const uint64_t* a_rows = a + i * a_stride;
+        const bool full_rows = i + TILE_ROWS <= m;
+        for (size_t j = 0; j < n; j += TILE_COLS) {
+            const uint64_t* b_rows = b_t + j * b_t_stride;
+            const size_t at = i * c_stride + j;
+            if (full_rows && j + TILE_COLS <= n) {
+                clmul_tile<TILE_ROWS, TILE_COLS>(a_rows, a_stride, b_rows, b_t_stride, lo + at,
+                                                 hi + at, c_stride, k);
+                continue;
+            }
+            for (size_t r = i; r < std::min(m, i + TILE_ROWS); ++r) {
+                for (size_t c = j; c < std::min(n, j + TILE_COLS); ++c) {
+                    const size_t x = r * c_stride + c;
+                    clmul_tile<1, 1>(a + r * a_stride, a_stride, b_t + c * b_t_stride,
+                                     b_t_stride, lo + x, hi + x, c_stride, k);
+                }
+            }
+        }
+    }
+}
+
+#endif // defined(__aarch64__)
@@ -0,0 +1,86 @@
+// Only compile this file for x86_64 architecture. It is built with
+// -mavx512f -mvpclmulqdq and only called after the runtime dispatch has
+// confirmed AVX-512F and VPCLMULQDQ support.
+#if defined(__x86_64__) || defined(_M_X64)
+
+#include "GF2Kernels.hpp"
+
+// GCC 12 warns about the _mm512_undefined_* placeholders inside its own
+// AVX-512 intrinsics headers (a known false positive)
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include <immintrin.h>
+#include <algorithm>
+
+// Rows of A and of B^T per register tile: 2 x 2 dot products share each load
+static constexpr size_t TILE_ROWS = 2;
+static constexpr size_t TILE_COLS = 2;
+
+// VPTERNLOGQ truth table of a ^ b ^ c
+static constexpr int TERNLOG_XOR3 = 0x96;
+
+// Eight words of each operand per step: VPCLMULQDQ multiplies the low words
+// of the four 128-bit lanes with one instruction and the high words with a
+// second, and one VPTERNLOGQ adds both to the accumulator. The tail words
+// are loaded under a mask, as zeros past k. The lanes are folded at the end.
+template <size_t R, size_t C>
+static inline void clmul_tile(const uint64_t* a, size_t a_stride, const uint64_t* b_t,
+                              size_t b_t_stride, uint64_t* lo, uint64_t* hi, size_t c_stride,
+                              size_t k) {
+    __m512i acc[R][C];
+    for (size_t r = 0; r < R; ++r) {
+        for (size_t c = 0; c < C; ++c) acc[r][c] = _mm512_setzero_si512();
+    }
+    for (size_t p = 0; p < k; p += 8) {
+        const __mmask8 mask = k - p >= 8 ? __mmask8(0xFF) : __mmask8((1u << (k - p)) - 1);
+        __m512i x[R], y[C];
+        for (size_t r = 0; r < R; ++r) x[r] = _mm512_maskz_loadu_epi64(mask, a + r * a_stride + p);
+        for (size_t c = 0; c < C; ++c) {
+            y[c] = _mm512_maskz_loadu_epi64(mask, b_t + c * b_t_stride + p);
+        }
+        for (size_t r = 0; r < R; ++r) {
+            for (size_t c = 0; c < C; ++c) {
+                acc[r][c] = _mm512_ternarylogic_epi64(acc[r][c],
+                                                      _mm512_clmulepi64_epi128(x[r], y[c], 0x00),
+                                                      _mm512_clmulepi64_epi128(x[r], y[c], 0x11),
+                                                      TERNLOG_XOR3);
+            }
+        }
+    }
+    alignas(64) uint64_t lanes[8];
+    for (size_t r = 0; r < R; ++r) {
+        for (size_t c = 0; c < C; ++c) {
+            _mm512_store_si512(lanes, acc[r][c]);
+            lo[r * c_stride + c] ^= lanes[0] ^ lanes[2] ^ lanes[4] ^ lanes[6];
+            hi[r * c_stride + c] ^= lanes[1] ^ lanes[3] ^ lanes[5] ^ lanes[7];
+        }
+    }
+}
+
+void clmul_block_vpclmul(const uint64_t* a, size_t a_stride, const uint64_t* b_t,
+                         size_t b_t_stride, uint64_t* lo, uint64_t* hi, size_t c_stride,
+                         size_t m, size_t n, size_t k) {
+    for (size_t i = 0; i < m; i += TILE_ROWS) {
+        const uint64_t* a_rows = a + i * a_stride;
+        const bool full_rows = i + TILE_ROWS <= m;
+        for (size_t j = 0; j < n; j += TILE_COLS) {
+            const uint64_t* b_rows = b_t + j * b_t_stride;
+            const size_t at = i * c_stride + j;
+            if (full_rows && j + TILE_COLS <= n) {
+                clmul_tile<TILE_ROWS, TILE_COLS>(a_rows, a_stride, b_rows, b_t_stride, lo + at,
+                                                 hi + at, c_stride, k);
+                continue;
+            }
+            for (size_t r = i; r < std::min(m, i + TILE_ROWS); ++r) {
+                for (size_t c = j; c < std::min(n, j + TILE_COLS); ++c) {
+                    const size_t x = r * c_stride + c;
+                    clmul_tile<1, 1>(a + r * a_stride, a_stride, b_t + c * b_t_stride,
+                                     b_t_stride, lo + x, hi + x, c_stride, k);
+                }
+            }
+        }
+    }
+}
+
+#endif // defined(__x86_64__) || defined(_M_X64)
@@ -0,0 +1,84 @@
+// Only compile this file for x86_64 architecture. It is built with -mpclmul
+// and only called after the runtime dispatch has confirmed PCLMULQDQ support.
+#if defined(__x86_64__) || defined(_M_X64)
+
+#include "GF2Kernels.hpp"
+#include <immintrin.h>
+#include <algorithm>
+
+// Rows of A and of B^T per register tile: 2 x 2 dot products share each load
+static constexpr size_t TILE_ROWS = 2;
+static constexpr size_t TILE_COLS = 2;
+
+// Two words of each operand per step, the low halves multiplied by one
+// PCLMULQDQ and the high halves by another, into 128-bit accumulators
+template <size_t R, size_t C>
+static inline void clmul_tile(const uint64_t* a, size_t a_stride, const uint64_t* b_t,
+                              size_t b_t_stride, uint64_t* lo, uint64_t* hi, size_t c_stride,
+                              size_t k) {
+    __m128i acc[R][C];
+    for (size_t r = 0; r < R; ++r) {
+        for (size_t c = 0; c < C; ++c) acc[r][c] = _mm_setzero_si128();
+    }
+    size_t p = 0;
+    for (; p + 2 <= k; p += 2) {
+        __m128i x[R], y[C];
+        for (size_t r = 0; r < R; ++r) {
+            x[r] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + r * a_stride + p));
+        }
+        for (size_t c = 0; c < C; ++c) {
+            y[c] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b_t + c * b_t_stride + p));
+        }
+        for (size_t r = 0; r < R; ++r) {
+            for (size_t c = 0; c < C; ++c) {
+                acc[r][c] = _mm_xor_si128(acc[r][c], _mm_clmulepi64_si128(x[r], y[c], 0x00));
+                acc[r][c] = _mm_xor_si128(acc[r][c], _mm_clmulepi64_si128(x[r], y[c], 0x11));
+            }
+        }
+    }
+    if (p < k) {
+        for (size_t r = 0; r < R; ++r) {
+            const __m128i x =
+                _mm_loadl_epi64(reinterpret_cast<const __m128i*>(a + r * a_stride + p));
+            for (size_t c = 0; c < C; ++c) {
+                const __m128i y =
+                    _mm_loadl_epi64(reinterpret_cast<const __m128i*>(b_t + c * b_t_stride + p));
+                acc[r][c] = _mm_xor_si128(acc[r][c], _mm_clmulepi64_si128(x, y, 0x00));
+            }
+        }
+    }
+    for (size_t r = 0; r < R; ++r) {
+        for (size_t c = 0; c < C; ++c) {
+            lo[r * c_stride + c] ^= uint64_t(_mm_cvtsi128_si64(acc[r][c]));
+            hi[r * c_stride + c] ^=
+                uint64_t(_mm_cvtsi128_si64(_mm_unpackhi_epi64(acc[r][c], acc[r][c])));
+        }
+    }
+}
+
+void clmul_block_pclmul(const uint64_t* a, size_t a_stride, const uint64_t* b_t,
+                        size_t b_t_stride, uint64_t* lo, uint64_t* hi, size_t c_stride,
+                        size_t m, size_t n, size_t k) {
+    for (size_t i = 0; i < m; i += TILE_ROWS) {
+        const uint64_t* a_rows = a + i * a_stride;
+        const bool full_rows = i + TILE_ROWS <= m;
+        for (size_t j = 0; j < n; j += TILE_COLS) {
+            const uint64_t* b_rows = b_t + j * b_t_stride;
+            const size_t at = i * c_stride + j;
+            if (full_rows && j + TILE_COLS <= n) {
+                clmul_tile<TILE_ROWS, TILE_COLS>(a_rows, a_stride, b_rows, b_t_stride, lo + at,
+                                                 hi + at, c_stride, k);
+                continue;
+            }
+            for (size_t r = i; r < std::min(m, i + TILE_ROWS); ++r) {
+                for (size_t c = j; c < std::min(n, j + TILE_COLS); ++c) {
+                    const size_t x = r * c_stride + c;
+                    clmul_tile<1, 1>(a + r * a_stride, a_stride, b_t + c * b_t_stride,
+                                     b_t_stride, lo + x, hi + x, c_stride, k);
+                }
+            }
+        }
+    }
+}
+
+#endif // defined(__x86_64__) || defined(_M_X64)
@@ -0,0 +1,109 @@
+#include "GF2ProductCache.hpp"
+#include <stdexcept>
+#include <utility>
+
+GF2ProductCache::GF2ProductCache(size_t max_bytes) : m_max_bytes(max_bytes) {}
+
+GF2ProductCache::Key GF2ProductCache::keyOf(const GF2Matrix& a, const GF2Matrix& b) {
+    return Key{a.contentHash(), b.contentHash()};
+}
+
+size_t GF2ProductCache::bytesOf(const GF2Matrix& m) {
+    return m.rows() * m.row_stride() * sizeof(uint64_t);
+}
+
+std::shared_ptr<const GF2Matrix> GF2ProductCache::find(const GF2Matrix& a, const GF2Matrix& b) {
+    // Hashed outside the lock, once per matrix
+    const Key key = keyOf(a, b);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_index.find(key);
+    if (it == m_index.end()) {
+        ++m_stats.misses;
+        return nullptr;
+    }
+    ++m_stats.hits;
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    return it->second->product;
+}
+
+bool GF2ProductCache::lookup(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result) {
+    std::shared_ptr<const GF2Matrix> product = find(a, b);
+    if (!product) {
+        return false;
+    }
+    result = *product;
+    return true;
+}
+
+void GF2ProductCache::insert(const GF2Matrix& a, const GF2Matrix& b,
+                             std::shared_ptr<const GF2Matrix> product) {
+    const Key key = keyOf(a, b);
+    const size_t bytes = bytesOf(*product);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_index.find(key);
+    if (it != m_index.end()) {
+        m_stats.bytes -= it->second->bytes;
+        m_lru.erase(it->second);
+        m_index.erase(it);
+        --m_stats.entries;
+    }
+    if (bytes > m_max_bytes) {
+        return;
+    }
+    m_lru.push_front(Entry{key, std::move(product), bytes});
+    m_index.emplace(key, m_lru.begin());
+    m_stats.bytes += bytes;
+    ++m_stats.entries;
+    ++m_stats.insertions;
+    shrink();
+}
+
+std::shared_ptr<const GF2Matrix> GF2ProductCache::multiply(const GF2Matrix& a, const GF2Matrix& b,
+                                                           const Product& product) {
+    if (a.cols() != b.rows()) {
+        throw std::runtime_error("Matrix dimensions don't match for multiplication");
+    }
+    std::shared_ptr<const GF2Matrix> cached = find(a, b);
+    if (cached) {
+        return cached;
+    }
+    auto result = std::make_shared<GF2Matrix>(a.rows(), b.cols());
+    product(a, b, *result);
+    insert(a, b, result);
+    return result;
+}
+
+void GF2ProductCache::shrink() {
+    while (m_stats.bytes > m_max_bytes && !m_lru.empty()) {
+        const Entry& cold = m_lru.back();
+        m_stats.bytes -= cold.bytes;
+        m_index.erase(cold.key);
+        m_lru.pop_back();
+        --m_stats.entries;
+        ++m_stats.evictions;
+    }
+}
+
+void GF2ProductCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lru.clear();
+    m_index.clear();
+    m_stats.entries = 0;
+    m_stats.bytes = 0;
+}
+
+void GF2ProductCache::setMaxBytes(size_t max_bytes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_max_bytes = max_bytes;
+    shrink();
+}
+
+size_t GF2ProductCache::maxBytes() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_max_bytes;
+}
+
+GF2ProductCacheStats GF2ProductCache::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
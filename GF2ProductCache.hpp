@@ -0,0 +1,92 @@
+#pragma once
+
+#include "GF2Matrix.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// Hits, misses and occupancy of a GF2ProductCache
+struct GF2ProductCacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t insertions = 0;
+    size_t evictions = 0;
+    size_t entries = 0;
+    size_t bytes = 0; // storage of the cached products
+
+    double hitRate() const {
+        return hits + misses > 0 ? double(hits) / double(hits + misses) : 0.0;
+    }
+};
+
+// Memoized products for workloads that multiply the same (A, B) pairs
+// again, such as a fixed generator matrix against recurring inputs. A
+// product is keyed by the operands' contentHash(), which is computed once
+// per matrix at memory bandwidth and cached on it, so a repeated pair costs
+// two cached hashes and a lookup instead of a multiply. The products are
+// kept in LRU order within a budget of bytes of their storage; one larger
+// than the whole budget is not kept.
+//
+// Keys are 256 bits of content hash. Two different pairs sharing a key
+// would get each other's product, which for inputs not built to collide
+// does not happen in practice. Thread safe; two threads missing on the
+// same pair at once both multiply it.
+class GF2ProductCache {
+public:
+    static constexpr size_t DEFAULT_MAX_BYTES = size_t(256) << 20;
+
+    using Product = std::function<void(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& c)>;
+
+    explicit GF2ProductCache(size_t max_bytes = DEFAULT_MAX_BYTES);
+
+    // The cached a * b and a hit, or null and a miss
+    std::shared_ptr<const GF2Matrix> find(const GF2Matrix& a, const GF2Matrix& b);
+    // Copies the cached a * b into result; false (and result as it was)
+    // on a miss
+    bool lookup(const GF2Matrix& a, const GF2Matrix& b, GF2Matrix& result);
+    // Keeps product as a * b, replacing what was kept for the pair
+    void insert(const GF2Matrix& a, const GF2Matrix& b, std::shared_ptr<const GF2Matrix> product);
+
+    // The cached a * b, else product(a, b, c) into a new matrix that is
+    // then kept. Throws std::runtime_error if the shapes do not match.
+    std::shared_ptr<const GF2Matrix> multiply(const GF2Matrix& a, const GF2Matrix& b,
+                                              const Product& product);
+
+    // Drops every product; the counts of hits and misses stay
+    void clear();
+    void setMaxBytes(size_t max_bytes);
+    size_t maxBytes() const;
+    GF2ProductCacheStats stats() const;
+
+private:
+    struct Key {
+        GF2ContentHash a;
+        GF2ContentHash b;
+        bool operator==(const Key& o) const { return a == o.a && b == o.b; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            return size_t(k.a.lo ^ (k.b.lo * 0x9E3779B97F4A7C15ULL));
+        }
+    };
+    struct Entry {
+        Key key;
+        std::shared_ptr<const GF2Matrix> product;
+        size_t bytes;
+    };
+
+    static Key keyOf(const GF2Matrix& a, const GF2Matrix& b);
+    static size_t bytesOf(const GF2Matrix& m);
+    // Under the mutex: evicts from the cold end down to the budget
+    void shrink();
+
+    mutable std::mutex m_mutex;
+    size_t m_max_bytes;
+    std::list<Entry> m_lru; // most recently used first
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> m_index;
+    GF2ProductCacheStats m_stats;
+};
@@ -0,0 +1,300 @@
+// The gf2 Python module (pybind11). Matrices and views export their packed
+// words through the buffer protocol, so numpy.asarray(m) is a uint64 array
+// of rows x words_per_row over the matrix's own storage, at its row stride:
+// no copy either way. Bytes and packed bit streams come in and go out
+// through fromBytes / fromBits and their inverses, a row kernel per row
+// instead of a call per bit. Every multiply and conversion releases the
+// GIL, so Python threads can drive several backends or engines at once.
+
+#include "GF2Backend.hpp"
+#include "GF2Engine.hpp"
+#include "GF2Matrix.hpp"
+#include "GF2MatrixView.hpp"
+#include <pybind11/numpy.h>
+#include <pybind11/operators.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace py = pybind11;
+
+namespace {
+
+// rows x words at a stride of 'stride' words
+py::buffer_info words_buffer(const uint64_t* data, size_t rows, size_t words, size_t stride,
+                             bool readonly) {
+    return py::buffer_info(const_cast<uint64_t*>(data), sizeof(uint64_t),
+                           py::format_descriptor<uint64_t>::format(), 2,
+                           {py::ssize_t(rows), py::ssize_t(words)},
+                           {py::ssize_t(stride * sizeof(uint64_t)), py::ssize_t(sizeof(uint64_t))},
+                           readonly);
+}
+
+// A 2-D array of one-byte items (uint8, int8 or bool) whose rows are
+// contiguous, read in place; returns the row stride in bytes
+size_t byte_rows(const py::array& a, size_t min_cols) {
+    if (a.ndim() != 2 || a.itemsize() != 1) {
+        throw py::value_error("Expected a 2-D array of one-byte items");
+    }
+    if (a.shape(1) > 1 && a.strides(1) != 1) {
+        throw py::value_error("Array rows must be contiguous");
+    }
+    if (size_t(a.shape(1)) < min_cols) {
+        throw py::value_error("Array rows are too short");
+    }
+    if (a.shape(0) <= 1) {
+        return size_t(a.shape(1));
+    }
+    if (a.strides(0) < a.shape(1)) {
+        throw py::value_error("Array rows must not overlap");
+    }
+    return size_t(a.strides(0));
+}
+
+GF2BitOrder bit_order(const std::string& order) {
+    if (order == "big") return GF2BitOrder::MsbFirst;
+    if (order == "little") return GF2BitOrder::LsbFirst;
+    throw py::value_error("bitorder must be 'big' or 'little'");
+}
+
+GF2Engine::Method method_named(const std::string& name) {
+    for (int i = 0; i <= int(GF2Engine::Method::Hybrid); ++i) {
+        const auto method = static_cast<GF2Engine::Method>(i);
+        if (name == GF2Engine::methodName(method)) {
+            return method;
+        }
+    }
+    throw py::value_error("Unknown method " + name);
+}
+
+} // namespace
+
+PYBIND11_MODULE(gf2, m) {
+    m.doc() = "Bit-packed matrices over GF(2)";
+
+    py::class_<GF2Matrix>(m, "Matrix", py::buffer_protocol())
+        .def(py::init<size_t, size_t>(), py::arg("rows"), py::arg("cols"))
+        // Writes through the array may change the bits, so the cached
+        // structure is dropped on every export
+        .def_buffer([](GF2Matrix& a) {
+            return words_buffer(a.get_raw_data(), a.rows(), a.words_per_row(), a.row_stride(),
+                                false);
+        })
+        .def_property_readonly("rows", &GF2Matrix::rows)
+        .def_property_readonly("cols", &GF2Matrix::cols)
+        .def_property_readonly("words_per_row", &GF2Matrix::words_per_row)
+        .def_property_readonly("row_stride", &GF2Matrix::row_stride)
+        .def_property_readonly(
+            "shape", [](const GF2Matrix& a) { return py::make_tuple(a.rows(), a.cols()); })
+        .def("__getitem__",
+             [](const GF2Matrix& a, std::pair<size_t, size_t> rc) {
+                 return a.get(rc.first, rc.second);
+             })
+        .def("__setitem__",
+             [](GF2Matrix& a, std::pair<size_t, size_t> rc, bool value) {
+                 a.set(rc.first, rc.second, value);
+             })
+        .def(py::self == py::self)
+        .def("copy", [](const GF2Matrix& a) { return GF2Matrix(a); })
+        .def("random_fill", py::overload_cast<>(&GF2Matrix::randomFill))
+        .def("random_fill", py::overload_cast<uint64_t, int>(&GF2Matrix::randomFill),
+             py::arg("seed"), py::arg("num_threads") = 0,
+             py::call_guard<py::gil_scoped_release>())
+        .def("popcount", &GF2Matrix::popcount)
+        .def("invalidate_structure", &GF2Matrix::invalidateStructure)
+        // After writes through an exported array that reached the padding
+        .def("clear_padding", [](GF2Matrix& a) { GF2MutableMatrixView(a).clearPadding(); })
+        .def("content_hash",
+             [](const GF2Matrix& a) {
+                 const GF2ContentHash h = a.contentHash();
+                 return py::make_tuple(h.lo, h.hi);
+             })
+        .def("view", &GF2Matrix::view, py::keep_alive<0, 1>())
+        .def("mutable_view", &GF2Matrix::mutableView, py::keep_alive<0, 1>())
+        .def("__matmul__",
+             py::overload_cast<const GF2Matrix&, int>(&GF2Matrix::multiplySIMDParallel,
+                                                      py::const_),
+             py::arg("other"), py::arg("num_threads") = 0,
+             py::call_guard<py::gil_scoped_release>())
+        .def("multiply_m4r",
+             [](const GF2Matrix& a, const GF2Matrix& b) { return a.multiplyM4R(b); },
+             py::call_guard<py::gil_scoped_release>())
+        .def("transpose", [](const GF2Matrix& a) { return a.transpose().materialize(); },
+             py::call_guard<py::gil_scoped_release>())
+        .def("rank", &GF2Matrix::rank, py::arg("num_threads") = 0,
+             py::call_guard<py::gil_scoped_release>())
+        .def("inverse", &GF2Matrix::inverse, py::arg("num_threads") = 0,
+             py::call_guard<py::gil_scoped_release>())
+        .def_static("solve",
+                    py::overload_cast<const GF2Matrix&, const GF2Matrix&, int>(&GF2Matrix::solve),
+                    py::arg("a"), py::arg("b"), py::arg("num_threads") = 0,
+                    py::call_guard<py::gil_scoped_release>())
+        .def_static(
+            "from_bytes",
+            [](const py::array& a, int num_threads) {
+                const size_t stride = byte_rows(a, 0);
+                const auto* data = static_cast<const uint8_t*>(a.data());
+                const size_t rows = size_t(a.shape(0)), cols = size_t(a.shape(1));
+                py::gil_scoped_release release;
+                return GF2Matrix::fromBytes(data, rows, cols, stride, num_threads);
+            },
+            py::arg("array"), py::arg("num_threads") = 0)
+        .def(
+            "to_bytes",
+            [](const GF2Matrix& a, int num_threads) {
+                py::array_t<uint8_t> out({a.rows(), a.cols()});
+                uint8_t* data = out.mutable_data();
+                {
+                    py::gil_scoped_release release;
+                    a.toBytes(data, a.cols(), num_threads);
+                }
+                return out;
+            },
+            py::arg("num_threads") = 0)
+        // Rows as numpy.packbits(..., axis=1, bitorder=bitorder) packs them
+        .def_static(
+            "from_bits",
+            [](const py::array& a, size_t cols, const std::string& bitorder, int num_threads) {
+                const GF2BitOrder order = bit_order(bitorder);
+                const size_t stride = byte_rows(a, (cols + 7) / 8);
+                const auto* data = static_cast<const uint8_t*>(a.data());
+                const size_t rows = size_t(a.shape(0));
+                py::gil_scoped_release release;
+                return GF2Matrix::fromBits(data, rows, cols, order, stride, num_threads);
+            },
+            py::arg("array"), py::arg("cols"), py::arg("bitorder") = "big",
+            py::arg("num_threads") = 0)
+        .def(
+            "to_bits",
+            [](const GF2Matrix& a, const std::string& bitorder, int num_threads) {
+                const GF2BitOrder order = bit_order(bitorder);
+                const size_t bytes = (a.cols() + 7) / 8;
+                py::array_t<uint8_t> out({a.rows(), bytes});
+                uint8_t* data = out.mutable_data();
+                {
+                    py::gil_scoped_release release;
+                    a.toBits(data, order, bytes, num_threads);
+                }
+                return out;
+            },
+            py::arg("bitorder") = "big", py::arg("num_threads") = 0)
+        .def("__repr__", [](const GF2Matrix& a) {
+            return "<gf2.Matrix " + std::to_string(a.rows()) + "x" + std::to_string(a.cols()) +
+                   ">";
+        });
+
+    // The words of a view are those of its rows in the matrix: column 0 is
+    // bit bit_offset of each row's first word, and the last word may hold
+    // columns past the view
+    py::class_<GF2MatrixView>(m, "View", py::buffer_protocol())
+        .def(py::init<const GF2Matrix&>(), py::keep_alive<1, 2>())
+        .def_buffer([](const GF2MatrixView& v) {
+            return words_buffer(v.get_raw_data(), v.rows(), v.words_per_row(), v.row_stride(),
+                                true);
+        })
+        .def_property_readonly("rows", &GF2MatrixView::rows)
+        .def_property_readonly("cols", &GF2MatrixView::cols)
+        .def_property_readonly("bit_offset", &GF2MatrixView::bit_offset)
+        .def_property_readonly("word_aligned", &GF2MatrixView::word_aligned)
+        .def("__getitem__",
+             [](const GF2MatrixView& v, std::pair<size_t, size_t> rc) {
+                 return v.get(rc.first, rc.second);
+             })
+        .def("view", &GF2MatrixView::view, py::keep_alive<0, 1>())
+        .def("copy", &GF2MatrixView::copy);
+    py::implicitly_convertible<GF2Matrix, GF2MatrixView>();
+
+    py::class_<GF2MutableMatrixView, GF2MatrixView>(m, "MutableView", py::buffer_protocol())
+        .def(py::init<GF2Matrix&>(), py::keep_alive<1, 2>())
+        .def_buffer([](const GF2MutableMatrixView& v) {
+            return words_buffer(v.get_raw_data(), v.rows(), v.words_per_row(), v.row_stride(),
+                                false);
+        })
+        .def("__setitem__",
+             [](const GF2MutableMatrixView& v, std::pair<size_t, size_t> rc, bool value) {
+                 v.set(rc.first, rc.second, value);
+             })
+        .def("mutable_view", &GF2MutableMatrixView::mutableView, py::keep_alive<0, 1>())
+        .def("clear_padding", &GF2MutableMatrixView::clearPadding);
+    py::implicitly_convertible<GF2Matrix, GF2MutableMatrixView>();
+
+    // out = a * b on views, in place in out's matrix
+    m.def(
+        "multiply_into",
+        [](const GF2MatrixView& a, const GF2MatrixView& b, const GF2MutableMatrixView& out,
+           int num_threads) {
+            GF2Workspace ws;
+            GF2Matrix::multiplyInto(a, b, out, ws, num_threads);
+        },
+        py::arg("a"), py::arg("b"), py::arg("out"), py::arg("num_threads") = 1,
+        py::call_guard<py::gil_scoped_release>());
+
+    py::enum_<GF2Kernel>(m, "Kernel")
+        .value("Baseline", GF2Kernel::Baseline)
+        .value("Transposed", GF2Kernel::Transposed)
+        .value("Tiled", GF2Kernel::Tiled)
+        .value("Vectorized", GF2Kernel::Vectorized)
+        .value("SimdGroup", GF2Kernel::SimdGroup)
+        .value("M4R", GF2Kernel::M4R);
+
+    py::class_<GF2Backend>(m, "Backend")
+        .def_property_readonly("name", &GF2Backend::backendName)
+        .def_property_readonly("device", &GF2Backend::deviceName)
+        .def("supports", &GF2Backend::supports, py::call_guard<py::gil_scoped_release>())
+        .def(
+            "multiply",
+            [](GF2Backend& gpu, GF2Kernel kernel, const GF2Matrix& a, const GF2Matrix& b) {
+                GF2Matrix result(a.rows(), b.cols());
+                gpu.multiply(kernel, a, b, result);
+                return result;
+            },
+            py::call_guard<py::gil_scoped_release>());
+    // GF2Backend::create(): the host's GPU backend, or None
+    m.def("create_backend", &GF2Backend::create);
+
+    py::class_<GF2EngineConfig>(m, "EngineConfig")
+        .def(py::init<>())
+        .def_readwrite("dims", &GF2EngineConfig::dims)
+        .def_readwrite("repetitions", &GF2EngineConfig::repetitions)
+        .def_readwrite("max_method_ms", &GF2EngineConfig::max_method_ms)
+        .def_readwrite("num_threads", &GF2EngineConfig::num_threads)
+        .def_readwrite("structure_aware", &GF2EngineConfig::structure_aware)
+        .def_readwrite("product_cache_bytes", &GF2EngineConfig::product_cache_bytes)
+        .def_readwrite("profile_path", &GF2EngineConfig::profile_path)
+        .def_readwrite("persist_profile", &GF2EngineConfig::persist_profile);
+
+    // Methods by their GF2Engine::methodName
+    py::class_<GF2Engine>(m, "Engine")
+        .def(py::init<GF2Backend*, GF2EngineConfig>(), py::arg("backend") = py::none(),
+             py::arg("config") = GF2EngineConfig(), py::keep_alive<1, 2>())
+        .def("multiply", py::overload_cast<const GF2Matrix&, const GF2Matrix&>(
+                             &GF2Engine::multiply),
+             py::call_guard<py::gil_scoped_release>())
+        .def(
+            "choose",
+            [](GF2Engine& e, size_t rows, size_t inner, size_t cols) {
+                return std::string(GF2Engine::methodName(e.choose(rows, inner, cols)));
+            },
+            py::call_guard<py::gil_scoped_release>())
+        .def(
+            "run",
+            [](GF2Engine& e, const std::string& method, const GF2Matrix& a, const GF2Matrix& b) {
+                const GF2Engine::Method chosen = method_named(method);
+                GF2Matrix result(a.rows(), b.cols());
+                py::gil_scoped_release release;
+                e.run(chosen, a, b, result);
+                return result;
+            })
+        .def("calibrate", &GF2Engine::calibrate, py::call_guard<py::gil_scoped_release>())
+        .def("available_methods",
+             [](const GF2Engine& e) {
+                 std::vector<std::string> names;
+                 for (GF2Engine::Method method : e.availableMethods()) {
+                     names.push_back(GF2Engine::methodName(method));
+                 }
+                 return names;
+             })
+        .def("machine_key", &GF2Engine::machineKey);
+}
@@ -0,0 +1,89 @@
+#include "GF2Random.hpp"
+#include <algorithm>
+#include <omp.h>
+
+namespace {
+
+constexpr uint32_t PHILOX_M0 = 0xD2511F53u;
+constexpr uint32_t PHILOX_M1 = 0xCD9E8D57u;
+constexpr uint32_t PHILOX_W0 = 0x9E3779B9u;
+constexpr uint32_t PHILOX_W1 = 0xBB67AE85u;
+constexpr int PHILOX_ROUNDS = 10;
+
+// Counters generated side by side: each round is then a handful of
+// independent 32 x 32 -> 64 multiplies the compiler turns into vector ones
+constexpr size_t LANES = 16;
+
+// Philox4x32-10 of the LANES counters (x0, x1, x2, x3)[l], in place
+void philox_lanes(uint32_t* x0, uint32_t* x1, uint32_t* x2, uint32_t* x3, uint32_t k0,
+                  uint32_t k1) {
+    for (int round = 0; round < PHILOX_ROUNDS; ++round) {
+        for (size_t l = 0; l < LANES; ++l) {
+            const uint64_t p0 = uint64_t(PHILOX_M0) * x0[l];
+            const uint64_t p1 = uint64_t(PHILOX_M1) * x2[l];
+            x0[l] = uint32_t(p1 >> 32) ^ x1[l] ^ k0;
+            x1[l] = uint32_t(p1);
+            x2[l] = uint32_t(p0 >> 32) ^ x3[l] ^ k1;
+            x3[l] = uint32_t(p0);
+        }
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+}
+
+// Words [0, words) of row r
+void fill_row(uint64_t* out, size_t words, uint64_t seed, uint64_t r) {
+    const uint32_t k0 = uint32_t(seed), k1 = uint32_t(seed >> 32);
+    for (size_t w = 0; w < words; w += 2 * LANES) {
+        alignas(64) uint32_t x0[LANES], x1[LANES], x2[LANES], x3[LANES];
+        for (size_t l = 0; l < LANES; ++l) {
+            const uint64_t counter = w / 2 + l;
+            x0[l] = uint32_t(counter);
+            x1[l] = uint32_t(counter >> 32);
+            x2[l] = uint32_t(r);
+            x3[l] = uint32_t(r >> 32);
+        }
+        philox_lanes(x0, x1, x2, x3, k0, k1);
+        const size_t n = std::min(words - w, 2 * LANES);
+        if (n == 2 * LANES) {
+            for (size_t l = 0; l < LANES; ++l) {
+                out[w + 2 * l] = x0[l] | (uint64_t(x1[l]) << 32);
+                out[w + 2 * l + 1] = x2[l] | (uint64_t(x3[l]) << 32);
+            }
+        } else {
+            for (size_t i = 0; i < n; ++i) {
+                const size_t l = i / 2;
+                out[w + i] = (i % 2 == 0) ? x0[l] | (uint64_t(x1[l]) << 32)
+                                          : x2[l] | (uint64_t(x3[l]) << 32);
+            }
+        }
+    }
+}
+
+} // namespace
+
+uint64_t gf2_random_word(uint64_t seed, uint64_t row, uint64_t word) {
+    uint32_t x0 = uint32_t(word / 2), x1 = uint32_t(word / 2 >> 32);
+    uint32_t x2 = uint32_t(row), x3 = uint32_t(row >> 32);
+    uint32_t k0 = uint32_t(seed), k1 = uint32_t(seed >> 32);
+    for (int round = 0; round < PHILOX_ROUNDS; ++round) {
+        const uint64_t p0 = uint64_t(PHILOX_M0) * x0;
+        const uint64_t p1 = uint64_t(PHILOX_M1) * x2;
+        x0 = uint32_t(p1 >> 32) ^ x1 ^ k0;
+        x1 = uint32_t(p1);
+        x2 = uint32_t(p0 >> 32) ^ x3 ^ k1;
+        x3 = uint32_t(p0);
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    return (word % 2 == 0) ? x0 | (uint64_t(x1) << 32) : x2 | (uint64_t(x3) << 32);
+}
+
+void gf2_random_fill(uint64_t* data, size_t rows, size_t words_per_row, size_t row_stride,
+                     uint64_t seed, int num_threads) {
+    const int threads = num_threads > 0 ? num_threads : omp_get_max_threads();
+    #pragma omp parallel for schedule(static) num_threads(threads) if (rows * words_per_row >= 4096)
+    for (size_t r = 0; r < rows; ++r) {
+        fill_row(data + r * row_stride, words_per_row, seed, r);
+    }
+}
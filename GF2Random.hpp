@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// The counter-based generator behind GF2Matrix::randomFill(seed): word w of
+// row r is half w % 2 of Philox4x32-10 (Salmon et al., "Parallel random
+// numbers: as easy as 1, 2, 3") keyed by the seed, on the counter
+// (w / 2, r). A word depends only on the seed and its position, so any block
+// of a matrix can be generated on its own, in any order and on any thread
+// or device, and gives the same bits.
+uint64_t gf2_random_word(uint64_t seed, uint64_t row, uint64_t word);
+
+// Fills words [0, words_per_row) of rows [0, rows) of data, whose rows are
+// row_stride words apart, with the gf2_random_word stream, the rows spread
+// over OpenMP threads (num_threads <= 0 for the OpenMP default). The bits
+// do not depend on the thread count.
+void gf2_random_fill(uint64_t* data, size_t rows, size_t words_per_row, size_t row_stride,
+                     uint64_t seed, int num_threads = 0);
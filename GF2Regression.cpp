@@ -0,0 +1,243 @@
+#include "GF2Regression.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+
+namespace {
+
+// (method, matrix_size, m, k, n, machine)
+using Key =
+    std::tuple<std::string, size_t, size_t, size_t, size_t, std::string>;
+
+// Fields of one CSV line, with "..." quoting and "" escapes as saveResults
+// writes them
+std::vector<std::string> csv_fields(const std::string &line) {
+  std::vector<std::string> fields(1);
+  bool quoted = false;
+  for (size_t i = 0; i < line.size(); ++i) {
+    const char c = line[i];
+    if (quoted) {
+      if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+        fields.back() += '"';
+        ++i;
+      } else if (c == '"') {
+        quoted = false;
+      } else {
+        fields.back() += c;
+      }
+    } else if (c == '"') {
+      quoted = true;
+    } else if (c == ',') {
+      fields.emplace_back();
+    } else if (c != '\r') {
+      fields.back() += c;
+    }
+  }
+  return fields;
+}
+
+std::string machine_of(const TestResult &r) {
+  return r.backend.empty() ? "" : r.backend + " " + r.device;
+}
+
+std::map<Key, std::vector<double>>
+throughput_samples(const std::vector<TestResult> &results) {
+  std::map<Key, std::vector<double>> samples;
+  for (const TestResult &r : results) {
+    if (r.correct && r.throughput_gbps > 0.0) {
+      samples[{r.method, r.matrix_size, r.m, r.k, r.n, machine_of(r)}]
+          .push_back(r.throughput_gbps);
+    }
+  }
+  return samples;
+}
+
+double median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  const size_t mid = values.size() / 2;
+  return values.size() % 2 ? values[mid]
+                           : 0.5 * (values[mid - 1] + values[mid]);
+}
+
+} // namespace
+
+std::vector<TestResult> GF2Regression::loadResults(const std::string &filename) {
+  std::ifstream file(filename);
+  if (!file.is_open()) {
+    throw std::runtime_error("Failed to open file: " + filename);
+  }
+
+  std::string line;
+  if (!std::getline(file, line)) {
+    throw std::runtime_error(filename + " is empty");
+  }
+  std::map<std::string, size_t> column;
+  const std::vector<std::string> header = csv_fields(line);
+  for (size_t i = 0; i < header.size(); ++i) {
+    column[header[i]] = i;
+  }
+  if (!column.count("Method") || !column.count("Throughput_GOPS")) {
+    throw std::runtime_error(filename + " is not a results file");
+  }
+
+  std::vector<TestResult> results;
+  size_t line_number = 1;
+  while (std::getline(file, line)) {
+    ++line_number;
+    if (line.empty()) {
+      continue;
+    }
+    const std::vector<std::string> fields = csv_fields(line);
+    auto field = [&](const char *name) -> std::string {
+      auto it = column.find(name);
+      return it != column.end() && it->second < fields.size()
+                 ? fields[it->second]
+                 : std::string();
+    };
+    auto number = [&](const char *name) {
+      const std::string value = field(name);
+      return value.empty() ? 0.0 : std::stod(value);
+    };
+
+    TestResult r{field("Method"), 0.0, true, 0.0, 0, {}};
+    try {
+      r.duration_ms = number("Duration_ms");
+      r.throughput_gbps = number("Throughput_GOPS");
+      r.correct = field("Correct") != "0";
+      r.matrix_size = size_t(number("Matrix_Size"));
+      r.m = size_t(number("M"));
+      r.k = size_t(number("K"));
+      r.n = size_t(number("N"));
+      r.threads = int(number("Threads"));
+    } catch (const std::logic_error &) {
+      throw std::runtime_error(filename + ":" + std::to_string(line_number) +
+                               ": bad number");
+    }
+    r.backend = field("Backend");
+    r.kernel = field("Kernel");
+    r.device = field("Device");
+    r.build = field("Build");
+    r.timestamp = field("Timestamp");
+    results.push_back(r);
+  }
+  return results;
+}
+
+std::vector<RegressionRow>
+GF2Regression::compare(const std::vector<TestResult> &baseline,
+                       const std::vector<TestResult> &current,
+                       const RegressionConfig &config) {
+  const std::map<Key, std::vector<double>> before =
+      throughput_samples(baseline);
+  std::vector<RegressionRow> rows;
+
+  for (const auto &[key, now] : throughput_samples(current)) {
+    const auto &[method, size, m, k, n, machine] = key;
+    auto match = before.find(key);
+    if (match == before.end()) {
+      // Rows of the old format have neither shape nor machine
+      match = before.find({method, size, 0, 0, 0, ""});
+    }
+    if (match == before.end()) {
+      continue;
+    }
+
+    RegressionRow row{method, m, k, n, machine, match->second.size(),
+                      now.size(), median(match->second), median(now),
+                      0.0, 1.0, false};
+    row.change = row.current_gops / row.baseline_gops - 1.0;
+    row.p_value = mannWhitneyP(now, match->second);
+    row.regressed =
+        row.change < -config.threshold && row.p_value < config.alpha;
+    rows.push_back(row);
+  }
+  return rows;
+}
+
+double GF2Regression::mannWhitneyP(const std::vector<double> &x,
+                                   const std::vector<double> &y) {
+  const size_t nx = x.size(), ny = y.size();
+  if (nx == 0 || ny == 0) {
+    return 1.0;
+  }
+
+  // Midranks of the pooled samples, and the tie term of the variance
+  std::vector<std::pair<double, bool>> pooled; // (value, from x)
+  for (double v : x) {
+    pooled.push_back({v, true});
+  }
+  for (double v : y) {
+    pooled.push_back({v, false});
+  }
+  std::sort(pooled.begin(), pooled.end());
+  double rank_sum_x = 0.0, ties = 0.0;
+  for (size_t i = 0; i < pooled.size();) {
+    size_t j = i;
+    while (j < pooled.size() && pooled[j].first == pooled[i].first) {
+      ++j;
+    }
+    const double rank = 0.5 * double(i + 1 + j); // mean of i + 1 .. j
+    for (size_t t = i; t < j; ++t) {
+      if (pooled[t].second) {
+        rank_sum_x += rank;
+      }
+    }
+    const double tied = double(j - i);
+    ties += tied * tied * tied - tied;
+    i = j;
+  }
+
+  const double N = double(nx + ny);
+  const double u = rank_sum_x - double(nx) * double(nx + 1) / 2.0;
+  const double mean = double(nx) * double(ny) / 2.0;
+  const double variance =
+      double(nx) * double(ny) / 12.0 * (N + 1.0 - ties / (N * (N - 1.0)));
+  if (variance <= 0.0) {
+    return 1.0; // every value equal
+  }
+  // Small U means x is smaller; the continuity correction moves U towards
+  // the mean
+  const double z = (u + 0.5 - mean) / std::sqrt(variance);
+  return 0.5 * std::erfc(-z / std::sqrt(2.0));
+}
+
+size_t GF2Regression::printReport(const std::vector<RegressionRow> &rows,
+                                  const RegressionConfig &config,
+                                  std::ostream &out) {
+  out << "\n=== Regression check ===\n";
+  out << "Fails on a median throughput loss over " << config.threshold * 100.0
+      << "% with a one-sided Mann-Whitney p below " << config.alpha << "\n";
+  out << std::left << std::setw(22) << "Method" << std::setw(20) << "Shape"
+      << std::right << std::setw(10) << "N" << std::setw(14) << "Base GOps/s"
+      << std::setw(14) << "Now GOps/s" << std::setw(10) << "Change"
+      << std::setw(10) << "p"
+      << "  Status\n";
+  out << std::string(106, '-') << "\n";
+
+  size_t regressions = 0;
+  for (const RegressionRow &row : rows) {
+    std::ostringstream shape, samples;
+    shape << row.m << "x" << row.k << "x" << row.n;
+    samples << row.baseline_samples << "/" << row.current_samples;
+    out << std::left << std::setw(22) << row.method << std::setw(20)
+        << shape.str() << std::right << std::setw(10) << samples.str()
+        << std::fixed << std::setprecision(2) << std::setw(14)
+        << row.baseline_gops << std::setw(14) << row.current_gops
+        << std::setprecision(1) << std::setw(9) << std::showpos
+        << row.change * 100.0 << "%" << std::noshowpos
+        << std::setprecision(4) << std::setw(10) << row.p_value << "  "
+        << (row.regressed ? "REGRESSED" : "ok") << std::defaultfloat << "\n";
+    regressions += row.regressed;
+  }
+  if (rows.empty()) {
+    out << "No (method, shape, machine) in both runs\n";
+  }
+  out << regressions << " of " << rows.size() << " regressed\n";
+  return regressions;
+}
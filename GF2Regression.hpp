@@ -0,0 +1,50 @@
+#pragma once
+
+#include "GF2TestFramework.hpp"
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+struct RegressionConfig {
+    // A method regresses when its median throughput is this much below the
+    // baseline's and the samples say so at the significance level
+    double threshold = 0.10;
+    double alpha = 0.05;
+};
+
+// One (method, shape, machine) present in both runs
+struct RegressionRow {
+    std::string method;
+    size_t m, k, n;
+    std::string machine; // backend and device, empty for old baselines
+    size_t baseline_samples, current_samples;
+    double baseline_gops, current_gops; // median throughput
+    double change;  // current / baseline - 1
+    double p_value; // one-sided Mann-Whitney U, current slower
+    bool regressed;
+};
+
+// Compares a run against a stored baseline results file, for gating kernel
+// changes on performance
+class GF2Regression {
+public:
+    // Reads saveResults' CSV, or the older Method,Duration_ms,
+    // Throughput_GOPS,Correct,Matrix_Size one (those rows match any machine
+    // and any shape with the same Matrix_Size). Throws std::runtime_error.
+    static std::vector<TestResult> loadResults(const std::string& filename);
+
+    // Matches the correct rows by (method, shape, machine) and tests each
+    // match's throughput samples
+    static std::vector<RegressionRow> compare(const std::vector<TestResult>& baseline,
+                                              const std::vector<TestResult>& current,
+                                              const RegressionConfig& config = {});
+
+    // One-sided Mann-Whitney U p-value for "values of x tend to be smaller
+    // than those of y", by the normal approximation with tie and continuity
+    // corrections
+    static double mannWhitneyP(const std::vector<double>& x, const std::vector<double>& y);
+
+    // The diff table; returns the number of regressions
+    static size_t printReport(const std::vector<RegressionRow>& rows,
+                              const RegressionConfig& config, std::ostream& out);
+};
@@ -0,0 +1,372 @@
+#include "GF2Roofline.hpp"
+#include "GF2CpuInfo.hpp"
+#include "GF2Kernels.hpp"
+#include "GF2Matrix.hpp"
+#include "GF2TestFramework.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <omp.h>
+#include <sstream>
+
+// Builds for every x86-64 CPU compile the peak loop for the widest vectors
+// too, picked at load time (ifunc, so not on macOS)
+#if defined(__x86_64__) && defined(__linux__) && defined(__GNUC__)
+#define GF2_PEAK_TARGETS                                                       \
+  __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define GF2_PEAK_TARGETS
+#endif
+
+namespace {
+
+double ceil_div(size_t a, size_t b) { return double((a + b - 1) / b); }
+
+// A * B^T by blocks of PARALLEL_ROW_BLOCK rows x PARALLEL_COL_BLOCK columns:
+// B is transposed once, then every block reads its rows of A and of B^T.
+// One AND and one popcount-accumulate per word of the common dimension.
+GF2WorkEstimate dot_product(size_t m, size_t k, size_t n) {
+  const double wk = ceil_div(k, 64), wn = ceil_div(n, 64);
+  const double row_blocks = ceil_div(m, GF2Matrix::PARALLEL_ROW_BLOCK);
+  const double col_blocks =
+      ceil_div(size_t(wn), GF2Matrix::PARALLEL_COL_BLOCK / 64);
+  GF2WorkEstimate w;
+  w.bytes_read = 8.0 * (k * wn + wk * (m * col_blocks + n * row_blocks));
+  w.bytes_written = 8.0 * (n * wk + m * wn);
+  w.word_ops = 2.0 * double(m) * double(n) * wk;
+  return w;
+}
+
+// Per word of A: 8 Gray-code tables of 255 row XORs over a panel of B, kept
+// in L2, then 8 table XORs into each row of C's panel
+GF2WorkEstimate m4r(size_t m, size_t k, size_t n) {
+  const double wk = ceil_div(k, 64), wn = ceil_div(n, 64);
+  const double panels = ceil_div(size_t(wn), m4r_panel_words(size_t(wn)));
+  GF2WorkEstimate w;
+  w.bytes_read = 8.0 * (k * wn + panels * m * wk + wk * m * wn);
+  w.bytes_written = 8.0 * wk * m * wn;
+  w.word_ops = wk * wn * double(M4R_TABLES) *
+               (double(M4R_TABLE_ROWS - 1) + double(m));
+  return w;
+}
+
+// 7^levels M4R leaves and 15 quadrant XORs per node, plus the copies in and
+// out of the padded blocks
+GF2WorkEstimate strassen(size_t m, size_t k, size_t n, size_t cutoff) {
+  cutoff = std::max<size_t>(cutoff, 64);
+  int levels = 0;
+  size_t lm = m, lk = k, ln = n;
+  while (lm > cutoff && lk > cutoff && ln > cutoff) {
+    lm /= 2;
+    lk /= 2;
+    ln /= 2;
+    ++levels;
+  }
+  if (levels == 0) {
+    return m4r(m, k, n);
+  }
+
+  const double wk = ceil_div(k, 64), wn = ceil_div(n, 64);
+  GF2WorkEstimate w = m4r(lm, lk, ln);
+  double nodes = 1.0;
+  for (int l = 0; l < levels; ++l) {
+    nodes *= 7.0;
+  }
+  w.bytes_read *= nodes;
+  w.bytes_written *= nodes;
+  w.word_ops *= nodes;
+
+  nodes = 1.0;
+  for (int l = 0; l < levels; ++l) {
+    const double scale = double(size_t(2) << l); // 2^(l + 1)
+    const double quadrant = m / scale * (std::max(wk, wn) / scale);
+    w.word_ops += nodes * 15.0 * quadrant;
+    w.bytes_read += nodes * 15.0 * 16.0 * quadrant;
+    w.bytes_written += nodes * 15.0 * 8.0 * quadrant;
+    nodes *= 7.0;
+  }
+  const double operands = 8.0 * (m * wk + k * wn + m * wn);
+  w.bytes_read += operands;
+  w.bytes_written += operands;
+  return w;
+}
+
+// get() per bit: a word of A's row per product and a word of B per term
+GF2WorkEstimate serial(size_t m, size_t k, size_t n) {
+  const double wk = ceil_div(k, 64), wn = ceil_div(n, 64);
+  GF2WorkEstimate w;
+  w.bytes_read = 8.0 * (m * wk + double(m) * k * wn);
+  w.bytes_written = 8.0 * m * wn;
+  w.word_ops = 2.0 * double(m) * double(n) * double(k);
+  return w;
+}
+
+bool is_gpu(const std::string &method) {
+  return method.compare(0, 3, "GPU") == 0;
+}
+
+// dst = src ^ key over a buffer far larger than the LLC
+double stream_gbps(int threads) {
+  const size_t llc = GF2CpuInfo::get().l3_bytes;
+  const size_t bytes =
+      std::min<size_t>(std::max<size_t>(4 * llc, size_t(64) << 20),
+                       size_t(256) << 20);
+  const size_t words = bytes / 2 / sizeof(uint64_t);
+  std::vector<uint64_t> src(words), dst(words);
+#pragma omp parallel for num_threads(threads) schedule(static)
+  for (long long i = 0; i < (long long)words; ++i) {
+    src[i] = uint64_t(i);
+    dst[i] = 0;
+  }
+
+  double best = 0.0;
+  for (int pass = 0; pass < 5; ++pass) {
+    const uint64_t key = 0x9E3779B97F4A7C15ULL * uint64_t(pass + 1);
+    auto start = std::chrono::steady_clock::now();
+#pragma omp parallel for num_threads(threads) schedule(static)
+    for (long long i = 0; i < (long long)words; ++i) {
+      dst[i] = src[i] ^ key;
+    }
+    const double s = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    best = std::max(best, 2.0 * words * sizeof(uint64_t) / s / 1e9);
+  }
+  volatile uint64_t sink = dst[words / 2];
+  (void)sink;
+  return best;
+}
+
+// Eight 512-bit accumulators, kept in registers
+constexpr size_t PEAK_LANES = 8;
+constexpr size_t PEAK_CHAINS = 8;
+typedef uint64_t peak_vector __attribute__((vector_size(8 * PEAK_LANES)));
+
+// acc[c] = (acc[c] & y) ^ acc[c + 1]: two word ops per lane per chain per
+// rep. Each chain feeds the next, so the reps can't be folded.
+GF2_PEAK_TARGETS
+uint64_t and_xor_reps(uint64_t seed, size_t reps) {
+  peak_vector acc[PEAK_CHAINS], x, y;
+  for (size_t l = 0; l < PEAK_LANES; ++l) {
+    x[l] = seed * (l + 1);
+    y[l] = ~(seed << l);
+  }
+  for (size_t c = 0; c < PEAK_CHAINS; ++c) {
+    acc[c] = x + c;
+  }
+  for (size_t r = 0; r < reps; ++r) {
+    const peak_vector first = acc[0];
+    for (size_t c = 0; c + 1 < PEAK_CHAINS; ++c) {
+      acc[c] = (acc[c] & y) ^ acc[c + 1];
+    }
+    acc[PEAK_CHAINS - 1] = (acc[PEAK_CHAINS - 1] & y) ^ first;
+  }
+  uint64_t sum = 0;
+  for (size_t c = 0; c < PEAK_CHAINS; ++c) {
+    for (size_t l = 0; l < PEAK_LANES; ++l) {
+      sum += acc[c][l];
+    }
+  }
+  return sum;
+}
+
+double and_xor_gops(int threads) {
+  const size_t reps = size_t(1) << 22;
+  double best = 0.0;
+  for (int pass = 0; pass < 3; ++pass) {
+    auto start = std::chrono::steady_clock::now();
+#pragma omp parallel num_threads(threads)
+    {
+      volatile uint64_t sink =
+          and_xor_reps(uint64_t(omp_get_thread_num()) + 3, reps);
+      (void)sink;
+    }
+    const double s = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    best = std::max(best, 2.0 * PEAK_LANES * PEAK_CHAINS * double(reps) *
+                              threads / s / 1e9);
+  }
+  return best;
+}
+
+// The dispatched SIMD kernel on operands that stay in L2, in the dot-product
+// model's word ops. Kernels such as GFNI do more than one word op per
+// instruction and beat the AND/XOR rate.
+double simd_kernel_gops(int threads) {
+  const size_t m = 1024, k = 2048, n = 1024;
+  GF2Matrix a(m, k), b(k, n);
+  a.randomFill();
+  b.randomFill();
+  const double ops = dot_product(m, k, n).word_ops;
+  double best = 0.0;
+  for (int pass = 0; pass < 5; ++pass) {
+    auto start = std::chrono::steady_clock::now();
+    GF2Matrix c = threads > 1 ? a.multiplySIMDParallel(b, threads)
+                              : a.multiplySIMD(b);
+    const double s = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    best = std::max(best, ops / s / 1e9);
+  }
+  return best;
+}
+
+bool is_dot_product(const std::string &method) {
+  return method.compare(0, 4, "SIMD") == 0 || method == "Hybrid";
+}
+
+struct Placement {
+  double achieved_gbps;  // modelled bytes over the median time
+  double achieved_gops;  // modelled word ops over the median time
+  double peak_gbps;      // the roofs of this method, 0 = none
+  double peak_gops;
+  double roof_gops;      // min(peak_gops, intensity * peak_gbps)
+  bool memory_bound;
+};
+
+Placement place(const TestSummary &s, const GF2MachinePeaks &peaks) {
+  Placement p{0.0, 0.0, 0.0, 0.0, 0.0, false};
+  const double seconds = s.stats.median_ms / 1000.0;
+  if (seconds <= 0.0) {
+    return p;
+  }
+  p.achieved_gbps = (s.bytes_read + s.bytes_written) / seconds / 1e9;
+  p.achieved_gops = s.word_ops / seconds / 1e9;
+  if (s.backend != "CPU" || s.word_ops <= 0.0) {
+    return p;
+  }
+  const bool threaded = s.threads > 1;
+  p.peak_gbps = threaded ? peaks.bandwidth_gbps : peaks.bandwidth_gbps_1t;
+  p.peak_gops = threaded ? peaks.word_gops : peaks.word_gops_1t;
+  if (is_dot_product(s.method == "Engine" ? s.kernel : s.method)) {
+    p.peak_gops = std::max(p.peak_gops,
+                           threaded ? peaks.simd_gops : peaks.simd_gops_1t);
+  }
+  const double intensity = s.word_ops / (s.bytes_read + s.bytes_written);
+  p.memory_bound = intensity * p.peak_gbps < p.peak_gops;
+  p.roof_gops = std::min(p.peak_gops, intensity * p.peak_gbps);
+  return p;
+}
+
+} // namespace
+
+double GF2WorkEstimate::intensity() const {
+  const double bytes = bytes_read + bytes_written;
+  return bytes > 0.0 ? word_ops / bytes : 0.0;
+}
+
+GF2WorkEstimate GF2Roofline::estimate(const std::string &method, size_t m,
+                                      size_t k, size_t n,
+                                      size_t strassen_cutoff) {
+  if (method == "Serial") {
+    return serial(m, k, n);
+  }
+  if (method == "M4R" || method == "GPU (M4R)" || method == "GPU-M4R") {
+    return m4r(m, k, n);
+  }
+  if (method == "Strassen") {
+    return strassen(m, k, n, strassen_cutoff);
+  }
+  if (method.compare(0, 4, "SIMD") == 0 || method == "Hybrid" ||
+      is_gpu(method)) {
+    return dot_product(m, k, n);
+  }
+  return {};
+}
+
+GF2MachinePeaks GF2Roofline::measurePeaks(int threads) {
+  GF2MachinePeaks peaks;
+  peaks.threads = threads > 0 ? threads : omp_get_max_threads();
+  peaks.bandwidth_gbps = stream_gbps(peaks.threads);
+  peaks.word_gops = and_xor_gops(peaks.threads);
+  peaks.bandwidth_gbps_1t =
+      peaks.threads > 1 ? stream_gbps(1) : peaks.bandwidth_gbps;
+  peaks.word_gops_1t = peaks.threads > 1 ? and_xor_gops(1) : peaks.word_gops;
+  peaks.simd_gops = simd_kernel_gops(peaks.threads);
+  peaks.simd_gops_1t =
+      peaks.threads > 1 ? simd_kernel_gops(1) : peaks.simd_gops;
+  return peaks;
+}
+
+void GF2Roofline::printReport(const std::vector<TestSummary> &summaries,
+                              const GF2MachinePeaks &peaks,
+                              std::ostream &out) {
+  out << "\n=== Roofline ===\n";
+  out << std::fixed << std::setprecision(1) << "Peaks (" << peaks.threads
+      << " threads / 1 thread): " << peaks.bandwidth_gbps << " / "
+      << peaks.bandwidth_gbps_1t << " GB/s, " << peaks.word_gops << " / "
+      << peaks.word_gops_1t << " G word-ops/s AND/XOR, " << peaks.simd_gops
+      << " / " << peaks.simd_gops_1t << " with the " << GF2Matrix::simdKernelName()
+      << " kernel; ridge at " << std::setprecision(2)
+      << peaks.word_gops / peaks.bandwidth_gbps << " ops/byte\n";
+  out << std::left << std::setw(22) << "Method" << std::setw(20) << "Shape"
+      << std::right << std::setw(8) << "Threads" << std::setw(11)
+      << "Ops/byte" << std::setw(10) << "GB/s" << std::setw(12) << "Gops/s"
+      << std::setw(12) << "Roof" << std::setw(8) << "% roof"
+      << "  Bound\n";
+  out << std::string(113, '-') << "\n";
+
+  for (const TestSummary &s : summaries) {
+    if (s.word_ops <= 0.0) {
+      continue;
+    }
+    const Placement p = place(s, peaks);
+    std::ostringstream shape;
+    shape << s.m << "x" << s.k << "x" << s.n;
+    out << std::left << std::setw(22) << s.method << std::setw(20)
+        << shape.str() << std::right << std::setw(8) << s.threads
+        << std::setprecision(3) << std::setw(11)
+        << s.word_ops / (s.bytes_read + s.bytes_written)
+        << std::setprecision(2) << std::setw(10) << p.achieved_gbps
+        << std::setw(12) << p.achieved_gops;
+    if (p.roof_gops > 0.0) {
+      out << std::setw(12) << p.roof_gops << std::setprecision(1)
+          << std::setw(8) << 100.0 * p.achieved_gops / p.roof_gops << "  "
+          << (p.memory_bound ? "memory" : "compute");
+    } else {
+      out << std::setw(12) << "-" << std::setw(8) << "-"
+          << "  (no GPU peaks)";
+    }
+    out << "\n";
+  }
+  out << std::defaultfloat
+      << "Bytes and ops are modelled per method; Roof is the attainable "
+         "Gops/s at that intensity.\n";
+}
+
+void GF2Roofline::saveReport(const std::vector<TestSummary> &summaries,
+                             const GF2MachinePeaks &peaks,
+                             const std::string &filename) {
+  std::ofstream file(filename);
+  if (!file.is_open()) {
+    std::cerr << "Failed to open file: " << filename << std::endl;
+    return;
+  }
+
+  file << "Method,M,K,N,Threads,Backend,Median_ms,Bytes_Read,Bytes_Written,"
+          "Word_Ops,Ops_Per_Byte,Achieved_GBps,Achieved_Gops,Peak_GBps,"
+          "Peak_Gops,Roof_Gops,Bound\n";
+  for (const TestSummary &s : summaries) {
+    if (s.word_ops <= 0.0) {
+      continue;
+    }
+    const Placement p = place(s, peaks);
+    file << s.method << "," << s.m << "," << s.k << "," << s.n << ","
+         << s.threads << "," << s.backend << "," << s.stats.median_ms << ","
+         << s.bytes_read << "," << s.bytes_written << "," << s.word_ops << ","
+         << s.word_ops / (s.bytes_read + s.bytes_written) << ","
+         << p.achieved_gbps << "," << p.achieved_gops << ",";
+    if (p.roof_gops > 0.0) {
+      file << p.peak_gbps << "," << p.peak_gops << "," << p.roof_gops << "," << (p.memory_bound ? "memory" : "compute");
+    } else {
+      file << ",,,";
+    }
+    file << "\n";
+  }
+
+  std::cout << "Roofline saved to: " << filename << std::endl;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+struct TestSummary;
+
+// Work of one product under a per-method model. The bytes are the operand
+// traffic at the level of the method's cache blocking. A block the kernel
+// means to keep in L1/L2, such as the M4R tables, counts once, and its
+// reloads are free. Word ops are 64-bit AND, XOR and popcount operations
+// (a 512-bit XOR is 8).
+struct GF2WorkEstimate {
+    double bytes_read = 0.0;
+    double bytes_written = 0.0;
+    double word_ops = 0.0;
+
+    // Word ops per byte moved
+    double intensity() const;
+};
+
+// Ceilings measured on this machine, with all threads and with one
+struct GF2MachinePeaks {
+    int threads = 0;
+    double bandwidth_gbps = 0.0; // streaming XOR of a buffer much larger than the LLC
+    double word_gops = 0.0;      // 64-bit AND + XOR in registers, widest vectors
+    // The dispatched SIMD kernel on L2-resident operands: the compute roof
+    // of the dot-product methods when it is above word_gops
+    double simd_gops = 0.0;
+    double bandwidth_gbps_1t = 0.0;
+    double word_gops_1t = 0.0;
+    double simd_gops_1t = 0.0;
+};
+
+// Places each (method, shape) on a roofline against the machine's peaks, to
+// tell memory-bound kernels from compute-bound ones
+class GF2Roofline {
+public:
+    // By the test or engine method name ("SIMD-Parallel", "GPU (M4R)",
+    // "GPU-M4R", ...); all zero for an unknown name
+    static GF2WorkEstimate estimate(const std::string& method, size_t m, size_t k,
+                                    size_t n, size_t strassen_cutoff = 1024);
+
+    // About a second; threads = 0 for the OpenMP default
+    static GF2MachinePeaks measurePeaks(int threads = 0);
+
+    // GPU methods are reported without a roof: only CPU peaks are measured
+    static void printReport(const std::vector<TestSummary>& summaries,
+                            const GF2MachinePeaks& peaks, std::ostream& out);
+    static void saveReport(const std::vector<TestSummary>& summaries,
+                           const GF2MachinePeaks& peaks, const std::string& filename);
+};
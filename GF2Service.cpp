@@ -0,0 +1,285 @@
+#include "GF2Service.hpp"
+#include "GF2Engine.hpp"
+#include "GF2MatrixBatch.hpp"
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <omp.h>
+#include <stdexcept>
+
+GF2MultiplyService::GF2MultiplyService(GF2ServiceConfig config)
+    : m_config(config), m_start(Clock::now()) {
+    m_config.max_batch = std::max<size_t>(m_config.max_batch, 1);
+    m_latencies.reserve(GF2ServiceStats::LATENCY_WINDOW);
+    for (int i = 0; i < std::max(m_config.workers, 1); ++i) {
+        m_workers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+GF2MultiplyService::~GF2MultiplyService() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+}
+
+std::future<GF2Matrix> GF2MultiplyService::submit(GF2Matrix a, GF2Matrix b) {
+    auto shared = std::make_shared<const GF2Matrix>(std::move(b));
+    return enqueue(Request{std::move(a), std::move(shared), false, {}, Clock::now()});
+}
+
+std::future<GF2Matrix> GF2MultiplyService::submit(GF2Matrix a,
+                                                  std::shared_ptr<const GF2Matrix> b) {
+    if (!b) {
+        throw std::runtime_error("Null operand submitted");
+    }
+    return enqueue(Request{std::move(a), std::move(b), true, {}, Clock::now()});
+}
+
+std::future<GF2Matrix> GF2MultiplyService::enqueue(Request request) {
+    if (request.a.cols() != request.b->rows()) {
+        throw std::runtime_error("Matrix dimensions incompatible for multiplication");
+    }
+    std::future<GF2Matrix> future = request.result.get_future();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back(std::move(request));
+        ++m_submitted;
+        m_max_queue_depth = std::max(m_max_queue_depth, m_queue.size());
+    }
+    m_cv.notify_one();
+    return future;
+}
+
+GF2MultiplyService::Key GF2MultiplyService::keyOf(const Request& r) {
+    const size_t m = r.a.rows(), k = r.a.cols(), n = r.b->cols();
+    if (m <= 64 && k <= 64 && n <= 64) {
+        return Key{0, nullptr, 0, 0, 0};
+    }
+    if (r.shared_b) {
+        return Key{1, r.b.get(), 0, k, n};
+    }
+    return Key{2, nullptr, m, k, n};
+}
+
+// The batch of the oldest request: it is taken once it is full or it is
+// due (or the service is stopping), else the worker sleeps until then or the
+// next submit. It is due when that request's delay is up and its newest
+// request is gather_window old, or at twice the delay.
+void GF2MultiplyService::workerLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        if (m_queue.empty()) {
+            if (m_stop) {
+                return;
+            }
+            m_cv.wait(lock);
+            continue;
+        }
+        const Key key = keyOf(m_queue.front());
+        const Clock::time_point deadline = m_queue.front().submitted + m_config.max_delay;
+        Clock::time_point newest = m_queue.front().submitted;
+        size_t count = 0;
+        for (const Request& r : m_queue) {
+            if (keyOf(r) == key) {
+                newest = std::max(newest, r.submitted);
+                if (++count == m_config.max_batch) break;
+            }
+        }
+        Clock::time_point due = deadline;
+        if (m_config.gather_window.count() > 0) {
+            due = std::min(std::max(deadline, newest + m_config.gather_window),
+                           deadline + m_config.max_delay);
+        }
+        if (count < m_config.max_batch && !m_stop && Clock::now() < due) {
+            m_cv.wait_until(lock, due);
+            continue;
+        }
+        size_t bucket = 0;
+        while (bucket + 1 < m_batch_sizes.size() && count >> (bucket + 1)) ++bucket;
+        ++m_batch_sizes[bucket];
+        m_max_batch_size = std::max(m_max_batch_size, count);
+        std::vector<Request> batch;
+        for (auto it = m_queue.begin(); it != m_queue.end() && batch.size() < count;) {
+            if (keyOf(*it) == key) {
+                batch.push_back(std::move(*it));
+                it = m_queue.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        lock.unlock();
+        runBatch(batch, key);
+        lock.lock();
+    }
+}
+
+void GF2MultiplyService::runBatch(std::vector<Request>& batch, const Key& key) {
+    try {
+        switch (key.kind) {
+        case 0: runSmall(batch); break;
+        case 1: runStacked(batch); break;
+        default: runEach(batch); break;
+        }
+    } catch (...) {
+        const std::exception_ptr error = std::current_exception();
+        for (Request& r : batch) {
+            r.result.set_exception(error);
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_completed += batch.size();
+        ++m_batches;
+    }
+}
+
+// Every operand zero-padded to 64 x 64: an A row, a B row and a C row are
+// one word each, and the padding multiplies to zero past the result's shape
+void GF2MultiplyService::runSmall(std::vector<Request>& batch) {
+    const size_t count = batch.size();
+    GF2MatrixBatch a(count), b(count), c(count);
+    for (size_t i = 0; i < count; ++i) {
+        const GF2Matrix& ai = batch[i].a;
+        const GF2Matrix& bi = *batch[i].b;
+        for (size_t r = 0; r < ai.rows() && ai.words_per_row() > 0; ++r) {
+            a.setRow(i, r, ai.get_raw_data()[r * ai.row_stride()]);
+        }
+        for (size_t r = 0; r < bi.rows() && bi.words_per_row() > 0; ++r) {
+            b.setRow(i, r, bi.get_raw_data()[r * bi.row_stride()]);
+        }
+    }
+    GF2MatrixBatch::multiply(a, b, c, m_config.num_threads);
+
+    std::vector<GF2Matrix> results;
+    results.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        GF2Matrix ci(batch[i].a.rows(), batch[i].b->cols());
+        for (size_t r = 0; r < ci.rows() && ci.words_per_row() > 0; ++r) {
+            ci.get_raw_data()[r * ci.row_stride()] = c.row(i, r);
+        }
+        results.push_back(std::move(ci));
+    }
+    finish(batch, results);
+}
+
+// One product of the As one above the other by the shared B
+void GF2MultiplyService::runStacked(std::vector<Request>& batch) {
+    const GF2Matrix& b = *batch.front().b;
+    size_t rows = 0;
+    for (const Request& r : batch) rows += r.a.rows();
+
+    GF2Matrix stacked(rows, b.rows());
+    const size_t a_words = stacked.words_per_row();
+    size_t row = 0;
+    for (const Request& r : batch) {
+        for (size_t i = 0; i < r.a.rows() && a_words > 0; ++i, ++row) {
+            std::memcpy(stacked.get_raw_data() + row * stacked.row_stride(),
+                        r.a.get_raw_data() + i * r.a.row_stride(), a_words * sizeof(uint64_t));
+        }
+    }
+
+    GF2Matrix product(0, 0);
+    if (m_config.engine) {
+        std::lock_guard<std::mutex> lock(m_engine_mutex);
+        m_config.engine->multiply(stacked, b, product);
+    } else {
+        product = stacked.multiplySIMDParallel(b, m_config.num_threads);
+    }
+
+    std::vector<GF2Matrix> results;
+    results.reserve(batch.size());
+    const size_t c_words = product.words_per_row();
+    row = 0;
+    for (const Request& r : batch) {
+        GF2Matrix c(r.a.rows(), b.cols());
+        for (size_t i = 0; i < c.rows() && c_words > 0; ++i, ++row) {
+            std::memcpy(c.get_raw_data() + i * c.row_stride(),
+                        product.get_raw_data() + row * product.row_stride(),
+                        c_words * sizeof(uint64_t));
+        }
+        results.push_back(std::move(c));
+    }
+    finish(batch, results);
+}
+
+void GF2MultiplyService::runEach(std::vector<Request>& batch) {
+    const int count = static_cast<int>(batch.size());
+    const int threads = m_config.num_threads > 0 ? m_config.num_threads : omp_get_max_threads();
+    std::vector<GF2Matrix> results(batch.size(), GF2Matrix(0, 0));
+    std::vector<std::exception_ptr> errors(batch.size());
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+    for (int i = 0; i < count; ++i) {
+        try {
+            results[i] = batch[i].a.multiplySIMD(*batch[i].b);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    }
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (errors[i]) {
+            std::rethrow_exception(errors[i]);
+        }
+    }
+    finish(batch, results);
+}
+
+void GF2MultiplyService::finish(std::vector<Request>& batch, std::vector<GF2Matrix>& results) {
+    const Clock::time_point now = Clock::now();
+    std::vector<double> latencies;
+    latencies.reserve(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+        latencies.push_back(std::chrono::duration<double, std::micro>(now - batch[i].submitted)
+                                .count());
+        batch[i].result.set_value(std::move(results[i]));
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (double us : latencies) {
+        if (m_latencies.size() < GF2ServiceStats::LATENCY_WINDOW) {
+            m_latencies.push_back(us);
+        } else {
+            m_latencies[m_completed % GF2ServiceStats::LATENCY_WINDOW] = us;
+        }
+        ++m_completed;
+        m_latency_sum_us += us;
+        m_max_latency_us = std::max(m_max_latency_us, us);
+    }
+    ++m_batches;
+}
+
+GF2ServiceStats GF2MultiplyService::stats() const {
+    GF2ServiceStats s;
+    std::vector<double> window;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        s.submitted = m_submitted;
+        s.completed = m_completed;
+        s.batches = m_batches;
+        s.queue_depth = m_queue.size();
+        s.max_queue_depth = m_max_queue_depth;
+        s.max_batch_size = m_max_batch_size;
+        s.batch_sizes = m_batch_sizes;
+        s.max_latency_us = m_max_latency_us;
+        if (m_completed > 0) {
+            s.mean_latency_us = m_latency_sum_us / double(m_completed);
+        }
+        if (m_batches > 0) {
+            s.mean_batch_size = double(m_completed) / double(m_batches);
+        }
+        const double elapsed = std::chrono::duration<double>(Clock::now() - m_start).count();
+        s.requests_per_second = elapsed > 0.0 ? double(m_completed) / elapsed : 0.0;
+        window = m_latencies;
+    }
+    if (!window.empty()) {
+        auto percentile = [&](double q) {
+            const size_t i = std::min(window.size() - 1, size_t(q * double(window.size())));
+            std::nth_element(window.begin(), window.begin() + long(i), window.end());
+            return window[i];
+        };
+        s.p50_latency_us = percentile(0.50);
+        s.p99_latency_us = percentile(0.99);
+    }
+    return s;
+}
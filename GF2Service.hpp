@@ -0,0 +1,137 @@
+#pragma once
+
+#include "GF2Matrix.hpp"
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class GF2Engine;
+
+// Latency budget and batching of GF2MultiplyService
+struct GF2ServiceConfig {
+    int workers = 1;
+    // A request waits at most this long for others to batch with; a batch
+    // of max_batch requests is run at once
+    std::chrono::microseconds max_delay{200};
+    size_t max_batch = 64;
+    // Past max_delay, a batch keeps gathering while requests of its kind
+    // arrive less than this apart, for at most another max_delay; 0 to run
+    // it at max_delay
+    std::chrono::microseconds gather_window{50};
+    // Runs the stacked products of a shared B, so large ones can go to the
+    // GPU; used by one worker at a time. Null for the SIMD kernel.
+    GF2Engine* engine = nullptr;
+    int num_threads = 1; // OpenMP threads of a batch; <= 0 for the default
+};
+
+// What the service has done since it started. Latencies run from submit()
+// to the result being set; the percentiles are over the last
+// LATENCY_WINDOW requests.
+struct GF2ServiceStats {
+    static constexpr size_t LATENCY_WINDOW = 4096;
+    static constexpr size_t BATCH_SIZE_BUCKETS = 8;
+
+    size_t submitted = 0;
+    size_t completed = 0;
+    size_t batches = 0;
+    size_t queue_depth = 0;     // waiting now
+    size_t max_queue_depth = 0;
+    double mean_batch_size = 0.0;
+    size_t max_batch_size = 0;
+    // Batches by size: entry i counts those of 2^i to 2^(i+1) - 1 requests,
+    // the last one all larger
+    std::array<size_t, BATCH_SIZE_BUCKETS> batch_sizes{};
+    double requests_per_second = 0.0;
+    double mean_latency_us = 0.0;
+    double p50_latency_us = 0.0;
+    double p99_latency_us = 0.0;
+    double max_latency_us = 0.0;
+};
+
+// An in-process multiply service for many small concurrent requests. submit()
+// queues a product and returns its future at once; worker threads take the
+// queue in batches of requests that can run as one launch:
+//
+//  - products of at most 64 x 64 by 64 x 64, of any shapes, as one
+//    GF2MatrixBatch (structure-of-arrays) multiply
+//  - products with the same B (submitted as one shared_ptr), whose As are
+//    stacked into a single tall product and split again
+//  - products of one shape otherwise, spread over the batch's threads
+//
+// A batch is run when it holds max_batch requests or its oldest request has
+// waited max_delay, unless requests of its kind are still arriving within
+// gather_window of each other; then it waits for the first such gap, or
+// max_delay more. A lone request pays max_delay, or gather_window if that is
+// longer. An error
+// of a product is set on its future. The destructor runs what is queued.
+class GF2MultiplyService {
+public:
+    explicit GF2MultiplyService(GF2ServiceConfig config = GF2ServiceConfig());
+    ~GF2MultiplyService();
+    GF2MultiplyService(const GF2MultiplyService&) = delete;
+    GF2MultiplyService& operator=(const GF2MultiplyService&) = delete;
+
+    // a * b; throws std::runtime_error at once if the shapes do not match
+    std::future<GF2Matrix> submit(GF2Matrix a, GF2Matrix b);
+    std::future<GF2Matrix> submit(GF2Matrix a, std::shared_ptr<const GF2Matrix> b);
+
+    GF2ServiceStats stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Request {
+        GF2Matrix a;
+        std::shared_ptr<const GF2Matrix> b;
+        bool shared_b;
+        std::promise<GF2Matrix> result;
+        Clock::time_point submitted;
+    };
+
+    // Requests that can run in one batch compare equal
+    struct Key {
+        int kind; // 0: small, 1: shared B, 2: one shape
+        const GF2Matrix* b;
+        size_t m, k, n;
+        bool operator==(const Key& o) const {
+            return kind == o.kind && b == o.b && m == o.m && k == o.k && n == o.n;
+        }
+    };
+    static Key keyOf(const Request& r);
+
+    std::future<GF2Matrix> enqueue(Request request);
+    void workerLoop();
+    void runBatch(std::vector<Request>& batch, const Key& key);
+    void runSmall(std::vector<Request>& batch);
+    void runStacked(std::vector<Request>& batch);
+    void runEach(std::vector<Request>& batch);
+    void finish(std::vector<Request>& batch, std::vector<GF2Matrix>& results);
+
+    GF2ServiceConfig m_config;
+    std::vector<std::thread> m_workers;
+    std::mutex m_engine_mutex;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<Request> m_queue;
+    bool m_stop = false;
+
+    // Under m_mutex
+    Clock::time_point m_start;
+    size_t m_submitted = 0;
+    size_t m_completed = 0;
+    size_t m_batches = 0;
+    size_t m_max_queue_depth = 0;
+    size_t m_max_batch_size = 0;
+    std::array<size_t, GF2ServiceStats::BATCH_SIZE_BUCKETS> m_batch_sizes{};
+    double m_latency_sum_us = 0.0;
+    double m_max_latency_us = 0.0;
+    std::vector<double> m_latencies; // ring of the last LATENCY_WINDOW
+};
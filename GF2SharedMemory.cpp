@@ -0,0 +1,363 @@
+#include "GF2SharedMemory.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iterator>
+#include <pthread.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char MAGIC[8] = {'G', 'F', '2', 'S', 'H', 'M', 'E', 'M'};
+constexpr uint32_t VERSION = 1;
+constexpr size_t SLOTS = 64;
+constexpr size_t PAGE = 4096;
+
+enum SlotState : uint32_t { SLOT_FREE, SLOT_POSTED, SLOT_DONE };
+
+enum Status : uint32_t {
+    STATUS_OK,
+    STATUS_BAD_OPERAND,
+    STATUS_SHAPE,
+    STATUS_OVERLAP,
+    STATUS_FAILED,
+};
+
+const char* status_message(uint32_t status) {
+    switch (status) {
+    case STATUS_BAD_OPERAND: return "Operand outside the shared-memory arena";
+    case STATUS_SHAPE: return "Matrix dimensions incompatible for multiplication";
+    case STATUS_OVERLAP: return "Output overlaps an operand";
+    default: return "Shared-memory multiply failed";
+    }
+}
+
+// Where a matrix is in the region
+struct Block {
+    uint64_t offset, rows, cols, row_stride;
+};
+
+struct Slot {
+    Block a, b, c;
+    uint32_t state;
+    uint32_t status;
+};
+
+size_t stride_of(size_t cols) {
+    const size_t align = GF2Matrix::ROW_ALIGN_WORDS;
+    return ((cols + 63) / 64 + align - 1) / align * align;
+}
+
+size_t round_up(size_t x, size_t align) {
+    return (x + align - 1) / align * align;
+}
+
+// Bytes and alignment the client's allocator gives a matrix
+size_t allocation_align(size_t bytes) {
+    return bytes >= PAGE ? PAGE : GF2_STORAGE_ALIGNMENT;
+}
+size_t allocation_bytes(size_t rows, size_t cols) {
+    const size_t bytes = rows * stride_of(cols) * sizeof(uint64_t);
+    return std::max<size_t>(round_up(bytes, allocation_align(bytes)), GF2_STORAGE_ALIGNMENT);
+}
+
+std::runtime_error shm_error(const std::string& what, const std::string& name) {
+    return std::runtime_error(what + " " + name + ": " + std::strerror(errno));
+}
+
+} // namespace
+
+// The start of the region: the request ring and its synchronization, then
+// the arena from arena_offset (a page boundary) to the end
+struct GF2ShmRegion {
+    char magic[8];
+    uint32_t version;
+    uint32_t slots;
+    uint64_t bytes;
+    uint64_t arena_offset;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t posted;    // the server: a request queued, or stop
+    pthread_cond_t completed; // clients: a slot done
+    uint64_t head;            // requests queued, by the client
+    uint64_t tail;            // requests taken, by the server
+    uint32_t stop;
+    uint32_t queue[SLOTS]; // slot indices, queued in order
+    Slot slot[SLOTS];
+};
+
+namespace {
+
+size_t arena_start() {
+    return round_up(sizeof(GF2ShmRegion), PAGE);
+}
+
+uint64_t* data_at(GF2ShmRegion* region, size_t offset) {
+    return reinterpret_cast<uint64_t*>(reinterpret_cast<char*>(region) + offset);
+}
+
+// Whether the block lies in the arena [arena_offset, bytes), with
+// GF2Matrix's alignment and row stride. The bounds are the server's own: a
+// client can write anything into the region.
+bool valid(const Block& b, size_t arena_offset, size_t bytes) {
+    const size_t align = GF2Matrix::ROW_ALIGN_WORDS;
+    if (b.offset < arena_offset || b.offset > bytes ||
+        b.offset % GF2_STORAGE_ALIGNMENT != 0 || b.row_stride < (b.cols + 63) / 64 ||
+        b.row_stride % align != 0) {
+        return false;
+    }
+    const uint64_t words = (bytes - b.offset) / sizeof(uint64_t);
+    return b.rows == 0 || b.row_stride <= words / b.rows;
+}
+
+bool overlap(const Block& x, const Block& y) {
+    const uint64_t x_end = x.offset + x.rows * x.row_stride * sizeof(uint64_t);
+    const uint64_t y_end = y.offset + y.rows * y.row_stride * sizeof(uint64_t);
+    return x.offset < y_end && y.offset < x_end;
+}
+
+Block block_of(const GF2ShmMatrix& m) {
+    return Block{m.offset(), m.rows(), m.cols(), m.row_stride()};
+}
+
+} // namespace
+
+GF2MatrixView GF2ShmMatrix::view() const {
+    return GF2MatrixView(m_data, m_rows, m_cols, 0, m_row_stride, m_row_stride);
+}
+
+GF2MutableMatrixView GF2ShmMatrix::mutableView() const {
+    return GF2MutableMatrixView(view());
+}
+
+// --- Server ---
+
+GF2ShmServer::GF2ShmServer(const std::string& name, size_t bytes, int num_threads)
+    : m_name(name), m_threads(num_threads) {
+    const size_t arena_offset = arena_start();
+    m_bytes = round_up(std::max(bytes, arena_offset + PAGE), PAGE);
+    const int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        throw shm_error("Could not create shared memory", name);
+    }
+    void* map = MAP_FAILED;
+    if (::ftruncate(fd, static_cast<off_t>(m_bytes)) == 0) {
+        map = ::mmap(nullptr, m_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        ::shm_unlink(name.c_str());
+        throw shm_error("Could not map shared memory", name);
+    }
+    m_region = static_cast<GF2ShmRegion*>(map);
+
+    GF2ShmRegion& r = *m_region;
+    r.version = VERSION;
+    r.slots = SLOTS;
+    r.bytes = m_bytes;
+    r.arena_offset = arena_offset;
+    r.head = r.tail = 0;
+    r.stop = 0;
+    pthread_mutexattr_t mutex_attr;
+    pthread_mutexattr_init(&mutex_attr);
+    pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutex_init(&r.mutex, &mutex_attr);
+    pthread_mutexattr_destroy(&mutex_attr);
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setpshared(&cond_attr, PTHREAD_PROCESS_SHARED);
+    pthread_cond_init(&r.posted, &cond_attr);
+    pthread_cond_init(&r.completed, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+    // Last, so a client that opens the region early sees no magic until the
+    // rest is set up
+    std::memcpy(r.magic, MAGIC, sizeof(MAGIC));
+}
+
+GF2ShmServer::~GF2ShmServer() {
+    ::munmap(m_region, m_bytes);
+    ::shm_unlink(m_name.c_str());
+}
+
+void GF2ShmServer::run() {
+    GF2ShmRegion& r = *m_region;
+    GF2Workspace ws;
+    pthread_mutex_lock(&r.mutex);
+    while (true) {
+        while (!r.stop && r.head == r.tail) {
+            pthread_cond_wait(&r.posted, &r.mutex);
+        }
+        if (r.stop) {
+            break;
+        }
+        const uint32_t index = r.queue[r.tail % SLOTS];
+        ++r.tail;
+        const Slot request = r.slot[index % SLOTS];
+        pthread_mutex_unlock(&r.mutex);
+
+        uint32_t status = STATUS_OK;
+        const size_t arena = arena_start();
+        if (!valid(request.a, arena, m_bytes) || !valid(request.b, arena, m_bytes) ||
+            !valid(request.c, arena, m_bytes)) {
+            status = STATUS_BAD_OPERAND;
+        } else if (request.a.cols != request.b.rows || request.c.rows != request.a.rows ||
+                   request.c.cols != request.b.cols) {
+            status = STATUS_SHAPE;
+        } else if (overlap(request.c, request.a) || overlap(request.c, request.b)) {
+            status = STATUS_OVERLAP;
+        } else {
+            auto matrix = [&](const Block& b) {
+                return GF2ShmMatrix(data_at(m_region, b.offset), b.offset, b.rows, b.cols,
+                                    b.row_stride);
+            };
+            try {
+                GF2Matrix::multiplyInto(matrix(request.a).view(), matrix(request.b).view(),
+                                        matrix(request.c).mutableView(), ws, m_threads);
+            } catch (...) {
+                status = STATUS_FAILED;
+            }
+        }
+
+        pthread_mutex_lock(&r.mutex);
+        r.slot[index % SLOTS].status = status;
+        r.slot[index % SLOTS].state = SLOT_DONE;
+        ++m_served;
+        pthread_cond_broadcast(&r.completed);
+    }
+    pthread_mutex_unlock(&r.mutex);
+}
+
+void GF2ShmServer::stop() {
+    GF2ShmRegion& r = *m_region;
+    pthread_mutex_lock(&r.mutex);
+    r.stop = 1;
+    pthread_cond_broadcast(&r.posted);
+    pthread_mutex_unlock(&r.mutex);
+}
+
+// --- Client ---
+
+GF2ShmClient::GF2ShmClient(const std::string& name) {
+    const int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        throw shm_error("Could not open shared memory", name);
+    }
+    struct stat st;
+    void* map = MAP_FAILED;
+    if (::fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(GF2ShmRegion)) {
+        m_bytes = size_t(st.st_size);
+        map = ::mmap(nullptr, m_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        throw shm_error("Could not map shared memory", name);
+    }
+    m_region = static_cast<GF2ShmRegion*>(map);
+    const GF2ShmRegion& r = *m_region;
+    if (std::memcmp(r.magic, MAGIC, sizeof(MAGIC)) != 0 || r.version != VERSION ||
+        r.slots != SLOTS || r.bytes != m_bytes) {
+        ::munmap(m_region, m_bytes);
+        throw std::runtime_error("Not a GF2 shared-memory region: " + name);
+    }
+    m_free[r.arena_offset] = m_bytes - r.arena_offset;
+    for (size_t i = SLOTS; i > 0; --i) {
+        m_free_slots.push_back(i - 1);
+    }
+}
+
+GF2ShmClient::~GF2ShmClient() {
+    ::munmap(m_region, m_bytes);
+}
+
+// First fit over the free blocks
+GF2ShmMatrix GF2ShmClient::allocate(size_t rows, size_t cols) {
+    const size_t bytes = allocation_bytes(rows, cols);
+    const size_t align = allocation_align(bytes);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_free.begin(); it != m_free.end(); ++it) {
+        const size_t begin = it->first, end = it->first + it->second;
+        const size_t start = round_up(begin, align);
+        if (start + bytes > end) {
+            continue;
+        }
+        m_free.erase(it);
+        if (start > begin) m_free[begin] = start - begin;
+        if (start + bytes < end) m_free[start + bytes] = end - start - bytes;
+        uint64_t* data = data_at(m_region, start);
+        std::memset(data, 0, bytes);
+        return GF2ShmMatrix(data, start, rows, cols, stride_of(cols));
+    }
+    throw std::runtime_error("No room for a " + std::to_string(rows) + "x" + std::to_string(cols) +
+                             " matrix in the shared-memory arena");
+}
+
+void GF2ShmClient::release(const GF2ShmMatrix& m) {
+    if (!m.get_raw_data()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t begin = m.offset(), end = begin + allocation_bytes(m.rows(), m.cols());
+    auto next = m_free.lower_bound(begin);
+    if (next != m_free.end() && next->first == end) {
+        end += next->second;
+        next = m_free.erase(next);
+    }
+    if (next != m_free.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == begin) {
+            begin = prev->first;
+            m_free.erase(prev);
+        }
+    }
+    m_free[begin] = end - begin;
+}
+
+size_t GF2ShmClient::submit(const GF2ShmMatrix& a, const GF2ShmMatrix& b, const GF2ShmMatrix& c) {
+    size_t index;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_free_slots.empty()) {
+            throw std::runtime_error("All " + std::to_string(SLOTS) +
+                                     " shared-memory request slots are in use");
+        }
+        index = m_free_slots.back();
+        m_free_slots.pop_back();
+    }
+    GF2ShmRegion& r = *m_region;
+    pthread_mutex_lock(&r.mutex);
+    r.slot[index] = Slot{block_of(a), block_of(b), block_of(c), SLOT_POSTED, STATUS_OK};
+    r.queue[r.head % SLOTS] = uint32_t(index);
+    ++r.head;
+    pthread_cond_signal(&r.posted);
+    pthread_mutex_unlock(&r.mutex);
+    return index;
+}
+
+void GF2ShmClient::wait(size_t ticket) {
+    if (ticket >= SLOTS) {
+        throw std::runtime_error("Not a shared-memory request ticket");
+    }
+    GF2ShmRegion& r = *m_region;
+    pthread_mutex_lock(&r.mutex);
+    while (r.slot[ticket].state != SLOT_DONE) {
+        pthread_cond_wait(&r.completed, &r.mutex);
+    }
+    const uint32_t status = r.slot[ticket].status;
+    r.slot[ticket].state = SLOT_FREE;
+    pthread_mutex_unlock(&r.mutex);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_free_slots.push_back(ticket);
+    }
+    if (status != STATUS_OK) {
+        throw std::runtime_error(status_message(status));
+    }
+}
+
+void GF2ShmClient::multiply(const GF2ShmMatrix& a, const GF2ShmMatrix& b, const GF2ShmMatrix& c) {
+    wait(submit(a, b, c));
+}
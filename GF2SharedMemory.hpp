@@ -0,0 +1,111 @@
+#pragma once
+
+#include "GF2Matrix.hpp"
+#include "GF2MatrixView.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct GF2ShmRegion;
+
+// A matrix in a shared-memory region, stored the way GF2Matrix stores it:
+// row r at get_raw_data() + r * row_stride(), the padding zero. Client and
+// server map the region at different addresses; offset() is where it is in
+// either.
+class GF2ShmMatrix {
+public:
+    GF2ShmMatrix() = default;
+
+    size_t rows() const { return m_rows; }
+    size_t cols() const { return m_cols; }
+    size_t row_stride() const { return m_row_stride; }
+    size_t offset() const { return m_offset; }
+    uint64_t* get_raw_data() const { return m_data; }
+
+    // The matrix in place, for the kernels and for filling it
+    GF2MatrixView view() const;
+    GF2MutableMatrixView mutableView() const;
+
+private:
+    friend class GF2ShmClient;
+    friend class GF2ShmServer;
+
+    GF2ShmMatrix(uint64_t* data, size_t offset, size_t rows, size_t cols, size_t row_stride)
+        : m_data(data), m_offset(offset), m_rows(rows), m_cols(cols), m_row_stride(row_stride) {}
+
+    uint64_t* m_data = nullptr;
+    size_t m_offset = 0;
+    size_t m_rows = 0;
+    size_t m_cols = 0;
+    size_t m_row_stride = 0;
+};
+
+// The serving side of a shared-memory multiply interface. The server creates
+// a named POSIX shared-memory region holding a ring of request slots and an
+// arena; a client process (GF2ShmClient) places its operands in the arena,
+// posts a request naming them, and the server multiplies them where they
+// are, writing C into the arena as well, so no matrix is copied between the
+// processes. The rings' mutex and condition variables are process-shared
+// and live in the region too. One client per region; serve several with a
+// server and a thread each.
+class GF2ShmServer {
+public:
+    // Creates the region name (a shm_open name, "/something") of 'bytes'
+    // bytes; throws std::runtime_error if it exists or cannot be made.
+    // num_threads are the OpenMP threads of a multiply (<= 0 for the default).
+    GF2ShmServer(const std::string& name, size_t bytes, int num_threads = 0);
+    // Removes the region; clients that have it mapped keep their mapping
+    ~GF2ShmServer();
+    GF2ShmServer(const GF2ShmServer&) = delete;
+    GF2ShmServer& operator=(const GF2ShmServer&) = delete;
+
+    // Serves requests until stop(); a request whose operands are out of the
+    // arena or whose shapes do not match is answered with an error status
+    void run();
+    // Makes run() return once its current request is done; any thread
+    void stop();
+
+    size_t served() const { return m_served; }
+
+private:
+    std::string m_name;
+    GF2ShmRegion* m_region = nullptr;
+    size_t m_bytes = 0;
+    int m_threads;
+    size_t m_served = 0;
+};
+
+// The client side: maps a server's region, allocates operands in it and
+// posts products.
+class GF2ShmClient {
+public:
+    // Opens the region of a running GF2ShmServer; throws std::runtime_error
+    // if there is none or it is not one
+    explicit GF2ShmClient(const std::string& name);
+    ~GF2ShmClient();
+    GF2ShmClient(const GF2ShmClient&) = delete;
+    GF2ShmClient& operator=(const GF2ShmClient&) = delete;
+
+    // A zeroed rows x cols matrix in the arena, page aligned once it spans a
+    // page; throws std::runtime_error if the arena has no room
+    GF2ShmMatrix allocate(size_t rows, size_t cols);
+    void release(const GF2ShmMatrix& m);
+
+    // Posts c = a * b and returns its ticket for wait(). c must not overlap
+    // a or b. Throws std::runtime_error if every request slot is waiting.
+    size_t submit(const GF2ShmMatrix& a, const GF2ShmMatrix& b, const GF2ShmMatrix& c);
+    // Blocks until the request is done; throws std::runtime_error with the
+    // server's reason if it failed
+    void wait(size_t ticket);
+    void multiply(const GF2ShmMatrix& a, const GF2ShmMatrix& b, const GF2ShmMatrix& c);
+
+private:
+    GF2ShmRegion* m_region = nullptr;
+    size_t m_bytes = 0;
+    std::mutex m_mutex;
+    std::map<size_t, size_t> m_free; // arena offset -> bytes, coalesced
+    std::vector<size_t> m_free_slots;
+};
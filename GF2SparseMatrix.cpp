@@ -0,0 +1,286 @@
+#include "GF2SparseMatrix.hpp"
+#include "GF2Kernels.hpp"
+#include <algorithm>
+#include <omp.h>
+#include <stdexcept>
+
+namespace {
+
+int resolve_threads(int num_threads) {
+    return num_threads > 0 ? num_threads : omp_get_max_threads();
+}
+
+// Calls f(column) for every set bit of 'words' packed words
+template <class F>
+void for_each_bit(const uint64_t* words, size_t count, F&& f) {
+    for (size_t w = 0; w < count; ++w) {
+        for (uint64_t bits = words[w]; bits; bits &= bits - 1) {
+            f(w * 64 + size_t(__builtin_ctzll(bits)));
+        }
+    }
+}
+
+// Sorts a row's indices and drops the pairs, which cancel over GF(2)
+void normalize(std::vector<uint32_t>& row) {
+    std::sort(row.begin(), row.end());
+    size_t out = 0;
+    for (size_t i = 0; i < row.size();) {
+        size_t j = i;
+        while (j < row.size() && row[j] == row[i]) {
+            ++j;
+        }
+        if ((j - i) % 2 == 1) {
+            row[out++] = row[i];
+        }
+        i = j;
+    }
+    row.resize(out);
+}
+
+} // namespace
+
+GF2SparseMatrix::GF2SparseMatrix(size_t rows, size_t cols)
+    : m_rows(rows), m_cols(cols), m_words_per_row((cols + 63) / 64),
+      m_row_start(rows + 1, 0), m_packed_row(rows, NOT_PACKED) {
+    if (cols > size_t(UINT32_MAX) + 1) {
+        throw std::runtime_error("Sparse matrix columns exceed 32-bit indices");
+    }
+}
+
+bool GF2SparseMatrix::packs(size_t ones) const {
+    return ones * sizeof(uint32_t) > m_words_per_row * sizeof(uint64_t);
+}
+
+template <class F>
+void GF2SparseMatrix::forEachOne(size_t row, F&& f) const {
+    if (m_packed_row[row] != NOT_PACKED) {
+        for_each_bit(m_packed.data() + m_packed_row[row], m_words_per_row, f);
+        return;
+    }
+    for (size_t p = m_row_start[row]; p < m_row_start[row + 1]; ++p) {
+        f(size_t(m_indices[p]));
+    }
+}
+
+GF2SparseMatrix GF2SparseMatrix::fromRows(size_t rows, size_t cols,
+                                          std::vector<std::vector<uint32_t>>& row_indices,
+                                          bool pack_dense_rows) {
+    GF2SparseMatrix s(rows, cols);
+    size_t listed = 0;
+    for (const std::vector<uint32_t>& r : row_indices) {
+        listed += pack_dense_rows && s.packs(r.size()) ? 0 : r.size();
+    }
+    s.m_indices.reserve(listed);
+    for (size_t i = 0; i < rows; ++i) {
+        std::vector<uint32_t>& r = row_indices[i];
+        s.m_nnz += r.size();
+        if (pack_dense_rows && s.packs(r.size())) {
+            s.m_packed_row[i] = s.m_packed.size();
+            s.m_packed.resize(s.m_packed.size() + s.m_words_per_row, 0);
+            uint64_t* words = s.m_packed.data() + s.m_packed_row[i];
+            for (uint32_t c : r) {
+                words[c / 64] |= uint64_t(1) << (c % 64);
+            }
+        } else {
+            s.m_indices.insert(s.m_indices.end(), r.begin(), r.end());
+        }
+        s.m_row_start[i + 1] = s.m_indices.size();
+        std::vector<uint32_t>().swap(r);
+    }
+    return s;
+}
+
+GF2SparseMatrix GF2SparseMatrix::fromIndices(size_t rows, size_t cols,
+                                             const std::vector<size_t>& row_start,
+                                             const std::vector<uint32_t>& indices) {
+    if (row_start.size() != rows + 1 || row_start.front() != 0 ||
+        row_start.back() != indices.size() ||
+        !std::is_sorted(row_start.begin(), row_start.end())) {
+        throw std::runtime_error("Malformed sparse row offsets");
+    }
+    std::vector<std::vector<uint32_t>> row_indices(rows);
+    for (size_t i = 0; i < rows; ++i) {
+        row_indices[i].assign(indices.begin() + row_start[i], indices.begin() + row_start[i + 1]);
+        for (uint32_t c : row_indices[i]) {
+            if (c >= cols) {
+                throw std::runtime_error("Sparse column index out of range");
+            }
+        }
+        normalize(row_indices[i]);
+    }
+    return fromRows(rows, cols, row_indices, true);
+}
+
+GF2SparseMatrix GF2SparseMatrix::fromDense(const GF2Matrix& dense, bool pack_dense_rows) {
+    GF2SparseMatrix s(dense.rows(), dense.cols());
+    const size_t words = dense.words_per_row();
+    for (size_t i = 0; i < dense.rows(); ++i) {
+        const uint64_t* row = dense.get_raw_data() + i * dense.row_stride();
+        size_t ones = 0;
+        for (size_t w = 0; w < words; ++w) {
+            ones += size_t(__builtin_popcountll(row[w]));
+        }
+        s.m_nnz += ones;
+        if (pack_dense_rows && s.packs(ones)) {
+            s.m_packed_row[i] = s.m_packed.size();
+            s.m_packed.insert(s.m_packed.end(), row, row + words);
+        } else {
+            for_each_bit(row, words, [&](size_t c) { s.m_indices.push_back(uint32_t(c)); });
+        }
+        s.m_row_start[i + 1] = s.m_indices.size();
+    }
+    return s;
+}
+
+GF2Matrix GF2SparseMatrix::toDense() const {
+    GF2Matrix dense(m_rows, m_cols);
+    for (size_t i = 0; i < m_rows; ++i) {
+        xorRowInto(i, dense.get_raw_data() + i * dense.row_stride());
+    }
+    return dense;
+}
+
+double GF2SparseMatrix::density() const {
+    return m_rows && m_cols ? double(m_nnz) / (double(m_rows) * double(m_cols)) : 0.0;
+}
+
+size_t GF2SparseMatrix::storage_bytes() const {
+    return m_row_start.size() * sizeof(size_t) + m_indices.size() * sizeof(uint32_t) +
+           m_packed_row.size() * sizeof(size_t) + m_packed.size() * sizeof(uint64_t);
+}
+
+bool GF2SparseMatrix::get(size_t row, size_t col) const {
+    if (row >= m_rows || col >= m_cols) return false;
+
+    if (m_packed_row[row] != NOT_PACKED) {
+        return (m_packed[m_packed_row[row] + col / 64] >> (col % 64)) & 1;
+    }
+    return std::binary_search(m_indices.begin() + m_row_start[row],
+                              m_indices.begin() + m_row_start[row + 1], uint32_t(col));
+}
+
+std::vector<uint32_t> GF2SparseMatrix::row(size_t row) const {
+    std::vector<uint32_t> out;
+    forEachOne(row, [&](size_t c) { out.push_back(uint32_t(c)); });
+    return out;
+}
+
+void GF2SparseMatrix::xorRowInto(size_t row, uint64_t* dst) const {
+    if (m_packed_row[row] != NOT_PACKED) {
+        row_xor(dst, m_packed.data() + m_packed_row[row], m_words_per_row);
+        return;
+    }
+    for (size_t p = m_row_start[row]; p < m_row_start[row + 1]; ++p) {
+        dst[m_indices[p] / 64] ^= uint64_t(1) << (m_indices[p] % 64);
+    }
+}
+
+GF2Matrix GF2SparseMatrix::multiply(const GF2Matrix& other, int num_threads) const {
+    if (m_cols != other.rows()) {
+        throw std::runtime_error("Matrix dimensions incompatible for multiplication");
+    }
+    GF2Matrix result(m_rows, other.cols());
+    const size_t words = other.words_per_row();
+    const uint64_t* b = other.get_raw_data();
+    const size_t b_stride = other.row_stride();
+    uint64_t* c = result.get_raw_data();
+    const long long rows = static_cast<long long>(m_rows);
+
+    // Rows differ in length, so they are handed out in small chunks
+    #pragma omp parallel for schedule(dynamic, 64) num_threads(resolve_threads(num_threads))
+    for (long long ii = 0; ii < rows; ++ii) {
+        const size_t i = static_cast<size_t>(ii);
+        uint64_t* c_row = c + i * result.row_stride();
+        forEachOne(i, [&](size_t k) { row_xor(c_row, b + k * b_stride, words); });
+    }
+    return result;
+}
+
+void GF2SparseMatrix::multiplyBlock(const uint64_t* x, uint64_t* y, int num_threads) const {
+    const long long rows = static_cast<long long>(m_rows);
+
+    #pragma omp parallel for schedule(dynamic, 256) num_threads(resolve_threads(num_threads))
+    for (long long ii = 0; ii < rows; ++ii) {
+        const size_t i = static_cast<size_t>(ii);
+        uint64_t sum = 0;
+        forEachOne(i, [&](size_t k) { sum ^= x[k]; });
+        y[i] = sum;
+    }
+}
+
+GF2SparseMatrix GF2SparseMatrix::multiply(const GF2SparseMatrix& other, int num_threads) const {
+    if (m_cols != other.m_rows) {
+        throw std::runtime_error("Matrix dimensions incompatible for multiplication");
+    }
+    const size_t words = other.m_words_per_row;
+    std::vector<std::vector<uint32_t>> out(m_rows);
+    const long long rows = static_cast<long long>(m_rows);
+
+    #pragma omp parallel num_threads(resolve_threads(num_threads))
+    {
+        // Row accumulator, and the words of it that are in use
+        std::vector<uint64_t> acc(words, 0);
+        std::vector<uint8_t> in_use(words, 0);
+        std::vector<size_t> used;
+
+        #pragma omp for schedule(dynamic, 64)
+        for (long long ii = 0; ii < rows; ++ii) {
+            const size_t i = static_cast<size_t>(ii);
+            bool all_words = false;
+            forEachOne(i, [&](size_t k) {
+                if (other.m_packed_row[k] != NOT_PACKED) {
+                    other.xorRowInto(k, acc.data());
+                    all_words = true;
+                    return;
+                }
+                for (size_t p = other.m_row_start[k]; p < other.m_row_start[k + 1]; ++p) {
+                    const size_t w = other.m_indices[p] / 64;
+                    if (!in_use[w]) {
+                        in_use[w] = 1;
+                        used.push_back(w);
+                    }
+                    acc[w] ^= uint64_t(1) << (other.m_indices[p] % 64);
+                }
+            });
+
+            std::vector<uint32_t>& r = out[i];
+            auto collect = [&](size_t w) {
+                for_each_bit(&acc[w], 1, [&](size_t c) { r.push_back(uint32_t(w * 64 + c)); });
+                acc[w] = 0;
+                in_use[w] = 0;
+            };
+            if (all_words) {
+                for (size_t w = 0; w < words; ++w) {
+                    collect(w);
+                }
+            } else {
+                std::sort(used.begin(), used.end());
+                for (size_t w : used) {
+                    collect(w);
+                }
+            }
+            used.clear();
+        }
+    }
+    return fromRows(m_rows, other.m_cols, out, true);
+}
+
+GF2SparseMatrix GF2SparseMatrix::transpose() const {
+    std::vector<std::vector<uint32_t>> out(m_cols);
+    for (size_t i = 0; i < m_rows; ++i) {
+        forEachOne(i, [&](size_t c) { out[c].push_back(uint32_t(i)); });
+    }
+    return fromRows(m_cols, m_rows, out, true);
+}
+
+bool GF2SparseMatrix::operator==(const GF2SparseMatrix& other) const {
+    if (m_rows != other.m_rows || m_cols != other.m_cols || m_nnz != other.m_nnz) {
+        return false;
+    }
+    for (size_t i = 0; i < m_rows; ++i) {
+        if (row(i) != other.row(i)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "GF2Matrix.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Sparse GF(2) matrix in compressed sparse row form: the ascending column
+// indices of the ones of each row. A row whose index list would take more
+// memory than its bit-packed form (more than two ones per 64 columns) is
+// kept packed instead, so the footprint is never far above that of the
+// same rows in a GF2Matrix.
+class GF2SparseMatrix {
+public:
+    // An all-zero rows x cols matrix
+    GF2SparseMatrix(size_t rows, size_t cols);
+
+    // From CSR arrays: the ones of row i are indices[row_start[i],
+    // row_start[i + 1]), in any order. A column listed twice cancels out,
+    // as in a sum over GF(2). Throws std::runtime_error on an index out of
+    // range or a malformed row_start.
+    static GF2SparseMatrix fromIndices(size_t rows, size_t cols,
+                                       const std::vector<size_t>& row_start,
+                                       const std::vector<uint32_t>& indices);
+
+    // pack_dense_rows = false keeps every row as an index list
+    static GF2SparseMatrix fromDense(const GF2Matrix& dense, bool pack_dense_rows = true);
+    GF2Matrix toDense() const;
+
+    size_t rows() const { return m_rows; }
+    size_t cols() const { return m_cols; }
+    // Number of ones
+    size_t nnz() const { return m_nnz; }
+    double density() const;
+    // Bytes of index, row and packed-row storage
+    size_t storage_bytes() const;
+
+    bool get(size_t row, size_t col) const;
+    // Ascending column indices of the ones of a row
+    std::vector<uint32_t> row(size_t row) const;
+
+    // this * other. Row i of the product is the XOR of the rows of other
+    // listed in row i of this, so the work is nnz(this) row XORs of other.
+    // num_threads <= 0 uses the OpenMP default.
+    GF2Matrix multiply(const GF2Matrix& other, int num_threads = 0) const;
+    // Gustavson's row-by-row product into a bit accumulator: the work is the
+    // number of (i, k, j) with this(i, k) and other(k, j) set, plus the
+    // accumulator words touched
+    GF2SparseMatrix multiply(const GF2SparseMatrix& other, int num_threads = 0) const;
+
+    // y = this * x for an n x 64 block x (see GF2Kernels.hpp): x has cols()
+    // words and y rows() words
+    void multiplyBlock(const uint64_t* x, uint64_t* y, int num_threads = 0) const;
+
+    GF2SparseMatrix transpose() const;
+
+    // Up to 64 independent vectors x with this * x = 0, one per row of the
+    // result (cols() columns), found by Montgomery's block Lanczos on
+    // this^T * this with n x 64 blocks (GF2BlockLanczos.cpp). The memory is
+    // the matrix, its transpose and a few blocks of cols() words. Up to
+    // 1024 columns, the rows are instead eliminated densely, a chunk at a
+    // time. A Lanczos start that finds fewer than 64 is merged with further
+    // starts (seed + 1, ...), so fewer rows than 64 come back when the
+    // nullspace is smaller or, rarely, when four more starts still add too
+    // few; throws std::runtime_error if the iteration keeps breaking down.
+    GF2Matrix nullspace(uint64_t seed = 1, int num_threads = 0) const;
+
+    bool operator==(const GF2SparseMatrix& other) const;
+
+private:
+    // No packed form
+    static constexpr size_t NOT_PACKED = SIZE_MAX;
+
+    size_t m_rows;
+    size_t m_cols;
+    size_t m_words_per_row;
+    size_t m_nnz = 0;
+    std::vector<size_t> m_row_start;   // rows + 1 offsets into m_indices
+    std::vector<uint32_t> m_indices;
+    std::vector<size_t> m_packed_row;  // offset into m_packed, or NOT_PACKED
+    std::vector<uint64_t> m_packed;    // words_per_row words per packed row
+
+    // Builds from one ascending index list per row, packing the dense ones
+    static GF2SparseMatrix fromRows(size_t rows, size_t cols,
+                                    std::vector<std::vector<uint32_t>>& row_indices,
+                                    bool pack_dense_rows);
+    // Whether a row of this many ones is smaller packed
+    bool packs(size_t ones) const;
+    // dst[0, words_per_row) ^= row i of this, as bits
+    void xorRowInto(size_t row, uint64_t* dst) const;
+    // Calls f(column) for every one of a row, in ascending order
+    template <class F>
+    void forEachOne(size_t row, F&& f) const;
+};
@@ -0,0 +1,219 @@
+#include "GF2StreamingMultiplier.hpp"
+#include "GF2MatrixView.hpp"
+#include "GF2Numa.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+GF2StreamingMultiplier::GF2StreamingMultiplier(const GF2Matrix& b, Sink sink,
+                                               GF2StreamingConfig config)
+    : m_b(b), m_packed(b), m_sink(std::move(sink)), m_config(config) {
+    if (!m_sink) {
+        throw std::runtime_error("Null sink for a streaming multiply");
+    }
+    start();
+}
+
+GF2StreamingMultiplier::GF2StreamingMultiplier(const GF2Matrix& b, GF2StreamingConfig config)
+    : m_b(b), m_packed(b), m_config(config) {
+    start();
+}
+
+void GF2StreamingMultiplier::start() {
+    m_config.queue_chunks = std::max<size_t>(m_config.queue_chunks, 1);
+    m_worker = std::thread([this] { workerLoop(); });
+}
+
+GF2StreamingMultiplier::~GF2StreamingMultiplier() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_stop = true;
+    }
+    m_in_cv.notify_all();
+    m_out_cv.notify_all();
+    m_worker.join();
+}
+
+// Under m_mutex
+void GF2StreamingMultiplier::rethrow() {
+    if (m_error) {
+        std::rethrow_exception(m_error);
+    }
+}
+
+void GF2StreamingMultiplier::push(GF2Matrix rows) {
+    if (rows.cols() != m_b.rows()) {
+        throw std::runtime_error("Matrix dimensions incompatible for multiplication");
+    }
+    if (rows.rows() == 0) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    rethrow();
+    if (m_closed) {
+        throw std::runtime_error("Rows pushed to a closed stream");
+    }
+    if (m_stats.chunks_in == 0) {
+        m_first_push = Clock::now();
+    }
+    if (m_in.size() >= m_config.queue_chunks) {
+        const Clock::time_point t0 = Clock::now();
+        m_in_cv.wait(lock, [&] { return m_in.size() < m_config.queue_chunks || m_error; });
+        m_stats.push_stall_seconds += std::chrono::duration<double>(Clock::now() - t0).count();
+        rethrow();
+    }
+    const size_t count = rows.rows();
+    m_in.push_back(GF2RowChunk{m_next_row, std::move(rows)});
+    m_next_row += count;
+    ++m_pending;
+    ++m_stats.chunks_in;
+    m_stats.rows_in += count;
+    lock.unlock();
+    m_in_cv.notify_all();
+}
+
+void GF2StreamingMultiplier::push(const uint64_t* rows, size_t count, size_t stride) {
+    GF2Matrix chunk(count, m_b.rows());
+    const size_t words = chunk.words_per_row();
+    for (size_t i = 0; i < count; ++i) {
+        std::memcpy(chunk.get_raw_data() + i * chunk.row_stride(), rows + i * stride,
+                    words * sizeof(uint64_t));
+    }
+    chunk.mutableView(0, count, 0, chunk.cols()).clearPadding();
+    push(std::move(chunk));
+}
+
+void GF2StreamingMultiplier::close() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+    }
+    m_in_cv.notify_all();
+    m_out_cv.notify_all();
+}
+
+bool GF2StreamingMultiplier::pop(GF2RowChunk& chunk) {
+    if (m_sink) {
+        throw std::runtime_error("pop() on a streaming multiply with a sink");
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_out_cv.wait(lock, [&] {
+        return !m_out.empty() || m_error || (m_closed && m_pending == 0);
+    });
+    if (m_out.empty()) {
+        rethrow();
+        return false;
+    }
+    chunk = std::move(m_out.front());
+    m_out.pop_front();
+    lock.unlock();
+    m_out_cv.notify_all();
+    return true;
+}
+
+void GF2StreamingMultiplier::finish() {
+    close();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_out_cv.wait(lock, [&] { return m_pending == 0 || m_error; });
+    rethrow();
+}
+
+size_t GF2StreamingMultiplier::rows() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_next_row;
+}
+
+GF2StreamingStats GF2StreamingMultiplier::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+// Chunks in push order, each handed on before the next is taken, so C
+// comes out in row order. After an error the queued chunks are dropped.
+void GF2StreamingMultiplier::workerLoop() {
+    gf2_set_thread_qos(GF2ThreadQos::Compute);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_in_cv.wait(lock, [&] { return !m_in.empty() || m_closed; });
+        if (m_in.empty()) {
+            return;
+        }
+        GF2RowChunk chunk = std::move(m_in.front());
+        m_in.pop_front();
+        lock.unlock();
+        m_in_cv.notify_all();
+        try {
+            GF2RowChunk product{chunk.row0, GF2Matrix(chunk.rows.rows(), m_b.cols())};
+            multiplyChunk(chunk.rows, product.rows);
+            emit(std::move(product));
+            lock.lock();
+            --m_pending;
+        } catch (...) {
+            lock.lock();
+            m_error = std::current_exception();
+            m_pending = 0;
+            m_in.clear();
+            m_in_cv.notify_all();
+        }
+        m_out_cv.notify_all();
+    }
+}
+
+void GF2StreamingMultiplier::multiplyChunk(const GF2Matrix& a, GF2Matrix& c) {
+    GF2StreamKernel kernel = m_config.kernel;
+    if (kernel == GF2StreamKernel::Auto) {
+        if (a.rows() < M4R_MIN_ROWS || m_dot_row_seconds < 0.0) {
+            kernel = GF2StreamKernel::Dot;
+        } else if (m_m4r_row_seconds < 0.0) {
+            kernel = GF2StreamKernel::M4R;
+        } else {
+            kernel = m_m4r_row_seconds < m_dot_row_seconds ? GF2StreamKernel::M4R
+                                                           : GF2StreamKernel::Dot;
+        }
+    }
+
+    const Clock::time_point t0 = Clock::now();
+    if (kernel == GF2StreamKernel::Dot) {
+        a.multiplyInto(m_packed, c, m_config.num_threads);
+    } else {
+        GF2Matrix::multiplyM4RInto(a, m_b, c.mutableView(0, c.rows(), 0, c.cols()));
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    if (a.rows() >= M4R_MIN_ROWS) {
+        double& row_seconds =
+            kernel == GF2StreamKernel::Dot ? m_dot_row_seconds : m_m4r_row_seconds;
+        if (row_seconds < 0.0) {
+            row_seconds = seconds / double(a.rows());
+        }
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.compute_seconds += seconds;
+    ++(kernel == GF2StreamKernel::Dot ? m_stats.dot_chunks : m_stats.m4r_chunks);
+}
+
+// A slow sink, or in queue mode a full queue, holds up the worker here and
+// so in time push(); a stream being destroyed drops instead of waiting
+void GF2StreamingMultiplier::emit(GF2RowChunk chunk) {
+    const Clock::time_point t0 = Clock::now();
+    const size_t count = chunk.rows.rows();
+    if (m_sink) {
+        m_sink(chunk);
+    } else {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_out_cv.wait(lock, [&] { return m_out.size() < m_config.queue_chunks || m_stop; });
+        if (!m_stop) {
+            m_out.push_back(std::move(chunk));
+        }
+    }
+    const Clock::time_point t1 = Clock::now();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_stats.chunks_out == 0) {
+        m_stats.first_chunk_seconds = std::chrono::duration<double>(t0 - m_first_push).count();
+    }
+    m_stats.emit_seconds += std::chrono::duration<double>(t1 - t0).count();
+    ++m_stats.chunks_out;
+    m_stats.rows_out += count;
+}
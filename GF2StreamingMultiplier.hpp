@@ -0,0 +1,133 @@
+#pragma once
+
+#include "GF2Matrix.hpp"
+#include "GF2PackedOperand.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// The kernel of a streamed chunk. Dot is the SIMD kernel on a prepared B^T
+// (GF2PackedOperand), whose cost per chunk is its rows only; M4R builds
+// Four Russians tables of B for every chunk, which pays off only over
+// hundreds of rows. Auto runs chunks under M4R_MIN_ROWS rows with Dot and
+// times one larger chunk with each kernel to pick the faster for the rest.
+enum class GF2StreamKernel { Auto, Dot, M4R };
+
+struct GF2StreamingConfig {
+    GF2StreamKernel kernel = GF2StreamKernel::Auto;
+    // Chunks of A waiting to be multiplied, and in queue mode products
+    // waiting for pop(); a push() past it blocks until the worker catches up
+    size_t queue_chunks = 4;
+    int num_threads = 1; // OpenMP threads of a chunk; <= 0 for the default
+};
+
+// Rows [row0, row0 + rows.rows()) of C
+struct GF2RowChunk {
+    size_t row0 = 0;
+    GF2Matrix rows{0, 0};
+};
+
+struct GF2StreamingStats {
+    size_t chunks_in = 0;
+    size_t rows_in = 0;
+    size_t chunks_out = 0;
+    size_t rows_out = 0;
+    size_t dot_chunks = 0;
+    size_t m4r_chunks = 0;
+    // From the first push() to the first chunk of C handed on
+    double first_chunk_seconds = 0.0;
+    double compute_seconds = 0.0;
+    // Time push() spent blocked on a full queue, and the worker on a full
+    // output queue (queue mode) or in the sink (callback mode)
+    double push_stall_seconds = 0.0;
+    double emit_seconds = 0.0;
+};
+
+// C = A * B for an A whose rows arrive over time, from a network or decode
+// stage, against a B fixed up front. Each push() of a chunk of rows of A is
+// multiplied on a worker thread as soon as it is taken, and its rows of C
+// are handed on in order: to a sink called on the worker thread, or to a
+// bounded queue the consumer drains with pop(). The first rows of C come
+// one chunk's compute after their rows of A, not after the whole of A.
+//
+// Both queues are bounded, so a slow consumer holds up the worker and then
+// push(): a stream never holds more than queue_chunks chunks of each side.
+// An exception of a chunk (or of the sink) stops the stream and is thrown
+// by the next push(), pop() or finish(). B is copied. One producer and one
+// consumer; push() and pop() may be on different threads.
+class GF2StreamingMultiplier {
+public:
+    // Chunks under this many rows go to Dot in Auto mode
+    static constexpr size_t M4R_MIN_ROWS = 256;
+
+    using Sink = std::function<void(const GF2RowChunk& chunk)>;
+
+    // Callback mode: each chunk of C goes to sink, on the worker thread
+    GF2StreamingMultiplier(const GF2Matrix& b, Sink sink,
+                           GF2StreamingConfig config = GF2StreamingConfig());
+    // Queue mode: chunks of C wait for pop()
+    explicit GF2StreamingMultiplier(const GF2Matrix& b,
+                                    GF2StreamingConfig config = GF2StreamingConfig());
+    // Runs what is queued; in queue mode the products nobody popped are
+    // dropped
+    ~GF2StreamingMultiplier();
+    GF2StreamingMultiplier(const GF2StreamingMultiplier&) = delete;
+    GF2StreamingMultiplier& operator=(const GF2StreamingMultiplier&) = delete;
+
+    // The next rows of A, which must have B.rows() columns (else
+    // std::runtime_error). Blocks while queue_chunks chunks are waiting.
+    void push(GF2Matrix rows);
+    // count rows of words_per_row() words each, stride words apart
+    void push(const uint64_t* rows, size_t count, size_t stride);
+
+    // No more rows will be pushed
+    void close();
+    // Queue mode: the next chunk of C, blocking until it is computed; false
+    // once the stream is closed and every chunk was popped
+    bool pop(GF2RowChunk& chunk);
+    // close(), then waits until every chunk was handed on (in queue mode,
+    // queued for pop()); throws the stream's error if it had one
+    void finish();
+
+    size_t rows() const;  // rows of A pushed so far
+    size_t cols() const { return m_b.cols(); }
+    GF2StreamingStats stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void start();
+    void workerLoop();
+    void multiplyChunk(const GF2Matrix& a, GF2Matrix& c);
+    void emit(GF2RowChunk chunk);
+    void rethrow();
+
+    GF2Matrix m_b;
+    GF2PackedOperand m_packed;
+    Sink m_sink;
+    GF2StreamingConfig m_config;
+    // Auto mode's timings of a chunk of at least M4R_MIN_ROWS rows,
+    // seconds per row; negative until measured
+    double m_dot_row_seconds = -1.0;
+    double m_m4r_row_seconds = -1.0;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_in_cv;  // m_in changed, or the stream closed
+    std::condition_variable m_out_cv; // m_out or m_pending changed
+    std::deque<GF2RowChunk> m_in;
+    std::deque<GF2RowChunk> m_out;
+    size_t m_pending = 0; // pushed and not yet handed on
+    size_t m_next_row = 0;
+    bool m_closed = false;
+    bool m_stop = false;
+    std::exception_ptr m_error;
+    Clock::time_point m_first_push;
+    GF2StreamingStats m_stats;
+    std::thread m_worker;
+};
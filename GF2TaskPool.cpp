@@ -0,0 +1,159 @@
+#include "GF2TaskPool.hpp"
+#include "GF2Numa.hpp"
+#include <omp.h>
+
+namespace {
+
+// The pool and deque of the calling worker thread
+thread_local const GF2TaskPool* current_pool = nullptr;
+thread_local int current_index = -1;
+
+} // namespace
+
+GF2TaskPool::GF2TaskPool(int threads) {
+    const int workers = threads > 0 ? threads : omp_get_max_threads();
+    // The last deque takes the tasks of run(), which any worker may steal
+    for (int i = 0; i <= workers; ++i) {
+        m_deques.push_back(std::make_unique<Deque>());
+    }
+    for (int i = 0; i < workers; ++i) {
+        m_workers.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+GF2TaskPool::~GF2TaskPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+}
+
+GF2TaskPool& GF2TaskPool::shared() {
+    static GF2TaskPool pool;
+    return pool;
+}
+
+int GF2TaskPool::workerIndex() const {
+    return current_pool == this ? current_index : -1;
+}
+
+bool GF2TaskPool::push(int index, GF2Task* task) {
+    Deque& deque = *m_deques[index];
+    {
+        std::lock_guard<std::mutex> lock(deque.mutex);
+        if (deque.bottom - deque.top == DEQUE_CAPACITY) {
+            return false;
+        }
+        deque.tasks[deque.bottom++ % DEQUE_CAPACITY] = task;
+    }
+    // Pairs with the fence of a worker going to sleep: either it sees the
+    // task or this sees it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_sleeping.load(std::memory_order_relaxed) > 0) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_epoch;
+        }
+        m_cv.notify_one();
+    }
+    return true;
+}
+
+bool GF2TaskPool::popIf(int index, GF2Task* task) {
+    Deque& deque = *m_deques[index];
+    std::lock_guard<std::mutex> lock(deque.mutex);
+    if (deque.bottom == deque.top || deque.tasks[(deque.bottom - 1) % DEQUE_CAPACITY] != task) {
+        return false;
+    }
+    --deque.bottom;
+    return true;
+}
+
+GF2Task* GF2TaskPool::steal(int thief) {
+    const size_t n = m_deques.size();
+    for (size_t k = 1; k <= n; ++k) {
+        Deque& deque = *m_deques[(size_t(thief) + k) % n];
+        std::lock_guard<std::mutex> lock(deque.mutex);
+        if (deque.bottom != deque.top) {
+            return deque.tasks[deque.top++ % DEQUE_CAPACITY];
+        }
+    }
+    return nullptr;
+}
+
+void GF2TaskPool::execute(GF2Task* task) {
+    try {
+        task->execute(task);
+    } catch (...) {
+        task->error = std::current_exception();
+    }
+    if (!task->external) {
+        task->done.store(true, std::memory_order_release);
+        return;
+    }
+    {
+        // run() waits on m_ran for its task under m_mutex
+        std::lock_guard<std::mutex> lock(m_mutex);
+        task->done.store(true, std::memory_order_release);
+    }
+    m_ran.notify_all();
+}
+
+void GF2TaskPool::workerLoop(int index) {
+    current_pool = this;
+    current_index = index;
+    gf2_set_thread_qos(GF2ThreadQos::Compute);
+    while (true) {
+        if (GF2Task* task = steal(index)) {
+            execute(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_stop) {
+            return;
+        }
+        const size_t epoch = m_epoch;
+        m_sleeping.fetch_add(1, std::memory_order_relaxed);
+        lock.unlock();
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        GF2Task* task = steal(index);
+        lock.lock();
+        if (!task) {
+            m_cv.wait(lock, [&] { return m_epoch != epoch || m_stop; });
+        }
+        m_sleeping.fetch_sub(1, std::memory_order_relaxed);
+        lock.unlock();
+        if (task) {
+            execute(task);
+        }
+    }
+}
+
+void GF2TaskPool::helpUntil(int index, GF2Task* task) {
+    while (!task->done.load(std::memory_order_acquire)) {
+        if (GF2Task* other = steal(index)) {
+            execute(other);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void GF2TaskPool::submitAndWait(GF2Task* task) {
+    const int external = static_cast<int>(m_deques.size()) - 1;
+    while (!push(external, task)) {
+        std::this_thread::yield();
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_ran.wait(lock, [&] { return task->done.load(std::memory_order_acquire); });
+}
+
+void GF2TaskPool::rethrow(GF2Task& task) {
+    if (task.error) {
+        std::rethrow_exception(task.error);
+    }
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// A unit of work of GF2TaskPool. Tasks live in the frame of the call that
+// forks them, which joins them before it returns, so the pool never
+// allocates per task.
+struct GF2Task {
+    void (*execute)(GF2Task*) = nullptr;
+    std::atomic<bool> done{false};
+    bool external = false; // from run(), whose caller waits on the pool's m_ran
+    std::exception_ptr error;
+};
+
+// Fixed worker threads with a deque each, for the irregular task trees of
+// recursive algorithms (Strassen's seven products per level). A worker
+// pushes the tasks it forks onto the bottom of its deque and pops them back
+// from there; an idle worker steals from the top of another's, taking the
+// oldest, largest pieces of work. Joining a task that was stolen runs other
+// tasks until it completes instead of blocking. Threads outside the pool
+// (the caller, GPU submission threads) enter it through run(); a call to
+// invoke() or parallelFor() from one is run() of itself.
+class GF2TaskPool {
+public:
+    // threads workers (<= 0 for the OpenMP default)
+    explicit GF2TaskPool(int threads = 0);
+    ~GF2TaskPool();
+    GF2TaskPool(const GF2TaskPool&) = delete;
+    GF2TaskPool& operator=(const GF2TaskPool&) = delete;
+
+    int size() const { return static_cast<int>(m_workers.size()); }
+
+    // Runs f on the pool and waits for it; inline on one of its workers.
+    // An exception of f is rethrown here.
+    template <typename F>
+    void run(F&& f);
+
+    // Runs f and g, possibly in parallel, and returns when both are done;
+    // the first exception of either is rethrown
+    template <typename F, typename G>
+    void invoke(F&& f, G&& g);
+
+    // f(i) for i in [begin, end), split in halves down to grain indices
+    template <typename F>
+    void parallelFor(size_t begin, size_t end, size_t grain, F&& f);
+
+    // A pool with the OpenMP default of workers, created on first use
+    static GF2TaskPool& shared();
+
+private:
+    static constexpr size_t DEQUE_CAPACITY = 256;
+
+    // Bounded, so a push never allocates; a full deque runs the task inline
+    struct Deque {
+        std::mutex mutex;
+        GF2Task* tasks[DEQUE_CAPACITY];
+        size_t top = 0;    // oldest, stolen from
+        size_t bottom = 0; // newest, pushed and popped by the owner
+    };
+
+    template <typename F>
+    struct FunctionTask : GF2Task {
+        F* f;
+        explicit FunctionTask(F& fn) : f(&fn) { execute = &call; }
+        static void call(GF2Task* t) { (*static_cast<FunctionTask*>(t)->f)(); }
+    };
+
+    std::vector<std::unique_ptr<Deque>> m_deques; // one per worker, then run()'s
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;  // idle workers
+    std::condition_variable m_ran; // run() callers waiting for their task
+    std::atomic<int> m_sleeping{0};
+    size_t m_epoch = 0; // under m_mutex: bumped by every push a sleeper may miss
+    bool m_stop = false;
+
+    // The index of the calling thread's deque, if it is one of this pool's
+    // workers; else -1
+    int workerIndex() const;
+    bool push(int index, GF2Task* task);
+    // Takes task back from the bottom of deque index, if no one stole it
+    bool popIf(int index, GF2Task* task);
+    GF2Task* steal(int thief);
+    void execute(GF2Task* task);
+    void workerLoop(int index);
+    // Runs other tasks until task is done
+    void helpUntil(int index, GF2Task* task);
+    void submitAndWait(GF2Task* task);
+    static void rethrow(GF2Task& task);
+};
+
+template <typename F>
+void GF2TaskPool::run(F&& f) {
+    if (workerIndex() >= 0) {
+        f();
+        return;
+    }
+    FunctionTask<std::remove_reference_t<F>> task(f);
+    task.external = true;
+    submitAndWait(&task);
+    rethrow(task);
+}
+
+template <typename F, typename G>
+void GF2TaskPool::invoke(F&& f, G&& g) {
+    const int index = workerIndex();
+    if (index < 0) {
+        run([&] { invoke(f, g); });
+        return;
+    }
+    FunctionTask<std::remove_reference_t<G>> second(g);
+    if (!push(index, &second)) {
+        f();
+        g();
+        return;
+    }
+    std::exception_ptr error;
+    try {
+        f();
+    } catch (...) {
+        error = std::current_exception();
+    }
+    if (popIf(index, &second)) {
+        execute(&second);
+    } else {
+        helpUntil(index, &second);
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    rethrow(second);
+}
+
+template <typename F>
+void GF2TaskPool::parallelFor(size_t begin, size_t end, size_t grain, F&& f) {
+    grain = grain > 0 ? grain : 1;
+    if (end - begin <= grain) {
+        for (size_t i = begin; i < end; ++i) {
+            f(i);
+        }
+        return;
+    }
+    const size_t mid = begin + (end - begin) / 2;
+    invoke([&] { parallelFor(begin, mid, grain, f); },
+           [&] { parallelFor(mid, end, grain, f); });
+}
@@ -1,44 +1,395 @@
 #include "GF2TestFramework.hpp"
+#include "GF2CpuInfo.hpp"
+#include "GF2Numa.hpp"
+#include "GF2Roofline.hpp"
+#include "GF2Trace.hpp"
+#ifdef GF2_HAVE_METAL
+#include "GF2GPU.hpp"
+#include "GF2MultiGPU.hpp"
+#endif
 #include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
 #include <fstream>
+#include <future>
 #include <iomanip>
 #include <iostream>
+#include <omp.h>
+#include <optional>
+#include <random>
+#include <sstream>
 
-GF2TestFramework::GF2TestFramework() { initializeGPU(); }
+namespace {
+
+// The methods that run on the GPU backend (Hybrid in part)
+bool is_gpu_label(const std::string &method) {
+  return method.compare(0, 3, "GPU") == 0 || method == "Hybrid";
+}
+
+bool is_multithreaded_label(const std::string &method) {
+  return method == "SIMD-Parallel" || method == "SIMD-Tiled" ||
+         method == "SIMD-Into" || method == "Hybrid" || method == "Engine";
+}
+
+// The kernel behind a test method: the dispatched SIMD kernel on the CPU,
+// the GF2Kernel variant on the GPU
+std::string kernel_variant(const std::string &method) {
+  if (method == "Serial") {
+    return "serial";
+  }
+  if (method == "M4R") {
+    return "m4r";
+  }
+  if (method == "Strassen") {
+    return "strassen/m4r";
+  }
+  if (method == "GPU") {
+    return "Baseline";
+  }
+  if (method == "GPU (Transposed)") {
+    return "Transposed";
+  }
+  if (method == "GPU-Tiled") {
+    return "Tiled";
+  }
+  if (method == "GPU-SimdGroup") {
+    return "SimdGroup";
+  }
+  if (method == "GPU (M4R)") {
+    return "M4R";
+  }
+  if (method == "GPU-Strassen") {
+    return "strassen/M4R";
+  }
+  if (is_gpu_label(method)) {
+    // The resident, plan, out-of-core, batched, async and hybrid paths
+    return "Vectorized";
+  }
+  return GF2Matrix::simdKernelName();
+}
+
+// Compiler and the flags CMake passed (GF2_BUILD_FLAGS)
+std::string build_description() {
+#ifndef GF2_BUILD_FLAGS
+#define GF2_BUILD_FLAGS "unknown flags"
+#endif
+#ifdef __VERSION__
+  return std::string(__VERSION__) + "; " + GF2_BUILD_FLAGS;
+#else
+  return GF2_BUILD_FLAGS;
+#endif
+}
+
+std::string utc_timestamp() {
+  std::time_t now = std::time(nullptr);
+  std::tm utc{};
+  gmtime_r(&now, &utc);
+  char buffer[32];
+  std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", &utc);
+  return buffer;
+}
+
+// Quoted when it holds a comma, a quote or a newline
+std::string csv_field(const std::string &value) {
+  if (value.find_first_of(",\"\n") == std::string::npos) {
+    return value;
+  }
+  std::string quoted = "\"";
+  for (char c : value) {
+    quoted += c;
+    if (c == '"') {
+      quoted += '"';
+    }
+  }
+  return quoted + "\"";
+}
+
+std::string json_string(const std::string &value) {
+  std::string out = "\"";
+  for (char c : value) {
+    switch (c) {
+    case '"': out += "\\\""; break;
+    case '\\': out += "\\\\"; break;
+    case '\n': out += "\\n"; break;
+    case '\t': out += "\\t"; break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        char escaped[8];
+        std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+        out += escaped;
+      } else {
+        out += c;
+      }
+    }
+  }
+  return out + "\"";
+}
+
+// Median of the non-negative values, or -1 if there are none
+double median_of_valid(std::vector<double> values) {
+  values.erase(std::remove_if(values.begin(), values.end(),
+                              [](double v) { return v < 0.0; }),
+               values.end());
+  if (values.empty()) {
+    return -1.0;
+  }
+  std::nth_element(values.begin(), values.begin() + values.size() / 2,
+                   values.end());
+  return values[values.size() / 2];
+}
+
+// A counter value or a derived one for the CSV, empty when not counted
+std::string counter_field(double value) {
+  if (value < 0.0) {
+    return "";
+  }
+  std::ostringstream out;
+  out << value;
+  return out.str();
+}
+
+std::string counter_json(double value) {
+  return value < 0.0 ? "null" : counter_field(value);
+}
+
+// Largest of the non-negative values, or -1 if there are none
+double max_of_valid(const std::vector<double> &values) {
+  double most = -1.0;
+  for (double v : values) {
+    most = std::max(most, v);
+  }
+  return most;
+}
+
+// Bytes as MiB with one decimal, empty when not measured
+std::string mib_field(double bytes) {
+  if (bytes < 0.0) {
+    return "";
+  }
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(1) << bytes / (1024.0 * 1024.0);
+  return out.str();
+}
+
+// Seeds of generateRandomMatrix's operands, when the run has a seed
+std::optional<std::mt19937_64> operand_seeds;
+
+void seed_operands(uint64_t seed) {
+  if (seed != 0) {
+    operand_seeds.emplace(seed);
+  } else {
+    operand_seeds.reset();
+  }
+}
+
+// The seed of the next operand: drawn from operand_seeds, or fresh
+uint64_t next_operand_seed() {
+  if (operand_seeds) {
+    return (*operand_seeds)();
+  }
+  std::random_device rd;
+  return (uint64_t(rd()) << 32) | rd();
+}
+
+// The operands of a test's timed iterations, shaped like a and b. With
+// background set, the pair of iteration i + 1 is generated on a thread of
+// its own, one OpenMP thread wide, while iteration i is timed, so the
+// generation is off the critical path (and with the Background QoS class,
+// on an E-core of Apple silicon). The seeds are drawn up front in the
+// order generateRandomMatrix would draw them, so a seeded run sees the same
+// operands either way.
+class OperandPipeline {
+public:
+  OperandPipeline(const GF2Matrix &a, const GF2Matrix &b, int iterations,
+                  bool background)
+      : _aRows(a.rows()), _aCols(a.cols()), _bRows(b.rows()),
+        _bCols(b.cols()), _background(background) {
+    for (int i = 0; i < iterations; ++i) {
+      _seeds.emplace_back(next_operand_seed(), next_operand_seed());
+    }
+    if (_background && !_seeds.empty()) {
+      _pending = std::async(std::launch::async, [this] {
+        gf2_set_thread_qos(GF2ThreadQos::Background);
+        return generate(0, 1);
+      });
+    }
+  }
+
+  std::pair<GF2Matrix, GF2Matrix> next() {
+    const size_t i = _next++;
+    if (i >= _seeds.size()) {
+      throw std::runtime_error("More iterations than operands");
+    }
+    if (!_background) {
+      return generate(i, 0);
+    }
+    std::pair<GF2Matrix, GF2Matrix> operands = _pending.get();
+    if (i + 1 < _seeds.size()) {
+      _pending = std::async(std::launch::async, [this, i] {
+        gf2_set_thread_qos(GF2ThreadQos::Background);
+        return generate(i + 1, 1);
+      });
+    }
+    return operands;
+  }
+
+private:
+  size_t _aRows, _aCols, _bRows, _bCols;
+  bool _background;
+  std::vector<std::pair<uint64_t, uint64_t>> _seeds;
+  size_t _next = 0;
+  std::future<std::pair<GF2Matrix, GF2Matrix>> _pending;
+
+  std::pair<GF2Matrix, GF2Matrix> generate(size_t i, int threads) const {
+    std::pair<GF2Matrix, GF2Matrix> operands(GF2Matrix(_aRows, _aCols),
+                                             GF2Matrix(_bRows, _bCols));
+    operands.first.randomFill(_seeds[i].first, threads);
+    operands.second.randomFill(_seeds[i].second, threads);
+    return operands;
+  }
+};
+
+} // namespace
+
+GF2TestFramework::GF2TestFramework()
+    : _warmup(1), _backgroundInputs(false), _validationRounds(20), _confidence(0.95),
+      _rejectOutliers(true), _trackMemory(true) {
+  initializeGPU();
+}
 
 GF2TestFramework::~GF2TestFramework() { cleanupGPU(); }
 
 void GF2TestFramework::initializeGPU() {
-  _device = MTL::CreateSystemDefaultDevice();
-  if (_device) {
-    _gpu = new GF2GPU(_device);
-  } else {
-    _gpu = nullptr;
+  _backend = GF2Backend::create();
+  _gpu = nullptr;
+#ifdef GF2_HAVE_METAL
+  _gpu = dynamic_cast<GF2GPU *>(_backend.get());
+  // The Metal-only methods run on the primary of several devices
+  if (auto *multi = dynamic_cast<GF2MultiGPU *>(_backend.get())) {
+    _gpu = &multi->primary();
+  }
+#endif
+  // The engine routes testEngine() and predicts the times the budget skips
+  // by, neither of which needs the full grid: unless GF2_ENGINE_PROFILE names
+  // a profile to use, a coarse one is measured in memory in a few seconds
+  GF2EngineConfig engine_config;
+  const char *profile = std::getenv("GF2_ENGINE_PROFILE");
+  if (!profile || !*profile) {
+    engine_config.dims = {64, 512, 2048};
+    engine_config.repetitions = 1;
+    engine_config.max_method_ms = 50.0;
+    engine_config.persist_profile = false;
   }
+  _engine = new GF2Engine(_backend.get(), engine_config);
 }
 
 void GF2TestFramework::cleanupGPU() {
-  if (_gpu)
-    delete _gpu;
-  if (_device)
-    _device->release();
+  delete _engine;
+  _gpu = nullptr;
+  _backend.reset();
+}
+
+bool GF2TestFramework::hasKernel(GF2Kernel kernel) const {
+  return _backend && _backend->supports(kernel);
+}
+
+void GF2TestFramework::beginRegion() {
+  if (_trackMemory) {
+    _memory.start(_backend.get());
+  }
+  _energy.start();
+  _counters.start();
+  _regionTraceStart = gf2_trace_active() ? gf2_trace_now_us() : -1.0;
+}
+
+void GF2TestFramework::endRegion() {
+  RegionSample sample;
+  if (_regionTraceStart >= 0.0) {
+    sample.trace_start_us = _regionTraceStart;
+    sample.trace_end_us = gf2_trace_now_us();
+  }
+  sample.counters = _counters.stop();
+  sample.energy = _energy.stop();
+  if (_trackMemory) {
+    sample.memory = _memory.stop();
+  }
+  _samples.push_back(sample);
+}
+
+bool GF2TestFramework::verified(const GF2Matrix &a, const GF2Matrix &b,
+                                const GF2Matrix &result) const {
+  return _validationRounds == 0 ||
+         validateMultiplication(a, b, result, _validationRounds);
 }
 
 std::vector<TestResult> GF2TestFramework::runTests(const TestConfig &config) {
   std::vector<TestResult> allResults;
+  _warmup = std::max(config.warmup_iterations, 0);
+  _backgroundInputs = config.background_inputs && omp_get_num_procs() > 1;
+  _validationRounds =
+      config.validate_results ? std::max(config.validation_rounds, 1) : 0;
+  _confidence = config.confidence;
+  _rejectOutliers = config.reject_outliers;
+  _trackMemory = config.track_memory;
+  seed_operands(config.seed);
+  if (config.perf_counters && !_counters.isOpen()) {
+    std::string error;
+    if (!_counters.open(&error)) {
+      std::cout << "Hardware counters unavailable: " << error << "\n";
+    }
+  } else if (!config.perf_counters) {
+    _counters.close();
+  }
+  if (config.energy && !_energy.isOpen()) {
+    std::string error;
+    if (!_energy.open(&error)) {
+      std::cout << "Energy counters unavailable: " << error << "\n";
+    }
+  } else if (!config.energy) {
+    _energy.close();
+  }
 
   std::cout << "Running GF(2) Matrix Multiplication Tests\n";
-  std::cout << "========================================\n\n";
+  std::cout << "========================================\n";
+  std::cout << "CPU kernel: " << GF2Matrix::simdKernelName() << "\n";
+  if (_counters.isOpen()) {
+    std::cout << "Hardware counters: " << _counters.describe() << "\n";
+  }
+  if (_energy.isOpen()) {
+    std::cout << "Energy: " << _energy.describe() << "\n";
+  }
+  if (_trackMemory) {
+    std::cout << "Peak memory: " << _memory.describe(_backend.get()) << "\n";
+  }
+  if (_backend) {
+    std::cout << "GPU backend: " << _backend->backendName() << " ("
+              << _backend->deviceName() << ")\n";
+  }
+#ifdef GF2_HAVE_METAL
+  if (_gpu) {
+    std::cout << "GPU storage: "
+              << (_gpu->storage() == GF2GPU::Storage::Private
+                      ? "private, blit-staged"
+                      : "shared")
+              << "\n";
+  }
+#endif
+  std::cout << "\n";
 
-  const size_t max_size_1 = 1024;
-  const size_t max_size_2 = 4096;
+  std::vector<std::tuple<size_t, size_t, size_t>> shapes = config.shapes;
+  if (shapes.empty()) {
+    for (const auto &size : config.matrix_sizes) {
+      shapes.emplace_back(size.first, size.second, size.second);
+    }
+  }
 
-  for (const auto &size : config.matrix_sizes) {
-    size_t rowsA = size.first;
-    size_t colsA = size.second;
-    size_t rowsB = colsA; // For valid multiplication
-    size_t colsB = size.second;
+  for (const auto &[m, k, n] : shapes) {
+    size_t rowsA = m;
+    size_t colsA = k;
+    size_t rowsB = k;
+    size_t colsB = n;
 
     std::cout << "Testing matrices: " << rowsA << "x" << colsA << " * " << rowsB
               << "x" << colsB << "\n";
@@ -46,394 +397,1154 @@ std::vector<TestResult> GF2TestFramework::runTests(const TestConfig &config) {
     GF2Matrix a = generateRandomMatrix(rowsA, colsA);
     GF2Matrix b = generateRandomMatrix(rowsB, colsB);
 
-    // Skip serial multiplication for matrices 1024 and above
-    if (config.run_serial && (rowsA < max_size_1)) {
-      auto results = testSerial(a, b, config.iterations);
-      allResults.insert(allResults.end(), results.begin(), results.end());
+    // Skip the slow methods at the sizes where the engine profile says
+    // they would not finish in time
+    if (config.run_serial &&
+        withinBudget(GF2Engine::Method::Serial, a, b, config)) {
+      runMeasured(allResults, config, a, b, [&](int iterations) {
+        return testSerial(a, b, iterations);
+      });
     }
 
     if (config.run_simd) {
-      auto results = testSIMD(a, b, config.iterations);
-      allResults.insert(allResults.end(), results.begin(), results.end());
+      runMeasured(allResults, config, a, b, [&](int iterations) {
+        return testSIMD(a, b, iterations);
+      });
+    }
+
+    if (config.run_simd_parallel) {
+      runMeasured(allResults, config, a, b, [&](int iterations) {
+        return testSIMDParallel(a, b, iterations, config.num_threads);
+      });
+    }
+
+    if (config.run_simd_tiled) {
+      runMeasured(allResults, config, a, b, [&](int iterations) {
+        return testSIMDTiled(a, b, iterations, config.tiles,
+                             config.num_threads);
+      });
+    }
+
+    if (config.run_simd_into) {
+      runMeasured(allResults, config, a, b, [&](int iterations) {
+        return testSIMDInto(a, b, iterations, config.num_threads);
+      });
     }
 
-    if (config.run_gpu && _gpu) {
-      auto results = testGPU(a, b, config.iterations && (rowsA < max_size_2));
-      allResults.insert(allResults.end(), results.begin(), results.end());
+    if (config.run_m4r) {
+      runMeasured(allResults, config, a, b, [&](int iterations) {
+        return testM4R(a, b, iterations);
+      });
     }
 
-    if (config.run_gpu_transposed && _gpu && (rowsA < max_size_2)) {
-      auto results = testGPU_transposed(a, b, config.iterations);
-      allResults.insert(allResults.end(), results.begin(), results.end());
+    if (config.run_strassen) {
+      runMeasured(allResults, config, a, b, [&](int iterations) {
+        return testStrassen(a, b, iterations, config.strassen_cutoff);
+      });
     }
 
-    if (config.run_gpu_tiled && _gpu && (rowsA < max_size_2)) {
-      auto results = testGPUTiled(a, b, config.iterations);
-      allResults.insert(allResults.end(), results.begin(), results.end());
+    if (config.run_gpu && hasKernel(GF2Kernel::Baseline) &&
+        withinBudget(GF2Engine::Method::GPUBaseline, a, b, config)) {
+      runMeasured(allResults, config, a, b, [&](int iterations) {
+        return testGPU(a, b, iterations);
+      });
     }
 
-    if (config.run_gpu_vectorized && _gpu) {
-      auto results = testGPUVectorized(a, b, config.iterations);
-      allResults.insert(allResults.end(), results.begin(), results.end());
+    if (config.run_gpu_transposed && hasKernel(GF2Kernel::Transposed) &&
+        withinBudget(GF2Engine::Method::GPUTransposed, a, b, config)) {
+      runMeasured(allResults, config, a, b, [&](int iterations) {
+        return testGPU_transposed(a, b, iterations);
+      });
+    }
+
+    if (config.run_gpu_tiled && hasKernel(GF2Kernel::Tiled) &&
+        withinBudget(GF2Engine::Method::GPUTiled, a, b, config)) {
+      runMeasured(allResults, config, a, b, [&](int iterations) {
+        return testGPUTiled(a, b, iterations);
+      });
+    }
+
+    if (config.run_gpu_vectorized && hasKernel(GF2Kernel::Vectorized)) {
+      runMeasured(allResults, config, a, b, [&](int iterations) {
+        return testGPUVectorized(a, b, iterations);
+      });
+    }
+
+    if (config.run_gpu_simdgroup && hasKernel(GF2Kernel::SimdGroup)) {
+      runMeasured(allResults, config, a, b, [&](int iterations) {
+        return testGPUSimdGroup(a, b, iterations);
+      });
+    }
+
+#ifdef GF2_HAVE_METAL
+    if (config.run_gpu_resident && _gpu) {
+      runMeasured(allResults, config, a, b, [&](int iterations) {
+        return testGPUResident(a, b, iterations);
+      });
+    }
+
+    if (config.run_gpu_plan && _gpu) {
+      runMeasured(allResults, config, a, b, [&](int iterations) {
+        return testGPUPlan(a, b, iterations);
+      });
+    }
+
+    if (config.run_gpu_out_of_core && _gpu) {
+      runMeasured(allResults, config, a, b, [&](int iterations) {
+        return testGPUOutOfCore(a, b, iterations);
+      });
+    }
+
+    if (config.run_gpu_strassen && _gpu) {
+      runMeasured(allResults, config, a, b, [&](int iterations) {
+        return testGPUStrassen(a, b, iterations);
+      });
+    }
+
+    if (config.run_hybrid && _gpu) {
+      runMeasured(allResults, config, a, b, [&](int iterations) {
+        return testHybrid(a, b, iterations, config.num_threads);
+      });
+    }
+#endif
+
+    if (config.run_gpu_m4r && hasKernel(GF2Kernel::M4R)) {
+      runMeasured(allResults, config, a, b, [&](int iterations) {
+        return testGPUM4R(a, b, iterations);
+      });
+    }
+
+#ifdef GF2_HAVE_METAL
+    if (config.run_gpu_batched && _gpu && rowsA <= 512) {
+      runMeasured(allResults, config, a, b, [&](int iterations) {
+        return testGPUBatched(a, b, iterations, config.gpu_batch_size);
+      });
+    }
+
+    if (config.run_gpu_async && _gpu) {
+      runMeasured(allResults, config, a, b, [&](int iterations) {
+        return testGPUAsync(a, b, iterations);
+      });
+    }
+#endif
+
+    if (config.run_engine) {
+      runMeasured(allResults, config, a, b, [&](int iterations) {
+        return testEngine(a, b, iterations);
+      });
+    }
+
+    std::cout << "\n";
+  }
+
+  return allResults;
+}
+
+void GF2TestFramework::runMeasured(
+    std::vector<TestResult> &all, const TestConfig &config, const GF2Matrix &a,
+    const GF2Matrix &b,
+    const std::function<std::vector<TestResult>(int)> &test) {
+  const std::string timestamp = utc_timestamp();
+  // The test, with the counters and memory of its iterations when it
+  // recorded one sample per row
+  auto counted = [&](int iterations) {
+    _samples.clear();
+    std::vector<TestResult> rows = test(iterations);
+    if (_samples.size() == rows.size()) {
+      for (size_t i = 0; i < rows.size(); ++i) {
+        rows[i].counters = _samples[i].counters;
+        rows[i].memory = _samples[i].memory;
+        rows[i].energy = _samples[i].energy;
+#ifdef GF2_TRACE
+        // The timed region, named once its method is known
+        if (_samples[i].trace_start_us >= 0.0) {
+          gf2_trace_event("test: iteration", "test", _samples[i].trace_start_us,
+                          _samples[i].trace_end_us,
+                          rows[i].method + " " + std::to_string(a.rows()) + "x" +
+                              std::to_string(a.cols()) + "x" +
+                              std::to_string(b.cols()));
+        }
+#endif
+      }
+    }
+    return rows;
+  };
+  std::vector<TestResult> results = counted(config.iterations);
+
+  auto samples = [&results]() {
+    std::vector<double> ms;
+    for (const TestResult &r : results) {
+      if (r.correct) {
+        ms.push_back(r.duration_ms);
+      }
+    }
+    return ms;
+  };
+
+  if (config.ci_target > 0.0) {
+    for (;;) {
+      std::vector<double> ms = samples();
+      if (ms.empty() || ms.size() >= size_t(config.max_iterations)) {
+        break; // unavailable, or enough
+      }
+      double spent = 0.0;
+      for (double t : ms) {
+        spent += t;
+      }
+      TimingStats stats =
+          timingStats(ms, config.confidence, config.reject_outliers);
+      double half_width = (stats.ci_high_ms - stats.ci_low_ms) / 2.0;
+      bool tight =
+          ms.size() >= 2 && half_width <= config.ci_target * stats.median_ms;
+      if (tight || spent >= config.adaptive_budget_ms) {
+        break;
+      }
+      // Double the iterations, within both limits
+      size_t room = size_t(config.max_iterations) - ms.size();
+      int more = int(std::min(ms.size(), room));
+      if (stats.median_ms > 0.0) {
+        double affordable =
+            (config.adaptive_budget_ms - spent) / stats.median_ms;
+        more = std::min(more, std::max(1, int(affordable)));
+      }
+      std::vector<TestResult> extra = counted(more);
+      if (extra.empty()) {
+        break;
+      }
+      results.insert(results.end(), extra.begin(), extra.end());
     }
+  }
+
+  for (TestResult &result : results) {
+    describe(result, config, a, b, timestamp);
+  }
+  all.insert(all.end(), results.begin(), results.end());
+}
+
+void GF2TestFramework::describe(TestResult &result, const TestConfig &config,
+                                const GF2Matrix &a, const GF2Matrix &b,
+                                const std::string &timestamp) const {
+  result.m = a.rows();
+  result.k = a.cols();
+  result.n = b.cols();
+  result.bytes_moved =
+      (double(result.m) * result.k + double(result.k) * result.n +
+       double(result.m) * result.n) /
+      8.0;
+  // The engine's rows are modelled as the method it chose
+  const GF2WorkEstimate work = GF2Roofline::estimate(
+      result.method == "Engine" ? result.kernel : result.method, result.m,
+      result.k, result.n, config.strassen_cutoff);
+  result.bytes_read = work.bytes_read;
+  result.bytes_written = work.bytes_written;
+  result.word_ops = work.word_ops;
+  const bool gpu = is_gpu_label(result.method);
+  if (result.backend.empty()) {
+    result.backend = gpu && _backend ? _backend->backendName() : "CPU";
+  }
+  if (result.kernel.empty()) {
+    result.kernel = kernel_variant(result.method);
+  }
+  if (result.device.empty()) {
+    result.device = result.backend == "CPU" ? GF2CpuInfo::get().describe()
+                                            : _backend->deviceName();
+  }
+  if (result.backend == "CPU") {
+    result.memory.gpu_bytes = -1.0; // the pool of earlier GPU methods
+  }
+  const int all_threads =
+      config.num_threads > 0 ? config.num_threads : omp_get_max_threads();
+  if (result.threads == 0 && (!gpu || result.method == "Hybrid")) {
+    result.threads = is_multithreaded_label(result.method) ? all_threads : 1;
+  }
+  result.build = build_description();
+  result.timestamp = timestamp;
+}
+
+std::vector<TestResult> GF2TestFramework::testSerial(const GF2Matrix &a,
+                                                     const GF2Matrix &b,
+                                                     int iterations) {
+  if (a.cols() != b.rows()) {
+    throw std::runtime_error(
+        "Matrix dimensions incompatible for multiplication");
+  }
+
+  // Pre-allocate result matrix
+  GF2Matrix result(a.rows(), b.cols());
+
+  // Warm up
+  GF2Matrix a_warm = generateRandomMatrix(a.rows(), a.cols());
+  GF2Matrix b_warm = generateRandomMatrix(b.rows(), b.cols());
+  for (int w = 0; w < _warmup; ++w) {
+    result = a_warm.multiplySerial(b_warm);
+  }
+
+  std::vector<TestResult> individual_results;
+
+  OperandPipeline operands(a, b, iterations, _backgroundInputs);
+  for (int i = 0; i < iterations; i++) {
+    // Generate new random matrices for each iteration
+    auto [a_new, b_new] = operands.next();
+
+    beginRegion();
+    auto start = std::chrono::high_resolution_clock::now();
+    result = a_new.multiplySerial(b_new);
+    auto end = std::chrono::high_resolution_clock::now();
+    endRegion();
+
+    std::chrono::duration<double, std::milli> duration = end - start;
+    bool correct = verified(a_new, b_new, result);
+    double throughput =
+        calculateThroughput(a.rows(), a.cols(), b.cols(), duration.count());
+
+    individual_results.push_back(
+        {"Serial", duration.count(), correct, throughput,
+         a.rows() * b.cols(), {}});
+  }
+  return individual_results;
+}
+
+std::vector<TestResult> GF2TestFramework::testSIMD(const GF2Matrix &a,
+                                                   const GF2Matrix &b,
+                                                   int iterations) {
+  if (a.cols() != b.rows()) {
+    throw std::runtime_error(
+        "Matrix dimensions incompatible for multiplication");
+  }
+
+  // Pre-allocate result matrix
+  GF2Matrix result(a.rows(), b.cols());
+
+  // Warm up
+  GF2Matrix a_warm = generateRandomMatrix(a.rows(), a.cols());
+  GF2Matrix b_warm = generateRandomMatrix(b.rows(), b.cols());
+  for (int w = 0; w < _warmup; ++w) {
+    result = a_warm.multiplySIMD(b_warm);
+  }
+
+  std::vector<TestResult> individual_results;
+
+  OperandPipeline operands(a, b, iterations, _backgroundInputs);
+  for (int i = 0; i < iterations; i++) {
+    // Generate new random matrices for each iteration
+    auto [a_new, b_new] = operands.next();
+
+    beginRegion();
+    auto start = std::chrono::high_resolution_clock::now();
+    result = a_new.multiplySIMD(b_new);
+    auto end = std::chrono::high_resolution_clock::now();
+    endRegion();
+
+    std::chrono::duration<double, std::milli> duration = end - start;
+    bool correct = verified(a_new, b_new, result);
+    double throughput =
+        calculateThroughput(a.rows(), a.cols(), b.cols(), duration.count());
+
+    individual_results.push_back(
+        {"SIMD", duration.count(), correct, throughput,
+         a.rows() * b.cols(), {}});
+  }
+
+  return individual_results;
+}
+
+std::vector<TestResult> GF2TestFramework::testSIMDParallel(
+    const GF2Matrix &a, const GF2Matrix &b, int iterations, int num_threads) {
+  if (a.cols() != b.rows()) {
+    throw std::runtime_error(
+        "Matrix dimensions incompatible for multiplication");
+  }
+
+  // Pre-allocate result matrix
+  GF2Matrix result(a.rows(), b.cols());
+
+  // Warm up
+  GF2Matrix a_warm = generateRandomMatrix(a.rows(), a.cols());
+  GF2Matrix b_warm = generateRandomMatrix(b.rows(), b.cols());
+  for (int w = 0; w < _warmup; ++w) {
+    result = a_warm.multiplySIMDParallel(b_warm, num_threads);
+  }
+
+  std::vector<TestResult> individual_results;
+
+  OperandPipeline operands(a, b, iterations, _backgroundInputs);
+  for (int i = 0; i < iterations; i++) {
+    // Generate new random matrices for each iteration
+    auto [a_new, b_new] = operands.next();
+
+    beginRegion();
+    auto start = std::chrono::high_resolution_clock::now();
+    result = a_new.multiplySIMDParallel(b_new, num_threads);
+    auto end = std::chrono::high_resolution_clock::now();
+    endRegion();
+
+    std::chrono::duration<double, std::milli> duration = end - start;
+    bool correct = verified(a_new, b_new, result);
+    double throughput =
+        calculateThroughput(a.rows(), a.cols(), b.cols(), duration.count());
+
+    individual_results.push_back({"SIMD-Parallel", duration.count(), correct,
+                                  throughput, a.rows() * b.cols(), {}});
+  }
+
+  return individual_results;
+}
+
+std::vector<TestResult> GF2TestFramework::testSIMDTiled(
+    const GF2Matrix &a, const GF2Matrix &b, int iterations,
+    const GF2TileConfig &tiles, int num_threads) {
+  if (a.cols() != b.rows()) {
+    throw std::runtime_error(
+        "Matrix dimensions incompatible for multiplication");
+  }
+
+  // Pre-allocate result matrix
+  GF2Matrix result(a.rows(), b.cols());
+
+  // Warm up
+  GF2Matrix a_warm = generateRandomMatrix(a.rows(), a.cols());
+  GF2Matrix b_warm = generateRandomMatrix(b.rows(), b.cols());
+  for (int w = 0; w < _warmup; ++w) {
+    result = a_warm.multiplySIMDTiled(b_warm, tiles, num_threads);
+  }
+
+  std::vector<TestResult> individual_results;
+
+  OperandPipeline operands(a, b, iterations, _backgroundInputs);
+  for (int i = 0; i < iterations; i++) {
+    // Generate new random matrices for each iteration
+    auto [a_new, b_new] = operands.next();
+
+    beginRegion();
+    auto start = std::chrono::high_resolution_clock::now();
+    result = a_new.multiplySIMDTiled(b_new, tiles, num_threads);
+    auto end = std::chrono::high_resolution_clock::now();
+    endRegion();
+
+    std::chrono::duration<double, std::milli> duration = end - start;
+    bool correct = verified(a_new, b_new, result);
+    double throughput =
+        calculateThroughput(a.rows(), a.cols(), b.cols(), duration.count());
+
+    individual_results.push_back({"SIMD-Tiled", duration.count(), correct,
+                                  throughput, a.rows() * b.cols(), {}});
+  }
+
+  return individual_results;
+}
+
+std::vector<TestResult> GF2TestFramework::testSIMDInto(const GF2Matrix &a,
+                                                       const GF2Matrix &b,
+                                                       int iterations,
+                                                       int num_threads) {
+  if (a.cols() != b.rows()) {
+    throw std::runtime_error(
+        "Matrix dimensions incompatible for multiplication");
+  }
+
+  // Result and scratch are allocated once and reused by every iteration
+  GF2Matrix result(a.rows(), b.cols());
+  GF2Workspace workspace;
+
+  // Warm up
+  GF2Matrix a_warm = generateRandomMatrix(a.rows(), a.cols());
+  GF2Matrix b_warm = generateRandomMatrix(b.rows(), b.cols());
+  for (int w = 0; w < _warmup; ++w) {
+    a_warm.multiplyInto(b_warm, result, workspace, num_threads);
+  }
+
+  std::vector<TestResult> individual_results;
+
+  OperandPipeline operands(a, b, iterations, _backgroundInputs);
+  for (int i = 0; i < iterations; i++) {
+    // Generate new random matrices for each iteration
+    auto [a_new, b_new] = operands.next();
+
+    beginRegion();
+    auto start = std::chrono::high_resolution_clock::now();
+    a_new.multiplyInto(b_new, result, workspace, num_threads);
+    auto end = std::chrono::high_resolution_clock::now();
+    endRegion();
+
+    std::chrono::duration<double, std::milli> duration = end - start;
+    bool correct = verified(a_new, b_new, result);
+    // The fused addMul into the non-zero product, untimed: C ^ A*B is zero
+    if (correct && _validationRounds > 0) {
+      GF2Matrix accumulated = result;
+      GF2Matrix::addMul(accumulated, a_new, b_new, workspace, num_threads);
+      correct = accumulated.structure().zero();
+    }
+    double throughput =
+        calculateThroughput(a.rows(), a.cols(), b.cols(), duration.count());
+
+    individual_results.push_back({"SIMD-Into", duration.count(), correct,
+                                  throughput, a.rows() * b.cols(), {}});
+  }
+
+  return individual_results;
+}
+
+std::vector<TestResult> GF2TestFramework::testM4R(const GF2Matrix &a,
+                                                  const GF2Matrix &b,
+                                                  int iterations) {
+  if (a.cols() != b.rows()) {
+    throw std::runtime_error(
+        "Matrix dimensions incompatible for multiplication");
+  }
+
+  // Pre-allocate result matrix
+  GF2Matrix result(a.rows(), b.cols());
+
+  // Warm up
+  GF2Matrix a_warm = generateRandomMatrix(a.rows(), a.cols());
+  GF2Matrix b_warm = generateRandomMatrix(b.rows(), b.cols());
+  for (int w = 0; w < _warmup; ++w) {
+    result = a_warm.multiplyM4R(b_warm);
+  }
+
+  std::vector<TestResult> individual_results;
+
+  OperandPipeline operands(a, b, iterations, _backgroundInputs);
+  for (int i = 0; i < iterations; i++) {
+    // Generate new random matrices for each iteration
+    auto [a_new, b_new] = operands.next();
+
+    beginRegion();
+    auto start = std::chrono::high_resolution_clock::now();
+    result = a_new.multiplyM4R(b_new);
+    auto end = std::chrono::high_resolution_clock::now();
+    endRegion();
+
+    std::chrono::duration<double, std::milli> duration = end - start;
+    bool correct = verified(a_new, b_new, result);
+    double throughput =
+        calculateThroughput(a.rows(), a.cols(), b.cols(), duration.count());
+
+    individual_results.push_back(
+        {"M4R", duration.count(), correct, throughput,
+         a.rows() * b.cols(), {}});
+  }
+
+  return individual_results;
+}
+
+std::vector<TestResult> GF2TestFramework::testStrassen(const GF2Matrix &a,
+                                                       const GF2Matrix &b,
+                                                       int iterations,
+                                                       size_t cutoff) {
+  if (a.cols() != b.rows()) {
+    throw std::runtime_error(
+        "Matrix dimensions incompatible for multiplication");
+  }
+
+  // Pre-allocate result matrix
+  GF2Matrix result(a.rows(), b.cols());
+
+  // Warm up
+  GF2Matrix a_warm = generateRandomMatrix(a.rows(), a.cols());
+  GF2Matrix b_warm = generateRandomMatrix(b.rows(), b.cols());
+  for (int w = 0; w < _warmup; ++w) {
+    result = a_warm.multiplyStrassen(b_warm, cutoff);
+  }
+
+  std::vector<TestResult> individual_results;
+
+  OperandPipeline operands(a, b, iterations, _backgroundInputs);
+  for (int i = 0; i < iterations; i++) {
+    // Generate new random matrices for each iteration
+    auto [a_new, b_new] = operands.next();
+
+    beginRegion();
+    auto start = std::chrono::high_resolution_clock::now();
+    result = a_new.multiplyStrassen(b_new, cutoff);
+    auto end = std::chrono::high_resolution_clock::now();
+    endRegion();
+
+    std::chrono::duration<double, std::milli> duration = end - start;
+    bool correct = verified(a_new, b_new, result);
+    double throughput =
+        calculateThroughput(a.rows(), a.cols(), b.cols(), duration.count());
+
+    individual_results.push_back(
+        {"Strassen", duration.count(), correct, throughput,
+         a.rows() * b.cols(), {}});
+  }
+
+  return individual_results;
+}
+
+// std::vector<TestResult> GF2TestFramework::testSIMD(const GF2Matrix& a, const
+// GF2Matrix& b, int iterations, bool debug_mode) {
+//     if (a.cols() != b.rows()) {
+//         throw std::runtime_error("Matrix dimensions incompatible for
+//         multiplication");
+//     }
+//
+//     // Pre-allocate result matrix
+//     GF2Matrix result(a.rows(), b.cols());
+//
+//     // Warm up with one multiplication
+//     GF2Matrix a_warm = generateRandomMatrix(a.rows(), a.cols());
+//     GF2Matrix b_warm = generateRandomMatrix(b.rows(), b.cols());
+//     result = a_warm.multiplySIMD(b_warm);
+//
+//     std::vector<TestResult> individual_results;
+//
+//     for (int i = 0; i < iterations; i++) {
+//         // Generate new random matrices for each iteration
+//         GF2Matrix a_new = generateRandomMatrix(a.rows(), a.cols());
+//         GF2Matrix b_new = generateRandomMatrix(b.rows(), b.cols());
+//
+//         auto start = std::chrono::high_resolution_clock::now();
+//         result = a_new.multiplySIMD(b_new);
+//         auto end = std::chrono::high_resolution_clock::now();
+//
+//         if (debug_mode) {
+//             std::cout << "  SIMD multiplication " << (i + 1) << "/" <<
+//             iterations
+//                       << " completed: " << a.rows() << "x" << a.cols() << " *
+//                       "
+//                       << b.rows() << "x" << b.cols() << "\n";
+//         }
+//
+//         std::chrono::duration<double, std::milli> duration = end - start;
+//         double throughput = calculateThroughput(a.rows(), a.cols(), b.cols(),
+//         duration.count());
+//
+//         individual_results.push_back({
+//             "SIMD",
+//             duration.count(),
+//             true,
+//             throughput,
+//             a.rows() * b.cols()
+//         });
+//     }
+//
+//     return individual_results;
+// }
+
+std::vector<TestResult> GF2TestFramework::testGPU(const GF2Matrix &a,
+                                                  const GF2Matrix &b,
+                                                  int iterations) {
+  if (!hasKernel(GF2Kernel::Baseline)) {
+    return std::vector<TestResult>{
+        {"GPU", 0.0, false, 0.0, a.rows() * b.cols(), {}}};
+  }
+
+  // Pre-allocate result matrix
+  GF2Matrix result(a.rows(), b.cols());
+
+  // Warm up
+  GF2Matrix a_warm = generateRandomMatrix(a.rows(), a.cols());
+  GF2Matrix b_warm = generateRandomMatrix(b.rows(), b.cols());
+  for (int w = 0; w < _warmup; ++w) {
+    _backend->multiply(GF2Kernel::Baseline, a_warm, b_warm, result);
+  }
+
+  std::vector<TestResult> individual_results;
+
+  OperandPipeline operands(a, b, iterations, _backgroundInputs);
+  for (int i = 0; i < iterations; i++) {
+    // Generate new random matrices for each iteration
+    auto [a_new, b_new] = operands.next();
+
+    beginRegion();
+    auto start = std::chrono::high_resolution_clock::now();
+    _backend->multiply(GF2Kernel::Baseline, a_new, b_new, result);
+    auto end = std::chrono::high_resolution_clock::now();
+    endRegion();
+
+    std::chrono::duration<double, std::milli> duration = end - start;
+    bool correct = verified(a_new, b_new, result);
+    double throughput =
+        calculateThroughput(a.rows(), a.cols(), b.cols(), duration.count());
+
+    individual_results.push_back(
+        {"GPU", duration.count(), correct, throughput, a.rows() * b.cols(),
+         _backend->lastTiming()});
+  }
+
+  return individual_results;
+}
+
+std::vector<TestResult> GF2TestFramework::testGPU_transposed(const GF2Matrix &a,
+                                                             const GF2Matrix &b,
+                                                             int iterations) {
+  if (!hasKernel(GF2Kernel::Transposed)) {
+    return std::vector<TestResult>{
+        {"GPU (Transposed)", 0.0, false, 0.0, a.rows() * b.cols(), {}}};
+  }
+
+  GF2Matrix result(a.rows(), b.cols());
+
+  // Warm up
+  GF2Matrix a_warm = generateRandomMatrix(a.rows(), a.cols());
+  GF2Matrix b_warm = generateRandomMatrix(b.rows(), b.cols());
+  for (int w = 0; w < _warmup; ++w) {
+    _backend->multiply(GF2Kernel::Transposed, a_warm, b_warm, result);
+  }
+
+  std::vector<TestResult> individual_results;
+
+  OperandPipeline operands(a, b, iterations, _backgroundInputs);
+  for (int i = 0; i < iterations; i++) {
+    auto [a_new, b_new] = operands.next();
+
+    beginRegion();
+    auto start = std::chrono::high_resolution_clock::now();
+    _backend->multiply(GF2Kernel::Transposed, a_new, b_new, result);
+    auto end = std::chrono::high_resolution_clock::now();
+    endRegion();
+
+    std::chrono::duration<double, std::milli> duration = end - start;
+    bool correct = verified(a_new, b_new, result);
+    double throughput =
+        calculateThroughput(a.rows(), a.cols(), b.cols(), duration.count());
+
+    individual_results.push_back({"GPU (Transposed)", // Method name for reports
+                                  duration.count(),
+                                  correct,
+                                  throughput, a.rows() * b.cols(),
+                                  _backend->lastTiming()});
+  }
+
+  return individual_results;
+}
+
+std::vector<TestResult> GF2TestFramework::testGPUTiled(const GF2Matrix &a,
+                                                       const GF2Matrix &b,
+                                                       int iterations) {
+  if (!hasKernel(GF2Kernel::Tiled)) {
+    return std::vector<TestResult>{
+        {"GPU-Tiled", 0.0, false, 0.0, a.rows() * b.cols(), {}}};
+  }
+
+  GF2Matrix result(a.rows(), b.cols());
+
+  // Warm up
+  GF2Matrix a_warm = generateRandomMatrix(a.rows(), a.cols());
+  GF2Matrix b_warm = generateRandomMatrix(b.rows(), b.cols());
+  for (int w = 0; w < _warmup; ++w) {
+    _backend->multiply(GF2Kernel::Tiled, a_warm, b_warm, result);
+  }
+
+  std::vector<TestResult> individual_results;
+
+  OperandPipeline operands(a, b, iterations, _backgroundInputs);
+  for (int i = 0; i < iterations; i++) {
+    auto [a_new, b_new] = operands.next();
+
+    beginRegion();
+    auto start = std::chrono::high_resolution_clock::now();
+    _backend->multiply(GF2Kernel::Tiled, a_new, b_new, result);
+    auto end = std::chrono::high_resolution_clock::now();
+    endRegion();
+
+    std::chrono::duration<double, std::milli> duration = end - start;
+    bool correct = verified(a_new, b_new, result);
+    double throughput =
+        calculateThroughput(a.rows(), a.cols(), b.cols(), duration.count());
+
+    individual_results.push_back(
+        {"GPU-Tiled", // Set the correct method name for reporting
+         duration.count(),
+         correct,
+         throughput, a.rows() * b.cols(),
+         _backend->lastTiming()});
+  }
+
+  return individual_results;
+}
+
+std::vector<TestResult> GF2TestFramework::testGPUVectorized(const GF2Matrix &a,
+                                                            const GF2Matrix &b,
+                                                            int iterations) {
+  if (!hasKernel(GF2Kernel::Vectorized)) {
+    return std::vector<TestResult>{
+        {"GPU-Vectorized", 0.0, false, 0.0, a.rows() * b.cols(), {}}};
+  }
+
+  GF2Matrix result(a.rows(), b.cols());
+
+  // Warm up
+  GF2Matrix a_warm = generateRandomMatrix(a.rows(), a.cols());
+  GF2Matrix b_warm = generateRandomMatrix(b.rows(), b.cols());
+  for (int w = 0; w < _warmup; ++w) {
+    _backend->multiply(GF2Kernel::Vectorized, a_warm, b_warm, result);
+  }
+
+  std::vector<TestResult> individual_results;
+
+  OperandPipeline operands(a, b, iterations, _backgroundInputs);
+  for (int i = 0; i < iterations; i++) {
+    auto [a_new, b_new] = operands.next();
+
+    beginRegion();
+    auto start = std::chrono::high_resolution_clock::now();
+    _backend->multiply(GF2Kernel::Vectorized, a_new, b_new, result);
+    auto end = std::chrono::high_resolution_clock::now();
+    endRegion();
+
+    std::chrono::duration<double, std::milli> duration = end - start;
+    bool correct = verified(a_new, b_new, result);
+    double throughput =
+        calculateThroughput(a.rows(), a.cols(), b.cols(), duration.count());
+
+    individual_results.push_back({"GPU-Vectorized", // Method name for reports
+                                  duration.count(),
+                                  correct,
+                                  throughput, a.rows() * b.cols(),
+                                  _backend->lastTiming()});
+  }
+
+  return individual_results;
+}
+
+std::vector<TestResult> GF2TestFramework::testGPUSimdGroup(const GF2Matrix &a,
+                                                           const GF2Matrix &b,
+                                                           int iterations) {
+  if (!hasKernel(GF2Kernel::SimdGroup)) {
+    return std::vector<TestResult>{
+        {"GPU-SimdGroup", 0.0, false, 0.0, a.rows() * b.cols(), {}}};
+  }
+
+  GF2Matrix result(a.rows(), b.cols());
+
+  // Warm up
+  GF2Matrix a_warm = generateRandomMatrix(a.rows(), a.cols());
+  GF2Matrix b_warm = generateRandomMatrix(b.rows(), b.cols());
+  for (int w = 0; w < _warmup; ++w) {
+    _backend->multiply(GF2Kernel::SimdGroup, a_warm, b_warm, result);
+  }
+
+  std::vector<TestResult> individual_results;
+
+  OperandPipeline operands(a, b, iterations, _backgroundInputs);
+  for (int i = 0; i < iterations; i++) {
+    auto [a_new, b_new] = operands.next();
+
+    beginRegion();
+    auto start = std::chrono::high_resolution_clock::now();
+    _backend->multiply(GF2Kernel::SimdGroup, a_new, b_new, result);
+    auto end = std::chrono::high_resolution_clock::now();
+    endRegion();
 
-    if (config.run_gpu_m4r && _gpu) {
-      auto results = testGPUM4R(a, b, config.iterations);
-      allResults.insert(allResults.end(), results.begin(), results.end());
-    }
+    std::chrono::duration<double, std::milli> duration = end - start;
+    bool correct = verified(a_new, b_new, result);
+    double throughput =
+        calculateThroughput(a.rows(), a.cols(), b.cols(), duration.count());
 
-    std::cout << "\n";
+    individual_results.push_back({"GPU-SimdGroup", duration.count(),
+                                  correct,
+                                  throughput, a.rows() * b.cols(),
+                                  _backend->lastTiming()});
   }
 
-  return allResults;
+  return individual_results;
 }
 
-std::vector<TestResult> GF2TestFramework::testSerial(const GF2Matrix &a,
-                                                     const GF2Matrix &b,
-                                                     int iterations,
-                                                     bool debug_mode) {
-  if (a.cols() != b.rows()) {
-    throw std::runtime_error(
-        "Matrix dimensions incompatible for multiplication");
+bool GF2TestFramework::withinBudget(GF2Engine::Method method,
+                                    const GF2Matrix &a, const GF2Matrix &b,
+                                    const TestConfig &config) {
+  if (config.max_method_ms <= 0.0) {
+    return true;
+  }
+  double predicted = _engine->predictMs(method, a.rows(), a.cols(), b.cols());
+  if (predicted > config.max_method_ms) {
+    std::cout << "  Skipping " << GF2Engine::methodName(method) << " (about "
+              << predicted << " ms per product)\n";
+    return false;
   }
+  return true;
+}
 
-  // Pre-allocate result matrix
+std::vector<TestResult> GF2TestFramework::testEngine(const GF2Matrix &a,
+                                                     const GF2Matrix &b,
+                                                     int iterations) {
+  GF2Engine::Method method = _engine->choose(a.rows(), a.cols(), b.cols());
   GF2Matrix result(a.rows(), b.cols());
 
-  // Warm up with one multiplication
+  // Warm up
   GF2Matrix a_warm = generateRandomMatrix(a.rows(), a.cols());
   GF2Matrix b_warm = generateRandomMatrix(b.rows(), b.cols());
-  result = a_warm.multiplySerial(b_warm);
+  for (int w = 0; w < _warmup; ++w) {
+    _engine->multiply(a_warm, b_warm, result);
+  }
 
   std::vector<TestResult> individual_results;
 
+  OperandPipeline operands(a, b, iterations, _backgroundInputs);
   for (int i = 0; i < iterations; i++) {
-    // Generate new random matrices for each iteration
-    GF2Matrix a_new = generateRandomMatrix(a.rows(), a.cols());
-    GF2Matrix b_new = generateRandomMatrix(b.rows(), b.cols());
+    auto [a_new, b_new] = operands.next();
 
+    beginRegion();
     auto start = std::chrono::high_resolution_clock::now();
-    result = a_new.multiplySerial(b_new);
+    _engine->multiply(a_new, b_new, result);
     auto end = std::chrono::high_resolution_clock::now();
+    endRegion();
 
     std::chrono::duration<double, std::milli> duration = end - start;
+    bool correct = verified(a_new, b_new, result);
     double throughput =
         calculateThroughput(a.rows(), a.cols(), b.cols(), duration.count());
 
-    if (debug_mode) {
-      std::cout << "  Serial multiplication " << (i + 1) << "/" << iterations
-                << " completed: " << a.rows() << "x" << a.cols() << " * "
-                << b.rows() << "x" << b.cols() << " in " << duration.count()
-                << " ms"
-                << " and " << throughput << " GB/s"
-                << "\n";
+    individual_results.push_back({"Engine", duration.count(), correct,
+                                  throughput, a.rows() * b.cols(),
+                                  {}});
+    TestResult &row = individual_results.back();
+    row.kernel = GF2Engine::methodName(method);
+    if (method >= GF2Engine::Method::GPUBaseline && _backend) {
+      row.backend = _backend->backendName();
     }
-
-    individual_results.push_back(
-        {"Serial", duration.count(), true, throughput, a.rows() * b.cols()});
   }
+
   return individual_results;
 }
 
-std::vector<TestResult> GF2TestFramework::testSIMD(const GF2Matrix &a,
-                                                   const GF2Matrix &b,
-                                                   int iterations,
-                                                   bool debug_mode) {
-  if (a.cols() != b.rows()) {
-    throw std::runtime_error(
-        "Matrix dimensions incompatible for multiplication");
+#ifdef GF2_HAVE_METAL
+// --- Metal-only paths ---
+
+// Device-resident operands: generated on the GPU (GF2GPU::random), multiplied
+// and downloaded through GF2GPUMatrix handles, the work encoded into the
+// pending command buffer. The time includes the generation, not an upload.
+std::vector<TestResult> GF2TestFramework::testGPUResident(const GF2Matrix &a,
+                                                          const GF2Matrix &b,
+                                                          int iterations) {
+  if (!_gpu) {
+    return std::vector<TestResult>{
+        {"GPU-Resident", 0.0, false, 0.0, a.rows() * b.cols(), {}}};
   }
 
-  // Pre-allocate result matrix
   GF2Matrix result(a.rows(), b.cols());
 
-  // Warm up with one multiplication
-  GF2Matrix a_warm = generateRandomMatrix(a.rows(), a.cols());
-  GF2Matrix b_warm = generateRandomMatrix(b.rows(), b.cols());
-  result = a_warm.multiplySIMD(b_warm);
+  // Warm up
+  const uint64_t a_warm = next_operand_seed(), b_warm = next_operand_seed();
+  for (int w = 0; w < _warmup; ++w) {
+    _gpu->download(_gpu->multiply(_gpu->random(a.rows(), a.cols(), a_warm),
+                                  _gpu->random(b.rows(), b.cols(), b_warm)),
+                   result);
+  }
 
   std::vector<TestResult> individual_results;
 
+  // The operands are generated on the GPU, from seeds drawn in the order
+  // of the other tests' operands, and on the CPU only for the check
   for (int i = 0; i < iterations; i++) {
-    // Generate new random matrices for each iteration
-    GF2Matrix a_new = generateRandomMatrix(a.rows(), a.cols());
-    GF2Matrix b_new = generateRandomMatrix(b.rows(), b.cols());
+    const uint64_t a_seed = next_operand_seed(), b_seed = next_operand_seed();
 
+    beginRegion();
     auto start = std::chrono::high_resolution_clock::now();
-    result = a_new.multiplySIMD(b_new);
+    GF2GPUMatrix a_gpu = _gpu->random(a.rows(), a.cols(), a_seed);
+    GF2GPUMatrix b_gpu = _gpu->random(b.rows(), b.cols(), b_seed);
+    _gpu->download(_gpu->multiply(a_gpu, b_gpu), result);
     auto end = std::chrono::high_resolution_clock::now();
+    endRegion();
 
     std::chrono::duration<double, std::milli> duration = end - start;
+    GF2Matrix a_new(a.rows(), a.cols()), b_new(b.rows(), b.cols());
+    a_new.randomFill(a_seed);
+    b_new.randomFill(b_seed);
+    bool correct = verified(a_new, b_new, result);
     double throughput =
         calculateThroughput(a.rows(), a.cols(), b.cols(), duration.count());
 
-    if (debug_mode) {
-      std::cout << "  SIMD multiplication " << (i + 1) << "/" << iterations
-                << " completed: " << a.rows() << "x" << a.cols() << " * "
-                << b.rows() << "x" << b.cols() << " in " << duration.count()
-                << " ms"
-                << " and " << throughput << " GB/s"
-                << "\n";
-    }
-
-    individual_results.push_back(
-        {"SIMD", duration.count(), true, throughput, a.rows() * b.cols()});
+    individual_results.push_back({"GPU-Resident", duration.count(), correct,
+                                  throughput, a.rows() * b.cols(),
+                                  _gpu->lastTiming()});
   }
 
   return individual_results;
 }
 
-// std::vector<TestResult> GF2TestFramework::testSIMD(const GF2Matrix& a, const
-// GF2Matrix& b, int iterations, bool debug_mode) {
-//     if (a.cols() != b.rows()) {
-//         throw std::runtime_error("Matrix dimensions incompatible for
-//         multiplication");
-//     }
-//
-//     // Pre-allocate result matrix
-//     GF2Matrix result(a.rows(), b.cols());
-//
-//     // Warm up with one multiplication
-//     GF2Matrix a_warm = generateRandomMatrix(a.rows(), a.cols());
-//     GF2Matrix b_warm = generateRandomMatrix(b.rows(), b.cols());
-//     result = a_warm.multiplySIMD(b_warm);
-//
-//     std::vector<TestResult> individual_results;
-//
-//     for (int i = 0; i < iterations; i++) {
-//         // Generate new random matrices for each iteration
-//         GF2Matrix a_new = generateRandomMatrix(a.rows(), a.cols());
-//         GF2Matrix b_new = generateRandomMatrix(b.rows(), b.cols());
-//
-//         auto start = std::chrono::high_resolution_clock::now();
-//         result = a_new.multiplySIMD(b_new);
-//         auto end = std::chrono::high_resolution_clock::now();
-//
-//         if (debug_mode) {
-//             std::cout << "  SIMD multiplication " << (i + 1) << "/" <<
-//             iterations
-//                       << " completed: " << a.rows() << "x" << a.cols() << " *
-//                       "
-//                       << b.rows() << "x" << b.cols() << "\n";
-//         }
-//
-//         std::chrono::duration<double, std::milli> duration = end - start;
-//         double throughput = calculateThroughput(a.rows(), a.cols(), b.cols(),
-//         duration.count());
-//
-//         individual_results.push_back({
-//             "SIMD",
-//             duration.count(),
-//             true,
-//             throughput,
-//             a.rows() * b.cols()
-//         });
-//     }
-//
-//     return individual_results;
-// }
-
-std::vector<TestResult> GF2TestFramework::testGPU(const GF2Matrix &a,
-                                                  const GF2Matrix &b,
-                                                  int iterations,
-                                                  bool debug_mode) {
+std::vector<TestResult> GF2TestFramework::testGPUPlan(const GF2Matrix &a,
+                                                      const GF2Matrix &b,
+                                                      int iterations) {
   if (!_gpu) {
     return std::vector<TestResult>{
-        {"GPU", 0.0, false, 0.0, a.rows() * b.cols()}};
+        {"GPU-Plan", 0.0, false, 0.0, a.rows() * b.cols(), {}}};
   }
 
-  // Pre-allocate result matrix
+  std::unique_ptr<GF2GPUPlan> plan = _gpu->recordPlan(
+      GF2GPU::Kernel::Vectorized, a.rows(), a.cols(), b.cols());
   GF2Matrix result(a.rows(), b.cols());
 
-  // Warm up with one multiplication
+  // Warm up
   GF2Matrix a_warm = generateRandomMatrix(a.rows(), a.cols());
   GF2Matrix b_warm = generateRandomMatrix(b.rows(), b.cols());
-  _gpu->multiplyGPU(a_warm, b_warm, result);
+  for (int w = 0; w < _warmup; ++w) {
+    _gpu->runPlan(*plan, a_warm, b_warm, result);
+  }
 
   std::vector<TestResult> individual_results;
 
+  OperandPipeline operands(a, b, iterations, _backgroundInputs);
   for (int i = 0; i < iterations; i++) {
-    // Generate new random matrices for each iteration
-    GF2Matrix a_new = generateRandomMatrix(a.rows(), a.cols());
-    GF2Matrix b_new = generateRandomMatrix(b.rows(), b.cols());
+    auto [a_new, b_new] = operands.next();
 
+    beginRegion();
     auto start = std::chrono::high_resolution_clock::now();
-    _gpu->multiplyGPU(a_new, b_new, result);
+    _gpu->runPlan(*plan, a_new, b_new, result);
     auto end = std::chrono::high_resolution_clock::now();
+    endRegion();
 
     std::chrono::duration<double, std::milli> duration = end - start;
+    bool correct = verified(a_new, b_new, result);
     double throughput =
         calculateThroughput(a.rows(), a.cols(), b.cols(), duration.count());
 
-    if (debug_mode) {
-      std::cout << "  GPU multiplication " << (i + 1) << "/" << iterations
-                << " completed: " << a.rows() << "x" << a.cols() << " * "
-                << b.rows() << "x" << b.cols() << " in " << duration.count()
-                << " ms"
-                << " and " << throughput << " GB/s"
-                << "\n";
-    }
-
-    individual_results.push_back(
-        {"GPU", duration.count(), true, throughput, a.rows() * b.cols()});
+    individual_results.push_back({"GPU-Plan", duration.count(), correct,
+                                  throughput, a.rows() * b.cols(),
+                                  _gpu->lastTiming()});
   }
 
   return individual_results;
 }
 
-std::vector<TestResult> GF2TestFramework::testGPU_transposed(const GF2Matrix &a,
-                                                             const GF2Matrix &b,
-                                                             int iterations,
-                                                             bool debug_mode) {
+std::vector<TestResult> GF2TestFramework::testGPUOutOfCore(const GF2Matrix &a,
+                                                           const GF2Matrix &b,
+                                                           int iterations) {
   if (!_gpu) {
     return std::vector<TestResult>{
-        {"GPU (Transposed)", 0.0, false, 0.0, a.rows() * b.cols()}};
+        {"GPU-OutOfCore", 0.0, false, 0.0, a.rows() * b.cols(), {}}};
   }
 
+  const size_t block_bytes = std::max<size_t>(
+      64 * 1024, a.rows() * a.row_stride() * sizeof(uint64_t) / 4);
   GF2Matrix result(a.rows(), b.cols());
 
   // Warm up
   GF2Matrix a_warm = generateRandomMatrix(a.rows(), a.cols());
   GF2Matrix b_warm = generateRandomMatrix(b.rows(), b.cols());
-  _gpu->multiplyGPU_transposed(a_warm, b_warm, result);
+  for (int w = 0; w < _warmup; ++w) {
+    _gpu->multiplyGPUOutOfCore(GF2GPU::Kernel::Vectorized, a_warm, b_warm,
+                               result, block_bytes);
+  }
 
   std::vector<TestResult> individual_results;
 
+  OperandPipeline operands(a, b, iterations, _backgroundInputs);
   for (int i = 0; i < iterations; i++) {
-    GF2Matrix a_new = generateRandomMatrix(a.rows(), a.cols());
-    GF2Matrix b_new = generateRandomMatrix(b.rows(), b.cols());
+    auto [a_new, b_new] = operands.next();
 
+    beginRegion();
     auto start = std::chrono::high_resolution_clock::now();
-    _gpu->multiplyGPU_transposed(a_new, b_new, result); // Call the new method
+    _gpu->multiplyGPUOutOfCore(GF2GPU::Kernel::Vectorized, a_new, b_new, result,
+                               block_bytes);
     auto end = std::chrono::high_resolution_clock::now();
+    endRegion();
 
     std::chrono::duration<double, std::milli> duration = end - start;
+    bool correct = verified(a_new, b_new, result);
     double throughput =
         calculateThroughput(a.rows(), a.cols(), b.cols(), duration.count());
 
-    if (debug_mode) {
-      std::cout << "  GPU (Transposed) multiplication " << (i + 1) << "/"
-                << iterations << " completed: " << a.rows() << "x" << a.cols()
-                << " * " << b.rows() << "x" << b.cols() << " in "
-                << duration.count() << " ms"
-                << " and " << throughput << " GOps/s"
-                << "\n";
-    }
-
-    individual_results.push_back({"GPU (Transposed)", // Method name for reports
-                                  duration.count(),
-                                  true, // Assuming correctness for benchmark
-                                  throughput, a.rows() * b.cols()});
+    individual_results.push_back({"GPU-OutOfCore", duration.count(), correct,
+                                  throughput, a.rows() * b.cols(),
+                                  _gpu->lastTiming()});
   }
 
   return individual_results;
 }
 
-std::vector<TestResult> GF2TestFramework::testGPUTiled(const GF2Matrix &a,
-                                                       const GF2Matrix &b,
-                                                       int iterations,
-                                                       bool debug_mode) {
+std::vector<TestResult> GF2TestFramework::testGPUStrassen(const GF2Matrix &a,
+                                                          const GF2Matrix &b,
+                                                          int iterations) {
   if (!_gpu) {
     return std::vector<TestResult>{
-        {"GPU-Tiled", 0.0, false, 0.0, a.rows() * b.cols()}};
+        {"GPU-Strassen", 0.0, false, 0.0, a.rows() * b.cols(), {}}};
   }
 
+  // Half the smallest dimension, so every size takes one halving
+  const size_t cutoff =
+      std::max<size_t>(64, std::min({a.rows(), a.cols(), b.cols()}) / 2);
   GF2Matrix result(a.rows(), b.cols());
 
   // Warm up
   GF2Matrix a_warm = generateRandomMatrix(a.rows(), a.cols());
   GF2Matrix b_warm = generateRandomMatrix(b.rows(), b.cols());
-  _gpu->multiplyGPUTiled(a_warm, b_warm, result);
+  for (int w = 0; w < _warmup; ++w) {
+    _gpu->multiplyGPUStrassen(a_warm, b_warm, result, GF2GPU::Kernel::M4R,
+                              cutoff);
+  }
 
   std::vector<TestResult> individual_results;
 
+  OperandPipeline operands(a, b, iterations, _backgroundInputs);
   for (int i = 0; i < iterations; i++) {
-    GF2Matrix a_new = generateRandomMatrix(a.rows(), a.cols());
-    GF2Matrix b_new = generateRandomMatrix(b.rows(), b.cols());
+    auto [a_new, b_new] = operands.next();
 
+    beginRegion();
     auto start = std::chrono::high_resolution_clock::now();
-    _gpu->multiplyGPUTiled(a_new, b_new, result); // Call the new tiled method
+    _gpu->multiplyGPUStrassen(a_new, b_new, result, GF2GPU::Kernel::M4R,
+                              cutoff);
     auto end = std::chrono::high_resolution_clock::now();
+    endRegion();
 
     std::chrono::duration<double, std::milli> duration = end - start;
+    bool correct = verified(a_new, b_new, result);
     double throughput =
         calculateThroughput(a.rows(), a.cols(), b.cols(), duration.count());
 
-    if (debug_mode) {
-      std::cout << "  GPU-Tiled multiplication " << (i + 1) << "/" << iterations
-                << " completed: " << a.rows() << "x" << a.cols() << " * "
-                << b.rows() << "x" << b.cols() << " in " << duration.count()
-                << " ms"
-                << " and " << throughput << " GB/s"
-                << "\n";
-    }
-
-    individual_results.push_back(
-        {"GPU-Tiled", // Set the correct method name for reporting
-         duration.count(),
-         true, // Assuming correctness for benchmark
-         throughput, a.rows() * b.cols()});
+    individual_results.push_back({"GPU-Strassen", duration.count(), correct,
+                                  throughput, a.rows() * b.cols(),
+                                  _gpu->lastTiming()});
   }
 
   return individual_results;
 }
 
-std::vector<TestResult> GF2TestFramework::testGPUVectorized(const GF2Matrix &a,
-                                                            const GF2Matrix &b,
-                                                            int iterations,
-                                                            bool debug_mode) {
+std::vector<TestResult> GF2TestFramework::testHybrid(const GF2Matrix &a,
+                                                     const GF2Matrix &b,
+                                                     int iterations,
+                                                     int num_threads) {
   if (!_gpu) {
     return std::vector<TestResult>{
-        {"GPU-Vectorized", 0.0, false, 0.0, a.rows() * b.cols()}};
+        {"Hybrid", 0.0, false, 0.0, a.rows() * b.cols(), {}}};
   }
 
   GF2Matrix result(a.rows(), b.cols());
 
-  // Warm up
+  // Warm up; this also gives the row split a first measurement
   GF2Matrix a_warm = generateRandomMatrix(a.rows(), a.cols());
   GF2Matrix b_warm = generateRandomMatrix(b.rows(), b.cols());
-  _gpu->multiplyGPUVectorized(a_warm, b_warm, result);
+  for (int w = 0; w < _warmup; ++w) {
+    _gpu->multiplyHybrid(a_warm, b_warm, result, GF2GPU::Kernel::Vectorized,
+                         num_threads);
+  }
 
   std::vector<TestResult> individual_results;
 
+  OperandPipeline operands(a, b, iterations, _backgroundInputs);
   for (int i = 0; i < iterations; i++) {
-    GF2Matrix a_new = generateRandomMatrix(a.rows(), a.cols());
-    GF2Matrix b_new = generateRandomMatrix(b.rows(), b.cols());
+    auto [a_new, b_new] = operands.next();
 
+    beginRegion();
     auto start = std::chrono::high_resolution_clock::now();
-    _gpu->multiplyGPUVectorized(a_new, b_new,
-                                result); // Call the new vectorized method
+    _gpu->multiplyHybrid(a_new, b_new, result, GF2GPU::Kernel::Vectorized,
+                         num_threads);
     auto end = std::chrono::high_resolution_clock::now();
+    endRegion();
 
     std::chrono::duration<double, std::milli> duration = end - start;
+    bool correct = verified(a_new, b_new, result);
     double throughput =
         calculateThroughput(a.rows(), a.cols(), b.cols(), duration.count());
 
-    if (debug_mode) {
-      std::cout << "  GPU-Vectorized multiplication " << (i + 1) << "/"
-                << iterations << " completed: " << a.rows() << "x" << a.cols()
-                << " * " << b.rows() << "x" << b.cols() << " in "
-                << duration.count() << " ms"
-                << " and " << throughput << " GOps/s"
-                << "\n";
-    }
-
-    individual_results.push_back({"GPU-Vectorized", // Method name for reports
-                                  duration.count(),
-                                  true, // Assuming correctness for benchmark
-                                  throughput, a.rows() * b.cols()});
+    individual_results.push_back({"Hybrid", duration.count(), correct,
+                                  throughput, a.rows() * b.cols(),
+                                  _gpu->lastTiming()});
   }
 
   return individual_results;
 }
+#endif // GF2_HAVE_METAL
 
 std::vector<TestResult> GF2TestFramework::testGPUM4R(const GF2Matrix &a,
                                                      const GF2Matrix &b,
-                                                     int iterations,
-                                                     bool debug_mode) {
-  if (!_gpu) {
+                                                     int iterations) {
+  if (!hasKernel(GF2Kernel::M4R)) {
     return std::vector<TestResult>{
-        {"GPU (M4R)", 0.0, false, 0.0, a.rows() * b.cols()}};
+        {"GPU (M4R)", 0.0, false, 0.0, a.rows() * b.cols(), {}}};
   }
 
   GF2Matrix result(a.rows(), b.cols());
@@ -441,35 +1552,32 @@ std::vector<TestResult> GF2TestFramework::testGPUM4R(const GF2Matrix &a,
   // Warm up
   GF2Matrix a_warm = generateRandomMatrix(a.rows(), a.cols());
   GF2Matrix b_warm = generateRandomMatrix(b.rows(), b.cols());
-  _gpu->multiplyGPUM4R(a_warm, b_warm, result);
+  for (int w = 0; w < _warmup; ++w) {
+    _backend->multiply(GF2Kernel::M4R, a_warm, b_warm, result);
+  }
 
   std::vector<TestResult> individual_results;
 
+  OperandPipeline operands(a, b, iterations, _backgroundInputs);
   for (int i = 0; i < iterations; i++) {
-    GF2Matrix a_new = generateRandomMatrix(a.rows(), a.cols());
-    GF2Matrix b_new = generateRandomMatrix(b.rows(), b.cols());
+    auto [a_new, b_new] = operands.next();
 
+    beginRegion();
     auto start = std::chrono::high_resolution_clock::now();
-    _gpu->multiplyGPUM4R(a_new, b_new, result); // Call the new M4R method
+    _backend->multiply(GF2Kernel::M4R, a_new, b_new, result);
     auto end = std::chrono::high_resolution_clock::now();
+    endRegion();
 
     std::chrono::duration<double, std::milli> duration = end - start;
+    bool correct = verified(a_new, b_new, result);
     double throughput =
         calculateThroughput(a.rows(), a.cols(), b.cols(), duration.count());
 
-    if (debug_mode) {
-      std::cout << "  GPU (M4R) multiplication " << (i + 1) << "/" << iterations
-                << " completed: " << a.rows() << "x" << a.cols() << " * "
-                << b.rows() << "x" << b.cols() << " in " << duration.count()
-                << " ms"
-                << " and " << throughput << " GOps/s"
-                << "\n";
-    }
-
     individual_results.push_back({"GPU (M4R)", // Method name for reports
                                   duration.count(),
-                                  true, // Assuming correctness for benchmark
-                                  throughput, a.rows() * b.cols()});
+                                  correct,
+                                  throughput, a.rows() * b.cols(),
+                                  _backend->lastTiming()});
   }
 
   return individual_results;
@@ -486,22 +1594,237 @@ double GF2TestFramework::calculateThroughput(size_t a_rows, size_t a_cols,
   return gops;
 }
 
+TimingStats GF2TestFramework::timingStats(std::vector<double> samples_ms,
+                                          double confidence,
+                                          bool reject_outliers) {
+  TimingStats stats;
+  stats.samples = samples_ms.size();
+  if (samples_ms.empty()) {
+    return stats;
+  }
+  std::sort(samples_ms.begin(), samples_ms.end());
+
+  // Linear interpolation between the closest ranks
+  auto quantile = [](const std::vector<double> &sorted, double q) {
+    double pos = q * double(sorted.size() - 1);
+    size_t lo = size_t(pos);
+    size_t hi = std::min(lo + 1, sorted.size() - 1);
+    return sorted[lo] + (sorted[hi] - sorted[lo]) * (pos - double(lo));
+  };
+  stats.min_ms = samples_ms.front();
+  stats.median_ms = quantile(samples_ms, 0.5);
+  stats.p90_ms = quantile(samples_ms, 0.9);
+  stats.p99_ms = quantile(samples_ms, 0.99);
+
+  // Timing noise (preemption, frequency changes) only ever adds time, so
+  // only the upper fence applies
+  std::vector<double> kept = samples_ms;
+  if (reject_outliers && samples_ms.size() >= 4) {
+    double q1 = quantile(samples_ms, 0.25);
+    double q3 = quantile(samples_ms, 0.75);
+    double fence = q3 + 3.0 * (q3 - q1);
+    kept.erase(std::upper_bound(kept.begin(), kept.end(), fence), kept.end());
+    stats.outliers = samples_ms.size() - kept.size();
+  }
+
+  double sum = 0.0;
+  for (double t : kept) {
+    sum += t;
+  }
+  stats.mean_ms = sum / double(kept.size());
+  double squares = 0.0;
+  for (double t : kept) {
+    squares += (t - stats.mean_ms) * (t - stats.mean_ms);
+  }
+  stats.stddev_ms =
+      kept.size() > 1 ? std::sqrt(squares / double(kept.size() - 1)) : 0.0;
+
+  // Percentile bootstrap of the median. Seeded, so the same samples give
+  // the same interval.
+  const int RESAMPLES = 1000;
+  std::mt19937_64 rng(kept.size());
+  std::uniform_int_distribution<size_t> pick(0, kept.size() - 1);
+  std::vector<double> medians(RESAMPLES);
+  std::vector<double> resample(kept.size());
+  for (int r = 0; r < RESAMPLES; ++r) {
+    for (double &t : resample) {
+      t = kept[pick(rng)];
+    }
+    std::sort(resample.begin(), resample.end());
+    medians[r] = quantile(resample, 0.5);
+  }
+  std::sort(medians.begin(), medians.end());
+  double alpha = (1.0 - confidence) / 2.0;
+  stats.ci_low_ms = quantile(medians, alpha);
+  stats.ci_high_ms = quantile(medians, 1.0 - alpha);
+  return stats;
+}
+
+std::vector<TestSummary>
+GF2TestFramework::summarize(const std::vector<TestResult> &results) const {
+  // In the order the methods first appear
+  std::vector<TestSummary> summaries;
+  using Key = std::tuple<std::string, size_t, size_t, size_t, size_t>;
+  std::map<Key, std::vector<const TestResult *>> groups;
+  for (const auto &result : results) {
+    Key key(result.method, result.matrix_size, result.m, result.k, result.n);
+    if (!groups.count(key)) {
+      summaries.push_back({result.method, result.matrix_size, result.m,
+                           result.k, result.n, true, {}, 0.0});
+      TestSummary &summary = summaries.back();
+      summary.backend = result.backend;
+      summary.kernel = result.kernel;
+      summary.threads = result.threads;
+      summary.bytes_read = result.bytes_read;
+      summary.bytes_written = result.bytes_written;
+      summary.word_ops = result.word_ops;
+    }
+    groups[key].push_back(&result);
+  }
+
+  for (TestSummary &summary : summaries) {
+    std::vector<double> ms, ipc, l1d, llc, host, rss, gpu, joules, per_watt;
+    double operations = 0.0; // per product, from the rows' own throughput
+    for (const TestResult *r :
+         groups[Key(summary.method, summary.matrix_size, summary.m, summary.k,
+                    summary.n)]) {
+      summary.correct = summary.correct && r->correct;
+      host.push_back(r->memory.host_bytes);
+      rss.push_back(r->memory.rss_bytes);
+      gpu.push_back(r->memory.gpu_bytes);
+      if (r->correct) {
+        ms.push_back(r->duration_ms);
+        operations = r->throughput_gbps * 1e9 * r->duration_ms / 1000.0;
+        ipc.push_back(r->counters.ipc());
+        l1d.push_back(
+            GF2PerfSample::perWord(r->counters.l1d_misses, r->outputWords()));
+        llc.push_back(
+            GF2PerfSample::perWord(r->counters.llc_misses, r->outputWords()));
+        joules.push_back(r->energy.total());
+        per_watt.push_back(r->gopsPerWatt());
+      }
+    }
+    summary.ipc = median_of_valid(ipc);
+    summary.l1d_misses_per_word = median_of_valid(l1d);
+    summary.llc_misses_per_word = median_of_valid(llc);
+    summary.host_peak_bytes = max_of_valid(host);
+    summary.rss_peak_bytes = max_of_valid(rss);
+    summary.gpu_peak_bytes = max_of_valid(gpu);
+    summary.energy_j = median_of_valid(joules);
+    summary.gops_per_watt = median_of_valid(per_watt);
+    summary.stats = timingStats(ms, _confidence, _rejectOutliers);
+    if (summary.stats.median_ms > 0.0) {
+      summary.throughput_gbps =
+          operations / (summary.stats.median_ms / 1000.0) / 1e9;
+    }
+  }
+  return summaries;
+}
+
 void GF2TestFramework::printResults(const std::vector<TestResult> &results) {
   std::cout << "\n=== Test Results Summary ===\n";
-  std::cout << std::left << std::setw(10) << "Method" << std::setw(15)
-            << "Time (ms)" << std::setw(15) << "Throughput" << std::setw(10)
-            << "Correct" << std::setw(15) << "Matrix Size" << "\n";
-  std::cout << std::string(65, '-') << "\n";
+  std::cout << std::left << std::setw(22) << "Method" << std::setw(12)
+            << "Size" << std::right << std::setw(6) << "N" << std::setw(11)
+            << "Min" << std::setw(11) << "Median" << std::setw(11) << "p90"
+            << std::setw(11) << "p99" << std::setw(11) << "Stddev"
+            << std::setw(25) << "Median CI" << std::setw(12) << "GOps/s"
+            << "  Correct\n";
+  std::cout << std::string(141, '-') << "\n";
+
+  for (const TestSummary &s : summarize(results)) {
+    const TimingStats &t = s.stats;
+    std::ostringstream ci;
+    ci << std::fixed << std::setprecision(3) << "[" << t.ci_low_ms << ", "
+       << t.ci_high_ms << "]";
+    std::cout << std::left << std::setw(22) << s.method << std::setw(12)
+              << s.matrix_size << std::right << std::setw(6) << t.samples
+              << std::fixed << std::setprecision(3) << std::setw(11)
+              << t.min_ms << std::setw(11) << t.median_ms << std::setw(11)
+              << t.p90_ms << std::setw(11) << t.p99_ms << std::setw(11)
+              << t.stddev_ms << std::setw(25) << ci.str() << std::setw(12)
+              << std::setprecision(2) << s.throughput_gbps << "  "
+              << (s.correct ? "✓" : "✗");
+    if (t.outliers > 0) {
+      std::cout << " (" << t.outliers << " outliers)";
+    }
+    std::cout << "\n";
+  }
 
-  for (const auto &result : results) {
-    std::cout << std::left << std::setw(10) << result.method << std::setw(15)
-              << std::fixed << std::setprecision(2) << result.duration_ms
-              << std::setw(15) << std::setprecision(2) << result.throughput_gbps
-              << std::setw(10) << (result.correct ? "✓" : "✗") << std::setw(15)
-              << result.matrix_size << "\n";
+  std::cout << std::defaultfloat << "Times in ms; the CI is the "
+            << _confidence * 100.0 << "% bootstrap interval of the median.\n"
+            << std::endl;
+
+  const std::vector<TestSummary> summaries = summarize(results);
+  if (std::any_of(summaries.begin(), summaries.end(), [](const TestSummary &s) {
+        return s.host_peak_bytes >= 0.0;
+      })) {
+    std::cout << "=== Peak Memory (MiB, most over the iterations) ===\n";
+    std::cout << std::left << std::setw(22) << "Method" << std::setw(12)
+              << "Size" << std::right << std::setw(14) << "Allocator"
+              << std::setw(14) << "RSS" << std::setw(14) << "GPU" << "\n";
+    std::cout << std::string(76, '-') << "\n";
+    for (const TestSummary &s : summaries) {
+      if (s.host_peak_bytes < 0.0) {
+        continue;
+      }
+      std::cout << std::left << std::setw(22) << s.method << std::setw(12)
+                << s.matrix_size << std::right << std::setw(14)
+                << mib_field(s.host_peak_bytes) << std::setw(14)
+                << mib_field(s.rss_peak_bytes) << std::setw(14)
+                << mib_field(s.gpu_peak_bytes) << "\n";
+    }
+    std::cout << "Host columns are above what was allocated before the "
+                 "region; GPU is the backend's total.\n"
+              << std::endl;
+  }
+
+  if (std::any_of(summaries.begin(), summaries.end(),
+                  [](const TestSummary &s) { return s.energy_j >= 0.0; })) {
+    std::cout << "=== Energy (medians) ===\n";
+    std::cout << std::left << std::setw(22) << "Method" << std::setw(12)
+              << "Size" << std::right << std::setw(14) << "Energy (mJ)"
+              << std::setw(12) << "Power (W)" << std::setw(12) << "GOps/W"
+              << "\n";
+    std::cout << std::string(72, '-') << "\n";
+    for (const TestSummary &s : summaries) {
+      if (s.energy_j < 0.0) {
+        continue;
+      }
+      const double watts = s.stats.median_ms > 0.0
+                               ? s.energy_j / (s.stats.median_ms / 1000.0)
+                               : 0.0;
+      std::cout << std::left << std::setw(22) << s.method << std::setw(12)
+                << s.matrix_size << std::right << std::fixed
+                << std::setprecision(3) << std::setw(14) << s.energy_j * 1e3
+                << std::setprecision(2) << std::setw(12) << watts
+                << std::setw(12) << counter_field(s.gops_per_watt) << "\n";
+    }
+    std::cout << std::defaultfloat
+              << "Package (or CPU + GPU + DRAM) energy, idle power included.\n"
+              << std::endl;
   }
 
-  std::cout << std::endl;
+  if (std::none_of(summaries.begin(), summaries.end(),
+                   [](const TestSummary &s) { return s.ipc >= 0.0; })) {
+    return;
+  }
+  std::cout << "=== Hardware Counters (medians) ===\n";
+  std::cout << std::left << std::setw(22) << "Method" << std::setw(12)
+            << "Size" << std::right << std::setw(8) << "IPC" << std::setw(16)
+            << "L1D miss/word" << std::setw(16) << "LLC miss/word" << "\n";
+  std::cout << std::string(74, '-') << "\n";
+  for (const TestSummary &s : summaries) {
+    if (s.ipc < 0.0) {
+      continue;
+    }
+    std::cout << std::left << std::setw(22) << s.method << std::setw(12)
+              << s.matrix_size << std::right << std::fixed
+              << std::setprecision(2) << std::setw(8) << s.ipc
+              << std::setprecision(3) << std::setw(16)
+              << counter_field(s.l1d_misses_per_word) << std::setw(16)
+              << counter_field(s.llc_misses_per_word) << "\n";
+  }
+  std::cout << std::defaultfloat << std::endl;
 }
 
 void GF2TestFramework::saveResults(const std::vector<TestResult> &results,
@@ -512,19 +1835,147 @@ void GF2TestFramework::saveResults(const std::vector<TestResult> &results,
     return;
   }
 
-  file << "Method,Duration_ms,Throughput_GOPS,Correct,Matrix_Size\n";
+  file << "Method,Duration_ms,Throughput_GOPS,Correct,Matrix_Size,"
+          "Host_ms,Upload_ms,GPU_ms,Readback_ms,M,K,N,Bytes_Moved,Backend,"
+          "Kernel,Device,Threads,Build,Timestamp,Cycles,Instructions,"
+          "L1D_Misses,LLC_Misses,Branch_Misses,IPC,L1D_Misses_Per_Word,"
+          "LLC_Misses_Per_Word,Bytes_Read,Bytes_Written,Word_Ops,"
+          "Achieved_GBps,Host_Peak_Bytes,RSS_Peak_Bytes,GPU_Peak_Bytes,"
+          "Package_J,CPU_J,GPU_J,DRAM_J,GOPS_Per_Watt\n";
   for (const auto &result : results) {
-    file << result.method << "," << result.duration_ms << ","
+    const GF2GPUTiming &t = result.gpu_timing;
+    const GF2PerfSample &c = result.counters;
+    file << csv_field(result.method) << "," << result.duration_ms << ","
          << result.throughput_gbps << "," << result.correct << ","
-         << result.matrix_size << "\n";
+         << result.matrix_size << "," << t.host_ms << "," << t.upload_ms << ","
+         << t.gpu_ms << "," << t.readback_ms << "," << result.m << ","
+         << result.k << "," << result.n << "," << result.bytes_moved << ","
+         << result.backend << "," << csv_field(result.kernel) << ","
+         << csv_field(result.device) << "," << result.threads << ","
+         << csv_field(result.build) << "," << result.timestamp << ","
+         << counter_field(c.cycles) << "," << counter_field(c.instructions)
+         << "," << counter_field(c.l1d_misses) << ","
+         << counter_field(c.llc_misses) << ","
+         << counter_field(c.branch_misses) << "," << counter_field(c.ipc())
+         << ","
+         << counter_field(
+                GF2PerfSample::perWord(c.l1d_misses, result.outputWords()))
+         << ","
+         << counter_field(
+                GF2PerfSample::perWord(c.llc_misses, result.outputWords()))
+         << "," << result.bytes_read << "," << result.bytes_written << ","
+         << result.word_ops << "," << result.achievedGBps() << ","
+         << counter_field(result.memory.host_bytes) << ","
+         << counter_field(result.memory.rss_bytes) << ","
+         << counter_field(result.memory.gpu_bytes) << ","
+         << counter_field(result.energy.package_j) << ","
+         << counter_field(result.energy.cpu_j) << ","
+         << counter_field(result.energy.gpu_j) << ","
+         << counter_field(result.energy.dram_j) << ","
+         << counter_field(result.gopsPerWatt()) << "\n";
+  }
+
+  std::cout << "Results saved to: " << filename << std::endl;
+}
+
+void GF2TestFramework::saveSummary(const std::vector<TestResult> &results,
+                                   const std::string &filename) {
+  std::ofstream file(filename);
+  if (!file.is_open()) {
+    std::cerr << "Failed to open file: " << filename << std::endl;
+    return;
+  }
+
+  file << "Method,Matrix_Size,M,K,N,Samples,Outliers,Min_ms,Median_ms,"
+          "P90_ms,P99_ms,Mean_ms,Stddev_ms,CI_Low_ms,CI_High_ms,"
+          "Throughput_GOPS,Correct,IPC,L1D_Misses_Per_Word,"
+          "LLC_Misses_Per_Word,Host_Peak_Bytes,RSS_Peak_Bytes,"
+          "GPU_Peak_Bytes,Energy_J,GOPS_Per_Watt\n";
+  for (const TestSummary &s : summarize(results)) {
+    const TimingStats &t = s.stats;
+    file << csv_field(s.method) << "," << s.matrix_size << "," << s.m << ","
+         << s.k << "," << s.n << "," << t.samples << ","
+         << t.outliers << "," << t.min_ms << "," << t.median_ms << ","
+         << t.p90_ms << "," << t.p99_ms << "," << t.mean_ms << ","
+         << t.stddev_ms << "," << t.ci_low_ms << "," << t.ci_high_ms << ","
+         << s.throughput_gbps << "," << s.correct << ","
+         << counter_field(s.ipc) << "," << counter_field(s.l1d_misses_per_word)
+         << "," << counter_field(s.llc_misses_per_word) << ","
+         << counter_field(s.host_peak_bytes) << ","
+         << counter_field(s.rss_peak_bytes) << ","
+         << counter_field(s.gpu_peak_bytes) << ","
+         << counter_field(s.energy_j) << "," << counter_field(s.gops_per_watt)
+         << "\n";
+  }
+
+  std::cout << "Summary saved to: " << filename << std::endl;
+}
+
+void GF2TestFramework::saveResultsJSON(const std::vector<TestResult> &results,
+                                       const std::string &filename) {
+  std::ofstream file(filename);
+  if (!file.is_open()) {
+    std::cerr << "Failed to open file: " << filename << std::endl;
+    return;
+  }
+
+  std::string gpu = "null";
+  if (_backend) {
+    gpu = json_string(std::string(_backend->backendName()) + " " +
+                      _backend->deviceName());
+  }
+  file << "{\n  \"cpu\": " << json_string(GF2CpuInfo::get().describe())
+       << ",\n  \"cpu_kernel\": " << json_string(GF2Matrix::simdKernelName())
+       << ",\n  \"gpu\": " << gpu
+       << ",\n  \"build\": " << json_string(build_description())
+       << ",\n  \"results\": [";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const TestResult &r = results[i];
+    const GF2GPUTiming &t = r.gpu_timing;
+    const GF2PerfSample &c = r.counters;
+    file << (i ? ",\n" : "\n") << "    {\"method\": " << json_string(r.method)
+         << ", \"m\": " << r.m << ", \"k\": " << r.k << ", \"n\": " << r.n
+         << ", \"duration_ms\": " << r.duration_ms
+         << ", \"throughput_gops\": " << r.throughput_gbps
+         << ", \"correct\": " << (r.correct ? "true" : "false")
+         << ", \"bytes_moved\": " << r.bytes_moved
+         << ", \"bytes_read\": " << r.bytes_read
+         << ", \"bytes_written\": " << r.bytes_written
+         << ", \"word_ops\": " << r.word_ops
+         << ", \"achieved_gbps\": " << r.achievedGBps()
+         << ", \"backend\": " << json_string(r.backend)
+         << ", \"kernel\": " << json_string(r.kernel)
+         << ", \"device\": " << json_string(r.device)
+         << ", \"threads\": " << r.threads
+         << ", \"timestamp\": " << json_string(r.timestamp)
+         << ", \"host_ms\": " << t.host_ms
+         << ", \"upload_ms\": " << t.upload_ms << ", \"gpu_ms\": " << t.gpu_ms
+         << ", \"readback_ms\": " << t.readback_ms
+         << ", \"cycles\": " << counter_json(c.cycles)
+         << ", \"instructions\": " << counter_json(c.instructions)
+         << ", \"l1d_misses\": " << counter_json(c.l1d_misses)
+         << ", \"llc_misses\": " << counter_json(c.llc_misses)
+         << ", \"branch_misses\": " << counter_json(c.branch_misses)
+         << ", \"ipc\": " << counter_json(c.ipc()) << ", \"llc_misses_per_word\": "
+         << counter_json(
+                GF2PerfSample::perWord(c.llc_misses, r.outputWords()))
+         << ", \"host_peak_bytes\": " << counter_json(r.memory.host_bytes)
+         << ", \"rss_peak_bytes\": " << counter_json(r.memory.rss_bytes)
+         << ", \"gpu_peak_bytes\": " << counter_json(r.memory.gpu_bytes)
+         << ", \"package_j\": " << counter_json(r.energy.package_j)
+         << ", \"cpu_j\": " << counter_json(r.energy.cpu_j)
+         << ", \"gpu_j\": " << counter_json(r.energy.gpu_j)
+         << ", \"dram_j\": " << counter_json(r.energy.dram_j)
+         << ", \"gops_per_watt\": " << counter_json(r.gopsPerWatt()) << "}";
   }
+  file << "\n  ]\n}\n";
 
   std::cout << "Results saved to: " << filename << std::endl;
 }
 
 GF2Matrix GF2TestFramework::generateRandomMatrix(size_t rows, size_t cols) {
   GF2Matrix matrix(rows, cols);
-  matrix.randomFill();
+  matrix.randomFill(next_operand_seed());
   return matrix;
 }
 
@@ -536,27 +1987,181 @@ GF2Matrix GF2TestFramework::generateIdentityMatrix(size_t size) {
   return matrix;
 }
 
+namespace {
+
+// Parity of the AND of a packed row and a packed vector
+bool row_dot(const uint64_t *row, const std::vector<uint64_t> &x) {
+  uint64_t acc = 0;
+  for (size_t w = 0; w < x.size(); ++w) {
+    acc ^= row[w] & x[w];
+  }
+  return __builtin_popcountll(acc) & 1;
+}
+
+// m * x, packed like a matrix row; x has m.words_per_row() words
+std::vector<uint64_t> mat_vec(const GF2Matrix &m,
+                              const std::vector<uint64_t> &x) {
+  std::vector<uint64_t> y((m.rows() + 63) / 64, 0);
+  const uint64_t *data = m.get_raw_data();
+  for (size_t r = 0; r < m.rows(); ++r) {
+    if (row_dot(data + r * m.row_stride(), x)) {
+      y[r / 64] |= uint64_t(1) << (r % 64);
+    }
+  }
+  return y;
+}
+
+} // namespace
+
 bool GF2TestFramework::validateMultiplication(const GF2Matrix &a,
                                               const GF2Matrix &b,
-                                              const GF2Matrix &result) {
+                                              const GF2Matrix &result,
+                                              int rounds) {
   if (a.cols() != b.rows() || a.rows() != result.rows() ||
       b.cols() != result.cols()) {
     return false;
   }
 
-  // Check sample positions for correctness
-  for (size_t i = 0; i < std::min<size_t>(10, a.rows()); i++) {
-    for (size_t j = 0; j < std::min<size_t>(10, b.cols()); j++) {
-      bool expected = 0;
-      for (size_t k = 0; k < a.cols(); k++) {
-        // expected ^= (a.get(i, k) & b.get(k, j));
-        expected ^=
-            (static_cast<int>(a.get(i, k)) & static_cast<int>(b.get(k, j)));
-      }
-      if (expected != result.get(i, j)) {
-        return false;
-      }
+  std::mt19937_64 rng(std::random_device{}());
+  const size_t n = b.cols();
+  std::vector<uint64_t> x(b.words_per_row());
+  for (int round = 0; round < rounds; ++round) {
+    for (uint64_t &word : x) {
+      word = rng();
+    }
+    if (n % 64 != 0) {
+      x.back() &= (uint64_t(1) << (n % 64)) - 1;
+    }
+    // b * x has a.cols() bits, packed the same way as a row of a
+    std::vector<uint64_t> bx = mat_vec(b, x);
+    bx.resize(a.words_per_row(), 0);
+    if (mat_vec(a, bx) != mat_vec(result, x)) {
+      return false;
     }
   }
   return true;
 }
+
+#ifdef GF2_HAVE_METAL
+// --- Metal-only paths ---
+
+std::vector<TestResult> GF2TestFramework::testGPUAsync(const GF2Matrix &a,
+                                                       const GF2Matrix &b,
+                                                       int iterations) {
+  if (!_gpu) {
+    return std::vector<TestResult>{
+        {"GPU-Async", 0.0, false, 0.0, a.rows() * b.cols(), {}}};
+  }
+
+  // Two jobs in flight: the operands of job i + 1 are generated on the CPU
+  // while the GPU runs job i
+  const int DEPTH = 2;
+  std::vector<GF2Matrix> a_jobs, b_jobs, results;
+  for (int j = 0; j < DEPTH; j++) {
+    a_jobs.push_back(generateRandomMatrix(a.rows(), a.cols()));
+    b_jobs.push_back(generateRandomMatrix(b.rows(), b.cols()));
+    results.emplace_back(a.rows(), b.cols());
+  }
+  std::vector<std::future<void>> pending(DEPTH);
+
+  // Warm up
+  for (int w = 0; w < _warmup; ++w) {
+    _gpu->multiplyAsync(GF2GPU::Kernel::Vectorized, a_jobs[0], b_jobs[0],
+                        results[0])
+        .get();
+  }
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    int slot = i % DEPTH;
+    if (pending[slot].valid()) {
+      pending[slot].get();
+    }
+    a_jobs[slot] = generateRandomMatrix(a.rows(), a.cols());
+    b_jobs[slot] = generateRandomMatrix(b.rows(), b.cols());
+    pending[slot] = _gpu->multiplyAsync(GF2GPU::Kernel::Vectorized,
+                                        a_jobs[slot], b_jobs[slot],
+                                        results[slot]);
+  }
+  for (auto &job : pending) {
+    if (job.valid()) {
+      job.get();
+    }
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+
+  // Pipelined jobs overlap, so every iteration is reported with the mean,
+  // and correctness with the last job of each slot
+  std::chrono::duration<double, std::milli> duration = end - start;
+  bool correct = true;
+  for (int j = 0; j < std::min(DEPTH, iterations); j++) {
+    correct = correct && verified(a_jobs[j], b_jobs[j], results[j]);
+  }
+  double per_job = duration.count() / std::max(1, iterations);
+  double throughput =
+      calculateThroughput(a.rows(), a.cols(), b.cols(), per_job);
+
+  std::vector<TestResult> individual_results;
+  for (int i = 0; i < iterations; i++) {
+    individual_results.push_back(
+        {"GPU-Async", per_job, correct, throughput, a.rows() * b.cols(), {}});
+  }
+
+  return individual_results;
+}
+
+std::vector<TestResult> GF2TestFramework::testGPUBatched(const GF2Matrix &a,
+                                                         const GF2Matrix &b,
+                                                         int iterations,
+                                                         size_t batch_size) {
+  if (!_gpu) {
+    return std::vector<TestResult>{
+        {"GPU-Batched", 0.0, false, 0.0, a.rows() * b.cols(), {}}};
+  }
+
+  std::vector<GF2Matrix> a_batch, b_batch, results;
+  for (size_t j = 0; j < batch_size; j++) {
+    a_batch.push_back(generateRandomMatrix(a.rows(), a.cols()));
+    b_batch.push_back(generateRandomMatrix(b.rows(), b.cols()));
+  }
+
+  // Warm up
+  for (int w = 0; w < _warmup; ++w) {
+    _gpu->multiplyGPUBatched(GF2GPU::Kernel::Vectorized, a_batch, b_batch,
+                             results);
+  }
+
+  std::vector<TestResult> individual_results;
+
+  for (int i = 0; i < iterations; i++) {
+    for (size_t j = 0; j < batch_size; j++) {
+      a_batch[j] = generateRandomMatrix(a.rows(), a.cols());
+      b_batch[j] = generateRandomMatrix(b.rows(), b.cols());
+    }
+
+    beginRegion();
+    auto start = std::chrono::high_resolution_clock::now();
+    _gpu->multiplyGPUBatched(GF2GPU::Kernel::Vectorized, a_batch, b_batch,
+                             results);
+    auto end = std::chrono::high_resolution_clock::now();
+    endRegion();
+
+    // Reported per product of the batch
+    std::chrono::duration<double, std::milli> duration = end - start;
+    bool correct = results.size() == batch_size;
+    for (size_t j = 0; correct && j < batch_size; j++) {
+      correct = verified(a_batch[j], b_batch[j], results[j]);
+    }
+    double per_product = duration.count() / std::max<size_t>(1, batch_size);
+    double throughput =
+        calculateThroughput(a.rows(), a.cols(), b.cols(), per_product);
+
+    individual_results.push_back({"GPU-Batched", per_product, correct,
+                                  throughput, a.rows() * b.cols(),
+                                  _gpu->lastTiming()});
+  }
+
+  return individual_results;
+}
+
+#endif // GF2_HAVE_METAL
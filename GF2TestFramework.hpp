@@ -1,11 +1,20 @@
 #pragma once
 
 #include "GF2Matrix.hpp"
-#include "GF2GPU.hpp"
+#include "GF2Backend.hpp"
+#include "GF2Engine.hpp"
+#include "GF2PerfCounters.hpp"
+#include "GF2MemoryTracker.hpp"
+#include "GF2EnergyMeter.hpp"
 #include <chrono>
+#include <functional>
+#include <memory>
 #include <vector>
 #include <string>
 #include <map>
+#include <tuple>
+
+class GF2GPU;
 
 struct TestResult {
     std::string method;
@@ -13,19 +22,145 @@ struct TestResult {
     bool correct;
     double throughput_gbps; // Giga-bit operations per second
     size_t matrix_size;
+    GF2GPUTiming gpu_timing; // GPU methods only
+
+    // Filled in by runTests
+    size_t m = 0, k = 0, n = 0;
+    double bytes_moved = 0.0;   // packed A and B read plus C written, once each
+    // The method's own traffic and 64-bit word ops (GF2Roofline::estimate)
+    double bytes_read = 0.0;
+    double bytes_written = 0.0;
+    double word_ops = 0.0;
+    std::string backend = "";   // "CPU", "Metal", "OpenCL"
+    std::string kernel = "";    // CPU SIMD kernel or GPU kernel variant
+    std::string device = "";    // CPU description with its ISA, or the GPU name
+    int threads = 0;            // CPU threads; 0 for GPU methods
+    std::string build = "";     // compiler and flags
+    std::string timestamp = ""; // UTC, ISO 8601, when the method started
+    GF2PerfSample counters = {}; // timed region, TestConfig::perf_counters
+    GF2MemorySample memory = {}; // timed region, TestConfig::track_memory
+    GF2EnergySample energy = {}; // timed region, TestConfig::energy
+
+    // 64-bit words of the product, the unit of the per-word miss counts
+    size_t outputWords() const { return m * ((n + 63) / 64); }
+    // Bit operations per joule of the region's energy, or -1
+    double gopsPerWatt() const {
+        return GF2EnergySample::gopsPerWatt(throughput_gbps * 1e9 * duration_ms / 1000.0,
+                                            energy.total());
+    }
+    // Modelled bytes over the measured time
+    double achievedGBps() const {
+        return duration_ms > 0.0 ? (bytes_read + bytes_written) / duration_ms / 1e6 : 0.0;
+    }
+};
+
+// Statistics of the timed iterations of one method at one size. The order
+// statistics cover every sample; the mean, standard deviation and the
+// confidence interval exclude the outliers if they were rejected.
+struct TimingStats {
+    size_t samples = 0;
+    size_t outliers = 0; // above the upper Tukey fence, Q3 + 3 * IQR
+    double min_ms = 0.0;
+    double median_ms = 0.0;
+    double p90_ms = 0.0;
+    double p99_ms = 0.0;
+    double mean_ms = 0.0;
+    double stddev_ms = 0.0;
+    // Bootstrap (percentile) confidence interval of the median
+    double ci_low_ms = 0.0;
+    double ci_high_ms = 0.0;
+};
+
+// One line of printResults: a method at one size
+struct TestSummary {
+    std::string method;
+    size_t matrix_size;
+    size_t m, k, n;
+    bool correct; // every iteration
+    TimingStats stats;
+    double throughput_gbps; // at the median time
+    // Medians over the iterations with counters, else -1
+    double ipc = -1.0;
+    double l1d_misses_per_word = -1.0;
+    double llc_misses_per_word = -1.0;
+    // Peaks over the iterations (GF2MemorySample), else -1
+    double host_peak_bytes = -1.0;
+    double rss_peak_bytes = -1.0;
+    double gpu_peak_bytes = -1.0;
+    // Medians over the iterations with energy readings, else -1
+    double energy_j = -1.0;
+    double gops_per_watt = -1.0;
+    // Of the method, for the roofline
+    std::string backend = "";
+    std::string kernel = "";
+    int threads = 0;
+    double bytes_read = 0.0;
+    double bytes_written = 0.0;
+    double word_ops = 0.0;
 };
 
 struct TestConfig {
-    std::vector<std::pair<size_t, size_t>> matrix_sizes;
+    std::vector<std::pair<size_t, size_t>> matrix_sizes; // (m, k), n = k
+    // m x k x n; when set, used instead of matrix_sizes
+    std::vector<std::tuple<size_t, size_t, size_t>> shapes;
+    uint64_t seed = 0; // operands from this seed; 0 = different every run
     int iterations = 5;
+    int warmup_iterations = 1; // per method and size, before the timed ones
+    // Generate the operands of the next timed iteration on a background
+    // thread while the current one is timed. Only on machines with more
+    // than one core, where the generator need not share the measured one.
+    bool background_inputs = true;
+    // Adaptive iterations: a method runs more iterations (doubling) until the
+    // confidence interval of its median is within ci_target of the median on
+    // either side, it has max_iterations, or it has taken adaptive_budget_ms.
+    // 0 = exactly 'iterations'.
+    double ci_target = 0.02;
+    int max_iterations = 64;
+    double adaptive_budget_ms = 5000.0;
+    double confidence = 0.95;
+    bool reject_outliers = true;
+    // Hardware counters around every timed region (GF2PerfCounters). Not
+    // for GPU-Async, whose region spans all its iterations.
+    bool perf_counters = false;
+    // Peak host and GPU memory of every timed region (GF2MemoryTracker),
+    // with the same exception
+    bool track_memory = true;
+    // Energy of every timed region (GF2EnergyMeter), with the same exception
+    bool energy = false;
+    // Freivalds check of every timed product, after its timing
     bool validate_results = true;
+    int validation_rounds = 20; // a wrong product passes with 2^-rounds
     bool run_serial = true;
     bool run_simd = true;
+    bool run_simd_parallel = true;
+    int num_threads = 0; // 0 = OpenMP default
+    bool run_simd_tiled = true;
+    GF2TileConfig tiles; // zero fields = derived from the cache geometry
+    bool run_simd_into = true;
+    bool run_m4r = true;
+    bool run_strassen = true;
+    size_t strassen_cutoff = 1024;
     bool run_gpu = true;
     bool run_gpu_transposed = true;
     bool run_gpu_tiled = true;
     bool run_gpu_vectorized = true;
+    bool run_gpu_simdgroup = true;
+    bool run_hybrid = true;
+    bool run_gpu_resident = true;
+    bool run_gpu_plan = true; // recorded once, replayed every iteration
+    // Out-of-core path with blocks of a quarter of A, so that even the test
+    // sizes stream several blocks through the ring
+    bool run_gpu_out_of_core = true;
+    // GPU Strassen-Winograd with M4R leaves, one halving at every size
+    bool run_gpu_strassen = true;
     bool run_gpu_m4r = true;
+    bool run_gpu_async = true;
+    bool run_gpu_batched = true; // sizes up to 512 only
+    size_t gpu_batch_size = 64;
+    bool run_engine = true;
+    // Methods the engine profile predicts slower than this per product are
+    // skipped at that size (0 = run everything)
+    double max_method_ms = 2000.0;
 };
 
 class GF2TestFramework {
@@ -37,39 +172,176 @@ public:
     std::vector<TestResult> runTests(const TestConfig& config);
     
     // Individual test methods
-    std::vector<TestResult> testSerial(const GF2Matrix& a, const GF2Matrix& b, int iterations, bool debug_mode = true);
-    std::vector<TestResult> testSIMD(const GF2Matrix& a, const GF2Matrix& b, int iterations, bool debug_mode = true);
-    std::vector<TestResult> testGPU(const GF2Matrix& a, const GF2Matrix& b, int iterations, bool debug_mode = true);
-    std::vector<TestResult> testGPU_transposed(const GF2Matrix& a, const GF2Matrix& b, int iterations, bool debug_mode = true);
-    std::vector<TestResult> testGPUTiled(const GF2Matrix& a, const GF2Matrix& b, int iterations, bool debug_mode = true);
-    std::vector<TestResult> testGPUVectorized(const GF2Matrix& a, const GF2Matrix& b, int iterations, bool debug_mode = true);
+    std::vector<TestResult> testSerial(const GF2Matrix& a, const GF2Matrix& b, int iterations);
+    std::vector<TestResult> testSIMD(const GF2Matrix& a, const GF2Matrix& b, int iterations);
+    std::vector<TestResult> testSIMDParallel(const GF2Matrix& a, const GF2Matrix& b, int iterations, int num_threads);
+    std::vector<TestResult> testSIMDTiled(const GF2Matrix& a, const GF2Matrix& b, int iterations, const GF2TileConfig& tiles, int num_threads);
+    std::vector<TestResult> testSIMDInto(const GF2Matrix& a, const GF2Matrix& b, int iterations, int num_threads);
+    std::vector<TestResult> testM4R(const GF2Matrix& a, const GF2Matrix& b, int iterations);
+    std::vector<TestResult> testStrassen(const GF2Matrix& a, const GF2Matrix& b, int iterations, size_t cutoff);
+    std::vector<TestResult> testGPU(const GF2Matrix& a, const GF2Matrix& b, int iterations);
+    std::vector<TestResult> testGPU_transposed(const GF2Matrix& a, const GF2Matrix& b, int iterations);
+    std::vector<TestResult> testGPUTiled(const GF2Matrix& a, const GF2Matrix& b, int iterations);
+    std::vector<TestResult> testGPUVectorized(const GF2Matrix& a, const GF2Matrix& b, int iterations);
+    std::vector<TestResult> testGPUSimdGroup(const GF2Matrix& a, const GF2Matrix& b, int iterations);
+#ifdef GF2_HAVE_METAL
+    std::vector<TestResult> testGPUResident(const GF2Matrix& a, const GF2Matrix& b, int iterations);
+    std::vector<TestResult> testGPUPlan(const GF2Matrix& a, const GF2Matrix& b, int iterations);
+    std::vector<TestResult> testGPUOutOfCore(const GF2Matrix& a, const GF2Matrix& b, int iterations);
+    std::vector<TestResult> testGPUStrassen(const GF2Matrix& a, const GF2Matrix& b, int iterations);
+    std::vector<TestResult> testHybrid(const GF2Matrix& a, const GF2Matrix& b, int iterations, int num_threads);
+#endif
     // --- NEW: Declaration for M4R test method ---
-    std::vector<TestResult> testGPUM4R(const GF2Matrix& a, const GF2Matrix& b, int iterations, bool debug_mode = true);
+    std::vector<TestResult> testGPUM4R(const GF2Matrix& a, const GF2Matrix& b, int iterations);
+#ifdef GF2_HAVE_METAL
+    std::vector<TestResult> testGPUBatched(const GF2Matrix& a, const GF2Matrix& b, int iterations, size_t batch_size);
+    std::vector<TestResult> testGPUAsync(const GF2Matrix& a, const GF2Matrix& b, int iterations);
+#endif
+    std::vector<TestResult> testEngine(const GF2Matrix& a, const GF2Matrix& b, int iterations);
 
     
-    // Performance reporting
+    // Performance reporting. printResults prints one summary per method and
+    // size; saveResults writes every iteration, saveSummary the summaries.
     void printResults(const std::vector<TestResult>& results);
     void saveResults(const std::vector<TestResult>& results, const std::string& filename);
+    void saveSummary(const std::vector<TestResult>& results, const std::string& filename);
+    // Every iteration with the machine and build it ran on
+    void saveResultsJSON(const std::vector<TestResult>& results, const std::string& filename);
+    std::vector<TestSummary> summarize(const std::vector<TestResult>& results) const;
+
+    // Order statistics, mean, deviation and the bootstrap interval of the
+    // median at the given confidence
+    static TimingStats timingStats(std::vector<double> samples_ms, double confidence = 0.95,
+                                   bool reject_outliers = true);
     
     // Matrix generation helpers
+    // From the seed of the last runTests, if it had one
     static GF2Matrix generateRandomMatrix(size_t rows, size_t cols);
     static GF2Matrix generateIdentityMatrix(size_t size);
-    static bool validateMultiplication(const GF2Matrix& a, const GF2Matrix& b, const GF2Matrix& result);
+    // Freivalds' check that result = a * b: for random x, a * (b * x) must
+    // equal result * x. O(mk + kn + mn) per round; a wrong result passes a
+    // round with probability at most 1/2.
+    static bool validateMultiplication(const GF2Matrix& a, const GF2Matrix& b,
+                                       const GF2Matrix& result, int rounds = 20);
     
 private:
-    MTL::Device* _device;
-    GF2GPU* _gpu;
+    std::unique_ptr<GF2Backend> _backend; // null without a GPU
+    GF2GPU* _gpu; // _backend if it is the Metal one, else null
+    GF2Engine* _engine;
+    int _warmup; // warm-up multiplies per test method
+    bool _backgroundInputs; // TestConfig::background_inputs, if there are cores
+    int _validationRounds; // 0 = results are not checked
+    // Of the current runTests call
+    double _confidence;
+    bool _rejectOutliers;
+    GF2PerfCounters _counters; // open while TestConfig::perf_counters
+    bool _trackMemory;
+    GF2MemoryTracker _memory;
+    GF2EnergyMeter _energy; // open while TestConfig::energy
+    // What was measured around one timed region
+    struct RegionSample {
+        GF2PerfSample counters;
+        GF2MemorySample memory;
+        GF2EnergySample energy;
+        double trace_start_us = -1.0; // gf2_trace_now_us, while a trace records
+        double trace_end_us = -1.0;
+    };
+    std::vector<RegionSample> _samples; // of the current test call
+    double _regionTraceStart = -1.0;
+
+    // Around each timed region of the tests: they start the counters, the
+    // memory tracking and the energy meter, and record a RegionSample
+    void beginRegion();
+    void endRegion();
     
+    bool withinBudget(GF2Engine::Method method, const GF2Matrix& a, const GF2Matrix& b,
+                      const TestConfig& config);
     double calculateThroughput(size_t a_rows, size_t a_cols, size_t b_cols, double duration_ms);
+    bool hasKernel(GF2Kernel kernel) const;
+    // validateMultiplication with the configured rounds; true when off
+    bool verified(const GF2Matrix& a, const GF2Matrix& b, const GF2Matrix& result) const;
+    // Runs test(iterations) and, for adaptive iterations, again until the
+    // interval is tight enough; appends the rows, with their shape, machine
+    // and build fields, to 'all'
+    void runMeasured(std::vector<TestResult>& all, const TestConfig& config,
+                     const GF2Matrix& a, const GF2Matrix& b,
+                     const std::function<std::vector<TestResult>(int)>& test);
+    void describe(TestResult& result, const TestConfig& config, const GF2Matrix& a,
+                  const GF2Matrix& b, const std::string& timestamp) const;
     void initializeGPU();
     void cleanupGPU();
 };
 
+// What BenchmarkSuite runs
+struct BenchmarkConfig {
+    // Square sizes of the scaling sweep
+    std::vector<size_t> scaling_sizes = {256, 512, 1024, 2048, 4096};
+    // Thread counts of the sweep for the multithreaded methods; empty = 1, 2,
+    // 4, ... up to the OpenMP maximum
+    std::vector<int> thread_counts;
+    // Timed runs per point (after one warm-up); the median counts
+    int repetitions = 3;
+    // A method slower than this at some size is not run at larger ones
+    double max_method_ms = 2000.0;
+    // Back-to-back products of one size, for this long per method
+    size_t throughput_size = 1024;
+    double throughput_seconds = 2.0;
+    // m, k, n of the accuracy check: word boundaries, odd and non-square shapes
+    std::vector<std::tuple<size_t, size_t, size_t>> accuracy_shapes = {
+        {1, 1, 1},     {63, 64, 65},    {64, 64, 64},   {65, 63, 64},
+        {100, 200, 150}, {127, 513, 129}, {512, 512, 512}, {1000, 70, 1000},
+    };
+    std::string report_path = "gf2_benchmark_report.md";
+};
+
+// Benchmark driver over every method GF2Engine can run on this machine, the
+// GPU ones on the backend GF2Backend::create() finds. Each run* call adds
+// its measurements; generateReport writes them all to one file.
 class BenchmarkSuite {
 public:
+    explicit BenchmarkSuite(BenchmarkConfig config = BenchmarkConfig());
+    ~BenchmarkSuite();
+
+    // Median time of each method over the sizes, and over the thread counts
+    // for the multithreaded ones
     void runScalingBenchmark();
+    // Sustained rate of each method on back-to-back products
     void runThroughputBenchmark();
+    // Each method against multiplySerial on the accuracy shapes
     void runAccuracyBenchmark();
+    // Markdown report of everything measured so far, at config.report_path
     void generateReport();
+
+private:
+    struct ScalingPoint {
+        GF2Engine::Method method;
+        size_t size;
+        int threads; // 0 for the single-threaded and GPU methods
+        double median_ms;
+        double gops;
+    };
+    struct ThroughputPoint {
+        GF2Engine::Method method;
+        size_t products;
+        double seconds;
+        double best_ms;
+        double worst_ms;
+        double gops; // over the whole run
+    };
+    struct AccuracyPoint {
+        GF2Engine::Method method;
+        size_t m, k, n;
+        bool correct;
+        std::string error; // the exception, if the method failed to run
+    };
+
+    GF2Engine& engineFor(int threads);
+
+    BenchmarkConfig _config;
+    std::unique_ptr<GF2Backend> _backend;
+    std::map<int, std::unique_ptr<GF2Engine>> _engines; // by thread count
+    std::vector<ScalingPoint> _scaling;
+    std::vector<ThroughputPoint> _throughput;
+    std::vector<AccuracyPoint> _accuracy;
 };
 
@@ -0,0 +1,155 @@
+#include "GF2TiledMatrix.hpp"
+#include "GF2AlignedAllocator.hpp"
+#include "GF2Kernels.hpp"
+#include <cstring>
+#include <omp.h>
+#include <stdexcept>
+
+namespace {
+
+int resolve_threads(int num_threads) {
+    return num_threads > 0 ? num_threads : omp_get_max_threads();
+}
+
+} // namespace
+
+GF2TiledMatrix::GF2TiledMatrix(size_t rows, size_t cols, size_t tile)
+    : m_rows(rows), m_cols(cols), m_tile(tile), m_tiles(0, 0) {
+    if (tile != SMALL_TILE && tile != LARGE_TILE) {
+        throw std::runtime_error("Tile size must be 64 or 256");
+    }
+    m_tiles = GF2Matrix(tileRows() * tileCols() * tile, tile, 1);
+}
+
+// Row r of tile (i, j) is words [j * tw, (j + 1) * tw) of row i * tile + r,
+// clipped to the matrix
+GF2TiledMatrix GF2TiledMatrix::fromMatrix(const GF2Matrix& m, size_t tile, int num_threads) {
+    GF2TiledMatrix t(m.rows(), m.cols(), tile);
+    const size_t tw = t.tileWords(), tc = t.tileCols();
+    const long long tr = static_cast<long long>(t.tileRows());
+    #pragma omp parallel for schedule(static) num_threads(resolve_threads(num_threads))
+    for (long long ii = 0; ii < tr; ++ii) {
+        const size_t i = size_t(ii);
+        const size_t rows = std::min(tile, m.rows() - i * tile);
+        for (size_t j = 0; j < tc; ++j) {
+            const size_t words = std::min(tw, m.words_per_row() - j * tw);
+            uint64_t* dst = t.m_tiles.get_raw_data() + t.tileIndex(i, j) * t.tileSize();
+            const uint64_t* src = m.get_raw_data() + i * tile * m.row_stride() + j * tw;
+            for (size_t r = 0; r < rows; ++r) {
+                std::memcpy(dst + r * tw, src + r * m.row_stride(), words * sizeof(uint64_t));
+            }
+        }
+    }
+    return t;
+}
+
+GF2Matrix GF2TiledMatrix::toMatrix(int num_threads) const {
+    GF2Matrix m(m_rows, m_cols);
+    const size_t tw = tileWords(), tc = tileCols();
+    const long long tr = static_cast<long long>(tileRows());
+    uint64_t* data = m.get_raw_data();
+    #pragma omp parallel for schedule(static) num_threads(resolve_threads(num_threads))
+    for (long long ii = 0; ii < tr; ++ii) {
+        const size_t i = size_t(ii);
+        const size_t rows = std::min(m_tile, m_rows - i * m_tile);
+        for (size_t j = 0; j < tc; ++j) {
+            const size_t words = std::min(tw, m.words_per_row() - j * tw);
+            const uint64_t* src = tileData(i, j);
+            uint64_t* dst = data + i * m_tile * m.row_stride() + j * tw;
+            for (size_t r = 0; r < rows; ++r) {
+                std::memcpy(dst + r * m.row_stride(), src + r * tw, words * sizeof(uint64_t));
+            }
+        }
+    }
+    return m;
+}
+
+std::vector<std::pair<size_t, size_t>> GF2TiledMatrix::tileOrder() const {
+    std::vector<std::pair<size_t, size_t>> order(tileRows() * tileCols());
+    for (size_t i = 0; i < tileRows(); ++i) {
+        for (size_t j = 0; j < tileCols(); ++j) {
+            order[tileIndex(i, j)] = {i, j};
+        }
+    }
+    return order;
+}
+
+bool GF2TiledMatrix::get(size_t row, size_t col) const {
+    if (row >= m_rows || col >= m_cols) return false;
+    const uint64_t word = tileData(row / m_tile, col / m_tile)[(row % m_tile) * tileWords() +
+                                                               (col % m_tile) / 64];
+    return (word >> (col % 64)) & 1;
+}
+
+void GF2TiledMatrix::set(size_t row, size_t col, bool value) {
+    if (row >= m_rows || col >= m_cols) {
+        throw std::runtime_error("Matrix index out of bounds");
+    }
+    uint64_t& word = tileData(row / m_tile, col / m_tile)[(row % m_tile) * tileWords() +
+                                                          (col % m_tile) / 64];
+    const uint64_t bit = uint64_t(1) << (col % 64);
+    word = value ? word | bit : word & ~bit;
+}
+
+GF2TiledMatrix GF2TiledMatrix::multiply(const GF2TiledMatrix& other, int num_threads) const {
+    if (m_cols != other.m_rows) {
+        throw std::runtime_error("Matrix dimensions incompatible for multiplication");
+    }
+    if (m_tile != other.m_tile) {
+        throw std::runtime_error("Tiled matrices of different tile sizes");
+    }
+    GF2TiledMatrix result(m_rows, other.m_cols, m_tile);
+    const size_t tw = tileWords(), ts = tileSize(), tk = tileCols();
+    const size_t tiles = result.tileRows() * result.tileCols();
+    if (tiles == 0) {
+        return result;
+    }
+    const int threads = resolve_threads(num_threads);
+    const SimdKernel& kernel = simd_kernel();
+
+    // B^T of every tile of other, at the same index: B^T of tile (p, j) is
+    // tile (j, p) of other^T. A packed tile is the same size, its stride
+    // that of the kernel's packed layout.
+    const size_t b_tiles = other.tileRows() * other.tileCols();
+    std::vector<uint64_t, GF2AlignedAllocator<uint64_t>> b_t(b_tiles * ts);
+    const size_t b_t_stride = kernel.pack_b ? tw * 64 : tw;
+    const long long b_count = static_cast<long long>(b_tiles);
+    #pragma omp parallel num_threads(threads)
+    {
+        std::vector<uint64_t> transposed(ts);
+        #pragma omp for schedule(static)
+        for (long long t = 0; t < b_count; ++t) {
+            const uint64_t* src = other.m_tiles.get_raw_data() + size_t(t) * ts;
+            uint64_t* dst = b_t.data() + size_t(t) * ts;
+            transpose_matrix(src, tw, kernel.pack_b ? transposed.data() : dst, tw, m_tile, m_tile);
+            if (kernel.pack_b) {
+                kernel.pack_b(transposed.data(), tw, m_tile, tw, dst);
+            }
+        }
+    }
+
+    // Consecutive product tiles, and so each thread's static share, lie in
+    // one quadrant of the grid and reuse the same rows and columns of tiles
+    const std::vector<std::pair<size_t, size_t>> order = result.tileOrder();
+    const long long count = static_cast<long long>(tiles);
+    uint64_t* c_data = result.m_tiles.get_raw_data();
+    #pragma omp parallel for schedule(static) num_threads(threads)
+    for (long long t = 0; t < count; ++t) {
+        const size_t i = order[size_t(t)].first, j = order[size_t(t)].second;
+        uint64_t* c = c_data + size_t(t) * ts;
+        for (size_t p = 0; p < tk; ++p) {
+            kernel.block(tileData(i, p), tw, b_t.data() + other.tileIndex(p, j) * ts, b_t_stride,
+                         c, tw, m_tile, 0, m_tile, 0, tw, 0, tw, p > 0);
+        }
+    }
+    return result;
+}
+
+bool GF2TiledMatrix::operator==(const GF2TiledMatrix& other) const {
+    if (m_rows != other.m_rows || m_cols != other.m_cols || m_tile != other.m_tile) {
+        return false;
+    }
+    const size_t words = m_tiles.rows() * m_tiles.row_stride();
+    return std::memcmp(m_tiles.get_raw_data(), other.m_tiles.get_raw_data(),
+                       words * sizeof(uint64_t)) == 0;
+}
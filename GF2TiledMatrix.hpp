@@ -0,0 +1,106 @@
+#pragma once
+
+#include "GF2Matrix.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Position of tile (i, j) of a rows x cols grid of tiles in Z order (Morton
+// order: the bits of i and j interleaved, i the higher of each pair), with
+// the positions of tiles outside the grid left out, so that a grid of any
+// shape takes exactly rows * cols tiles. One step per level of the quadtree
+// of the grid; GF2TiledMatrix and the GPU kernels share this definition.
+inline size_t gf2_morton_rank(size_t i, size_t j, size_t rows, size_t cols) {
+    size_t side = 1;
+    while (side < rows || side < cols) side *= 2;
+    size_t rank = 0, r0 = 0, c0 = 0;
+    for (size_t s = side / 2; s > 0; s /= 2) {
+        // Tiles of the quadrant at (r, c) of the current node that are in the grid
+        auto count = [&](size_t r, size_t c) {
+            const size_t h = rows > r ? std::min(s, rows - r) : 0;
+            const size_t w = cols > c ? std::min(s, cols - c) : 0;
+            return h * w;
+        };
+        const bool down = i - r0 >= s, right = j - c0 >= s;
+        if (down) rank += count(r0, c0) + count(r0, c0 + s);
+        if (right) rank += count(down ? r0 + s : r0, c0);
+        r0 += down ? s : 0;
+        c0 += right ? s : 0;
+    }
+    return rank;
+}
+
+// A matrix stored as square tiles of 64 x 64 or 256 x 256 bits, each tile
+// contiguous (its rows one after the other, tileWords() words each) and the
+// tiles in Morton order (gf2_morton_rank). A tile is then one unit-stride
+// run of 512 bytes or 8 KiB, and tiles close in the matrix are close in
+// memory, where row-major storage reads a 64-row tile from 64 rows one
+// matrix stride apart. Bits past rows() and cols() in the edge tiles are
+// zero.
+class GF2TiledMatrix {
+public:
+    // Tile edges in bits
+    static constexpr size_t SMALL_TILE = 64;
+    static constexpr size_t LARGE_TILE = 256;
+
+    // An all-zero matrix; throws std::runtime_error if tile is not
+    // SMALL_TILE or LARGE_TILE
+    GF2TiledMatrix(size_t rows, size_t cols, size_t tile = SMALL_TILE);
+
+    // Conversions from and to row-major, a row of tiles per iteration over
+    // OpenMP threads (num_threads <= 0 for the default)
+    static GF2TiledMatrix fromMatrix(const GF2Matrix& m, size_t tile = SMALL_TILE,
+                                     int num_threads = 0);
+    GF2Matrix toMatrix(int num_threads = 0) const;
+
+    size_t rows() const { return m_rows; }
+    size_t cols() const { return m_cols; }
+    size_t tile() const { return m_tile; }
+    // Words per row of a tile, and per tile
+    size_t tileWords() const { return m_tile / 64; }
+    size_t tileSize() const { return m_tile * m_tile / 64; }
+    // The grid of tiles
+    size_t tileRows() const { return (m_rows + m_tile - 1) / m_tile; }
+    size_t tileCols() const { return (m_cols + m_tile - 1) / m_tile; }
+
+    // Tile (i, j), row r at tileData(i, j) + r * tileWords()
+    size_t tileIndex(size_t i, size_t j) const {
+        return gf2_morton_rank(i, j, tileRows(), tileCols());
+    }
+    const uint64_t* tileData(size_t i, size_t j) const {
+        return m_tiles.get_raw_data() + tileIndex(i, j) * tileSize();
+    }
+    uint64_t* tileData(size_t i, size_t j) {
+        return m_tiles.get_raw_data() + tileIndex(i, j) * tileSize();
+    }
+    // The (i, j) of each tile, in storage order
+    std::vector<std::pair<size_t, size_t>> tileOrder() const;
+
+    // The tiles one after the other as the rows of a
+    // (tileRows() * tileCols() * tile()) x tile() matrix without row padding,
+    // which is how the GPU backends upload them
+    const GF2Matrix& storage() const { return m_tiles; }
+    GF2Matrix& storage() { return m_tiles; }
+
+    bool get(size_t row, size_t col) const;
+    void set(size_t row, size_t col, bool value);
+
+    // this * other with the SIMD kernel (simd_kernel()) on whole tiles: each
+    // tile of other is transposed (and packed, for kernels that pack B^T)
+    // once, and every tile of the product is its row of tiles of this times
+    // its column of tiles of other, for which the kernel reads both tiles at
+    // unit stride. Tiles of the product go to the threads in Morton order,
+    // so each thread works in one compact region. Throws
+    // std::runtime_error if the shapes or tile sizes differ.
+    GF2TiledMatrix multiply(const GF2TiledMatrix& other, int num_threads = 0) const;
+
+    bool operator==(const GF2TiledMatrix& other) const;
+
+private:
+    size_t m_rows;
+    size_t m_cols;
+    size_t m_tile;
+    GF2Matrix m_tiles;
+};
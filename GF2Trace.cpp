@@ -0,0 +1,161 @@
+#include "GF2Trace.hpp"
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+std::atomic<bool> gf2_trace_detail::active{false};
+
+namespace {
+
+struct Event {
+    const char* name;
+    const char* category;
+    double start_us;
+    double end_us;
+    std::string label;
+};
+
+// The events of one thread, or of the GPU track. Only its thread appends;
+// the mutex is for gf2_trace_write and gf2_trace_start reading or clearing
+// it meanwhile.
+struct Buffer {
+    int tid;
+    std::mutex mutex;
+    std::vector<Event> events;
+};
+
+const int GPU_TID = 1 << 20;
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<Buffer>> buffers; // outlive their threads
+    Buffer gpu{GPU_TID, {}, {}};
+    int next_tid = 1;
+
+    static Registry& get() {
+        static Registry registry;
+        return registry;
+    }
+};
+
+Buffer& thread_buffer() {
+    thread_local std::shared_ptr<Buffer> buffer = [] {
+        Registry& r = Registry::get();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        auto b = std::make_shared<Buffer>();
+        b->tid = r.next_tid++;
+        r.buffers.push_back(b);
+        return b;
+    }();
+    return *buffer;
+}
+
+const auto TRACE_EPOCH = std::chrono::steady_clock::now();
+
+void write_escaped(std::ostream& out, const char* s) {
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\') {
+            out << '\\' << *s;
+        } else if (static_cast<unsigned char>(*s) >= 0x20) {
+            out << *s;
+        }
+    }
+}
+
+} // namespace
+
+void gf2_trace_start() {
+    Registry& r = Registry::get();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (auto& b : r.buffers) {
+        std::lock_guard<std::mutex> buffer_lock(b->mutex);
+        b->events.clear();
+    }
+    {
+        std::lock_guard<std::mutex> buffer_lock(r.gpu.mutex);
+        r.gpu.events.clear();
+    }
+    gf2_trace_detail::active.store(true, std::memory_order_relaxed);
+}
+
+void gf2_trace_stop() {
+    gf2_trace_detail::active.store(false, std::memory_order_relaxed);
+}
+
+double gf2_trace_now_us() {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() -
+                                                     TRACE_EPOCH)
+        .count();
+}
+
+void gf2_trace_event(const char* name, const char* category, double start_us, double end_us,
+                     const std::string& label) {
+    if (!gf2_trace_active()) {
+        return;
+    }
+    Buffer& b = thread_buffer();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    b.events.push_back(Event{name, category, start_us, end_us, label});
+}
+
+void gf2_trace_gpu(const char* name, double start_s, double end_s, double last_end_s) {
+    if (!gf2_trace_active() || end_s < start_s) {
+        return;
+    }
+    const double now = gf2_trace_now_us();
+    Buffer& b = Registry::get().gpu;
+    std::lock_guard<std::mutex> lock(b.mutex);
+    b.events.push_back(Event{name, "gpu", now - (last_end_s - start_s) * 1e6,
+                             now - (last_end_s - end_s) * 1e6, std::string()});
+}
+
+// Complete ("X") events, one track per thread plus the GPU's, named by
+// metadata events
+size_t gf2_trace_write(const std::string& path) {
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("Could not write " + path);
+    }
+    Registry& r = Registry::get();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    std::vector<Buffer*> buffers;
+    for (auto& b : r.buffers) buffers.push_back(b.get());
+    buffers.push_back(&r.gpu);
+
+    size_t count = 0;
+    out.precision(3);
+    out << std::fixed << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (Buffer* b : buffers) {
+        std::lock_guard<std::mutex> buffer_lock(b->mutex);
+        if (b->events.empty()) {
+            continue;
+        }
+        out << (first ? "" : ",\n") << "{\"ph\":\"M\",\"pid\":1,\"tid\":" << b->tid
+            << ",\"name\":\"thread_name\",\"args\":{\"name\":\""
+            << (b->tid == GPU_TID ? "GPU" : "CPU thread " + std::to_string(b->tid)) << "\"}}";
+        first = false;
+        for (const Event& e : b->events) {
+            out << ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << b->tid << ",\"name\":\"";
+            write_escaped(out, e.name);
+            out << "\",\"cat\":\"";
+            write_escaped(out, e.category);
+            out << "\",\"ts\":" << e.start_us << ",\"dur\":" << (e.end_us - e.start_us);
+            if (!e.label.empty()) {
+                out << ",\"args\":{\"label\":\"";
+                write_escaped(out, e.label.c_str());
+                out << "\"}";
+            }
+            out << "}";
+            ++count;
+        }
+    }
+    out << "\n]}\n";
+    if (!out) {
+        throw std::runtime_error("Could not write " + path);
+    }
+    return count;
+}
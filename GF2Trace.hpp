@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <utility>
+
+// Scoped trace points on the hot paths (the SIMD, M4R and Strassen
+// multiplies, the GPU backends' uploads, encodes, waits and readbacks, the
+// test framework's timed regions), recorded into per-thread buffers and
+// written as a Chrome trace (chrome://tracing, ui.perfetto.dev). GPU work
+// shows as a track of its own, its intervals taken from the command-buffer
+// or event timestamps.
+//
+// The trace points are compiled in only with GF2_TRACE defined (CMake
+// -DGF2_TRACE=ON); otherwise GF2_TRACE_SCOPE and GF2_TRACE_GPU expand to
+// nothing. Compiled in, a point costs one relaxed load while no trace is
+// being recorded.
+
+// Clears the recorded events and starts recording; stops recording
+void gf2_trace_start();
+void gf2_trace_stop();
+
+namespace gf2_trace_detail {
+extern std::atomic<bool> active;
+}
+inline bool gf2_trace_active() {
+    return gf2_trace_detail::active.load(std::memory_order_relaxed);
+}
+
+// Microseconds since an arbitrary start, on the clock of the trace
+double gf2_trace_now_us();
+
+// An interval of the calling thread; name and category must outlive the
+// recording (string literals), label is copied and shown as the event's
+// argument
+void gf2_trace_event(const char* name, const char* category, double start_us, double end_us,
+                     const std::string& label = std::string());
+
+// A GPU interval [start_s, end_s] in seconds on the device's clock, for
+// work of which the last part ended on the device at last_end_s, just
+// before the host saw it complete (now). The intervals of one submission
+// keep their spacing; the host and device clocks are aligned at completion.
+void gf2_trace_gpu(const char* name, double start_s, double end_s, double last_end_s);
+
+// Writes what was recorded as Chrome trace JSON and returns the number of
+// events; throws std::runtime_error if path cannot be written
+size_t gf2_trace_write(const std::string& path);
+
+// Records its lifetime as an interval of the calling thread
+class GF2TraceScope {
+public:
+    explicit GF2TraceScope(const char* name, const char* category = "cpu")
+        : m_name(name), m_category(category),
+          m_start(gf2_trace_active() ? gf2_trace_now_us() : -1.0) {}
+    GF2TraceScope(const char* name, const char* category, std::string label)
+        : m_name(name), m_category(category), m_label(std::move(label)),
+          m_start(gf2_trace_active() ? gf2_trace_now_us() : -1.0) {}
+    ~GF2TraceScope() {
+        if (m_start >= 0.0) {
+            gf2_trace_event(m_name, m_category, m_start, gf2_trace_now_us(), m_label);
+        }
+    }
+    GF2TraceScope(const GF2TraceScope&) = delete;
+    GF2TraceScope& operator=(const GF2TraceScope&) = delete;
+
+private:
+    const char* m_name;
+    const char* m_category;
+    std::string m_label;
+    double m_start;
+};
+
+#define GF2_TRACE_CONCAT_(a, b) a##b
+#define GF2_TRACE_CONCAT(a, b) GF2_TRACE_CONCAT_(a, b)
+
+#ifdef GF2_TRACE
+// GF2_TRACE_SCOPE("name") or GF2_TRACE_SCOPE("name", "category"[, label])
+#define GF2_TRACE_SCOPE(...) GF2TraceScope GF2_TRACE_CONCAT(gf2_trace_scope_, __LINE__)(__VA_ARGS__)
+#define GF2_TRACE_GPU(name, start_s, end_s, last_end_s) \
+    gf2_trace_gpu(name, start_s, end_s, last_end_s)
+#else
+#define GF2_TRACE_SCOPE(...) ((void)0)
+#define GF2_TRACE_GPU(name, start_s, end_s, last_end_s) ((void)0)
+#endif
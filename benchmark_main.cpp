@@ -0,0 +1,56 @@
+#include "GF2TestFramework.hpp"
+#include "GF2CpuInfo.hpp"
+#include <iostream>
+#include <string>
+
+// gf2_bench [--scaling] [--throughput] [--accuracy] [--report FILE]
+// Runs the selected benchmarks (all of them by default) and writes the
+// report.
+int main(int argc, char *argv[]) {
+  bool scaling = false, throughput = false, accuracy = false;
+  BenchmarkConfig config;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--scaling") {
+      scaling = true;
+    } else if (arg == "--throughput") {
+      throughput = true;
+    } else if (arg == "--accuracy") {
+      accuracy = true;
+    } else if (arg == "--report" && i + 1 < argc) {
+      config.report_path = argv[++i];
+    } else {
+      std::cerr << "Usage: " << argv[0]
+                << " [--scaling] [--throughput] [--accuracy] [--report FILE]\n";
+      return 1;
+    }
+  }
+  if (!scaling && !throughput && !accuracy) {
+    scaling = throughput = accuracy = true;
+  }
+
+  std::cout << "GF(2) Matrix Multiplication Benchmarks\n";
+  std::cout << "======================================\n";
+  std::cout << "- CPU: " << GF2CpuInfo::get().describe() << "\n";
+  std::cout << "- CPU kernel: " << GF2Matrix::simdKernelName() << "\n\n";
+
+  try {
+    BenchmarkSuite suite(config);
+    if (accuracy) {
+      suite.runAccuracyBenchmark();
+    }
+    if (scaling) {
+      suite.runScalingBenchmark();
+    }
+    if (throughput) {
+      suite.runThroughputBenchmark();
+    }
+    suite.generateReport();
+  } catch (const std::exception &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,48 @@
+// --- File: gf2_add.metal ---
+//
+// Addition of two bit-packed matrices over GF(2), a word-wise XOR, for the
+// device-resident operations of GF2GPU.
+
+#include <metal_stdlib>
+using namespace metal;
+
+struct GF2AddParams {
+    uint rows;
+    uint words; // words per row that hold columns
+    uint a_stride;
+    uint b_stride;
+    uint result_stride;
+};
+
+// Grid dispatch: (words, rows), one thread per result word
+kernel void gf2_add_kernel(
+    device const uint64_t* a [[buffer(0)]],
+    device const uint64_t* b [[buffer(1)]],
+    device uint64_t* result [[buffer(2)]],
+    constant GF2AddParams& params [[buffer(3)]],
+    uint2 gid [[thread_position_in_grid]])
+{
+    uint word = gid.x;
+    uint row = gid.y;
+    if (row >= params.rows || word >= params.words) {
+        return;
+    }
+    result[ulong(row) * params.result_stride + word] =
+        a[ulong(row) * params.a_stride + word] ^ b[ulong(row) * params.b_stride + word];
+}
+
+// result = a over the same grid, b_stride unused: a strided block of a
+// buffer made contiguous
+kernel void gf2_copy_kernel(
+    device const uint64_t* a [[buffer(0)]],
+    device uint64_t* result [[buffer(1)]],
+    constant GF2AddParams& params [[buffer(2)]],
+    uint2 gid [[thread_position_in_grid]])
+{
+    uint word = gid.x;
+    uint row = gid.y;
+    if (row >= params.rows || word >= params.words) {
+        return;
+    }
+    result[ulong(row) * params.result_stride + word] = a[ulong(row) * params.a_stride + word];
+}
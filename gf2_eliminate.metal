@@ -0,0 +1,31 @@
+// --- File: gf2_eliminate.metal ---
+//
+// Row gathers for the panel updates of GF2GPU::rank() and echelonForm(),
+// whose products run on the M4R kernels of gf2_multiply_m4r.metal.
+
+#include <metal_stdlib>
+using namespace metal;
+
+struct GF2GatherParams {
+    uint rows;
+    uint words;
+    uint src_stride;
+    uint dst_stride;
+};
+
+// Row j of dst = the first 'words' words of row rows[j] of src.
+// Grid dispatch: (words, rows), one thread per word
+kernel void gf2_gather_rows_kernel(
+    device const uint64_t* src [[buffer(0)]],
+    device uint64_t* dst [[buffer(1)]],
+    device const uint* rows [[buffer(2)]],
+    constant GF2GatherParams& params [[buffer(3)]],
+    uint2 gid [[thread_position_in_grid]])
+{
+    uint word = gid.x;
+    uint row = gid.y;
+    if (row >= params.rows || word >= params.words) {
+        return;
+    }
+    dst[ulong(row) * params.dst_stride + word] = src[ulong(rows[row]) * params.src_stride + word];
+}
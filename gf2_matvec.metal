@@ -0,0 +1,154 @@
+// --- File: gf2_matvec.metal ---
+//
+// Products of a bit-packed matrix A with n x 64 blocks of vectors (row k of
+// a block in word k, bit j in column j), for GF2GPU::multiplyBlock and
+// leftMultiplyBlock. Both read A once and are bound by its bandwidth. The
+// product A^T * B of GF2GPU::multiplyAtB is the left product with every
+// 64-column block of A at once. One triangle of A * A^T (GF2GPU::multiplyAAt)
+// takes dot products of rows of A.
+
+#include <metal_stdlib>
+using namespace metal;
+
+struct GF2BlockParams {
+    uint rows;   // of A
+    uint cols;   // of A
+    uint words;  // words per row of A that hold columns
+    uint stride; // row stride of A
+};
+
+struct GF2AtBParams {
+    uint rows;   // of A and B, the common dimension
+    uint cols;   // of A, the rows of the result
+    uint a_words;
+    uint b_words;
+    uint a_stride;
+    uint b_stride;
+    uint result_stride;
+};
+
+struct GF2AAtParams {
+    uint rows;   // of A, and the rows and columns of the result
+    uint words;  // words per row of A that hold columns
+    uint stride; // row stride of A
+    uint result_stride;
+    uint upper;  // the upper triangle, else the lower one
+};
+
+// y = A * x, x with cols words and y with rows words.
+// Grid dispatch: (rows, 1), one thread per row of A, which XORs the words
+// of x its bits select.
+kernel void gf2_matvec_block_kernel(
+    device const uint64_t* a [[buffer(0)]],
+    device const uint64_t* x [[buffer(1)]],
+    device uint64_t* y [[buffer(2)]],
+    constant GF2BlockParams& params [[buffer(3)]],
+    uint gid [[thread_position_in_grid]])
+{
+    if (gid >= params.rows) {
+        return;
+    }
+    device const uint64_t* row = a + ulong(gid) * params.stride;
+    uint64_t sum = 0;
+    for (uint w = 0; w < params.words; ++w) {
+        uint64_t bits = row[w];
+        device const uint64_t* xw = x + ulong(w) * 64;
+        while (bits != 0) {
+            sum ^= xw[ctz(bits)];
+            bits &= bits - 1;
+        }
+    }
+    y[gid] = sum;
+}
+
+// y = x^T * A, x with rows words and y with 64 rows of words words.
+// Grid dispatch: (64, words), one thread per word of y. The 64 threads of a
+// word read the same words of A and x, so a SIMD-group loads each once.
+kernel void gf2_matvec_left_block_kernel(
+    device const uint64_t* a [[buffer(0)]],
+    device const uint64_t* x [[buffer(1)]],
+    device uint64_t* y [[buffer(2)]],
+    constant GF2BlockParams& params [[buffer(3)]],
+    uint2 gid [[thread_position_in_grid]])
+{
+    uint j = gid.x;
+    uint word = gid.y;
+    if (j >= 64 || word >= params.words) {
+        return;
+    }
+    uint64_t acc = 0;
+    for (uint r = 0; r < params.rows; ++r) {
+        uint64_t select = 0 - ((x[r] >> j) & 1);
+        acc ^= a[ulong(r) * params.stride + word] & select;
+    }
+    y[ulong(j) * params.words + word] = acc;
+}
+
+// C = A^T * B: row i of C is the XOR of the rows of B at the ones of
+// column i of A. Grid dispatch: (64, b_words, a_words), one thread per word
+// of C; word z of the rows of A is the x of the left product for rows
+// [64z, 64z + 64) of C.
+kernel void gf2_multiply_at_b_kernel(
+    device const uint64_t* a [[buffer(0)]],
+    device const uint64_t* b [[buffer(1)]],
+    device uint64_t* c [[buffer(2)]],
+    constant GF2AtBParams& params [[buffer(3)]],
+    uint3 gid [[thread_position_in_grid]])
+{
+    uint j = gid.x;
+    uint word = gid.y;
+    uint z = gid.z;
+    uint row = z * 64 + j;
+    if (j >= 64 || word >= params.b_words || row >= params.cols) {
+        return;
+    }
+    uint64_t acc = 0;
+    for (uint r = 0; r < params.rows; ++r) {
+        uint64_t select = 0 - ((a[ulong(r) * params.a_stride + z] >> j) & 1);
+        acc ^= b[ulong(r) * params.b_stride + word] & select;
+    }
+    c[ulong(row) * params.result_stride + word] = acc;
+}
+
+// One triangle of C = A * A^T (diagonal included): bit b of word w of row i
+// is the parity of row i of A AND row 64w + b. Threads of words of the
+// other triangle store zero; in the diagonal word the bits past (lower) or
+// before (upper) column i are cleared.
+// Grid dispatch: (rows, result words), one thread per word of C
+kernel void gf2_multiply_aat_kernel(
+    device const uint64_t* a [[buffer(0)]],
+    device uint64_t* c [[buffer(1)]],
+    constant GF2AAtParams& params [[buffer(2)]],
+    uint2 gid [[thread_position_in_grid]])
+{
+    uint i = gid.x;
+    uint word = gid.y;
+    if (i >= params.rows || word >= (params.rows + 63) / 64) {
+        return;
+    }
+    device uint64_t* out = c + ulong(i) * params.result_stride + word;
+    uint diagonal_word = i / 64;
+    if (params.upper ? word < diagonal_word : word > diagonal_word) {
+        *out = 0;
+        return;
+    }
+    device const uint64_t* row = a + ulong(i) * params.stride;
+    uint64_t acc = 0;
+    for (uint b = 0; b < 64; ++b) {
+        uint j = word * 64 + b;
+        if (j >= params.rows) {
+            break;
+        }
+        device const uint64_t* other = a + ulong(j) * params.stride;
+        uint64_t dot = 0;
+        for (uint k = 0; k < params.words; ++k) {
+            dot ^= row[k] & other[k];
+        }
+        acc |= uint64_t(popcount(dot) & 1) << b;
+    }
+    if (word == diagonal_word) {
+        uint64_t bit = uint64_t(1) << (i % 64);
+        acc &= params.upper ? ~(bit - 1) : (bit << 1) - 1;
+    }
+    *out = acc;
+}
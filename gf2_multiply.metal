@@ -16,11 +16,21 @@ struct GF2Params {
     uint words_per_row_result;
 };
 
+// Batched dispatch: product gid.z reads and writes the matrices at these word
+// offsets from the buffer starts. Single products pass count = 1.
+struct GPUBatchParams {
+    uint count;
+    uint a_words;
+    uint b_words;
+    uint result_words;
+    uint table_words; // M4R only
+};
+
 // Bit manipulation helpers
 inline uint get_bit(device const uint64_t* data, uint row, uint col, uint words_per_row) {
     uint word_idx = col / 64;
     uint bit_idx = col % 64;
-    uint64_t word = data[row * words_per_row + word_idx];
+    uint64_t word = data[ulong(row) * words_per_row + word_idx];
     return (word >> bit_idx) & 1ULL;
 }
 
@@ -31,7 +41,7 @@ inline void set_bit_atomic(volatile device atomic_uint* data, uint row, uint col
     uint word_idx = col / 64;
     uint bit_idx = col % 64;
     
-    volatile device atomic_uint* atomic_ptr = &data[row * words_per_row + word_idx];
+    volatile device atomic_uint* atomic_ptr = &data[ulong(row) * words_per_row + word_idx];
     
     // FIX: The mask's type MUST be uint64_t to match the atomic's base type.
     // Use the 'ULL' suffix for an unsigned long long literal.
@@ -107,7 +117,7 @@ void gf2_multiply_aligned(
         }
     }
     
-    result[row * params.words_per_row_result + word_col] = word_result;
+    result[ulong(row) * params.words_per_row_result + word_col] = word_result;
 }
 
 // Batch processing kernel for better GPU utilization
@@ -116,14 +126,16 @@ kernel void gf2_multiply_batch(
     device const uint64_t* b [[buffer(1)]],
     device uint64_t* result [[buffer(2)]],
     constant GF2Params& params [[buffer(3)]],
+    constant GPUBatchParams& batch [[buffer(4)]],
     uint3 gid [[thread_position_in_grid]]) {
     
-    uint batch_idx = gid.z;
+    ulong batch_idx = gid.z;
     uint row = gid.x;
     uint word_col = gid.y;
     
-    if (batch_idx >= 1) return; // For now, single batch
+    if (batch_idx >= batch.count) return;
     
-    gf2_multiply_aligned(a, b, result, params, uint2(row, word_col));
+    gf2_multiply_aligned(a + batch_idx * batch.a_words, b + batch_idx * batch.b_words,
+                         result + batch_idx * batch.result_words, params, uint2(row, word_col));
 }
 
@@ -7,7 +7,9 @@
 //
 // This implementation is adapted from a CUDA version for the boolean semiring
 // and has been modified to perform GF(2) arithmetic (XOR-AND) and operate on
-// uint64_t packed data, consistent with the target framework.
+// uint64_t packed data, consistent with the target framework. The kernels are
+// templates on the arithmetic, and the *_boolean_kernel entry points run the
+// boolean semiring (OR-AND) again: tables of ORs, ORed into the result.
 
 #include <metal_stdlib>
 using namespace metal;
@@ -22,6 +24,16 @@ struct GPUParams {
     uint words_per_row_result;
 };
 
+// Batched dispatch: product gid.z reads and writes the matrices (and its own
+// set of lookup tables) at these word offsets from the buffer starts
+struct GPUBatchParams {
+    uint count;
+    uint a_words;
+    uint b_words;
+    uint result_words;
+    uint table_words;
+};
+
 // --- M4R Algorithm Constants ---
 
 // K_M4R: The number of bits used for a single table lookup key.
@@ -30,125 +42,150 @@ constant constexpr uint K_M4R = 8;
 // TABLE_ROWS: The number of entries in each lookup table (2^K_M4R).
 constant constexpr uint TABLE_ROWS = 1 << K_M4R; // 256
 
-// --- Bit-Twiddling Helper Functions ---
-
-// FIX: The 'function' keyword is not used for declaring standard helper functions in MSL.
-// It is removed from the declarations below. The 'inline' keyword is a valid hint.
-
-// Returns the least significant bit of an integer.
-inline uint lsb(uint i) {
-    return i & -i;
-}
-
-// "Snoob" (Stanford Nifty Organization or Bithacks) algorithm.
-// Returns the next integer with the same number of set bits.
-// This is used to efficiently build the lookup table by iterating through
-// keys with 2 set bits, then 3, and so on.
-inline uint snoob(uint i) {
-    uint least = lsb(i);
-    uint ripple = i + least;
-    // The original CUDA code used `(ripple ^ i) >> 2) / least`.
-    // This is equivalent to `((ripple ^ i) / least) >> 2`.
-    // We use the latter for clarity, though compilers often optimize this.
-    uint ones = ((ripple ^ i) / least) >> 2;
-    return ripple | ones;
-}
+// Blocked mode: one pass covers the panel of A words [k_word0, k_word0 +
+// k_words), i.e. k_words * 8 tables, and XORs into the result unless it is the
+// first panel. The host sizes panels so the tables stay within a fixed budget.
+struct GPUM4RPanel {
+    uint k_word0;
+    uint k_words;
+    uint accumulate;
+};
 
 
 // --- Kernel 1: Table Generation ---
 //
-// This kernel builds the M4R lookup tables.
-// We need one table for each 8-bit chunk of a row in matrix A.
-// Total tables = words_per_row_a * (64 / K_M4R)
+// This kernel builds the M4R lookup tables of one panel.
+// We need one table for each 8-bit chunk of the panel's words of A.
+// Total tables = panel.k_words * (64 / K_M4R)
 //
-// Each thread computes one column of one lookup table.
-// Grid dispatch: (words_per_row_b, words_per_row_a * 8)
-kernel void m4r_make_tables_kernel(
-    device const uint64_t* b [[buffer(0)]],
-    device uint64_t* lookup_tables [[buffer(1)]],
-    constant GPUParams& params [[buffer(2)]],
-    uint2 gid [[thread_position_in_grid]])
+// Each thread computes one column of one lookup table. Entries are filled in
+// Gray-code order, so each one costs a single XOR of the previous entry with
+// one row of B.
+// Grid dispatch: (words_per_row_b, panel.k_words * 8, batch count)
+template <bool BOOLEAN>
+static inline void m4r_make_tables(
+    device const uint64_t* b,
+    device uint64_t* lookup_tables,
+    constant GPUParams& params,
+    constant GPUBatchParams& batch,
+    constant GPUM4RPanel& panel,
+    uint3 gid)
 {
     uint word_col_idx = gid.x; // Which word column of the table to compute.
-    uint table_idx_flat = gid.y; // The flattened index of the table.
+    uint table_idx_flat = gid.y; // The flattened index of the table in the panel.
 
     // Boundary check.
-    uint num_tables = params.words_per_row_a * (64 / K_M4R);
-    if (word_col_idx >= params.words_per_row_b || table_idx_flat >= num_tables) {
+    uint num_tables = panel.k_words * (64 / K_M4R);
+    if (word_col_idx >= params.words_per_row_b || table_idx_flat >= num_tables ||
+        gid.z >= batch.count) {
         return;
     }
+    b += ulong(gid.z) * batch.b_words;
+    lookup_tables += ulong(gid.z) * batch.table_words;
 
     // Deconstruct the flat table index to find which rows of B to use.
-    uint table_word_idx = table_idx_flat / (64 / K_M4R); // Which word of A this table corresponds to.
+    uint table_word_idx = panel.k_word0 + table_idx_flat / (64 / K_M4R); // Word of A.
     uint sub_table_idx = table_idx_flat % (64 / K_M4R);  // Which 8-bit chunk within that word.
     uint b_start_row = table_word_idx * 64 + sub_table_idx * K_M4R;
 
     // Calculate a pointer to the start of the column this thread is responsible for.
     // Each table has TABLE_ROWS entries, and each entry is words_per_row_b wide.
-    device uint64_t* table_col_ptr = lookup_tables + (table_idx_flat * TABLE_ROWS * params.words_per_row_b) + word_col_idx;
-
-    // The entry for key 0 is always zero.
-    table_col_ptr[0] = 0;
+    device uint64_t* table_col_ptr = lookup_tables + (ulong(table_idx_flat) * TABLE_ROWS * params.words_per_row_b) + word_col_idx;
 
-    // Step 1: Fill base cases (keys with one bit set).
-    // These correspond to single rows from matrix B.
+    // Column word_col_idx of the K_M4R rows of B behind this table; rows past
+    // the common dimension are zero
+    uint64_t b_rows[K_M4R];
     for (uint i = 0; i < K_M4R; ++i) {
-        uint key = 1 << i;
         uint b_row_to_fetch = b_start_row + i;
+        b_rows[i] = b_row_to_fetch < params.a_cols
+                        ? b[ulong(b_row_to_fetch) * params.words_per_row_b + word_col_idx]
+                        : 0;
+    }
 
-        if (b_row_to_fetch < params.a_cols) {
-            // The stride between entries in this column is `params.words_per_row_b`.
-            table_col_ptr[key * params.words_per_row_b] = b[b_row_to_fetch * params.words_per_row_b + word_col_idx];
-        } else {
-            table_col_ptr[key * params.words_per_row_b] = 0;
+    if (BOOLEAN) {
+        // An OR cannot be undone, so no Gray code: entry g is the OR of the
+        // entries of its low and high nibbles, kept in registers
+        uint64_t lo[16], hi[16];
+        lo[0] = hi[0] = 0;
+        for (uint g = 1; g < 16; ++g) {
+            lo[g] = lo[g & (g - 1)] | b_rows[ctz(g)];
+            hi[g] = hi[g & (g - 1)] | b_rows[4 + ctz(g)];
+        }
+        for (uint g = 0; g < TABLE_ROWS; ++g) {
+            table_col_ptr[ulong(g) * params.words_per_row_b] = lo[g & 15] | hi[g >> 4];
         }
+        return;
     }
 
-    // Step 2: Fill the rest of the table using the snoob algorithm.
-    // We compute entries for keys with 2 bits, then 3, etc., up to K_M4R.
-    // Each entry is the XOR sum of two smaller entries.
-    for (uint h = 2; h <= K_M4R; ++h) {
-        uint i = (1 << h) - 1; // Start with the smallest number with h bits set.
-        while (i < TABLE_ROWS) {
-            uint least_bit = lsb(i);
-            uint rest = i - least_bit;
-            table_col_ptr[i * params.words_per_row_b] = table_col_ptr[least_bit * params.words_per_row_b] ^ table_col_ptr[rest * params.words_per_row_b];
-            i = snoob(i);
-        }
+    // The entry for key 0 is always zero. Entry gray(g) differs from entry
+    // gray(g - 1) by the row of the lowest set bit of g.
+    uint64_t entry = 0;
+    table_col_ptr[0] = 0;
+    for (uint g = 1; g < TABLE_ROWS; ++g) {
+        entry ^= b_rows[ctz(g)];
+        uint gray = g ^ (g >> 1);
+        table_col_ptr[ulong(gray) * params.words_per_row_b] = entry;
     }
 }
 
+kernel void m4r_make_tables_kernel(
+    device const uint64_t* b [[buffer(0)]],
+    device uint64_t* lookup_tables [[buffer(1)]],
+    constant GPUParams& params [[buffer(2)]],
+    constant GPUBatchParams& batch [[buffer(3)]],
+    constant GPUM4RPanel& panel [[buffer(4)]],
+    uint3 gid [[thread_position_in_grid]])
+{
+    m4r_make_tables<false>(b, lookup_tables, params, batch, panel, gid);
+}
+
+kernel void m4r_make_tables_boolean_kernel(
+    device const uint64_t* b [[buffer(0)]],
+    device uint64_t* lookup_tables [[buffer(1)]],
+    constant GPUParams& params [[buffer(2)]],
+    constant GPUBatchParams& batch [[buffer(3)]],
+    constant GPUM4RPanel& panel [[buffer(4)]],
+    uint3 gid [[thread_position_in_grid]])
+{
+    m4r_make_tables<true>(b, lookup_tables, params, batch, panel, gid);
+}
+
 
 // --- Kernel 2: Multiplication ---
 //
-// This kernel uses the pre-computed lookup tables to perform the multiplication.
+// This kernel uses the pre-computed lookup tables of one panel to perform
+// that panel's part of the multiplication. Key j of a word of A is its bits
+// [8j, 8j + 8), matching table j of the word.
 // Each thread computes one uint64_t word of the result matrix C.
-// Grid dispatch: (a_rows, words_per_row_result)
-kernel void m4r_multiply_kernel(
-    device const uint64_t* a [[buffer(0)]],
-    device uint64_t* result [[buffer(1)]],
-    device const uint64_t* lookup_tables [[buffer(2)]],
-    constant GPUParams& params [[buffer(3)]],
-    uint2 gid [[thread_position_in_grid]])
+// Grid dispatch: (a_rows, words_per_row_result, batch count)
+template <bool BOOLEAN>
+static inline void m4r_multiply(
+    device const uint64_t* a,
+    device uint64_t* result,
+    device const uint64_t* lookup_tables,
+    constant GPUParams& params,
+    constant GPUBatchParams& batch,
+    constant GPUM4RPanel& panel,
+    uint3 gid)
 {
     uint row_idx = gid.x;
     uint word_col_idx = gid.y; // Which word of the result row to compute.
 
     // Boundary check.
-    if (row_idx >= params.a_rows || word_col_idx >= params.words_per_row_result) {
+    if (row_idx >= params.a_rows || word_col_idx >= params.words_per_row_result ||
+        gid.z >= batch.count) {
         return;
     }
+    a += ulong(gid.z) * batch.a_words;
+    result += ulong(gid.z) * batch.result_words;
+    lookup_tables += ulong(gid.z) * batch.table_words;
 
     uint64_t result_word = 0;
 
-    // Iterate over the words in the row of A.
-    for (uint k_word = 0; k_word < params.words_per_row_a; ++k_word) {
+    // Iterate over the panel's words in the row of A.
+    for (uint k = 0; k < panel.k_words; ++k) {
         // Fetch a 64-bit word from matrix A.
-        uint64_t a_word = a[row_idx * params.words_per_row_a + k_word];
-
-        // The original CUDA code reversed bits. We preserve this behavior.
-        // It affects how the 8-bit keys are extracted from the 64-bit word.
-        a_word = reverse_bits(a_word);
+        uint64_t a_word = a[ulong(row_idx) * params.words_per_row_a + panel.k_word0 + k];
 
         // Process the 64-bit word in 8-bit chunks (keys).
         for (uint j = 0; j < (64 / K_M4R); ++j) {
@@ -160,22 +197,51 @@ kernel void m4r_multiply_kernel(
             }
 
             // Find the correct lookup table.
-            uint table_idx_flat = k_word * (64 / K_M4R) + j;
-
-            // Pointer to the start of the correct table.
-            device const uint64_t* table_ptr = lookup_tables + (table_idx_flat * TABLE_ROWS * params.words_per_row_b);
+            uint table_idx_flat = k * (64 / K_M4R) + j;
 
             // Pointer to the specific row in the table corresponding to our key.
-            device const uint64_t* table_row_ptr = table_ptr + (key * params.words_per_row_b);
+            device const uint64_t* table_row_ptr =
+                lookup_tables + (ulong(table_idx_flat) * TABLE_ROWS + key) * params.words_per_row_b;
 
-            // Fetch the pre-computed value and XOR it into our result.
+            // Fetch the pre-computed value and add it into our result.
             // We fetch the word at `word_col_idx`, which corresponds to the
             // column of the result matrix this thread is computing.
-            result_word ^= table_row_ptr[word_col_idx];
+            if (BOOLEAN) {
+                result_word |= table_row_ptr[word_col_idx];
+            } else {
+                result_word ^= table_row_ptr[word_col_idx];
+            }
         }
     }
 
-    // Write the final computed word to the result matrix.
-    result[row_idx * params.words_per_row_result + word_col_idx] = result_word;
+    // Write (or, after the first panel, accumulate) the computed word.
+    device uint64_t* out = result + ulong(row_idx) * params.words_per_row_result + word_col_idx;
+    if (panel.accumulate) {
+        result_word = BOOLEAN ? (*out | result_word) : (*out ^ result_word);
+    }
+    *out = result_word;
 }
 
+kernel void m4r_multiply_kernel(
+    device const uint64_t* a [[buffer(0)]],
+    device uint64_t* result [[buffer(1)]],
+    device const uint64_t* lookup_tables [[buffer(2)]],
+    constant GPUParams& params [[buffer(3)]],
+    constant GPUBatchParams& batch [[buffer(4)]],
+    constant GPUM4RPanel& panel [[buffer(5)]],
+    uint3 gid [[thread_position_in_grid]])
+{
+    m4r_multiply<false>(a, result, lookup_tables, params, batch, panel, gid);
+}
+
+kernel void m4r_multiply_boolean_kernel(
+    device const uint64_t* a [[buffer(0)]],
+    device uint64_t* result [[buffer(1)]],
+    device const uint64_t* lookup_tables [[buffer(2)]],
+    constant GPUParams& params [[buffer(3)]],
+    constant GPUBatchParams& batch [[buffer(4)]],
+    constant GPUM4RPanel& panel [[buffer(5)]],
+    uint3 gid [[thread_position_in_grid]])
+{
+    m4r_multiply<true>(a, result, lookup_tables, params, batch, panel, gid);
+}
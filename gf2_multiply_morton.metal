@@ -0,0 +1,90 @@
+// --- File: gf2_multiply_morton.metal ---
+
+#include <metal_stdlib>
+using namespace metal;
+
+// Tile grids of C = A * B in the Morton-ordered tiled layout
+// (GF2TiledMatrix.hpp): C is m_tiles x n_tiles tiles and the common
+// dimension k_tiles tiles, each tile tile x tile bits of tile_words words
+// per row
+struct GF2MortonParams {
+    uint tile;
+    uint tile_words;
+    uint m_tiles;
+    uint k_tiles;
+    uint n_tiles;
+};
+
+#define MAX_TILE 256
+#define MAX_TILE_WORDS (MAX_TILE / 64)
+
+// gf2_morton_rank of GF2TiledMatrix.hpp: the Z-order position of tile
+// (i, j) among the tiles of a rows x cols grid
+static inline uint morton_rank(uint i, uint j, uint rows, uint cols) {
+    uint side = 1;
+    while (side < rows || side < cols) side *= 2;
+    uint rank = 0, r0 = 0, c0 = 0;
+    for (uint s = side / 2; s > 0; s /= 2) {
+        const uint h0 = rows > r0 ? min(s, rows - r0) : 0;
+        const uint h1 = rows > r0 + s ? min(s, rows - r0 - s) : 0;
+        const uint w0 = cols > c0 ? min(s, cols - c0) : 0;
+        const uint w1 = cols > c0 + s ? min(s, cols - c0 - s) : 0;
+        const bool down = i - r0 >= s, right = j - c0 >= s;
+        if (down) rank += h0 * (w0 + w1);
+        if (right) rank += (down ? h1 : h0) * w0;
+        r0 += down ? s : 0;
+        c0 += right ? s : 0;
+    }
+    return rank;
+}
+
+// One threadgroup of `tile` threads per tile of C, thread r computing row r
+// of it. Per tile of the common dimension the group copies the B tile into
+// threadgroup memory, consecutive threads reading consecutive words of the
+// one contiguous tile, and each thread reads its A row (tile_words
+// consecutive words) and XORs the staged B rows its bits select.
+// Grid dispatch: threadgroups (n_tiles, m_tiles) of (tile, 1) threads
+kernel void gf2_multiply_morton_kernel(
+    device const uint64_t* a [[buffer(0)]],
+    device const uint64_t* b [[buffer(1)]],
+    device uint64_t* c [[buffer(2)]],
+    constant GF2MortonParams& params [[buffer(3)]],
+    uint2 group_id [[threadgroup_position_in_grid]],
+    uint r [[thread_index_in_threadgroup]])
+{
+    threadgroup uint64_t b_tile[MAX_TILE * MAX_TILE_WORDS];
+
+    const uint i = group_id.y, j = group_id.x;
+    const uint tw = params.tile_words;
+    const uint tile_size = params.tile * tw;
+
+    uint64_t acc[MAX_TILE_WORDS] = {0, 0, 0, 0};
+    for (uint p = 0; p < params.k_tiles; ++p) {
+        device const uint64_t* bt =
+            b + ulong(morton_rank(p, j, params.k_tiles, params.n_tiles)) * tile_size;
+        for (uint x = r; x < tile_size; x += params.tile) {
+            b_tile[x] = bt[x];
+        }
+        threadgroup_barrier(mem_flags::mem_threadgroup);
+
+        device const uint64_t* at =
+            a + ulong(morton_rank(i, p, params.m_tiles, params.k_tiles)) * tile_size + r * tw;
+        for (uint w = 0; w < tw; ++w) {
+            const uint64_t word = at[w];
+            for (uint k = 0; k < 64; ++k) {
+                const uint64_t mask = 0 - ((word >> k) & 1);
+                threadgroup const uint64_t* row = b_tile + (w * 64 + k) * tw;
+                for (uint x = 0; x < tw; ++x) {
+                    acc[x] ^= row[x] & mask;
+                }
+            }
+        }
+        threadgroup_barrier(mem_flags::mem_threadgroup);
+    }
+
+    device uint64_t* ct =
+        c + ulong(morton_rank(i, j, params.m_tiles, params.n_tiles)) * tile_size + r * tw;
+    for (uint x = 0; x < tw; ++x) {
+        ct[x] = acc[x];
+    }
+}
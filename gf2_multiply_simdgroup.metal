@@ -0,0 +1,107 @@
+// --- File: gf2_multiply_simdgroup.metal ---
+
+#include <metal_stdlib>
+using namespace metal;
+
+// Use the same parameter struct as the C++ side for consistency.
+// This is identical to the struct in gf2_multiply_transposed.metal.
+struct GPUParams {
+    uint a_rows;
+    uint a_cols; // This is the common dimension, K
+    uint b_cols;
+    uint words_per_row_a;
+    uint words_per_row_b; // For the transposed B matrix
+    uint words_per_row_result;
+};
+
+// Batched dispatch: product gid.z reads and writes the matrices at these word
+// offsets from the buffer starts. Single products pass count = 1.
+struct GPUBatchParams {
+    uint count;
+    uint a_words;
+    uint b_words;
+    uint result_words;
+    uint table_words; // M4R only
+};
+
+// Number of words of the common dimension, set by the host for common shapes
+// so that the loop over it is unrolled. The generic pipeline leaves it
+// undefined and derives the count from GPUParams.
+constant uint simdgroup_k_words [[function_constant(0)]];
+constant bool simdgroup_fixed_k = is_function_constant_defined(simdgroup_k_words);
+
+#define SIMD_WIDTH 32
+
+// XOR of 'value' over the 32 lanes of the SIMD-group, in every lane
+inline uint simd_xor_reduce(uint value) {
+    for (ushort offset = SIMD_WIDTH / 2; offset > 0; offset /= 2) {
+        value ^= simd_shuffle_xor(value, offset);
+    }
+    return value;
+}
+
+// One SIMD-group computes one word of C from A and B^T. The lanes split the
+// common dimension: lane l reads words l, l + 32, ... of the A row and of the
+// 64 B^T rows, so every load of the group is one contiguous run of words.
+// Each lane folds its partial dot products into one parity bit per column,
+// and the 64 parity bits of the lanes are combined with a butterfly of
+// simd_shuffle_xor.
+//
+// Grid dispatch: (32 * words_per_row(C), a_rows, batch count), with
+// threadgroup widths that are a multiple of 32.
+kernel void gf2_multiply_simdgroup_batch(
+    device const uint64_t* a [[buffer(0)]],
+    device const uint64_t* b_transposed [[buffer(1)]],
+    device uint64_t* result [[buffer(2)]],
+    constant GPUParams& params [[buffer(3)]],
+    constant GPUBatchParams& batch [[buffer(4)]],
+    uint3 gid [[thread_position_in_grid]],
+    ushort lane [[thread_index_in_simdgroup]])
+{
+    uint c_word_col = gid.x / SIMD_WIDTH;
+    uint c_row = gid.y;
+
+    // The whole SIMD-group shares c_word_col and c_row, so it leaves together
+    // and the shuffles below never see inactive lanes.
+    if (c_row >= params.a_rows || c_word_col >= params.words_per_row_result ||
+        gid.z >= batch.count) {
+        return;
+    }
+
+    ulong z = gid.z;
+    device const uint64_t* a_row_ptr =
+        a + z * batch.a_words + ulong(c_row) * params.words_per_row_a;
+    device const uint64_t* b_t_ptr = b_transposed + z * batch.b_words;
+
+    uint common_dim_words = simdgroup_fixed_k ? simdgroup_k_words : (params.a_cols + 63) / 64;
+    uint col0 = c_word_col * 64;
+    uint cols = min(64u, params.b_cols - col0);
+
+    // Column j's parity of this lane's k slice at bit j
+    uint parity_lo = 0;
+    uint parity_hi = 0;
+
+    for (uint k = lane; k < common_dim_words; k += SIMD_WIDTH) {
+        uint64_t a_word = a_row_ptr[k];
+        if (a_word == 0) {
+            continue;
+        }
+        for (uint j = 0; j < cols; ++j) {
+            uint64_t b_word = b_t_ptr[ulong(col0 + j) * params.words_per_row_b + k];
+            uint bit = popcount(a_word & b_word) & 1;
+            if (j < 32) {
+                parity_lo ^= bit << j;
+            } else {
+                parity_hi ^= bit << (j - 32);
+            }
+        }
+    }
+
+    parity_lo = simd_xor_reduce(parity_lo);
+    parity_hi = simd_xor_reduce(parity_hi);
+
+    if (lane == 0) {
+        result[z * batch.result_words + ulong(c_row) * params.words_per_row_result + c_word_col] =
+            uint64_t(parity_lo) | (uint64_t(parity_hi) << 32);
+    }
+}
@@ -13,93 +13,111 @@ struct GF2Params {
     uint words_per_row_result;
 };
 
-// --- Bit Manipulation Helpers ---
-
-// FIX: Removed the boundary check from inside the helper. The calling kernel
-// already performs a more accurate check before calling this function.
-inline uint get_bit(device const uint64_t* data, uint row, uint col, uint words_per_row) {
-    uint word_idx = col / 64;
-    uint bit_idx = col % 64;
-    uint64_t word = data[row * words_per_row + word_idx];
-    return (word >> bit_idx) & 1ULL;
-}
-
-// FIX: Corrected the latent type mismatch bug. The result buffer is atomic_uint (32-bit),
-// so the mask must also be a 32-bit uint.
-inline void set_bit_atomic(volatile device atomic_uint* data, uint row, uint col, uint words_per_row) {
-    uint word_idx = col / 64;
-    uint bit_idx = col % 64;
-    // The mask must be 'uint' to match the 'atomic_uint' base type.
-    uint mask = 1U << bit_idx;
-    atomic_fetch_or_explicit(&data[row * words_per_row + word_idx], mask, memory_order_relaxed);
-}
-
-
-// --- Tiled Multiplication Kernel ---
-
-#define TILE_WIDTH 32
 
+// --- Word-Tiled Multiplication Kernel ---
+//
+// Row i of C is the XOR of the rows of B selected by the bits of row i of A,
+// so each result word is computed from whole words of B without any parity
+// reduction. A threadgroup of 16 x 16 threads computes a tile of TILE_ROWS
+// rows by TILE_WORDS words of C. Per step it stages K_TILE_WORDS words of its
+// A rows and the matching K_TILE_WORDS * 64 rows of B (restricted to the
+// tile's words) in threadgroup memory. Each thread keeps ROWS_PER_THREAD
+// result words of one column in registers, so every staged word of B is
+// reused for ROWS_PER_THREAD rows. Whole words are written, no atomics.
+
+#define TILE_WORDS 16
+#define ROWS_PER_THREAD 4
+#define TILE_ROWS (16 * ROWS_PER_THREAD)
+#define K_TILE_WORDS 2
+#define THREADS_PER_GROUP 256
+
+// Grid dispatch: threadgroups (ceil(words_per_row(C) / TILE_WORDS),
+// ceil(a_rows / TILE_ROWS)) of 16 x 16 threads
 kernel void gf2_multiply_tiled_kernel(
     device const uint64_t* a [[buffer(0)]],
     device const uint64_t* b [[buffer(1)]],
-    volatile device atomic_uint* result [[buffer(2)]],
+    device uint64_t* result [[buffer(2)]],
     constant GF2Params& params [[buffer(3)]],
-    uint2 gid [[thread_position_in_grid]],
-    // FIX: Use the correct attribute for a 2D vector thread coordinate.
-    uint2 tid_in_group [[thread_position_in_threadgroup]])
+    uint2 group_id [[threadgroup_position_in_grid]],
+    uint2 tid_in_group [[thread_position_in_threadgroup]],
+    uint tid_flat [[thread_index_in_threadgroup]])
 {
-    // Global position of the bit this thread will compute
-    uint row = gid.x;
-    uint col = gid.y;
-
-    // Local position of the thread within its 32x32 threadgroup
-    uint local_row = tid_in_group.x;
-    uint local_col = tid_in_group.y;
-
-    // Declare fast on-chip threadgroup (shared) memory
-    threadgroup uint a_tile[TILE_WIDTH][TILE_WIDTH];
-    threadgroup uint b_tile[TILE_WIDTH][TILE_WIDTH];
-
-    uint sum = 0;
-    uint num_tiles = (params.a_cols + TILE_WIDTH - 1) / TILE_WIDTH;
-
-    // Loop over the tiles along the common dimension 'k'
-    for (uint tile_k = 0; tile_k < num_tiles; ++tile_k) {
-        // Calculate the global memory coordinates for this tile
-        uint tile_k_offset = tile_k * TILE_WIDTH;
-        uint a_col_to_load = tile_k_offset + local_col;
-        uint b_row_to_load = tile_k_offset + local_row;
-
-        // Load one bit into the A tile. This is a COALESCED read.
-        if (row < params.a_rows && a_col_to_load < params.a_cols) {
-            a_tile[local_row][local_col] = get_bit(a, row, a_col_to_load, params.words_per_row_a);
-        } else {
-            a_tile[local_row][local_col] = 0;
+    threadgroup uint64_t a_tile[TILE_ROWS][K_TILE_WORDS];
+    threadgroup uint64_t b_tile[K_TILE_WORDS * 64][TILE_WORDS];
+
+    const uint result_words = (params.b_cols + 63) / 64;
+    const uint k_words = (params.a_cols + 63) / 64;
+    const uint row0 = group_id.y * TILE_ROWS;
+    const uint word0 = group_id.x * TILE_WORDS;
+
+    // This thread's result column and its rows within the tile
+    const uint word_col = word0 + tid_in_group.x;
+    const uint local_row0 = tid_in_group.y * ROWS_PER_THREAD;
+
+    uint64_t acc[ROWS_PER_THREAD];
+    for (uint r = 0; r < ROWS_PER_THREAD; ++r) {
+        acc[r] = 0;
+    }
+
+    for (uint k0 = 0; k0 < k_words; k0 += K_TILE_WORDS) {
+        // Stage the A words. Rows past the end of A are zero.
+        for (uint i = tid_flat; i < TILE_ROWS * K_TILE_WORDS; i += THREADS_PER_GROUP) {
+            uint r = i / K_TILE_WORDS;
+            uint kw = i % K_TILE_WORDS;
+            uint row = row0 + r;
+            a_tile[r][kw] = (row < params.a_rows && k0 + kw < k_words)
+                                ? a[ulong(row) * params.words_per_row_a + k0 + kw]
+                                : 0;
         }
 
-        // Load one bit into the B tile. This is a STRIDED read.
-        // Perform an on-the-fly transpose: store at [local_col][local_row].
-        if (b_row_to_load < params.a_cols && col < params.b_cols) {
-            b_tile[local_col][local_row] = get_bit(b, b_row_to_load, col, params.words_per_row_b);
-        } else {
-            b_tile[local_col][local_row] = 0;
+        // Stage the B rows. Consecutive threads read consecutive words of a
+        // row; rows past the common dimension and words past the end of a row
+        // are zero, so stray bits of A beyond a_cols add nothing.
+        for (uint i = tid_flat; i < K_TILE_WORDS * 64 * TILE_WORDS; i += THREADS_PER_GROUP) {
+            uint r = i / TILE_WORDS;
+            uint w = i % TILE_WORDS;
+            uint b_row = k0 * 64 + r;
+            b_tile[r][w] = (b_row < params.a_cols && word0 + w < result_words)
+                               ? b[ulong(b_row) * params.words_per_row_b + word0 + w]
+                               : 0;
         }
 
-        // Synchronize all threads in the group to ensure tiles are fully loaded
         threadgroup_barrier(mem_flags::mem_threadgroup);
 
-        // Compute partial dot product from fast threadgroup memory
-        for (uint k_local = 0; k_local < TILE_WIDTH; ++k_local) {
-            sum ^= a_tile[local_row][k_local] & b_tile[k_local][local_col];
+        for (uint kw = 0; kw < K_TILE_WORDS; ++kw) {
+            uint64_t a_words[ROWS_PER_THREAD];
+            for (uint r = 0; r < ROWS_PER_THREAD; ++r) {
+                a_words[r] = a_tile[local_row0 + r][kw];
+            }
+
+            for (uint bit = 0; bit < 64; ++bit) {
+                uint64_t b_word = b_tile[kw * 64 + bit][tid_in_group.x];
+                for (uint r = 0; r < ROWS_PER_THREAD; ++r) {
+                    // All ones when bit 'bit' of the A word is set
+                    uint64_t mask = 0 - ((a_words[r] >> bit) & 1);
+                    acc[r] ^= b_word & mask;
+                }
+            }
         }
 
         // Synchronize again before the next iteration loads new data
         threadgroup_barrier(mem_flags::mem_threadgroup);
     }
 
-    // After all tiles are processed, write the final result to global memory if non-zero.
-    if (sum && row < params.a_rows && col < params.b_cols) {
-        set_bit_atomic(result, row, col, params.words_per_row_result);
+    if (word_col >= result_words) {
+        return;
     }
-}
 
+    // B may carry stale bits beyond its last column; keep C's padding zero
+    uint tail = params.b_cols % 64;
+    uint64_t col_mask = (word_col == result_words - 1 && tail != 0)
+                            ? ((uint64_t(1) << tail) - 1)
+                            : ~uint64_t(0);
+
+    for (uint r = 0; r < ROWS_PER_THREAD; ++r) {
+        uint row = row0 + local_row0 + r;
+        if (row < params.a_rows) {
+            result[ulong(row) * params.words_per_row_result + word_col] = acc[r] & col_mask;
+        }
+    }
+}
@@ -11,6 +11,22 @@ struct GPUParams {
     uint words_per_row_result;
 };
 
+// Batched dispatch: product gid.z reads and writes the matrices at these word
+// offsets from the buffer starts. Single products pass count = 1.
+struct GPUBatchParams {
+    uint count;
+    uint a_words;
+    uint b_words;
+    uint result_words;
+    uint table_words; // M4R only
+};
+
+// Number of words of the common dimension, set by the host for common shapes
+// so that the loop over it is unrolled. The generic pipeline leaves it
+// undefined and derives the count from GPUParams.
+constant uint transposed_k_words [[function_constant(0)]];
+constant bool transposed_fixed_k = is_function_constant_defined(transposed_k_words);
+
 // --- FIX STARTS HERE ---
 
 // This is a standard helper function. It is declared without any special
@@ -31,10 +47,10 @@ void gf2_multiply_transposed_logic(
     }
 
     // Pointer to the start of the relevant row in A.
-    device const uint64_t* a_row_ptr = a + c_row * params.words_per_row_a;
+    device const uint64_t* a_row_ptr = a + ulong(c_row) * params.words_per_row_a;
     
     uint64_t result_word = 0;
-    uint common_dim_words = params.a_cols / 64;
+    uint common_dim_words = transposed_fixed_k ? transposed_k_words : (params.a_cols + 63) / 64;
 
     // This outer loop calculates each of the 64 bits for our target result word.
     for (uint bit_idx = 0; bit_idx < 64; ++bit_idx) {
@@ -43,7 +59,7 @@ void gf2_multiply_transposed_logic(
         if (b_col_original >= params.b_cols) continue;
 
         // In the transposed matrix, this corresponds to a full row.
-        device const uint64_t* b_t_row_ptr = b_transposed + b_col_original * params.words_per_row_b;
+        device const uint64_t* b_t_row_ptr = b_transposed + ulong(b_col_original) * params.words_per_row_b;
 
         // --- Perform the dot product for a single result bit ---
         uint64_t dot_product_acc = 0;
@@ -57,7 +73,7 @@ void gf2_multiply_transposed_logic(
         }
     }
 
-    result[c_row * params.words_per_row_result + c_word_col] = result_word;
+    result[ulong(c_row) * params.words_per_row_result + c_word_col] = result_word;
 }
 
 
@@ -68,13 +84,16 @@ kernel void gf2_multiply_transposed_batch(
     device const uint64_t* b_transposed [[buffer(1)]],
     device uint64_t* result [[buffer(2)]],
     constant GPUParams& params [[buffer(3)]],
+    constant GPUBatchParams& batch [[buffer(4)]],
     uint3 gid [[thread_position_in_grid]]) {
     
-    // For now, single batch. This structure allows for future expansion.
-    if (gid.z >= 1) return;
+    if (gid.z >= batch.count) return;
     
     // It now correctly calls the helper function, passing along the arguments.
-    gf2_multiply_transposed_logic(a, b_transposed, result, params, gid.xy);
+    ulong z = gid.z;
+    gf2_multiply_transposed_logic(a + z * batch.a_words,
+                                  b_transposed + z * batch.b_words,
+                                  result + z * batch.result_words, params, gid.xy);
 }
 
 // --- FIX ENDS HERE ---
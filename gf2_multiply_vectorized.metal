@@ -14,6 +14,22 @@ struct GPUParams {
     uint words_per_row_result;
 };
 
+// Batched dispatch: product gid.z reads and writes the matrices at these word
+// offsets from the buffer starts. Single products pass count = 1.
+struct GPUBatchParams {
+    uint count;
+    uint a_words;
+    uint b_words;
+    uint result_words;
+    uint table_words; // M4R only
+};
+
+// Number of words of the common dimension, set by the host for common shapes
+// so that the loop over it is unrolled. The generic pipeline leaves it
+// undefined and derives the count from GPUParams.
+constant uint vectorized_k_words [[function_constant(0)]];
+constant bool vectorized_fixed_k = is_function_constant_defined(vectorized_k_words);
+
 // This is the logic function that performs the vectorized multiplication.
 // It's designed to be called by the main kernel entry point.
 void gf2_multiply_vectorized_logic(
@@ -31,10 +47,10 @@ void gf2_multiply_vectorized_logic(
     }
 
     // Pointer to the start of the relevant row in A.
-    device const uint64_t* a_row_ptr = a + c_row * params.words_per_row_a;
+    device const uint64_t* a_row_ptr = a + ulong(c_row) * params.words_per_row_a;
     
     uint64_t result_word = 0;
-    uint common_dim_words = params.a_cols / 64;
+    uint common_dim_words = vectorized_fixed_k ? vectorized_k_words : (params.a_cols + 63) / 64;
 
     // This outer loop calculates each of the 64 bits for our target result word.
     for (uint bit_idx = 0; bit_idx < 64; ++bit_idx) {
@@ -42,7 +58,7 @@ void gf2_multiply_vectorized_logic(
         if (b_col_original >= params.b_cols) continue;
 
         // In the transposed matrix, this corresponds to a full row.
-        device const uint64_t* b_t_row_ptr = b_transposed + b_col_original * params.words_per_row_b;
+        device const uint64_t* b_t_row_ptr = b_transposed + ulong(b_col_original) * params.words_per_row_b;
 
         // --- Vectorized Dot Product for a single result bit ---
         
@@ -74,7 +90,7 @@ void gf2_multiply_vectorized_logic(
         }
     }
 
-    result[c_row * params.words_per_row_result + c_word_col] = result_word;
+    result[ulong(c_row) * params.words_per_row_result + c_word_col] = result_word;
 }
 
 
@@ -84,12 +100,15 @@ kernel void gf2_multiply_vectorized_batch(
     device const uint64_t* b_transposed [[buffer(1)]],
     device uint64_t* result [[buffer(2)]],
     constant GPUParams& params [[buffer(3)]],
+    constant GPUBatchParams& batch [[buffer(4)]],
     uint3 gid [[thread_position_in_grid]]) {
     
-    // For now, single batch. This structure allows for future expansion.
-    if (gid.z >= 1) return;
+    if (gid.z >= batch.count) return;
     
     // Call the vectorized logic function.
-    gf2_multiply_vectorized_logic(a, b_transposed, result, params, gid.xy);
+    ulong z = gid.z;
+    gf2_multiply_vectorized_logic(a + z * batch.a_words,
+                                  b_transposed + z * batch.b_words,
+                                  result + z * batch.result_words, params, gid.xy);
 }
 
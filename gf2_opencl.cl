@@ -0,0 +1,437 @@
+// --- File: gf2_opencl.cl ---
+//
+// OpenCL C ports of the Metal kernels for the GF2OpenCL backend: the GPU
+// transpose of B, the transposed and vectorized multiplies reading B^T and
+// the two passes of the M4R multiply, the products with blocks of vectors,
+// A^T * B and the product in the Morton-ordered tiled layout. Single
+// products only. The structs match the ones in
+// GF2OpenCL.cpp and are passed by value.
+
+typedef struct {
+    uint a_rows;
+    uint a_cols; // The common dimension, K
+    uint b_cols;
+    uint words_per_row_a;
+    uint words_per_row_b;
+    uint words_per_row_result;
+} GPUParams;
+
+typedef struct {
+    uint rows;       // of the source
+    uint cols;       // of the source
+    uint src_stride; // words per source row
+    uint dst_stride; // words per destination row
+} GF2TransposeParams;
+
+// One M4R pass covers the A words [k_word0, k_word0 + k_words) and XORs into
+// the result unless it is the first panel
+typedef struct {
+    uint k_word0;
+    uint k_words;
+    uint accumulate;
+} GPUM4RPanel;
+
+// A of the products with n x 64 blocks of vectors
+typedef struct {
+    uint rows;
+    uint cols;
+    uint words;  // words per row that hold columns
+    uint stride; // row stride of A
+} GF2BlockParams;
+
+// Shape of A^T * B
+typedef struct {
+    uint rows; // of A and B, the common dimension
+    uint cols; // of A, the rows of the result
+    uint a_words;
+    uint b_words;
+    uint a_stride;
+    uint b_stride;
+    uint result_stride;
+} GF2AtBParams;
+
+// Shape of one triangle of A * A^T
+typedef struct {
+    uint rows;  // of A, and the rows and columns of the result
+    uint words; // words per row of A that hold columns
+    uint stride;
+    uint result_stride;
+    uint upper; // the upper triangle, else the lower one
+} GF2AAtParams;
+
+// Tile grids of a product in the tiled layout (GF2TiledMatrix.hpp)
+typedef struct {
+    uint tile; // 64 or 256 bits
+    uint tile_words;
+    uint m_tiles;
+    uint k_tiles;
+    uint n_tiles;
+} GF2MortonParams;
+
+#define BLOCK 64
+#define K_M4R 8
+#define TABLE_ROWS (1 << K_M4R)
+
+// dst = src^T, one work-group of 64 items per 64x64 bit block, with the
+// butterfly of gf2_transpose.metal.
+// NDRange: (64 * dst_stride, ceil(cols / 64)), work-groups (64, 1).
+__kernel void gf2_transpose_kernel(__global const ulong* src,
+                                   __global ulong* dst,
+                                   GF2TransposeParams params)
+{
+    __local ulong block[BLOCK];
+
+    uint bi = get_group_id(0);
+    uint bj = get_group_id(1);
+    uint tid = get_local_id(0);
+
+    uint src_row = bi * BLOCK + tid;
+    ulong word = 0;
+    if (src_row < params.rows && bj * BLOCK < params.cols) {
+        word = src[(ulong)src_row * params.src_stride + bj];
+        uint valid = min((uint)BLOCK, params.cols - bj * BLOCK);
+        if (valid < BLOCK) {
+            word &= (1UL << valid) - 1;
+        }
+    }
+    block[tid] = word;
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    const ulong masks[6] = {
+        0x00000000FFFFFFFFUL, 0x0000FFFF0000FFFFUL, 0x00FF00FF00FF00FFUL,
+        0x0F0F0F0F0F0F0F0FUL, 0x3333333333333333UL, 0x5555555555555555UL,
+    };
+    uint stage = 0;
+    for (uint j = 32; j >= 1; j >>= 1, ++stage) {
+        if ((tid & j) == 0) {
+            ulong lo = block[tid];
+            ulong hi = block[tid + j];
+            ulong t = ((lo >> j) ^ hi) & masks[stage];
+            block[tid] = lo ^ (t << j);
+            block[tid + j] = hi ^ t;
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    uint dst_row = bj * BLOCK + tid;
+    if (dst_row < params.cols) {
+        dst[(ulong)dst_row * params.dst_stride + bi] = block[tid];
+    }
+}
+
+// One work-item per result word: bit j is the parity of the AND of the A row
+// with row 64 * word + j of B^T.
+// NDRange: (a_rows, words_per_row(C))
+__kernel void gf2_multiply_transposed_kernel(__global const ulong* a,
+                                             __global const ulong* b_transposed,
+                                             __global ulong* result,
+                                             GPUParams params)
+{
+    uint c_row = get_global_id(0);
+    uint c_word_col = get_global_id(1);
+    if (c_row >= params.a_rows || c_word_col >= params.words_per_row_result) {
+        return;
+    }
+
+    __global const ulong* a_row = a + (ulong)c_row * params.words_per_row_a;
+    uint k_words = (params.a_cols + 63) / 64;
+
+    ulong result_word = 0;
+    for (uint bit = 0; bit < 64; ++bit) {
+        uint b_col = c_word_col * 64 + bit;
+        if (b_col >= params.b_cols) {
+            break;
+        }
+        __global const ulong* b_t_row = b_transposed + (ulong)b_col * params.words_per_row_b;
+        ulong acc = 0;
+        for (uint k = 0; k < k_words; ++k) {
+            acc ^= a_row[k] & b_t_row[k];
+        }
+        result_word |= (ulong)(popcount(acc) & 1) << bit;
+    }
+    result[(ulong)c_row * params.words_per_row_result + c_word_col] = result_word;
+}
+
+// The transposed kernel with 256-bit loads of A and B^T (ulong4), the tail
+// words one at a time.
+// NDRange: (a_rows, words_per_row(C))
+__kernel void gf2_multiply_vectorized_kernel(__global const ulong* a,
+                                             __global const ulong* b_transposed,
+                                             __global ulong* result,
+                                             GPUParams params)
+{
+    uint c_row = get_global_id(0);
+    uint c_word_col = get_global_id(1);
+    if (c_row >= params.a_rows || c_word_col >= params.words_per_row_result) {
+        return;
+    }
+
+    __global const ulong* a_row = a + (ulong)c_row * params.words_per_row_a;
+    uint k_words = (params.a_cols + 63) / 64;
+    uint k_vecs = k_words / 4;
+
+    ulong result_word = 0;
+    for (uint bit = 0; bit < 64; ++bit) {
+        uint b_col = c_word_col * 64 + bit;
+        if (b_col >= params.b_cols) {
+            break;
+        }
+        __global const ulong* b_t_row = b_transposed + (ulong)b_col * params.words_per_row_b;
+
+        ulong4 acc_vec = (ulong4)(0);
+        for (uint v = 0; v < k_vecs; ++v) {
+            acc_vec ^= vload4(v, a_row) & vload4(v, b_t_row);
+        }
+        ulong acc = acc_vec.x ^ acc_vec.y ^ acc_vec.z ^ acc_vec.w;
+        for (uint k = k_vecs * 4; k < k_words; ++k) {
+            acc ^= a_row[k] & b_t_row[k];
+        }
+        result_word |= (ulong)(popcount(acc) & 1) << bit;
+    }
+    result[(ulong)c_row * params.words_per_row_result + c_word_col] = result_word;
+}
+
+// M4R pass 1: the 8 tables of 256 entries per A word of the panel, one
+// work-item per table and word column, entries in Gray-code order.
+// NDRange: (words_per_row(B), panel.k_words * 8)
+__kernel void m4r_make_tables_kernel(__global const ulong* b,
+                                     __global ulong* lookup_tables,
+                                     GPUParams params,
+                                     GPUM4RPanel panel)
+{
+    uint word_col = get_global_id(0);
+    uint table = get_global_id(1);
+    if (word_col >= params.words_per_row_b || table >= panel.k_words * (64 / K_M4R)) {
+        return;
+    }
+
+    uint b_start_row = (panel.k_word0 + table / (64 / K_M4R)) * 64 + (table % (64 / K_M4R)) * K_M4R;
+    __global ulong* column = lookup_tables + (ulong)table * TABLE_ROWS * params.words_per_row_b + word_col;
+
+    ulong b_rows[K_M4R];
+    for (uint i = 0; i < K_M4R; ++i) {
+        uint row = b_start_row + i;
+        b_rows[i] = row < params.a_cols ? b[(ulong)row * params.words_per_row_b + word_col] : 0;
+    }
+
+    ulong entry = 0;
+    column[0] = 0;
+    for (uint g = 1; g < TABLE_ROWS; ++g) {
+        entry ^= b_rows[31 - clz(g & -g)]; // ctz is OpenCL 2.0
+        uint gray = g ^ (g >> 1);
+        column[(ulong)gray * params.words_per_row_b] = entry;
+    }
+}
+
+// M4R pass 2: one work-item per result word, one table lookup per byte of
+// the panel's A words.
+// NDRange: (a_rows, words_per_row(C))
+__kernel void m4r_multiply_kernel(__global const ulong* a,
+                                  __global ulong* result,
+                                  __global const ulong* lookup_tables,
+                                  GPUParams params,
+                                  GPUM4RPanel panel)
+{
+    uint row = get_global_id(0);
+    uint word_col = get_global_id(1);
+    if (row >= params.a_rows || word_col >= params.words_per_row_result) {
+        return;
+    }
+
+    ulong result_word = 0;
+    for (uint k = 0; k < panel.k_words; ++k) {
+        ulong a_word = a[(ulong)row * params.words_per_row_a + panel.k_word0 + k];
+        for (uint j = 0; j < 64 / K_M4R; ++j) {
+            uint key = (a_word >> (j * K_M4R)) & 0xFF;
+            if (key == 0) {
+                continue;
+            }
+            uint table = k * (64 / K_M4R) + j;
+            result_word ^= lookup_tables[((ulong)table * TABLE_ROWS + key) * params.words_per_row_b + word_col];
+        }
+    }
+
+    __global ulong* out = result + (ulong)row * params.words_per_row_result + word_col;
+    *out = panel.accumulate ? (*out ^ result_word) : result_word;
+}
+
+// y = A * x for a cols x 64 block x (row k in word k): one work-item per row
+// of A, XORing the words of x its bits select.
+// NDRange: (rows)
+__kernel void gf2_matvec_block_kernel(__global const ulong* a,
+                                      __global const ulong* x,
+                                      __global ulong* y,
+                                      GF2BlockParams params)
+{
+    uint row = get_global_id(0);
+    if (row >= params.rows) {
+        return;
+    }
+    __global const ulong* a_row = a + (ulong)row * params.stride;
+    ulong sum = 0;
+    for (uint w = 0; w < params.words; ++w) {
+        ulong bits = a_row[w];
+        while (bits != 0) {
+            sum ^= x[(ulong)w * 64 + 63 - clz(bits & -bits)];
+            bits &= bits - 1;
+        }
+    }
+    y[row] = sum;
+}
+
+// y = x^T * A for a rows x 64 block x: 64 rows of params.words words, one
+// work-item per word. The 64 items of a word read the same words of A and x.
+// NDRange: (64, words)
+__kernel void gf2_matvec_left_block_kernel(__global const ulong* a,
+                                           __global const ulong* x,
+                                           __global ulong* y,
+                                           GF2BlockParams params)
+{
+    uint j = get_global_id(0);
+    uint word = get_global_id(1);
+    if (j >= 64 || word >= params.words) {
+        return;
+    }
+    ulong acc = 0;
+    for (uint r = 0; r < params.rows; ++r) {
+        ulong select = 0 - ((x[r] >> j) & 1);
+        acc ^= a[(ulong)r * params.stride + word] & select;
+    }
+    y[(ulong)j * params.words + word] = acc;
+}
+
+// C = A^T * B, row i the XOR of the rows of B at the ones of column i of A:
+// word z of A's rows is the x of the left block product for rows
+// [64z, 64z + 64).
+// NDRange: (64, b_words, a_words), one work-item per word of C.
+__kernel void gf2_multiply_at_b_kernel(__global const ulong* a,
+                                       __global const ulong* b,
+                                       __global ulong* c,
+                                       GF2AtBParams params)
+{
+    uint j = get_global_id(0);
+    uint word = get_global_id(1);
+    uint z = get_global_id(2);
+    uint row = z * 64 + j;
+    if (j >= 64 || word >= params.b_words || row >= params.cols) {
+        return;
+    }
+    ulong acc = 0;
+    for (uint r = 0; r < params.rows; ++r) {
+        ulong select = 0 - ((a[(ulong)r * params.a_stride + z] >> j) & 1);
+        acc ^= b[(ulong)r * params.b_stride + word] & select;
+    }
+    c[(ulong)row * params.result_stride + word] = acc;
+}
+
+// One triangle of C = A * A^T, as gf2_matvec.metal: bit b of word w of row
+// i is the parity of row i of A AND row 64w + b, the other triangle's words
+// are zero and the diagonal word is cut at column i.
+// NDRange: (rows, result words), one work-item per word of C.
+__kernel void gf2_multiply_aat_kernel(__global const ulong* a,
+                                      __global ulong* c,
+                                      GF2AAtParams params)
+{
+    uint i = get_global_id(0);
+    uint word = get_global_id(1);
+    if (i >= params.rows || word >= (params.rows + 63) / 64) {
+        return;
+    }
+    __global ulong* out = c + (ulong)i * params.result_stride + word;
+    uint diagonal_word = i / 64;
+    if (params.upper ? word < diagonal_word : word > diagonal_word) {
+        *out = 0;
+        return;
+    }
+    __global const ulong* row = a + (ulong)i * params.stride;
+    ulong acc = 0;
+    for (uint b = 0; b < 64; ++b) {
+        uint j = word * 64 + b;
+        if (j >= params.rows) {
+            break;
+        }
+        __global const ulong* other = a + (ulong)j * params.stride;
+        ulong dot = 0;
+        for (uint k = 0; k < params.words; ++k) {
+            dot ^= row[k] & other[k];
+        }
+        acc |= (ulong)(popcount(dot) & 1) << b;
+    }
+    if (word == diagonal_word) {
+        ulong bit = (ulong)1 << (i % 64);
+        acc &= params.upper ? ~(bit - 1) : (bit << 1) - 1;
+    }
+    *out = acc;
+}
+
+#define MAX_TILE 256
+#define MAX_TILE_WORDS (MAX_TILE / 64)
+
+// gf2_morton_rank of GF2TiledMatrix.hpp: the Z-order position of tile
+// (i, j) among the tiles of a rows x cols grid
+uint morton_rank(uint i, uint j, uint rows, uint cols)
+{
+    uint side = 1;
+    while (side < rows || side < cols) side *= 2;
+    uint rank = 0, r0 = 0, c0 = 0;
+    for (uint s = side / 2; s > 0; s /= 2) {
+        uint h0 = rows > r0 ? min(s, rows - r0) : 0;
+        uint h1 = rows > r0 + s ? min(s, rows - r0 - s) : 0;
+        uint w0 = cols > c0 ? min(s, cols - c0) : 0;
+        uint w1 = cols > c0 + s ? min(s, cols - c0 - s) : 0;
+        bool down = i - r0 >= s, right = j - c0 >= s;
+        if (down) rank += h0 * (w0 + w1);
+        if (right) rank += (down ? h1 : h0) * w0;
+        r0 += down ? s : 0;
+        c0 += right ? s : 0;
+    }
+    return rank;
+}
+
+// C = A * B in the tiled layout, as gf2_multiply_morton.metal: one
+// work-group per tile of C, item r computing row r, the B tile of each step
+// staged in local memory with consecutive items reading consecutive words.
+// NDRange: (n_tiles * tile, m_tiles), work-groups (tile, 1).
+__kernel void gf2_multiply_morton_kernel(__global const ulong* a,
+                                         __global const ulong* b,
+                                         __global ulong* c,
+                                         GF2MortonParams params)
+{
+    __local ulong b_tile[MAX_TILE * MAX_TILE_WORDS];
+
+    uint j = get_group_id(0);
+    uint i = get_group_id(1);
+    uint r = get_local_id(0);
+    uint tw = params.tile_words;
+    uint tile_size = params.tile * tw;
+
+    ulong acc[MAX_TILE_WORDS] = {0, 0, 0, 0};
+    for (uint p = 0; p < params.k_tiles; ++p) {
+        __global const ulong* bt =
+            b + (ulong)morton_rank(p, j, params.k_tiles, params.n_tiles) * tile_size;
+        for (uint x = r; x < tile_size; x += params.tile) {
+            b_tile[x] = bt[x];
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        __global const ulong* at =
+            a + (ulong)morton_rank(i, p, params.m_tiles, params.k_tiles) * tile_size + r * tw;
+        for (uint w = 0; w < tw; ++w) {
+            ulong word = at[w];
+            for (uint k = 0; k < 64; ++k) {
+                ulong mask = 0 - ((word >> k) & 1);
+                __local const ulong* row = b_tile + (w * 64 + k) * tw;
+                for (uint x = 0; x < tw; ++x) {
+                    acc[x] ^= row[x] & mask;
+                }
+            }
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    __global ulong* ct =
+        c + (ulong)morton_rank(i, j, params.m_tiles, params.n_tiles) * tile_size + r * tw;
+    for (uint x = 0; x < tw; ++x) {
+        ct[x] = acc[x];
+    }
+}
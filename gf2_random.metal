@@ -0,0 +1,63 @@
+// --- File: gf2_random.metal ---
+//
+// Random matrices generated on the GPU, for device-resident operands: the
+// counter-based Philox4x32-10 stream of GF2Random.hpp, so a seed gives the
+// same bits as GF2Matrix::randomFill(seed) on the CPU.
+
+#include <metal_stdlib>
+using namespace metal;
+
+struct GF2RandomParams {
+    uint rows;
+    uint words;     // words per row that hold columns
+    uint stride;    // words per row in the buffer
+    uint seed_lo;
+    uint seed_hi;
+    uint last_bits; // columns in the last word, 0 for a whole word
+};
+
+constant uint PHILOX_M0 = 0xD2511F53u;
+constant uint PHILOX_M1 = 0xCD9E8D57u;
+constant uint PHILOX_W0 = 0x9E3779B9u;
+constant uint PHILOX_W1 = 0xBB67AE85u;
+
+// Grid dispatch: ((stride + 1) / 2, rows). Thread (t, r) runs Philox on the
+// counter (t, 0, r, 0) and writes words 2t and 2t + 1 of row r: the halves
+// of the output, masked to the columns, or zero in the row's padding.
+kernel void gf2_random_kernel(
+    device uint64_t* result [[buffer(0)]],
+    constant GF2RandomParams& params [[buffer(1)]],
+    uint2 gid [[thread_position_in_grid]])
+{
+    uint t = gid.x;
+    uint row = gid.y;
+    if (row >= params.rows || 2 * t >= params.stride) {
+        return;
+    }
+    uint x0 = t, x1 = 0, x2 = row, x3 = 0;
+    uint k0 = params.seed_lo, k1 = params.seed_hi;
+    for (int round = 0; round < 10; ++round) {
+        uint hi0 = mulhi(PHILOX_M0, x0), lo0 = PHILOX_M0 * x0;
+        uint hi1 = mulhi(PHILOX_M1, x2), lo1 = PHILOX_M1 * x2;
+        x0 = hi1 ^ x1 ^ k0;
+        x1 = lo1;
+        x2 = hi0 ^ x3 ^ k1;
+        x3 = lo0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    uint64_t half_words[2] = {uint64_t(x0) | (uint64_t(x1) << 32),
+                              uint64_t(x2) | (uint64_t(x3) << 32)};
+    device uint64_t* out = result + ulong(row) * params.stride;
+    for (uint i = 0; i < 2; ++i) {
+        uint w = 2 * t + i;
+        if (w >= params.stride) {
+            break;
+        }
+        uint64_t word = w < params.words ? half_words[i] : 0;
+        if (w + 1 == params.words && params.last_bits != 0) {
+            word &= (uint64_t(1) << params.last_bits) - 1;
+        }
+        out[w] = word;
+    }
+}
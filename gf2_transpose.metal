@@ -0,0 +1,73 @@
+// --- File: gf2_transpose.metal ---
+//
+// Bit-matrix transpose on the GPU, so that the transposed and vectorized
+// multiply kernels can get B^T without a round trip through the CPU.
+// Each threadgroup transposes one 64x64 bit block in threadgroup memory with
+// the recursive mask-and-shift (butterfly) method, the same as the CPU
+// transpose_64x64.
+
+#include <metal_stdlib>
+using namespace metal;
+
+struct GF2TransposeParams {
+    uint rows;       // of the source
+    uint cols;       // of the source
+    uint src_stride; // words per source row
+    uint dst_stride; // words per destination row
+};
+
+constant constexpr uint BLOCK = 64;
+
+// Grid dispatch: threadgroups (dst_stride, ceil(cols / 64)) of 64 threads.
+// Threadgroup (bi, bj) reads word bj of source rows 64 bi .. 64 bi + 63 and
+// writes word bi of destination rows 64 bj .. 64 bj + 63. Groups with bi past
+// the last source row block write the zero padding words of the destination.
+kernel void gf2_transpose_kernel(
+    device const uint64_t* src [[buffer(0)]],
+    device uint64_t* dst [[buffer(1)]],
+    constant GF2TransposeParams& params [[buffer(2)]],
+    uint2 tgid [[threadgroup_position_in_grid]],
+    uint tid [[thread_index_in_threadgroup]])
+{
+    threadgroup uint64_t block[BLOCK];
+
+    uint bi = tgid.x;
+    uint bj = tgid.y;
+
+    // Load row tid of the block; rows past the end and bits past the last
+    // column are zero
+    uint src_row = bi * BLOCK + tid;
+    uint64_t word = 0;
+    if (src_row < params.rows && bj * BLOCK < params.cols) {
+        word = src[ulong(src_row) * params.src_stride + bj];
+        uint valid = min(BLOCK, params.cols - bj * BLOCK);
+        if (valid < BLOCK) {
+            word &= (1ULL << valid) - 1;
+        }
+    }
+    block[tid] = word;
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+
+    // Six butterfly stages: the pair (k, k + j) with bit j of k clear swaps
+    // the high j bits of row k with the low j bits of row k + j
+    const uint64_t masks[6] = {
+        0x00000000FFFFFFFFULL, 0x0000FFFF0000FFFFULL, 0x00FF00FF00FF00FFULL,
+        0x0F0F0F0F0F0F0F0FULL, 0x3333333333333333ULL, 0x5555555555555555ULL,
+    };
+    uint stage = 0;
+    for (uint j = 32; j >= 1; j >>= 1, ++stage) {
+        if ((tid & j) == 0) {
+            uint64_t lo = block[tid];
+            uint64_t hi = block[tid + j];
+            uint64_t t = ((lo >> j) ^ hi) & masks[stage];
+            block[tid] = lo ^ (t << j);
+            block[tid + j] = hi ^ t;
+        }
+        threadgroup_barrier(mem_flags::mem_threadgroup);
+    }
+
+    uint dst_row = bj * BLOCK + tid;
+    if (dst_row < params.cols) {
+        dst[ulong(dst_row) * params.dst_stride + bi] = block[tid];
+    }
+}
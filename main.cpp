@@ -1,10 +1,186 @@
-#define NS_PRIVATE_IMPLEMENTATION
-#define MTL_PRIVATE_IMPLEMENTATION
-#define CA_PRIVATE_IMPLEMENTATION
-
 #include "GF2TestFramework.hpp"
+#include "GF2CpuInfo.hpp"
+#include "GF2Regression.hpp"
+#include "GF2Roofline.hpp"
+#include "GF2TiledMatrix.hpp"
+#include "GF2ExtensionMatrix.hpp"
+#include "GF2PolyMatrix.hpp"
+#include "GF2LowRankMatrix.hpp"
+#include "GF2Metrics.hpp"
+#include "GF2ProductCache.hpp"
+#include "GF2StreamingMultiplier.hpp"
+#include "GF2Basis.hpp"
+#include "GF2NarrowMatrix.hpp"
+#include "GF2SparseMatrix.hpp"
+#include "GF2MatrixView.hpp"
+#include "GF2MatrixFile.hpp"
+#include "GF2MatrixStream.hpp"
+#include "GF2Distributed.hpp"
+#include "GF2Service.hpp"
+#include "GF2SharedMemory.hpp"
+#include "GF2Expr.hpp"
+#include "GF2Incremental.hpp"
+#include "GF2PackedOperand.hpp"
+#include "GF2Trace.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+const char *USAGE =
+    "Usage: gf2_test [ITERATIONS] [options]\n"
+    "  --methods=LIST     comma-separated methods to run (default: all)\n"
+    "  --list-methods     print the method names and exit\n"
+    "  --sizes=LIST       square sizes, e.g. 256,1024\n"
+    "  --shapes=LIST      m x k x n shapes, e.g. 4096x64x4096,100x200x150\n"
+    "  --iterations=N     timed iterations per method and shape\n"
+    "  --warmup=N         warm-up multiplies per method and shape\n"
+    "  --adaptive=FRAC    CI target of adaptive iterations (0 = off)\n"
+    "  --threads=N        CPU threads (default: OpenMP default)\n"
+    "  --seed=N           reproducible operands (default: random)\n"
+    "  --no-validate      skip the Freivalds check of the products\n"
+    "  --no-background    generate each iteration's operands in line\n"
+    "  --perf-counters    hardware counters around every timed region\n"
+    "  --no-memory        skip the peak host and GPU memory of each region\n"
+    "  --energy           RAPL / IOReport energy of every timed region\n"
+    "  --huge-pages=MODE  off, thp, 2m or 1g backing of large matrices\n"
+    "  --roofline         measure the machine's peaks and place each method\n"
+    "  --trace=FILE       Chrome trace of the run (builds with -DGF2_TRACE=ON)\n"
+    "  --metrics=FILE     Prometheus text of the engine's metrics after the run\n"
+    "  --output=PREFIX    output files PREFIX_results.csv, ... (gf2_test)\n"
+    "  --format=FORMAT    csv, json or all (default: all)\n"
+    "  --baseline=FILE    compare the throughput with a saved results CSV\n"
+    "  --compare=FILE     compare FILE with the baseline instead of running\n"
+    "  --threshold=FRAC   median loss that is a regression (default: 0.10)\n"
+    "Exits with 2 when a method regressed against the baseline.\n"
+    "Options take their value after '=' or as the next argument.\n";
+
+// Methods by their name in the results, lower-cased with "(X)" as "-x"
+const std::vector<std::pair<const char *, bool TestConfig::*>> METHODS = {
+    {"serial", &TestConfig::run_serial},
+    {"simd", &TestConfig::run_simd},
+    {"simd-parallel", &TestConfig::run_simd_parallel},
+    {"simd-tiled", &TestConfig::run_simd_tiled},
+    {"simd-into", &TestConfig::run_simd_into},
+    {"m4r", &TestConfig::run_m4r},
+    {"strassen", &TestConfig::run_strassen},
+    {"gpu", &TestConfig::run_gpu},
+    {"gpu-transposed", &TestConfig::run_gpu_transposed},
+    {"gpu-tiled", &TestConfig::run_gpu_tiled},
+    {"gpu-vectorized", &TestConfig::run_gpu_vectorized},
+    {"gpu-simdgroup", &TestConfig::run_gpu_simdgroup},
+    {"gpu-resident", &TestConfig::run_gpu_resident},
+    {"gpu-plan", &TestConfig::run_gpu_plan},
+    {"gpu-outofcore", &TestConfig::run_gpu_out_of_core},
+    {"gpu-strassen", &TestConfig::run_gpu_strassen},
+    {"hybrid", &TestConfig::run_hybrid},
+    {"gpu-m4r", &TestConfig::run_gpu_m4r},
+    {"gpu-async", &TestConfig::run_gpu_async},
+    {"gpu-batched", &TestConfig::run_gpu_batched},
+    {"engine", &TestConfig::run_engine},
+};
+
+std::vector<std::string> split(const std::string &list) {
+  std::vector<std::string> items;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty()) {
+      items.push_back(item);
+    }
+  }
+  return items;
+}
+
+size_t to_size(const std::string &text) {
+  size_t used = 0;
+  unsigned long long value = std::stoull(text, &used);
+  if (used != text.size() || value == 0) {
+    throw std::invalid_argument(text);
+  }
+  return size_t(value);
+}
+
+void select_methods(TestConfig &config, const std::string &list) {
+  for (const auto &method : METHODS) {
+    config.*method.second = false;
+  }
+  for (std::string name : split(list)) {
+    for (char &c : name) {
+      c = char(std::tolower(static_cast<unsigned char>(c)));
+    }
+    bool found = false;
+    for (const auto &method : METHODS) {
+      if (name == method.first) {
+        config.*method.second = found = true;
+      }
+    }
+    if (!found) {
+      throw std::runtime_error("unknown method '" + name +
+                               "' (see --list-methods)");
+    }
+  }
+}
+
+// "MxKxN", or "N" for N x N x N
+std::tuple<size_t, size_t, size_t> parse_shape(const std::string &text) {
+  std::vector<size_t> dims;
+  std::stringstream stream(text);
+  std::string dim;
+  while (std::getline(stream, dim, 'x')) {
+    dims.push_back(to_size(dim));
+  }
+  if (dims.size() == 1) {
+    return {dims[0], dims[0], dims[0]};
+  }
+  if (dims.size() != 3) {
+    throw std::invalid_argument(text);
+  }
+  return {dims[0], dims[1], dims[2]};
+}
+
+// Reduced row echelon form by textbook Gauss-Jordan elimination, one
+// column at a time, as the reference for the blocked elimination
+GF2Matrix naive_rref(GF2Matrix m, size_t *rank = nullptr) {
+  size_t r = 0;
+  for (size_t col = 0; col < m.cols() && r < m.rows(); ++col) {
+    size_t pivot = r;
+    while (pivot < m.rows() && !m.get(pivot, col)) {
+      ++pivot;
+    }
+    if (pivot == m.rows()) {
+      continue;
+    }
+    m.rowSwap(r, pivot);
+    for (size_t i = 0; i < m.rows(); ++i) {
+      if (i != r && m.get(i, col)) {
+        m.rowXor(i, r);
+      }
+    }
+    ++r;
+  }
+  if (rank) {
+    *rank = r;
+  }
+  return m;
+}
+
+} // namespace
 
 int main(int argc, char *argv[]) {
   std::cout << "GF(2) Matrix Multiplication Performance Test Suite\n";
@@ -12,60 +188,235 @@ int main(int argc, char *argv[]) {
 
   // Create test configuration
   TestConfig config;
+  for (size_t size = 64; size <= 16384; size *= 2) {
+    config.shapes.emplace_back(size, size, size);
+  }
+  std::string output = "gf2_test";
+  std::string format = "all";
+  std::string trace_path;
+  std::string metrics_path;
+  std::string baseline_path, compare_path;
+  bool roofline = false;
+  RegressionConfig regression;
 
-  // Set test matrix sizes (adjust based on your hardware)
-  config.matrix_sizes = {
-                          {64, 64},     
-                          {128, 128},   
-                          {256, 256},
-                          {512, 512},   
-                          {1024, 1024}, 
-                          {2048, 2048},
-                          {4096, 4096}, 
-                          {8192, 8192},
-                          {16384, 16384}
-  };
-
-  // Parse command line arguments
-  if (argc > 1) {
-    // int it = std::stoi(argv[1]);
-    // config.matrix_sizes = {{size, size}};
-    config.iterations = std::stoi(argv[1]);
-  }
-
-  // // Parse command line arguments
-  // for (int i = 1; i < argc; ++i) {
-  //     std::string arg = argv[i];
-  //     if (arg == "--iterations" && i + 1 < argc) {
-  //         config.iterations = std::stoi(argv[i + 1]);
-  //         ++i; // Skip the next argument
-  //     } else if (arg.find("--") != 0) {  // Not a flag, likely a number
-  //         try {
-  //             int size = std::stoi(arg);
-  //             config.matrix_sizes = {{size, size}};
-  //         } catch (const std::invalid_argument&) {
-  //             // Ignore non-numeric arguments that aren't flags
-  //         }
-  //     }
-  // }
+  try {
+    for (int i = 1; i < argc; ++i) {
+      std::string arg = argv[i];
+      std::string value;
+      const size_t eq = arg.find('=');
+      if (eq != std::string::npos) {
+        value = arg.substr(eq + 1);
+        arg = arg.substr(0, eq);
+      }
+      // The value of an option, after '=' or as the next argument
+      auto next = [&]() {
+        if (eq == std::string::npos) {
+          if (i + 1 >= argc) {
+            throw std::invalid_argument(arg + " needs a value");
+          }
+          value = argv[++i];
+        }
+        return value;
+      };
+
+      if (arg == "--help" || arg == "-h") {
+        std::cout << USAGE;
+        return 0;
+      } else if (arg == "--list-methods") {
+        for (const auto &method : METHODS) {
+          std::cout << method.first << "\n";
+        }
+        return 0;
+      } else if (arg == "--methods") {
+        select_methods(config, next());
+      } else if (arg == "--sizes" || arg == "--shapes") {
+        config.shapes.clear();
+        for (const std::string &shape : split(next())) {
+          config.shapes.push_back(parse_shape(shape));
+        }
+      } else if (arg == "--iterations") {
+        config.iterations = std::stoi(next());
+      } else if (arg == "--warmup") {
+        config.warmup_iterations = std::stoi(next());
+      } else if (arg == "--adaptive") {
+        config.ci_target = std::stod(next());
+      } else if (arg == "--threads") {
+        config.num_threads = std::stoi(next());
+      } else if (arg == "--seed") {
+        config.seed = std::stoull(next());
+      } else if (arg == "--no-validate") {
+        config.validate_results = false;
+      } else if (arg == "--no-background") {
+        config.background_inputs = false;
+      } else if (arg == "--perf-counters") {
+        config.perf_counters = true;
+      } else if (arg == "--no-memory") {
+        config.track_memory = false;
+      } else if (arg == "--huge-pages") {
+        const std::string mode = next();
+        GF2HugePages pages;
+        if (!gf2_parse_huge_pages(mode, pages)) {
+          throw std::invalid_argument("huge page mode " + mode);
+        }
+        gf2_set_huge_pages(pages);
+      } else if (arg == "--energy") {
+        config.energy = true;
+      } else if (arg == "--roofline") {
+        roofline = true;
+      } else if (arg == "--trace") {
+        trace_path = next();
+      } else if (arg == "--metrics") {
+        metrics_path = next();
+      } else if (arg == "--output") {
+        output = next();
+      } else if (arg == "--format") {
+        format = next();
+        if (format != "csv" && format != "json" && format != "all") {
+          throw std::invalid_argument("format " + format);
+        }
+      } else if (arg == "--baseline") {
+        baseline_path = next();
+      } else if (arg == "--compare") {
+        compare_path = next();
+      } else if (arg == "--threshold") {
+        regression.threshold = std::stod(next());
+      } else if (arg.find("--") != 0) {
+        // A bare number is the iteration count, as before
+        config.iterations = std::stoi(arg);
+      } else {
+        throw std::invalid_argument("unknown option " + arg);
+      }
+    }
+  } catch (const std::runtime_error &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  } catch (const std::logic_error &e) {
+    std::cerr << "Bad argument: " << e.what() << "\n\n" << USAGE;
+    return 1;
+  }
+  if (config.shapes.empty()) {
+    std::cerr << "No shapes to test\n";
+    return 1;
+  }
+  if (!compare_path.empty() && baseline_path.empty()) {
+    std::cerr << "--compare needs --baseline\n";
+    return 1;
+  }
+
+  // Loaded first, so that a bad baseline fails before the run
+  std::vector<TestResult> baseline;
+  try {
+    if (!baseline_path.empty()) {
+      baseline = GF2Regression::loadResults(baseline_path);
+    }
+    if (!compare_path.empty()) {
+      std::cout << "Comparing " << compare_path << " with " << baseline_path
+                << "\n";
+      const size_t regressions = GF2Regression::printReport(
+          GF2Regression::compare(baseline,
+                                 GF2Regression::loadResults(compare_path),
+                                 regression),
+          regression, std::cout);
+      return regressions > 0 ? 2 : 0;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
 
   std::cout << "Configuration:\n";
-  std::cout << "- Matrix sizes: ";
-  for (const auto &size : config.matrix_sizes) {
-    std::cout << "(" << size.first << "x" << size.second << ") ";
+  std::cout << "- Shapes (m x k x n): ";
+  for (const auto &[m, k, n] : config.shapes) {
+    std::cout << m << "x" << k << "x" << n << " ";
+  }
+  std::cout << "\n";
+  std::cout << "- Iterations per test: " << config.iterations << "\n";
+  std::cout << "- Warm-up iterations: " << config.warmup_iterations << "\n";
+  if (config.ci_target > 0.0) {
+    std::cout << "- Adaptive: up to " << config.max_iterations
+              << " iterations until the median CI is within +/-"
+              << config.ci_target * 100.0 << "%\n";
+  }
+  if (config.num_threads > 0) {
+    std::cout << "- Threads: " << config.num_threads << "\n";
+  }
+  if (config.seed != 0) {
+    std::cout << "- Seed: " << config.seed << "\n";
+  }
+  std::cout << "- CPU: " << GF2CpuInfo::get().describe() << "\n";
+  std::cout << "- CPU kernel: " << GF2Matrix::simdKernelName() << "\n";
+  if (gf2_huge_pages() != GF2HugePages::Off) {
+    std::cout << "- Huge pages: " << gf2_huge_pages_name(gf2_huge_pages())
+              << "\n";
   }
   std::cout << "\n";
-  std::cout << "- Iterations per test: " << config.iterations << "\n\n";
 
+  int status = 0;
   try {
     GF2TestFramework framework;
 
+    if (!trace_path.empty()) {
+#ifndef GF2_TRACE
+      std::cerr << "Warning: built without GF2_TRACE, so " << trace_path
+                << " will hold no trace points\n";
+#endif
+      gf2_trace_start();
+    }
+
     // Run comprehensive tests
     auto results = framework.runTests(config);
+    if (!trace_path.empty()) {
+      gf2_trace_stop();
+      const size_t events = gf2_trace_write(trace_path);
+      std::cout << "Trace: " << events << " events in " << trace_path << "\n";
+    }
+
+    if (!metrics_path.empty()) {
+      std::ofstream metrics(metrics_path);
+      GF2Metrics::snapshot().writePrometheus(metrics);
+      if (!metrics) {
+        throw std::runtime_error("Cannot write " + metrics_path);
+      }
+      std::cout << "Metrics: " << metrics_path << "\n";
+    }
 
     // Print and save results
     framework.printResults(results);
-    framework.saveResults(results, "gf2_test_results.csv");
+    if (gf2_huge_pages() != GF2HugePages::Off) {
+      const GF2StorageUsage &usage = GF2StorageUsage::get();
+      std::cout << "Huge pages: " << usage.huge_allocations << " explicit, "
+                << usage.advised_allocations << " transparent, "
+                << usage.huge_fallbacks << " fell back to small pages";
+      const long long thp = gf2_transparent_huge_bytes();
+      if (thp >= 0) {
+        std::cout << "; " << thp / (1024 * 1024) << " MB now in huge pages";
+      }
+      std::cout << "\n";
+    }
+    if (format != "json") {
+      framework.saveResults(results, output + "_results.csv");
+      framework.saveSummary(results, output + "_summary.csv");
+    }
+    if (format != "csv") {
+      framework.saveResultsJSON(results, output + "_results.json");
+    }
+
+    if (roofline) {
+      std::cout << "Measuring the machine's peak bandwidth and XOR/AND rate...\n";
+      const GF2MachinePeaks peaks = GF2Roofline::measurePeaks(config.num_threads);
+      const std::vector<TestSummary> summaries = framework.summarize(results);
+      GF2Roofline::printReport(summaries, peaks, std::cout);
+      GF2Roofline::saveReport(summaries, peaks, output + "_roofline.csv");
+    }
+
+    if (!baseline_path.empty()) {
+      std::cout << "Baseline: " << baseline_path << "\n";
+      if (GF2Regression::printReport(
+              GF2Regression::compare(baseline, results, regression),
+              regression, std::cout) > 0) {
+        status = 2;
+      }
+    }
 
     // Display progress summary
     std::cout << "\n=== Processing Summary ===\n";
@@ -114,6 +465,1074 @@ int main(int argc, char *argv[]) {
     std::cout << "Small matrix test: " << (small_test ? "PASSED" : "FAILED")
               << "\n";
 
+    // Test 3: M4R against the serial reference (non-multiple-of-64 shape)
+    std::cout << "Testing M4R multiplication...\n";
+    GF2Matrix m4r_a = GF2TestFramework::generateRandomMatrix(100, 200);
+    GF2Matrix m4r_b = GF2TestFramework::generateRandomMatrix(200, 150);
+
+    bool m4r_test = m4r_a.multiplySerial(m4r_b) == m4r_a.multiplyM4R(m4r_b);
+    std::cout << "M4R test: " << (m4r_test ? "PASSED" : "FAILED") << "\n";
+
+    // Test 4: products with a transposed operand against explicit transposes
+    // and the Gram product
+    std::cout << "Testing A*B^T and A^T*B multiplication...\n";
+    GF2Matrix abt_b = GF2TestFramework::generateRandomMatrix(150, 200);
+    GF2Matrix atb_a = GF2TestFramework::generateRandomMatrix(200, 100);
+
+    bool transposed_test =
+        m4r_a.multiplyABt(abt_b) == m4r_a.multiplySerial(abt_b.transpose()) &&
+        atb_a.multiplyAtB(m4r_a.transpose(), 0, true) ==
+            m4r_a.multiplySerial(atb_a);
+    // The Gram product, one triangle and mirrored
+    GF2Matrix gram = m4r_a.multiplyAAt(GF2Triangle::Upper, true);
+    GF2Matrix gram_lower = m4r_a.multiplyAAt();
+    gram_lower.mirrorTriangle(GF2Triangle::Lower);
+    transposed_test = transposed_test && gram == m4r_a.multiplyABt(m4r_a) &&
+                      gram_lower == gram;
+    // Lazy transposes pick the kernel by orientation, materializing only
+    // for A^T * B^T
+    GF2Matrix lazy_c = GF2TestFramework::generateRandomMatrix(70, 100);
+    const GF2Matrix atb_a_t = atb_a.transpose();
+    const GF2Matrix abt_b_t = abt_b.transpose();
+    const GF2Matrix m4r_a_t = m4r_a.transpose();
+    transposed_test =
+        transposed_test && &abt_b.transpose().transpose() == &abt_b &&
+        abt_b.transpose().get(7, 3) == abt_b.get(3, 7) &&
+        m4r_a.multiplySIMDParallel(abt_b.transpose()) ==
+            m4r_a.multiplySerial(abt_b_t) &&
+        m4r_a.multiplySIMD(m4r_a.transpose()) == gram &&
+        atb_a.transpose().multiply(abt_b_t) == atb_a_t.multiplySerial(abt_b_t) &&
+        atb_a.transpose().multiply(abt_b.transpose()) ==
+            atb_a_t.multiplySerial(abt_b_t) &&
+        m4r_a.transpose().multiply(lazy_c.transpose()) ==
+            m4r_a_t.multiplySerial(lazy_c.transpose());
+    std::cout << "Transposed operand test: "
+              << (transposed_test ? "PASSED" : "FAILED") << "\n";
+
+    // Test 5: the Morton-ordered tiled layout, both tile sizes
+    std::cout << "Testing tiled layout multiplication...\n";
+    bool tiled_test = true;
+    for (size_t tile : {GF2TiledMatrix::SMALL_TILE, GF2TiledMatrix::LARGE_TILE}) {
+      GF2TiledMatrix ta = GF2TiledMatrix::fromMatrix(m4r_a, tile);
+      GF2TiledMatrix tb = GF2TiledMatrix::fromMatrix(abt_b.transpose(), tile);
+      tiled_test = tiled_test && ta.toMatrix() == m4r_a &&
+                   ta.multiply(tb).toMatrix() == m4r_a.multiplySerial(abt_b.transpose());
+    }
+    std::cout << "Tiled layout test: " << (tiled_test ? "PASSED" : "FAILED") << "\n";
+
+    // Test 6: bitsliced GF(2^8) and GF(2^16) products (Karatsuba over planes)
+    std::cout << "Testing GF(2^k) multiplication...\n";
+    bool extension_test = true;
+    for (unsigned k : {8u, 16u}) {
+      GF2ExtensionMatrix ea(37, 70, k), eb(70, 45, k);
+      ea.randomFill(k);
+      eb.randomFill(k + 100);
+      extension_test = extension_test && ea.multiply(eb) == ea.multiplySerial(eb);
+    }
+    std::cout << "GF(2^k) test: " << (extension_test ? "PASSED" : "FAILED") << "\n";
+
+    // Test 7: triangular multiply and solve, past one base block
+    std::cout << "Testing triangular multiply and solve...\n";
+    bool triangular_test = true;
+    GF2Matrix tri_t = GF2TestFramework::generateRandomMatrix(600, 600);
+    GF2Matrix tri_b = GF2TestFramework::generateRandomMatrix(600, 150);
+    for (GF2Triangle triangle : {GF2Triangle::Lower, GF2Triangle::Upper}) {
+      GF2Matrix t(600, 600);
+      for (size_t i = 0; i < 600; ++i) {
+        for (size_t j = 0; j < 600; ++j) {
+          const bool in = triangle == GF2Triangle::Lower ? j <= i : j >= i;
+          t.set(i, j, i == j || (in && tri_t.get(i, j)));
+        }
+      }
+      GF2Matrix b = tri_b;
+      GF2Matrix::triangularMultiply(tri_t, triangle, b, true);
+      triangular_test = triangular_test && b == t.multiplySerial(tri_b);
+      GF2Matrix::triangularSolve(tri_t, triangle, b, true);
+      triangular_test = triangular_test && b == tri_b;
+    }
+    std::cout << "Triangular test: " << (triangular_test ? "PASSED" : "FAILED")
+              << "\n";
+
+    // Test 8: polynomial matrices, classical and Karatsuba over word planes
+    std::cout << "Testing polynomial matrix multiplication...\n";
+    GF2PolyMatrix pa(9, 21, 300), pb(21, 13, 200);
+    pa.randomFill(1);
+    pb.randomFill(2);
+    const GF2PolyMatrix poly_ref = pa.multiplySerial(pb);
+    const bool poly_test =
+        pa.multiply(pb) == poly_ref && pa.multiplyClassical(pb) == poly_ref;
+    std::cout << "Polynomial matrix test: " << (poly_test ? "PASSED" : "FAILED")
+              << "\n";
+
+    // Test 9: identity plus low rank, against the dense matrix it stands for
+    std::cout << "Testing low-rank structured matrices...\n";
+    GF2Matrix lr_u = GF2TestFramework::generateRandomMatrix(300, 5);
+    GF2Matrix lr_v = GF2TestFramework::generateRandomMatrix(300, 5);
+    GF2Matrix lr_dense = lr_u.multiplySerial(lr_v.transpose());
+    for (size_t i = 0; i < 300; ++i) {
+      lr_dense.set(i, i, !lr_dense.get(i, i));
+    }
+    const GF2LowRankMatrix lr(lr_u, lr_v);
+    const GF2LowRankMatrix lr_square = lr.compose(lr);
+    const GF2Matrix lr_b = GF2TestFramework::generateRandomMatrix(300, 90);
+    const bool low_rank_test =
+        lr.toDense() == lr_dense && lr.multiply(lr_b) == lr_dense.multiplySerial(lr_b) &&
+        lr_square.toDense() == lr_dense.multiplySerial(lr_dense) && lr_square.rank() <= 10;
+    std::cout << "Low-rank test: " << (low_rank_test ? "PASSED" : "FAILED") << "\n";
+
+    // Test 10: engine metrics, the histogram buckets and the exporter
+    std::cout << "Testing engine metrics...\n";
+    bool buckets_test = true;
+    for (size_t b = 0; b < GF2LatencyHistogram::BUCKETS; ++b) {
+      buckets_test &= GF2LatencyHistogram::bucketOf(GF2LatencyHistogram::bucketLower(b)) == b;
+    }
+    GF2Engine metrics_engine;
+    const GF2Matrix ma = GF2TestFramework::generateRandomMatrix(100, 200);
+    const GF2Matrix mb = GF2TestFramework::generateRandomMatrix(200, 150);
+    GF2Matrix mc(100, 150);
+    const GF2MetricSeries m4r_before = GF2Metrics::snapshot().total("CPU", "M4R");
+    for (int i = 0; i < 3; ++i) {
+      metrics_engine.run(GF2Engine::Method::M4R, ma, mb, mc);
+    }
+    const GF2MetricsSnapshot metrics = GF2Metrics::snapshot();
+    const GF2MetricSeries m4r = metrics.total("CPU", "M4R");
+    const bool metrics_test =
+        buckets_test && (!GF2Metrics::enabled() ||
+                         (m4r.latency.count == m4r_before.latency.count + 3 &&
+                          m4r.bit_ops == m4r_before.bit_ops + 3 * 100 * 200 * 150 &&
+                          m4r.latency.percentile(0.99) > 0.0 &&
+                          metrics.prometheus().find("gf2_multiply_duration_seconds_count{"
+                                                    "backend=\"CPU\",method=\"M4R\","
+                                                    "shape=\"128x256x256\"}") !=
+                              std::string::npos));
+    std::cout << "Metrics test: " << (metrics_test ? "PASSED" : "FAILED") << "\n";
+
+    // Test 11: a repeated pair comes from the product cache, a changed one
+    // does not, and the budget evicts the least recently used product
+    std::cout << "Testing the product cache...\n";
+    const GF2Matrix pc_a = GF2TestFramework::generateRandomMatrix(100, 200);
+    const GF2Matrix pc_b = GF2TestFramework::generateRandomMatrix(200, 150);
+    const GF2Matrix pc_ref = pc_a.multiplySerial(pc_b);
+    int pc_products = 0;
+    const GF2ProductCache::Product pc_product = [&](const GF2Matrix& x, const GF2Matrix& y,
+                                                    GF2Matrix& z) {
+      ++pc_products;
+      z = x.multiplyM4R(y);
+    };
+    // Room for two 100 x 150 products of 100 rows of 8 words
+    GF2ProductCache product_cache(2 * 100 * 8 * sizeof(uint64_t));
+    const bool pc_first = *product_cache.multiply(pc_a, pc_b, pc_product) == pc_ref;
+    const bool pc_again = *product_cache.multiply(pc_a, pc_b, pc_product) == pc_ref;
+    GF2Matrix pc_changed = pc_a;
+    pc_changed.set(7, 9, !pc_changed.get(7, 9));
+    const GF2Matrix pc_changed_ref = pc_changed.multiplySerial(pc_b);
+    const bool pc_miss = *product_cache.multiply(pc_changed, pc_b, pc_product) == pc_changed_ref;
+    // A third product evicts pc_a * pc_b, used less recently than pc_changed's
+    GF2Matrix pc_c = GF2TestFramework::generateRandomMatrix(100, 200);
+    product_cache.multiply(pc_c, pc_b, pc_product);
+    GF2Matrix pc_out(100, 150);
+    const bool pc_evicted = !product_cache.lookup(pc_a, pc_b, pc_out);
+    const bool pc_kept =
+        product_cache.lookup(pc_changed, pc_b, pc_out) && pc_out == pc_changed_ref;
+    const GF2ProductCacheStats pc_stats = product_cache.stats();
+    const bool product_cache_test = pc_first && pc_again && pc_miss && pc_evicted && pc_kept &&
+                                    pc_products == 3 && pc_stats.hits == 2 &&
+                                    pc_stats.evictions == 1 && pc_stats.entries == 2;
+    std::cout << "Product cache test: " << (product_cache_test ? "PASSED" : "FAILED") << "\n";
+
+    // Test 12: rows of A streamed in uneven chunks, through both kernels,
+    // come out as the rows of A * B in order
+    std::cout << "Testing the streaming multiply...\n";
+    const GF2Matrix st_a = GF2TestFramework::generateRandomMatrix(700, 200);
+    const GF2Matrix st_b = GF2TestFramework::generateRandomMatrix(200, 150);
+    const GF2Matrix st_ref = st_a.multiplySerial(st_b);
+    bool streaming_test = true;
+    for (GF2StreamKernel kernel : {GF2StreamKernel::Dot, GF2StreamKernel::M4R}) {
+      GF2Matrix st_c(700, 150);
+      size_t st_next = 0;
+      GF2StreamingConfig st_config;
+      st_config.kernel = kernel;
+      st_config.queue_chunks = 2;
+      GF2StreamingMultiplier stream(
+          st_b,
+          [&](const GF2RowChunk &chunk) {
+            streaming_test &= chunk.row0 == st_next;
+            st_next += chunk.rows.rows();
+            for (size_t i = 0; i < chunk.rows.rows(); ++i) {
+              std::copy_n(chunk.rows.get_raw_data() + i * chunk.rows.row_stride(),
+                          st_c.words_per_row(),
+                          st_c.get_raw_data() + (chunk.row0 + i) * st_c.row_stride());
+            }
+          },
+          st_config);
+      for (size_t r = 0, count = 1; r < 700; r += count, count = count * 3 + 1) {
+        count = std::min<size_t>(count, 700 - r);
+        stream.push(st_a.get_raw_data() + r * st_a.row_stride(), count, st_a.row_stride());
+      }
+      stream.finish();
+      streaming_test &= st_c == st_ref && stream.stats().rows_out == 700;
+    }
+    std::cout << "Streaming test: " << (streaming_test ? "PASSED" : "FAILED") << "\n";
+
+    // Test 13: bytes and packed bit streams in both bit orders convert to
+    // the bits set() and get() see, with a padded row stride and a partial
+    // last word and byte
+    std::cout << "Testing byte and bit stream conversion...\n";
+    const size_t pk_rows = 37, pk_cols = 203, pk_stride = 211, pk_bytes = (pk_cols + 7) / 8;
+    std::vector<uint8_t> pk_in(pk_rows * pk_stride);
+    std::mt19937 pk_rng(83);
+    for (uint8_t &byte : pk_in) byte = pk_rng() % 3 == 0 ? uint8_t(pk_rng() | 1) : 0;
+    const GF2Matrix pk_m = GF2Matrix::fromBytes(pk_in.data(), pk_rows, pk_cols, pk_stride);
+    bool pack_test = true;
+    for (size_t r = 0; r < pk_rows; ++r) {
+      for (size_t c = 0; c < pk_cols; ++c) {
+        pack_test &= pk_m.get(r, c) == (pk_in[r * pk_stride + c] != 0);
+      }
+    }
+    std::vector<uint8_t> pk_out(pk_rows * pk_cols);
+    pk_m.toBytes(pk_out.data());
+    for (size_t i = 0; i < pk_out.size(); ++i) {
+      pack_test &= pk_out[i] == uint8_t(pk_m.get(i / pk_cols, i % pk_cols));
+    }
+    std::vector<uint8_t> pk_bits(pk_rows * pk_bytes);
+    pk_m.toBits(pk_bits.data(), GF2BitOrder::MsbFirst);
+    for (size_t r = 0; r < pk_rows; ++r) {
+      for (size_t c = 0; c < pk_cols; ++c) {
+        pack_test &= ((pk_bits[r * pk_bytes + c / 8] >> (7 - c % 8)) & 1) == int(pk_m.get(r, c));
+      }
+    }
+    pack_test &= GF2Matrix::fromBits(pk_bits.data(), pk_rows, pk_cols) == pk_m;
+    pk_m.toBits(pk_bits.data(), GF2BitOrder::LsbFirst);
+    for (size_t r = 0; r < pk_rows; ++r) {
+      pk_bits[r * pk_bytes + pk_bytes - 1] |= uint8_t(0xFF << (pk_cols % 8)); // ignored
+    }
+    const GF2Matrix pk_lsb =
+        GF2Matrix::fromBits(pk_bits.data(), pk_rows, pk_cols, GF2BitOrder::LsbFirst);
+    pack_test &= pk_lsb == pk_m && pk_lsb.popcount() == pk_m.popcount();
+    std::cout << "Pack test: " << (pack_test ? "PASSED" : "FAILED") << "\n";
+
+    // Test 14: vectors drawn from a span of rank 120 give the same rank and
+    // the same independent rows inserted one at a time and as a batch
+    // through the tables, and every vector is then in the span
+    std::cout << "Testing the incremental basis...\n";
+    const GF2Matrix ob_gen = GF2TestFramework::generateRandomMatrix(120, 333);
+    GF2Matrix ob_rows(400, 333);
+    std::mt19937 ob_rng(85);
+    for (size_t r = 0; r < ob_rows.rows(); ++r) {
+      for (size_t g = 0; g < ob_gen.rows(); ++g) {
+        if (ob_rng() & 1) ob_rows.rowXor(r, ob_gen, g);
+      }
+    }
+    GF2Basis ob_single(333, 1), ob_batch(333);
+    bool basis_test = true;
+    std::vector<bool> ob_added = ob_batch.insertBatch(ob_rows.view(0, 10, 0, 333).copy());
+    const std::vector<bool> ob_rest = ob_batch.insertBatch(ob_rows.view(10, 400, 0, 333).copy());
+    ob_added.insert(ob_added.end(), ob_rest.begin(), ob_rest.end());
+    for (size_t r = 0; r < ob_rows.rows(); ++r) {
+      basis_test &= ob_single.insert(ob_rows, r) == ob_added[r];
+    }
+    const std::vector<bool> ob_in = ob_single.containsBatch(ob_rows);
+    basis_test &= std::all_of(ob_in.begin(), ob_in.end(), [](bool in) { return in; });
+    basis_test &= ob_single.rank() == ob_rows.rank() && ob_batch.rank() == ob_single.rank() &&
+                  ob_single.basis().copy().rank() == ob_single.rank();
+    std::cout << "Basis test: " << (basis_test ? "PASSED" : "FAILED") << "\n";
+
+    // Test 15: narrow matrices of each cell width round-trip and multiply
+    // like their dense copies, through the tables and the direct paths
+    std::cout << "Testing narrow matrices...\n";
+    bool narrow_test = true;
+    for (size_t nw_cols : {5, 8, 13, 32}) {
+      for (size_t nw_rows : {size_t(100), size_t(1000)}) {
+        const GF2Matrix nw_a = GF2TestFramework::generateRandomMatrix(nw_rows, nw_cols);
+        const GF2Matrix nw_b = GF2TestFramework::generateRandomMatrix(nw_cols, 300);
+        const GF2Matrix nw_c = GF2TestFramework::generateRandomMatrix(nw_cols, 8);
+        const GF2Matrix nw_d = GF2TestFramework::generateRandomMatrix(nw_rows, 200);
+        const GF2Matrix nw_e = GF2TestFramework::generateRandomMatrix(200, nw_cols);
+        const GF2NarrowMatrix nw = GF2NarrowMatrix::fromMatrix(nw_a);
+        narrow_test &= nw.toMatrix() == nw_a && nw.get(3, 4) == nw_a.get(3, 4);
+        narrow_test &= nw.multiply(nw_b) == nw_a.multiplySerial(nw_b);
+        narrow_test &= nw.multiply(GF2NarrowMatrix::fromMatrix(nw_c)).toMatrix() ==
+                       nw_a.multiplySerial(nw_c);
+        narrow_test &=
+            GF2NarrowMatrix::multiply(nw_d, GF2NarrowMatrix::fromMatrix(nw_e)).toMatrix() ==
+            nw_d.multiplySerial(nw_e);
+      }
+    }
+    std::cout << "Narrow matrix test: " << (narrow_test ? "PASSED" : "FAILED") << "\n";
+
+    // Test 16: every register tile against the serial product, on shapes
+    // with partial tiles of rows and columns and a k tail
+    std::cout << "Testing register tiles...\n";
+    bool tile_test = !GF2Matrix::simdTileNames().empty();
+    for (const auto& [tl_m, tl_k, tl_n] : {std::tuple<size_t, size_t, size_t>{1, 1, 1},
+                                          {13, 70, 61}, {100, 515, 130}}) {
+      const GF2Matrix tl_a = GF2TestFramework::generateRandomMatrix(tl_m, tl_k);
+      const GF2Matrix tl_b = GF2TestFramework::generateRandomMatrix(tl_k, tl_n);
+      const GF2Matrix tl_ref = tl_a.multiplySerial(tl_b);
+      for (const std::string& tile : GF2Matrix::simdTileNames()) {
+        tile_test &= tl_a.multiplySIMDTile(tl_b, tile) == tl_ref;
+      }
+    }
+    std::cout << "Register tile test: " << (tile_test ? "PASSED" : "FAILED") << "\n";
+
+    // Test 17: sparse nullspaces are annihilated by the matrix and
+    // independent, on the dense path, block Lanczos, and inputs so sparse
+    // that a single Lanczos start comes back short
+    std::cout << "Testing sparse nullspaces...\n";
+    bool nullspace_test = true;
+    std::mt19937 ns_rng(46);
+    for (const auto& [ns_m, ns_n, ns_ones] : {std::tuple<size_t, size_t, int>{300, 500, 4},
+                                              {100, 1200, 1}, {300, 2000, 2},
+                                              {1190, 1200, 12}}) {
+      GF2Matrix ns_dense(ns_m, ns_n);
+      for (size_t i = 0; i < ns_m; ++i) {
+        for (int t = 0; t < ns_ones; ++t) ns_dense.set(i, ns_rng() % ns_n, true);
+      }
+      const GF2Matrix ns = GF2SparseMatrix::fromDense(ns_dense).nullspace();
+      const size_t ns_nullity = ns_n - ns_dense.rank();
+      nullspace_test &= ns.rows() == std::min<size_t>(64, ns_nullity) && ns.rank() == ns.rows() &&
+                        ns_dense.multiplySerial(ns.transpose().materialize()).structure().zero();
+    }
+    std::cout << "Nullspace test: " << (nullspace_test ? "PASSED" : "FAILED") << "\n";
+
+    // Test 18: rank, PLE and echelon forms against Gauss-Jordan elimination,
+    // on full-rank and rank-deficient matrices, past the 512-column blocks
+    std::cout << "Testing elimination...\n";
+    bool elimination_test = true;
+    for (const auto& [el_m, el_n, el_r] : {std::tuple<size_t, size_t, size_t>{1, 1, 1},
+                                           {70, 100, 100}, {600, 700, 700},
+                                           {300, 600, 40}, {200, 1100, 150}, {90, 80, 0}}) {
+      GF2Matrix el_a(el_m, el_n);
+      if (el_r >= el_n) {
+        el_a = GF2TestFramework::generateRandomMatrix(el_m, el_n);
+      } else if (el_r > 0) {
+        el_a = GF2TestFramework::generateRandomMatrix(el_m, el_r)
+                   .multiplySerial(GF2TestFramework::generateRandomMatrix(el_r, el_n));
+      }
+      size_t el_rank = 0;
+      const GF2Matrix el_rref = naive_rref(el_a, &el_rank);
+      elimination_test &= el_a.rank() == el_rank;
+
+      const GF2PLE el_ple = el_a.ple();
+      GF2Matrix el_pa(el_m, el_n);
+      std::vector<bool> el_seen(el_m, false);
+      for (size_t i = 0; i < el_m; ++i) {
+        elimination_test &= el_ple.rows[i] < el_m && !el_seen[el_ple.rows[i]];
+        el_seen[el_ple.rows[i] % el_m] = true;
+        el_pa.rowXor(i, el_a, el_ple.rows[i] % el_m);
+      }
+      elimination_test &= el_ple.rank() == el_rank && el_ple.L.rows() == el_m &&
+                          el_ple.L.cols() == el_rank && el_ple.E.rows() == el_rank &&
+                          el_ple.L.multiplySerial(el_ple.E) == el_pa;
+      for (size_t j = 0; j < el_ple.rank(); ++j) {
+        elimination_test &= el_ple.E.firstSetBit(j) == el_ple.pivots[j] &&
+                            (j == 0 || el_ple.pivots[j - 1] < el_ple.pivots[j]) &&
+                            el_ple.L.get(j, j) && el_ple.L.firstSetBit(j, j + 1) == el_rank;
+      }
+
+      elimination_test &= el_a.echelonForm() == el_rref;
+      const GF2Matrix el_ef = el_a.echelonForm(false);
+      size_t el_lead = 0;
+      for (size_t j = 0; j < el_m; ++j) {
+        const size_t lead = el_ef.firstSetBit(j);
+        elimination_test &= j < el_rank ? (j == 0 || lead > el_lead) : lead == el_n;
+        el_lead = lead;
+      }
+      elimination_test &= naive_rref(el_ef) == el_rref;
+    }
+    std::cout << "Elimination test: " << (elimination_test ? "PASSED" : "FAILED") << "\n";
+
+    // Test 19: inverses and solves are checked by multiplying back, and a
+    // singular matrix or an inconsistent system throws
+    std::cout << "Testing solve and inverse...\n";
+    bool solve_test = true;
+    for (size_t sv_n : {1, 64, 300, 700}) {
+      GF2Matrix sv_a = GF2TestFramework::generateRandomMatrix(sv_n, sv_n);
+      size_t sv_rank = 0;
+      while (naive_rref(sv_a, &sv_rank), sv_rank < sv_n) {
+        sv_a = GF2TestFramework::generateRandomMatrix(sv_n, sv_n);
+      }
+      const GF2Matrix sv_id = GF2TestFramework::generateIdentityMatrix(sv_n);
+      const GF2Matrix sv_inv = sv_a.inverse();
+      solve_test &= sv_a.multiplySerial(sv_inv) == sv_id && sv_inv.multiplySerial(sv_a) == sv_id;
+      const GF2Matrix sv_b = GF2TestFramework::generateRandomMatrix(sv_n, 70);
+      solve_test &= GF2Matrix::solve(sv_a, sv_b) == sv_inv.multiplySerial(sv_b);
+      if (sv_n > 1) {
+        const GF2Matrix sv_singular =
+            GF2TestFramework::generateRandomMatrix(sv_n, sv_n - 1)
+                .multiplySerial(GF2TestFramework::generateRandomMatrix(sv_n - 1, sv_n));
+        bool sv_threw = false;
+        try {
+          sv_singular.inverse();
+        } catch (const std::runtime_error &) {
+          sv_threw = true;
+        }
+        solve_test &= sv_threw;
+      }
+    }
+    for (const auto& [sv_m, sv_n, sv_r] : {std::tuple<size_t, size_t, size_t>{300, 500, 200},
+                                           {700, 600, 590}, {100, 1100, 100}}) {
+      const GF2Matrix sv_a =
+          GF2TestFramework::generateRandomMatrix(sv_m, sv_r)
+              .multiplySerial(GF2TestFramework::generateRandomMatrix(sv_r, sv_n));
+      const GF2Matrix sv_b = sv_a.multiplySerial(GF2TestFramework::generateRandomMatrix(sv_n, 90));
+      const GF2PLE sv_ple = sv_a.ple();
+      solve_test &= sv_a.multiplySerial(GF2Matrix::solve(sv_a, sv_b)) == sv_b &&
+                    sv_a.multiplySerial(GF2Matrix::solve(sv_ple, sv_b)) == sv_b;
+      if (sv_ple.rank() < sv_m) {
+        bool sv_threw = false;
+        try {
+          GF2Matrix::solve(sv_ple, GF2TestFramework::generateRandomMatrix(sv_m, 90));
+        } catch (const std::runtime_error &) {
+          sv_threw = true;
+        }
+        solve_test &= sv_threw;
+      }
+    }
+    std::cout << "Solve test: " << (solve_test ? "PASSED" : "FAILED") << "\n";
+
+    // Test 20: sparse matrices round-trip through the dense form and the
+    // index arrays, packed and not, and multiply like their dense copies
+    std::cout << "Testing sparse matrices...\n";
+    bool sparse_test = true;
+    std::mt19937 sp_rng(45);
+    for (const auto& [sp_m, sp_k, sp_n] : {std::tuple<size_t, size_t, size_t>{1, 1, 1},
+                                           {200, 300, 130}, {1000, 700, 515}}) {
+      // Mostly rows of a few ones, every tenth row half full so it packs
+      auto sp_random = [&sp_rng](size_t rows, size_t cols) {
+        GF2Matrix m(rows, cols);
+        for (size_t i = 0; i < rows; ++i) {
+          const size_t ones = i % 10 == 9 ? cols / 2 : sp_rng() % 4;
+          for (size_t t = 0; t < ones; ++t) m.set(i, sp_rng() % cols, true);
+        }
+        return m;
+      };
+      const GF2Matrix sp_a = sp_random(sp_m, sp_k);
+      const GF2Matrix sp_b = sp_random(sp_k, sp_n);
+      const GF2SparseMatrix sp_sa = GF2SparseMatrix::fromDense(sp_a);
+      const GF2SparseMatrix sp_sb = GF2SparseMatrix::fromDense(sp_b);
+      sparse_test &= sp_sa.toDense() == sp_a && sp_sa.nnz() == sp_a.popcount() &&
+                     GF2SparseMatrix::fromDense(sp_a, false).toDense() == sp_a &&
+                     GF2SparseMatrix::fromDense(sp_a, false) == sp_sa;
+
+      // The same ones as CSR arrays, in reverse order and with one column
+      // of each row listed a second and third time
+      std::vector<size_t> sp_start{0};
+      std::vector<uint32_t> sp_indices;
+      for (size_t i = 0; i < sp_m; ++i) {
+        std::vector<uint32_t> ones = sp_sa.row(i);
+        bool ascending = std::is_sorted(ones.begin(), ones.end());
+        for (size_t t = 0; t < ones.size(); ++t) {
+          ascending &= sp_a.get(i, ones[t]);
+        }
+        sparse_test &= ascending && ones.size() == sp_a.rowWeight(i);
+        std::reverse(ones.begin(), ones.end());
+        if (!ones.empty()) {
+          ones.insert(ones.end(), {ones[0], ones[0]});
+        }
+        sp_indices.insert(sp_indices.end(), ones.begin(), ones.end());
+        sp_start.push_back(sp_indices.size());
+      }
+      sparse_test &= GF2SparseMatrix::fromIndices(sp_m, sp_k, sp_start, sp_indices) == sp_sa;
+
+      const GF2Matrix sp_ref = sp_a.multiplySerial(sp_b);
+      sparse_test &= sp_sa.multiply(sp_b) == sp_ref && sp_sa.multiply(sp_sb).toDense() == sp_ref &&
+                     sp_sa.transpose().toDense() == sp_a.transpose().materialize();
+
+      // An n x 64 block: word j of x is row j of a k x 64 matrix
+      const GF2Matrix sp_x = GF2TestFramework::generateRandomMatrix(sp_k, 64);
+      std::vector<uint64_t> sp_xw(sp_k), sp_y(sp_m);
+      for (size_t j = 0; j < sp_k; ++j) sp_xw[j] = sp_x.get_raw_data()[j * sp_x.row_stride()];
+      sp_sa.multiplyBlock(sp_xw.data(), sp_y.data());
+      const GF2Matrix sp_ax = sp_a.multiplySerial(sp_x);
+      for (size_t i = 0; i < sp_m; ++i) {
+        sparse_test &= sp_y[i] == sp_ax.get_raw_data()[i * sp_ax.row_stride()];
+      }
+    }
+    bool sp_threw = false;
+    try {
+      GF2SparseMatrix::fromIndices(2, 10, {0, 1, 2}, {3, 10});
+    } catch (const std::runtime_error &) {
+      sp_threw = true;
+    }
+    sparse_test &= sp_threw;
+    std::cout << "Sparse matrix test: " << (sparse_test ? "PASSED" : "FAILED") << "\n";
+
+    // Test 21: views at unaligned rows and columns read the right bits, the
+    // kernels write only the window of a mutable view, and a writable view
+    // that does not cover whole words throws
+    std::cout << "Testing matrix views...\n";
+    bool view_test = true;
+    {
+      const GF2Matrix vw_a = GF2TestFramework::generateRandomMatrix(300, 400);
+      const GF2Matrix vw_b = GF2TestFramework::generateRandomMatrix(400, 350);
+      const GF2MatrixView vw_av = vw_a.view(7, 200, 13, 300);
+      const GF2MatrixView vw_bv = vw_b.view(30, 400, 100, 350).view(2, 289, 0, 247);
+      // A window, bit by bit
+      auto vw_cut = [](const GF2Matrix& m, size_t row0, size_t col0, size_t rows, size_t cols) {
+        GF2Matrix out(rows, cols);
+        for (size_t i = 0; i < rows; ++i) {
+          for (size_t j = 0; j < cols; ++j) out.set(i, j, m.get(row0 + i, col0 + j));
+        }
+        return out;
+      };
+      const GF2Matrix vw_ac = vw_cut(vw_a, 7, 13, 193, 287);
+      const GF2Matrix vw_bc = vw_cut(vw_b, 32, 100, 287, 247);
+      view_test &= vw_av.copy() == vw_ac && vw_bv.copy() == vw_bc && !vw_av.word_aligned() &&
+                   vw_av.get(5, 9) == vw_a.get(12, 22);
+      const GF2Matrix vw_ref = vw_ac.multiplySerial(vw_bc);
+
+      // Every writer into columns [64, 311) of rows [11, 204) of a matrix of
+      // random bits, which must keep the bits around the window
+      const GF2Matrix vw_c0 = GF2TestFramework::generateRandomMatrix(250, 311);
+      auto vw_expect = [&](bool accumulate, const GF2Matrix& result) {
+        GF2Matrix out = vw_c0;
+        for (size_t i = 0; i < result.rows(); ++i) {
+          for (size_t j = 0; j < result.cols(); ++j) {
+            out.set(11 + i, 64 + j, result.get(i, j) != (accumulate && out.get(11 + i, 64 + j)));
+          }
+        }
+        return out;
+      };
+      GF2Workspace vw_ws;
+      GF2Matrix vw_c = vw_c0;
+      GF2Matrix::multiplyInto(vw_av, vw_bv, vw_c.mutableView(11, 204, 64, 311), vw_ws);
+      view_test &= vw_c == vw_expect(false, vw_ref);
+      vw_c = vw_c0;
+      GF2Matrix::addMul(vw_c.mutableView(11, 204, 64, 311), vw_av, vw_bv, vw_ws, 2);
+      view_test &= vw_c == vw_expect(true, vw_ref);
+      vw_c = vw_c0;
+      GF2Matrix::multiplyM4RInto(vw_av, vw_bv, vw_c.mutableView(11, 204, 64, 311));
+      view_test &= vw_c == vw_expect(false, vw_ref);
+      vw_c = vw_c0;
+      GF2Matrix::multiplyStrassenInto(vw_av, vw_bv, vw_c.mutableView(11, 204, 64, 311), 64);
+      view_test &= vw_c == vw_expect(false, vw_ref);
+      vw_c = vw_c0;
+      GF2Matrix::transposeInto(vw_b.view(13, 260, 100, 293), vw_c.mutableView(11, 204, 64, 311));
+      view_test &=
+          vw_c == vw_expect(false, vw_cut(vw_b, 13, 100, 247, 193).transpose().materialize());
+
+      for (const auto& [vw_lo, vw_hi] : {std::pair<size_t, size_t>{3, 64}, {0, 100},
+                                        {64, 312}}) {
+        bool vw_threw = false;
+        try {
+          vw_c.mutableView(0, 10, vw_lo, vw_hi);
+        } catch (const std::runtime_error &) {
+          vw_threw = true;
+        }
+        view_test &= vw_threw;
+      }
+      bool vw_threw = false;
+      try {
+        vw_a.view(20, 10, 0, 5);
+      } catch (const std::runtime_error &) {
+        vw_threw = true;
+      }
+      view_test &= vw_threw;
+    }
+    std::cout << "View test: " << (view_test ? "PASSED" : "FAILED") << "\n";
+
+    // Test 22: Boolean products and transitive closures against the
+    // triple loop and Warshall's algorithm, on operands sparse enough that
+    // the OR of the products is not all ones
+    std::cout << "Testing Boolean products...\n";
+    bool boolean_test = true;
+    std::mt19937 bl_rng(52);
+    // About 'ones' ones per row
+    auto bl_random = [&bl_rng](size_t rows, size_t cols, size_t ones) {
+      GF2Matrix m(rows, cols);
+      for (size_t i = 0; i < rows; ++i) {
+        for (size_t j = 0; j < cols; ++j) {
+          if (bl_rng() % cols < ones) m.set(i, j, true);
+        }
+      }
+      return m;
+    };
+    for (const auto& [bl_m, bl_k, bl_n] : {std::tuple<size_t, size_t, size_t>{1, 1, 1},
+                                           {70, 130, 65}, {200, 300, 129}}) {
+      const GF2Matrix bl_a = bl_random(bl_m, bl_k, 3);
+      const GF2Matrix bl_b = bl_random(bl_k, bl_n, 1 + bl_n / 10);
+      GF2Matrix bl_ref(bl_m, bl_n);
+      for (size_t i = 0; i < bl_m; ++i) {
+        for (size_t j = 0; j < bl_n; ++j) {
+          bool any = false;
+          for (size_t k = 0; k < bl_k && !any; ++k) any = bl_a.get(i, k) && bl_b.get(k, j);
+          bl_ref.set(i, j, any);
+        }
+      }
+      boolean_test &= bl_a.multiplyBoolean(bl_b) == bl_ref &&
+                      bl_a.multiplyM4R(bl_b, GF2Semiring::OrAnd) == bl_ref;
+      GF2Workspace bl_ws;
+      GF2Matrix bl_c(bl_m, bl_n);
+      GF2Matrix::multiplyInto(bl_a, bl_b, bl_c, bl_ws, 2, GF2Semiring::OrAnd);
+      boolean_test &= bl_c == bl_ref;
+      // Accumulating ORs into c: c | A*B
+      const GF2Matrix bl_c0 = bl_random(bl_m, bl_n, 1 + bl_n / 10);
+      GF2Matrix bl_expect = bl_c0;
+      for (size_t i = 0; i < bl_m; ++i) {
+        for (size_t j = 0; j < bl_n; ++j) {
+          if (bl_ref.get(i, j)) bl_expect.set(i, j, true);
+        }
+      }
+      bl_c = bl_c0;
+      GF2Matrix::addMul(bl_c, bl_a, bl_b, bl_ws, 1, GF2Semiring::OrAnd);
+      boolean_test &= bl_c == bl_expect;
+      bl_c = bl_c0;
+      GF2Matrix::multiplyM4RInto(bl_a, bl_b, bl_c, true, GF2Semiring::OrAnd);
+      boolean_test &= bl_c == bl_expect;
+    }
+    for (size_t bl_v : {1, 150, 520}) {
+      const GF2Matrix bl_graph = bl_random(bl_v, bl_v, 1);
+      std::vector<std::vector<char>> bl_reach(bl_v, std::vector<char>(bl_v, 0));
+      for (size_t i = 0; i < bl_v; ++i) {
+        for (size_t j = 0; j < bl_v; ++j) bl_reach[i][j] = i == j || bl_graph.get(i, j);
+      }
+      for (size_t k = 0; k < bl_v; ++k) {
+        for (size_t i = 0; i < bl_v; ++i) {
+          if (!bl_reach[i][k]) continue;
+          for (size_t j = 0; j < bl_v; ++j) bl_reach[i][j] |= bl_reach[k][j];
+        }
+      }
+      GF2Matrix bl_ref(bl_v, bl_v);
+      for (size_t i = 0; i < bl_v; ++i) {
+        for (size_t j = 0; j < bl_v; ++j) bl_ref.set(i, j, bl_reach[i][j]);
+      }
+      boolean_test &= bl_graph.transitiveClosure(true) == bl_ref &&
+                      bl_graph.transitiveClosure() == bl_graph.multiplyBoolean(bl_ref);
+    }
+    std::cout << "Boolean product test: " << (boolean_test ? "PASSED" : "FAILED") << "\n";
+
+    // Test 23: .gf2 files round-trip through gf2_load and a mapping, the
+    // mapped view multiplies in place, and a damaged header or file is
+    // rejected
+    std::cout << "Testing .gf2 files...\n";
+    bool file_test = true;
+    const char *tmp_dir = std::getenv("TMPDIR");
+    const std::string file_prefix = std::string(tmp_dir && *tmp_dir ? tmp_dir : "/tmp") +
+                                    "/gf2_test_" + std::to_string(::getpid()) + "_";
+    {
+      const std::string fl_path = file_prefix + "a.gf2";
+      const GF2Matrix fl_a = GF2TestFramework::generateRandomMatrix(300, 517);
+      const GF2Matrix fl_b = GF2TestFramework::generateRandomMatrix(517, 90);
+      gf2_save(fl_a, fl_path);
+      file_test &= gf2_load(fl_path) == fl_a;
+      {
+        const GF2MappedMatrix fl_mapped(fl_path, true);
+        file_test &= fl_mapped.rows() == 300 && fl_mapped.cols() == 517 && fl_mapped.verify() &&
+                     fl_mapped.copy() == fl_a &&
+                     reinterpret_cast<uintptr_t>(fl_mapped.get_raw_data()) % 64 == 0;
+        GF2Workspace fl_ws;
+        GF2Matrix fl_c(300, 90);
+        GF2Matrix::multiplyInto(fl_mapped.view(), fl_b, fl_c, fl_ws);
+        file_test &= fl_c == fl_a.multiplySerial(fl_b);
+      }
+
+      // Overwrites bytes of a freshly saved file; whether opening it throws
+      auto fl_rejected = [&](std::streamoff offset, const std::string& bytes, bool verify) {
+        gf2_save(fl_a, fl_path);
+        {
+          std::fstream f(fl_path, std::ios::in | std::ios::out | std::ios::binary);
+          f.seekp(offset);
+          f.write(bytes.data(), std::streamsize(bytes.size()));
+        }
+        try {
+          GF2MappedMatrix fl_mapped(fl_path, verify);
+        } catch (const std::runtime_error &) {
+          return true;
+        }
+        return false;
+      };
+      // A wrong magic and version, more rows than the file holds, and a
+      // changed data byte, which only the checksum catches
+      const uint64_t fl_rows = 100000;
+      const std::string fl_rows_bytes(reinterpret_cast<const char *>(&fl_rows), 8);
+      file_test &= fl_rejected(0, "GF2MATRY", false) &&
+                   fl_rejected(8, std::string("\2\0\0\0", 4), false) &&
+                   fl_rejected(16, fl_rows_bytes, false) &&
+                   fl_rejected(GF2_FILE_ALIGNMENT + 100, "\x5a", true) &&
+                   !fl_rejected(GF2_FILE_ALIGNMENT + 100, "\x5a", false);
+      bool fl_threw = false;
+      try {
+        gf2_load(fl_path);
+      } catch (const std::runtime_error &) {
+        fl_threw = true;
+      }
+      file_test &= fl_threw;
+      std::remove(fl_path.c_str());
+    }
+    std::cout << "File format test: " << (file_test ? "PASSED" : "FAILED") << "\n";
+
+    // Test 24: a product streamed between .gf2 files, in many panels under
+    // a small memory budget and with B held in memory, is the in-memory
+    // product
+    std::cout << "Testing streamed file multiply...\n";
+    bool stream_files_test = true;
+    {
+      const std::string sf_a = file_prefix + "sa.gf2", sf_b = file_prefix + "sb.gf2",
+                        sf_c = file_prefix + "sc.gf2";
+      const GF2Matrix sf_ma = GF2TestFramework::generateRandomMatrix(500, 700);
+      const GF2Matrix sf_mb = GF2TestFramework::generateRandomMatrix(700, 1300);
+      gf2_save(sf_ma, sf_a);
+      gf2_save(sf_mb, sf_b);
+      const GF2Matrix sf_ref = sf_ma.multiplySerial(sf_mb);
+      GF2StreamConfig sf_config;
+      sf_config.memory_bytes = 64 * 1024;
+      GF2StreamStats sf_stats = gf2_multiply_files(sf_a, sf_b, sf_c, sf_config);
+      stream_files_test &= sf_stats.row_panels > 1 && sf_stats.col_panels > 1 &&
+                           GF2MappedMatrix(sf_c, true).copy() == sf_ref;
+      sf_stats = gf2_multiply_files(sf_a, sf_b, sf_c);
+      stream_files_test &= sf_stats.col_panels == 1 && gf2_load(sf_c) == sf_ref;
+      bool sf_threw = false;
+      try {
+        gf2_multiply_files(sf_b, sf_b, sf_c);
+      } catch (const std::runtime_error &) {
+        sf_threw = true;
+      }
+      stream_files_test &= sf_threw;
+      for (const std::string& path : {sf_a, sf_b, sf_c}) std::remove(path.c_str());
+    }
+    std::cout << "Streamed file multiply test: " << (stream_files_test ? "PASSED" : "FAILED")
+              << "\n";
+
+    // Test 25: SUMMA on 1 to 6 ranks of the in-process transport, on the
+    // squarest grids and on a 1 x 6 and a 3 x 2, against the serial product
+    std::cout << "Testing distributed multiply...\n";
+    bool summa_test = true;
+    {
+      const GF2Matrix sm_a = GF2TestFramework::generateRandomMatrix(300, 1000);
+      const GF2Matrix sm_b = GF2TestFramework::generateRandomMatrix(1000, 700);
+      const GF2Matrix sm_ref = sm_a.multiplySerial(sm_b);
+      for (const auto& [sm_ranks, sm_grid_rows] : {std::pair<int, int>{1, 0}, {2, 0}, {3, 0},
+                                                   {4, 0}, {5, 0}, {6, 0}, {6, 1}, {6, 3}}) {
+        const GF2SummaLayout sm_layout(300, 1000, 700, sm_ranks, 128, sm_grid_rows);
+        auto sm_transports = GF2LocalTransport::create(sm_ranks);
+        GF2Matrix sm_c(300, 700);
+        std::mutex sm_mutex;
+        bool sm_ok = true;
+        std::vector<std::thread> sm_threads;
+        for (int r = 0; r < sm_ranks; ++r) {
+          sm_threads.emplace_back([&, r]() {
+            try {
+              GF2SummaConfig sm_config;
+              sm_config.num_threads = 1;
+              const GF2Matrix c_local =
+                  gf2_summa_multiply(sm_layout.localA(sm_a, r), sm_layout.localB(sm_b, r),
+                                     sm_layout, *sm_transports[r], sm_config);
+              std::lock_guard<std::mutex> lock(sm_mutex);
+              sm_layout.placeC(c_local, r, sm_c);
+            } catch (const std::exception &) {
+              std::lock_guard<std::mutex> lock(sm_mutex);
+              sm_ok = false;
+            }
+          });
+        }
+        for (std::thread& t : sm_threads) t.join();
+        summa_test &= sm_ok && sm_layout.panels() == 8 && sm_c == sm_ref;
+      }
+      bool sm_threw = false;
+      try {
+        GF2SummaLayout(300, 1000, 700, 4, 128, 3);
+      } catch (const std::runtime_error &) {
+        sm_threw = true;
+      }
+      summa_test &= sm_threw;
+    }
+    std::cout << "Distributed multiply test: " << (summa_test ? "PASSED" : "FAILED") << "\n";
+
+    // Test 26: four threads submit small products, products of a shared B
+    // and products of one shape to the service at once; every future holds
+    // the serial product of its own operands
+    std::cout << "Testing multiply service...\n";
+    bool service_test = true;
+    {
+      GF2ServiceConfig sv_config;
+      sv_config.workers = 2;
+      GF2MultiplyService sv_service(sv_config);
+      const auto sv_shared = std::make_shared<const GF2Matrix>(
+          GF2TestFramework::generateRandomMatrix(300, 200));
+      struct Submitted {
+        GF2Matrix a, b;
+        std::future<GF2Matrix> c;
+      };
+      std::vector<std::vector<Submitted>> sv_submitted(4);
+      std::vector<std::thread> sv_threads;
+      for (size_t t = 0; t < sv_submitted.size(); ++t) {
+        sv_threads.emplace_back([&, t]() {
+          std::mt19937 rng(61 + unsigned(t));
+          for (int i = 0; i < 60; ++i) {
+            GF2Matrix a(0, 0), b(0, 0);
+            std::future<GF2Matrix> c;
+            if (i % 3 == 0) {
+              a = GF2TestFramework::generateRandomMatrix(1 + rng() % 64, 1 + rng() % 64);
+              b = GF2TestFramework::generateRandomMatrix(a.cols(), 1 + rng() % 64);
+              c = sv_service.submit(a, b);
+            } else if (i % 3 == 1) {
+              a = GF2TestFramework::generateRandomMatrix(1 + rng() % 150, 300);
+              b = *sv_shared;
+              c = sv_service.submit(a, sv_shared);
+            } else {
+              a = GF2TestFramework::generateRandomMatrix(100, 130);
+              b = GF2TestFramework::generateRandomMatrix(130, 90);
+              c = sv_service.submit(a, b);
+            }
+            sv_submitted[t].push_back(Submitted{std::move(a), std::move(b), std::move(c)});
+          }
+        });
+      }
+      for (std::thread& t : sv_threads) t.join();
+      for (std::vector<Submitted>& list : sv_submitted) {
+        for (Submitted& s : list) service_test &= s.c.get() == s.a.multiplySerial(s.b);
+      }
+      bool sv_threw = false;
+      try {
+        sv_service.submit(GF2Matrix(10, 20), GF2Matrix(21, 10));
+      } catch (const std::runtime_error &) {
+        sv_threw = true;
+      }
+      const GF2ServiceStats sv_stats = sv_service.stats();
+      service_test &= sv_threw && sv_stats.submitted == 240 && sv_stats.completed == 240 &&
+                      sv_stats.batches > 0 && sv_stats.batches <= 240;
+      size_t sv_counted = 0;
+      for (size_t n : sv_stats.batch_sizes) sv_counted += n;
+      service_test &= sv_counted == sv_stats.batches && sv_stats.max_batch_size >= 1 &&
+                      sv_stats.max_batch_size <= sv_config.max_batch;
+    }
+    {
+      // 32 small requests well within a long delay run as one full batch
+      GF2ServiceConfig sv_config;
+      sv_config.max_batch = 32;
+      sv_config.max_delay = std::chrono::seconds(5);
+      GF2MultiplyService sv_service(sv_config);
+      std::vector<GF2Matrix> sv_as, sv_bs;
+      std::vector<std::future<GF2Matrix>> sv_cs;
+      for (int i = 0; i < 32; ++i) {
+        sv_as.push_back(GF2TestFramework::generateRandomMatrix(64, 64));
+        sv_bs.push_back(GF2TestFramework::generateRandomMatrix(64, 64));
+        sv_cs.push_back(sv_service.submit(sv_as.back(), sv_bs.back()));
+      }
+      for (int i = 0; i < 32; ++i) {
+        service_test &= sv_cs[i].get() == sv_as[i].multiplySerial(sv_bs[i]);
+      }
+      const GF2ServiceStats sv_stats = sv_service.stats();
+      service_test &= sv_stats.batches == 1 && sv_stats.max_batch_size == 32 &&
+                      sv_stats.batch_sizes[5] == 1 && sv_stats.mean_batch_size == 32.0;
+    }
+    std::cout << "Multiply service test: " << (service_test ? "PASSED" : "FAILED") << "\n";
+
+    // Test 27: products posted through a shared-memory region, several in
+    // flight, come back as the serial product, and a request whose shapes
+    // do not match fails with the server's error
+    std::cout << "Testing shared-memory interface...\n";
+    bool shm_test = true;
+    {
+      const std::string sh_name = "/gf2_test_" + std::to_string(::getpid());
+      GF2ShmServer sh_server(sh_name, size_t(16) << 20, 1);
+      std::thread sh_thread([&sh_server]() { sh_server.run(); });
+      try {
+        GF2ShmClient sh_client(sh_name);
+        // A copy of m in the arena
+        auto sh_place = [&sh_client](const GF2Matrix& m) {
+          const GF2ShmMatrix s = sh_client.allocate(m.rows(), m.cols());
+          for (size_t r = 0; r < m.rows(); ++r) {
+            std::copy_n(m.get_raw_data() + r * m.row_stride(), m.words_per_row(),
+                        s.get_raw_data() + r * s.row_stride());
+          }
+          return s;
+        };
+        std::vector<GF2Matrix> sh_refs;
+        std::vector<GF2ShmMatrix> sh_cs;
+        std::vector<size_t> sh_tickets;
+        for (const auto& [sh_m, sh_k, sh_n] : {std::tuple<size_t, size_t, size_t>{1, 1, 1},
+                                               {200, 300, 150}, {64, 1000, 700}}) {
+          const GF2Matrix sh_a = GF2TestFramework::generateRandomMatrix(sh_m, sh_k);
+          const GF2Matrix sh_b = GF2TestFramework::generateRandomMatrix(sh_k, sh_n);
+          sh_refs.push_back(sh_a.multiplySerial(sh_b));
+          sh_cs.push_back(sh_client.allocate(sh_m, sh_n));
+          sh_tickets.push_back(sh_client.submit(sh_place(sh_a), sh_place(sh_b), sh_cs.back()));
+        }
+        for (size_t i = 0; i < sh_tickets.size(); ++i) {
+          sh_client.wait(sh_tickets[i]);
+          shm_test &= sh_cs[i].view().copy() == sh_refs[i];
+          sh_client.release(sh_cs[i]);
+        }
+        bool sh_threw = false;
+        try {
+          sh_client.multiply(sh_client.allocate(10, 20), sh_client.allocate(21, 10),
+                             sh_client.allocate(10, 10));
+        } catch (const std::runtime_error &) {
+          sh_threw = true;
+        }
+        shm_test &= sh_threw;
+      } catch (const std::exception &e) {
+        std::cerr << "Shared-memory interface: " << e.what() << "\n";
+        shm_test = false;
+      }
+      sh_server.stop();
+      sh_thread.join();
+      shm_test &= sh_server.served() == 4;
+    }
+    std::cout << "Shared-memory test: " << (shm_test ? "PASSED" : "FAILED") << "\n";
+
+    // Test 28: product expressions pick the cheap order for a chain ending
+    // or starting in a vector, evaluate to the left-to-right serial product,
+    // and write into (or accumulate into) one of their own operands
+    std::cout << "Testing product expressions...\n";
+    bool expr_test = true;
+    {
+      // a ^ b
+      auto ex_sum = [](GF2Matrix a, const GF2Matrix& b) {
+        for (size_t i = 0; i < a.rows(); ++i) a.rowXor(i, b, i);
+        return a;
+      };
+      const GF2Matrix ex_a = GF2TestFramework::generateRandomMatrix(200, 300);
+      const GF2Matrix ex_b = GF2TestFramework::generateRandomMatrix(300, 250);
+      const GF2Matrix ex_x = GF2TestFramework::generateRandomMatrix(250, 1);
+      const GF2Matrix ex_y = GF2TestFramework::generateRandomMatrix(1, 200);
+      const GF2Matrix ex_ab = ex_a.multiplySerial(ex_b);
+      const GF2Product ex_abx = ex_a * ex_b * ex_x;
+      expr_test &= ex_abx.order() == "(0 (1 2))" && ex_abx.cost() < ex_abx.leftToRightCost() &&
+                   ex_abx.evaluate() == ex_ab.multiplySerial(ex_x);
+      const GF2Product ex_yab = ex_y * ex_a * ex_b;
+      expr_test &= ex_yab.order() == "((0 1) 2)" &&
+                   GF2Matrix(ex_yab) == ex_y.multiplySerial(ex_a).multiplySerial(ex_b);
+      const GF2Matrix ex_c = GF2TestFramework::generateRandomMatrix(250, 40);
+      const GF2Matrix ex_d = GF2TestFramework::generateRandomMatrix(40, 500);
+      const GF2Product ex_chain = ex_y * ex_a * (ex_b * ex_c) * ex_d;
+      expr_test &= ex_chain.cost() <= ex_chain.leftToRightCost() &&
+                   ex_chain.evaluate() ==
+                       ex_y.multiplySerial(ex_ab).multiplySerial(ex_c).multiplySerial(ex_d);
+
+      // Outputs aliasing an operand: s = s * t * t, s ^= s * t, and a sum
+      const GF2Matrix ex_s0 = GF2TestFramework::generateRandomMatrix(130, 130);
+      const GF2Matrix ex_t = GF2TestFramework::generateRandomMatrix(130, 130);
+      const GF2Matrix ex_st = ex_s0.multiplySerial(ex_t);
+      GF2Matrix ex_s = ex_s0;
+      (ex_s * ex_t * ex_t).evaluateInto(ex_s);
+      expr_test &= ex_s == ex_st.multiplySerial(ex_t);
+      ex_s = ex_s0;
+      ex_s ^= ex_s * ex_t;
+      expr_test &= ex_s == ex_sum(ex_s0, ex_st);
+      ex_s = ex_s0;
+      (ex_s * ex_t + ex_t * ex_s).evaluateInto(ex_s, true);
+      expr_test &= ex_s == ex_sum(ex_sum(ex_s0, ex_st), ex_t.multiplySerial(ex_s0));
+      ex_s = ex_s0;
+      ex_s = ex_t * ex_s + ex_s * ex_t;
+      expr_test &= ex_s == ex_sum(ex_t.multiplySerial(ex_s0), ex_st);
+
+      for (int ex_case = 0; ex_case < 2; ++ex_case) {
+        bool ex_threw = false;
+        try {
+          if (ex_case == 0) {
+            GF2Product ex_bad = ex_a * ex_b;
+            ex_bad *= GF2Product(ex_a);
+          } else {
+            GF2ProductSum ex_bad = ex_a * ex_b + ex_b * ex_c;
+          }
+        } catch (const std::runtime_error &) {
+          ex_threw = true;
+        }
+        expr_test &= ex_threw;
+      }
+    }
+    std::cout << "Product expression test: " << (expr_test ? "PASSED" : "FAILED") << "\n";
+
+    // Test 29: an incremental product after rounds of row edits of A, of B
+    // and of both, few and many rows (both paths of each), is the product
+    // recomputed from scratch
+    std::cout << "Testing incremental products...\n";
+    bool incremental_test = true;
+    {
+      GF2IncrementalProduct in_p(GF2TestFramework::generateRandomMatrix(300, 500),
+                                 GF2TestFramework::generateRandomMatrix(500, 270));
+      std::mt19937 in_rng(65);
+      for (const auto& [in_rows_a, in_rows_b] : {std::pair<size_t, size_t>{3, 0}, {20, 0},
+                                                 {0, 5}, {0, 40}, {7, 12}, {70, 70}}) {
+        const GF2Matrix in_new_a = GF2TestFramework::generateRandomMatrix(in_rows_a, 500);
+        const GF2Matrix in_new_b = GF2TestFramework::generateRandomMatrix(in_rows_b, 270);
+        for (size_t i = 0; i < in_rows_a; ++i) {
+          in_p.setRowOfA(in_rng() % 300, in_new_a.get_raw_data() + i * in_new_a.row_stride());
+        }
+        for (size_t i = 0; i < in_rows_b; ++i) {
+          const size_t r = in_rng() % 500;
+          // An edit in place, then the same row set again
+          uint64_t* row = in_p.editRowOfB(r);
+          row[0] ^= 1;
+          in_p.setRowOfB(r, in_new_b.get_raw_data() + i * in_new_b.row_stride());
+        }
+        incremental_test &= in_p.pendingRowsOfA() <= in_rows_a &&
+                            in_p.pendingRowsOfB() <= in_rows_b &&
+                            (in_rows_b == 0 || in_p.pendingRowsOfB() > 0);
+        in_p.update();
+        incremental_test &= in_p.pendingRowsOfA() == 0 && in_p.pendingRowsOfB() == 0 &&
+                            in_p.product() == in_p.a().multiplySerial(in_p.b());
+      }
+      incremental_test &= in_p.rowsRecomputed() > 0 && in_p.correctionRank() > 0;
+      in_p.editRowOfA(0)[0] ^= 1;
+      in_p.recompute();
+      incremental_test &= in_p.pendingRowsOfA() == 0 &&
+                          in_p.product() == in_p.a().multiplySerial(in_p.b());
+      bool in_threw = false;
+      try {
+        in_p.editRowOfB(500);
+      } catch (const std::runtime_error &) {
+        in_threw = true;
+      }
+      incremental_test &= in_threw;
+    }
+    std::cout << "Incremental product test: " << (incremental_test ? "PASSED" : "FAILED") << "\n";
+
+    // Test 30: multiplyInto overwrites a used output and addMul accumulates
+    // into a non-zero one, with one workspace across shapes and with a
+    // packed B, like the serial product; mismatched shapes throw
+    std::cout << "Testing products into an output...\n";
+    bool into_test = true;
+    {
+      GF2Workspace in_ws;
+      for (const auto& [in_m, in_k, in_n] : {std::tuple<size_t, size_t, size_t>{1, 1, 1},
+                                             {300, 200, 100}, {70, 515, 130}, {64, 64, 64}}) {
+        const GF2Matrix in_a = GF2TestFramework::generateRandomMatrix(in_m, in_k);
+        const GF2Matrix in_b = GF2TestFramework::generateRandomMatrix(in_k, in_n);
+        const GF2Matrix in_c0 = GF2TestFramework::generateRandomMatrix(in_m, in_n);
+        const GF2Matrix in_ref = in_a.multiplySerial(in_b);
+        GF2Matrix in_sum = in_c0;
+        for (size_t i = 0; i < in_m; ++i) in_sum.rowXor(i, in_ref, i);
+        const GF2PackedOperand in_packed(in_b);
+        for (int in_threads : {1, 3}) {
+          GF2Matrix in_c = in_c0;
+          in_a.multiplyInto(in_b, in_c, in_ws, in_threads);
+          into_test &= in_c == in_ref;
+          in_c = in_c0;
+          in_a.multiplyInto(in_packed, in_c, in_threads);
+          into_test &= in_c == in_ref;
+          in_c = in_c0;
+          GF2Matrix::addMul(in_c, in_a, in_b, in_ws, in_threads);
+          into_test &= in_c == in_sum;
+          in_c = in_c0;
+          GF2Matrix::addMul(in_c, in_a, in_packed, in_threads);
+          into_test &= in_c == in_sum;
+        }
+      }
+      const GF2Matrix in_a = GF2TestFramework::generateRandomMatrix(100, 200);
+      const GF2Matrix in_b = GF2TestFramework::generateRandomMatrix(200, 50);
+      const GF2Matrix in_short = GF2TestFramework::generateRandomMatrix(199, 50);
+      for (int in_case = 0; in_case < 4; ++in_case) {
+        GF2Matrix in_c(in_case % 2 == 0 ? 100 : 101, 50);
+        const GF2Matrix& in_rhs = in_case % 2 == 0 ? in_short : in_b;
+        bool in_threw = false;
+        try {
+          if (in_case < 2) {
+            in_a.multiplyInto(in_rhs, in_c, in_ws);
+          } else {
+            GF2Matrix::addMul(in_c, in_a, in_rhs, in_ws);
+          }
+        } catch (const std::runtime_error &) {
+          in_threw = true;
+        }
+        into_test &= in_threw;
+      }
+    }
+    std::cout << "Into test: " << (into_test ? "PASSED" : "FAILED") << "\n";
+
     std::cout << "\n=== Test Suite Complete ===\n";
 
   } catch (const std::exception &e) {
@@ -121,5 +1540,5 @@ int main(int argc, char *argv[]) {
     return 1;
   }
 
-  return 0;
+  return status;
 }
@@ -0,0 +1,760 @@
+#include "GF2Backend.hpp"
+#include "GF2CpuInfo.hpp"
+#include "GF2Fixed.hpp"
+#include "GF2Kernels.hpp"
+#include "GF2Matrix.hpp"
+#include "GF2MatrixBatch.hpp"
+#include "GF2SparseMatrix.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Microbenchmarks of the individual kernels, in the manner of Google
+// Benchmark: a benchmark is a function of a State that runs its loop body
+// once per iteration,
+//
+//   for (auto _ : state) { ... }
+//
+// and the driver grows the iteration count until one run lasts at least
+// --min-time. gf2_test and gf2_bench time whole multiplies; these time the
+// pieces they are made of.
+
+namespace {
+
+const char *USAGE =
+    "Usage: gf2_microbench [options]\n"
+    "  --filter=REGEX     run the benchmarks whose name matches\n"
+    "  --list             print the benchmark names and exit\n"
+    "  --min-time=SEC     minimum time of a measured run (default: 0.2)\n"
+    "  --repetitions=N    measured runs per benchmark, with their median\n"
+    "  --format=FORMAT    console or csv (default: console)\n"
+    "  --output=FILE      write to FILE instead of stdout\n"
+    "Options take their value after '=' or as the next argument.\n";
+
+using Clock = std::chrono::steady_clock;
+
+// Keeps the compiler from dropping a value, or the stores to memory before
+// this point, as unused
+template <class T> inline void do_not_optimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+class State {
+public:
+  State(const std::vector<int64_t> &args, size_t iterations)
+      : _args(args), _iterations(iterations) {}
+
+  int64_t range(size_t i) const { return _args.at(i); }
+  size_t iterations() const { return _iterations; }
+
+  // The range-for protocol of the timed loop. The clock runs from begin()
+  // until the last iteration is done.
+  struct [[maybe_unused]] Value {}; // so an unused loop variable is fine
+  class Iterator {
+  public:
+    Iterator(State *state, size_t left) : _state(state), _left(left) {}
+    Value operator*() const { return Value(); }
+    void operator++() { --_left; }
+    bool operator!=(const Iterator &) {
+      if (_left == 0) {
+        _state->stop();
+        return false;
+      }
+      return true;
+    }
+
+  private:
+    State *_state;
+    size_t _left;
+  };
+  Iterator begin() {
+    start();
+    return Iterator(this, _iterations);
+  }
+  Iterator end() { return Iterator(this, 0); }
+
+  // Untimed setup inside the loop
+  void pauseTiming() { stop(); }
+  void resumeTiming() { start(); }
+
+  // Manual timing: the benchmark measures each iteration itself (a GPU
+  // kernel's execution time) and the wall clock is ignored
+  void setIterationTime(double seconds) {
+    _manual = true;
+    _manual_seconds += seconds;
+  }
+
+  // Totals over all iterations, reported per second
+  void setBytesProcessed(double bytes) { _bytes = bytes; }
+  void setItemsProcessed(double items) { _items = items; }
+  void setLabel(const std::string &label) { _label = label; }
+  // No measurement, with the reason instead
+  void skip(const std::string &reason) { _error = reason; }
+
+  double realSeconds() const { return _manual ? _manual_seconds : _real; }
+  double cpuSeconds() const { return _cpu; }
+  double bytes() const { return _bytes; }
+  double items() const { return _items; }
+  const std::string &label() const { return _label; }
+  const std::string &error() const { return _error; }
+
+private:
+  void start() {
+    _real_start = Clock::now();
+    _cpu_start = std::clock();
+  }
+  void stop() {
+    _real += std::chrono::duration<double>(Clock::now() - _real_start).count();
+    _cpu += double(std::clock() - _cpu_start) / CLOCKS_PER_SEC;
+  }
+
+  std::vector<int64_t> _args;
+  size_t _iterations;
+  Clock::time_point _real_start;
+  std::clock_t _cpu_start = 0;
+  double _real = 0.0, _cpu = 0.0;
+  bool _manual = false;
+  double _manual_seconds = 0.0;
+  double _bytes = 0.0, _items = 0.0;
+  std::string _label, _error;
+};
+
+struct Benchmark {
+  std::string name;
+  std::function<void(State &)> run;
+  std::vector<std::vector<int64_t>> args; // one run per entry
+};
+
+struct Measurement {
+  std::string name;
+  size_t iterations = 0;
+  double real_ns = 0.0; // per iteration
+  double cpu_ns = 0.0;
+  double bytes_per_second = 0.0;
+  double items_per_second = 0.0;
+  std::string label;
+  std::string error;
+};
+
+using AlignedWords = std::vector<uint64_t, GF2AlignedAllocator<uint64_t>>;
+
+AlignedWords random_words(size_t count, uint64_t seed) {
+  std::mt19937_64 rng(seed);
+  AlignedWords words(count);
+  for (uint64_t &w : words) {
+    w = rng();
+  }
+  return words;
+}
+
+size_t stride_of(size_t bits) {
+  const size_t align = GF2Matrix::ROW_ALIGN_WORDS;
+  return ((bits + 63) / 64 + align - 1) / align * align;
+}
+
+// --- Benchmarks ---
+
+// transpose_matrix of an n x n matrix
+void bm_transpose(State &state) {
+  const size_t n = size_t(state.range(0));
+  const size_t stride = stride_of(n);
+  const AlignedWords src = random_words(n * stride, 1);
+  AlignedWords dst(n * stride);
+  for (auto _ : state) {
+    transpose_matrix(src.data(), stride, dst.data(), stride, n, n);
+    do_not_optimize(dst.data());
+  }
+  state.setBytesProcessed(2.0 * double(state.iterations()) * double(n) *
+                          double(n) / 8.0);
+}
+
+// transpose_64x64 of one block in L1
+void bm_transpose_64x64(State &state) {
+  AlignedWords block = random_words(64, 2);
+  for (auto _ : state) {
+    transpose_64x64(block.data());
+    do_not_optimize(block.data());
+  }
+  state.setBytesProcessed(2.0 * double(state.iterations()) * 64 * 8);
+}
+
+// One call of a dot-product block kernel as the parallel driver makes it:
+// PARALLEL_ROW_BLOCK rows of A against PARALLEL_COL_BLOCK columns of B^T,
+// over k words of the common dimension
+void bm_dot_block(State &state, const SimdKernel &kernel) {
+  const size_t rows = GF2Matrix::PARALLEL_ROW_BLOCK;
+  const size_t cols = GF2Matrix::PARALLEL_COL_BLOCK;
+  const size_t k_words = size_t(state.range(0));
+  const AlignedWords a = random_words(rows * k_words, 3);
+  const AlignedWords b_t = random_words(cols * k_words, 4);
+  AlignedWords c(rows * (cols / 64));
+
+  AlignedWords packed;
+  const uint64_t *b = b_t.data();
+  size_t b_stride = k_words;
+  if (kernel.pack_b) {
+    packed.resize(cols / 64 * k_words * 64);
+    kernel.pack_b(b_t.data(), k_words, cols, k_words, packed.data());
+    b = packed.data();
+    b_stride = k_words * 64;
+  }
+
+  for (auto _ : state) {
+    kernel.block(a.data(), k_words, b, b_stride, c.data(), cols / 64, cols, 0,
+                 rows, 0, cols / 64, 0, k_words, false);
+    do_not_optimize(c.data());
+  }
+  state.setItemsProcessed(double(state.iterations()) * rows * cols *
+                          double(k_words) * 64.0);
+  state.setBytesProcessed(double(state.iterations()) * 8.0 *
+                          double((rows + cols) * k_words));
+}
+
+// One M4R table: 2^8 entries of a panel of 'width' words
+void bm_m4r_table(State &state) {
+  const size_t width = size_t(state.range(0));
+  const AlignedWords b = random_words(M4R_BITS * width, 5);
+  AlignedWords table(M4R_TABLE_ROWS * width);
+  for (auto _ : state) {
+    m4r_build_table(b.data(), width, M4R_BITS, width, table.data());
+    do_not_optimize(table.data());
+  }
+  state.setBytesProcessed(double(state.iterations()) * 8.0 *
+                          double(M4R_TABLE_ROWS * width));
+}
+
+// m4r_multiply_block of m x 64 by 64 x 64n: one word of A per row, so the
+// eight table builds are amortised over m rows of lookups
+void bm_m4r_block(State &state) {
+  const size_t m = size_t(state.range(0));
+  const size_t n_words = size_t(state.range(1));
+  const size_t stride = stride_of(n_words * 64);
+  const AlignedWords a = random_words(m, 6);
+  const AlignedWords b = random_words(64 * stride, 7);
+  AlignedWords c(m * stride);
+  for (auto _ : state) {
+    m4r_multiply_block(a.data(), 1, b.data(), stride, c.data(), stride, m, 64,
+                       n_words, false);
+    do_not_optimize(c.data());
+  }
+  state.setItemsProcessed(double(state.iterations()) * double(m) * 64.0 *
+                          double(n_words) * 64.0);
+  state.setLabel("panel " + std::to_string(m4r_panel_words(n_words)) +
+                 " words");
+}
+
+// dst ^= src over rows of 'words' words: the inner step of the M4R table
+// build and of row reduction
+void bm_row_xor(State &state) {
+  const size_t words = size_t(state.range(0));
+  const AlignedWords src = random_words(words, 8);
+  AlignedWords dst = random_words(words, 9);
+  for (auto _ : state) {
+    uint64_t *d = dst.data();
+    const uint64_t *s = src.data();
+    for (size_t j = 0; j < words; ++j) {
+      d[j] ^= s[j];
+    }
+    do_not_optimize(d);
+  }
+  state.setBytesProcessed(double(state.iterations()) * 3.0 * 8.0 *
+                          double(words));
+}
+
+// Ones in a row of 'words' words with the selected row kernel
+void bm_row_weight(State &state) {
+  const size_t words = size_t(state.range(0));
+  const AlignedWords row = random_words(words, 10);
+  const RowKernel &kernel = row_kernel();
+  size_t total = 0;
+  for (auto _ : state) {
+    total += kernel.weight(row.data(), words);
+    do_not_optimize(&total);
+  }
+  state.setBytesProcessed(double(state.iterations()) * 8.0 * double(words));
+  state.setLabel(kernel.name);
+}
+
+void bm_random_fill(State &state) {
+  const size_t n = size_t(state.range(0));
+  GF2Matrix matrix(n, n);
+  uint64_t seed = 0;
+  for (auto _ : state) {
+    matrix.randomFill(++seed);
+    do_not_optimize(matrix.get_raw_data());
+  }
+  state.setBytesProcessed(double(state.iterations()) * double(n) *
+                          double(n) / 8.0);
+}
+
+// n x n at 1% density times a dense n x n: nnz(A) row XORs of B
+void bm_sparse_dense(State &state) {
+  const size_t n = size_t(state.range(0));
+  std::mt19937_64 gen(12);
+  std::vector<size_t> row_start(1, 0);
+  std::vector<uint32_t> indices;
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = 0; j < n / 100; ++j) {
+      indices.push_back(uint32_t(gen() % n));
+    }
+    row_start.push_back(indices.size());
+  }
+  const GF2SparseMatrix a = GF2SparseMatrix::fromIndices(n, n, row_start, indices);
+  GF2Matrix b(n, n);
+  b.randomFill(13);
+  for (auto _ : state) {
+    GF2Matrix c = a.multiply(b, 1);
+    do_not_optimize(c.get_raw_data());
+  }
+  state.setItemsProcessed(double(state.iterations()) * double(a.nnz()) *
+                          double(n));
+  state.setLabel("nnz " + std::to_string(a.nnz()));
+}
+
+// n x n times a vector, a block of 64 vectors, and the block on the left:
+// all read A once, so the rate is in bytes of A
+void bm_matvec(State &state, int kind) {
+  const size_t n = size_t(state.range(0));
+  GF2Matrix a(n, n);
+  a.randomFill(14);
+  const AlignedWords x = random_words(n, 15);
+  AlignedWords y(64 * a.words_per_row());
+  for (auto _ : state) {
+    if (kind == 0) {
+      a.multiplyVector(x.data(), y.data(), 1);
+    } else if (kind == 1) {
+      a.multiplyBlock(x.data(), y.data(), 1);
+    } else {
+      a.leftMultiplyBlock(x.data(), y.data(), 1);
+    }
+    do_not_optimize(y.data());
+  }
+  state.setBytesProcessed(double(state.iterations()) *
+                          double(a.words_per_row() * n * 8));
+}
+
+// GF2Fixed<N, N> product, transpose (kind 1) and inverse (kind 2), each
+// result fed into the next call
+template <size_t N> void bm_fixed(State &state, int kind) {
+  GF2Matrix a(N, N), b(N, N);
+  a.randomFill(16);
+  b.randomFill(17);
+  GF2Fixed<N, N> x(a);
+  const GF2Fixed<N, N> y(b);
+  // Invertible: the identity with ones above the diagonal of the first row
+  GF2Fixed<N, N> u = GF2Fixed<N, N>::identity();
+  for (size_t j = 1; j < N; ++j) {
+    u.set(0, j, true);
+  }
+  for (auto _ : state) {
+    if (kind == 0) {
+      x = x.multiply(y);
+    } else if (kind == 1) {
+      x = x.transpose();
+    } else {
+      u = u.inverse();
+    }
+    do_not_optimize(x.row(0));
+    do_not_optimize(u.row(0));
+  }
+  state.setItemsProcessed(double(state.iterations()));
+}
+
+// A batch of n 64 x 64 products (kind 0) or transposes (kind 1), in
+// matrices per second
+void bm_batch(State &state, int kind) {
+  const size_t n = size_t(state.range(0));
+  GF2MatrixBatch a(n), b(n), c(n);
+  a.randomFill(18);
+  b.randomFill(19);
+  for (auto _ : state) {
+    if (kind == 0) {
+      GF2MatrixBatch::multiply(a, b, c, 1);
+    } else {
+      GF2MatrixBatch::transpose(a, c, 1);
+    }
+    do_not_optimize(c.get_raw_data());
+  }
+  state.setItemsProcessed(double(state.iterations()) * double(n));
+  state.setLabel(GF2MatrixBatch::kernelName());
+}
+
+// The backend of this host, created on first use; null without a GPU
+GF2Backend *backend() {
+  static std::unique_ptr<GF2Backend> instance = GF2Backend::create();
+  return instance.get();
+}
+
+// A GPU kernel's n x n multiply, timed by the GPU's own clock, without the
+// uploads, readback and host work around it
+void bm_gpu_kernel(State &state, GF2Kernel kernel) {
+  const size_t n = size_t(state.range(0));
+  GF2Matrix a(n, n), b(n, n), c(n, n);
+  a.randomFill(10);
+  b.randomFill(11);
+  try {
+    backend()->multiply(kernel, a, b, c); // compiles the pipeline
+    for (auto _ : state) {
+      backend()->multiply(kernel, a, b, c);
+      state.setIterationTime(backend()->lastTiming().gpu_ms / 1000.0);
+    }
+  } catch (const std::exception &e) {
+    state.skip(e.what());
+    return;
+  }
+  state.setItemsProcessed(double(state.iterations()) * double(n) * double(n) *
+                          double(n));
+  state.setLabel(backend()->deviceName());
+}
+
+// The GPU's block products (kind as in bm_matvec), by the GPU's clock
+void bm_gpu_matvec(State &state, int kind) {
+  const size_t n = size_t(state.range(0));
+  GF2Matrix a(n, n);
+  a.randomFill(14);
+  const AlignedWords x = random_words(n, 15);
+  AlignedWords y(64 * a.words_per_row());
+  auto run = [&] {
+    if (kind == 1) {
+      backend()->multiplyBlock(a, x.data(), y.data());
+    } else {
+      backend()->leftMultiplyBlock(a, x.data(), y.data());
+    }
+  };
+  try {
+    run(); // compiles the pipeline
+    for (auto _ : state) {
+      run();
+      state.setIterationTime(backend()->lastTiming().gpu_ms / 1000.0);
+    }
+  } catch (const std::exception &e) {
+    state.skip(e.what());
+    return;
+  }
+  state.setBytesProcessed(double(state.iterations()) *
+                          double(a.words_per_row() * n * 8));
+  state.setLabel(backend()->deviceName());
+}
+
+std::vector<Benchmark> benchmarks() {
+  std::vector<Benchmark> list = {
+      {"transpose", bm_transpose, {{64}, {512}, {4096}}},
+      {"transpose_64x64", bm_transpose_64x64, {{}}},
+  };
+  for (const SimdKernel &kernel : simd_kernels()) {
+    list.push_back({std::string("dot_block/") + kernel.name,
+                    [kernel](State &state) { bm_dot_block(state, kernel); },
+                    {{16}, {128}}});
+    if (kernel.block_or) {
+      const SimdKernel boolean{kernel.name, kernel.block_or, nullptr,
+                               kernel.k_align, kernel.block_or};
+      list.push_back({std::string("dot_block_or/") + kernel.name,
+                      [boolean](State &state) { bm_dot_block(state, boolean); },
+                      {{16}, {128}}});
+    }
+  }
+  list.push_back({"m4r_table", bm_m4r_table, {{8}, {64}, {512}}});
+  list.push_back({"m4r_block", bm_m4r_block, {{64, 64}, {4096, 64}}});
+  list.push_back({"row_xor", bm_row_xor, {{16}, {128}, {1024}}});
+  list.push_back({"row_weight", bm_row_weight, {{16}, {128}, {1024}}});
+  list.push_back({"random_fill", bm_random_fill, {{1024}, {4096}}});
+  list.push_back({"sparse_dense", bm_sparse_dense, {{1024}, {4096}}});
+  list.push_back({"matvec", [](State &state) { bm_matvec(state, 0); },
+                  {{1024}, {8192}}});
+  list.push_back({"matvec_block", [](State &state) { bm_matvec(state, 1); },
+                  {{1024}, {8192}}});
+  list.push_back({"matvec_left_block",
+                  [](State &state) { bm_matvec(state, 2); },
+                  {{1024}, {8192}}});
+  list.push_back({"fixed_multiply/64",
+                  [](State &state) { bm_fixed<64>(state, 0); }, {{}}});
+  list.push_back({"fixed_multiply/128",
+                  [](State &state) { bm_fixed<128>(state, 0); }, {{}}});
+  list.push_back({"fixed_transpose/64",
+                  [](State &state) { bm_fixed<64>(state, 1); }, {{}}});
+  list.push_back({"fixed_inverse/64",
+                  [](State &state) { bm_fixed<64>(state, 2); }, {{}}});
+  list.push_back({"batch_multiply",
+                  [](State &state) { bm_batch(state, 0); }, {{1024}}});
+  list.push_back({"batch_transpose",
+                  [](State &state) { bm_batch(state, 1); }, {{1024}}});
+
+  if (backend()) {
+    const std::pair<const char *, GF2Kernel> gpu_kernels[] = {
+        {"baseline", GF2Kernel::Baseline},
+        {"transposed", GF2Kernel::Transposed},
+        {"tiled", GF2Kernel::Tiled},
+        {"vectorized", GF2Kernel::Vectorized},
+        {"simdgroup", GF2Kernel::SimdGroup},
+        {"m4r", GF2Kernel::M4R},
+    };
+    for (const auto &[name, kernel] : gpu_kernels) {
+      if (backend()->supports(kernel)) {
+        list.push_back({std::string("gpu/") + name,
+                        [kernel = kernel](State &state) {
+                          bm_gpu_kernel(state, kernel);
+                        },
+                        {{1024}, {4096}}});
+      }
+    }
+    list.push_back({"gpu/matvec_block",
+                    [](State &state) { bm_gpu_matvec(state, 1); },
+                    {{1024}, {8192}}});
+    list.push_back({"gpu/matvec_left_block",
+                    [](State &state) { bm_gpu_matvec(state, 2); },
+                    {{1024}, {8192}}});
+  }
+  return list;
+}
+
+std::string run_name(const Benchmark &benchmark,
+                     const std::vector<int64_t> &args) {
+  std::string name = benchmark.name;
+  for (int64_t arg : args) {
+    name += "/" + std::to_string(arg);
+  }
+  return name;
+}
+
+Measurement measure(const std::string &name, const State &state) {
+  Measurement m;
+  m.name = name;
+  m.iterations = state.iterations();
+  m.label = state.label();
+  m.error = state.error();
+  if (!m.error.empty() || state.realSeconds() <= 0.0) {
+    return m;
+  }
+  m.real_ns = state.realSeconds() * 1e9 / double(m.iterations);
+  m.cpu_ns = state.cpuSeconds() * 1e9 / double(m.iterations);
+  m.bytes_per_second = state.bytes() / state.realSeconds();
+  m.items_per_second = state.items() / state.realSeconds();
+  return m;
+}
+
+// Runs with 1, then more iterations until a run lasts min_time, then
+// 'repetitions' measured runs at that count
+std::vector<Measurement> run(const Benchmark &benchmark,
+                             const std::vector<int64_t> &args,
+                             double min_time, int repetitions) {
+  const std::string name = run_name(benchmark, args);
+  size_t iterations = 1;
+  for (;;) {
+    State state(args, iterations);
+    benchmark.run(state);
+    if (!state.error().empty()) {
+      return {measure(name, state)};
+    }
+    const double seconds = state.realSeconds();
+    if (seconds >= min_time || iterations >= 1000000000) {
+      if (repetitions <= 1) {
+        return {measure(name, state)};
+      }
+      break;
+    }
+    // Aim 40% past min_time, growing by at most 10x per step
+    const double factor =
+        seconds > 0.0 ? std::min(10.0, 1.4 * min_time / seconds) : 10.0;
+    iterations = std::max(iterations + 1, size_t(double(iterations) * factor));
+  }
+
+  std::vector<Measurement> runs;
+  for (int r = 0; r < repetitions; ++r) {
+    State state(args, iterations);
+    benchmark.run(state);
+    runs.push_back(measure(name, state));
+  }
+  Measurement median = runs[runs.size() / 2];
+  auto middle = [&](double Measurement::*field) {
+    std::vector<double> values;
+    for (const Measurement &m : runs) {
+      values.push_back(m.*field);
+    }
+    std::sort(values.begin(), values.end());
+    const size_t mid = values.size() / 2;
+    return values.size() % 2 ? values[mid]
+                             : 0.5 * (values[mid - 1] + values[mid]);
+  };
+  median.name += "_median";
+  median.real_ns = middle(&Measurement::real_ns);
+  median.cpu_ns = middle(&Measurement::cpu_ns);
+  median.bytes_per_second = middle(&Measurement::bytes_per_second);
+  median.items_per_second = middle(&Measurement::items_per_second);
+  runs.push_back(median);
+  return runs;
+}
+
+// 1.23G/s style
+std::string rate(double per_second) {
+  if (per_second <= 0.0) {
+    return "";
+  }
+  const char *units[] = {"", "k", "M", "G", "T"};
+  size_t unit = 0;
+  while (per_second >= 1000.0 && unit + 1 < sizeof(units) / sizeof(units[0])) {
+    per_second /= 1000.0;
+    ++unit;
+  }
+  std::ostringstream text;
+  text << std::fixed << std::setprecision(per_second < 10.0 ? 2 : 1)
+       << per_second << units[unit] << "/s";
+  return text.str();
+}
+
+void print_console_header(std::ostream &out) {
+  out << std::left << std::setw(32) << "Benchmark" << std::right
+      << std::setw(14) << "Time (ns)" << std::setw(14) << "CPU (ns)"
+      << std::setw(12) << "Iterations" << std::setw(12) << "Bytes"
+      << std::setw(12) << "Items" << "  Label\n";
+  out << std::string(100, '-') << "\n";
+}
+
+void print_console(const Measurement &m, std::ostream &out) {
+  out << std::left << std::setw(32) << m.name << std::right;
+  if (!m.error.empty()) {
+    out << "  skipped: " << m.error << "\n";
+    return;
+  }
+  out << std::fixed << std::setprecision(1) << std::setw(14) << m.real_ns
+      << std::setw(14) << m.cpu_ns << std::defaultfloat << std::setw(12)
+      << m.iterations << std::setw(12) << rate(m.bytes_per_second)
+      << std::setw(12) << rate(m.items_per_second) << "  " << m.label << "\n";
+}
+
+void print_csv(const Measurement &m, std::ostream &out) {
+  auto quoted = [](const std::string &text) {
+    std::string escaped;
+    for (char c : text) {
+      escaped += c == '"' ? std::string("\"\"") : std::string(1, c);
+    }
+    return "\"" + escaped + "\"";
+  };
+  out << quoted(m.name) << "," << m.iterations << "," << m.real_ns << ","
+      << m.cpu_ns << "," << m.bytes_per_second << "," << m.items_per_second
+      << "," << quoted(m.label) << "," << quoted(m.error) << "\n";
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::string filter, format = "console", output;
+  double min_time = 0.2;
+  int repetitions = 1;
+  bool list_only = false;
+
+  try {
+    for (int i = 1; i < argc; ++i) {
+      std::string arg = argv[i];
+      std::string value;
+      const size_t eq = arg.find('=');
+      if (eq != std::string::npos) {
+        value = arg.substr(eq + 1);
+        arg = arg.substr(0, eq);
+      }
+      // The value of an option, after '=' or as the next argument
+      auto next = [&]() {
+        if (eq == std::string::npos) {
+          if (i + 1 >= argc) {
+            throw std::invalid_argument(arg + " needs a value");
+          }
+          value = argv[++i];
+        }
+        return value;
+      };
+
+      if (arg == "--help" || arg == "-h") {
+        std::cout << USAGE;
+        return 0;
+      } else if (arg == "--list") {
+        list_only = true;
+      } else if (arg == "--filter") {
+        filter = next();
+      } else if (arg == "--min-time") {
+        min_time = std::stod(next());
+      } else if (arg == "--repetitions") {
+        repetitions = std::max(1, std::stoi(next()));
+      } else if (arg == "--format") {
+        format = next();
+        if (format != "console" && format != "csv") {
+          throw std::invalid_argument("format " + format);
+        }
+      } else if (arg == "--output") {
+        output = next();
+      } else {
+        throw std::invalid_argument(arg);
+      }
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "Invalid argument: " << e.what() << "\n" << USAGE;
+    return 1;
+  }
+
+  std::ofstream file;
+  if (!output.empty()) {
+    file.open(output);
+    if (!file.is_open()) {
+      std::cerr << "Error: Failed to open file: " << output << "\n";
+      return 1;
+    }
+  }
+  std::ostream &out = output.empty() ? std::cout : file;
+
+  try {
+    const std::regex pattern(filter);
+    std::vector<std::pair<const Benchmark *, std::vector<int64_t>>> selected;
+    const std::vector<Benchmark> all = benchmarks();
+    for (const Benchmark &benchmark : all) {
+      for (const std::vector<int64_t> &args : benchmark.args) {
+        if (std::regex_search(run_name(benchmark, args), pattern)) {
+          selected.push_back({&benchmark, args});
+        }
+      }
+    }
+    if (list_only) {
+      for (const auto &[benchmark, args] : selected) {
+        std::cout << run_name(*benchmark, args) << "\n";
+      }
+      return 0;
+    }
+
+    if (format == "console") {
+      out << "- CPU: " << GF2CpuInfo::get().describe() << "\n";
+      out << "- CPU kernel: " << GF2Matrix::simdKernelName() << "\n";
+      out << "- GPU: "
+          << (backend() ? std::string(backend()->backendName()) + " " +
+                              backend()->deviceName()
+                        : std::string("none"))
+          << "\n\n";
+      print_console_header(out);
+    } else {
+      out << "name,iterations,real_time_ns,cpu_time_ns,bytes_per_second,"
+             "items_per_second,label,error\n";
+    }
+    for (const auto &[benchmark, args] : selected) {
+      for (const Measurement &m : run(*benchmark, args, min_time, repetitions)) {
+        if (format == "console") {
+          print_console(m, out);
+        } else {
+          print_csv(m, out);
+        }
+        out.flush();
+      }
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,132 @@
+"""Checks of the gf2 Python module (GF2Python.cpp), run by ctest when the
+module is built: the buffer-protocol export of matrices and views over
+padded rows, and that a view keeps its matrix alive."""
+
+import gc
+import unittest
+
+import gf2
+
+WORD = 8  # bytes per exported item (uint64)
+
+
+def view_of_temporary():
+    # The matrix is only reachable through the returned view
+    m = gf2.Matrix(70, 200)
+    m[10, 150] = True
+    m[19, 199] = True
+    return m.view(10, 20, 100, 200)
+
+
+class BufferTest(unittest.TestCase):
+    def test_matrix_buffer_over_padded_rows(self):
+        m = gf2.Matrix(5, 130)
+        self.assertEqual(m.words_per_row, 3)
+        self.assertGreater(m.row_stride, m.words_per_row)
+        mv = memoryview(m)
+        self.assertEqual(mv.format, "Q")
+        self.assertEqual(mv.itemsize, WORD)
+        self.assertEqual(mv.ndim, 2)
+        self.assertEqual(mv.shape, (5, 3))
+        self.assertEqual(mv.strides, (m.row_stride * WORD, WORD))
+        self.assertFalse(mv.readonly)
+
+        m[2, 129] = True
+        m[4, 0] = True
+        self.assertEqual(mv[2, 2], 1 << 1)
+        self.assertEqual(mv[4, 0], 1)
+        self.assertEqual(mv.tolist()[2], [0, 0, 2])
+
+        mv[1, 1] = 1 << 5
+        self.assertTrue(m[1, 69])
+
+    def test_view_buffer(self):
+        m = gf2.Matrix(8, 300)
+        m[3, 64] = True
+        m[6, 299] = True
+        v = m.view(1, 7, 64, 300)
+        self.assertEqual(v.bit_offset, 0)
+        mv = memoryview(v)
+        self.assertEqual(mv.shape, (6, 4))
+        self.assertEqual(mv.strides, (m.row_stride * WORD, WORD))
+        self.assertTrue(mv.readonly)
+        self.assertEqual(mv[2, 0], 1)
+        self.assertEqual(mv[5, 3], 1 << (299 - 256))
+
+    def test_unaligned_view_buffer(self):
+        m = gf2.Matrix(5, 130)
+        m[2, 3] = True
+        m[2, 69] = True
+        v = m.view(0, 5, 3, 70)
+        self.assertEqual(v.bit_offset, 3)
+        self.assertFalse(v.word_aligned)
+        mv = memoryview(v)
+        # Column 0 is bit 3 of each row's first word
+        self.assertEqual(mv.shape, (5, 2))
+        self.assertEqual(mv.strides, (m.row_stride * WORD, WORD))
+        self.assertEqual(mv[2, 0], 1 << 3)
+        self.assertEqual(mv[2, 1], 1 << 5)
+        self.assertTrue(v[2, 0])
+        self.assertTrue(v[2, 66])
+
+    def test_mutable_view_buffer(self):
+        m = gf2.Matrix(6, 200)
+        v = m.mutable_view(1, 4, 64, 200)
+        mv = memoryview(v)
+        self.assertFalse(mv.readonly)
+        self.assertEqual(mv.shape, (3, 3))
+        self.assertEqual(mv.strides, (m.row_stride * WORD, WORD))
+        mv[0, 0] = 1
+        mv[2, 1] = 1 << 7
+        self.assertTrue(m[1, 64])
+        self.assertTrue(m[3, 64 + 64 + 7])
+        self.assertEqual(m.popcount(), 2)
+
+
+class KeepAliveTest(unittest.TestCase):
+    def churn(self):
+        # Reuses freed matrix storage, should the view's matrix be gone
+        garbage = [gf2.Matrix(70, 200) for _ in range(8)]
+        for g in garbage:
+            g.random_fill()
+        gc.collect()
+
+    def test_view_keeps_matrix(self):
+        v = view_of_temporary()
+        gc.collect()
+        self.churn()
+        self.assertTrue(v[0, 50])
+        self.assertTrue(v[9, 99])
+        self.assertEqual(v.copy().popcount(), 2)
+
+    def test_view_of_view_keeps_matrix(self):
+        w = view_of_temporary().view(5, 10, 50, 100)
+        gc.collect()
+        self.churn()
+        self.assertTrue(w[4, 49])
+        self.assertEqual(w.copy().popcount(), 1)
+
+    def test_mutable_view_keeps_matrix(self):
+        def mutable_view_of_temporary():
+            m = gf2.Matrix(10, 100)
+            return m.mutable_view(2, 8, 0, 100)
+
+        v = mutable_view_of_temporary()
+        gc.collect()
+        self.churn()
+        v[5, 99] = True
+        self.assertTrue(v[5, 99])
+        self.assertEqual(v.copy().popcount(), 1)
+
+    def test_buffer_keeps_matrix(self):
+        # Columns 100 to 199 of the view's matrix: bit 36 of word 1 on
+        mv = memoryview(view_of_temporary())
+        gc.collect()
+        self.churn()
+        self.assertEqual(mv.shape, (10, 3))
+        self.assertEqual(mv[0, 1], 1 << (150 - 128))
+        self.assertEqual(mv[9, 2], 1 << (199 - 192))
+
+
+if __name__ == "__main__":
+    unittest.main()